@@ -16,6 +16,7 @@
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "codec"
+#include <dirent.h>
 #include <inttypes.h>
 #include <utils/Log.h>
 
@@ -47,7 +48,8 @@ static void usage(const char *me) {
                     "\t\t[-p] playback\n"
                     "\t\t[-S] allocate buffers from a surface\n"
                     "\t\t[-R] render output to surface (enables -S)\n"
-                    "\t\t[-T] use render timestamps (enables -R)\n",
+                    "\t\t[-T] use render timestamps (enables -R)\n"
+                    "\t\t[-b frames] pack up to this many audio frames per buffer\n",
                     me);
     exit(1);
 }
@@ -63,8 +65,110 @@ struct CodecState {
     int64_t mNumBuffersDecoded;
     int64_t mNumBytesDecoded;
     bool mIsAudio;
+    int32_t mSampleRate;
+    int32_t mChannelCount;
+    int32_t mMaxFramesPerBuffer;
+    sp<ABuffer> mSampleBuffer;
 };
 
+// Fills |buffer| with up to |maxFrames| samples of |trackIndex|, each preceded
+// by its length, the way a codec in multi-frame mode expects its input.
+static void readPackedSampleData(
+        const sp<NuMediaExtractor> &extractor, size_t trackIndex,
+        int32_t maxFrames, const sp<ABuffer> &sample,
+        const sp<ABuffer> &buffer) {
+    size_t size = 0;
+    for (int32_t numFrames = 0; numFrames < maxFrames; ++numFrames) {
+        size_t sampleTrackIndex;
+        if (extractor->getSampleTrackIndex(&sampleTrackIndex) != OK
+                || sampleTrackIndex != trackIndex) {
+            break;
+        }
+
+        status_t err = extractor->readSampleData(sample);
+        CHECK_EQ(err, (status_t)OK);
+
+        uint32_t length = sample->size();
+        if (size + sizeof(length) + length > buffer->capacity()) {
+            CHECK_GT(numFrames, 0);
+            break;
+        }
+
+        memcpy(buffer->base() + size, &length, sizeof(length));
+        memcpy(buffer->base() + size + sizeof(length), sample->data(), length);
+        size += sizeof(length) + length;
+
+        extractor->advance();
+    }
+
+    buffer->setRange(0, size);
+}
+
+// Returns the CPU time used by the process so far, in seconds.
+static double getProcessCpuTime(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char stat[1024];
+    size_t size = fread(stat, 1, sizeof(stat) - 1, file);
+    fclose(file);
+    stat[size] = '\0';
+
+    // utime and stime are the 12th and 13th fields after the command name
+    unsigned long utime, stime;
+    const char *fields = strrchr(stat, ')');
+    if (fields == NULL || sscanf(fields + 1,
+            " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+            &utime, &stime) != 2) {
+        return -1;
+    }
+
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+// Returns the pid of the process whose command line starts with |name|.
+static pid_t findProcess(const char *name) {
+    DIR *dir = opendir("/proc");
+    if (dir == NULL) {
+        return -1;
+    }
+
+    pid_t pid = -1;
+    struct dirent *entry;
+    while (pid < 0 && (entry = readdir(dir)) != NULL) {
+        char *end;
+        long id = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || id <= 0) {
+            continue;
+        }
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%ld/cmdline", id);
+
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+
+        char cmdline[128];
+        size_t size = fread(cmdline, 1, sizeof(cmdline) - 1, file);
+        fclose(file);
+        cmdline[size] = '\0';
+
+        if (!strcmp(cmdline, name)) {
+            pid = id;
+        }
+    }
+
+    closedir(dir);
+    return pid;
+}
+
 }  // namespace android
 
 static int decode(
@@ -74,7 +178,8 @@ static int decode(
         bool useVideo,
         const android::sp<android::Surface> &surface,
         bool renderSurface,
-        bool useTimestamp) {
+        bool useTimestamp,
+        int32_t maxFramesPerBuffer) {
     using namespace android;
 
     static int64_t kTimeout = 500ll;
@@ -119,6 +224,18 @@ static int decode(
         state->mNumBytesDecoded = 0;
         state->mNumBuffersDecoded = 0;
         state->mIsAudio = isAudio;
+        state->mSampleRate = 0;
+        state->mChannelCount = 0;
+        state->mMaxFramesPerBuffer = 1;
+
+        if (isAudio) {
+            format->findInt32("sample-rate", &state->mSampleRate);
+            format->findInt32("channel-count", &state->mChannelCount);
+
+            if (maxFramesPerBuffer > 1) {
+                format->setInt32("max-frames-per-buffer", maxFramesPerBuffer);
+            }
+        }
 
         state->mCodec = MediaCodec::CreateByType(
                 looper, mime.c_str(), false /* encoder */);
@@ -132,12 +249,31 @@ static int decode(
 
         CHECK_EQ(err, (status_t)OK);
 
+        // the codec tells whether it takes several frames per buffer
+        sp<AMessage> inputFormat;
+        CHECK_EQ((status_t)OK, state->mCodec->getInputFormat(&inputFormat));
+        inputFormat->findInt32("max-frames-per-buffer", &state->mMaxFramesPerBuffer);
+
+        if (maxFramesPerBuffer > 1 && isAudio) {
+            printf("track %zu: %d frames per buffer\n", i, state->mMaxFramesPerBuffer);
+        }
+
         state->mSignalledInputEOS = false;
         state->mSawOutputEOS = false;
     }
 
     CHECK(!stateByTrack.isEmpty());
 
+    // the codecs run in the codec process if there is one
+    pid_t codecPid = findProcess("media.codec");
+    const char *codecProcess = "media.codec";
+    if (codecPid < 0) {
+        codecPid = findProcess("/system/bin/mediaserver");
+        codecProcess = "mediaserver";
+    }
+    double startCpuTime = getProcessCpuTime(getpid());
+    double startCodecCpuTime = codecPid < 0 ? -1 : getProcessCpuTime(codecPid);
+
     int64_t startTimeUs = ALooper::GetNowUs();
     int64_t startTimeRender = -1;
 
@@ -153,6 +289,10 @@ static int decode(
 
         ALOGV("got %zu input and %zu output buffers",
               state->mInBuffers.size(), state->mOutBuffers.size());
+
+        if (state->mMaxFramesPerBuffer > 1) {
+            state->mSampleBuffer = new ABuffer(state->mInBuffers[0]->capacity());
+        }
     }
 
     bool sawInputEOS = false;
@@ -176,13 +316,21 @@ static int decode(
 
                     const sp<ABuffer> &buffer = state->mInBuffers.itemAt(index);
 
-                    err = extractor->readSampleData(buffer);
-                    CHECK_EQ(err, (status_t)OK);
-
                     int64_t timeUs;
                     err = extractor->getSampleTime(&timeUs);
                     CHECK_EQ(err, (status_t)OK);
 
+                    if (state->mMaxFramesPerBuffer > 1) {
+                        readPackedSampleData(
+                                extractor, trackIndex, state->mMaxFramesPerBuffer,
+                                state->mSampleBuffer, buffer);
+                    } else {
+                        err = extractor->readSampleData(buffer);
+                        CHECK_EQ(err, (status_t)OK);
+
+                        extractor->advance();
+                    }
+
                     uint32_t bufferFlags = 0;
 
                     err = state->mCodec->queueInputBuffer(
@@ -193,8 +341,6 @@ static int decode(
                             bufferFlags);
 
                     CHECK_EQ(err, (status_t)OK);
-
-                    extractor->advance();
                 } else {
                     CHECK_EQ(err, -EAGAIN);
                 }
@@ -299,6 +445,11 @@ static int decode(
                 CHECK_EQ((status_t)OK, state->mCodec->getOutputFormat(&format));
 
                 ALOGV("INFO_FORMAT_CHANGED: %s", format->debugString().c_str());
+
+                if (state->mIsAudio) {
+                    format->findInt32("sample-rate", &state->mSampleRate);
+                    format->findInt32("channel-count", &state->mChannelCount);
+                }
             } else {
                 CHECK_EQ(err, -EAGAIN);
             }
@@ -307,6 +458,10 @@ static int decode(
 
     int64_t elapsedTimeUs = ALooper::GetNowUs() - startTimeUs;
 
+    double cpuTime = getProcessCpuTime(getpid()) - startCpuTime;
+    double codecCpuTime = codecPid < 0 ? -1 : getProcessCpuTime(codecPid) - startCodecCpuTime;
+    double audioDurationSec = 0;
+
     for (size_t i = 0; i < stateByTrack.size(); ++i) {
         CodecState *state = &stateByTrack.editValueAt(i);
 
@@ -317,6 +472,11 @@ static int decode(
                    i,
                    (long long)state->mNumBytesDecoded,
                    state->mNumBytesDecoded * 1E6 / 1024 / elapsedTimeUs);
+
+            if (state->mSampleRate > 0 && state->mChannelCount > 0) {
+                audioDurationSec += state->mNumBytesDecoded
+                        / (double)(state->mSampleRate * state->mChannelCount * sizeof(int16_t));
+            }
         } else {
             printf("track %zu: %lld frames decoded, %.2f fps. %lld"
                     " bytes received. %.2f KB/sec\n",
@@ -328,6 +488,15 @@ static int decode(
         }
     }
 
+    // The CPU time of the codec process counts whatever else it did meanwhile,
+    // so this is only meaningful for audio alone on an idle device.
+    if (!haveVideo && audioDurationSec > 0 && codecCpuTime >= 0) {
+        printf("%.2f s of audio: %.3f s CPU here, %.3f s CPU in %s, "
+               "%.3f s CPU per minute of audio\n",
+               audioDurationSec, cpuTime, codecCpuTime, codecProcess,
+               (cpuTime + codecCpuTime) * 60 / audioDurationSec);
+    }
+
     return 0;
 }
 
@@ -342,9 +511,10 @@ int main(int argc, char **argv) {
     bool useSurface = false;
     bool renderSurface = false;
     bool useTimestamp = false;
+    int32_t maxFramesPerBuffer = 1;
 
     int res;
-    while ((res = getopt(argc, argv, "havpSDRT")) >= 0) {
+    while ((res = getopt(argc, argv, "havpSDRTb:")) >= 0) {
         switch (res) {
             case 'a':
             {
@@ -376,6 +546,14 @@ int main(int argc, char **argv) {
                 useSurface = true;
                 break;
             }
+            case 'b':
+            {
+                maxFramesPerBuffer = atoi(optarg);
+                if (maxFramesPerBuffer < 1) {
+                    usage(me);
+                }
+                break;
+            }
             case '?':
             case 'h':
             default:
@@ -451,7 +629,7 @@ int main(int argc, char **argv) {
         player->reset();
     } else {
         decode(looper, argv[0], useAudio, useVideo, surface, renderSurface,
-                useTimestamp);
+                useTimestamp, maxFramesPerBuffer);
     }
 
     if (playback || (useSurface && useVideo)) {
@@ -79,7 +79,11 @@ public:
     bool atLeastNumBitsLeft(size_t n) const;
 
 private:
-    int32_t mNumZeros;
+    // The bytes before mEmulationPrevention hold no emulation_prevention_three_byte.
+    // It points at one if mAtEmulationPrevention is set, otherwise at the end of
+    // the part of the data that has been scanned so far.
+    const uint8_t *mEmulationPrevention;
+    bool mAtEmulationPrevention;
 
     virtual bool fillReservoir();
 
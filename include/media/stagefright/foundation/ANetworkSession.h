@@ -22,15 +22,20 @@
 #include <utils/KeyedVector.h>
 #include <utils/RefBase.h>
 #include <utils/Thread.h>
+#include <utils/Vector.h>
 
 #include <netinet/in.h>
 
 namespace android {
 
+struct ABuffer;
 struct AMessage;
 
 // Helper class to manage a number of live sockets (datagram and stream-based)
 // on a single thread. Clients are notified about activity through AMessages.
+// Sockets are watched through an edge-triggered epoll set, so the cost of a
+// wakeup depends on the number of sockets that are ready rather than on the
+// number of sessions.
 struct ANetworkSession : public RefBase {
     ANetworkSession();
 
@@ -77,6 +82,16 @@ struct ANetworkSession : public RefBase {
             int32_t sessionID, const void *data, ssize_t size = -1,
             bool timeValid = false, int64_t timeUs = -1ll);
 
+    // Queues a datagram made up of |size| bytes of |data|, which are
+    // copied, followed by |payloadSize| bytes of |payload|'s data starting
+    // at |payloadOffset|. The payload is sent by reference and must not be
+    // modified afterwards. Only valid on UDP and TCP datagram sessions.
+    status_t sendDatagram(
+            int32_t sessionID, const void *data, size_t size,
+            const sp<ABuffer> &payload, size_t payloadOffset,
+            size_t payloadSize,
+            bool timeValid = false, int64_t timeUs = -1ll);
+
     status_t switchToWebSocketMode(int32_t sessionID);
 
     enum NotificationReason {
@@ -103,9 +118,14 @@ private:
     int32_t mNextSessionID;
 
     int mPipeFd[2];
+    int mEpollFd;
 
     KeyedVector<int32_t, sp<Session> > mSessions;
 
+    // Sessions that have data queued that the network thread hasn't tried
+    // to send yet.
+    Vector<int32_t> mPendingWrites;
+
     enum Mode {
         kModeCreateUDPSession,
         kModeCreateTCPDatagramSessionPassive,
@@ -122,6 +142,11 @@ private:
             const sp<AMessage> &notify,
             int32_t *sessionID);
 
+    status_t addSession(const sp<Session> &session);
+    void processEvents(const sp<Session> &session, uint32_t events);
+    void acceptConnections(const sp<Session> &session);
+    void drainInterruptPipe();
+
     void threadLoop();
     void interrupt();
 
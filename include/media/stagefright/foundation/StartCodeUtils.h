@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef START_CODE_UTILS_H_
+
+#define START_CODE_UTILS_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// Returns the offset of the first 0x00 0x00 0x01 start code prefix in
+// |data|, or |size| if there is none. Uses SSE2 or NEON where available.
+size_t findStartCode(const uint8_t *data, size_t size);
+
+// Returns the offset of the first 0x00 0x00 0x03 sequence in |data|, i.e.
+// the emulation_prevention_three_byte is at the returned offset + 2, or
+// |size| if there is none.
+size_t findEmulationPrevention(const uint8_t *data, size_t size);
+
+// Byte-at-a-time versions of the above, for reference and testing.
+size_t findStartCodeScalar(const uint8_t *data, size_t size);
+size_t findEmulationPreventionScalar(const uint8_t *data, size_t size);
+
+}  // namespace android
+
+#endif  // START_CODE_UTILS_H_
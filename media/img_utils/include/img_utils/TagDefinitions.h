@@ -142,6 +142,11 @@ enum {
     TAG_THRESHHOLDING = 0x0107u,
     TAG_STRIPOFFSETS = 0x0111u,
     TAG_STRIPBYTECOUNTS = 0x0117u,
+    TAG_TILEWIDTH = 0x0142u,
+    TAG_TILELENGTH = 0x0143u,
+    TAG_TILEOFFSETS = 0x0144u,
+    TAG_TILEBYTECOUNTS = 0x0145u,
+    TAG_PREDICTOR = 0x013Du,
     TAG_SOFTWARE = 0x0131u,
     TAG_SAMPLESPERPIXEL = 0x0115u,
     TAG_ROWSPERSTRIP = 0x0116u,
@@ -204,6 +209,16 @@ enum {
     TAG_ORIENTATION_UNKNOWN = 9
 };
 
+enum {
+    TAG_COMPRESSION_NONE = 1,
+    TAG_COMPRESSION_DEFLATE = 8
+};
+
+enum {
+    TAG_PREDICTOR_NONE = 1,
+    TAG_PREDICTOR_HORIZONTAL = 2
+};
+
 /**
  * TIFF_EP_TAG_DEFINITIONS contains tags defined in the TIFF EP spec
  */
@@ -590,6 +605,14 @@ const TagDefinition_t TIFF_6_TAG_DEFINITIONS[] = {
         1,
         UNDEFINED_ENDIAN
     },
+    { // Predictor
+        "Predictor",
+        0x013Du,
+        SHORT,
+        IFD_0,
+        1,
+        UNDEFINED_ENDIAN
+    },
     { // ResolutionUnit
         "ResolutionUnit",
         0x0128u,
@@ -654,6 +677,38 @@ const TagDefinition_t TIFF_6_TAG_DEFINITIONS[] = {
         1,
         UNDEFINED_ENDIAN
     },
+    { // TileByteCounts
+        "TileByteCounts",
+        0x0145u,
+        LONG,
+        IFD_0,
+        0,
+        UNDEFINED_ENDIAN
+    },
+    { // TileLength
+        "TileLength",
+        0x0143u,
+        LONG,
+        IFD_0,
+        1,
+        UNDEFINED_ENDIAN
+    },
+    { // TileOffsets
+        "TileOffsets",
+        0x0144u,
+        LONG,
+        IFD_0,
+        0,
+        UNDEFINED_ENDIAN
+    },
+    { // TileWidth
+        "TileWidth",
+        0x0142u,
+        LONG,
+        IFD_0,
+        1,
+        UNDEFINED_ENDIAN
+    },
     { // XResolution
         "XResolution",
         0x011Au,
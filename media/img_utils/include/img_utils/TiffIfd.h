@@ -27,6 +27,7 @@
 #include <utils/String8.h>
 #include <utils/SortedVector.h>
 #include <utils/StrongPointer.h>
+#include <utils/Vector.h>
 #include <stdint.h>
 
 namespace android {
@@ -115,13 +116,45 @@ class ANDROID_API TiffIfd : public TiffWritable {
          */
         virtual status_t validateAndSetStripTags();
 
+        /**
+         * Convenience method to validate and set tile-related image tags.
+         *
+         * This sets the TileWidth, TileLength, TileByteCounts, TileOffsets,
+         * Compression and Predictor tags, and removes any strip tags.  Offset
+         * values are left unitialized, and byte counts are set to the size of
+         * an uncompressed tile; setTileByteCounts must be called with the
+         * actual sizes if the tiles are compressed.  Edge tiles are padded to
+         * the full tile size.
+         *
+         * The tile dimensions must be non-zero multiples of 16.  Does not
+         * handle planar image configurations (PlanarConfiguration != 1).
+         *
+         * Returns OK on success, or a negative error code.
+         */
+        virtual status_t validateAndSetTileTags(uint32_t tileWidth, uint32_t tileLength,
+                uint16_t compression);
+
+        /**
+         * Returns true if validateAndSetTileTags has been called, and image data for this
+         * IFD is stored in tiles rather than strips.
+         */
+        virtual bool isTiled() const;
+
+        /**
+         * Replace the byte counts set for each tile.
+         *
+         * Returns OK on success, or a negative error code.
+         */
+        virtual status_t setTileByteCounts(const Vector<uint32_t>& byteCounts);
+
         /**
          * Returns true if validateAndSetStripTags has been called, but not setStripOffsets.
          */
         virtual bool uninitializedOffsets() const;
 
         /**
-         * Convenience method to set beginning offset for strips.
+         * Convenience method to set beginning offset for strips, or tiles if
+         * this IFD is tiled.
          *
          * Call this to update the strip offsets before calling writeData.
          *
@@ -133,7 +166,7 @@ class ANDROID_API TiffIfd : public TiffWritable {
          * Get the total size of the strips in bytes.
          *
          * This sums the byte count at each strip offset, and returns
-         * the total count of bytes stored in strips for this IFD.
+         * the total count of bytes stored in strips (or tiles) for this IFD.
          */
         virtual uint32_t getStripSize() const;
 
@@ -158,6 +191,7 @@ class ANDROID_API TiffIfd : public TiffWritable {
         sp<TiffIfd> mNextIfd;
         uint32_t mIfdId;
         bool mStripOffsetsInitialized;
+        bool mTiled;
 };
 
 } /*namespace img_utils*/
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMG_UTILS_TIFF_TILE_ENCODER_H
+#define IMG_UTILS_TIFF_TILE_ENCODER_H
+
+#include <img_utils/EndianUtils.h>
+#include <img_utils/Output.h>
+
+#include <cutils/compiler.h>
+#include <utils/Condition.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+namespace android {
+namespace img_utils {
+
+/**
+ * Utility class that splits an image into TIFF tiles and optionally
+ * compresses them.
+ *
+ * Row-major pixel data is written to this class as an Output, typically
+ * from a StripSource.  Each time a full band of tile rows has been received,
+ * the tiles in that band are padded to the full tile size and compressed in
+ * parallel on a pool of worker threads.  Once all of the image has been
+ * written and finish has been called, the encoded tiles can be written to
+ * an Output in order.
+ *
+ * Supported compression schemes are TAG_COMPRESSION_NONE and
+ * TAG_COMPRESSION_DEFLATE.  Deflate compression applies the TIFF horizontal
+ * differencing predictor for 8 and 16 bit samples.
+ */
+class ANDROID_API TiffTileEncoder : public Output, public LightRefBase<TiffTileEncoder> {
+    public:
+        /**
+         * Create an encoder for an image of the given dimensions and pixel
+         * layout.  The endianness is used to interpret multi-byte samples for
+         * the predictor, and must match the endianness of the TIFF file.
+         * workerCount is the number of threads that compress tiles in addition
+         * to the thread calling write; 0 compresses on the calling thread only.
+         */
+        TiffTileEncoder(uint32_t width, uint32_t height, uint32_t samplesPerPixel,
+                uint32_t bytesPerSample, uint32_t tileWidth, uint32_t tileLength,
+                uint16_t compression, Endianness end, size_t workerCount);
+
+        virtual ~TiffTileEncoder();
+
+        /**
+         * Write row-major pixel data for the image.  Tiles are encoded as each
+         * band of tile rows is completed.
+         *
+         * Returns OK on success, or a negative error code.
+         */
+        virtual status_t write(const uint8_t* buf, size_t offset, size_t count);
+
+        /**
+         * Encode the last band of tiles.  This must be called once all rows
+         * of the image have been written.
+         *
+         * Returns OK on success, or a negative error code.
+         */
+        virtual status_t finish();
+
+        /**
+         * Get the number of tiles in the image.
+         */
+        virtual size_t getTileCount() const;
+
+        /**
+         * Get the encoded size in bytes of each tile.
+         */
+        virtual void getTileByteCounts(/*out*/Vector<uint32_t>* byteCounts) const;
+
+        /**
+         * Get the total encoded size in bytes of all tiles.
+         */
+        virtual uint32_t getTotalSize() const;
+
+        /**
+         * Write the encoded tiles to the given Output in order.
+         *
+         * Returns OK on success, or a negative error code.
+         */
+        virtual status_t writeTiles(Output* out) const;
+
+    private:
+        static void* threadWrapper(void* me);
+        void threadLoop();
+
+        status_t encodeBand(uint32_t bandRows);
+        status_t encodeTile(size_t tileIndex, uint32_t bandRows);
+        void applyPredictor(uint8_t* row) const;
+
+        const uint32_t mWidth;
+        const uint32_t mHeight;
+        const uint32_t mSamplesPerPixel;
+        const uint32_t mBytesPerSample;
+        const uint32_t mTileWidth;
+        const uint32_t mTileLength;
+        const uint16_t mCompression;
+        const Endianness mEndian;
+
+        uint32_t mRowBytes;
+        uint32_t mTilesAcross;
+        uint32_t mTilesDown;
+
+        // Raw data for the band of tile rows currently being received
+        Vector<uint8_t> mBand;
+        size_t mBandFill;
+        uint32_t mBandIndex;
+
+        // Encoded tiles, indexed in TIFF tile order
+        Vector<Vector<uint8_t> > mTiles;
+
+        Mutex mLock;
+        Condition mWorkAvailable;
+        Condition mBandDone;
+        Vector<pthread_t> mWorkers;
+        size_t mNextTile;
+        size_t mBandTileEnd;
+        uint32_t mBandRows;
+        size_t mPendingTiles;
+        status_t mBandStatus;
+        bool mExiting;
+};
+
+} /*namespace img_utils*/
+} /*namespace android*/
+
+#endif /*IMG_UTILS_TIFF_TILE_ENCODER_H*/
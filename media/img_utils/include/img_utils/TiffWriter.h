@@ -22,6 +22,7 @@
 #include <img_utils/TiffEntryImpl.h>
 #include <img_utils/TagDefinitions.h>
 #include <img_utils/TiffIfd.h>
+#include <img_utils/TiffTileEncoder.h>
 
 #include <utils/Log.h>
 #include <utils/Errors.h>
@@ -88,6 +89,10 @@ class ANDROID_API TiffWriter : public LightRefBase<TiffWriter> {
          * StripOffsets tags must be set to use this.  To set these tags in a
          * given IFD, use the addStrip method.
          *
+         * For IFDs set up with the addTiles method, the StripSource data is
+         * split into tiles and compressed before the header is written, and
+         * the TileByteCounts and TileOffsets tags are updated to match.
+         *
          * Returns OK on success, or a negative error code on failure.
          */
         virtual status_t write(Output* out, StripSource** sources, size_t sourcesCount,
@@ -175,6 +180,27 @@ class ANDROID_API TiffWriter : public LightRefBase<TiffWriter> {
          */
         virtual status_t addStrip(uint32_t ifd);
 
+        /**
+         * Convenience function to set the tile related tags for a given IFD.
+         *
+         * Call this instead of addStrip before using a StripSource as an input
+         * to write to store the image data for this IFD in tiles of the given
+         * size.  The tile dimensions must be multiples of 16.  compression must
+         * be TAG_COMPRESSION_NONE or TAG_COMPRESSION_DEFLATE.
+         *
+         * The same tags as for addStrip must be set before calling this method.
+         *
+         * Returns OK on success, or a negative error code.
+         */
+        virtual status_t addTiles(uint32_t ifd, uint32_t tileWidth, uint32_t tileLength,
+                uint16_t compression = TAG_COMPRESSION_NONE);
+
+        /**
+         * Set the number of worker threads used to compress tiles during write,
+         * in addition to the calling thread.  Defaults to 0.
+         */
+        virtual void setTileWorkerCount(size_t count);
+
         /**
          * Return the TIFF entry with the given tag ID in the IFD with the given ID,
          * or an empty pointer if none exists.
@@ -259,11 +285,14 @@ class ANDROID_API TiffWriter : public LightRefBase<TiffWriter> {
         status_t writeFileHeader(EndianOutput& out);
         const TagDefinition_t* lookupDefinition(uint16_t tag) const;
         status_t calculateOffsets();
+        status_t encodeTiles(const sp<TiffIfd>& ifd, StripSource* source, Endianness end,
+                /*out*/sp<TiffTileEncoder>* encoder) const;
 
         sp<TiffIfd> mIfd;
         KeyedVector<uint32_t, sp<TiffIfd> > mNamedIfds;
         KeyedVector<uint16_t, const TagDefinition_t*>* mTagMaps;
         size_t mNumTagMaps;
+        size_t mTileWorkerCount;
 
         static KeyedVector<uint16_t, const TagDefinition_t*> sTagMaps[];
 };
@@ -26,6 +26,7 @@ LOCAL_SRC_FILES := \
   Orderable.cpp \
   TiffIfd.cpp \
   TiffWritable.cpp \
+  TiffTileEncoder.cpp \
   TiffWriter.cpp \
   TiffEntry.cpp \
   TiffEntryImpl.cpp \
@@ -38,7 +39,8 @@ LOCAL_SHARED_LIBRARIES := \
   libutils \
   libcutils \
   libcamera_metadata \
-  libcamera_client
+  libcamera_client \
+  libz
 
 LOCAL_C_INCLUDES += \
   $(LOCAL_PATH)/../include \
@@ -27,7 +27,7 @@ namespace android {
 namespace img_utils {
 
 TiffIfd::TiffIfd(uint32_t ifdId)
-        : mNextIfd(), mIfdId(ifdId), mStripOffsetsInitialized(false) {}
+        : mNextIfd(), mIfdId(ifdId), mStripOffsetsInitialized(false), mTiled(false) {}
 
 TiffIfd::~TiffIfd() {}
 
@@ -289,29 +289,153 @@ status_t TiffIfd::validateAndSetStripTags() {
     return OK;
 }
 
+status_t TiffIfd::validateAndSetTileTags(uint32_t tileWidth, uint32_t tileLength,
+        uint16_t compression) {
+    sp<TiffEntry> widthEntry = getEntry(TAG_IMAGEWIDTH);
+    if (widthEntry == NULL) {
+        ALOGE("%s: IFD %u doesn't have a ImageWidth tag set", __FUNCTION__, mIfdId);
+        return BAD_VALUE;
+    }
+
+    sp<TiffEntry> heightEntry = getEntry(TAG_IMAGELENGTH);
+    if (heightEntry == NULL) {
+        ALOGE("%s: IFD %u doesn't have a ImageLength tag set", __FUNCTION__, mIfdId);
+        return BAD_VALUE;
+    }
+
+    sp<TiffEntry> samplesEntry = getEntry(TAG_SAMPLESPERPIXEL);
+    if (samplesEntry == NULL) {
+        ALOGE("%s: IFD %u doesn't have a SamplesPerPixel tag set", __FUNCTION__, mIfdId);
+        return BAD_VALUE;
+    }
+
+    sp<TiffEntry> bitsEntry = getEntry(TAG_BITSPERSAMPLE);
+    if (bitsEntry == NULL) {
+        ALOGE("%s: IFD %u doesn't have a BitsPerSample tag set", __FUNCTION__, mIfdId);
+        return BAD_VALUE;
+    }
+
+    if (tileWidth == 0 || tileLength == 0 || (tileWidth % 16) != 0 ||
+            (tileLength % 16) != 0) {
+        ALOGE("%s: Tile size %ux%u in IFD %u is not a multiple of 16.", __FUNCTION__,
+                tileWidth, tileLength, mIfdId);
+        return BAD_VALUE;
+    }
+
+    if (compression != TAG_COMPRESSION_NONE && compression != TAG_COMPRESSION_DEFLATE) {
+        ALOGE("%s: Unsupported compression %u for IFD %u.", __FUNCTION__, compression,
+                mIfdId);
+        return BAD_VALUE;
+    }
+
+    uint32_t width = *(widthEntry->getData<uint32_t>());
+    uint32_t height = *(heightEntry->getData<uint32_t>());
+    uint16_t bitsPerSample = *(bitsEntry->getData<uint16_t>());
+    uint16_t samplesPerPixel = *(samplesEntry->getData<uint16_t>());
+
+    if ((bitsPerSample % 8) != 0) {
+        ALOGE("%s: BitsPerSample %d in IFD %u is not byte-aligned.", __FUNCTION__,
+                bitsPerSample, mIfdId);
+        return BAD_VALUE;
+    }
+
+    uint32_t bytesPerSample = bitsPerSample / 8;
+    const uint32_t tileSize = bytesPerSample * samplesPerPixel * tileWidth * tileLength;
+    const uint32_t tilesAcross = (width + tileWidth - 1) / tileWidth;
+    const uint32_t tilesDown = (height + tileLength - 1) / tileLength;
+    const uint32_t numTiles = tilesAcross * tilesDown;
+
+    Vector<uint32_t> byteCounts;
+    byteCounts.insertAt(tileSize, 0, numTiles);
+
+    Vector<uint32_t> tileOffsetsVector;
+    tileOffsetsVector.resize(numTiles);
+
+    uint16_t predictorVal = (compression == TAG_COMPRESSION_DEFLATE && bytesPerSample <= 2) ?
+            TAG_PREDICTOR_HORIZONTAL : TAG_PREDICTOR_NONE;
+
+    sp<TiffEntry> entries[] = {
+        TiffWriter::uncheckedBuildEntry(TAG_TILEWIDTH, LONG, 1, UNDEFINED_ENDIAN, &tileWidth),
+        TiffWriter::uncheckedBuildEntry(TAG_TILELENGTH, LONG, 1, UNDEFINED_ENDIAN,
+                &tileLength),
+        TiffWriter::uncheckedBuildEntry(TAG_TILEBYTECOUNTS, LONG, numTiles, UNDEFINED_ENDIAN,
+                byteCounts.array()),
+        TiffWriter::uncheckedBuildEntry(TAG_TILEOFFSETS, LONG, numTiles, UNDEFINED_ENDIAN,
+                tileOffsetsVector.array()),
+        TiffWriter::uncheckedBuildEntry(TAG_COMPRESSION, SHORT, 1, UNDEFINED_ENDIAN,
+                &compression),
+        TiffWriter::uncheckedBuildEntry(TAG_PREDICTOR, SHORT, 1, UNDEFINED_ENDIAN,
+                &predictorVal),
+    };
+
+    for (size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); ++i) {
+        if (entries[i] == NULL || addEntry(entries[i]) != OK) {
+            ALOGE("%s: Could not add tile entries to IFD %u", __FUNCTION__, mIfdId);
+            return BAD_VALUE;
+        }
+    }
+
+    removeEntry(TAG_STRIPOFFSETS);
+    removeEntry(TAG_STRIPBYTECOUNTS);
+    removeEntry(TAG_ROWSPERSTRIP);
+
+    mTiled = true;
+    mStripOffsetsInitialized = true;
+    return OK;
+}
+
+bool TiffIfd::isTiled() const {
+    return mTiled;
+}
+
+status_t TiffIfd::setTileByteCounts(const Vector<uint32_t>& byteCounts) {
+    sp<TiffEntry> oldByteCounts = getEntry(TAG_TILEBYTECOUNTS);
+    if (oldByteCounts == NULL) {
+        ALOGE("%s: IFD %u does not contain TileByteCounts entry.", __FUNCTION__, mIfdId);
+        return BAD_VALUE;
+    }
+
+    if (oldByteCounts->getCount() != byteCounts.size()) {
+        ALOGE("%s: Tile count (%zu) doesn't match TileByteCounts count (%u) in IFD %u",
+                __FUNCTION__, byteCounts.size(), oldByteCounts->getCount(), mIfdId);
+        return BAD_VALUE;
+    }
+
+    sp<TiffEntry> newByteCounts = TiffWriter::uncheckedBuildEntry(TAG_TILEBYTECOUNTS, LONG,
+            static_cast<uint32_t>(byteCounts.size()), UNDEFINED_ENDIAN, byteCounts.array());
+
+    if (newByteCounts == NULL || addEntry(newByteCounts) != OK) {
+        ALOGE("%s: Failed to add updated byte counts entry in IFD %u", __FUNCTION__, mIfdId);
+        return BAD_VALUE;
+    }
+    return OK;
+}
+
 bool TiffIfd::uninitializedOffsets() const {
     return mStripOffsetsInitialized;
 }
 
 status_t TiffIfd::setStripOffset(uint32_t offset) {
+    const uint16_t offsetsTag = mTiled ? TAG_TILEOFFSETS : TAG_STRIPOFFSETS;
+    const uint16_t byteCountsTag = mTiled ? TAG_TILEBYTECOUNTS : TAG_STRIPBYTECOUNTS;
 
     // Get old offsets and bytecounts
-    sp<TiffEntry> oldOffsets = getEntry(TAG_STRIPOFFSETS);
+    sp<TiffEntry> oldOffsets = getEntry(offsetsTag);
     if (oldOffsets == NULL) {
-        ALOGE("%s: IFD %u does not contain StripOffsets entry.", __FUNCTION__, mIfdId);
+        ALOGE("%s: IFD %u does not contain offsets entry.", __FUNCTION__, mIfdId);
         return BAD_VALUE;
     }
 
-    sp<TiffEntry> stripByteCounts = getEntry(TAG_STRIPBYTECOUNTS);
+    sp<TiffEntry> stripByteCounts = getEntry(byteCountsTag);
     if (stripByteCounts == NULL) {
-        ALOGE("%s: IFD %u does not contain StripByteCounts entry.", __FUNCTION__, mIfdId);
+        ALOGE("%s: IFD %u does not contain byte counts entry.", __FUNCTION__, mIfdId);
         return BAD_VALUE;
     }
 
     uint32_t offsetsCount = oldOffsets->getCount();
     uint32_t byteCount = stripByteCounts->getCount();
     if (offsetsCount != byteCount) {
-        ALOGE("%s: StripOffsets count (%u) doesn't match StripByteCounts count (%u) in IFD %u",
+        ALOGE("%s: Offsets count (%u) doesn't match byte counts count (%u) in IFD %u",
             __FUNCTION__, offsetsCount, byteCount, mIfdId);
         return BAD_VALUE;
     }
@@ -328,7 +452,7 @@ status_t TiffIfd::setStripOffset(uint32_t offset) {
         offset += stripByteCountsArray[i];
     }
 
-    sp<TiffEntry> newOffsets = TiffWriter::uncheckedBuildEntry(TAG_STRIPOFFSETS, LONG,
+    sp<TiffEntry> newOffsets = TiffWriter::uncheckedBuildEntry(offsetsTag, LONG,
             static_cast<uint32_t>(numStrips), UNDEFINED_ENDIAN, stripOffsets.array());
 
     if (newOffsets == NULL) {
@@ -344,9 +468,9 @@ status_t TiffIfd::setStripOffset(uint32_t offset) {
 }
 
 uint32_t TiffIfd::getStripSize() const {
-    sp<TiffEntry> stripByteCounts = getEntry(TAG_STRIPBYTECOUNTS);
+    sp<TiffEntry> stripByteCounts = getEntry(mTiled ? TAG_TILEBYTECOUNTS : TAG_STRIPBYTECOUNTS);
     if (stripByteCounts == NULL) {
-        ALOGE("%s: IFD %u does not contain StripByteCounts entry.", __FUNCTION__, mIfdId);
+        ALOGE("%s: IFD %u does not contain byte counts entry.", __FUNCTION__, mIfdId);
         return BAD_VALUE;
     }
 
@@ -0,0 +1,284 @@
+/*
+ * Copyright 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TiffTileEncoder"
+
+#include <img_utils/TagDefinitions.h>
+#include <img_utils/TiffTileEncoder.h>
+
+#include <utils/Log.h>
+
+#include <string.h>
+#include <zlib.h>
+
+namespace android {
+namespace img_utils {
+
+TiffTileEncoder::TiffTileEncoder(uint32_t width, uint32_t height, uint32_t samplesPerPixel,
+        uint32_t bytesPerSample, uint32_t tileWidth, uint32_t tileLength,
+        uint16_t compression, Endianness end, size_t workerCount)
+        : mWidth(width), mHeight(height), mSamplesPerPixel(samplesPerPixel),
+          mBytesPerSample(bytesPerSample), mTileWidth(tileWidth), mTileLength(tileLength),
+          mCompression(compression), mEndian(end), mBandFill(0), mBandIndex(0),
+          mNextTile(0), mBandTileEnd(0), mBandRows(0), mPendingTiles(0),
+          mBandStatus(OK), mExiting(false) {
+    mRowBytes = mWidth * mSamplesPerPixel * mBytesPerSample;
+    mTilesAcross = (mWidth + mTileWidth - 1) / mTileWidth;
+    mTilesDown = (mHeight + mTileLength - 1) / mTileLength;
+
+    mBand.insertAt(0, 0, mRowBytes * mTileLength);
+    mTiles.insertAt(0, mTilesAcross * mTilesDown);
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, threadWrapper, this) != 0) {
+            ALOGW("%s: Could not start tile worker %zu, continuing with %zu workers.",
+                    __FUNCTION__, i, mWorkers.size());
+            break;
+        }
+        mWorkers.push_back(thread);
+    }
+}
+
+TiffTileEncoder::~TiffTileEncoder() {
+    {
+        Mutex::Autolock l(mLock);
+        mExiting = true;
+        mWorkAvailable.broadcast();
+    }
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        pthread_join(mWorkers[i], NULL);
+    }
+}
+
+void* TiffTileEncoder::threadWrapper(void* me) {
+    static_cast<TiffTileEncoder*>(me)->threadLoop();
+    return NULL;
+}
+
+void TiffTileEncoder::threadLoop() {
+    Mutex::Autolock l(mLock);
+    while (true) {
+        while (!mExiting && mNextTile >= mBandTileEnd) {
+            mWorkAvailable.wait(mLock);
+        }
+        if (mExiting) {
+            return;
+        }
+
+        size_t tile = mNextTile++;
+        uint32_t bandRows = mBandRows;
+
+        mLock.unlock();
+        status_t err = encodeTile(tile, bandRows);
+        mLock.lock();
+
+        if (err != OK) {
+            mBandStatus = err;
+        }
+        if (--mPendingTiles == 0) {
+            mBandDone.signal();
+        }
+    }
+}
+
+status_t TiffTileEncoder::write(const uint8_t* buf, size_t offset, size_t count) {
+    const size_t bandBytes = mBand.size();
+    buf += offset;
+
+    while (count > 0) {
+        if (mBandIndex >= mTilesDown) {
+            ALOGE("%s: Received more data than fits in a %ux%u image.", __FUNCTION__,
+                    mWidth, mHeight);
+            return BAD_VALUE;
+        }
+
+        size_t toCopy = bandBytes - mBandFill;
+        if (toCopy > count) {
+            toCopy = count;
+        }
+        memcpy(mBand.editArray() + mBandFill, buf, toCopy);
+        mBandFill += toCopy;
+        buf += toCopy;
+        count -= toCopy;
+
+        if (mBandFill == bandBytes) {
+            status_t err = encodeBand(mTileLength);
+            if (err != OK) {
+                return err;
+            }
+        }
+    }
+    return OK;
+}
+
+status_t TiffTileEncoder::finish() {
+    uint32_t rows = mBandFill / mRowBytes;
+    if (mBandFill % mRowBytes != 0 || mBandIndex * mTileLength + rows != mHeight) {
+        ALOGE("%s: Image data is incomplete, received %u rows out of %u.", __FUNCTION__,
+                mBandIndex * mTileLength + rows, mHeight);
+        return BAD_VALUE;
+    }
+
+    if (rows > 0) {
+        return encodeBand(rows);
+    }
+    return OK;
+}
+
+status_t TiffTileEncoder::encodeBand(uint32_t bandRows) {
+    const size_t firstTile = mBandIndex * mTilesAcross;
+    const size_t endTile = firstTile + mTilesAcross;
+    status_t ret = OK;
+
+    if (mWorkers.size() == 0) {
+        for (size_t i = firstTile; i < endTile && ret == OK; ++i) {
+            ret = encodeTile(i, bandRows);
+        }
+    } else {
+        Mutex::Autolock l(mLock);
+        mBandRows = bandRows;
+        mBandStatus = OK;
+        mPendingTiles = mTilesAcross;
+        mNextTile = firstTile;
+        mBandTileEnd = endTile;
+        mWorkAvailable.broadcast();
+
+        // Help out with the band rather than idling until the workers finish.
+        while (mNextTile < mBandTileEnd) {
+            size_t tile = mNextTile++;
+
+            mLock.unlock();
+            status_t err = encodeTile(tile, bandRows);
+            mLock.lock();
+
+            if (err != OK) {
+                mBandStatus = err;
+            }
+            --mPendingTiles;
+        }
+        while (mPendingTiles > 0) {
+            mBandDone.wait(mLock);
+        }
+        ret = mBandStatus;
+    }
+
+    mBandFill = 0;
+    ++mBandIndex;
+    return ret;
+}
+
+status_t TiffTileEncoder::encodeTile(size_t tileIndex, uint32_t bandRows) {
+    const uint32_t pixelBytes = mSamplesPerPixel * mBytesPerSample;
+    const uint32_t tileRowBytes = mTileWidth * pixelBytes;
+    const uint32_t tileX = (tileIndex % mTilesAcross) * mTileWidth;
+
+    uint32_t copyBytes = tileRowBytes;
+    if (tileX + mTileWidth > mWidth) {
+        copyBytes = (mWidth - tileX) * pixelBytes;
+    }
+
+    // Each tile is padded with zeroes to the full tile size.
+    Vector<uint8_t> raw;
+    raw.insertAt(0, 0, tileRowBytes * mTileLength);
+    uint8_t* rawData = raw.editArray();
+    const uint8_t* band = mBand.array() + tileX * pixelBytes;
+    for (uint32_t row = 0; row < bandRows; ++row) {
+        memcpy(rawData + row * tileRowBytes, band + row * mRowBytes, copyBytes);
+    }
+
+    // Workers only touch their own tile, and mTiles is never resized.
+    Vector<uint8_t>& tile = mTiles.editArray()[tileIndex];
+
+    if (mCompression == TAG_COMPRESSION_NONE) {
+        tile = raw;
+        return OK;
+    }
+
+    if (mBytesPerSample <= 2) {
+        for (uint32_t row = 0; row < mTileLength; ++row) {
+            applyPredictor(rawData + row * tileRowBytes);
+        }
+    }
+
+    uLongf compressedSize = compressBound(raw.size());
+    tile.clear();
+    tile.insertAt(0, 0, compressedSize);
+    int err = compress2(tile.editArray(), &compressedSize, raw.array(), raw.size(),
+            Z_DEFAULT_COMPRESSION);
+    if (err != Z_OK) {
+        ALOGE("%s: Failed to compress tile %zu: %d", __FUNCTION__, tileIndex, err);
+        return BAD_VALUE;
+    }
+    tile.removeItemsAt(compressedSize, tile.size() - compressedSize);
+    return OK;
+}
+
+void TiffTileEncoder::applyPredictor(uint8_t* row) const {
+    // Horizontal differencing, applied right to left so each sample is
+    // replaced by its difference to the same sample of the previous pixel.
+    const uint32_t count = mTileWidth * mSamplesPerPixel;
+    if (mBytesPerSample == 1) {
+        for (uint32_t i = count - 1; i >= mSamplesPerPixel; --i) {
+            row[i] -= row[i - mSamplesPerPixel];
+        }
+    } else if (mBytesPerSample == 2) {
+        const bool big = (mEndian == BIG);
+        for (uint32_t i = count - 1; i >= mSamplesPerPixel; --i) {
+            uint8_t* cur = row + 2 * i;
+            const uint8_t* prev = row + 2 * (i - mSamplesPerPixel);
+            uint16_t c = big ? (cur[0] << 8) | cur[1] : (cur[1] << 8) | cur[0];
+            uint16_t p = big ? (prev[0] << 8) | prev[1] : (prev[1] << 8) | prev[0];
+            uint16_t d = c - p;
+            cur[big ? 0 : 1] = d >> 8;
+            cur[big ? 1 : 0] = d & 0xFF;
+        }
+    }
+}
+
+size_t TiffTileEncoder::getTileCount() const {
+    return mTiles.size();
+}
+
+void TiffTileEncoder::getTileByteCounts(/*out*/Vector<uint32_t>* byteCounts) const {
+    byteCounts->clear();
+    byteCounts->setCapacity(mTiles.size());
+    for (size_t i = 0; i < mTiles.size(); ++i) {
+        byteCounts->push_back(static_cast<uint32_t>(mTiles[i].size()));
+    }
+}
+
+uint32_t TiffTileEncoder::getTotalSize() const {
+    uint32_t total = 0;
+    for (size_t i = 0; i < mTiles.size(); ++i) {
+        total += mTiles[i].size();
+    }
+    return total;
+}
+
+status_t TiffTileEncoder::writeTiles(Output* out) const {
+    status_t ret = OK;
+    for (size_t i = 0; i < mTiles.size(); ++i) {
+        if ((ret = out->write(mTiles[i].array(), 0, mTiles[i].size())) != OK) {
+            ALOGE("%s: Could not write tile %zu, received %d.", __FUNCTION__, i, ret);
+            return ret;
+        }
+    }
+    return ret;
+}
+
+} /*namespace img_utils*/
+} /*namespace android*/
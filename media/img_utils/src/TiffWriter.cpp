@@ -49,10 +49,12 @@ KeyedVector<uint16_t, const TagDefinition_t*> TiffWriter::sTagMaps[] = {
     buildTagMap(TIFF_6_TAG_DEFINITIONS, ARRAY_SIZE(TIFF_6_TAG_DEFINITIONS))
 };
 
-TiffWriter::TiffWriter() : mTagMaps(sTagMaps), mNumTagMaps(DEFAULT_NUM_TAG_MAPS) {}
+TiffWriter::TiffWriter() : mTagMaps(sTagMaps), mNumTagMaps(DEFAULT_NUM_TAG_MAPS),
+        mTileWorkerCount(0) {}
 
 TiffWriter::TiffWriter(KeyedVector<uint16_t, const TagDefinition_t*>* enabledDefinitions,
-        size_t length) : mTagMaps(enabledDefinitions), mNumTagMaps(length) {}
+        size_t length) : mTagMaps(enabledDefinitions), mNumTagMaps(length),
+        mTileWorkerCount(0) {}
 
 TiffWriter::~TiffWriter() {}
 
@@ -66,6 +68,30 @@ status_t TiffWriter::write(Output* out, StripSource** sources, size_t sourcesCou
         return BAD_VALUE;
     }
 
+    // Tiles are encoded up front, since the compressed tile sizes are needed
+    // to set the tile offsets written in the header.
+    KeyedVector<uint32_t, sp<TiffTileEncoder> > tileEncoders;
+    for (size_t i = 0; i < mNamedIfds.size(); ++i) {
+        if (!mNamedIfds[i]->uninitializedOffsets() || !mNamedIfds[i]->isTiled()) {
+            continue;
+        }
+        uint32_t ifdKey = mNamedIfds.keyAt(i);
+        StripSource* source = NULL;
+        for (size_t j = 0; j < sourcesCount; ++j) {
+            if (sources[j]->getIfd() == ifdKey) {
+                source = sources[j];
+                break;
+            }
+        }
+        if (source == NULL) {
+            ALOGE("%s: No stream for tiles for IFD %u", __FUNCTION__, ifdKey);
+            return BAD_VALUE;
+        }
+        sp<TiffTileEncoder> encoder;
+        BAIL_ON_FAIL(encodeTiles(mNamedIfds[i], source, end, &encoder), ret);
+        tileEncoders.add(ifdKey, encoder);
+    }
+
     uint32_t totalSize = getTotalSize();
 
     KeyedVector<uint32_t, uint32_t> offsetVector;
@@ -106,11 +132,23 @@ status_t TiffWriter::write(Output* out, StripSource** sources, size_t sourcesCou
 
     for (size_t i = 0; i < offVecSize; ++i) {
         uint32_t ifdKey = offsetVector.keyAt(i);
-        uint32_t sizeToWrite = mNamedIfds[ifdKey]->getStripSize();
+        uint32_t sizeToWrite = mNamedIfds.valueFor(ifdKey)->getStripSize();
+
+        ssize_t encoderIndex = tileEncoders.indexOfKey(ifdKey);
+        if (encoderIndex >= 0) {
+            if ((ret = tileEncoders[encoderIndex]->writeTiles(&endOut)) != OK) {
+                ALOGE("%s: Could not write tiles, received %d.", __FUNCTION__, ret);
+                return ret;
+            }
+            ZERO_TILL_WORD(&endOut, sizeToWrite, ret);
+            assert(offsetVector[i] == endOut.getCurrentOffset());
+            continue;
+        }
+
         bool found = false;
         for (size_t j = 0; j < sourcesCount; ++j) {
             if (sources[j]->getIfd() == ifdKey) {
-                if ((ret = sources[i]->writeToStream(endOut, sizeToWrite)) != OK) {
+                if ((ret = sources[j]->writeToStream(endOut, sizeToWrite)) != OK) {
                     ALOGE("%s: Could not write to stream, received %d.", __FUNCTION__, ret);
                     return ret;
                 }
@@ -214,6 +252,66 @@ status_t TiffWriter::addStrip(uint32_t ifd) {
     return selected->validateAndSetStripTags();
 }
 
+status_t TiffWriter::addTiles(uint32_t ifd, uint32_t tileWidth, uint32_t tileLength,
+        uint16_t compression) {
+    ssize_t index = mNamedIfds.indexOfKey(ifd);
+    if (index < 0) {
+        ALOGE("%s: Ifd %u doesn't exist, cannot add tile entries.", __FUNCTION__, ifd);
+        return BAD_VALUE;
+    }
+    sp<TiffIfd> selected = mNamedIfds[index];
+    return selected->validateAndSetTileTags(tileWidth, tileLength, compression);
+}
+
+void TiffWriter::setTileWorkerCount(size_t count) {
+    mTileWorkerCount = count;
+}
+
+status_t TiffWriter::encodeTiles(const sp<TiffIfd>& ifd, StripSource* source,
+        Endianness end, /*out*/sp<TiffTileEncoder>* encoder) const {
+    status_t ret = OK;
+
+    sp<TiffEntry> widthEntry = ifd->getEntry(TAG_IMAGEWIDTH);
+    sp<TiffEntry> heightEntry = ifd->getEntry(TAG_IMAGELENGTH);
+    sp<TiffEntry> samplesEntry = ifd->getEntry(TAG_SAMPLESPERPIXEL);
+    sp<TiffEntry> bitsEntry = ifd->getEntry(TAG_BITSPERSAMPLE);
+    sp<TiffEntry> tileWidthEntry = ifd->getEntry(TAG_TILEWIDTH);
+    sp<TiffEntry> tileLengthEntry = ifd->getEntry(TAG_TILELENGTH);
+    sp<TiffEntry> compressionEntry = ifd->getEntry(TAG_COMPRESSION);
+    if (widthEntry == NULL || heightEntry == NULL || samplesEntry == NULL ||
+            bitsEntry == NULL || tileWidthEntry == NULL || tileLengthEntry == NULL ||
+            compressionEntry == NULL) {
+        ALOGE("%s: IFD %u is missing tags required for tiling.", __FUNCTION__, ifd->getId());
+        return BAD_VALUE;
+    }
+
+    uint32_t width = *(widthEntry->getData<uint32_t>());
+    uint32_t height = *(heightEntry->getData<uint32_t>());
+    uint16_t samplesPerPixel = *(samplesEntry->getData<uint16_t>());
+    uint16_t bitsPerSample = *(bitsEntry->getData<uint16_t>());
+    uint32_t tileWidth = *(tileWidthEntry->getData<uint32_t>());
+    uint32_t tileLength = *(tileLengthEntry->getData<uint32_t>());
+    uint16_t compression = *(compressionEntry->getData<uint16_t>());
+
+    sp<TiffTileEncoder> tiles = new TiffTileEncoder(width, height, samplesPerPixel,
+            bitsPerSample / 8, tileWidth, tileLength, compression, end, mTileWorkerCount);
+
+    uint32_t imageSize = width * height * samplesPerPixel * (bitsPerSample / 8);
+    if ((ret = source->writeToStream(*tiles, imageSize)) != OK) {
+        ALOGE("%s: Could not read image data for IFD %u, received %d.", __FUNCTION__,
+                ifd->getId(), ret);
+        return ret;
+    }
+    BAIL_ON_FAIL(tiles->finish(), ret);
+
+    Vector<uint32_t> byteCounts;
+    tiles->getTileByteCounts(&byteCounts);
+    BAIL_ON_FAIL(ifd->setTileByteCounts(byteCounts), ret);
+
+    *encoder = tiles;
+    return OK;
+}
+
 status_t TiffWriter::addIfd(uint32_t ifd) {
     ssize_t index = mNamedIfds.indexOfKey(ifd);
     if (index >= 0) {
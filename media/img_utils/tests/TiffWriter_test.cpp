@@ -0,0 +1,247 @@
+/*
+ * Copyright 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TiffWriter_test"
+
+#include <gtest/gtest.h>
+
+#include <img_utils/ByteArrayOutput.h>
+#include <img_utils/StripSource.h>
+#include <img_utils/TagDefinitions.h>
+#include <img_utils/TiffWriter.h>
+
+#include <utils/Vector.h>
+
+#include <string.h>
+#include <zlib.h>
+
+namespace android {
+namespace img_utils {
+
+static const uint32_t kWidth = 200;
+static const uint32_t kHeight = 75;
+
+// Synthetic 16-bit single channel image written in one pass, the way DNG
+// raw strip sources do.
+class TestStripSource : public StripSource {
+  public:
+    TestStripSource(uint32_t ifd) : mIfd(ifd) {
+        for (uint32_t y = 0; y < kHeight; ++y) {
+            for (uint32_t x = 0; x < kWidth; ++x) {
+                uint16_t v = static_cast<uint16_t>((x * 13 + y * 7 + (x ^ y)) & 0x3FF);
+                mPixels.push_back(v);
+            }
+        }
+    }
+
+    virtual status_t writeToStream(Output& stream, uint32_t count) {
+        EXPECT_EQ(kWidth * kHeight * 2, count);
+        // Write in odd-sized chunks to exercise band accumulation
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(mPixels.array());
+        size_t remaining = mPixels.size() * 2;
+        size_t offset = 0;
+        while (remaining > 0) {
+            size_t chunk = remaining < 999 ? remaining : 999;
+            status_t err = stream.write(data, offset, chunk);
+            if (err != OK) {
+                return err;
+            }
+            offset += chunk;
+            remaining -= chunk;
+        }
+        return OK;
+    }
+
+    virtual uint32_t getIfd() const {
+        return mIfd;
+    }
+
+    uint16_t pixel(uint32_t x, uint32_t y) const {
+        return mPixels[y * kWidth + x];
+    }
+
+  private:
+    uint32_t mIfd;
+    Vector<uint16_t> mPixels;
+};
+
+// Minimal little-endian TIFF reader for the tags the tile writer sets.
+class TiffReader {
+  public:
+    TiffReader(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+    uint16_t u16(size_t offset) const {
+        return mData[offset] | (mData[offset + 1] << 8);
+    }
+
+    uint32_t u32(size_t offset) const {
+        return u16(offset) | (static_cast<uint32_t>(u16(offset + 2)) << 16);
+    }
+
+    // Returns the values of a SHORT or LONG tag in IFD0.
+    Vector<uint32_t> getTag(uint16_t tag) const {
+        Vector<uint32_t> values;
+        uint32_t ifdOffset = u32(4);
+        uint16_t entries = u16(ifdOffset);
+        for (uint16_t i = 0; i < entries; ++i) {
+            size_t entry = ifdOffset + 2 + i * 12;
+            if (u16(entry) != tag) {
+                continue;
+            }
+            uint16_t type = u16(entry + 2);
+            uint32_t count = u32(entry + 4);
+            size_t typeSize = (type == SHORT) ? 2 : 4;
+            size_t valueOffset = (count * typeSize <= 4) ? entry + 8 : u32(entry + 8);
+            for (uint32_t j = 0; j < count; ++j) {
+                size_t at = valueOffset + j * typeSize;
+                values.push_back(type == SHORT ? u16(at) : u32(at));
+            }
+        }
+        return values;
+    }
+
+    const uint8_t* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+  private:
+    const uint8_t* mData;
+    size_t mSize;
+};
+
+class TiffWriterTest : public ::testing::Test {
+  protected:
+    void writeTiled(uint16_t compression, size_t workers, ByteArrayOutput* out,
+            TestStripSource* source) {
+        sp<TiffWriter> writer = new TiffWriter();
+        ASSERT_EQ(OK, writer->addIfd(IFD_0));
+
+        uint32_t width = kWidth;
+        uint32_t height = kHeight;
+        uint16_t bits = 16;
+        uint16_t samples = 1;
+        ASSERT_EQ(OK, writer->addEntry(TAG_IMAGEWIDTH, 1, &width, IFD_0));
+        ASSERT_EQ(OK, writer->addEntry(TAG_IMAGELENGTH, 1, &height, IFD_0));
+        ASSERT_EQ(OK, writer->addEntry(TAG_BITSPERSAMPLE, 1, &bits, IFD_0));
+        ASSERT_EQ(OK, writer->addEntry(TAG_SAMPLESPERPIXEL, 1, &samples, IFD_0));
+
+        ASSERT_EQ(OK, writer->addTiles(IFD_0, 64, 32, compression));
+        writer->setTileWorkerCount(workers);
+
+        StripSource* sources[] = { source };
+        ASSERT_EQ(OK, writer->write(out, sources, 1));
+    }
+
+    void verifyTiles(const ByteArrayOutput& out, const TestStripSource& source,
+            uint16_t expectedCompression) {
+        TiffReader reader(out.getArray(), out.getSize());
+        ASSERT_EQ(LITTLE_ENDIAN_MARKER, reader.u16(0));
+
+        Vector<uint32_t> compression = reader.getTag(TAG_COMPRESSION);
+        Vector<uint32_t> tileWidth = reader.getTag(TAG_TILEWIDTH);
+        Vector<uint32_t> tileLength = reader.getTag(TAG_TILELENGTH);
+        Vector<uint32_t> offsets = reader.getTag(TAG_TILEOFFSETS);
+        Vector<uint32_t> byteCounts = reader.getTag(TAG_TILEBYTECOUNTS);
+        Vector<uint32_t> predictor = reader.getTag(TAG_PREDICTOR);
+
+        ASSERT_EQ(1u, compression.size());
+        ASSERT_EQ(expectedCompression, compression[0]);
+        ASSERT_EQ(64u, tileWidth[0]);
+        ASSERT_EQ(32u, tileLength[0]);
+        ASSERT_EQ(0u, reader.getTag(TAG_STRIPOFFSETS).size());
+
+        const uint32_t tw = tileWidth[0];
+        const uint32_t tl = tileLength[0];
+        const uint32_t across = (kWidth + tw - 1) / tw;
+        const uint32_t down = (kHeight + tl - 1) / tl;
+        ASSERT_EQ(across * down, offsets.size());
+        ASSERT_EQ(offsets.size(), byteCounts.size());
+
+        Vector<uint8_t> tile;
+        tile.insertAt(0, 0, tw * tl * 2);
+        for (size_t t = 0; t < offsets.size(); ++t) {
+            ASSERT_LE(offsets[t] + byteCounts[t], reader.size());
+            const uint8_t* src = reader.data() + offsets[t];
+
+            if (expectedCompression == TAG_COMPRESSION_DEFLATE) {
+                uLongf size = tile.size();
+                ASSERT_EQ(Z_OK, uncompress(tile.editArray(), &size, src, byteCounts[t]));
+                ASSERT_EQ(tile.size(), size);
+                if (predictor[0] == TAG_PREDICTOR_HORIZONTAL) {
+                    uint8_t* p = tile.editArray();
+                    for (uint32_t row = 0; row < tl; ++row) {
+                        for (uint32_t i = 1; i < tw; ++i) {
+                            size_t cur = (row * tw + i) * 2;
+                            size_t prev = cur - 2;
+                            uint16_t v = (p[cur] | (p[cur + 1] << 8)) +
+                                    (p[prev] | (p[prev + 1] << 8));
+                            p[cur] = v & 0xFF;
+                            p[cur + 1] = v >> 8;
+                        }
+                    }
+                }
+            } else {
+                ASSERT_EQ(tile.size(), byteCounts[t]);
+                memcpy(tile.editArray(), src, byteCounts[t]);
+            }
+
+            const uint32_t x0 = (t % across) * tw;
+            const uint32_t y0 = (t / across) * tl;
+            const uint8_t* p = tile.array();
+            for (uint32_t y = 0; y < tl; ++y) {
+                for (uint32_t x = 0; x < tw; ++x) {
+                    uint16_t v = p[(y * tw + x) * 2] | (p[(y * tw + x) * 2 + 1] << 8);
+                    if (x0 + x < kWidth && y0 + y < kHeight) {
+                        ASSERT_EQ(source.pixel(x0 + x, y0 + y), v)
+                                << "tile " << t << " at " << x << "," << y;
+                    } else {
+                        ASSERT_EQ(0, v) << "padding in tile " << t;
+                    }
+                }
+            }
+        }
+    }
+};
+
+TEST_F(TiffWriterTest, UncompressedTilesRoundTrip) {
+    ByteArrayOutput out;
+    TestStripSource source(IFD_0);
+    writeTiled(TAG_COMPRESSION_NONE, 0, &out, &source);
+    verifyTiles(out, source, TAG_COMPRESSION_NONE);
+}
+
+TEST_F(TiffWriterTest, DeflateTilesRoundTrip) {
+    ByteArrayOutput out;
+    TestStripSource source(IFD_0);
+    writeTiled(TAG_COMPRESSION_DEFLATE, 0, &out, &source);
+    verifyTiles(out, source, TAG_COMPRESSION_DEFLATE);
+    EXPECT_LT(out.getSize(), kWidth * kHeight * 2);
+}
+
+TEST_F(TiffWriterTest, ParallelDeflateMatchesSingleThreaded) {
+    ByteArrayOutput serial;
+    ByteArrayOutput parallel;
+    TestStripSource source(IFD_0);
+    writeTiled(TAG_COMPRESSION_DEFLATE, 0, &serial, &source);
+    writeTiled(TAG_COMPRESSION_DEFLATE, 4, &parallel, &source);
+    verifyTiles(parallel, source, TAG_COMPRESSION_DEFLATE);
+
+    ASSERT_EQ(serial.getSize(), parallel.getSize());
+    EXPECT_EQ(0, memcmp(serial.getArray(), parallel.getArray(), serial.getSize()));
+}
+
+} /*namespace img_utils*/
+} /*namespace android*/
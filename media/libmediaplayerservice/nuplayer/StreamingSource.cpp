@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include <inttypes.h>
+#include <unistd.h>
 
 #include "StreamingSource.h"
 
@@ -26,6 +27,7 @@
 #include "AnotherPacketSource.h"
 #include "NuPlayerStreamListener.h"
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
@@ -37,6 +39,10 @@ namespace android {
 
 const int32_t kNumListenerQueuePackets = 80;
 
+static inline bool getParallelDemuxSetting() {
+    return property_get_bool("media.stagefright.ts.parallel", false /* default_value */);
+}
+
 NuPlayer::StreamingSource::StreamingSource(
         const sp<AMessage> &notify,
         const sp<IStreamSource> &source)
@@ -76,6 +82,12 @@ void NuPlayer::StreamingSource::start() {
     if (sourceFlags & IStreamSource::kFlagAlignedVideoData) {
         parserFlags |= ATSParser::ALIGNED_VIDEO_DATA;
     }
+    // Streams are fed from their own looper and SyncEvents aren't used, so
+    // PES reassembly can be moved to a worker if asked for and there is a
+    // core for it.
+    if (getParallelDemuxSetting() && sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+        parserFlags |= ATSParser::PARALLEL_DEMUX;
+    }
 
     mTSParser = new ATSParser(parserFlags);
 
@@ -2384,6 +2384,15 @@ status_t ACodec::configureCodec(
         err = setOperatingRate(rateFloat, video);
     }
 
+    int32_t maxFramesPerBuffer;
+    if (!video && !encoder
+            && msg->findInt32("max-frames-per-buffer", &maxFramesPerBuffer)
+            && maxFramesPerBuffer > 1
+            && setMultiFrameBuffers(&maxFramesPerBuffer) == OK) {
+        // tell the client it may now pack frames into its input buffers
+        inputFormat->setInt32("max-frames-per-buffer", maxFramesPerBuffer);
+    }
+
     // NOTE: both mBaseOutputFormat and mOutputFormat are outputFormat to signal first frame.
     mBaseOutputFormat = outputFormat;
     // trigger a kWhatOutputFormatChanged msg on first buffer
@@ -2463,6 +2472,37 @@ status_t ACodec::setOperatingRate(float rateFloat, bool isVideo) {
     return OK;
 }
 
+status_t ACodec::setMultiFrameBuffers(int32_t *maxFramesPerBuffer) {
+    OMX_INDEXTYPE index;
+    status_t err = mOMX->getExtensionIndex(
+            mNode, "OMX.google.android.index.multiFrameBuffers", &index);
+    if (err != OK) {
+        ALOGI("[%s] does not support multiple frames per buffer", mComponentName.c_str());
+        return err;
+    }
+
+    // In this mode each frame in an input buffer is preceded by its length
+    // as a uint32_t in host byte order, and an output buffer holds the
+    // decoded frames of up to |*maxFramesPerBuffer| of them.
+    OMX_PARAM_U32TYPE params;
+    InitOMXParams(&params);
+    params.nPortIndex = kPortIndexOutput;
+    params.nU32 = (OMX_U32)*maxFramesPerBuffer;
+    err = mOMX->setParameter(mNode, index, &params, sizeof(params));
+    if (err == OK) {
+        // the codec may allow fewer frames than asked for
+        err = mOMX->getParameter(mNode, index, &params, sizeof(params));
+    }
+    if (err != OK || params.nU32 <= 1) {
+        ALOGI("[%s] failed to set %d frames per buffer (err %d)",
+                mComponentName.c_str(), *maxFramesPerBuffer, err);
+        return err != OK ? err : INVALID_OPERATION;
+    }
+
+    *maxFramesPerBuffer = (int32_t)params.nU32;
+    return OK;
+}
+
 status_t ACodec::getIntraRefreshPeriod(uint32_t *intraRefreshPeriod) {
     OMX_VIDEO_CONFIG_ANDROID_INTRAREFRESHTYPE params;
     InitOMXParams(&params);
@@ -4444,6 +4484,14 @@ status_t ACodec::setupAVCEncoderParameters(const sp<AMessage> &msg) {
         h264type.nAllowedPictureTypes |= OMX_VIDEO_PictureTypeB;
     }
 
+    // Slices of at most this many macroblocks, e.g. for encoders that
+    // encode the slices of a picture concurrently.
+    int32_t sliceHeaderSpacing;
+    if (msg->findInt32("slice-header-spacing", &sliceHeaderSpacing)
+            && sliceHeaderSpacing > 0) {
+        h264type.nSliceHeaderSpacing = sliceHeaderSpacing;
+    }
+
     h264type.bEnableUEP = OMX_FALSE;
     h264type.bEnableFMO = OMX_FALSE;
     h264type.bEnableASO = OMX_FALSE;
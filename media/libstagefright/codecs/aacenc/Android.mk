@@ -78,6 +78,8 @@ LOCAL_CFLAGS += -Werror
 LOCAL_CLANG := true
 LOCAL_SANITIZE := signed-integer-overflow unsigned-integer-overflow
 
+# x86 builds use SSE2 (in both x86 ABIs); the MDCT needs SSE4.1 pmuldq, checked by x86_has_sse41().
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
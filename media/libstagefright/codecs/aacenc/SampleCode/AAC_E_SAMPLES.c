@@ -271,6 +271,16 @@ int main(int argc, char **argv)
 //################################################  End Encoding Section  #######################################################
 	returnCode = AudioAPI.Uninit(hCodec);
 
+	// one core can encode this many streams of the same kind in real time;
+	if(total > 0)
+	{
+		double audioSecs = (double)EncoderdFrame * 1024 / aacpara.sampleRate;
+		double cpuSecs = (double)total / CLOCKS_PER_SEC;
+
+		printf("%d frames, %.2f s of audio in %.2f s of cpu: %.1f streams per core\n",
+				EncoderdFrame, audioSecs, cpuSecs, audioSecs / cpuSecs);
+	}
+
 	fclose(infile);
 	if (outfile)
     {
@@ -0,0 +1,144 @@
+/*
+ ** Copyright (C) 2016 The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		basic_op_sse2.h
+
+	Content:	Basic operators of basic_op.h on four Word32 at once,
+				bit-exact with the scalar ones.
+
+				SSE2 has no signed 32x32->64 bit multiply. Emulating it
+				with the unsigned one costs more than the scalar MULHIGH(),
+				so MULHIGH_x4() needs the pmuldq of SSE4.1, which the 32
+				bit x86 Android ABI does not include. Its callers check
+				x86_has_sse41() and use the C code otherwise. pmuldq is
+				emitted with inline asm when the build does not enable
+				SSE4.1.
+
+*******************************************************************************/
+
+#ifndef __BASIC_OP_SSE2_H
+#define __BASIC_OP_SSE2_H
+
+#if defined(__SSE2__)
+
+#include "basic_op.h"
+
+/* typedefs.h makes __inline static, which the intrinsics headers do not expect */
+#pragma push_macro("__inline")
+#undef __inline
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#include "x86_cpu_features.h"
+#pragma pop_macro("__inline")
+
+/* MULHIGH() of each lane, SSE4.1 only: see x86_has_sse41() */
+__inline __m128i MULHIGH_x4(__m128i a, __m128i b)
+{
+	const __m128i hiMask = _mm_set_epi32(-1, 0, -1, 0);
+	__m128i even = a, odd = _mm_srli_epi64(a, 32);
+
+#if defined(__SSE4_1__)
+	even = _mm_mul_epi32(even, b);
+	odd = _mm_mul_epi32(odd, _mm_srli_epi64(b, 32));
+#else
+	__asm__("pmuldq %1, %0" : "+x"(even) : "x"(b));
+	__asm__("pmuldq %1, %0" : "+x"(odd) : "x"(_mm_srli_epi64(b, 32)));
+#endif
+
+	even = _mm_srli_epi64(even, 32);
+	odd = _mm_and_si128(odd, hiMask);
+
+	return _mm_or_si128(even, odd);
+}
+
+/* L_abs() of each lane, MIN_32 gives MAX_32 */
+__inline __m128i L_abs_x4(__m128i a)
+{
+	__m128i s = _mm_srai_epi32(a, 31);
+
+	a = _mm_sub_epi32(_mm_xor_si128(a, s), s);
+
+	return _mm_add_epi32(a, _mm_srai_epi32(a, 31));
+}
+
+/* L_mpy_ls(a, b) of each lane, b holds a Word16 that is not negative in
+   the low half of each lane and zero in the high half */
+__inline __m128i L_mpy_ls_x4(__m128i a, __m128i b)
+{
+	/* unsigned low half of a times b, then the signed high half times b */
+	__m128i lo = _mm_or_si128(_mm_mullo_epi16(a, b), _mm_slli_epi32(_mm_mulhi_epu16(a, b), 16));
+	__m128i hi = _mm_madd_epi16(a, _mm_slli_epi32(b, 16));
+
+	return _mm_add_epi32(_mm_srli_epi32(lo, 15), _mm_slli_epi32(hi, 1));
+}
+
+/* max() of each lane */
+__inline __m128i max_x4(__m128i a, __m128i b)
+{
+	__m128i m = _mm_cmpgt_epi32(a, b);
+
+	return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+/* L_add() of each lane, for lanes that are not negative */
+__inline __m128i L_add_pos_x4(__m128i a, __m128i b)
+{
+	__m128i s = _mm_add_epi32(a, b);
+	__m128i o = _mm_srai_epi32(s, 31);
+
+	return _mm_or_si128(_mm_andnot_si128(o, s), _mm_srli_epi32(o, 1));
+}
+
+/* L_add() of the four lanes, for lanes that are not negative */
+__inline Word32 L_add_pos_sum_x4(__m128i a)
+{
+	a = L_add_pos_x4(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+	a = L_add_pos_x4(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(a);
+}
+
+/* MULHIGH(a, a) of each lane, added up in the two Word64 lanes of acc */
+__inline __m128i L_sqr_acc_x4(__m128i acc, __m128i a)
+{
+	__m128i s = _mm_srai_epi32(a, 31);
+
+	/* |a| fits in 32 unsigned bits, MIN_32 included */
+	a = _mm_sub_epi32(_mm_xor_si128(a, s), s);
+
+	acc = _mm_add_epi64(acc, _mm_srli_epi64(_mm_mul_epu32(a, a), 32));
+	a = _mm_srli_epi64(a, 32);
+	acc = _mm_add_epi64(acc, _mm_srli_epi64(_mm_mul_epu32(a, a), 32));
+
+	return acc;
+}
+
+/* sum of the two Word64 lanes of L_sqr_acc_x4(), saturated to MAX_32 */
+__inline Word32 L_sqr_sum_x4(__m128i acc)
+{
+	Word64 sum[2];
+
+	_mm_storeu_si128((__m128i *)sum, acc);
+	sum[0] += sum[1];
+
+	return (sum[0] > MAX_32) ? MAX_32 : (Word32)sum[0];
+}
+
+#endif /* __SSE2__ */
+
+#endif /* __BASIC_OP_SSE2_H */
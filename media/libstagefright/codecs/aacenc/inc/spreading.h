@@ -30,4 +30,12 @@ void SpreadingMax(const Word16 pbCnt,
                   const Word16 *maskHighFactor,
                   Word32       *pbSpreadedEnergy);
 
+void SpreadingMax2(const Word16 pbCnt,
+                   const Word16 *maskLowFactor,
+                   const Word16 *maskHighFactor,
+                   Word32       *pbSpreadedEnergy,
+                   const Word16 *maskLowFactor2,
+                   const Word16 *maskHighFactor2,
+                   Word32       *pbSpreadedEnergy2);
+
 #endif /* #ifndef _SPREADING_H */
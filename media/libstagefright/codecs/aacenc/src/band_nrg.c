@@ -22,6 +22,7 @@
 
 #include "basic_op.h"
 #include "band_nrg.h"
+#include "basic_op_sse2.h"
 
 #ifndef ARMV5E
 /********************************************************************************
@@ -41,7 +42,17 @@ void CalcBandEnergy(const Word32 *mdctSpectrum,
 
   for (i=0; i<numBands; i++) {
     Word32 accu = 0;
-    for (j=bandOffset[i]; j<bandOffset[i+1]; j++)
+    j = bandOffset[i];
+#if defined(__SSE2__)
+    /* the terms are not negative, so saturating once at the end is the same */
+    {
+      __m128i acc = _mm_setzero_si128();
+      for (; j+4<=bandOffset[i+1]; j+=4)
+        acc = L_sqr_acc_x4(acc, _mm_loadu_si128((const __m128i *)&mdctSpectrum[j]));
+      accu = L_sqr_sum_x4(acc);
+    }
+#endif /* __SSE2__ */
+    for (; j<bandOffset[i+1]; j++)
       accu = L_add(accu, MULHIGH(mdctSpectrum[j], mdctSpectrum[j]));
 
 	accu = L_add(accu, accu);
@@ -75,7 +86,22 @@ void CalcBandEnergyMS(const Word32 *mdctSpectrumLeft,
   for(i=0; i<numBands; i++) {
     Word32 accuMid = 0;
     Word32 accuSide = 0;
-    for (j=bandOffset[i]; j<bandOffset[i+1]; j++) {
+    j = bandOffset[i];
+#if defined(__SSE2__)
+    {
+      __m128i accm = _mm_setzero_si128();
+      __m128i accs = _mm_setzero_si128();
+      for (; j+4<=bandOffset[i+1]; j+=4) {
+        __m128i l = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&mdctSpectrumLeft[j]), 1);
+        __m128i r = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&mdctSpectrumRight[j]), 1);
+        accm = L_sqr_acc_x4(accm, _mm_add_epi32(l, r));
+        accs = L_sqr_acc_x4(accs, _mm_sub_epi32(l, r));
+      }
+      accuMid = L_sqr_sum_x4(accm);
+      accuSide = L_sqr_sum_x4(accs);
+    }
+#endif /* __SSE2__ */
+    for (; j<bandOffset[i+1]; j++) {
       Word32 specm, specs;
       Word32 l, r;
 
@@ -554,11 +554,22 @@ static Word16 advancePsychLong(PSY_DATA* psyData,
   }
 
 
-  /* spreading energy */
-  SpreadingMax(hPsyConfLong->sfbCnt,
-               hPsyConfLong->sfbMaskLowFactor,
-               hPsyConfLong->sfbMaskHighFactor,
-               psyData->sfbThreshold.sfbLong);
+  /* spreaded energy */
+  data0 = psyData->sfbSpreadedEnergy.sfbLong;
+  data1 = psyData->sfbEnergy.sfbLong;
+  for (i=hPsyConfLong->sfbCnt; i; i--) {
+    //psyData->sfbSpreadedEnergy.sfbLong[i] = psyData->sfbEnergy.sfbLong[i];
+	  *data0++ = *data1++;
+  }
+
+  /* spreading energy, of the thresholds and of the spreaded energy */
+  SpreadingMax2(hPsyConfLong->sfbCnt,
+                hPsyConfLong->sfbMaskLowFactor,
+                hPsyConfLong->sfbMaskHighFactor,
+                psyData->sfbThreshold.sfbLong,
+                hPsyConfLong->sfbMaskLowFactorSprEn,
+                hPsyConfLong->sfbMaskHighFactorSprEn,
+                psyData->sfbSpreadedEnergy.sfbLong);
 
   /* threshold in quiet */
   data0 = psyData->sfbThreshold.sfbLong;
@@ -602,21 +613,6 @@ static Word16 advancePsychLong(PSY_DATA* psyData,
                             tnsData->dataRaw.tnsLong.subBlockInfo,
                             psyData->sfbThreshold.sfbLong);
 
-
-  /* spreaded energy */
-  data0 = psyData->sfbSpreadedEnergy.sfbLong;
-  data1 = psyData->sfbEnergy.sfbLong;
-  for (i=hPsyConfLong->sfbCnt; i; i--) {
-    //psyData->sfbSpreadedEnergy.sfbLong[i] = psyData->sfbEnergy.sfbLong[i];
-	  *data0++ = *data1++;
-  }
-
-  /* spreading energy */
-  SpreadingMax(hPsyConfLong->sfbCnt,
-               hPsyConfLong->sfbMaskLowFactorSprEn,
-               hPsyConfLong->sfbMaskHighFactorSprEn,
-               psyData->sfbSpreadedEnergy.sfbLong);
-
   return 0;
 }
 
@@ -735,11 +731,21 @@ static Word16 advancePsychShort(PSY_DATA* psyData,
 	  psyData->sfbEnergySum.sfbShort[w] = tdata;
     }
 
-    /* spreading */
-    SpreadingMax(hPsyConfShort->sfbCnt,
-                 hPsyConfShort->sfbMaskLowFactor,
-                 hPsyConfShort->sfbMaskHighFactor,
-                 psyData->sfbThreshold.sfbShort[w]);
+    /* spreaded energy */
+    data0 = psyData->sfbSpreadedEnergy.sfbShort[w];
+	data1 = psyData->sfbEnergy.sfbShort[w];
+	for (i=hPsyConfShort->sfbCnt; i; i--) {
+	  *data0++ = *data1++;
+    }
+
+    /* spreading, of the thresholds and of the spreaded energy */
+    SpreadingMax2(hPsyConfShort->sfbCnt,
+                  hPsyConfShort->sfbMaskLowFactor,
+                  hPsyConfShort->sfbMaskHighFactor,
+                  psyData->sfbThreshold.sfbShort[w],
+                  hPsyConfShort->sfbMaskLowFactorSprEn,
+                  hPsyConfShort->sfbMaskHighFactorSprEn,
+                  psyData->sfbSpreadedEnergy.sfbShort[w]);
 
 
     /* threshold in quiet */
@@ -768,17 +774,6 @@ static Word16 advancePsychShort(PSY_DATA* psyData,
                                tnsData->dataRaw.tnsShort.subBlockInfo[w],
                                psyData->sfbThreshold.sfbShort[w]);
 
-    /* spreaded energy */
-    data0 = psyData->sfbSpreadedEnergy.sfbShort[w];
-	data1 = psyData->sfbEnergy.sfbShort[w];
-	for (i=hPsyConfShort->sfbCnt; i; i--) {
-	  *data0++ = *data1++;
-    }
-    SpreadingMax(hPsyConfShort->sfbCnt,
-                 hPsyConfShort->sfbMaskLowFactorSprEn,
-                 hPsyConfShort->sfbMaskHighFactorSprEn,
-                 psyData->sfbSpreadedEnergy.sfbShort[w]);
-
     wOffset += FRAME_LEN_SHORT;
   } /* for TRANS_FAC */
 
@@ -25,6 +25,7 @@
 #include "oper_32b.h"
 #include "quantize.h"
 #include "aac_rom.h"
+#include "basic_op_sse2.h"
 
 #define MANT_DIGITS 9
 #define MANT_SIZE   (1<<MANT_DIGITS)
@@ -119,7 +120,42 @@ static void quantizeLines(const Word16 gain,
 
   if(g >= 0)
   {
-	for (line=0; line<noOfLines; line++) {
+	line = 0;
+#if defined(__SSE2__)
+	{
+	  const __m128i quat0 = _mm_set1_epi32(pquat[0]);
+	  const __m128i quat1 = _mm_set1_epi32(pquat[1] - 1);
+	  const __m128i quat2 = _mm_set1_epi32(pquat[2] - 1);
+	  const __m128i quat3 = _mm_set1_epi32(pquat[3] - 1);
+	  const __m128i shift = _mm_cvtsi32_si128(g);
+
+	  for (; line+4<=noOfLines; line+=4) {
+		__m128i spec = _mm_loadu_si128((const __m128i *)&mdctSpectrum[line]);
+		__m128i sign = _mm_srai_epi32(spec, 31);
+		__m128i saShft = _mm_srl_epi32(L_abs_x4(spec), shift);
+		__m128i qua;
+		Word32 k, big;
+
+		/* 1, 2 or 3 from the borders, lines past the last border go alone */
+		qua = _mm_sub_epi32(_mm_setzero_si128(), _mm_cmpgt_epi32(saShft, quat0));
+		qua = _mm_sub_epi32(qua, _mm_cmpgt_epi32(saShft, quat1));
+		qua = _mm_sub_epi32(qua, _mm_cmpgt_epi32(saShft, quat2));
+		qua = _mm_sub_epi32(_mm_xor_si128(qua, sign), sign);
+		_mm_storel_epi64((__m128i *)&quaSpectrum[line], _mm_packs_epi32(qua, qua));
+
+		big = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(saShft, quat3)));
+		for (k = 0; big; k++, big >>= 1) {
+		  if (big & 1) {
+			mdctSpeL = mdctSpectrum[line+k];
+			quaSpectrum[line+k] = quantizeSingleLine(gain, L_abs(mdctSpeL));
+			if (mdctSpeL < 0)
+			  quaSpectrum[line+k] = -quaSpectrum[line+k];
+		  }
+		}
+	  }
+	}
+#endif /* __SSE2__ */
+	for (; line<noOfLines; line++) {
 	  Word32 qua;
 	  qua = 0;
 
@@ -344,7 +380,58 @@ Word32 calcSfbDist(const Word32 *spec,
   if(g2 < 0 && g >= 0)
   {
 	  g2 = -g2;
-	  for(line=0; line<sfbWidth; line++) {
+	  line = 0;
+#if defined(__SSE2__)
+	  {
+		  const __m128i quat0 = _mm_set1_epi32(pquat[0]);
+		  const __m128i quat1 = _mm_set1_epi32(pquat[1]);
+		  const __m128i quat2 = _mm_set1_epi32(pquat[2]);
+		  const __m128i quat3 = _mm_set1_epi32(pquat[3]);
+		  const __m128i recon0 = _mm_set1_epi32(repquat[0]);
+		  const __m128i recon1 = _mm_set1_epi32(repquat[1]);
+		  const __m128i recon2 = _mm_set1_epi32(repquat[2]);
+		  const __m128i low16 = _mm_set1_epi32(0xffff);
+		  const __m128i shift = _mm_cvtsi32_si128(g);
+		  const __m128i shift2 = _mm_cvtsi32_si128(g2);
+		  __m128i distSum = _mm_setzero_si128();
+
+		  for(; line+4<=sfbWidth; line+=4) {
+			  __m128i saShft = _mm_srl_epi32(L_abs_x4(_mm_loadu_si128((const __m128i *)&spec[line])), shift);
+			  __m128i lt0 = _mm_cmplt_epi32(saShft, quat0);
+			  __m128i lt1 = _mm_cmplt_epi32(saShft, quat1);
+			  __m128i lt2 = _mm_cmplt_epi32(saShft, quat2);
+			  __m128i lt3 = _mm_cmplt_epi32(saShft, quat3);
+			  __m128i diff;
+			  Word32 k, big;
+
+			  /* reconstruction value of the border interval, 0 below the first one */
+			  diff = _mm_and_si128(_mm_andnot_si128(lt0, lt1), recon0);
+			  diff = _mm_or_si128(diff, _mm_and_si128(_mm_andnot_si128(lt1, lt2), recon1));
+			  diff = _mm_or_si128(diff, _mm_and_si128(_mm_andnot_si128(lt2, lt3), recon2));
+
+			  /* below the last border the difference fits in 16 bits */
+			  diff = _mm_and_si128(_mm_sub_epi32(saShft, diff), low16);
+			  diff = _mm_srl_epi32(_mm_madd_epi16(diff, diff), shift2);
+			  distSum = L_add_pos_x4(distSum, _mm_and_si128(diff, lt3));
+
+			  big = _mm_movemask_ps(_mm_castsi128_ps(lt3)) ^ 0xf;
+			  for (k = 0; big; k++, big >>= 1) {
+				  if (big & 1) {
+					  Word32 sa = L_abs(spec[line+k]);
+					  Word16 qua = quantizeSingleLine(gain, sa);
+					  Word32 iqval, diff32;
+					  iquantizeLines(gain, 1, &qua, &iqval);
+					  diff32 = sa - iqval;
+					  dist = L_add(dist, fixmul(diff32, diff32));
+				  }
+			  }
+		  }
+
+		  /* none of the terms is negative, so the order of the sums does not matter */
+		  dist = L_add(dist, L_add_pos_sum_x4(distSum));
+	  }
+#endif /* __SSE2__ */
+	  for(; line<sfbWidth; line++) {
 		  if (spec[line]) {
 			  Word32 diff;
 			  Word32 distSingle;
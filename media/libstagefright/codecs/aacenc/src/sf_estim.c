@@ -26,6 +26,7 @@
 #include "quantize.h"
 #include "bit_cnt.h"
 #include "aac_rom.h"
+#include "basic_op_sse2.h"
 
 static const Word16 MAX_SCF_DELTA = 60;
 
@@ -724,7 +725,21 @@ EstimateScaleFactorsChannel(PSY_OUT_CHANNEL *psyOutChan,
 
 		maxSpec = 0;
 		/* maximum of spectrum */
-		for (j=sbfwith; j; j-- ) {
+		j = sbfwith;
+#if defined(__SSE2__)
+		{
+			__m128i acc = _mm_setzero_si128();
+
+			for (; j>=4; j-=4) {
+				acc = _mm_or_si128(acc, L_abs_x4(_mm_loadu_si128((const __m128i *)mdctSpec)));
+				mdctSpec += 4;
+			}
+			acc = _mm_or_si128(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+			acc = _mm_or_si128(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+			maxSpec = _mm_cvtsi128_si32(acc);
+		}
+#endif /* __SSE2__ */
+		for (; j; j-- ) {
 			Word32 absSpec = L_abs(*mdctSpec); mdctSpec++;
 			maxSpec |= absSpec;
 		}
@@ -23,6 +23,7 @@
 #include "basic_op.h"
 #include "oper_32b.h"
 #include "spreading.h"
+#include "basic_op_sse2.h"
 
 /*********************************************************************************
 *
@@ -50,3 +51,67 @@ void SpreadingMax(const Word16 pbCnt,
                                 L_mpy_ls(pbSpreadedEnergy[i+1], maskLowFactor[i]));
   }
 }
+
+/*********************************************************************************
+*
+* function name: SpreadingMax2
+* description:  SpreadingMax() of two sets of bands with the same count, the
+*				two recurrences run side by side
+*
+**********************************************************************************/
+void SpreadingMax2(const Word16 pbCnt,
+                   const Word16 *maskLowFactor,
+                   const Word16 *maskHighFactor,
+                   Word32       *pbSpreadedEnergy,
+                   const Word16 *maskLowFactor2,
+                   const Word16 *maskHighFactor2,
+                   Word32       *pbSpreadedEnergy2)
+{
+  Word32 i;
+#if defined(__SSE2__)
+  /* lane 0 is the first set, lane 1 the second, the factors are not negative */
+  __m128i energy, factor;
+
+  if (pbCnt <= 0)
+    return;
+
+  energy = _mm_unpacklo_epi32(_mm_cvtsi32_si128(pbSpreadedEnergy[0]),
+                              _mm_cvtsi32_si128(pbSpreadedEnergy2[0]));
+
+  /* slope to higher frequencies */
+  for (i=1; i<pbCnt; i++) {
+    factor = _mm_unpacklo_epi32(_mm_cvtsi32_si128((UWord16)maskHighFactor[i]),
+                                _mm_cvtsi32_si128((UWord16)maskHighFactor2[i]));
+    energy = max_x4(_mm_unpacklo_epi32(_mm_cvtsi32_si128(pbSpreadedEnergy[i]),
+                                       _mm_cvtsi32_si128(pbSpreadedEnergy2[i])),
+                    L_mpy_ls_x4(energy, factor));
+    pbSpreadedEnergy[i] = _mm_cvtsi128_si32(energy);
+    pbSpreadedEnergy2[i] = _mm_cvtsi128_si32(_mm_srli_si128(energy, 4));
+  }
+  /* slope to lower frequencies */
+  for (i=pbCnt - 2; i>=0; i--) {
+    factor = _mm_unpacklo_epi32(_mm_cvtsi32_si128((UWord16)maskLowFactor[i]),
+                                _mm_cvtsi32_si128((UWord16)maskLowFactor2[i]));
+    energy = max_x4(_mm_unpacklo_epi32(_mm_cvtsi32_si128(pbSpreadedEnergy[i]),
+                                       _mm_cvtsi32_si128(pbSpreadedEnergy2[i])),
+                    L_mpy_ls_x4(energy, factor));
+    pbSpreadedEnergy[i] = _mm_cvtsi128_si32(energy);
+    pbSpreadedEnergy2[i] = _mm_cvtsi128_si32(_mm_srli_si128(energy, 4));
+  }
+#else /* __SSE2__ */
+  /* slope to higher frequencies */
+  for (i=1; i<pbCnt; i++) {
+    pbSpreadedEnergy[i] = max(pbSpreadedEnergy[i],
+                                L_mpy_ls(pbSpreadedEnergy[i-1], maskHighFactor[i]));
+    pbSpreadedEnergy2[i] = max(pbSpreadedEnergy2[i],
+                                L_mpy_ls(pbSpreadedEnergy2[i-1], maskHighFactor2[i]));
+  }
+  /* slope to lower frequencies */
+  for (i=pbCnt - 2; i>=0; i--) {
+    pbSpreadedEnergy[i] = max(pbSpreadedEnergy[i],
+                                L_mpy_ls(pbSpreadedEnergy[i+1], maskLowFactor[i]));
+    pbSpreadedEnergy2[i] = max(pbSpreadedEnergy2[i],
+                                L_mpy_ls(pbSpreadedEnergy2[i+1], maskLowFactor2[i]));
+  }
+#endif /* __SSE2__ */
+}
@@ -24,6 +24,7 @@
 #include "psy_const.h"
 #include "transform.h"
 #include "aac_rom.h"
+#include "basic_op_sse2.h"
 
 
 #define LS_TRANS ((FRAME_LEN_LONG-FRAME_LEN_SHORT)/2) /* 448 */
@@ -185,6 +186,116 @@ static void Radix8First(int *buf, int num)
 * description:  Radix 4 point fft core function
 *
 **********************************************************************************/
+#if defined(__SSE2__)
+
+/* splits four interleaved complex values into their real and imaginary parts */
+__inline void deinterleave_x4(const int *p, __m128i *re, __m128i *im)
+{
+	__m128 lo = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)p));
+	__m128 hi = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p + 4)));
+
+	*re = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+	*im = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+__inline void interleave_x4(int *p, __m128i re, __m128i im)
+{
+	_mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi32(re, im));
+	_mm_storeu_si128((__m128i *)(p + 4), _mm_unpackhi_epi32(re, im));
+}
+
+/* the cos/sin pairs of four butterflies, given as two vectors of two pairs */
+__inline void twiddle_x4(__m128d p01, __m128d p23, __m128i *cosx, __m128i *sinx)
+{
+	__m128 lo = _mm_castpd_ps(p01);
+	__m128 hi = _mm_castpd_ps(p23);
+
+	*cosx = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+	*sinx = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+/*****************************************************************************
+*
+* function name: Radix4FFT
+* description:  Radix 4 point fft core function, four butterflies at a time,
+*				SSE4.1 (bgn is 4 or 8 at the first pass, so a multiple of 4)
+*
+**********************************************************************************/
+static void Radix4FFT_x4(int *buf, int num, int bgn, int *twidTab)
+{
+	__m128i r0, r1, r2, r3;
+	__m128i r4, r5, r6, r7;
+	__m128i t0, t1;
+	__m128i cos1, sin1, cos2, sin2, cos3, sin3;
+	__m128d c0, c1, c2, c3, c4, c5;
+	int i, j, step;
+	int *xptr, *csptr;
+
+	for (num >>= 2; num != 0; num >>= 2)
+	{
+		step = 2*bgn;
+		xptr = buf;
+
+		for (i = num; i != 0; i--)
+		{
+			csptr = twidTab;
+
+			for (j = bgn; j != 0; j -= 4)
+			{
+				/* cos1 sin1 cos2 sin2 cos3 sin3 of four butterflies */
+				c0 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)(csptr + 0)));
+				c1 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)(csptr + 4)));
+				c2 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)(csptr + 8)));
+				c3 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)(csptr + 12)));
+				c4 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)(csptr + 16)));
+				c5 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)(csptr + 20)));
+				twiddle_x4(_mm_shuffle_pd(c0, c1, 2), _mm_shuffle_pd(c3, c4, 2), &cos1, &sin1);
+				twiddle_x4(_mm_shuffle_pd(c0, c2, 1), _mm_shuffle_pd(c3, c5, 1), &cos2, &sin2);
+				twiddle_x4(_mm_shuffle_pd(c1, c2, 2), _mm_shuffle_pd(c4, c5, 2), &cos3, &sin3);
+				csptr += 24;
+
+				deinterleave_x4(xptr, &r0, &r1);
+				deinterleave_x4(xptr + step, &t0, &t1);
+				r2 = _mm_add_epi32(MULHIGH_x4(cos1, t0), MULHIGH_x4(sin1, t1));
+				r3 = _mm_sub_epi32(MULHIGH_x4(cos1, t1), MULHIGH_x4(sin1, t0));
+
+				t0 = _mm_srai_epi32(r0, 2);
+				t1 = _mm_srai_epi32(r1, 2);
+				r0 = _mm_sub_epi32(t0, r2);
+				r1 = _mm_sub_epi32(t1, r3);
+				r2 = _mm_add_epi32(t0, r2);
+				r3 = _mm_add_epi32(t1, r3);
+
+				deinterleave_x4(xptr + 2*step, &t0, &t1);
+				r4 = _mm_add_epi32(MULHIGH_x4(cos2, t0), MULHIGH_x4(sin2, t1));
+				r5 = _mm_sub_epi32(MULHIGH_x4(cos2, t1), MULHIGH_x4(sin2, t0));
+
+				deinterleave_x4(xptr + 3*step, &t0, &t1);
+				r6 = _mm_add_epi32(MULHIGH_x4(cos3, t0), MULHIGH_x4(sin3, t1));
+				r7 = _mm_sub_epi32(MULHIGH_x4(cos3, t1), MULHIGH_x4(sin3, t0));
+
+				t0 = r4;
+				t1 = r5;
+				r4 = _mm_add_epi32(t0, r6);
+				r5 = _mm_sub_epi32(r7, t1);
+				r6 = _mm_sub_epi32(t0, r6);
+				r7 = _mm_add_epi32(r7, t1);
+
+				interleave_x4(xptr + 3*step, _mm_add_epi32(r0, r5), _mm_add_epi32(r1, r6));
+				interleave_x4(xptr + 2*step, _mm_sub_epi32(r2, r4), _mm_sub_epi32(r3, r7));
+				interleave_x4(xptr + step, _mm_sub_epi32(r0, r5), _mm_sub_epi32(r1, r6));
+				interleave_x4(xptr, _mm_add_epi32(r2, r4), _mm_add_epi32(r3, r7));
+				xptr += 8;
+			}
+			xptr += 3*step;
+		}
+		twidTab += 3*step;
+		bgn <<= 2;
+	}
+}
+
+#endif /* __SSE2__ */
+
 static void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
 {
 	int r0, r1, r2, r3;
@@ -194,6 +305,14 @@ static void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
 	int i, j, step;
 	int *xptr, *csptr;
 
+#if defined(__SSE2__)
+	if (x86_has_sse41())
+	{
+		Radix4FFT_x4(buf, num, bgn, twidTab);
+		return;
+	}
+#endif
+
 	for (num >>= 2; num != 0; num >>= 2)
 	{
 		step = 2*bgn;
@@ -270,6 +389,118 @@ static void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
 	}
 }
 
+#if defined(__SSE2__)
+
+/* the cosa sina cosb sinb quadruples of four iterations, transposed */
+__inline void mdct_twiddle_x4(const int *csptr,
+							  __m128i *cosa, __m128i *sina, __m128i *cosb, __m128i *sinb)
+{
+	__m128i c0 = _mm_loadu_si128((const __m128i *)(csptr + 0));
+	__m128i c1 = _mm_loadu_si128((const __m128i *)(csptr + 4));
+	__m128i c2 = _mm_loadu_si128((const __m128i *)(csptr + 8));
+	__m128i c3 = _mm_loadu_si128((const __m128i *)(csptr + 12));
+	__m128i t0 = _mm_unpacklo_epi32(c0, c1);
+	__m128i t1 = _mm_unpacklo_epi32(c2, c3);
+	__m128i t2 = _mm_unpackhi_epi32(c0, c1);
+	__m128i t3 = _mm_unpackhi_epi32(c2, c3);
+
+	*cosa = _mm_unpacklo_epi64(t0, t1);
+	*sina = _mm_unpackhi_epi64(t0, t1);
+	*cosb = _mm_unpacklo_epi64(t2, t3);
+	*sinb = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* p[-1] (lo) and p[0] (hi) of four iterations, p moving down by 2 each time */
+__inline void load_down_x4(const int *p, __m128i *lo, __m128i *hi)
+{
+	__m128 y0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p - 7)));
+	__m128 y1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p - 3)));
+
+	*lo = _mm_castps_si128(_mm_shuffle_ps(y1, y0, _MM_SHUFFLE(0, 2, 0, 2)));
+	*hi = _mm_castps_si128(_mm_shuffle_ps(y1, y0, _MM_SHUFFLE(1, 3, 1, 3)));
+}
+
+__inline void store_down_x4(int *p, __m128i lo, __m128i hi)
+{
+	__m128i y1 = _mm_unpacklo_epi32(lo, hi);
+	__m128i y0 = _mm_unpackhi_epi32(lo, hi);
+
+	_mm_storeu_si128((__m128i *)(p - 3), _mm_shuffle_epi32(y1, _MM_SHUFFLE(1, 0, 3, 2)));
+	_mm_storeu_si128((__m128i *)(p - 7), _mm_shuffle_epi32(y0, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+/*********************************************************************************
+*
+* function name: PreMDCT
+* description:  prepare MDCT process for next FFT compute, four iterations at a
+*				time, SSE4.1
+*
+**********************************************************************************/
+static void PreMDCT_x4(int *buf0, int num, const int *csptr)
+{
+	int i;
+	__m128i tr1, ti1, tr2, ti2;
+	__m128i cosa, sina, cosb, sinb;
+	int *buf1;
+
+	buf1 = buf0 + num - 1;
+
+	for(i = num >> 4; i != 0; i--)
+	{
+		mdct_twiddle_x4(csptr, &cosa, &sina, &cosb, &sinb);
+		csptr += 16;
+
+		deinterleave_x4(buf0, &tr1, &ti2);
+		load_down_x4(buf1, &tr2, &ti1);
+
+		interleave_x4(buf0,
+			_mm_add_epi32(MULHIGH_x4(cosa, tr1), MULHIGH_x4(sina, ti1)),
+			_mm_sub_epi32(MULHIGH_x4(cosa, ti1), MULHIGH_x4(sina, tr1)));
+		store_down_x4(buf1,
+			_mm_add_epi32(MULHIGH_x4(cosb, tr2), MULHIGH_x4(sinb, ti2)),
+			_mm_sub_epi32(MULHIGH_x4(cosb, ti2), MULHIGH_x4(sinb, tr2)));
+		buf0 += 8;
+		buf1 -= 8;
+	}
+}
+
+/*********************************************************************************
+*
+* function name: PostMDCT
+* description:   post MDCT process after next FFT for MDCT, four iterations at a
+*				time, SSE4.1
+*
+**********************************************************************************/
+static void PostMDCT_x4(int *buf0, int num, const int *csptr)
+{
+	int i;
+	__m128i tr1, ti1, tr2, ti2;
+	__m128i cosa, sina, cosb, sinb;
+	int *buf1;
+
+	buf1 = buf0 + num - 1;
+
+	for(i = num >> 4; i != 0; i--)
+	{
+		mdct_twiddle_x4(csptr, &cosa, &sina, &cosb, &sinb);
+		csptr += 16;
+
+		deinterleave_x4(buf0, &tr1, &ti1);
+		load_down_x4(buf1, &tr2, &ti2);
+
+		interleave_x4(buf0,
+			_mm_add_epi32(MULHIGH_x4(cosa, tr1), MULHIGH_x4(sina, ti1)),
+			_mm_sub_epi32(MULHIGH_x4(sinb, tr2), MULHIGH_x4(cosb, ti2)));
+		store_down_x4(buf1,
+			_mm_add_epi32(MULHIGH_x4(cosb, tr2), MULHIGH_x4(sinb, ti2)),
+			_mm_sub_epi32(MULHIGH_x4(sina, tr1), MULHIGH_x4(cosa, ti1)));
+		buf0 += 8;
+		buf1 -= 8;
+	}
+}
+
+#endif /* __SSE2__ */
+
 /*********************************************************************************
 *
 * function name: PreMDCT
@@ -283,6 +514,14 @@ static void PreMDCT(int *buf0, int num, const int *csptr)
 	int cosa, sina, cosb, sinb;
 	int *buf1;
 
+#if defined(__SSE2__)
+	if (x86_has_sse41())
+	{
+		PreMDCT_x4(buf0, num, csptr);
+		return;
+	}
+#endif
+
 	buf1 = buf0 + num - 1;
 
 	for(i = num >> 2; i != 0; i--)
@@ -318,6 +557,14 @@ static void PostMDCT(int *buf0, int num, const int *csptr)
 	int cosa, sina, cosb, sinb;
 	int *buf1;
 
+#if defined(__SSE2__)
+	if (x86_has_sse41())
+	{
+		PostMDCT_x4(buf0, num, csptr);
+		return;
+	}
+#endif
+
 	buf1 = buf0 + num - 1;
 
 	for(i = num >> 2; i != 0; i--)
@@ -339,6 +586,7 @@ static void PostMDCT(int *buf0, int num, const int *csptr)
 		*buf1-- = MULHIGH(cosb, tr2) + MULHIGH(sinb, ti2);
 	}
 }
+
 #else
 void Radix4First(int *buf, int num);
 void Radix8First(int *buf, int num);
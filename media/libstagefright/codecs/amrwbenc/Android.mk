@@ -105,6 +105,8 @@ LOCAL_CFLAGS += -Werror
 LOCAL_CLANG := true
 #LOCAL_SANITIZE := signed-integer-overflow
 
+# x86 builds use the SSE2 filter and correlation kernels: both x86 ABIs have SSE2.
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
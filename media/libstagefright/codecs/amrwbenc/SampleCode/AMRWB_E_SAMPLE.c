@@ -246,6 +246,10 @@ safe_exit:
 	returnCode = AudioAPI.Uninit(hCodec);
 
 	printf( "\n%2.5f seconds\n", (double)duration/CLOCKS_PER_SEC);
+	/* every frame is 20 ms of audio, so this is how many real-time channels one core encodes */
+	if (duration > 0)
+		printf("%d frames, %.2f s of audio: %.1f channels per core\n", framenum, framenum * 0.02,
+				framenum * 0.02 / ((double)duration/CLOCKS_PER_SEC));
 
 	if (fsrc)
 		fclose(fsrc);
@@ -0,0 +1,99 @@
+/*
+ ** Copyright (C) 2016 The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+
+/*--------------------------------------------------------------------------*
+ *                         BASIC_OP_SSE2.H                                  *
+ *--------------------------------------------------------------------------*
+ *       Helpers for the SSE2 filter and correlation kernels                *
+ *--------------------------------------------------------------------------*/
+
+#ifndef __BASIC_OP_SSE2_H__
+#define __BASIC_OP_SSE2_H__
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include <emmintrin.h>
+#include "typedef.h"
+#include "basic_op.h"
+
+/* [sum(a), sum(b), sum(c), sum(d)] of the 32 bit lanes, modulo 2^32 */
+static_vo __m128i vo_sum4_x4(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    __m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+    __m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+/* sum(x[i] * y[i]), i = 0..8*n8-1, in four 32 bit lanes, modulo 2^32 */
+static_vo __m128i vo_dot_x8(const Word16 *x, const Word16 *y, Word32 n8)
+{
+    __m128i acc = _mm_setzero_si128();
+
+    for (; n8 > 0; n8--)
+    {
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)x),
+                                                _mm_loadu_si128((const __m128i *)y)));
+        x += 8;
+        y += 8;
+    }
+    return acc;
+}
+
+/* sum(x[i] * x[i]), i = 0..8*n8-1, exact */
+static_vo int64_t vo_energy_x8(const Word16 *x, Word32 n8)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    int64_t sum[2];
+
+    for (; n8 > 0; n8--)
+    {
+        /* a pair of squares is at most 2^31, so it is taken as unsigned */
+        __m128i v = _mm_loadu_si128((const __m128i *)x);
+        v = _mm_madd_epi16(v, v);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+        x += 8;
+    }
+    _mm_storeu_si128((__m128i *)sum, acc);
+    return sum[0] + sum[1];
+}
+
+/*
+ * By Cauchy-Schwarz, no partial sum of products of two vectors with the
+ * energies e1 and e2 is larger than sqrt(e1 * e2). When that is at most
+ * L_max the saturating L_add() chains of the reference code never saturate,
+ * so the sums can be taken in any order, four lanes at a time.
+ */
+static_vo Flag vo_sum_fits(int64_t e1, int64_t e2, Word32 L_max)
+{
+    return (e1 == 0) || (e2 <= (int64_t)L_max * L_max / e1);
+}
+
+/* extract_h(L_add(L_shl2(L_var1, n), 0x8000)) of each lane, 0 < n < 15, once saturated by _mm_packs_epi32() */
+static_vo __m128i vo_round_shl_x4(__m128i L_var1, Word16 n)
+{
+    L_var1 = _mm_srai_epi32(L_var1, 15 - n);
+    L_var1 = _mm_add_epi32(L_var1, _mm_set1_epi32(1));
+    return _mm_srai_epi32(L_var1, 1);
+}
+
+#endif /* __SSE2__ */
+
+#endif /* __BASIC_OP_SSE2_H__ */
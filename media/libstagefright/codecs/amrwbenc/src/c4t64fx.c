@@ -44,6 +44,7 @@
 #include "math_op.h"
 #include "acelp.h"
 #include "cnst.h"
+#include "basic_op_sse2.h"
 
 #include "q_pulse.h"
 
@@ -826,6 +827,36 @@ void ACELP_4t64_fx(
 }
 
 
+#if defined(__SSE2__)
+/*-------------------------------------------------------------------*
+ * corr[i] = voround(L_shl(sum(h[k] * vz[pos + k]), 2)) for the 16   *
+ * positions pos = start + 4 * i, k = 0..63-pos. vz[] is vec[] padded *
+ * with zeros to 72 samples and the sums must not saturate.          *
+ *-------------------------------------------------------------------*/
+static void cor_h_vec_sse2(
+        Word16 h[],
+        Word16 vz[],
+        Word32 start,
+        Word16 corr[]
+        )
+{
+    Word32 i, pos;
+    __m128i s0, s1, s2, s3;
+
+    for (i = 0, pos = start; i < NB_POS; i += 4, pos += 4 * STEP)
+    {
+        s0 = vo_dot_x8(h, &vz[pos], (71 - pos) >> 3);
+        s1 = vo_dot_x8(h, &vz[pos + STEP], (71 - pos - STEP) >> 3);
+        s2 = vo_dot_x8(h, &vz[pos + 2 * STEP], (71 - pos - 2 * STEP) >> 3);
+        s3 = vo_dot_x8(h, &vz[pos + 3 * STEP], (71 - pos - 3 * STEP) >> 3);
+        s0 = vo_round_shl_x4(vo_sum4_x4(s0, s1, s2, s3), 2);
+        _mm_storel_epi64((__m128i *)&corr[i], _mm_packs_epi32(s0, s0));
+    }
+    return;
+}
+
+#endif /* __SSE2__ */
+
 /*-------------------------------------------------------------------*
  * Function  cor_h_vec()                                             *
  * ~~~~~~~~~~~~~~~~~~~~~                                             *
@@ -850,6 +881,28 @@ void cor_h_vec_30(
     p3 = rrixix[0];
     pos = track;
 
+#if defined(__SSE2__)
+    if (vo_sum_fits(vo_energy_x8(h, 8), vo_energy_x8(vec, 8), MAX_32))
+    {
+        Word16 vz[L_SUBFR + 8], corr1[NB_POS], corr2[NB_POS];
+
+        for (i = 0; i < L_SUBFR; i++)
+            vz[i] = vec[i];
+        for (; i < L_SUBFR + 8; i++)
+            vz[i] = 0;
+
+        cor_h_vec_sse2(h, vz, pos, corr1);
+        cor_h_vec_sse2(h, vz, pos - 3, corr2);
+        for (i = 0; i < NB_POS; i++)
+        {
+            *cor_x++ = mult(corr1[i], sign[pos]) + (*p0++);
+            *cor_y++ = mult(corr2[i], sign[pos-3]) + (*p3++);
+            pos += STEP;
+        }
+        return;
+    }
+#endif /* __SSE2__ */
+
     for (i = 0; i < NB_POS; i+=2)
     {
         L_sum1 = L_sum2 = 0L;
@@ -922,6 +975,28 @@ void cor_h_vec_012(
     p3 = rrixix[track+1];
     pos = track;
 
+#if defined(__SSE2__)
+    if (vo_sum_fits(vo_energy_x8(h, 8), vo_energy_x8(vec, 8), MAX_32))
+    {
+        Word16 vz[L_SUBFR + 8], corr1[NB_POS], corr2[NB_POS];
+
+        for (i = 0; i < L_SUBFR; i++)
+            vz[i] = vec[i];
+        for (; i < L_SUBFR + 8; i++)
+            vz[i] = 0;
+
+        cor_h_vec_sse2(h, vz, pos, corr1);
+        cor_h_vec_sse2(h, vz, pos + 1, corr2);
+        for (i = 0; i < NB_POS; i++)
+        {
+            cor_x[i] = vo_mult(corr1[i], sign[pos]) + (*p0++);
+            cor_y[i] = vo_mult(corr2[i], sign[pos + 1]) + (*p3++);
+            pos += STEP;
+        }
+        return;
+    }
+#endif /* __SSE2__ */
+
     for (i = 0; i < NB_POS; i+=2)
     {
         L_sum1 = L_sum2 = 0L;
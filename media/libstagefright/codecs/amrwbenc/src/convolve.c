@@ -24,6 +24,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 #define UNUSED(x) (void)(x)
 
@@ -39,6 +40,32 @@ void Convolve (
     Word32 s;
         UNUSED(L);
 
+#if defined(__SSE2__)
+    if (vo_sum_fits(vo_energy_x8(x, 8), vo_energy_x8(h, 8), MAX_32))
+    {
+        /* h[] reversed and padded with zeros: y[n] = sum(x[i] * hr[63 - n + i]), i = 0..63 */
+        Word16 hr[128];
+        __m128i s0, s1, s2, s3;
+
+        for (i = 0; i < 64; i++)
+        {
+            hr[i] = h[63 - i];
+            hr[64 + i] = 0;
+        }
+        for (n = 0; n < 64; n += 4)
+        {
+            i = (n >> 3) + 1;
+            s0 = vo_dot_x8(x, &hr[63 - n], i);
+            s1 = vo_dot_x8(x, &hr[62 - n], i);
+            s2 = vo_dot_x8(x, &hr[61 - n], i);
+            s3 = vo_dot_x8(x, &hr[60 - n], i);
+            s0 = vo_round_shl_x4(vo_sum4_x4(s0, s1, s2, s3), 1);
+            _mm_storel_epi64((__m128i *)&y[n], _mm_packs_epi32(s0, s0));
+        }
+        return;
+    }
+#endif /* __SSE2__ */
+
     for (n = 0; n < 64;)
     {
         tmpH = h+n;
@@ -27,6 +27,7 @@
 #include "typedef.h"
 #include "basic_op.h"
 #include "math_op.h"
+#include "basic_op_sse2.h"
 
 #define L_SUBFR   64
 #define NB_TRACK  4
@@ -49,6 +50,47 @@ void cor_h_x(
     L_max1 = 0;
     L_max2 = 0;
     L_max3 = 0;
+#if defined(__SSE2__)
+    if (vo_sum_fits(vo_energy_x8(x, 8), vo_energy_x8(h, 8), 0x3fffffff))
+    {
+        /* y32[] cannot saturate, x[] is padded with zeros to whole vectors */
+        Word16 xz[L_SUBFR + 8];
+        __m128i s0, s1, s2, s3;
+
+        for (i = 0; i < L_SUBFR; i++)
+            xz[i] = x[i];
+        for (; i < L_SUBFR + 8; i++)
+            xz[i] = 0;
+
+        for (i = 0; i < L_SUBFR; i += STEP)
+        {
+            j = 8 - (i >> 3);
+            s0 = vo_dot_x8(&xz[i], h, j);
+            s1 = vo_dot_x8(&xz[i + 1], h, j);
+            s2 = vo_dot_x8(&xz[i + 2], h, j);
+            s3 = vo_dot_x8(&xz[i + 3], h, j);
+            s0 = _mm_slli_epi32(vo_sum4_x4(s0, s1, s2, s3), 1);
+            _mm_storeu_si128((__m128i *)&y32[i], _mm_add_epi32(s0, _mm_set1_epi32(1)));
+        }
+
+        for (i = 0; i < L_SUBFR; i += STEP)
+        {
+            L_tmp = L_abs(y32[i]);
+            if(L_tmp > L_max)
+                L_max = L_tmp;
+            L_tmp = L_abs(y32[i + 1]);
+            if(L_tmp > L_max1)
+                L_max1 = L_tmp;
+            L_tmp = L_abs(y32[i + 2]);
+            if(L_tmp > L_max2)
+                L_max2 = L_tmp;
+            L_tmp = L_abs(y32[i + 3]);
+            if(L_tmp > L_max3)
+                L_max3 = L_tmp;
+        }
+    }
+    else
+#endif /* __SSE2__ */
     for (i = 0; i < L_SUBFR; i += STEP)
     {
         L_tmp = 1;                                    /* 1 -> to avoid null dn[] */
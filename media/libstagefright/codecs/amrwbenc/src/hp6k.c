@@ -27,6 +27,7 @@
 #include "basic_op.h"
 #include "acelp.h"
 #include "cnst.h"
+#include "basic_op_sse2.h"
 
 #define L_FIR 31
 
@@ -64,7 +65,38 @@ void Filt_6k_7k(
     {
         x[i + L_FIR - 1] = signal[i] >> 2;                         /* gain of filter = 4 */
     }
-    for (i = 0; i < lg; i++)
+    i = 0;
+#if defined(__SSE2__)
+    {
+        /* taps 0..7, 8..15, 16..23, and 23..30 with tap 23 masked out */
+        const __m128i c0 = _mm_loadu_si128((__m128i *)&fir_6k_7k[0]);
+        const __m128i c1 = _mm_loadu_si128((__m128i *)&fir_6k_7k[8]);
+        const __m128i c2 = _mm_loadu_si128((__m128i *)&fir_6k_7k[16]);
+        const __m128i c3 = _mm_and_si128(_mm_loadu_si128((__m128i *)&fir_6k_7k[23]),
+                                         _mm_set_epi16(-1, -1, -1, -1, -1, -1, -1, 0));
+        __m128i s[4];
+        Word32 k;
+
+        for (; i + 4 <= lg; i += 4)
+        {
+            for (k = 0; k < 4; k++)
+            {
+                Word16 *p = &x[i + k];
+                s[k] = _mm_add_epi32(
+                        _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&p[0]), c0),
+                                      _mm_madd_epi16(_mm_loadu_si128((__m128i *)&p[8]), c1)),
+                        _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&p[16]), c2),
+                                      _mm_madd_epi16(_mm_loadu_si128((__m128i *)&p[23]), c3)));
+            }
+            s[0] = vo_sum4_x4(s[0], s[1], s[2], s[3]);
+            s[0] = _mm_srai_epi32(_mm_add_epi32(s[0], _mm_set1_epi32(0x4000)), 15);
+            /* the result is truncated to 16 bits, not saturated */
+            s[0] = _mm_srai_epi32(_mm_slli_epi32(s[0], 16), 16);
+            _mm_storel_epi64((__m128i *)&signal[i], _mm_packs_epi32(s[0], s[0]));
+        }
+    }
+#endif /* __SSE2__ */
+    for (; i < lg; i++)
     {
         L_tmp =  (x[i] + x[i+ 30]) * fir_6k_7k[0];
         L_tmp += (x[i+1] + x[i + 29]) * fir_6k_7k[1];
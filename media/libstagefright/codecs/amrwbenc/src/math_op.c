@@ -38,6 +38,7 @@
 */
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 #include "math_op.h"
 
 /*___________________________________________________________________________
@@ -179,6 +180,24 @@ Word32 Pow2(                               /* (o) Q0  : result       (range: 0<=
     return (L_x);
 }
 
+#if defined(__SSE2__)
+/* is there an i < lg, lg a multiple of 8, with x[i] == y[i] == MIN_16 ? */
+static Flag Min16_pair(Word16 x[], Word16 y[], Word16 lg)
+{
+    const __m128i min16 = _mm_set1_epi16(MIN_16);
+    __m128i m = _mm_setzero_si128();
+    Word32 i;
+
+    for (i = 0; i < lg; i += 8)
+    {
+        m = _mm_or_si128(m, _mm_and_si128(
+                    _mm_cmpeq_epi16(_mm_loadu_si128((__m128i *)&x[i]), min16),
+                    _mm_cmpeq_epi16(_mm_loadu_si128((__m128i *)&y[i]), min16)));
+    }
+    return _mm_movemask_epi8(m) != 0;
+}
+
+#endif /* __SSE2__ */
 /*___________________________________________________________________________
 |                                                                           |
 |   Function Name : Dot_product12()                                         |
@@ -203,7 +222,30 @@ Word32 Dot_product12(                      /* (o) Q31: normalized result (1 < va
     Word16 sft;
     Word32 i, L_sum;
     L_sum = 0;
-    for (i = 0; i < lg; i++)
+    i = 0;
+#if defined(__SSE2__)
+    /* without a pair of MIN_16 no product is 0x40000000 */
+    if ((lg & 7) == 0 && !Min16_pair(x, y, lg))
+    {
+        int64_t L_ener = vo_energy_x8(x, lg >> 3);
+        __m128i acc;
+
+        if (x == y)
+        {
+            /* no term is negative, so L_add() only saturates the total */
+            L_sum = (L_ener > MAX_32) ? MAX_32 : (Word32)L_ener;
+            i = lg;
+        }
+        else if (vo_sum_fits(L_ener, vo_energy_x8(y, lg >> 3), MAX_32))
+        {
+            acc = vo_dot_x8(x, y, lg >> 3);
+            acc = vo_sum4_x4(acc, acc, acc, acc);
+            L_sum = _mm_cvtsi128_si32(acc);
+            i = lg;
+        }
+    }
+#endif /* __SSE2__ */
+    for (; i < lg; i++)
     {
         Word32 tmp = (Word32) x[i] * (Word32) y[i];
         if (tmp == (Word32) 0x40000000L) {
@@ -26,6 +26,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 #define UP_SAMP      4
 #define L_INTERPOL2  16
@@ -71,7 +72,35 @@ void Pred_lt4(
     k = 3 - frac;                                /* k = UP_SAMP - 1 - frac */
 
     ptr2 = &(inter4_2[k][0]);
-    for (j = 0; j < L_subfr; j++)
+    j = 0;
+#if defined(__SSE2__)
+    /* exc[j] reads up to exc[j - T0 + 16], four outputs at a time need T0 > 19 */
+    if (T0 >= L_INTERPOL2 + 4)
+    {
+        const __m128i c0 = _mm_loadu_si128((__m128i *)&ptr2[0]);
+        const __m128i c1 = _mm_loadu_si128((__m128i *)&ptr2[8]);
+        const __m128i c2 = _mm_loadu_si128((__m128i *)&ptr2[16]);
+        const __m128i c3 = _mm_loadu_si128((__m128i *)&ptr2[24]);
+        __m128i s[4];
+
+        for (; j + 4 <= L_subfr; j += 4)
+        {
+            for (k = 0; k < 4; k++)
+            {
+                ptr1 = x + k;
+                s[k] = _mm_add_epi32(
+                        _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[0]), c0),
+                                      _mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[8]), c1)),
+                        _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[16]), c2),
+                                      _mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[24]), c3)));
+            }
+            s[0] = vo_round_shl_x4(vo_sum4_x4(s[0], s[1], s[2], s[3]), 2);
+            _mm_storel_epi64((__m128i *)&exc[j], _mm_packs_epi32(s[0], s[0]));
+            x += 4;
+        }
+    }
+#endif /* __SSE2__ */
+    for (; j < L_subfr; j++)
     {
         ptr = ptr2;
         ptr1 = x;
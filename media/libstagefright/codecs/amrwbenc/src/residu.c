@@ -24,6 +24,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 void Residu(
         Word16 a[],                           /* (i) Q12 : prediction coefficients                     */
@@ -34,7 +35,36 @@ void Residu(
 {
     Word16 i,*p1, *p2;
     Word32 s;
-    for (i = 0; i < lg; i++)
+
+    i = 0;
+#if defined(__SSE2__)
+    {
+        /* a[16..9] and a[8..1] against x[i-16..i-1], a[0] paired with zeros against x[i] */
+        const __m128i a_hi = _mm_set_epi16(a[9], a[10], a[11], a[12], a[13], a[14], a[15], a[16]);
+        const __m128i a_lo = _mm_set_epi16(a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+        const __m128i a_0 = _mm_set1_epi32((UWord16)a[0]);
+        __m128i s0, s1, s2, s3;
+
+        for (; i + 4 <= lg; i += 4)
+        {
+            s0 = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 16]), a_hi),
+                               _mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 8]), a_lo));
+            s1 = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 15]), a_hi),
+                               _mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 7]), a_lo));
+            s2 = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 14]), a_hi),
+                               _mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 6]), a_lo));
+            s3 = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 13]), a_hi),
+                               _mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i - 5]), a_lo));
+            s0 = vo_sum4_x4(s0, s1, s2, s3);
+            s1 = _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i *)&x[i]), _mm_setzero_si128());
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(s1, a_0));
+
+            s0 = vo_round_shl_x4(s0, 5);
+            _mm_storel_epi64((__m128i *)&y[i], _mm_packs_epi32(s0, s0));
+        }
+    }
+#endif /* __SSE2__ */
+    for (; i < lg; i++)
     {
         p1 = a;
         p2 = &x[i];
@@ -16,6 +16,7 @@ LOCAL_SRC_FILES := \
     src/sad.cpp \
     src/sad_halfpel.cpp \
     src/slice.cpp \
+    src/slice_thread.cpp \
     src/vlc_encode.cpp
 
 
@@ -34,6 +35,8 @@ LOCAL_CFLAGS += -Werror
 LOCAL_CLANG := true
 LOCAL_SANITIZE := signed-integer-overflow
 
+# x86 builds use the SSE2 motion estimation kernels in src/: both x86 ABIs have SSE2.
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
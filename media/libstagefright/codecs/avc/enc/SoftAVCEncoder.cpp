@@ -18,6 +18,7 @@
 #define LOG_TAG "SoftAVCEncoder"
 #include <utils/Log.h>
 #include <utils/misc.h>
+#include <unistd.h>
 
 #include "avcenc_api.h"
 #include "avcenc_int.h"
@@ -53,6 +54,18 @@ static void InitOMXParams(T *params) {
     params->nVersion.s.nStep = 0;
 }
 
+static int GetCPUCoreCount() {
+    int cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK_GE(cpuCoreCount, 1);
+    return cpuCoreCount;
+}
+
 static const CodecProfileLevel kProfileLevels[] = {
     { OMX_VIDEO_AVCProfileBaseline, OMX_VIDEO_AVCLevel2  },
 };
@@ -161,6 +174,7 @@ SoftAVCEncoder::SoftAVCEncoder(
             176 /* width */, 144 /* height */,
             callbacks, appData, component),
       mIDRFrameRefreshIntervalInSec(1),
+      mSliceHeaderSpacing(0),
       mAVCEncProfile(AVC_BASELINE),
       mAVCEncLevel(AVC_LEVEL2),
       mNumInputFrames(-1),
@@ -282,6 +296,18 @@ OMX_ERRORTYPE SoftAVCEncoder::initEncParams() {
     }
     mEncParams->slice_group = mSliceGroup;
 
+    // Slices of at most mSliceHeaderSpacing macroblocks, rounded up to whole
+    // macroblock rows, encoded concurrently on all the cores. ACodec takes
+    // the spacing from the "slice-header-spacing" format key; without it a
+    // picture is a single slice, encoded on one core.
+    int32_t mbHeight = divUp(mHeight, 16);
+    mEncParams->num_slice = 1;
+    if (mSliceHeaderSpacing > 0) {
+        int32_t mbRowsPerSlice = divUp(mSliceHeaderSpacing, divUp(mWidth, 16));
+        mEncParams->num_slice = divUp(mbHeight, mbRowsPerSlice);
+    }
+    mEncParams->num_thread = min(mEncParams->num_slice, GetCPUCoreCount());
+
     // Set IDR frame refresh interval
     if (mIDRFrameRefreshIntervalInSec < 0) {
         mEncParams->idr_period = -1;
@@ -417,6 +443,7 @@ OMX_ERRORTYPE SoftAVCEncoder::internalGetParameter(
             avcParams->bDirect8x8Inference = OMX_FALSE;
             avcParams->bDirectSpatialTemporal = OMX_FALSE;
             avcParams->nCabacInitIdc = 0;
+            avcParams->nSliceHeaderSpacing = mSliceHeaderSpacing;
             return OMX_ErrorNone;
         }
 
@@ -482,6 +509,8 @@ OMX_ERRORTYPE SoftAVCEncoder::internalSetParameter(
                 return OMX_ErrorUndefined;
             }
 
+            mSliceHeaderSpacing = avcType->nSliceHeaderSpacing;
+
             return OMX_ErrorNone;
         }
 
@@ -491,7 +520,8 @@ OMX_ERRORTYPE SoftAVCEncoder::internalSetParameter(
 }
 
 void SoftAVCEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
-    if (mSignalledError || mSawInputEOS) {
+    // The picture of the last input buffer may still have slices to output.
+    if (mSignalledError || (mSawInputEOS && mReadyForNextFrame)) {
         return;
     }
 
@@ -504,7 +534,7 @@ void SoftAVCEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
     List<BufferInfo *> &inQueue = getPortQueue(0);
     List<BufferInfo *> &outQueue = getPortQueue(1);
 
-    while (!mSawInputEOS && !inQueue.empty() && !outQueue.empty()) {
+    while (!(mSawInputEOS && mReadyForNextFrame) && !inQueue.empty() && !outQueue.empty()) {
         BufferInfo *inInfo = *inQueue.begin();
         OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
         BufferInfo *outInfo = *outQueue.begin();
@@ -639,19 +669,53 @@ void SoftAVCEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
 
         // Encode an input video frame
         CHECK(encoderStatus == AVCENC_SUCCESS || encoderStatus == AVCENC_NEW_IDR);
-        dataLength = outHeader->nAllocLen;  // Reset the output buffer length
+        bool pictureDone = true;
         if (inHeader->nFilledLen > 0) {
-            if (outHeader->nAllocLen >= 4) {
+            // All the slices of the picture go into the same output buffer,
+            // as many as fit. The ones that don't fit go into the next one.
+            bool bufferFull = false;
+            do {
+                dataLength = outHeader->nAllocLen - (outPtr - outHeader->pBuffer);
+                if (dataLength < 4) {
+                    bufferFull = true;
+                    break;
+                }
                 memcpy(outPtr, "\x00\x00\x00\x01", 4);
-                outPtr += 4;
                 dataLength -= 4;
+                encoderStatus = PVAVCEncodeNAL(mHandle, outPtr + 4, &dataLength, &type);
+                if (encoderStatus == AVCENC_SUCCESS || encoderStatus == AVCENC_PICTURE_READY) {
+                    CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
+                    outPtr += 4 + dataLength;
+                } else if (encoderStatus == AVCENC_BITSTREAM_BUFFER_FULL) {
+                    bufferFull = true;
+                }
+            } while (encoderStatus == AVCENC_SUCCESS);
+
+            dataLength = outPtr - outHeader->pBuffer;
+            if (bufferFull) {
+                if (dataLength == 0) {
+                    // Not even one slice fits into an empty buffer.
+                    encoderStatus = AVCENC_BITSTREAM_BUFFER_FULL;
+                } else {
+                    // Hand out the slices so far and keep the input buffer
+                    // for the rest of the picture.
+                    pictureDone = false;
+                    encoderStatus = AVCENC_SUCCESS;
+                }
             }
-            encoderStatus = PVAVCEncodeNAL(mHandle, outPtr, &dataLength, &type);
-            dataLength = outPtr + dataLength - outHeader->pBuffer;
-            if (encoderStatus == AVCENC_SUCCESS) {
-                CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
+
+            if (encoderStatus < AVCENC_SUCCESS) {
+                ALOGE("encoderStatus = %d at line %d", encoderStatus, __LINE__);
+                mSignalledError = true;
+                notify(OMX_EventError, OMX_ErrorUndefined, 0, 0);
+                return;
+            }
+
+            if (!pictureDone) {
+                if (mIsIDRFrame) {
+                    outHeader->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
+                }
             } else if (encoderStatus == AVCENC_PICTURE_READY) {
-                CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
                 if (mIsIDRFrame) {
                     outHeader->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
                     mIsIDRFrame = false;
@@ -665,31 +729,30 @@ void SoftAVCEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
                 dataLength = 0;
                 mReadyForNextFrame = true;
             }
-
-            if (encoderStatus < AVCENC_SUCCESS) {
-                ALOGE("encoderStatus = %d at line %d", encoderStatus, __LINE__);
-                mSignalledError = true;
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, 0);
-                return;
-            }
         } else {
             dataLength = 0;
         }
 
+        CHECK(!mInputBufferInfoVec.empty());
+        InputBufferInfo *inputBufInfo = mInputBufferInfoVec.begin();
+        outHeader->nTimeStamp = inputBufInfo->mTimeUs;
+        outHeader->nFilledLen = dataLength;
+        outQueue.erase(outQueue.begin());
+        outInfo->mOwnedByUs = false;
+
+        if (!pictureDone) {
+            notifyFillBufferDone(outHeader);
+            continue;
+        }
+
         inQueue.erase(inQueue.begin());
         inInfo->mOwnedByUs = false;
         notifyEmptyBufferDone(inHeader);
 
-        outQueue.erase(outQueue.begin());
-        CHECK(!mInputBufferInfoVec.empty());
-        InputBufferInfo *inputBufInfo = mInputBufferInfoVec.begin();
-        outHeader->nTimeStamp = inputBufInfo->mTimeUs;
         outHeader->nFlags |= (inputBufInfo->mFlags | OMX_BUFFERFLAG_ENDOFFRAME);
         if (mSawInputEOS) {
             outHeader->nFlags |= OMX_BUFFERFLAG_EOS;
         }
-        outHeader->nFilledLen = dataLength;
-        outInfo->mOwnedByUs = false;
         notifyFillBufferDone(outHeader);
         mInputBufferInfoVec.erase(mInputBufferInfoVec.begin());
     }
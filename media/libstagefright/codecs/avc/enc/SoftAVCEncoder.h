@@ -67,6 +67,7 @@ private:
     } InputBufferInfo;
 
     int32_t  mIDRFrameRefreshIntervalInSec;
+    int32_t  mSliceHeaderSpacing;  // in macroblocks, 0 for a single slice per picture
     AVCProfile mAVCEncProfile;
     AVCLevel   mAVCEncLevel;
 
@@ -211,6 +211,26 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
         return AVCENC_MEMORY_FAIL;
     }
 
+    /* split the picture into bands of MB rows encoded concurrently */
+    encvid->sliceThreads = NULL;
+    encvid->currSlice = 0;
+    encvid->firstMbRow = 0;
+    encvid->endMbRow = video->PicHeightInMbs;
+    encvid->chromaPadded = false;
+
+    if (encParam->num_slice > 1)
+    {
+        if (video->currPicParams->num_slice_groups_minus1 > 0)
+        {
+            return AVCENC_INVALID_NUM_SLICEGROUP;
+        }
+
+        if (AVCENC_SUCCESS != InitSliceThreads(avcHandle, encParam->num_slice, encParam->num_thread))
+        {
+            return AVCENC_MEMORY_FAIL;
+        }
+    }
+
     /* intialize function pointers */
     encvid->functionPointer = (AVCEncFuncPtr*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncFuncPtr), DEFAULT_ATTR);
     if (encvid->functionPointer == NULL)
@@ -437,32 +457,45 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncodeNAL(AVCHandle *avcHandle, unsigned char
         case AVCEnc_Encoding_Frame:
             /* initialized the structure */
             BitstreamEncInit(bitstream, buffer, *buf_nal_size, encvid->overrunBuffer, encvid->oBSize);
-            BitstreamWriteBits(bitstream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
-
-            /* Re-order the reference list according to the ref_pic_list_reordering() */
-            /* We don't have to reorder the list for the encoder here. This can only be done
-            after we encode this slice. We can run thru a second-pass to see if new ordering
-            would save more bits. Too much delay !! */
-            /* status = ReOrderList(video);*/
-            status = InitSlice(encvid);
-            if (status != AVCENC_SUCCESS)
-            {
-                return status;
-            }
 
-            /* when we have everything, we encode the slice header */
-            status = EncodeSliceHeader(encvid, bitstream);
-            if (status != AVCENC_SUCCESS)
+            if (encvid->sliceThreads != NULL)
             {
-                return status;
+                /* the slices are encoded concurrently on the first call for a picture */
+                status = AVCEncodeSliceThreaded(encvid, bitstream);
+                if (status != AVCENC_SUCCESS && status != AVCENC_PICTURE_READY)
+                {
+                    return status;
+                }
             }
+            else
+            {
+                BitstreamWriteBits(bitstream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
+
+                /* Re-order the reference list according to the ref_pic_list_reordering() */
+                /* We don't have to reorder the list for the encoder here. This can only be done
+                after we encode this slice. We can run thru a second-pass to see if new ordering
+                would save more bits. Too much delay !! */
+                /* status = ReOrderList(video);*/
+                status = InitSlice(encvid);
+                if (status != AVCENC_SUCCESS)
+                {
+                    return status;
+                }
 
-            status = AVCEncodeSlice(encvid);
+                /* when we have everything, we encode the slice header */
+                status = EncodeSliceHeader(encvid, bitstream);
+                if (status != AVCENC_SUCCESS)
+                {
+                    return status;
+                }
 
-            video->slice_id++;
+                status = AVCEncodeSlice(encvid);
 
-            /* closing the NAL with trailing bits */
-            BitstreamTrailingBits(bitstream, buf_nal_size);
+                video->slice_id++;
+
+                /* closing the NAL with trailing bits */
+                BitstreamTrailingBits(bitstream, buf_nal_size);
+            }
 
             *buf_nal_size = bitstream->write_pos;
 
@@ -596,6 +629,8 @@ OSCL_EXPORT_REF void    PVAVCCleanUpEncoder(AVCHandle *avcHandle)
 
     if (encvid != NULL)
     {
+        CleanSliceThreads(avcHandle);
+
         CleanMotionSearchModule(avcHandle);
 
         CleanupRateControlModule(avcHandle);
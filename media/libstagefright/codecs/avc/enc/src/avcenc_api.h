@@ -124,6 +124,10 @@ typedef struct tagAVCEncParam
     /* fmo_type == 6 */
     uint *slice_group; /* array of size MBWidth*MBHeight */
 
+    int num_slice;      /* number of slices per picture, each one a band of MB rows, 0 or 1 for
+                        a single slice. Cannot be used with more than one slice group. */
+    int num_thread;     /* number of threads encoding the slices of a picture concurrently */
+
     AVCFlag db_filter;  /* enable deblocking loop filter */
     int disable_db_idc;  /* 0: filter everywhere, 1: no filter, 2: no filter across slice boundary */
     int alpha_offset;   /* alpha offset range -6,...,6 */
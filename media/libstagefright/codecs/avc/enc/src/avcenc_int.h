@@ -31,6 +31,8 @@ and necessary type defitionitions and enumerations.
 #include "avcenc_api.h"
 #endif
 
+#include <pthread.h>
+
 typedef float OsclFloat;
 
 /* Definition for the structures below */
@@ -361,6 +363,7 @@ typedef struct tagHTFM_Stat
 } HTFM_Stat;
 #endif
 
+typedef struct tagEncSliceThreads AVCEncSliceThreads;
 
 /**
 This structure is the main object for AVC encoder library providing access to all
@@ -386,6 +389,13 @@ typedef struct tagEncObject
 
     int                 currSliceGroup; /* currently encoded slice group id */
 
+    /* slice-parallel encoding, see slice_thread.cpp */
+    AVCEncSliceThreads  *sliceThreads; /* NULL when a picture is a single slice */
+    int                 currSlice;  /* next slice of the picture to be output */
+    int                 firstMbRow; /* the slice being worked on covers MB rows */
+    int                 endMbRow;   /* [firstMbRow, endMbRow) */
+    bool                chromaPadded; /* reference chromas padded for the whole picture */
+
     int     level[24][16], run[24][16]; /* scratch memory */
     int     leveldc[16], rundc[16]; /* for DC component */
     int     levelcdc[16], runcdc[16]; /* for chroma DC component */
@@ -466,6 +476,70 @@ typedef struct tagEncObject
 
 } AVCEncObject;
 
+/**
+Jobs run on every slice of a picture by the slice threads.
+*/
+typedef enum
+{
+    AVC_SLICE_MOTION_EST = 0,   /* one pass of motion estimation */
+    AVC_SLICE_ENCODE            /* encode the slice into its NAL */
+} AVCSliceJob;
+
+/**
+This structure contains a slice encoded concurrently with the other slices of the
+picture. Its objects are copies of the main ones, taken when a job starts, so that
+the threads only share the per-MB arrays, in which each slice writes its own MBs.
+*/
+typedef struct tagEncSlice
+{
+    AVCEncObject    encvid;
+    AVCCommonObj    video;
+    AVCSliceHeader  sliceHdr;
+    AVCRateControl  rateCtrl;
+    AVCEncBitstream bitstream;
+
+    uint8   *buffer;    /* the encoded NAL, reallocated as needed */
+    int     buf_size;
+
+    int     firstMbRow; /* MB rows [firstMbRow, endMbRow) */
+    int     endMbRow;
+
+    /* outputs of the jobs */
+    int     totalSAD;
+    int     numIntraSearch;
+    AVCEnc_Status status;
+
+} AVCEncSlice;
+
+/**
+This structure contains the threads encoding the slices of a picture. The thread
+calling the encoder takes part in every job, so there are numThread-1 of them.
+*/
+struct tagEncSliceThreads
+{
+    AVCEncObject    *encvid;    /* main object */
+    AVCEncSlice     *slice;     /* array of numSlice slices */
+    int             numSlice;
+
+    pthread_t       *thread;
+    int             numThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  startCond;  /* signalled when a job is started or on exit */
+    pthread_cond_t  doneCond;   /* signalled when a thread has run out of slices */
+
+    /* fields below protected by mutex */
+    AVCSliceJob     job;
+    int             jobCount;   /* incremented for each job started */
+    int             nextSlice;  /* next slice to be picked up */
+    int             numBusy;    /* number of slices being worked on */
+    bool            quit;
+
+    /* parameters of the motion estimation pass */
+    int             start_i;
+    int             incr_i;
+    int             type_pred;
+};
+
 
 #endif /*AVCENC_INT_H_INCLUDED*/
 
@@ -287,6 +287,16 @@ extern "C"
     */
     AVCEnc_Status AVCBitstreamUseOverrunBuffer(AVCEncBitstream* stream, int numExtraBytes);
 
+    /**
+    This function copies a NAL that has already been encoded, in EBSP format, to an empty
+    bitstream, using the overrun buffer if the bitstream buffer is not big enough.
+    \param "stream" "Pointer to the bitstream structure."
+    \param "nal"    "Pointer to the NAL."
+    \param "size"   "Size of the NAL in bytes."
+    \return "AVCENC_SUCCESS or AVCENC_BITSTREAM_BUFFER_FULL."
+    */
+    AVCEnc_Status BitstreamCopyNAL(AVCEncBitstream *stream, uint8 *nal, int size);
+
 
     /*-------------- intra_est.c ---------------*/
 
@@ -454,7 +464,7 @@ extern "C"
 
     void eChromaMotionComp(uint8 *ref, int picwidth, int picheight,
                            int x_pos, int y_pos, uint8 *pred, int pred_pitch,
-                           int blkwidth, int blkheight);
+                           int blkwidth, int blkheight, bool padded);
 
     void eChromaDiagonalMC_SIMD(uint8 *pRef, int srcPitch, int dx, int dy,
                                 uint8 *pOut, int predPitch, int blkwidth, int blkheight);
@@ -504,6 +514,21 @@ extern "C"
     */
     void AVCMotionEstimation(AVCEncObject *encvid);
 
+    /**
+    This function performs one pass of motion estimation over the MB rows
+    [encvid->firstMbRow, encvid->endMbRow). The candidates come from within these rows
+    only, so that the rows of different slices can be searched concurrently.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "start_i"    "First MB column of the pass, toggled every row when incr_i is 2."
+    \param "incr_i"     "1 to search every MB, 2 for every other MB."
+    \param "type_pred"  "Type of the candidate prediction."
+    \param "totalSAD"   "Pointer to the SAD of the rows, for rate control."
+    \param "NumIntraSearch" "Pointer to the number of MBs to be intra searched."
+    \return "void"
+    */
+    void AVCMotionEstimationRows(AVCEncObject *encvid, int start_i, int incr_i, int type_pred,
+                                 int *totalSAD, int *NumIntraSearch);
+
     /**
     This function performs repetitive edge padding to the reference picture by adding 16 pixels
     around the luma and 8 pixels around the chromas.
@@ -512,6 +537,14 @@ extern "C"
     */
     void  AVCPaddingEdge(AVCPictureData *refPic);
 
+    /**
+    This function performs repetitive edge padding of 8 pixels around the chromas of the
+    reference picture, for the slices encoded concurrently.
+    \param "refPic" "Pointer to the reference picture."
+    \return "void"
+    */
+    void  AVCPaddingEdgeChroma(AVCPictureData *refPic);
+
     /**
     This function keeps track of intra refresh macroblock locations.
     \param "encvid" "Pointer to the global array structure AVCEncObject."
@@ -817,6 +850,44 @@ extern "C"
 #endif
 
 
+    /*------------- slice_thread.c -------------------*/
+
+    /**
+    This function splits the picture into bands of MB rows, one per slice, and starts
+    the threads encoding them.
+    \param "avcHandle"  "Pointer to AVCHandle."
+    \param "numSlice"   "Number of slices per picture."
+    \param "numThread"  "Number of threads, including the one calling the encoder."
+    \return "AVCENC_SUCCESS or AVCENC_MEMORY_FAIL."
+    */
+    AVCEnc_Status InitSliceThreads(AVCHandle *avcHandle, int numSlice, int numThread);
+
+    /**
+    This function stops the slice threads and frees the slices.
+    \param "avcHandle"  "Pointer to AVCHandle."
+    \return "void"
+    */
+    void CleanSliceThreads(AVCHandle *avcHandle);
+
+    /**
+    This function runs a job on every slice of the picture and returns once all of them
+    are done.
+    \param "threads"    "Pointer to AVCEncSliceThreads."
+    \param "job"        "The job to be run."
+    \return "void"
+    */
+    void RunSliceJob(AVCEncSliceThreads *threads, AVCSliceJob job);
+
+    /**
+    This function outputs the next slice of the picture. On the first call for a picture,
+    all the slices are encoded concurrently, the following calls return them in order.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "stream" "Pointer to the bitstream the slice NAL is copied to."
+    \return "AVCENC_SUCCESS for success, AVCENC_PICTURE_READY after the last slice, or
+             the error status of a slice."
+    */
+    AVCEnc_Status AVCEncodeSliceThreaded(AVCEncObject *encvid, AVCEncBitstream *stream);
+
     /*------------- slice.c -------------------------*/
 
     /**
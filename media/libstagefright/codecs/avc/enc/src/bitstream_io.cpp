@@ -337,3 +337,20 @@ AVCEnc_Status AVCBitstreamUseOverrunBuffer(AVCEncBitstream* stream, int numExtra
 
 
 
+
+/* copy an already encoded NAL to an empty bitstream */
+AVCEnc_Status BitstreamCopyNAL(AVCEncBitstream *stream, uint8 *nal, int size)
+{
+    if (stream->buf_size - stream->write_pos < size)
+    {
+        if (AVCENC_SUCCESS != AVCBitstreamUseOverrunBuffer(stream, size))
+        {
+            return AVCENC_BITSTREAM_BUFFER_FULL;
+        }
+    }
+
+    memcpy(stream->bitstreamBuffer + stream->write_pos, nal, size);
+    stream->write_pos += size;
+
+    return AVCENC_SUCCESS;
+}
@@ -16,6 +16,11 @@
  * -------------------------------------------------------------------
  */
 #include "avcenc_lib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /* 3/29/01 fast half-pel search based on neighboring guess */
 /* value ranging from 0 to 4, high complexity (more accurate) to
    low complexity (less accurate) */
@@ -130,6 +135,192 @@ int AVCFindHalfPelMB(AVCEncObject *encvid, uint8 *cur, AVCMV *mot, uint8 *ncand,
 Each sub-pel position array is 20 pixel wide (for word-alignment) and 17 pixel tall. */
 /** The sub-pel position is labeled in spiral manner from the center. */
 
+#if defined(__SSE2__)
+
+/* 6-tap filter a + f - 5 * (b + e) + 20 * (c + d) of 8 pixels */
+static inline __m128i filter6_epi16(__m128i a, __m128i b, __m128i c,
+                                    __m128i d, __m128i e, __m128i f)
+{
+    __m128i t;
+
+    t = _mm_add_epi16(c, d);
+    t = _mm_sub_epi16(_mm_slli_epi16(t, 2), _mm_add_epi16(b, e));
+    t = _mm_add_epi16(t, _mm_slli_epi16(t, 2));  /* 20 * (c + d) - 5 * (b + e) */
+    return _mm_add_epi16(t, _mm_add_epi16(a, f));
+}
+
+static inline __m128i load8_epi16(uint8 *src)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)src), _mm_setzero_si128());
+}
+
+/* same as the C version below, bit-exact including the vertical
+   interpolation of the last 16 columns, see there */
+void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
+{
+    uint8 *ref;
+    uint8 *dst;
+    int16 tmp_horz[18*22], *src_16;
+    int a, b, c, d, e, f;
+    int32 tmp32;
+    int i, j;
+    __m128i x0, x1, x2, x3, x4, x5, y0, y1, y2;
+    const __m128i round5 = _mm_set1_epi16(16);
+    const __m128i round10 = _mm_set1_epi32(512);
+    const __m128i coef = _mm_set_epi16(-5, 20, -5, 20, -5, 20, -5, 20);
+    /* columns 2-3 of each group of 4 in the SWAR version, see below */
+    const __m128i borrow = _mm_set_epi16(-1, -1, 0, 0, -1, -1, 0, 0);
+
+    /* first copy full-pel to the first array */
+    ref = ncand - 3 - lx - (lx << 1); /* move back (-3,-3) */
+    dst = subpel_pred;
+    for (j = 0; j < 22; j++) /* 24x22 */
+    {
+        _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((__m128i*)ref));
+        _mm_storel_epi64((__m128i*)(dst + 16), _mm_loadl_epi64((__m128i*)(ref + 16)));
+        ref += lx;
+        dst += 24;
+    }
+
+    /* horizontal interp, into tmp_horz (17x22, stride 18) for all rows and
+       into the 14th array for rows 2-19 */
+    ref = subpel_pred;
+    dst = subpel_pred + V0Q_H2Q * SUBPEL_PRED_BLK_SIZE - 48;
+    for (j = 0; j < 22; j++)
+    {
+        for (i = 0; i < 16; i += 8)
+        {
+            x0 = filter6_epi16(load8_epi16(ref + i), load8_epi16(ref + i + 1),
+                               load8_epi16(ref + i + 2), load8_epi16(ref + i + 3),
+                               load8_epi16(ref + i + 4), load8_epi16(ref + i + 5));
+            _mm_storeu_si128((__m128i*)(tmp_horz + j * 18 + i), x0);
+            if (j >= 2 && j < 20)
+            {
+                x0 = _mm_srai_epi16(_mm_add_epi16(x0, round5), 5);
+                _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(x0, x0));
+            }
+        }
+        /* do the 17th column here */
+        tmp32 = ref[16] + ref[21] - 5 * (ref[17] + ref[20]) + 20 * (ref[18] + ref[19]);
+        tmp_horz[j * 18 + 16] = tmp32;
+        if (j >= 2 && j < 20)
+        {
+            tmp32 = (tmp32 + 16) >> 5;
+            CLIP_RESULT(tmp32)
+            dst[16] = tmp32;
+        }
+
+        ref += 24;
+        dst += 24;
+    }
+
+    /* Do middle point filtering, into the 12th array */
+    src_16 = tmp_horz;
+    dst = subpel_pred + V2Q_H2Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 17; j++)
+    {
+        for (i = 0; i < 16; i += 8)
+        {
+            x0 = _mm_loadu_si128((__m128i*)(src_16 + i));
+            x1 = _mm_loadu_si128((__m128i*)(src_16 + i + 18));
+            x2 = _mm_loadu_si128((__m128i*)(src_16 + i + 36));
+            x3 = _mm_loadu_si128((__m128i*)(src_16 + i + 54));
+            x4 = _mm_loadu_si128((__m128i*)(src_16 + i + 72));
+            x5 = _mm_loadu_si128((__m128i*)(src_16 + i + 90));
+
+            /* the sums fit in 16 bits, the result needs 32 */
+            x0 = _mm_add_epi16(x0, x5);
+            x1 = _mm_add_epi16(x1, x4);
+            x2 = _mm_add_epi16(x2, x3);
+            y0 = _mm_madd_epi16(_mm_unpacklo_epi16(x2, x1), coef);
+            y1 = _mm_madd_epi16(_mm_unpackhi_epi16(x2, x1), coef);
+            y0 = _mm_add_epi32(y0, _mm_srai_epi32(_mm_unpacklo_epi16(x0, x0), 16));
+            y1 = _mm_add_epi32(y1, _mm_srai_epi32(_mm_unpackhi_epi16(x0, x0), 16));
+            y0 = _mm_srai_epi32(_mm_add_epi32(y0, round10), 10);
+            y1 = _mm_srai_epi32(_mm_add_epi32(y1, round10), 10);
+            y0 = _mm_packs_epi32(y0, y1);
+            _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(y0, y0));
+        }
+        /* do the 17th column here */
+        tmp32 = src_16[16] + src_16[106] - 5 * (src_16[34] + src_16[88]) +
+                20 * (src_16[52] + src_16[70]);
+        tmp32 = (tmp32 + 512) >> 10;
+        CLIP_RESULT(tmp32)
+        dst[16] = tmp32;
+
+        src_16 += 18;
+        dst += 24;
+    }
+
+    /* do vertical interpolation, into the 10th array. The first two
+       columns are filtered on their own. */
+    ref = subpel_pred + 2;
+    dst = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE;
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < 17; j++)
+        {
+            a = ref[j * 24];
+            b = ref[j * 24 + 24];
+            c = ref[j * 24 + 48];
+            d = ref[j * 24 + 72];
+            e = ref[j * 24 + 96];
+            f = ref[j * 24 + 120];
+
+            tmp32 = a + f - 5 * (b + e) + 20 * (c + d);
+            tmp32 = (tmp32 + 16) >> 5;
+            CLIP_RESULT(tmp32)
+            dst[j * 24] = tmp32;
+        }
+        ref++;
+        dst++;
+    }
+
+    /* The remaining 16 columns are filtered two pixels to a word in the C
+       version. When the filtered value of the lower pixel is below -16, the
+       borrow takes one off the upper pixel, i.e. columns 2 and 3 of each
+       group of 4 get one off when the pixel 2 columns left of them is that
+       low. Done here too to get the same result. */
+    for (j = 0; j < 17; j++)
+    {
+        x0 = _mm_loadu_si128((__m128i*)ref);
+        x1 = _mm_loadu_si128((__m128i*)(ref + 24));
+        x2 = _mm_loadu_si128((__m128i*)(ref + 48));
+        x3 = _mm_loadu_si128((__m128i*)(ref + 72));
+        x4 = _mm_loadu_si128((__m128i*)(ref + 96));
+        x5 = _mm_loadu_si128((__m128i*)(ref + 120));
+
+        y0 = filter6_epi16(_mm_unpacklo_epi8(x0, _mm_setzero_si128()),
+                           _mm_unpacklo_epi8(x1, _mm_setzero_si128()),
+                           _mm_unpacklo_epi8(x2, _mm_setzero_si128()),
+                           _mm_unpacklo_epi8(x3, _mm_setzero_si128()),
+                           _mm_unpacklo_epi8(x4, _mm_setzero_si128()),
+                           _mm_unpacklo_epi8(x5, _mm_setzero_si128()));
+        y1 = filter6_epi16(_mm_unpackhi_epi8(x0, _mm_setzero_si128()),
+                           _mm_unpackhi_epi8(x1, _mm_setzero_si128()),
+                           _mm_unpackhi_epi8(x2, _mm_setzero_si128()),
+                           _mm_unpackhi_epi8(x3, _mm_setzero_si128()),
+                           _mm_unpackhi_epi8(x4, _mm_setzero_si128()),
+                           _mm_unpackhi_epi8(x5, _mm_setzero_si128()));
+        y0 = _mm_add_epi16(y0, round5);
+        y1 = _mm_add_epi16(y1, round5);
+        y2 = _mm_and_si128(_mm_slli_si128(_mm_srai_epi16(y0, 15), 4), borrow);
+        y0 = _mm_add_epi16(y0, y2);
+        y2 = _mm_and_si128(_mm_slli_si128(_mm_srai_epi16(y1, 15), 4), borrow);
+        y1 = _mm_add_epi16(y1, y2);
+        y0 = _mm_srai_epi16(y0, 5);
+        y1 = _mm_srai_epi16(y1, 5);
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(y0, y1));
+
+        ref += 24;
+        dst += 24;
+    }
+
+    return ;
+}
+
+#else /* __SSE2__ */
+
 void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
 {
     /* let's do straightforward way first */
@@ -440,6 +631,8 @@ void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
     return ;
 }
 
+#endif /* __SSE2__ */
+
 void VertInterpWClip(uint8 *dst, uint8 *ref)
 {
     int i, j;
@@ -500,6 +693,88 @@ void VertInterpWClip(uint8 *dst, uint8 *ref)
 }
 
 
+#if defined(__SSE2__)
+
+static inline __m128i load16(uint8 *src)
+{
+    return _mm_loadu_si128((__m128i*)src);
+}
+
+/* (a + b + 1) >> 1 of 16 pixels */
+static inline void store_avg16(uint8 *dst, __m128i a, __m128i b)
+{
+    _mm_storeu_si128((__m128i*)dst, _mm_avg_epu8(a, b));
+}
+
+void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
+{
+    // for even value of hpel_pos, start with pattern 1, otherwise, start with pattern 2
+    int j;
+
+    uint8 *c1 = qpel_cand;
+    uint8 *tl = bilin_base[0];
+    uint8 *tr = bilin_base[1];
+    uint8 *bl = bilin_base[2];
+    uint8 *br = bilin_base[3];
+    __m128i a, b, c, d;
+
+    if (!(hpel_pos&1)) // diamond pattern
+    {
+        for (j = 0; j < 16; j++)
+        {
+            a = load16(tr);
+            b = load16(bl + 1);
+            c = load16(br);
+            d = load16(tr + 24);
+
+            store_avg16(c1, c, a);
+            store_avg16(c1 + 384, b, a);      /* c2 */
+            store_avg16(c1 + 384 * 2, b, c);  /* c3 */
+            store_avg16(c1 + 384 * 3, b, d);  /* c4 */
+
+            b = load16(bl);
+
+            store_avg16(c1 + 384 * 4, c, d);  /* c5 */
+            store_avg16(c1 + 384 * 5, b, d);  /* c6 */
+            store_avg16(c1 + 384 * 6, b, c);  /* c7 */
+            store_avg16(c1 + 384 * 7, b, a);  /* c8 */
+
+            // advance to the next line, pitch is 24
+            tr += 24;
+            bl += 24;
+            br += 24;
+            c1 += 24;
+        }
+    }
+    else // star pattern
+    {
+        for (j = 0; j < 16; j++)
+        {
+            a = load16(br);
+
+            store_avg16(c1, a, load16(tr));
+            store_avg16(c1 + 384, a, load16(tl + 1));      /* c2 */
+            store_avg16(c1 + 384 * 2, a, load16(bl + 1));  /* c3 */
+            store_avg16(c1 + 384 * 3, a, load16(tl + 25)); /* c4 */
+            store_avg16(c1 + 384 * 4, a, load16(tr + 24)); /* c5 */
+            store_avg16(c1 + 384 * 5, a, load16(tl + 24)); /* c6 */
+            store_avg16(c1 + 384 * 6, a, load16(bl));      /* c7 */
+            store_avg16(c1 + 384 * 7, a, load16(tl));      /* c8 */
+
+            // advance to the next line, pitch is 24
+            tl += 24;
+            tr += 24;
+            bl += 24;
+            br += 24;
+            c1 += 24;
+        }
+    }
+
+    return ;
+}
+
+#else /* __SSE2__ */
+
 void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
 {
     // for even value of hpel_pos, start with pattern 1, otherwise, start with pattern 2
@@ -588,6 +863,7 @@ void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
     return ;
 }
 
+#endif /* __SSE2__ */
 
 /* assuming cand always has a pitch of 24 */
 int SATD_MB(uint8 *cand, uint8 *cur, int dmin)
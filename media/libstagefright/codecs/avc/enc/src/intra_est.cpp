@@ -17,6 +17,10 @@
  */
 #include "avcenc_lib.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define TH_I4  0  /* threshold biasing toward I16 mode instead of I4 mode */
 #define TH_Intra  0 /* threshold biasing toward INTER mode instead of intra mode */
 
@@ -43,8 +47,11 @@ bool IntraDecisionABE(AVCEncObject *encvid, int min_cost, uint8 *curL, int picPi
     OsclFloat ABE;
     bool intra = true;
 
+    /* the left neighbor column below reaches into the next MB row, which may be
+       encoded concurrently by the next slice, skip the last row of the slice too */
     if (((x_pos >> 4) != (int)video->PicWidthInMbs - 1) &&
             ((y_pos >> 4) != (int)video->PicHeightInMbs - 1) &&
+            ((y_pos >> 4) != encvid->endMbRow - 1) &&
             video->intraAvailA &&
             video->intraAvailB)
     {
@@ -489,6 +496,30 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
 }
 
 
+#if defined(__SSE2__)
+/* 4-point Hadamard transform of each group of 4 coefficients, the DC ends
+   up in the first one of the group, the order of the others is different
+   from the C code but only their absolute values are used. */
+static inline __m128i hadamard4_epi16(__m128i x)
+{
+    const __m128i neg1 = _mm_set_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+    const __m128i neg2 = _mm_set_epi16(-1, -1, 0, 0, -1, -1, 0, 0);
+    __m128i y;
+
+    y = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)),
+                            _MM_SHUFFLE(2, 3, 0, 1));
+    x = _mm_add_epi16(y, _mm_sub_epi16(_mm_xor_si128(x, neg1), neg1));
+    y = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(1, 0, 3, 2)),
+                            _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_add_epi16(y, _mm_sub_epi16(_mm_xor_si128(x, neg2), neg2));
+}
+
+static inline __m128i abs_epi16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+#endif
+
 int cost_i16(uint8 *org, int org_pitch, uint8 *pred, int min_cost)
 {
 
@@ -497,6 +528,66 @@ int cost_i16(uint8 *org, int org_pitch, uint8 *pred, int min_cost)
     int16 res[256], *pres; // residue
     int m0, m1, m2, m3;
 
+#if defined(__SSE2__)
+    /* Transform a row of 4 blocks at a time, vertically first, two blocks
+       per vector. Only the DC values are stored in res for the Hadamard of
+       the DC below. The cost is checked after each row of blocks like the C
+       version. */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i noDC = _mm_set_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    __m128i d0[2], d1[2], d2[2], d3[2];
+    __m128i x0, x1, x2, x3, sum;
+
+    cost = 0;
+    for (j = 0; j < 4; j++)
+    {
+        __m128i *row[4] = {d0, d1, d2, d3};
+
+        for (k = 0; k < 4; k++)
+        {
+            x0 = _mm_loadu_si128((__m128i*)org);
+            x1 = _mm_loadu_si128((__m128i*)pred);
+            row[k][0] = _mm_sub_epi16(_mm_unpacklo_epi8(x0, zero), _mm_unpacklo_epi8(x1, zero));
+            row[k][1] = _mm_sub_epi16(_mm_unpackhi_epi8(x0, zero), _mm_unpackhi_epi8(x1, zero));
+            org += org_pitch;
+            pred += 16;
+        }
+
+        sum = zero;
+        for (k = 0; k < 2; k++)
+        {
+            /* vertical transform */
+            x0 = _mm_add_epi16(d0[k], d3[k]);
+            x3 = _mm_sub_epi16(d0[k], d3[k]);
+            x1 = _mm_add_epi16(d1[k], d2[k]);
+            x2 = _mm_sub_epi16(d1[k], d2[k]);
+
+            /* horizontal transform */
+            d0[k] = hadamard4_epi16(_mm_add_epi16(x0, x1));
+            d1[k] = hadamard4_epi16(_mm_sub_epi16(x0, x1));
+            d2[k] = hadamard4_epi16(_mm_add_epi16(x3, x2));
+            d3[k] = hadamard4_epi16(_mm_sub_epi16(x3, x2));
+
+            pres = res + (j << 6) + (k << 3);
+            pres[0] = _mm_extract_epi16(d0[k], 0);
+            pres[4] = _mm_extract_epi16(d0[k], 4);
+
+            // only sum up non DC values.
+            x0 = _mm_add_epi16(abs_epi16(_mm_and_si128(d0[k], noDC)), abs_epi16(d1[k]));
+            x1 = _mm_add_epi16(abs_epi16(d2[k]), abs_epi16(d3[k]));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_add_epi16(x0, x1), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+        sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+        cost += _mm_cvtsi128_si32(sum);
+
+        if ((cost >> 1) > min_cost) /* early drop out */
+        {
+            return (cost >> 1);
+        }
+    }
+#else
     // calculate SATD
     org_pitch -= 16;
     pres = res;
@@ -564,6 +655,7 @@ int cost_i16(uint8 *org, int org_pitch, uint8 *pred, int min_cost)
             return (cost >> 1);
         }
     }
+#endif /* __SSE2__ */
 
     /* Hadamard of the DC coefficient */
     pres = res;
@@ -37,8 +37,6 @@ static void (*const eChromaMC_SIMD[8])(uint8 *, int , int , int , uint8 *, int,
 /* Perform motion prediction and compensation with residue if exist. */
 void AVCMBMotionComp(AVCEncObject *encvid, AVCCommonObj *video)
 {
-    (void)(encvid);
-
     AVCMacroblock *currMB = video->currMB;
     AVCPictureData *currPic = video->currPic;
     int mbPartIdx, subMbPartIdx;
@@ -103,10 +101,12 @@ void AVCMBMotionComp(AVCEncObject *encvid, AVCCommonObj *video)
             offsetP = (block_y * picWidth) + (block_x << 1);
             eChromaMotionComp(ref_Cb, picWidth >> 1, picHeight >> 1, x_pos, y_pos,
                               /*comp_Scb +  offsetC,*/
-                              predCb + offsetP, picPitch >> 1, MbWidth >> 1, MbHeight >> 1);
+                              predCb + offsetP, picPitch >> 1, MbWidth >> 1, MbHeight >> 1,
+                              encvid->chromaPadded);
             eChromaMotionComp(ref_Cr, picWidth >> 1, picHeight >> 1, x_pos, y_pos,
                               /*comp_Scr +  offsetC,*/
-                              predCr + offsetP, picPitch >> 1, MbWidth >> 1, MbHeight >> 1);
+                              predCr + offsetP, picPitch >> 1, MbWidth >> 1, MbHeight >> 1,
+                              encvid->chromaPadded);
 
             offset_indx = currMB->SubMbPartWidth[mbPartIdx] >> 3;
         }
@@ -1805,13 +1805,16 @@ void ePadChroma(uint8 *ref, int picwidth, int picheight, int picpitch, int x_pos
 void eChromaMotionComp(uint8 *ref, int picwidth, int picheight,
                        int x_pos, int y_pos,
                        uint8 *pred, int picpitch,
-                       int blkwidth, int blkheight)
+                       int blkwidth, int blkheight, bool padded)
 {
     int dx, dy;
     int offset_dx, offset_dy;
     int index;
 
-    ePadChroma(ref, picwidth, picheight, picpitch, x_pos, y_pos);
+    if (!padded)
+    {
+        ePadChroma(ref, picwidth, picheight, picpitch, x_pos, y_pos);
+    }
 
     dx = x_pos & 7;
     dy = y_pos & 7;
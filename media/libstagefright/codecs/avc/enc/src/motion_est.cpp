@@ -238,39 +238,26 @@ void AVCMotionEstimation(AVCEncObject *encvid)
 {
     AVCCommonObj *video = encvid->common;
     int slice_type = video->slice_type;
-    AVCFrameIO *currInput = encvid->currInput;
     AVCPictureData *refPic = video->RefPicList0[0];
-    int i, j, k;
-    int mbwidth = video->PicWidthInMbs;
-    int mbheight = video->PicHeightInMbs;
+    int i, k;
     int totalMB = video->PicSizeInMbs;
-    int pitch = currInput->pitch;
-    AVCMacroblock *currMB, *mblock = video->mblock;
-    AVCMV *mot_mb_16x16, *mot16x16 = encvid->mot16x16;
-    // AVCMV *mot_mb_16x8, *mot_mb_8x16, *mot_mb_8x8, etc;
+    AVCMacroblock *mblock = video->mblock;
     AVCRateControl *rateCtrl = encvid->rateCtrl;
     uint8 *intraSearch = encvid->intraSearch;
-    uint FS_en = encvid->fullsearch_enable;
+    AVCEncSliceThreads *threads;
 
     int NumIntraSearch, start_i, numLoop, incr_i;
-    int mbnum, offset;
-    uint8 *cur, *best_cand[5];
     int totalSAD = 0;   /* average SAD for rate control */
     int type_pred;
-    int abe_cost;
 
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
     int collect = 0;
-    HTFM_Stat htfm_stat;
+    HTFM_Stat *htfm_stat = &encvid->htfm_stat;
     double newvar[16];
     double exp_lamda[15];
     /*********************************/
 #endif
-    int hp_guess = 0;
-    uint32 mv_uint32;
-
-    offset = 0;
 
     if (slice_type == AVC_I_SLICE)
     {
@@ -309,7 +296,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     encvid->sad_extra_info = NULL;
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/
-    InitHTFM(video, &htfm_stat, newvar, &collect);
+    InitHTFM(video, htfm_stat, newvar, &collect);
     /*********************************/
 #endif
 
@@ -336,94 +323,26 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     NumIntraSearch = 0; // to be intra searched in the encoding loop.
     while (numLoop--)
     {
-        for (j = 0; j < mbheight; j++)
+        if (encvid->sliceThreads)
         {
-            if (incr_i > 1)
-                start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
+            /* each slice searches its own MB rows */
+            threads = encvid->sliceThreads;
+            threads->start_i = start_i;
+            threads->incr_i = incr_i;
+            threads->type_pred = type_pred;
 
-            offset = pitch * (j << 4) + (start_i << 4);
+            RunSliceJob(threads, AVC_SLICE_MOTION_EST);
 
-            mbnum = j * mbwidth + start_i;
-
-            for (i = start_i; i < mbwidth; i += incr_i)
+            for (k = 0; k < threads->numSlice; k++)
             {
-                video->mbNum = mbnum;
-                video->currMB = currMB = mblock + mbnum;
-                mot_mb_16x16 = mot16x16 + mbnum;
-
-                cur = currInput->YCbCr[0] + offset;
-
-                if (currMB->mb_intra == 0) /* for INTER mode */
-                {
-#if defined(HTFM)
-                    HTFMPrepareCurMB_AVC(encvid, &htfm_stat, cur, pitch);
-#else
-                    AVCPrepareCurMB(encvid, cur, pitch);
-#endif
-                    /************************************************************/
-                    /******** full-pel 1MV search **********************/
-
-                    AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
-                                      FS_en, &hp_guess);
-
-                    abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
-
-                    /* set mbMode and MVs */
-                    currMB->mbMode = AVC_P16;
-                    currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
-                    mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
-                    for (k = 0; k < 32; k += 2)
-                    {
-                        currMB->mvL0[k>>1] = mv_uint32;
-                    }
-
-                    /* make a decision whether it should be tested for intra or not */
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
-                        {
-                            intraSearch[mbnum] = 0;
-                        }
-                        else
-                        {
-                            NumIntraSearch++;
-                            rateCtrl->MADofMB[mbnum] = abe_cost;
-                        }
-                    }
-                    else // boundary MBs, always do intra search
-                    {
-                        NumIntraSearch++;
-                    }
-
-                    totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
-                }
-                else    /* INTRA update, use for prediction */
-                {
-                    mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
-
-                    /* reset all other MVs to zero */
-                    /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
-                    abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
-
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        IntraDecisionABE(&abe_cost, cur, pitch, false);
-
-                        rateCtrl->MADofMB[mbnum] = abe_cost;
-                        totalSAD += abe_cost;
-                    }
-
-                    NumIntraSearch++ ;
-                    /* cannot do I16 prediction here because it needs full decoding. */
-                    // intraSearch[mbnum] = 1;
-
-                }
-
-                mbnum += incr_i;
-                offset += (incr_i << 4);
-
-            } /* for i */
-        } /* for j */
+                totalSAD += threads->slice[k].totalSAD;
+                NumIntraSearch += threads->slice[k].numIntraSearch;
+            }
+        }
+        else
+        {
+            AVCMotionEstimationRows(encvid, start_i, incr_i, type_pred, &totalSAD, &NumIntraSearch);
+        }
 
         /* since we cannot do intra/inter decision here, the SCD has to be
         based on other criteria such as motion vectors coherency or the SAD */
@@ -464,7 +383,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     if (collect)
     {
         collect = 0;
-        UpdateHTFM(encvid, newvar, exp_lamda, &htfm_stat);
+        UpdateHTFM(encvid, newvar, exp_lamda, htfm_stat);
     }
     /*********************************/
 #endif
@@ -472,6 +391,127 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     return ;
 }
 
+/* one pass of motion estimation over the MB rows of the current slice */
+void AVCMotionEstimationRows(AVCEncObject *encvid, int start_i, int incr_i, int type_pred,
+                             int *totalSAD, int *NumIntraSearch)
+{
+    AVCCommonObj *video = encvid->common;
+    AVCFrameIO *currInput = encvid->currInput;
+    int i, j, k;
+    int mbwidth = video->PicWidthInMbs;
+    int mbheight = video->PicHeightInMbs;
+    int pitch = currInput->pitch;
+    AVCMacroblock *currMB, *mblock = video->mblock;
+    AVCMV *mot_mb_16x16, *mot16x16 = encvid->mot16x16;
+    // AVCMV *mot_mb_16x8, *mot_mb_8x16, *mot_mb_8x8, etc;
+    AVCRateControl *rateCtrl = encvid->rateCtrl;
+    uint8 *intraSearch = encvid->intraSearch;
+    uint FS_en = encvid->fullsearch_enable;
+
+    int mbnum, offset;
+    uint8 *cur, *best_cand[5];
+    int abe_cost;
+    int hp_guess = 0;
+    uint32 mv_uint32;
+
+    /* start_i toggles every row from the top of the picture */
+    if (incr_i > 1 && (encvid->firstMbRow & 1))
+    {
+        start_i = (start_i == 0 ? 1 : 0) ;
+    }
+
+    for (j = encvid->firstMbRow; j < encvid->endMbRow; j++)
+    {
+        if (incr_i > 1)
+            start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
+
+        offset = pitch * (j << 4) + (start_i << 4);
+
+        mbnum = j * mbwidth + start_i;
+
+        for (i = start_i; i < mbwidth; i += incr_i)
+        {
+            video->mbNum = mbnum;
+            video->currMB = currMB = mblock + mbnum;
+            mot_mb_16x16 = mot16x16 + mbnum;
+
+            cur = currInput->YCbCr[0] + offset;
+
+            if (currMB->mb_intra == 0) /* for INTER mode */
+            {
+#if defined(HTFM)
+                HTFMPrepareCurMB_AVC(encvid, &encvid->htfm_stat, cur, pitch);
+#else
+                AVCPrepareCurMB(encvid, cur, pitch);
+#endif
+                /************************************************************/
+                /******** full-pel 1MV search **********************/
+
+                AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
+                                  FS_en, &hp_guess);
+
+                abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
+
+                /* set mbMode and MVs */
+                currMB->mbMode = AVC_P16;
+                currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
+                mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
+                for (k = 0; k < 32; k += 2)
+                {
+                    currMB->mvL0[k>>1] = mv_uint32;
+                }
+
+                /* make a decision whether it should be tested for intra or not */
+                if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+                {
+                    if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
+                    {
+                        intraSearch[mbnum] = 0;
+                    }
+                    else
+                    {
+                        (*NumIntraSearch)++;
+                        rateCtrl->MADofMB[mbnum] = abe_cost;
+                    }
+                }
+                else // boundary MBs, always do intra search
+                {
+                    (*NumIntraSearch)++;
+                }
+
+                *totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
+            }
+            else    /* INTRA update, use for prediction */
+            {
+                mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
+
+                /* reset all other MVs to zero */
+                /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
+                abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
+
+                if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+                {
+                    IntraDecisionABE(&abe_cost, cur, pitch, false);
+
+                    rateCtrl->MADofMB[mbnum] = abe_cost;
+                    *totalSAD += abe_cost;
+                }
+
+                (*NumIntraSearch)++ ;
+                /* cannot do I16 prediction here because it needs full decoding. */
+                // intraSearch[mbnum] = 1;
+
+            }
+
+            mbnum += incr_i;
+            offset += (incr_i << 4);
+
+        } /* for i */
+    } /* for j */
+
+    return ;
+}
+
 /*=====================================================================
     Function:   PaddingEdge
     Date:       09/16/2000
@@ -562,6 +602,62 @@ void  AVCPaddingEdge(AVCPictureData *refPic)
     return ;
 }
 
+/*=====================================================================
+    Function:   PaddingEdgeChroma
+    Purpose:    Pad 8 pixels around the chromas of a reference picture,
+                done lazily per block by the chroma motion compensation
+                when a picture is a single slice
+=====================================================================*/
+
+static void PadChromaPlane(uint8 *src, int width, int height, int pitch)
+{
+    uint8 *dst;
+    int i;
+
+    /* pad sides */
+    dst = src;
+    i = height;
+    while (i--)
+    {
+        memset(dst - 8, dst[0], 8);
+        memset(dst + width, dst[width-1], 8);
+        dst += pitch;
+    }
+
+    /* pad top and bottom, corners included */
+    src -= 8;
+    dst = src - (pitch << 3);
+    i = 8;
+    while (i--)
+    {
+        memcpy(dst, src, width + 16);
+        dst += pitch;
+    }
+
+    src += (height - 1) * pitch;
+    dst = src + pitch;
+    i = 8;
+    while (i--)
+    {
+        memcpy(dst, src, width + 16);
+        dst += pitch;
+    }
+
+    return ;
+}
+
+void  AVCPaddingEdgeChroma(AVCPictureData *refPic)
+{
+    int width = refPic->width >> 1;
+    int height = refPic->height >> 1;
+    int pitch = refPic->pitch >> 1;
+
+    PadChromaPlane(refPic->Scb, width, height, pitch);
+    PadChromaPlane(refPic->Scr, width, height, pitch);
+
+    return ;
+}
+
 /*===========================================================================
     Function:   AVCRasterIntraUpdate
     Date:       2/26/01
@@ -1066,9 +1162,9 @@ void AVCMBMotionSearch(AVCEncObject *encvid, uint8 *cur, uint8 *best_cand[],
         ncand = ref + imin + jmin * lx;
     }
     else
-    {   /*       fullsearch the top row to only upto (0,3) MB */
+    {   /*       fullsearch the top row of the slice to only upto (0,3) MB */
         /*       upto 30% complexity saving with the same complexity */
-        if (video->PrevRefFrameNum == 0 && j0 == 0 && i0 <= 64 && type_pred != 1)
+        if (video->PrevRefFrameNum == 0 && j0 == (encvid->firstMbRow << 4) && i0 <= 64 && type_pred != 1)
         {
             *hp_guess = 0; /* no guess for fast half-pel */
             dmin =  AVCFullSearch(encvid, ref, cur, &imin, &jmin, ilow, ihigh, jlow, jhigh, cmvx, cmvy);
@@ -1362,6 +1458,10 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
     int mbnum = video->mbNum;
     int mbwidth = video->PicWidthInMbs;
     int mbheight = video->PicHeightInMbs;
+    /* MBs of the other slices may be searched concurrently, only the MB rows of the
+       current slice are used */
+    int firstRow = encvid->firstMbRow;
+    int lastRow = encvid->endMbRow - 1;
     int i, j, same, num1;
 
     /* this part is for predicted MV */
@@ -1391,26 +1491,26 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
 
-            if (jmb < mbheight - 1)  /*bottom neighbor previous frame */
+            if (jmb < lastRow)  /*bottom neighbor previous frame */
             {
                 pmot = &mot16x16[mbnum+mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            else if (jmb > 0)   /*upper neighbor previous frame */
+            else if (jmb > firstRow)   /*upper neighbor previous frame */
             {
                 pmot = &mot16x16[mbnum-mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
 
-            if (imb > 0 && jmb > 0)  /* upper-left neighbor current frame*/
+            if (imb > 0 && jmb > firstRow)  /* upper-left neighbor current frame*/
             {
                 pmot = &mot16x16[mbnum-mbwidth-1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb > 0 && imb < mbheight - 1)  /* upper right neighbor current frame*/
+            if (jmb > firstRow && imb < mbheight - 1)  /* upper right neighbor current frame*/
             {
                 pmot = &mot16x16[mbnum-mbwidth+1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1430,7 +1530,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb > 0)  /*upper neighbor current frame */
+            if (jmb > firstRow)  /*upper neighbor current frame */
             {
                 pmot = &mot16x16[mbnum-mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1442,7 +1542,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb < mbheight - 1)  /*bottom neighbor previous frame */
+            if (jmb < lastRow)  /*bottom neighbor previous frame */
             {
                 pmot = &mot16x16[mbnum+mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1459,7 +1559,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
             pmvA_y = pmot->y;
         }
 
-        if (jmb > 0) /* get MV from top (B) neighbor either on current or previous frame */
+        if (jmb > firstRow) /* get MV from top (B) neighbor either on current or previous frame */
         {
             availB = 1;
             pmot = &mot16x16[mbnum-mbwidth];
@@ -1491,13 +1591,13 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (imb > 0 && jmb > 0)  /* upper-left neighbor */
+            if (imb > 0 && jmb > firstRow)  /* upper-left neighbor */
             {
                 pmot = &mot16x16[mbnum-mbwidth-1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb > 0 && imb < mbheight - 1)  /* upper right neighbor */
+            if (jmb > firstRow && imb < mbheight - 1)  /* upper right neighbor */
             {
                 pmot = &mot16x16[mbnum-mbwidth+1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1513,7 +1613,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 pmvA_y = pmot->y;
             }
 
-            if (jmb > 0 && imb > 0) /* get MV from top-left (B) neighbor of current frame */
+            if (jmb > firstRow && imb > 0) /* get MV from top-left (B) neighbor of current frame */
             {
                 availB = 1;
                 pmot = &mot16x16[mbnum-mbwidth-1];
@@ -1521,7 +1621,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 pmvB_y = pmot->y;
             }
 
-            if (jmb > 0 && imb < mbwidth - 1)
+            if (jmb > firstRow && imb < mbwidth - 1)
             {
                 availC = 1;
                 pmot = &mot16x16[mbnum-mbwidth+1];
@@ -1541,7 +1641,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     mvx[(*num_can)] = (pmot->x) >> 2;
                     mvy[(*num_can)++] = (pmot->y) >> 2;
                 }
-                if (jmb > 0)  /*upper neighbor current frame */
+                if (jmb > firstRow)  /*upper neighbor current frame */
                 {
                     pmot = &mot16x16[mbnum-mbwidth];
                     mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1553,7 +1653,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     mvx[(*num_can)] = (pmot->x) >> 2;
                     mvy[(*num_can)++] = (pmot->y) >> 2;
                 }
-                if (jmb < mbheight - 1)  /*bottom neighbor current frame */
+                if (jmb < lastRow)  /*bottom neighbor current frame */
                 {
                     pmot = &mot16x16[mbnum+mbwidth];
                     mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1569,7 +1669,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     mvx[(*num_can)] = (pmot->x) >> 2;
                     mvy[(*num_can)++] = (pmot->y) >> 2;
 
-                    if (jmb > 0)  /*upper-left neighbor current frame */
+                    if (jmb > firstRow)  /*upper-left neighbor current frame */
                     {
                         pmot = &mot16x16[mbnum-mbwidth-1];
                         mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1577,7 +1677,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     }
 
                 }
-                if (jmb > 0)  /*upper neighbor current frame */
+                if (jmb > firstRow)  /*upper neighbor current frame */
                 {
                     pmot = &mot16x16[mbnum-mbwidth];
                     mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1601,7 +1701,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 pmvA_y = pmot->y;
             }
 
-            if (jmb > 0) /* get MV from top (B) neighbor either on current or previous frame */
+            if (jmb > firstRow) /* get MV from top (B) neighbor either on current or previous frame */
             {
                 availB = 1;
                 pmot = &mot16x16[mbnum-mbwidth];
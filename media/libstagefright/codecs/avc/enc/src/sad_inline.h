@@ -18,6 +18,10 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -58,6 +62,35 @@ extern "C"
         return src1;
     }
 
+#if defined(__SSE2__)
+
+    /* Unaligned loads cost the same as aligned ones here, so there is no
+       need for the byte offset versions of sad_mb_offset.h. The SAD is
+       checked against dmin after each row like the versions below, so
+       that the same partial SAD is returned. */
+    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    {
+        __m128i sad = _mm_setzero_si128();
+        int32 x10 = 0;
+        int i;
+
+        for (i = 16; i > 0; i--)
+        {
+            sad = _mm_add_epi64(sad, _mm_sad_epu8(_mm_loadu_si128((__m128i*)ref),
+                                                  _mm_loadu_si128((__m128i*)blk)));
+            x10 = _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+            if (x10 > dmin)
+                break;
+
+            ref += lx;
+            blk += 16;
+        }
+
+        return x10;
+    }
+
+#else /* __SSE2__ */
+
 #define NUMBER 3
 #define SHIFT 24
 
@@ -169,6 +202,8 @@ SadMBOffset1:
 
     }
 
+#endif /* __SSE2__ */
+
 #elif defined(__CC_ARM)  /* only work with arm v5 */
 
     __inline int32 SUB_SAD(int32 sad, int32 tmp, int32 tmp2)
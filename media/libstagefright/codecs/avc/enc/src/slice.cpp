@@ -42,7 +42,12 @@ AVCEnc_Status AVCEncodeSlice(AVCEncObject *encvid)
     {
         video->mbNum = CurrMbAddr;
         currMB = video->currMB = &(video->mblock[CurrMbAddr]);
-        currMB->slice_id = video->slice_id;  // for deblocking
+        /* already set when the slices of the picture are encoded concurrently, the
+           neighboring slices read it */
+        if (currMB->slice_id != (int)video->slice_id)
+        {
+            currMB->slice_id = video->slice_id;  // for deblocking
+        }
 
         video->mb_x = CurrMbAddr % video->PicWidthInMbs;
         video->mb_y = CurrMbAddr / video->PicWidthInMbs;
@@ -101,6 +106,13 @@ AVCEnc_Status AVCEncodeSlice(AVCEncObject *encvid)
             CurrMbAddr++;
         }
 
+        if ((uint)CurrMbAddr < video->PicSizeInMbs &&
+                CurrMbAddr >= encvid->endMbRow * (int)video->PicWidthInMbs)
+        {
+            /* end of slice, the MB rows below are encoded as other slices */
+            break;
+        }
+
         if ((uint)CurrMbAddr >= video->PicSizeInMbs)
         {
             /* end of slice, return, but before that check to see if there are other slices
@@ -0,0 +1,450 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include "avcenc_lib.h"
+
+/* A picture is split into bands of MB rows, one slice each. Since MBs of other slices are
+   never used for prediction, the slices of a picture can be motion searched and encoded
+   concurrently. Rate control runs per frame, all the slices of a picture use its QP. */
+
+static void *SliceThreadLoop(void *arg);
+
+/* ======================================================================== */
+/*  Function : InitSliceThreads()                                           */
+/*  Purpose  : Allocate the slices and start numThread-1 threads.           */
+/*  In/out   :                                                              */
+/*  Return   : AVCENC_SUCCESS if successed, AVCENC_MEMORY_FAIL if failed.   */
+/*  Modified :                                                              */
+/* ======================================================================== */
+AVCEnc_Status InitSliceThreads(AVCHandle *avcHandle, int numSlice, int numThread)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCCommonObj *video = encvid->common;
+    void *userData = avcHandle->userData;
+    AVCEncSliceThreads *threads;
+    AVCEncSlice *slice;
+    int mbheight = video->PicHeightInMbs;
+    int k;
+
+    if (numSlice > mbheight)
+    {
+        numSlice = mbheight;
+    }
+    if (numThread > numSlice)
+    {
+        numThread = numSlice;
+    }
+    if (numThread < 1)
+    {
+        numThread = 1;
+    }
+
+    threads = (AVCEncSliceThreads*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncSliceThreads), DEFAULT_ATTR);
+    if (threads == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+    memset(threads, 0, sizeof(AVCEncSliceThreads));
+
+    pthread_mutex_init(&threads->mutex, NULL);
+    pthread_cond_init(&threads->startCond, NULL);
+    pthread_cond_init(&threads->doneCond, NULL);
+
+    threads->encvid = encvid;
+    threads->numThread = 1; /* the calling thread */
+    /* from now on CleanSliceThreads() undoes whatever has been done */
+    encvid->sliceThreads = threads;
+
+    threads->slice = (AVCEncSlice*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncSlice) * numSlice, DEFAULT_ATTR);
+    if (threads->slice == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+    memset(threads->slice, 0, sizeof(AVCEncSlice) * numSlice);
+    threads->numSlice = numSlice;
+
+    for (k = 0; k < numSlice; k++)
+    {
+        slice = &threads->slice[k];
+        slice->firstMbRow = k * mbheight / numSlice;
+        slice->endMbRow = (k + 1) * mbheight / numSlice;
+
+        /* initial guess of the NAL size, the buffer grows as needed */
+        slice->buf_size = (slice->endMbRow - slice->firstMbRow) * video->PicWidthInMbs * 64;
+        if (slice->buf_size < 1024)
+        {
+            slice->buf_size = 1024;
+        }
+        slice->buffer = (uint8*) avcHandle->CBAVC_Malloc(userData, slice->buf_size, DEFAULT_ATTR);
+        if (slice->buffer == NULL)
+        {
+            return AVCENC_MEMORY_FAIL;
+        }
+    }
+
+    if (numThread > 1)
+    {
+        threads->thread = (pthread_t*) avcHandle->CBAVC_Malloc(userData, sizeof(pthread_t) * (numThread - 1), DEFAULT_ATTR);
+        if (threads->thread == NULL)
+        {
+            return AVCENC_MEMORY_FAIL;
+        }
+
+        for (k = 0; k < numThread - 1; k++)
+        {
+            if (pthread_create(&threads->thread[k], NULL, SliceThreadLoop, threads))
+            {
+                return AVCENC_MEMORY_FAIL;
+            }
+            threads->numThread++;
+        }
+    }
+
+    return AVCENC_SUCCESS;
+}
+
+/* ======================================================================== */
+/*  Function : CleanSliceThreads()                                          */
+/*  Purpose  : Stop the threads and free the slices.                        */
+/*  In/out   :                                                              */
+/*  Return   :                                                              */
+/*  Modified :                                                              */
+/* ======================================================================== */
+void CleanSliceThreads(AVCHandle *avcHandle)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCEncSliceThreads *threads = encvid->sliceThreads;
+    void *userData = avcHandle->userData;
+    int k;
+
+    if (threads == NULL)
+    {
+        return ;
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    threads->quit = true;
+    pthread_cond_broadcast(&threads->startCond);
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (k = 0; k < threads->numThread - 1; k++)
+    {
+        pthread_join(threads->thread[k], NULL);
+    }
+
+    pthread_cond_destroy(&threads->doneCond);
+    pthread_cond_destroy(&threads->startCond);
+    pthread_mutex_destroy(&threads->mutex);
+
+    if (threads->thread)
+    {
+        avcHandle->CBAVC_Free(userData, threads->thread);
+    }
+
+    if (threads->slice)
+    {
+        for (k = 0; k < threads->numSlice; k++)
+        {
+            if (threads->slice[k].buffer)
+            {
+                avcHandle->CBAVC_Free(userData, threads->slice[k].buffer);
+            }
+        }
+        avcHandle->CBAVC_Free(userData, threads->slice);
+    }
+
+    avcHandle->CBAVC_Free(userData, threads);
+    encvid->sliceThreads = NULL;
+
+    return ;
+}
+
+/* encode one slice into its own buffer, used as overrun buffer as well so that it grows
+   when the NAL doesn't fit. */
+static void EncodeSliceNAL(AVCEncSlice *slice)
+{
+    AVCEncObject *encvid = &slice->encvid;
+    AVCCommonObj *video = &slice->video;
+    AVCEncBitstream *stream = &slice->bitstream;
+    AVCEnc_Status status;
+    uint nal_size;
+
+    encvid->overrunBuffer = slice->buffer;
+    encvid->oBSize = slice->buf_size;
+
+    status = BitstreamEncInit(stream, slice->buffer, slice->buf_size, slice->buffer, slice->buf_size);
+    stream->encvid = encvid;
+
+    if (status == AVCENC_SUCCESS)
+    {
+        status = BitstreamWriteBits(stream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
+    }
+
+    video->mbNum = slice->firstMbRow * video->PicWidthInMbs;
+
+    if (status == AVCENC_SUCCESS)
+    {
+        status = InitSlice(encvid);
+    }
+    if (status == AVCENC_SUCCESS)
+    {
+        status = EncodeSliceHeader(encvid, stream);
+    }
+    if (status == AVCENC_SUCCESS)
+    {
+        status = AVCEncodeSlice(encvid);
+        /* the last slice of the picture returns AVCENC_PICTURE_READY */
+        if (status == AVCENC_SUCCESS || status == AVCENC_PICTURE_READY)
+        {
+            status = BitstreamTrailingBits(stream, &nal_size);
+        }
+    }
+
+    /* the buffer has been reallocated if the NAL didn't fit */
+    slice->buffer = stream->overrunBuffer;
+    if (stream->overrunBuffer == encvid->overrunBuffer)
+    {
+        slice->buf_size = encvid->oBSize;
+    }
+
+    slice->status = status;
+
+    return ;
+}
+
+/* run the current job on slice k */
+static void RunJobOnSlice(AVCEncSliceThreads *threads, int k)
+{
+    AVCEncObject *encvid = threads->encvid;
+    AVCEncSlice *slice = &threads->slice[k];
+    uint8 **cand;
+    int offset, i;
+
+    /* private copies of the main objects, pointing to each other */
+    slice->encvid = *encvid;
+    slice->video = *encvid->common;
+    slice->sliceHdr = *encvid->common->sliceHdr;
+    slice->rateCtrl = *encvid->rateCtrl;
+
+    slice->encvid.common = &slice->video;
+    slice->encvid.bitstream = &slice->bitstream;
+    slice->encvid.rateCtrl = &slice->rateCtrl;
+    slice->encvid.sliceThreads = NULL;
+    slice->encvid.firstMbRow = slice->firstMbRow;
+    slice->encvid.endMbRow = slice->endMbRow;
+    slice->encvid.chromaPadded = true; /* see AVCEncodeSliceThreaded() */
+    slice->video.sliceHdr = &slice->sliceHdr;
+    slice->video.slice_id = encvid->common->slice_id + k;
+
+    /* the sub-pel search pointers have to point into the copy's own scratch memory */
+    offset = (uint8*) slice->encvid.subpel_pred - (uint8*) encvid->subpel_pred;
+    cand = slice->encvid.hpel_cand;
+    for (i = 0; i < 9; i++)
+    {
+        cand[i] += offset;
+    }
+    cand = &slice->encvid.bilin_base[0][0];
+    for (i = 0; i < 36; i++)
+    {
+        if (cand[i])
+        {
+            cand[i] += offset;
+        }
+    }
+
+    switch (threads->job)
+    {
+        case AVC_SLICE_MOTION_EST:
+            slice->totalSAD = 0;
+            slice->numIntraSearch = 0;
+            AVCMotionEstimationRows(&slice->encvid, threads->start_i, threads->incr_i,
+                                    threads->type_pred, &slice->totalSAD, &slice->numIntraSearch);
+            break;
+        case AVC_SLICE_ENCODE:
+            EncodeSliceNAL(slice);
+            break;
+    }
+
+    return ;
+}
+
+/* pick up slices of the current job until there are none left, called with the mutex held */
+static void WorkOnSlices(AVCEncSliceThreads *threads)
+{
+    int k;
+
+    while (threads->nextSlice < threads->numSlice)
+    {
+        k = threads->nextSlice++;
+        threads->numBusy++;
+        pthread_mutex_unlock(&threads->mutex);
+
+        RunJobOnSlice(threads, k);
+
+        pthread_mutex_lock(&threads->mutex);
+        threads->numBusy--;
+    }
+
+    return ;
+}
+
+/* ======================================================================== */
+/*  Function : RunSliceJob()                                                */
+/*  Purpose  : Run a job on all the slices, the calling thread works on     */
+/*             them as well.                                                */
+/*  In/out   :                                                              */
+/*  Return   :                                                              */
+/*  Modified :                                                              */
+/* ======================================================================== */
+void RunSliceJob(AVCEncSliceThreads *threads, AVCSliceJob job)
+{
+    pthread_mutex_lock(&threads->mutex);
+
+    threads->job = job;
+    threads->nextSlice = 0;
+    threads->jobCount++;
+    pthread_cond_broadcast(&threads->startCond);
+
+    WorkOnSlices(threads);
+
+    while (threads->numBusy > 0)
+    {
+        pthread_cond_wait(&threads->doneCond, &threads->mutex);
+    }
+
+    pthread_mutex_unlock(&threads->mutex);
+
+    return ;
+}
+
+static void *SliceThreadLoop(void *arg)
+{
+    AVCEncSliceThreads *threads = (AVCEncSliceThreads*) arg;
+    int jobCount = 0; /* the threads are started before any job */
+
+    pthread_mutex_lock(&threads->mutex);
+
+    while (!threads->quit)
+    {
+        if (threads->jobCount == jobCount)
+        {
+            pthread_cond_wait(&threads->startCond, &threads->mutex);
+            continue;
+        }
+
+        jobCount = threads->jobCount;
+        WorkOnSlices(threads);
+        pthread_cond_signal(&threads->doneCond);
+    }
+
+    pthread_mutex_unlock(&threads->mutex);
+
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  Function : AVCEncodeSliceThreaded()                                     */
+/*  Purpose  : Encode all the slices of the picture on the first call and   */
+/*             output one slice NAL per call.                               */
+/*  In/out   :                                                              */
+/*  Return   : AVCENC_SUCCESS, AVCENC_PICTURE_READY after the last slice.   */
+/*  Modified :                                                              */
+/* ======================================================================== */
+AVCEnc_Status AVCEncodeSliceThreaded(AVCEncObject *encvid, AVCEncBitstream *stream)
+{
+    AVCCommonObj *video = encvid->common;
+    AVCRateControl *rateCtrl = encvid->rateCtrl;
+    AVCEncSliceThreads *threads = encvid->sliceThreads;
+    AVCEncSlice *slice;
+    AVCEnc_Status status;
+    int numIntraMB, numHeaderBits, numTextureBits;
+    int k, mbnum;
+
+    if (encvid->currSlice == 0)
+    {
+        /* slice header and deblocking parameters of the picture */
+        status = InitSlice(encvid);
+        if (status != AVCENC_SUCCESS)
+        {
+            return status;
+        }
+
+        /* the chroma motion compensation pads the reference edges as needed, which the
+           slices can't do concurrently, pad them all at once */
+        if (video->slice_type == AVC_P_SLICE)
+        {
+            for (k = 0; k < video->refList0Size; k++)
+            {
+                AVCPaddingEdgeChroma(video->RefPicList0[k]);
+            }
+        }
+
+        /* the slice ids are read across the slice boundaries by the neighbor availability
+           check, set them before any slice starts */
+        for (k = 0; k < threads->numSlice; k++)
+        {
+            slice = &threads->slice[k];
+            for (mbnum = slice->firstMbRow * video->PicWidthInMbs;
+                    mbnum < slice->endMbRow * (int)video->PicWidthInMbs; mbnum++)
+            {
+                video->mblock[mbnum].slice_id = video->slice_id + k;
+            }
+        }
+
+        RunSliceJob(threads, AVC_SLICE_ENCODE);
+
+        for (k = 0; k < threads->numSlice; k++)
+        {
+            if (threads->slice[k].status != AVCENC_SUCCESS)
+            {
+                return threads->slice[k].status;
+            }
+        }
+
+        /* each slice started from the counters of the main objects, add what it counted */
+        numIntraMB = encvid->numIntraMB;
+        numHeaderBits = rateCtrl->NumberofHeaderBits;
+        numTextureBits = rateCtrl->NumberofTextureBits;
+        for (k = 0; k < threads->numSlice; k++)
+        {
+            slice = &threads->slice[k];
+            encvid->numIntraMB += slice->encvid.numIntraMB - numIntraMB;
+            rateCtrl->NumberofHeaderBits += slice->rateCtrl.NumberofHeaderBits - numHeaderBits;
+            rateCtrl->NumberofTextureBits += slice->rateCtrl.NumberofTextureBits - numTextureBits;
+        }
+
+        video->slice_id += threads->numSlice;
+    }
+
+    slice = &threads->slice[encvid->currSlice];
+    status = BitstreamCopyNAL(stream, slice->bitstream.bitstreamBuffer, slice->bitstream.write_pos);
+    if (status != AVCENC_SUCCESS)
+    {
+        return status;
+    }
+
+    encvid->currSlice++;
+    if (encvid->currSlice < threads->numSlice)
+    {
+        return AVCENC_SUCCESS;
+    }
+
+    encvid->currSlice = 0;
+
+    return AVCENC_PICTURE_READY;
+}
+
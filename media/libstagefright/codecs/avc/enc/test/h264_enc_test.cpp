@@ -30,16 +30,17 @@
 #include <stdint.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "avcenc_api.h"
 #include "avcenc_int.h"
 
 // Constants.
 enum {
-    kMaxWidth         = 720,
-    kMaxHeight        = 480,
+    kMaxWidth         = 1920,
+    kMaxHeight        = 1088,
     kMaxFrameRate     = 30,
-    kMaxBitrate       = 2048, // in kbps.
+    kMaxBitrate       = 20480, // in kbps.
     kInputBufferSize  = (kMaxWidth * kMaxHeight * 3) / 2, // For YUV 420 format.
     kOutputBufferSize = kInputBufferSize,
     kMaxDpbBuffers    = 17,
@@ -47,6 +48,12 @@ enum {
 };
 
 
+static int64_t GetNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 static void *MallocCb(void * /*userData*/, int32_t size, int32_t /*attrs*/) {
     void *ptr = calloc(size, 1);
     return ptr;
@@ -81,7 +88,7 @@ int main(int argc, char *argv[]) {
 
     if (argc < 7) {
         fprintf(stderr, "Usage %s <input yuv> <output file> <width> <height>"
-                        " <frame rate> <bitrate in kbps>\n", argv[0]);
+                        " <frame rate> <bitrate in kbps> [<slices> [<threads>]]\n", argv[0]);
         fprintf(stderr, "Max width %d\n", kMaxWidth);
         fprintf(stderr, "Max height %d\n", kMaxHeight);
         fprintf(stderr, "Max framerate %d\n", kMaxFrameRate);
@@ -122,6 +129,15 @@ int main(int argc, char *argv[]) {
     }
     bitrate *= 1024; // kbps to bps.
 
+    // Read the number of slices per picture and of threads encoding them.
+    int32_t numSlices = (argc > 7) ? atoi(argv[7]) : 1;
+    int32_t numThreads = (argc > 8) ? atoi(argv[8]) : numSlices;
+    if (numSlices <= 0 || numThreads <= 0) {
+        fprintf(stderr, "Unsupported number of slices %d or threads %d\n",
+            numSlices, numThreads);
+        return EXIT_FAILURE;
+    }
+
     // Open the input file.
     FILE *fpInput = fopen(argv[1], "rb");
     if (!fpInput) {
@@ -215,8 +231,10 @@ int main(int argc, char *argv[]) {
         }
     }
     encParams.slice_group = sliceGroup;
+    encParams.num_slice = numSlices;
+    encParams.num_thread = numThreads;
     encParams.profile = AVC_BASELINE;
-    encParams.level = AVC_LEVEL2;
+    encParams.level = (AVCLevel)0;  // Let the encoder pick the lowest level.
 
     // Initialize the handle.
     tagAVCHandle handle;
@@ -268,6 +286,9 @@ int main(int argc, char *argv[]) {
     int32_t numInputFrames = 0;
     int32_t numNalEncoded = 0;
     bool readyForNextFrame = true;
+    // The encoder keeps a pointer to the input frame until it is encoded.
+    AVCFrameIO vin;
+    int64_t encodeTimeNs = 0;
 
     while (1) {
         if (readyForNextFrame == true) {
@@ -279,7 +300,6 @@ int main(int argc, char *argv[]) {
             }
 
             // Set the input frame.
-            AVCFrameIO vin;
             memset(&vin, 0, sizeof(vin));
             vin.height = ((height + 15) >> 4) << 4;
             vin.pitch  = ((width  + 15) >> 4) << 4;
@@ -289,7 +309,9 @@ int main(int argc, char *argv[]) {
             vin.YCbCr[2] = vin.YCbCr[1] + ((vin.height * vin.pitch) >> 2);
             vin.disp_order = numInputFrames;
 
+            int64_t startNs = GetNowNs();
             status = PVAVCEncSetInput(&handle, &vin);
+            encodeTimeNs += GetNowNs() - startNs;
             if (status == AVCENC_SUCCESS || status == AVCENC_NEW_IDR) {
                 readyForNextFrame = false;
                 ++numInputFrames;
@@ -307,7 +329,9 @@ int main(int argc, char *argv[]) {
 
         // Encode the input frame.
         dataLength = kOutputBufferSize;
+        int64_t startNs = GetNowNs();
         status = PVAVCEncodeNAL(&handle, outputBuf, &dataLength, &type);
+        encodeTimeNs += GetNowNs() - startNs;
         if (status == AVCENC_SUCCESS) {
             PVAVCEncGetOverrunBuffer(&handle);
         } else if (status == AVCENC_PICTURE_READY) {
@@ -338,6 +362,11 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (encodeTimeNs > 0) {
+        printf("Encoded %d frames in %.3f s, %.2f fps\n", numInputFrames,
+                encodeTimeNs / 1E9, numInputFrames * 1E9 / encodeTimeNs);
+    }
+
     // Close input and output file.
     fclose(fpInput);
     fclose(fpOutput);
@@ -171,6 +171,10 @@
 #include    "mp4dec_lib.h"
 #include    "post_proc.h"
 #include    "mp4def.h"
+#if defined(__SSE2__)
+#include    <emmintrin.h>
+#include    <string.h>
+#endif
 
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 
@@ -209,6 +213,108 @@
 /*----------------------------------------------------------------------------
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
+#if defined(__SSE2__)
+/* Load the ncols+2 pixels of a row used to filter ncols pixels, only those
+   pixels are read from the frame. */
+static inline __m128i LoadSmoothRow(uint8 *ptr, int ncols)
+{
+    uint8 tmp[16] = {0};
+
+    if (ncols == BLKSIZE)
+    {
+        return _mm_insert_epi16(_mm_loadl_epi64((__m128i *)ptr), ptr[8] | (ptr[9] << 8), 4);
+    }
+    memcpy(tmp, ptr, ncols + 2);
+    return _mm_loadu_si128((__m128i *)tmp);
+}
+
+/* The filter only uses the original values of the pixels, the rows are
+   filtered eight pixels at a time keeping the rows above and below in
+   registers. */
+void AdaptiveSmooth_NoMMX(
+    uint8 *Rec_Y,       /* i/o  */
+    int y_start,        /* i    */
+    int x_start,        /* i    */
+    int y_blk_start,    /* i    */
+    int x_blk_start,    /* i    */
+    int thr,        /* i    */
+    int width,      /* i    */
+    int max_diff        /* i    */
+)
+{
+    uint8 tmp[16];
+    uint8 *Rec_Y_ptr;
+    int ncols, row_cntr;
+    __m128i zero, thr8, nine, round, diff;
+    __m128i pelu, pelc, pell, signu, signc, signl;
+    __m128i sign, cond, sum_lo, sum_hi, sum, pel, res;
+
+    ncols = (x_blk_start + BLKSIZE - 1) - x_start; /* pixels filtered in a row */
+    Rec_Y_ptr = &Rec_Y[(int32)y_start * width + x_start];
+
+    zero = _mm_setzero_si128();
+    thr8 = _mm_set1_epi8((char)thr);
+    nine = _mm_set1_epi8(-9);
+    round = _mm_set1_epi16(8);
+    diff = _mm_set1_epi16(max_diff);
+
+    /* -1 for the pixels above or equal to thr, 0 for the others */
+    pelu = LoadSmoothRow(Rec_Y_ptr, ncols);
+    signu = _mm_cmpeq_epi8(_mm_max_epu8(pelu, thr8), pelu);
+    Rec_Y_ptr += width;
+    pelc = LoadSmoothRow(Rec_Y_ptr, ncols);
+    signc = _mm_cmpeq_epi8(_mm_max_epu8(pelc, thr8), pelc);
+
+    for (row_cntr = (y_blk_start + BLKSIZE - 1) - y_start; row_cntr > 0; row_cntr--)
+    {
+        pell = LoadSmoothRow(Rec_Y_ptr + width, ncols);
+        signl = _mm_cmpeq_epi8(_mm_max_epu8(pell, thr8), pell);
+
+        /* minus the number of the 9 pixels above or equal to thr */
+        sign = _mm_add_epi8(_mm_add_epi8(signu, signc), signl);
+        sign = _mm_add_epi8(_mm_add_epi8(sign, _mm_srli_si128(sign, 1)), _mm_srli_si128(sign, 2));
+        cond = _mm_or_si128(_mm_cmpeq_epi8(sign, zero), _mm_cmpeq_epi8(sign, nine));
+        cond = _mm_unpacklo_epi8(cond, cond);
+
+        /* weighted sums of pelu, pelc and pell */
+        sum_lo = _mm_add_epi16(_mm_unpacklo_epi8(pelu, zero), _mm_unpacklo_epi8(pell, zero));
+        sum_lo = _mm_add_epi16(sum_lo, _mm_slli_epi16(_mm_unpacklo_epi8(pelc, zero), 1));
+        sum_hi = _mm_add_epi16(_mm_unpackhi_epi8(pelu, zero), _mm_unpackhi_epi8(pell, zero));
+        sum_hi = _mm_add_epi16(sum_hi, _mm_slli_epi16(_mm_unpackhi_epi8(pelc, zero), 1));
+
+        /* weighted average of the 9 pixels */
+        sum = _mm_add_epi16(sum_lo, round);
+        sum = _mm_add_epi16(sum, _mm_or_si128(_mm_srli_si128(sum_lo, 4), _mm_slli_si128(sum_hi, 12)));
+        sum = _mm_add_epi16(sum, _mm_slli_epi16(_mm_or_si128(_mm_srli_si128(sum_lo, 2), _mm_slli_si128(sum_hi, 14)), 1));
+        sum = _mm_srli_epi16(sum, 4);
+
+        /* limit the change to max_diff */
+        pel = _mm_unpacklo_epi8(_mm_srli_si128(pelc, 1), zero);
+        sum = _mm_max_epi16(sum, _mm_sub_epi16(pel, diff));
+        sum = _mm_min_epi16(sum, _mm_add_epi16(pel, diff));
+
+        res = _mm_or_si128(_mm_and_si128(cond, sum), _mm_andnot_si128(cond, pel));
+        res = _mm_packus_epi16(res, res);
+        if (ncols == BLKSIZE)
+        {
+            _mm_storel_epi64((__m128i *)(Rec_Y_ptr + 1), res);
+        }
+        else
+        {
+            _mm_storel_epi64((__m128i *)tmp, res);
+            memcpy(Rec_Y_ptr + 1, tmp, ncols);
+        }
+
+        pelu = pelc;
+        signu = signc;
+        pelc = pell;
+        signc = signl;
+        Rec_Y_ptr += width;
+    }
+
+    return;
+}
+#else /* __SSE2__ */
 void AdaptiveSmooth_NoMMX(
     uint8 *Rec_Y,       /* i/o  */
     int y_start,        /* i    */
@@ -418,4 +524,5 @@ void AdaptiveSmooth_NoMMX(
     ----------------------------------------------------------------------------*/
     return;
 }
+#endif /* __SSE2__ */
 #endif
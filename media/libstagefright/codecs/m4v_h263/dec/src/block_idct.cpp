@@ -102,6 +102,9 @@
 #include "mp4dec_lib.h"
 #include "idct.h"
 #include "motion_comp.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 /*----------------------------------------------------------------------------
@@ -199,6 +202,194 @@ static void (*const idctrowVCA2_intra[8])(int16*, PIXEL *, int) =
     &idctrow1_intra, &idctrow4_intra, &idctrow3_intra, &idctrow4_intra,
     &idctrow2_intra, &idctrow4_intra, &idctrow3_intra, &idctrow4_intra
 };
+
+#if defined(__SSE2__)
+/* x * C in 32-bit lanes for 0 <= C < 0x8000, c = _mm_set1_epi16(C). Wraps
+   the same way as the 32-bit multiply of the C code. */
+static inline __m128i mul32c(__m128i x, __m128i c)
+{
+    return _mm_add_epi32(_mm_mullo_epi16(x, c), _mm_slli_epi32(_mm_mulhi_epu16(x, c), 16));
+}
+
+/* int16 of the 32-bit lanes, i.e. the low 16 bits like an int16 store */
+static inline __m128i pack_trunc32(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+static inline void transpose8x8_epi16(__m128i *x)
+{
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_unpacklo_epi16(x[0], x[1]);
+    a1 = _mm_unpackhi_epi16(x[0], x[1]);
+    a2 = _mm_unpacklo_epi16(x[2], x[3]);
+    a3 = _mm_unpackhi_epi16(x[2], x[3]);
+    a4 = _mm_unpacklo_epi16(x[4], x[5]);
+    a5 = _mm_unpackhi_epi16(x[4], x[5]);
+    a6 = _mm_unpacklo_epi16(x[6], x[7]);
+    a7 = _mm_unpackhi_epi16(x[6], x[7]);
+
+    b0 = _mm_unpacklo_epi32(a0, a2);
+    b1 = _mm_unpackhi_epi32(a0, a2);
+    b2 = _mm_unpacklo_epi32(a1, a3);
+    b3 = _mm_unpackhi_epi32(a1, a3);
+    b4 = _mm_unpacklo_epi32(a4, a6);
+    b5 = _mm_unpackhi_epi32(a4, a6);
+    b6 = _mm_unpacklo_epi32(a5, a7);
+    b7 = _mm_unpackhi_epi32(a5, a7);
+
+    x[0] = _mm_unpacklo_epi64(b0, b4);
+    x[1] = _mm_unpackhi_epi64(b0, b4);
+    x[2] = _mm_unpacklo_epi64(b1, b5);
+    x[3] = _mm_unpackhi_epi64(b1, b5);
+    x[4] = _mm_unpacklo_epi64(b2, b6);
+    x[5] = _mm_unpackhi_epi64(b2, b6);
+    x[6] = _mm_unpacklo_epi64(b3, b7);
+    x[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* 8-point IDCT of 4 vectors at once, the same steps as idctcol() or, with
+   row set, as idctrow()/idctrow_intra() without the clipping. */
+static inline void idct8_epi32(__m128i *x, int row)
+{
+    const __m128i cW7 = _mm_set1_epi16(W7);
+    const __m128i cW1mW7 = _mm_set1_epi16(W1 - W7);
+    const __m128i cW1pW7 = _mm_set1_epi16(W1 + W7);
+    const __m128i cW3 = _mm_set1_epi16(W3);
+    const __m128i cW3mW5 = _mm_set1_epi16(W3 - W5);
+    const __m128i cW3pW5 = _mm_set1_epi16(W3 + W5);
+    const __m128i cW6 = _mm_set1_epi16(W6);
+    const __m128i cW2pW6 = _mm_set1_epi16(W2 + W6);
+    const __m128i cW2mW6 = _mm_set1_epi16(W2 - W6);
+    const __m128i c181 = _mm_set1_epi16(181);
+    const __m128i r128 = _mm_set1_epi32(128);
+    const __m128i r4 = _mm_set1_epi32(row ? 4 : 0);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    if (row)
+    {
+        x1 = _mm_slli_epi32(x[4], 8);
+        x0 = _mm_add_epi32(_mm_slli_epi32(x[0], 8), _mm_set1_epi32(8192));
+    }
+    else
+    {
+        x1 = _mm_slli_epi32(x[4], 11);
+        x0 = _mm_add_epi32(_mm_slli_epi32(x[0], 11), r128);
+    }
+    x2 = x[6];
+    x3 = x[2];
+    x4 = x[1];
+    x5 = x[7];
+    x6 = x[5];
+    x7 = x[3];
+
+    /* first stage */
+    x8 = _mm_add_epi32(mul32c(_mm_add_epi32(x4, x5), cW7), r4);
+    x4 = _mm_add_epi32(x8, mul32c(x4, cW1mW7));
+    x5 = _mm_sub_epi32(x8, mul32c(x5, cW1pW7));
+    x8 = _mm_add_epi32(mul32c(_mm_add_epi32(x6, x7), cW3), r4);
+    x6 = _mm_sub_epi32(x8, mul32c(x6, cW3mW5));
+    x7 = _mm_sub_epi32(x8, mul32c(x7, cW3pW5));
+    if (row)
+    {
+        x4 = _mm_srai_epi32(x4, 3);
+        x5 = _mm_srai_epi32(x5, 3);
+        x6 = _mm_srai_epi32(x6, 3);
+        x7 = _mm_srai_epi32(x7, 3);
+    }
+
+    /* second stage */
+    x8 = _mm_add_epi32(x0, x1);
+    x0 = _mm_sub_epi32(x0, x1);
+    x1 = _mm_add_epi32(mul32c(_mm_add_epi32(x3, x2), cW6), r4);
+    x2 = _mm_sub_epi32(x1, mul32c(x2, cW2pW6));
+    x3 = _mm_add_epi32(x1, mul32c(x3, cW2mW6));
+    if (row)
+    {
+        x2 = _mm_srai_epi32(x2, 3);
+        x3 = _mm_srai_epi32(x3, 3);
+    }
+    x1 = _mm_add_epi32(x4, x6);
+    x4 = _mm_sub_epi32(x4, x6);
+    x6 = _mm_add_epi32(x5, x7);
+    x5 = _mm_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm_add_epi32(x8, x3);
+    x8 = _mm_sub_epi32(x8, x3);
+    x3 = _mm_add_epi32(x0, x2);
+    x0 = _mm_sub_epi32(x0, x2);
+    x2 = _mm_srai_epi32(_mm_add_epi32(mul32c(_mm_add_epi32(x4, x5), c181), r128), 8);
+    x4 = _mm_srai_epi32(_mm_add_epi32(mul32c(_mm_sub_epi32(x4, x5), c181), r128), 8);
+
+    /* fourth stage, the final shift is left to the caller */
+    x[0] = _mm_add_epi32(x7, x1);
+    x[1] = _mm_add_epi32(x3, x2);
+    x[2] = _mm_add_epi32(x0, x4);
+    x[3] = _mm_add_epi32(x8, x6);
+    x[4] = _mm_sub_epi32(x8, x6);
+    x[5] = _mm_sub_epi32(x0, x4);
+    x[6] = _mm_sub_epi32(x3, x2);
+    x[7] = _mm_sub_epi32(x7, x1);
+}
+
+/* idctcol() of all 8 columns followed by idctrow_intra() or, with pred
+   set, idctrow(), bit-exact with those. Clears the block. */
+static void BlockIDCT_SSE2(int16 *blk, uint8 *pred, uint8 *dst, int width)
+{
+    __m128i x[8], lo[8], hi[8];
+    const __m128i zero = _mm_setzero_si128();
+    int i;
+
+    /* columns, one row of the block per vector */
+    for (i = 0; i < 8; i++)
+    {
+        x[i] = _mm_loadu_si128((__m128i*)(blk + (i << 3)));
+        lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(x[i], x[i]), 16);
+        hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(x[i], x[i]), 16);
+        _mm_storeu_si128((__m128i*)(blk + (i << 3)), zero);
+    }
+    idct8_epi32(lo, 0);
+    idct8_epi32(hi, 0);
+    for (i = 0; i < 8; i++)
+    {
+        x[i] = pack_trunc32(_mm_srai_epi32(lo[i], 8), _mm_srai_epi32(hi[i], 8));
+    }
+
+    /* rows, one column of the block per vector */
+    transpose8x8_epi16(x);
+    for (i = 0; i < 8; i++)
+    {
+        lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(x[i], x[i]), 16);
+        hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(x[i], x[i]), 16);
+    }
+    idct8_epi32(lo, 1);
+    idct8_epi32(hi, 1);
+    for (i = 0; i < 8; i++)
+    {
+        /* saturating is fine, the result is clipped to [0, 255] anyway */
+        x[i] = _mm_packs_epi32(_mm_srai_epi32(lo[i], 14), _mm_srai_epi32(hi[i], 14));
+    }
+    transpose8x8_epi16(x);
+
+    for (i = 0; i < 8; i++)
+    {
+        if (pred)
+        {
+            x[i] = _mm_adds_epi16(x[i], _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            pred += 16;
+        }
+        _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(x[i], x[i]));
+        dst += width;
+    }
+
+    return ;
+}
+#endif /* __SSE2__ */
 #endif
 
 /*----------------------------------------------------------------------------
@@ -277,6 +468,15 @@ void BlockIDCT_intra(
     }
     else
     {
+#if defined(__SSE2__)
+        /* the general row IDCT, the special cases of idctcol() give the same
+           result as the full one */
+        if ((bitmapcol[4] | bitmapcol[5] | bitmapcol[6] | bitmapcol[7]) != 0)
+        {
+            BlockIDCT_SSE2(coeff_in, NULL, c_comp, width);
+            return;
+        }
+#endif
         i = 8;
         while (i--)
         {
@@ -374,6 +574,15 @@ void BlockIDCT(
     }
     else
     {
+#if defined(__SSE2__)
+        /* the general row IDCT, the special cases of idctcol() give the same
+           result as the full one */
+        if ((bitmapcol[4] | bitmapcol[5] | bitmapcol[6] | bitmapcol[7]) != 0)
+        {
+            BlockIDCT_SSE2(coeff_in, pred, dst, width);
+            return ;
+        }
+#endif
         i = 8;
 
         while (i--)
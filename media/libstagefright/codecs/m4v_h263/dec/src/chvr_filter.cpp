@@ -17,9 +17,209 @@
  */
 #include    "mp4dec_lib.h"
 #include    "post_proc.h"
+#if defined(__SSE2__)
+#include    <emmintrin.h>
+#endif
 
 #ifdef PV_POSTPROC_ON
 
+#if defined(__SSE2__)
+/* The filters below work on the 8 lines across a block edge at once. x[6] holds the
+   pixels right below (or right of) the edge and x[5] the ones above (or left of) it,
+   one pixel of each line per 16 bit lane. Each line only uses its own original pixels,
+   which gives the same result as filtering the lines one after the other. */
+
+/* hard filter, uses x[0] to x[11] and changes x[3] to x[8] */
+static inline void HardFilter_SSE2(__m128i *x, int QP)
+{
+    __m128i a3_0, cond, sum, round, out[6];
+    int k;
+
+    a3_0 = _mm_sub_epi16(x[6], x[5]);
+    a3_0 = _mm_max_epi16(a3_0, _mm_sub_epi16(_mm_setzero_si128(), a3_0));
+    cond = _mm_and_si128(_mm_cmpgt_epi16(a3_0, _mm_set1_epi16(KThH)),
+                         _mm_cmpgt_epi16(_mm_set1_epi16(QP), a3_0));
+    if (_mm_movemask_epi8(cond) == 0)
+    {
+        return;
+    }
+
+    round = _mm_set1_epi16(4);
+    sum = _mm_add_epi16(_mm_add_epi16(x[0], x[1]), _mm_add_epi16(x[2], x[3]));
+    sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_add_epi16(x[4], x[5]), x[6]));
+    out[0] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sum, x[3]), round), 3);
+    for (k = 0; k < 5; k++)
+    {
+        sum = _mm_add_epi16(_mm_sub_epi16(sum, x[k]), x[k + 7]);
+        out[k + 1] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sum, x[k + 4]), round), 3);
+    }
+
+    for (k = 0; k < 6; k++)
+    {
+        x[k + 3] = _mm_or_si128(_mm_and_si128(cond, out[k]), _mm_andnot_si128(cond, x[k + 3]));
+    }
+
+    return;
+}
+
+/* soft filter, uses x[2] to x[9] and changes x[5] and x[6] */
+static inline void SoftFilter_SSE2(__m128i *x, int QP)
+{
+    __m128i zero, a3_0, a3_1, a3_2, A3_0, abs_a3_0, delta, cond;
+
+    zero = _mm_setzero_si128();
+
+    a3_0 = _mm_sub_epi16(x[6], x[5]);
+    cond = _mm_cmpgt_epi16(_mm_max_epi16(a3_0, _mm_sub_epi16(zero, a3_0)), _mm_set1_epi16(KTh));
+
+    /* a3_0 = 5 * a3_0 + 2 * (x[4] - x[7]) */
+    a3_0 = _mm_add_epi16(_mm_add_epi16(a3_0, _mm_slli_epi16(a3_0, 2)),
+                         _mm_slli_epi16(_mm_sub_epi16(x[4], x[7]), 1));
+    abs_a3_0 = _mm_max_epi16(a3_0, _mm_sub_epi16(zero, a3_0));
+    cond = _mm_and_si128(cond, _mm_cmpgt_epi16(_mm_set1_epi16(QP << 3), abs_a3_0));
+    if (_mm_movemask_epi8(cond) == 0)
+    {
+        return;
+    }
+
+    a3_1 = _mm_sub_epi16(x[4], x[3]);
+    a3_1 = _mm_add_epi16(_mm_add_epi16(a3_1, _mm_slli_epi16(a3_1, 2)),
+                         _mm_slli_epi16(_mm_sub_epi16(x[2], x[5]), 1));
+    a3_2 = _mm_sub_epi16(x[8], x[7]);
+    a3_2 = _mm_add_epi16(_mm_add_epi16(a3_2, _mm_slli_epi16(a3_2, 2)),
+                         _mm_slli_epi16(_mm_sub_epi16(x[6], x[9]), 1));
+    a3_1 = _mm_max_epi16(a3_1, _mm_sub_epi16(zero, a3_1));
+    a3_2 = _mm_max_epi16(a3_2, _mm_sub_epi16(zero, a3_2));
+
+    A3_0 = _mm_sub_epi16(abs_a3_0, _mm_min_epi16(a3_1, a3_2));
+    cond = _mm_and_si128(cond, _mm_cmpgt_epi16(A3_0, zero));
+
+    A3_0 = _mm_add_epi16(A3_0, _mm_slli_epi16(A3_0, 2));
+    A3_0 = _mm_srai_epi16(_mm_add_epi16(A3_0, _mm_set1_epi16(32)), 6);
+    a3_0 = _mm_cmpgt_epi16(a3_0, zero);
+    A3_0 = _mm_sub_epi16(_mm_xor_si128(A3_0, a3_0), a3_0); /* -A3_0 where a3_0 > 0 */
+
+    /* move (x[5] - x[6]) / 2 towards 0 up to A3_0 */
+    delta = _mm_srai_epi16(_mm_sub_epi16(x[5], x[6]), 1);
+    a3_1 = _mm_min_epi16(delta, _mm_max_epi16(A3_0, zero));
+    a3_2 = _mm_max_epi16(delta, _mm_min_epi16(A3_0, zero));
+    a3_0 = _mm_cmpgt_epi16(zero, delta);
+    delta = _mm_or_si128(_mm_and_si128(a3_0, a3_2), _mm_andnot_si128(a3_0, a3_1));
+    delta = _mm_and_si128(cond, delta);
+
+    x[5] = _mm_sub_epi16(x[5], delta);
+    x[6] = _mm_add_epi16(x[6], delta);
+
+    return;
+}
+
+/* filter the horizontal edge above ptr, rows first to last are loaded */
+static inline void HorzFilter_SSE2(uint8 *ptr, int width, int QP, int hard)
+{
+    __m128i x[12], zero;
+    int first, last, k;
+
+    zero = _mm_setzero_si128();
+    first = hard ? 0 : 2;
+    last = hard ? 12 : 10;
+    for (k = first; k < last; k++)
+    {
+        x[k] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(ptr + (k - 6) * width)), zero);
+    }
+
+    if (hard)
+    {
+        HardFilter_SSE2(x, QP);
+        first = 3;
+        last = 9;
+    }
+    else
+    {
+        SoftFilter_SSE2(x, QP);
+        first = 5;
+        last = 7;
+    }
+
+    for (k = first; k < last; k++)
+    {
+        _mm_storel_epi64((__m128i *)(ptr + (k - 6) * width), _mm_packus_epi16(x[k], x[k]));
+    }
+
+    return;
+}
+
+/* filter the vertical edge left of ptr, the 8 rows are transposed so that
+   each vector holds a column */
+static inline void VertFilter_SSE2(uint8 *ptr, int width, int QP, int hard)
+{
+    __m128i r[8], a[8], b[8], x[16], zero;
+    int k;
+
+    zero = _mm_setzero_si128();
+    for (k = 0; k < 8; k++)
+    {
+        r[k] = _mm_loadu_si128((__m128i *)(ptr - 8 + k * width));
+    }
+
+    /* columns -8 to 7 of the edge go to x[0] to x[15] */
+    for (k = 0; k < 4; k++)
+    {
+        a[k] = _mm_unpacklo_epi8(r[2 * k], r[2 * k + 1]);
+        a[k + 4] = _mm_unpackhi_epi8(r[2 * k], r[2 * k + 1]);
+    }
+    for (k = 0; k < 8; k += 4)
+    {
+        b[k] = _mm_unpacklo_epi16(a[k], a[k + 1]);
+        b[k + 1] = _mm_unpackhi_epi16(a[k], a[k + 1]);
+        b[k + 2] = _mm_unpacklo_epi16(a[k + 2], a[k + 3]);
+        b[k + 3] = _mm_unpackhi_epi16(a[k + 2], a[k + 3]);
+        a[k] = _mm_unpacklo_epi32(b[k], b[k + 2]);
+        a[k + 1] = _mm_unpackhi_epi32(b[k], b[k + 2]);
+        a[k + 2] = _mm_unpacklo_epi32(b[k + 1], b[k + 3]);
+        a[k + 3] = _mm_unpackhi_epi32(b[k + 1], b[k + 3]);
+    }
+    for (k = 0; k < 8; k++)
+    {
+        x[2 * k] = _mm_unpacklo_epi8(a[k], zero);
+        x[2 * k + 1] = _mm_unpackhi_epi8(a[k], zero);
+    }
+
+    if (hard)
+    {
+        HardFilter_SSE2(x + 2, QP);
+    }
+    else
+    {
+        SoftFilter_SSE2(x + 2, QP);
+    }
+
+    /* columns -4 to 3 back to the rows */
+    for (k = 0; k < 4; k++)
+    {
+        a[k] = _mm_unpacklo_epi16(x[2 * k + 4], x[2 * k + 5]);
+        a[k + 4] = _mm_unpackhi_epi16(x[2 * k + 4], x[2 * k + 5]);
+    }
+    for (k = 0; k < 8; k += 4)
+    {
+        b[k] = _mm_unpacklo_epi32(a[k], a[k + 1]);
+        b[k + 1] = _mm_unpackhi_epi32(a[k], a[k + 1]);
+        b[k + 2] = _mm_unpacklo_epi32(a[k + 2], a[k + 3]);
+        b[k + 3] = _mm_unpackhi_epi32(a[k + 2], a[k + 3]);
+    }
+    for (k = 0; k < 8; k += 4)
+    {
+        a[0] = _mm_packus_epi16(_mm_unpacklo_epi64(b[k], b[k + 2]), _mm_unpackhi_epi64(b[k], b[k + 2]));
+        a[1] = _mm_packus_epi16(_mm_unpacklo_epi64(b[k + 1], b[k + 3]), _mm_unpackhi_epi64(b[k + 1], b[k + 3]));
+        _mm_storel_epi64((__m128i *)(ptr - 4 + (k) * width), a[0]);
+        _mm_storel_epi64((__m128i *)(ptr - 4 + (k + 1) * width), _mm_srli_si128(a[0], 8));
+        _mm_storel_epi64((__m128i *)(ptr - 4 + (k + 2) * width), a[1]);
+        _mm_storel_epi64((__m128i *)(ptr - 4 + (k + 3) * width), _mm_srli_si128(a[1], 8));
+    }
+
+    return;
+}
+#endif /* __SSE2__ */
+
 void CombinedHorzVertRingFilter(
     uint8 *rec,
     int width,
@@ -32,15 +232,20 @@ void CombinedHorzVertRingFilter(
     /*----------------------------------------------------------------------------
     ; Define all local variables
     ----------------------------------------------------------------------------*/
-    int index, counter;
+    int index;
     int br, bc, incr, mbr, mbc;
     int QP = 1;
-    int v[5];
-    uint8 *ptr, *ptr_c, *ptr_n;
-    int w1, w2, w3, w4;
+    uint8 *ptr;
+    int w1;
     int pp_w, pp_h, brwidth;
+#if !defined(__SSE2__)
+    int counter;
+    int v[5];
+    uint8 *ptr_c, *ptr_n;
+    int w2, w3, w4;
     int sum, delta;
     int a3_0, a3_1, a3_2, A3_0;
+#endif
     /* for Deringing Threshold approach (MPEG4)*/
     int max_diff, thres, v0, h0, min_blk, max_blk;
     int cnthflag;
@@ -54,9 +259,11 @@ void CombinedHorzVertRingFilter(
 
     /* Set up various values needed for updating pointers into rec */
     w1 = width;             /* Offset to next row in pixels */
+#if !defined(__SSE2__)
     w2 = width << 1;        /* Offset to two rows in pixels */
     w3 = w1 + w2;           /* Offset to three rows in pixels */
     w4 = w2 << 1;           /* Offset to four rows in pixels */
+#endif
     incr = width - BLKSIZE; /* Offset to next row after processing block */
 
     /* Work through the area hortizontally by two rows per step */
@@ -117,6 +324,9 @@ void CombinedHorzVertRingFilter(
                             /* Set HorzHflag (bit 4) in the pp_mod location */
                             pp_mod[index-pp_w] |= 0x10; /*  4/26/00 reuse pp_mod for HorzHflag*/
 
+#if defined(__SSE2__)
+                            HorzFilter_SSE2(ptr, w1, QP, 1);
+#else /* __SSE2__ */
                             /* Filter across the 8 pixels of the block */
                             for (index = BLKSIZE; index > 0; index--)
                             {
@@ -166,6 +376,7 @@ void CombinedHorzVertRingFilter(
                                 /* Increment pointer to next pixel */
                                 ++ptr;
                             } /* index*/
+#endif /* __SSE2__ */
                         }
                         else
                         { /* soft filter*/
@@ -173,6 +384,9 @@ void CombinedHorzVertRingFilter(
                             /* Clear HorzHflag (bit 4) in the pp_mod location */
                             pp_mod[index-pp_w] &= 0xef; /* reset 1110,1111 */
 
+#if defined(__SSE2__)
+                            HorzFilter_SSE2(ptr, w1, QP, 0);
+#else /* __SSE2__ */
                             for (index = BLKSIZE; index > 0; index--)
                             {
                                 /* Difference between the current pixel and the pixel above it */
@@ -234,6 +448,7 @@ void CombinedHorzVertRingFilter(
                                 /* Increment pointer to next pixel */
                                 ++ptr;
                             } /*index*/
+#endif /* __SSE2__ */
                         } /* Soft filter*/
                     }/* boundary checking*/
                 }/*bc*/
@@ -276,6 +491,9 @@ void CombinedHorzVertRingFilter(
                             /* Set VertHflag (bit 5) in the pp_mod location of previous block*/
                             pp_mod[index-1] |= 0x20; /*  4/26/00 reuse pp_mod for VertHflag*/
 
+#if defined(__SSE2__)
+                            VertFilter_SSE2(ptr, w1, QP, 1);
+#else /* __SSE2__ */
                             /* Filter across the 8 pixels of the block */
                             for (index = BLKSIZE; index > 0; index--)
                             {
@@ -324,12 +542,16 @@ void CombinedHorzVertRingFilter(
                                 /* Increment pointers to next pixel row */
                                 ptr += w1;
                             } /* index*/
+#endif /* __SSE2__ */
                         }
                         else
                         { /* soft filter*/
 
                             /* Clear VertHflag (bit 5) in the pp_mod location */
                             pp_mod[index-1] &= 0xdf; /* reset 1101,1111 */
+#if defined(__SSE2__)
+                            VertFilter_SSE2(ptr, w1, QP, 0);
+#else /* __SSE2__ */
                             for (index = BLKSIZE; index > 0; index--)
                             {
                                 /* Difference between the current pixel and the pixel above it */
@@ -390,6 +612,7 @@ void CombinedHorzVertRingFilter(
                                 }
                                 ptr += w1;
                             } /*index*/
+#endif /* __SSE2__ */
                         } /* Soft filter*/
                     } /* boundary*/
                 } /*bc*/
@@ -93,6 +93,9 @@ found and the location pointed to by max_ptr contains the maximum value found.
 ----------------------------------------------------------------------------*/
 #include    "mp4dec_lib.h"
 #include    "post_proc.h"
+#if defined(__SSE2__)
+#include    <emmintrin.h>
+#endif
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -129,6 +132,39 @@ found and the location pointed to by max_ptr contains the maximum value found.
 /*----------------------------------------------------------------------------
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
+#if defined(__SSE2__)
+void  FindMaxMin(
+    uint8 *input_ptr,
+    int *min_ptr,
+    int *max_ptr,
+    int incr)
+{
+    __m128i row, min, max;
+    int i;
+
+    min = max = _mm_loadl_epi64((__m128i *)input_ptr);
+    for (i = BLKSIZE - 1; i > 0; i--)
+    {
+        input_ptr += BLKSIZE + incr;
+        row = _mm_loadl_epi64((__m128i *)input_ptr);
+        min = _mm_min_epu8(min, row);
+        max = _mm_max_epu8(max, row);
+    }
+
+    /* fold the 8 columns */
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 2));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 2));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 1));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 1));
+
+    *max_ptr = _mm_cvtsi128_si32(max) & 0xFF;
+    *min_ptr = _mm_cvtsi128_si32(min) & 0xFF;
+
+    return;
+}
+#else /* __SSE2__ */
 void  FindMaxMin(
     uint8 *input_ptr,
     int *min_ptr,
@@ -173,4 +209,5 @@ void  FindMaxMin(
     ----------------------------------------------------------------------------*/
     return;
 }
+#endif /* __SSE2__ */
 #endif
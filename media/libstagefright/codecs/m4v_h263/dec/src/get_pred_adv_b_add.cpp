@@ -76,9 +76,133 @@
 ----------------------------------------------------------------------------*/
 #include "mp4dec_lib.h"
 #include "motion_comp.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 
+#if defined(__SSE2__)
+
+/* Unaligned loads are cheap, no need to branch on the alignment of prev.
+   Same rounding as the C versions below. */
+
+int GetPredAdvancedBy0x0(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        _mm_storel_epi64((__m128i*)pred_block, _mm_loadl_epi64((__m128i*)prev));
+        pred_block += pred_width;
+        prev += width;
+    }
+
+    return 1;
+}
+
+/* (a + b + rnd1) >> 1 of 8 pixels */
+static inline __m128i avg2_epu8(__m128i a, __m128i b, int rnd1)
+{
+    __m128i avg = _mm_avg_epu8(a, b); /* (a + b + 1) >> 1 */
+
+    if (rnd1 != 1)
+    {
+        avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+    }
+
+    return avg;
+}
+
+/**************************************************************************/
+int GetPredAdvancedBy0x1(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+    int rnd1 = pred_width_rnd & 1;
+    __m128i a, b;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        a = _mm_loadl_epi64((__m128i*)prev);
+        b = _mm_loadl_epi64((__m128i*)(prev + 1));
+        _mm_storel_epi64((__m128i*)pred_block, avg2_epu8(a, b, rnd1));
+        pred_block += pred_width;
+        prev += width;
+    }
+
+    return 1;
+}
+
+/**************************************************************************/
+int GetPredAdvancedBy1x0(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+    int rnd1 = pred_width_rnd & 1;
+    __m128i a, b;
+
+    a = _mm_loadl_epi64((__m128i*)prev);
+    for (i = B_SIZE; i > 0; i--)
+    {
+        b = _mm_loadl_epi64((__m128i*)(prev += width));
+        _mm_storel_epi64((__m128i*)pred_block, avg2_epu8(a, b, rnd1));
+        a = b;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+/**********************************************************************************/
+int GetPredAdvancedBy1x1(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rnd2 = _mm_set1_epi16((pred_width_rnd & 1) + 1);
+    __m128i a, b, sum;
+
+    /* sum of the two horizontal neighbours of the first line */
+    a = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                      _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+    for (i = B_SIZE; i > 0; i--)
+    {
+        prev += width;
+        b = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                          _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+        sum = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a, b), rnd2), 2);
+        _mm_storel_epi64((__m128i*)pred_block, _mm_packus_epi16(sum, sum));
+        a = b;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+#else /* __SSE2__ */
+
 int GetPredAdvancedBy0x0(
     uint8 *prev,        /* i */
     uint8 *pred_block,      /* i */
@@ -1186,5 +1310,4 @@ int GetPredAdvancedBy1x1(
         return 1;
     }
 }
-
-
+#endif /* __SSE2__ */
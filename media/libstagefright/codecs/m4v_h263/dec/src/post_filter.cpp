@@ -17,11 +17,134 @@
  */
 
 #include    "mp4dec_lib.h"
+#if defined(__SSE2__)
+#include    <emmintrin.h>
+#endif
 
 #ifdef PV_ANNEX_IJKT_SUPPORT
 #include    "motion_comp.h"
 #include "mbtype_mode.h"
 const static int STRENGTH_tab[] = {0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10, 11, 11, 11, 12, 12, 12};
+
+#if defined(__SSE2__)
+/* The Annex J filter on 8 lines across an edge at once. x[0] to x[3] hold the pixels
+   A, B, C and D of each line, one line per 16 bit lane. */
+static inline void DeblockFilter_SSE2(__m128i *x, int strength)
+{
+    __m128i zero, A_D, d, sign, d1, d1_2, d2;
+
+    zero = _mm_setzero_si128();
+
+    A_D = _mm_sub_epi16(x[0], x[3]);
+    d = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(x[2], x[1]), 2), A_D);
+
+    /* |d1| = |d| / 8 ramped down to 0 between strength and 2 * strength */
+    sign = _mm_srai_epi16(d, 15);
+    d1 = _mm_srai_epi16(_mm_max_epi16(d, _mm_sub_epi16(zero, d)), 3);
+    d1 = _mm_min_epi16(d1, _mm_max_epi16(_mm_sub_epi16(_mm_set1_epi16(strength << 1), d1), zero));
+    d1_2 = _mm_srai_epi16(d1, 1);
+    d1 = _mm_sub_epi16(_mm_xor_si128(d1, sign), sign);
+
+    /* |d2| = |A - D| / 4 clipped to |d1| / 2 */
+    sign = _mm_srai_epi16(A_D, 15);
+    d2 = _mm_srai_epi16(_mm_max_epi16(A_D, _mm_sub_epi16(zero, A_D)), 2);
+    d2 = _mm_min_epi16(d2, d1_2);
+    d2 = _mm_sub_epi16(_mm_xor_si128(d2, sign), sign);
+
+    /* A - d2 and D + d2 stay between A and D, B and C are clipped by the packing */
+    x[0] = _mm_sub_epi16(x[0], d2);
+    x[1] = _mm_add_epi16(x[1], d1);
+    x[2] = _mm_sub_epi16(x[2], d1);
+    x[3] = _mm_add_epi16(x[3], d2);
+
+    return;
+}
+
+/* filter the horizontal edge above ptr, n = 8 or 16 pixels wide */
+static inline void DeblockHorzEdge_SSE2(uint8 *ptr, int width, int n, int strength)
+{
+    __m128i x[4], zero;
+    int k;
+
+    zero = _mm_setzero_si128();
+    for (; n > 0; n -= 8)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            x[k] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(ptr + (k - 2) * width)), zero);
+        }
+
+        DeblockFilter_SSE2(x, strength);
+
+        for (k = 0; k < 4; k++)
+        {
+            _mm_storel_epi64((__m128i *)(ptr + (k - 2) * width), _mm_packus_epi16(x[k], x[k]));
+        }
+        ptr += 8;
+    }
+
+    return;
+}
+
+/* filter the vertical edge left of ptr, n = 8 or 16 rows high. The 4 pixels
+   of 8 rows are transposed so that each vector holds a column */
+static inline void DeblockVertEdge_SSE2(uint8 *ptr, int width, int n, int strength)
+{
+    __m128i r[8], x[4], lo, hi, zero;
+    int32 word;
+    int k;
+
+    zero = _mm_setzero_si128();
+    for (; n > 0; n -= 8)
+    {
+        for (k = 0; k < 8; k++)
+        {
+            oscl_memcpy(&word, ptr - 2 + k * width, 4);
+            r[k] = _mm_cvtsi32_si128(word);
+        }
+
+        /* rows 0 to 3 in lo and 4 to 7 in hi, 4 bytes each */
+        lo = _mm_unpacklo_epi64(_mm_unpacklo_epi32(r[0], r[1]), _mm_unpacklo_epi32(r[2], r[3]));
+        hi = _mm_unpacklo_epi64(_mm_unpacklo_epi32(r[4], r[5]), _mm_unpacklo_epi32(r[6], r[7]));
+
+        /* to the columns A and B in lo and C and D in hi, 8 bytes each */
+        r[0] = _mm_unpacklo_epi8(lo, hi);
+        r[1] = _mm_unpackhi_epi8(lo, hi);
+        r[2] = _mm_unpacklo_epi8(r[0], r[1]);
+        r[3] = _mm_unpackhi_epi8(r[0], r[1]);
+        lo = _mm_unpacklo_epi8(r[2], r[3]);
+        hi = _mm_unpackhi_epi8(r[2], r[3]);
+
+        x[0] = _mm_unpacklo_epi8(lo, zero);
+        x[1] = _mm_unpackhi_epi8(lo, zero);
+        x[2] = _mm_unpacklo_epi8(hi, zero);
+        x[3] = _mm_unpackhi_epi8(hi, zero);
+
+        DeblockFilter_SSE2(x, strength);
+
+        /* and back to the rows */
+        lo = _mm_packus_epi16(x[0], x[1]);
+        hi = _mm_packus_epi16(x[2], x[3]);
+        r[0] = _mm_unpacklo_epi8(lo, hi);
+        r[1] = _mm_unpackhi_epi8(lo, hi);
+        lo = _mm_unpacklo_epi8(r[0], r[1]);
+        hi = _mm_unpackhi_epi8(r[0], r[1]);
+
+        for (k = 0; k < 4; k++)
+        {
+            word = _mm_cvtsi128_si32(lo);
+            oscl_memcpy(ptr - 2 + k * width, &word, 4);
+            word = _mm_cvtsi128_si32(hi);
+            oscl_memcpy(ptr - 2 + (k + 4) * width, &word, 4);
+            lo = _mm_srli_si128(lo, 4);
+            hi = _mm_srli_si128(hi, 4);
+        }
+        ptr += 8 * width;
+    }
+
+    return;
+}
+#endif /* __SSE2__ */
 #endif
 
 #ifdef PV_POSTPROC_ON
@@ -183,11 +306,16 @@ void H263_Deblock(uint8 *rec,
     /*----------------------------------------------------------------------------
     ; Define all local variables
     ----------------------------------------------------------------------------*/
-    int i, j, k;
+    int i, j;
     uint8 *rec_y;
+    int mbnum, strength, b_size;
+    int offset, nMBPerRow, nMBPerCol;
+#if !defined(__SSE2__)
+    int k;
     int tmpvar;
-    int mbnum, strength, A_D, d1_2, d1, d2, A, B, C, D, b_size;
-    int d, offset, nMBPerRow, nMBPerCol, width2 = (width << 1);
+    int A_D, d1_2, d1, d2, A, B, C, D;
+    int d, width2 = (width << 1);
+#endif
     /* MAKE SURE I-VOP INTRA MACROBLOCKS ARE SET TO NON-SKIPPED MODE*/
     mbnum = 0;
 
@@ -216,8 +344,12 @@ void H263_Deblock(uint8 *rec,
             {
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
-                    k = 16;
                     strength = STRENGTH_tab[QP_store[mbnum]];
+#if defined(__SSE2__)
+                    DeblockHorzEdge_SSE2(rec_y, width, 16, strength);
+                    rec_y += 16;
+#else /* __SSE2__ */
+                    k = 16;
                     while (k--)
                     {
                         A =  *(rec_y - width2);
@@ -281,6 +413,7 @@ void H263_Deblock(uint8 *rec,
                         *(rec_y + width) = D + d2;
                         rec_y++;
                     }
+#endif /* __SSE2__ */
                 }
                 else
                 {
@@ -305,7 +438,6 @@ void H263_Deblock(uint8 *rec,
         {
             if (mode[mbnum] != MODE_SKIPPED || mode[mbnum - nMBPerRow] != MODE_SKIPPED)
             {
-                k = b_size;
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum]] : QP_store[mbnum])];
@@ -315,6 +447,11 @@ void H263_Deblock(uint8 *rec,
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum - nMBPerRow]] : QP_store[mbnum - nMBPerRow])];
                 }
 
+#if defined(__SSE2__)
+                DeblockHorzEdge_SSE2(rec_y, width, b_size, strength);
+                rec_y += b_size;
+#else /* __SSE2__ */
+                k = b_size;
                 while (k--)
                 {
                     A =  *(rec_y - width2);
@@ -378,6 +515,7 @@ void H263_Deblock(uint8 *rec,
                     *(rec_y + width) = D + d2;
                     rec_y++;
                 }
+#endif /* __SSE2__ */
             }
             else
             {
@@ -404,8 +542,12 @@ void H263_Deblock(uint8 *rec,
             {
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
-                    k = 16;
                     strength = STRENGTH_tab[QP_store[mbnum]];
+#if defined(__SSE2__)
+                    DeblockVertEdge_SSE2(rec_y, width, 16, strength);
+                    rec_y += 16 * width;
+#else /* __SSE2__ */
+                    k = 16;
                     while (k--)
                     {
                         A =  *(rec_y - 2);
@@ -469,6 +611,7 @@ void H263_Deblock(uint8 *rec,
                         *(rec_y + 1) = D + d2;
                         rec_y += width;
                     }
+#endif /* __SSE2__ */
                     rec_y -= offset;
                 }
                 else
@@ -494,7 +637,6 @@ void H263_Deblock(uint8 *rec,
         {
             if (mode[mbnum] != MODE_SKIPPED || mode[mbnum-1] != MODE_SKIPPED)
             {
-                k = b_size;
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum]] : QP_store[mbnum])];
@@ -504,6 +646,11 @@ void H263_Deblock(uint8 *rec,
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum - 1]] : QP_store[mbnum - 1])];
                 }
 
+#if defined(__SSE2__)
+                DeblockVertEdge_SSE2(rec_y, width, b_size, strength);
+                rec_y += b_size * width;
+#else /* __SSE2__ */
+                k = b_size;
                 while (k--)
                 {
                     A =  *(rec_y - 2);
@@ -567,6 +714,7 @@ void H263_Deblock(uint8 *rec,
                     *(rec_y + 1) = D + d2;
                     rec_y += width;
                 }
+#endif /* __SSE2__ */
                 rec_y -= offset;
             }
             else
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mp4dec_api.h"
+
+// Constants.
+enum {
+    kMaxWidth         = 720,
+    kMaxHeight        = 480,
+};
+
+static int64_t GetNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Returns the offset of the next picture start code at or after offset, or
+// size if there is none.
+static int32_t FindStartCode(const uint8_t *data, int32_t size, int32_t offset,
+        bool isH263mode) {
+    for (; offset + 3 < size; offset++) {
+        if (data[offset] != 0 || data[offset + 1] != 0) {
+            continue;
+        }
+        if (isH263mode) {
+            // 22 bit picture start code.
+            if ((data[offset + 2] & 0xFC) == 0x80) {
+                return offset;
+            }
+        } else if (data[offset + 2] == 0x01 && data[offset + 3] == 0xB6) {
+            // VOP start code.
+            return offset;
+        }
+    }
+    return size;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 6) {
+        fprintf(stderr, "Usage %s <input bitstream> <output yuv> <mode> <width> "
+                        "<height> [<post-processing>]\n", argv[0]);
+        fprintf(stderr, "mode : h263 or mpeg4\n");
+        fprintf(stderr, "post-processing : 0 none (default), 1 deblocking, "
+                        "2 deringing, 3 both\n");
+        fprintf(stderr, "Max width %d\n", kMaxWidth);
+        fprintf(stderr, "Max height %d\n", kMaxHeight);
+        return EXIT_FAILURE;
+    }
+
+    // Read mode.
+    bool isH263mode;
+    if (strcmp(argv[3], "mpeg4") == 0) {
+        isH263mode = false;
+    } else if (strcmp(argv[3], "h263") == 0) {
+        isH263mode = true;
+    } else {
+        fprintf(stderr, "Unsupported mode %s\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    // Read width and height.
+    int32_t width = atoi(argv[4]);
+    int32_t height = atoi(argv[5]);
+    if (width > kMaxWidth || height > kMaxHeight || width <= 0 || height <= 0) {
+        fprintf(stderr, "Unsupported dimensions %dx%d\n", width, height);
+        return EXIT_FAILURE;
+    }
+
+    if (width % 16 != 0 || height % 16 != 0) {
+        fprintf(stderr, "Video frame size %dx%d must be a multiple of 16\n",
+            width, height);
+        return EXIT_FAILURE;
+    }
+
+    // Read post-processing type.
+    int32_t postProcType = (argc > 6) ? atoi(argv[6]) : PV_NO_POST_PROC;
+    if (postProcType < 0 || postProcType > (PV_DEBLOCK | PV_DERING)) {
+        fprintf(stderr, "Unsupported post-processing type %d\n", postProcType);
+        return EXIT_FAILURE;
+    }
+
+    // Read the whole input bitstream.
+    FILE *fpInput = fopen(argv[1], "rb");
+    if (fpInput == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    fseek(fpInput, 0, SEEK_END);
+    int32_t inputSize = ftell(fpInput);
+    fseek(fpInput, 0, SEEK_SET);
+    uint8_t *inputBuf = (uint8_t *)malloc(inputSize > 0 ? inputSize : 1);
+    assert(inputBuf != NULL);
+    if (fread(inputBuf, 1, inputSize, fpInput) != (size_t)inputSize) {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        free(inputBuf);
+        fclose(fpInput);
+        return EXIT_FAILURE;
+    }
+    fclose(fpInput);
+
+    // Open the output file.
+    FILE *fpOutput = fopen(argv[2], "wb");
+    if (fpOutput == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        free(inputBuf);
+        return EXIT_FAILURE;
+    }
+
+    // Allocate the two frames the decoder alternates between, and one for
+    // the post-processed output.
+    int32_t frameSize = (width * height * 3) / 2;
+    uint8_t *frames[2];
+    frames[0] = (uint8_t *)malloc(frameSize);
+    frames[1] = (uint8_t *)malloc(frameSize);
+    uint8_t *postProcBuf = (uint8_t *)malloc(frameSize);
+    assert(frames[0] != NULL && frames[1] != NULL && postProcBuf != NULL);
+
+    // Everything before the first picture is the VOL header.
+    int32_t offset = FindStartCode(inputBuf, inputSize, 0, isH263mode);
+    uint8_t *volData[1] = { NULL };
+    int32_t volSize = 0;
+    if (!isH263mode && offset > 0) {
+        volData[0] = inputBuf;
+        volSize = offset;
+    }
+
+    // Initialize the decoder.
+    tagvideoDecControls handle;
+    memset(&handle, 0, sizeof(tagvideoDecControls));
+    if (!PVInitVideoDecoder(&handle, volData, &volSize, 1, width, height,
+            isH263mode ? H263_MODE : MPEG4_MODE)) {
+        fprintf(stderr, "Failed to initialize the decoder\n");
+        fclose(fpOutput);
+        free(inputBuf);
+        free(frames[0]);
+        free(frames[1]);
+        free(postProcBuf);
+        return EXIT_FAILURE;
+    }
+    PVSetPostProcType(&handle, postProcType);
+    PVSetReferenceYUV(&handle, frames[0]);
+
+    // Core loop.
+    int32_t retVal = EXIT_SUCCESS;
+    int32_t numFramesDecoded = 0;
+    int64_t decodeTimeNs = 0;
+    uint8_t *currFrame = frames[1];
+
+    while (offset < inputSize) {
+        int32_t next = FindStartCode(inputBuf, inputSize, offset + 3, isH263mode);
+        uint8_t *bitstream = inputBuf + offset;
+        int32_t bufferSize = next - offset;
+        uint32_t timestamp = numFramesDecoded;
+        uint useExtTimestamp = 1;
+        offset = next;
+
+        // Decode the frame.
+        int64_t startNs = GetNowNs();
+        Bool decoded = PVDecodeVideoFrame(&handle, &bitstream, &timestamp,
+                &bufferSize, &useExtTimestamp, currFrame);
+        if (decoded && postProcType != PV_NO_POST_PROC) {
+            PVDecPostProcess(&handle, postProcBuf);
+        }
+        decodeTimeNs += GetNowNs() - startNs;
+        if (!decoded) {
+            fprintf(stderr, "Failed to decode frame %d\n", numFramesDecoded);
+            retVal = EXIT_FAILURE;
+            break;
+        }
+        numFramesDecoded++;
+
+        // Write the output.
+        fwrite(handle.outputFrame, 1, frameSize, fpOutput);
+
+        // The decoded frame is the reference of the next one.
+        currFrame = (currFrame == frames[0]) ? frames[1] : frames[0];
+    }
+
+    if (decodeTimeNs > 0) {
+        printf("Decoded %d frames in %.3f s, %.2f fps\n", numFramesDecoded,
+                decodeTimeNs / 1E9, numFramesDecoded * 1E9 / decodeTimeNs);
+    }
+
+    // Close output file.
+    fclose(fpOutput);
+
+    // Free allocated memory.
+    free(inputBuf);
+    free(frames[0]);
+    free(frames[1]);
+    free(postProcBuf);
+
+    // Close decoder instance.
+    PVCleanUpVideoDecoder(&handle);
+    return retVal;
+}
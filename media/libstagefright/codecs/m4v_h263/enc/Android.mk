@@ -10,6 +10,7 @@ LOCAL_SRC_FILES := \
     src/fastcodemb.cpp \
     src/fastidct.cpp \
     src/fastquant.cpp \
+    src/me_thread.cpp \
     src/me_utils.cpp \
     src/mp4enc_api.cpp \
     src/rate_control.cpp \
@@ -37,6 +38,8 @@ LOCAL_CFLAGS += -Werror
 LOCAL_CLANG := true
 LOCAL_SANITIZE := signed-integer-overflow
 
+# x86 builds use the SSE2 SAD, DCT and interpolation kernels in src/: both x86 ABIs have SSE2.
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
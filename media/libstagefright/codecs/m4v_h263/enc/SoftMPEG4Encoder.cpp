@@ -18,6 +18,7 @@
 #define LOG_TAG "SoftMPEG4Encoder"
 #include <utils/Log.h>
 #include <utils/misc.h>
+#include <unistd.h>
 
 #include "mp4enc_api.h"
 #include "OMX_Video.h"
@@ -52,6 +53,18 @@ static void InitOMXParams(T *params) {
     params->nVersion.s.nStep = 0;
 }
 
+static int GetCPUCoreCount() {
+    int cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK_GE(cpuCoreCount, 1);
+    return cpuCoreCount;
+}
+
 static const CodecProfileLevel kMPEG4ProfileLevels[] = {
     { OMX_VIDEO_MPEG4ProfileCore, OMX_VIDEO_MPEG4Level2 },
 };
@@ -173,6 +186,10 @@ OMX_ERRORTYPE SoftMPEG4Encoder::initEncParams() {
     mEncParams->useACPred = PV_ON;
     mEncParams->intraDCVlcTh = 0;
 
+    // Motion search the MB rows concurrently, the encoder caps it to the
+    // number of rows
+    mEncParams->numThreads = GetCPUCoreCount();
+
     return OMX_ErrorNone;
 }
 
@@ -234,6 +234,11 @@ typedef struct tagvideoEncOptions
     /** @brief This flag turns on the use of AC prediction */
     Bool                useACPred;
 
+    /** @brief  Specifies the number of threads doing the motion estimation, the MB rows of a frame
+    *           are searched concurrently. The result is the same for any number of threads.
+    *           The default value is 1.*/
+    Int                 numThreads;
+
 } VideoEncOptions;
 
 #ifdef __cplusplus
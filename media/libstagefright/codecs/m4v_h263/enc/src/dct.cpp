@@ -26,6 +26,150 @@ extern "C"
 {
 #endif
 
+#if defined(__SSE2__)
+
+    /* 8-point AAN DCT of 4 vectors at once, same steps as the C code below,
+       k[] is returned in coefficient order with the same scaling. */
+    static inline void fdct8_epi32(__m128i *k)
+    {
+        const __m128i round = _mm_set1_epi32(1 << (FDCT_SHIFT - 1));
+        const __m128i c724 = _mm_set1_epi16(724);
+        const __m128i c392 = _mm_set1_epi16(392);
+        const __m128i c554 = _mm_set1_epi16(554);
+        const __m128i c1338 = _mm_set1_epi16(1338);
+        __m128i k0, k1, k2, k3, k4, k5, k6, k7, t;
+
+        /* fdct_1 */
+        k0 = _mm_add_epi32(k[0], k[7]);
+        k7 = _mm_sub_epi32(k[0], k[7]);
+        k1 = _mm_add_epi32(k[1], k[6]);
+        k6 = _mm_sub_epi32(k[1], k[6]);
+        k2 = _mm_add_epi32(k[2], k[5]);
+        k5 = _mm_sub_epi32(k[2], k[5]);
+        k3 = _mm_add_epi32(k[3], k[4]);
+        k4 = _mm_sub_epi32(k[3], k[4]);
+
+        t = k0;
+        k0 = _mm_add_epi32(t, k3);
+        k3 = _mm_sub_epi32(t, k3);
+        t = k1;
+        k1 = _mm_add_epi32(t, k2);
+        k2 = _mm_sub_epi32(t, k2);
+
+        k[0] = _mm_add_epi32(k0, k1);
+        k[4] = _mm_sub_epi32(k0, k1);
+
+        /* fdct_2 */
+        k4 = _mm_add_epi32(k4, k5);
+        k5 = _mm_add_epi32(k5, k6);
+        k6 = _mm_add_epi32(k6, k7);
+        k2 = _mm_add_epi32(k2, k3);
+        k5 = _mm_srai_epi32(_mm_add_epi32(mul32c(k5, c724), round), FDCT_SHIFT);
+        k2 = _mm_srai_epi32(_mm_add_epi32(mul32c(k2, c724), round), FDCT_SHIFT);
+        k2 = _mm_add_epi32(k2, k3);
+        k3 = _mm_sub_epi32(_mm_slli_epi32(k3, 1), k2);
+        k[2] = k2;
+        k[6] = _mm_slli_epi32(k3, 1);
+
+        /* fdct_3 */
+        k0 = _mm_sub_epi32(k4, k6);
+        k1 = _mm_add_epi32(mul32c(k0, c392), round);
+        k0 = _mm_add_epi32(mul32c(k4, c554), k1);
+        k1 = _mm_add_epi32(mul32c(k6, c1338), k1);
+        k4 = _mm_srai_epi32(k0, FDCT_SHIFT);
+        k6 = _mm_srai_epi32(k1, FDCT_SHIFT);
+
+        k5 = _mm_add_epi32(k5, k7);
+        k7 = _mm_sub_epi32(_mm_slli_epi32(k7, 1), k5);
+        k4 = _mm_add_epi32(k4, k7);
+        k7 = _mm_sub_epi32(_mm_slli_epi32(k7, 1), k4);
+        k5 = _mm_add_epi32(k5, k6);
+        k6 = _mm_sub_epi32(k5, _mm_slli_epi32(k6, 1));
+        k[5] = _mm_slli_epi32(k4, 1);
+        k[1] = k5;
+        k[7] = _mm_slli_epi32(k6, 2);
+        k[3] = k7;
+    }
+
+    /* 8-point DCT of the 8 Short vectors x[], 4 lanes at a time in 32 bits */
+    static inline void fdct8_epi16(__m128i *x)
+    {
+        __m128i lo[8], hi[8];
+        Int i;
+
+        for (i = 0; i < 8; i++)
+        {
+            lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(x[i], x[i]), 16);
+            hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(x[i], x[i]), 16);
+        }
+
+        fdct8_epi32(lo);
+        fdct8_epi32(hi);
+
+        for (i = 0; i < 8; i++)
+        {
+            x[i] = pack_trunc32(lo[i], hi[i]);
+        }
+    }
+
+    /* Both passes of BlockDCT_AANwSub/BlockDCT_AANIntra on the 8 rows of
+       the (doubled) input in x[], bit-exact with the C code including the
+       deadzone thresholding of the columns. */
+    static void BlockDCT_SSE2(Short *out, __m128i *x)
+    {
+        __m128i col[8];
+        __m128i sum, tmp, sign, mask;
+        const __m128i ColTh = _mm_set1_epi32(out[64]);
+        Int i;
+
+        /* horizontal pass, the rows end up in the lanes */
+        transpose8x8_epi16(x);
+        fdct8_epi16(x);
+        transpose8x8_epi16(x);
+
+        /* vertical pass, the columns are in the lanes */
+        for (i = 0; i < 8; i++)
+        {
+            col[i] = x[i];
+        }
+        fdct8_epi16(col);
+
+        /* sum_abs(), without the -carry of the first term */
+        mask = _mm_setzero_si128();
+        for (i = 0; i < 2; i++)
+        {
+            Int j;
+
+            tmp = i ? _mm_unpackhi_epi16(x[0], x[0]) : _mm_unpacklo_epi16(x[0], x[0]);
+            tmp = _mm_srai_epi32(tmp, 16);
+            sum = _mm_xor_si128(tmp, _mm_srai_epi32(tmp, 31));
+            for (j = 1; j < 8; j++)
+            {
+                tmp = i ? _mm_unpackhi_epi16(x[j], x[j]) : _mm_unpacklo_epi16(x[j], x[j]);
+                tmp = _mm_srai_epi32(tmp, 16);
+                sign = _mm_srai_epi32(tmp, 31);
+                sum = _mm_add_epi32(sum, _mm_sub_epi32(_mm_xor_si128(tmp, sign), sign));
+            }
+            sum = _mm_cmplt_epi32(sum, ColTh);
+            mask = i ? _mm_packs_epi32(mask, sum) : sum;
+        }
+
+        /* columns below the threshold keep the horizontal pass, with 0x7fff
+           in row 0 */
+        x[0] = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi16(0x7fff)),
+                            _mm_andnot_si128(mask, col[0]));
+        _mm_storeu_si128((__m128i*)(out + 64), x[0]);
+        for (i = 1; i < 8; i++)
+        {
+            x[i] = _mm_or_si128(_mm_and_si128(mask, x[i]), _mm_andnot_si128(mask, col[i]));
+            _mm_storeu_si128((__m128i*)(out + 64 + (i << 3)), x[i]);
+        }
+
+        return ;
+    }
+
+#endif /* __SSE2__ */
+
     /**************************************************************************/
     /*  Function:   BlockDCT_AANwSub
         Date:       7/31/01
@@ -35,6 +179,30 @@ extern "C"
         Modified:
     **************************************************************************/
 
+#if defined(__SSE2__)
+
+    Void BlockDCT_AANwSub(Short *out, UChar *cur, UChar *pred, Int width)
+    {
+        __m128i x[8];
+        const __m128i zero = _mm_setzero_si128();
+        Int i;
+
+        for (i = 0; i < 8; i++)
+        {
+            x[i] = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)cur), zero),
+                                 _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            x[i] = _mm_slli_epi16(x[i], 1);
+            cur += width;
+            pred += 16;
+        }
+
+        BlockDCT_SSE2(out, x);
+
+        return ;
+    }
+
+#else /* __SSE2__ */
+
     Void BlockDCT_AANwSub(Short *out, UChar *cur, UChar *pred, Int width)
     {
         Short *dst;
@@ -255,6 +423,8 @@ extern "C"
         return ;
     }
 
+#endif /* __SSE2__ */
+
     /**************************************************************************/
     /*  Function:   Block4x4DCT_AANwSub
         Date:       7/31/01
@@ -649,6 +819,30 @@ extern "C"
         Modified:
     **************************************************************************/
 
+#if defined(__SSE2__)
+
+    Void BlockDCT_AANIntra(Short *out, UChar *cur, UChar *dummy2, Int width)
+    {
+        __m128i x[8];
+        const __m128i zero = _mm_setzero_si128();
+        Int i;
+
+        OSCL_UNUSED_ARG(dummy2);
+
+        for (i = 0; i < 8; i++)
+        {
+            x[i] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)cur), zero);
+            x[i] = _mm_slli_epi16(x[i], 1);
+            cur += width;
+        }
+
+        BlockDCT_SSE2(out, x);
+
+        return ;
+    }
+
+#else /* __SSE2__ */
+
     Void BlockDCT_AANIntra(Short *out, UChar *cur, UChar *dummy2, Int width)
     {
         Short *dst;
@@ -851,6 +1045,8 @@ extern "C"
         return ;
     }
 
+#endif /* __SSE2__ */
+
     /**************************************************************************/
     /*  Function:   Block4x4DCT_AANIntra
         Date:       8/9/01
@@ -390,6 +390,60 @@ __inline int32 sum_abs(int32 k0, int32 k1, int32 k2, int32 k3,
 
 #endif // Diff. OS
 
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+/* x * C in 32-bit lanes for 0 <= C < 0x8000, c = _mm_set1_epi16(C). Wraps
+   the same way as the 32-bit multiply of the C code. */
+static inline __m128i mul32c(__m128i x, __m128i c)
+{
+    return _mm_add_epi32(_mm_mullo_epi16(x, c), _mm_slli_epi32(_mm_mulhi_epu16(x, c), 16));
+}
+
+/* Short of the 32-bit lanes, i.e. the low 16 bits like a Short store */
+static inline __m128i pack_trunc32(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+static inline void transpose8x8_epi16(__m128i *x)
+{
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_unpacklo_epi16(x[0], x[1]);
+    a1 = _mm_unpackhi_epi16(x[0], x[1]);
+    a2 = _mm_unpacklo_epi16(x[2], x[3]);
+    a3 = _mm_unpackhi_epi16(x[2], x[3]);
+    a4 = _mm_unpacklo_epi16(x[4], x[5]);
+    a5 = _mm_unpackhi_epi16(x[4], x[5]);
+    a6 = _mm_unpacklo_epi16(x[6], x[7]);
+    a7 = _mm_unpackhi_epi16(x[6], x[7]);
+
+    b0 = _mm_unpacklo_epi32(a0, a2);
+    b1 = _mm_unpackhi_epi32(a0, a2);
+    b2 = _mm_unpacklo_epi32(a1, a3);
+    b3 = _mm_unpackhi_epi32(a1, a3);
+    b4 = _mm_unpacklo_epi32(a4, a6);
+    b5 = _mm_unpackhi_epi32(a4, a6);
+    b6 = _mm_unpacklo_epi32(a5, a7);
+    b7 = _mm_unpackhi_epi32(a5, a7);
+
+    x[0] = _mm_unpacklo_epi64(b0, b4);
+    x[1] = _mm_unpackhi_epi64(b0, b4);
+    x[2] = _mm_unpacklo_epi64(b1, b5);
+    x[3] = _mm_unpackhi_epi64(b1, b5);
+    x[4] = _mm_unpacklo_epi64(b2, b6);
+    x[5] = _mm_unpackhi_epi64(b2, b6);
+    x[6] = _mm_unpacklo_epi64(b3, b7);
+    x[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+#endif /* __SSE2__ */
+
 #endif //_DCT_INLINE_H_
 
 
@@ -42,6 +42,7 @@
 #include "mp4enc_lib.h"
 #include "mp4lib_int.h"
 #include "dct.h"
+#include "dct_inline.h"
 
 #define ADD_CLIP    { \
             tmp = *rec + tmp; \
@@ -1835,6 +1836,148 @@ void idct_rowzmv(Short *blk, UChar *rec, UChar *pred, Int lx)
     return;
 }
 
+#if defined(__SSE2__)
+
+/* 8-point IDCT of 4 vectors at once, the same steps as idct_col() or, with
+   row set, as idct_rowIntra()/idct_rowzmv() without the clipping. */
+static inline void idct8_epi32(__m128i *x, Int row)
+{
+    const __m128i cW7 = _mm_set1_epi16(W7);
+    const __m128i cW1mW7 = _mm_set1_epi16(W1 - W7);
+    const __m128i cW1pW7 = _mm_set1_epi16(W1 + W7);
+    const __m128i cW3 = _mm_set1_epi16(W3);
+    const __m128i cW3mW5 = _mm_set1_epi16(W3 - W5);
+    const __m128i cW3pW5 = _mm_set1_epi16(W3 + W5);
+    const __m128i cW6 = _mm_set1_epi16(W6);
+    const __m128i cW2pW6 = _mm_set1_epi16(W2 + W6);
+    const __m128i cW2mW6 = _mm_set1_epi16(W2 - W6);
+    const __m128i c181 = _mm_set1_epi16(181);
+    const __m128i r128 = _mm_set1_epi32(128);
+    const __m128i r4 = _mm_set1_epi32(row ? 4 : 0);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    if (row)
+    {
+        x1 = _mm_slli_epi32(x[4], 8);
+        x0 = _mm_add_epi32(_mm_slli_epi32(x[0], 8), _mm_set1_epi32(8192));
+    }
+    else
+    {
+        x1 = _mm_slli_epi32(x[4], 11);
+        x0 = _mm_add_epi32(_mm_slli_epi32(x[0], 11), r128);
+    }
+    x2 = x[6];
+    x3 = x[2];
+    x4 = x[1];
+    x5 = x[7];
+    x6 = x[5];
+    x7 = x[3];
+
+    /* first stage */
+    x8 = _mm_add_epi32(mul32c(_mm_add_epi32(x4, x5), cW7), r4);
+    x4 = _mm_add_epi32(x8, mul32c(x4, cW1mW7));
+    x5 = _mm_sub_epi32(x8, mul32c(x5, cW1pW7));
+    x8 = _mm_add_epi32(mul32c(_mm_add_epi32(x6, x7), cW3), r4);
+    x6 = _mm_sub_epi32(x8, mul32c(x6, cW3mW5));
+    x7 = _mm_sub_epi32(x8, mul32c(x7, cW3pW5));
+    if (row)
+    {
+        x4 = _mm_srai_epi32(x4, 3);
+        x5 = _mm_srai_epi32(x5, 3);
+        x6 = _mm_srai_epi32(x6, 3);
+        x7 = _mm_srai_epi32(x7, 3);
+    }
+
+    /* second stage */
+    x8 = _mm_add_epi32(x0, x1);
+    x0 = _mm_sub_epi32(x0, x1);
+    x1 = _mm_add_epi32(mul32c(_mm_add_epi32(x3, x2), cW6), r4);
+    x2 = _mm_sub_epi32(x1, mul32c(x2, cW2pW6));
+    x3 = _mm_add_epi32(x1, mul32c(x3, cW2mW6));
+    if (row)
+    {
+        x2 = _mm_srai_epi32(x2, 3);
+        x3 = _mm_srai_epi32(x3, 3);
+    }
+    x1 = _mm_add_epi32(x4, x6);
+    x4 = _mm_sub_epi32(x4, x6);
+    x6 = _mm_add_epi32(x5, x7);
+    x5 = _mm_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm_add_epi32(x8, x3);
+    x8 = _mm_sub_epi32(x8, x3);
+    x3 = _mm_add_epi32(x0, x2);
+    x0 = _mm_sub_epi32(x0, x2);
+    x2 = _mm_srai_epi32(_mm_add_epi32(mul32c(_mm_add_epi32(x4, x5), c181), r128), 8);
+    x4 = _mm_srai_epi32(_mm_add_epi32(mul32c(_mm_sub_epi32(x4, x5), c181), r128), 8);
+
+    /* fourth stage, the final shift is left to the caller */
+    x[0] = _mm_add_epi32(x7, x1);
+    x[1] = _mm_add_epi32(x3, x2);
+    x[2] = _mm_add_epi32(x0, x4);
+    x[3] = _mm_add_epi32(x8, x6);
+    x[4] = _mm_sub_epi32(x8, x6);
+    x[5] = _mm_sub_epi32(x0, x4);
+    x[6] = _mm_sub_epi32(x3, x2);
+    x[7] = _mm_sub_epi32(x7, x1);
+}
+
+/* idct_col() of all 8 columns followed by idct_rowIntra() or, with pred
+   set, idct_rowzmv(), bit-exact with those. Clears the block. */
+static void BlockIDCT_SSE2(Short *block, UChar *rec, UChar *pred, Int lx)
+{
+    __m128i x[8], lo[8], hi[8];
+    const __m128i zero = _mm_setzero_si128();
+    Int i;
+
+    /* columns, one row of the block per vector */
+    for (i = 0; i < 8; i++)
+    {
+        x[i] = _mm_loadu_si128((__m128i*)(block + (i << 3)));
+        lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(x[i], x[i]), 16);
+        hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(x[i], x[i]), 16);
+        _mm_storeu_si128((__m128i*)(block + (i << 3)), zero);
+    }
+    idct8_epi32(lo, 0);
+    idct8_epi32(hi, 0);
+    for (i = 0; i < 8; i++)
+    {
+        x[i] = pack_trunc32(_mm_srai_epi32(lo[i], 8), _mm_srai_epi32(hi[i], 8));
+    }
+
+    /* rows, one column of the block per vector */
+    transpose8x8_epi16(x);
+    for (i = 0; i < 8; i++)
+    {
+        lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(x[i], x[i]), 16);
+        hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(x[i], x[i]), 16);
+    }
+    idct8_epi32(lo, 1);
+    idct8_epi32(hi, 1);
+    for (i = 0; i < 8; i++)
+    {
+        /* saturating is fine, the result is clipped to [0, 255] anyway */
+        x[i] = _mm_packs_epi32(_mm_srai_epi32(lo[i], 14), _mm_srai_epi32(hi[i], 14));
+    }
+    transpose8x8_epi16(x);
+
+    for (i = 0; i < 8; i++)
+    {
+        if (pred)
+        {
+            x[i] = _mm_adds_epi16(x[i], _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            pred += 16;
+        }
+        _mm_storel_epi64((__m128i*)rec, _mm_packus_epi16(x[i], x[i]));
+        rec += lx;
+    }
+
+    return ;
+}
+
+#endif /* __SSE2__ */
+
 /*----------------------------------------------------------------------------
 ;  End Function: idctcol
 ----------------------------------------------------------------------------*/
@@ -1990,6 +2133,16 @@ void BlockIDCTMotionComp(Short *block, UChar *bitmapcol, UChar bitmaprow,
         }
     }
 
+#if defined(__SSE2__)
+    /* the general row IDCT, the special cases of idct_col() give the same
+       result as the full one */
+    if (dctMode == 8 && (bitmaprow&0xf) != 0)
+    {
+        BlockIDCT_SSE2(block, rec, intra ? NULL : pred, lx);
+        return ;
+    }
+#endif
+
     for (i = 0; i < dctMode; i++)
     {
         bmap = (Int)bitmapcol[i];
@@ -0,0 +1,315 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include "mp4lib_int.h"
+#include "mp4enc_lib.h"
+#include "m4venc_oscl.h"
+
+/* The MB rows of a motion estimation pass are handed out to the threads in order. The
+   candidate selection of a MB uses the MVs of the MBs to its left, above left, above and
+   above right found in this pass, and those of the MBs to its right and below found in the
+   previous frame or pass. A row can therefore run while it stays two MBs behind the row
+   above, which gives the same MVs as the serial loop. */
+
+static void *METhreadLoop(void *arg);
+
+/*==================================================================
+    Function:   InitMEThreads
+    Purpose:    Start numThread-1 threads for the motion estimation,
+                nothing is done for a single thread.
+    Return:     PV_TRUE if successed, PV_FALSE if failed.
+====================================================================*/
+Bool InitMEThreads(VideoEncData *video, Int numThread)
+{
+    METhreads *threads;
+    Int mbheight = 0;
+    Int k;
+
+    for (k = 0; k < video->encParams->nLayers; k++)
+    {
+        if (video->vol[k]->nMBPerCol > mbheight)
+        {
+            mbheight = video->vol[k]->nMBPerCol;
+        }
+    }
+
+    if (numThread > mbheight)
+    {
+        numThread = mbheight;
+    }
+    if (numThread <= 1)
+    {
+        return PV_TRUE;
+    }
+
+    threads = (METhreads *) M4VENC_MALLOC(sizeof(METhreads));
+    if (threads == NULL)
+    {
+        return PV_FALSE;
+    }
+    M4VENC_MEMSET(threads, 0, sizeof(METhreads));
+
+    pthread_mutex_init(&threads->mutex, NULL);
+    pthread_cond_init(&threads->startCond, NULL);
+    pthread_cond_init(&threads->doneCond, NULL);
+    pthread_cond_init(&threads->rowCond, NULL);
+
+    threads->video = video;
+    threads->mbheight = mbheight;
+    threads->numThread = 1; /* the calling thread */
+    /* from now on CleanMEThreads() undoes whatever has been done */
+    video->meThreads = threads;
+
+    threads->worker = (MEWorker *) M4VENC_MALLOC(sizeof(MEWorker) * numThread);
+    threads->rowDone = (Int *) M4VENC_MALLOC(sizeof(Int) * mbheight);
+    threads->thread = (pthread_t *) M4VENC_MALLOC(sizeof(pthread_t) * (numThread - 1));
+    if (threads->worker == NULL || threads->rowDone == NULL || threads->thread == NULL)
+    {
+        return PV_FALSE;
+    }
+
+    for (k = 0; k < numThread - 1; k++)
+    {
+        if (pthread_create(&threads->thread[k], NULL, METhreadLoop, threads))
+        {
+            return PV_FALSE;
+        }
+        threads->numThread++;
+    }
+
+    return PV_TRUE;
+}
+
+/*==================================================================
+    Function:   CleanMEThreads
+    Purpose:    Stop the motion estimation threads.
+====================================================================*/
+void CleanMEThreads(VideoEncData *video)
+{
+    METhreads *threads = video->meThreads;
+    Int k;
+
+    if (threads == NULL)
+    {
+        return ;
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    threads->quit = PV_TRUE;
+    pthread_cond_broadcast(&threads->startCond);
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (k = 0; k < threads->numThread - 1; k++)
+    {
+        pthread_join(threads->thread[k], NULL);
+    }
+
+    pthread_cond_destroy(&threads->rowCond);
+    pthread_cond_destroy(&threads->doneCond);
+    pthread_cond_destroy(&threads->startCond);
+    pthread_mutex_destroy(&threads->mutex);
+
+    if (threads->thread) M4VENC_FREE(threads->thread);
+    if (threads->rowDone) M4VENC_FREE(threads->rowDone);
+    if (threads->worker) M4VENC_FREE(threads->worker);
+
+    M4VENC_FREE(threads);
+    video->meThreads = NULL;
+
+    return ;
+}
+
+/* private copy of the main object for a thread taking part in the pass */
+static void PrepareWorker(METhreads *threads, MEWorker *worker)
+{
+    VideoEncData *video = threads->video;
+
+    worker->video = *video;
+    worker->video.meThreads = NULL;
+#ifdef HTFM
+    /* the statistics collected by each thread are added up after the pass */
+    worker->video.htfm_stat.abs_dif_mad_avg = 0;
+    worker->video.htfm_stat.countbreak = 0;
+    if (video->sad_extra_info == (void*)&video->htfm_stat)
+    {
+        worker->video.sad_extra_info = (void*)&worker->video.htfm_stat;
+    }
+#endif
+
+    worker->stat.totalSAD = 0;
+    worker->stat.numIntra = 0;
+    worker->stat.max_mag = 0;
+    worker->stat.min_mag = 0;
+
+    return ;
+}
+
+/* pick up rows of the current pass until there are none left, called with the mutex held */
+static void WorkOnRows(METhreads *threads)
+{
+    MEWorker *worker;
+    Int start_i = threads->start_i;
+    Int incr_i = threads->incr_i;
+    Int type_pred = threads->type_pred;
+    Int j;
+
+    if (threads->nextRow >= threads->mbheight)
+    {
+        return ;
+    }
+
+    worker = &threads->worker[threads->nextWorker++];
+    threads->numBusy++;
+    pthread_mutex_unlock(&threads->mutex);
+
+    PrepareWorker(threads, worker);
+
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->nextRow < threads->mbheight)
+    {
+        j = threads->nextRow++;
+        pthread_mutex_unlock(&threads->mutex);
+
+        MotionEstimationRow(&worker->video, j, start_i, incr_i, type_pred, &worker->stat, threads);
+
+        pthread_mutex_lock(&threads->mutex);
+    }
+    threads->numBusy--;
+
+    return ;
+}
+
+/*==================================================================
+    Function:   RunMEPass
+    Purpose:    Run a pass of the motion estimation over all the MB
+                rows, the calling thread works on them as well. The
+                statistics of the pass are added to stat.
+====================================================================*/
+void RunMEPass(METhreads *threads, Int start_i, Int incr_i, Int type_pred, MEStat *stat)
+{
+    VideoEncData *video = threads->video;
+    MEWorker *worker;
+    Int k;
+
+    pthread_mutex_lock(&threads->mutex);
+
+    threads->start_i = start_i;
+    threads->incr_i = incr_i;
+    threads->type_pred = type_pred;
+    threads->mbheight = video->vol[video->currLayer]->nMBPerCol;
+    threads->nextRow = 0;
+    threads->nextWorker = 0;
+    M4VENC_MEMSET(threads->rowDone, 0, sizeof(Int) * threads->mbheight);
+    threads->jobCount++;
+    pthread_cond_broadcast(&threads->startCond);
+
+    WorkOnRows(threads);
+
+    while (threads->numBusy > 0)
+    {
+        pthread_cond_wait(&threads->doneCond, &threads->mutex);
+    }
+
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (k = 0; k < threads->nextWorker; k++)
+    {
+        worker = &threads->worker[k];
+        stat->totalSAD += worker->stat.totalSAD;
+        stat->numIntra += worker->stat.numIntra;
+        if (worker->stat.max_mag > stat->max_mag)
+            stat->max_mag = worker->stat.max_mag;
+        if (worker->stat.min_mag < stat->min_mag)
+            stat->min_mag = worker->stat.min_mag;
+#ifdef HTFM
+        video->htfm_stat.abs_dif_mad_avg += worker->video.htfm_stat.abs_dif_mad_avg;
+        video->htfm_stat.countbreak += worker->video.htfm_stat.countbreak;
+#endif
+    }
+
+    return ;
+}
+
+/*==================================================================
+    Function:   WaitMERow
+    Purpose:    Wait until the row above row j is done with the MBs
+                up to the one above right of MB i.
+====================================================================*/
+void WaitMERow(METhreads *threads, Int j, Int i)
+{
+    Int mbwidth;
+
+    if (j == 0)
+    {
+        return ;
+    }
+
+    mbwidth = threads->video->vol[threads->video->currLayer]->nMBPerRow;
+    i += 2;
+    if (i > mbwidth)
+    {
+        i = mbwidth;
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->rowDone[j - 1] < i)
+    {
+        pthread_cond_wait(&threads->rowCond, &threads->mutex);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    return ;
+}
+
+/*==================================================================
+    Function:   SetMERowDone
+    Purpose:    Row j is done with its first numDone MBs.
+====================================================================*/
+void SetMERowDone(METhreads *threads, Int j, Int numDone)
+{
+    pthread_mutex_lock(&threads->mutex);
+    threads->rowDone[j] = numDone;
+    pthread_cond_broadcast(&threads->rowCond);
+    pthread_mutex_unlock(&threads->mutex);
+
+    return ;
+}
+
+static void *METhreadLoop(void *arg)
+{
+    METhreads *threads = (METhreads *) arg;
+    Int jobCount = 0; /* the threads are started before any pass */
+
+    pthread_mutex_lock(&threads->mutex);
+
+    while (!threads->quit)
+    {
+        if (threads->jobCount == jobCount)
+        {
+            pthread_cond_wait(&threads->startCond, &threads->mutex);
+            continue;
+        }
+
+        jobCount = threads->jobCount;
+        WorkOnRows(threads);
+        pthread_cond_signal(&threads->doneCond);
+    }
+
+    pthread_mutex_unlock(&threads->mutex);
+
+    return NULL;
+}
@@ -18,6 +18,10 @@
 #include "mp4lib_int.h"
 #include "mp4enc_lib.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 //const static Int roundtab4[] = {0,1,1,1};
 //const static Int roundtab8[] = {0,0,1,1,1,1,1,2};
 //const static Int roundtab12[] = {0,0,0,1,1,1,1,1,1,1,2,2};
@@ -347,6 +351,123 @@ void EncPrediction_Chrom(
     Modified:
 ***************************************************************************/
 
+#if defined(__SSE2__)
+
+/* Unaligned loads are cheap, no need to branch on the alignment of prev.
+   Same rounding as the C versions below. */
+
+Int GetPredAdvBy0x0(
+    UChar *prev,        /* i */
+    UChar *rec,     /* i */
+    Int lx,     /* i */
+    Int rnd /* i */
+)
+{
+    Int i;      /* loop variable */
+
+    OSCL_UNUSED_ARG(rnd);
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        _mm_storel_epi64((__m128i*)rec, _mm_loadl_epi64((__m128i*)prev));
+        rec += 16;
+        prev += lx;
+    }
+
+    return 1;
+}
+
+/* (a + b + rnd1) >> 1 of 8 pixels */
+static inline __m128i avg2_epu8(__m128i a, __m128i b, Int rnd1)
+{
+    __m128i avg = _mm_avg_epu8(a, b); /* (a + b + 1) >> 1 */
+
+    if (rnd1 != 1)
+    {
+        avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+    }
+
+    return avg;
+}
+
+/**************************************************************************/
+Int GetPredAdvBy0x1(
+    UChar *prev,        /* i */
+    UChar *rec,     /* i */
+    Int lx,     /* i */
+    Int rnd1 /* i */
+)
+{
+    Int i;      /* loop variable */
+    __m128i a, b;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        a = _mm_loadl_epi64((__m128i*)prev);
+        b = _mm_loadl_epi64((__m128i*)(prev + 1));
+        _mm_storel_epi64((__m128i*)rec, avg2_epu8(a, b, rnd1));
+        rec += 16;
+        prev += lx;
+    }
+
+    return 1;
+}
+
+/**************************************************************************/
+Int GetPredAdvBy1x0(
+    UChar *prev,        /* i */
+    UChar *rec,     /* i */
+    Int lx,     /* i */
+    Int rnd1 /* i */
+)
+{
+    Int i;      /* loop variable */
+    __m128i a, b;
+
+    a = _mm_loadl_epi64((__m128i*)prev);
+    for (i = B_SIZE; i > 0; i--)
+    {
+        b = _mm_loadl_epi64((__m128i*)(prev += lx));
+        _mm_storel_epi64((__m128i*)rec, avg2_epu8(a, b, rnd1));
+        a = b;
+        rec += 16;
+    }
+
+    return 1;
+}
+
+/**************************************************************************/
+Int GetPredAdvBy1x1(
+    UChar *prev,        /* i */
+    UChar *rec,     /* i */
+    Int lx,     /* i */
+    Int rnd1 /* i */
+)
+{
+    Int i;      /* loop variable */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rnd2 = _mm_set1_epi16(rnd1 + 1);
+    __m128i a, b, sum;
+
+    /* sum of the two horizontal neighbours of the first line */
+    a = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                      _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+    for (i = B_SIZE; i > 0; i--)
+    {
+        prev += lx;
+        b = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                          _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+        sum = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a, b), rnd2), 2);
+        _mm_storel_epi64((__m128i*)rec, _mm_packus_epi16(sum, sum));
+        a = b;
+        rec += 16;
+    }
+
+    return 1;
+}
+
+#else /* __SSE2__ */
+
 Int GetPredAdvBy0x0(
     UChar *prev,        /* i */
     UChar *rec,     /* i */
@@ -1444,6 +1565,8 @@ Int GetPredAdvBy1x1(
 }
 
 
+#endif /* __SSE2__ */
+
 /*=============================================================================
     Function:   EncGetPredOutside
     Date:       04/17/2001
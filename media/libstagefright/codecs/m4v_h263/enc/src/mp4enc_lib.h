@@ -115,11 +115,20 @@ extern "C"
 
     /* defined in motion_est.c */
     void MotionEstimation(VideoEncData *video);
+    void MotionEstimationRow(VideoEncData *video, Int j, Int start_i, Int incr_i, Int type_pred,
+                             MEStat *stat, METhreads *threads);
 #ifdef HTFM
     void InitHTFM(VideoEncData *video, HTFM_Stat *htfm_stat, double *newvar, Int *collect);
     void UpdateHTFM(VideoEncData *video, double *newvar, double *exp_lamda, HTFM_Stat *htfm_stat);
 #endif
 
+    /* defined in me_thread.cpp */
+    Bool InitMEThreads(VideoEncData *video, Int numThread);
+    void CleanMEThreads(VideoEncData *video);
+    void RunMEPass(METhreads *threads, Int start_i, Int incr_i, Int type_pred, MEStat *stat);
+    void WaitMERow(METhreads *threads, Int j, Int i);
+    void SetMERowDone(METhreads *threads, Int j, Int numDone);
+
     /* defined in ME_utils.c */
     void ChooseMode_C(UChar *Mode, UChar *cur, Int lx, Int min_SAD);
     void ChooseMode_MMX(UChar *Mode, UChar *cur, Int lx, Int min_SAD);
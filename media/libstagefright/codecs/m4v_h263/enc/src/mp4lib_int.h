@@ -19,6 +19,8 @@
 #ifndef _MP4LIB_INT_H_
 #define _MP4LIB_INT_H_
 
+#include <pthread.h>
+
 #include "mp4def.h"
 #include "mp4enc_api.h"
 #include "rate_control.h"
@@ -313,6 +315,8 @@ typedef struct tagHTFM_Stat
 } HTFM_Stat;
 #endif
 
+typedef struct tagMEThreads METhreads;
+
 /* Global structure that can be passed around */
 typedef struct tagVideoEncData
 {
@@ -416,6 +420,8 @@ typedef struct tagVideoEncData
     Int     hp_guess;
     /*********************************/
 
+    METhreads   *meThreads;     /* NULL when motion estimation runs on one thread */
+
     HintTrackInfo hintTrackInfo;    /* hintTrackInfo */
     /* IntraPeriod, Timestamp, etc. */
     float       nextEncIVop;    /* counter til the next I-Vop */
@@ -432,6 +438,52 @@ typedef struct tagVideoEncData
 
 } VideoEncData;
 
+/* statistics gathered by the motion estimation of a set of MBs */
+typedef struct tagMEStat
+{
+    Int     totalSAD;           /* sum of the SAD of the MBs */
+    Int     numIntra;           /* number of INTRA MBs */
+    Int     max_mag;            /* largest MV component */
+    Int     min_mag;            /* smallest MV component */
+} MEStat;
+
+/* one thread working on the MB rows of a motion estimation pass */
+typedef struct tagMEWorker
+{
+    VideoEncData    video;      /* private copy, for currYMB, mbnum and htfm_stat */
+    MEStat          stat;
+} MEWorker;
+
+/* The MB rows of a motion estimation pass are searched concurrently, a row following
+   the one above it two MBs behind. The thread calling the encoder takes part in
+   every pass, so there are numThread-1 threads. */
+struct tagMEThreads
+{
+    VideoEncData    *video;     /* main object */
+    MEWorker        *worker;    /* array of numThread workers */
+    Int             *rowDone;   /* number of MBs of each row done with */
+    Int             mbheight;   /* MB rows of the current pass */
+
+    pthread_t       *thread;
+    Int             numThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  startCond;  /* signalled when a pass is started or on exit */
+    pthread_cond_t  doneCond;   /* signalled when a thread has run out of rows */
+    pthread_cond_t  rowCond;    /* signalled when a row has made progress */
+
+    /* fields below protected by mutex */
+    Int             jobCount;   /* incremented for each pass started */
+    Int             nextRow;    /* next row to be picked up */
+    Int             nextWorker; /* next worker to be used */
+    Int             numBusy;    /* number of threads working on rows */
+    Bool            quit;
+
+    /* parameters of the pass */
+    Int             start_i;
+    Int             incr_i;
+    Int             type_pred;
+};
+
 /*************************************************************/
 /*                  VLC structures                           */
 /*************************************************************/
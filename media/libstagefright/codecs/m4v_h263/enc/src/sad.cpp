@@ -103,6 +103,80 @@ extern "C"
         Changes:
       ===============================================================*/
 
+#if defined(__SSE2__)
+
+    /* The 16 pixels of a stage are gathered into one register, the SAD of
+       each stage and the early dropout are the same as in the C code. */
+    Int SAD_MB_HTFM_Collect(UChar *ref, UChar *blk, Int dmin_lx, void *extra_info)
+    {
+        Int i;
+        Int sad = 0;
+        Int lx4 = (dmin_lx << 2) & 0x3FFFC;
+        Int saddata[16];    /* used when collecting flag (global) is on */
+        Int difmad;
+        HTFM_Stat *htfm_stat = (HTFM_Stat*) extra_info;
+        Int *abs_dif_mad_avg = &(htfm_stat->abs_dif_mad_avg);
+        UInt *countbreak = &(htfm_stat->countbreak);
+        Int *offsetRef = htfm_stat->offsetRef;
+
+        NUM_SAD_MB_CALL();
+
+        for (i = 0; i < 16; i++)
+        {
+            sad += simd_sad_16(simd_htfm_load(ref + offsetRef[i], lx4), blk);
+            blk += 16;
+
+            NUM_SAD_MB();
+
+            saddata[i] = sad;
+
+            if (i > 0)
+            {
+                if ((ULong)sad > ((ULong)dmin_lx >> 16))
+                {
+                    break;
+                }
+            }
+        }
+
+        difmad = saddata[0] - ((saddata[1] + 1) >> 1);
+        (*abs_dif_mad_avg) += ((difmad > 0) ? difmad : -difmad);
+        (*countbreak)++;
+        return sad;
+    }
+
+    Int SAD_MB_HTFM(UChar *ref, UChar *blk, Int dmin_lx, void *extra_info)
+    {
+        Int sad = 0;
+        Int i;
+        Int lx4 = (dmin_lx << 2) & 0x3FFFC;
+        Int sadstar = 0, madstar;
+        Int *nrmlz_th = (Int*) extra_info;
+        Int *offsetRef = (Int*) extra_info + 32;
+
+        madstar = (ULong)dmin_lx >> 20;
+
+        NUM_SAD_MB_CALL();
+
+        for (i = 0; i < 16; i++)
+        {
+            sad += simd_sad_16(simd_htfm_load(ref + offsetRef[i], lx4), blk);
+            blk += 16;
+
+            NUM_SAD_MB();
+
+            sadstar += madstar;
+            if (((ULong)sad <= ((ULong)dmin_lx >> 16)) && (sad <= (sadstar - *nrmlz_th++)))
+                ;
+            else
+                return 65536;
+        }
+
+        return sad;
+    }
+
+#else /* __SSE2__ */
+
     Int SAD_MB_HTFM_Collect(UChar *ref, UChar *blk, Int dmin_lx, void *extra_info)
     {
         Int i;
@@ -297,6 +371,8 @@ extern "C"
 
         return sad;
     }
+
+#endif /* __SSE2__ */
 #endif /* HTFM */
 
 #ifndef NO_INTER4V
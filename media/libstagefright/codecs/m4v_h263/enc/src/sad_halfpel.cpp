@@ -31,6 +31,7 @@ Int SAD_Blk_HalfPel_C(UChar *ref,UChar *blk,Int dmin,Int width,Int rx,Int xh,Int
 #include "mp4def.h"
 #include "mp4lib_int.h"
 #include "sad_halfpel_inline.h"
+#include "sad_inline.h"
 
 #ifdef _SAD_STAT
 ULong num_sad_HP_MB = 0;
@@ -331,6 +332,144 @@ extern "C"
 
 #ifdef HTFM  /* HTFM with uniform subsampling implementation, 2/28/01 */
 
+#if defined(__SSE2__)
+
+    /* SAD of one HTFM stage at half-pel position (xh, yh), the interpolated
+       pixels are rounded the same way as INTERP1_SUB_SAD/INTERP2_SUB_SAD. */
+    static inline Int simd_sad_hp_stage(UChar *p1, UChar *blk, Int rx, Int refwx4,
+                                        Int xh, Int yh)
+    {
+        __m128i x0, x1, x2, x3, lo, hi;
+        const __m128i zero = _mm_setzero_si128();
+
+        x0 = simd_htfm_load(p1, refwx4);
+        if (xh && yh)
+        {
+            x1 = simd_htfm_load(p1 + 1, refwx4);
+            x2 = simd_htfm_load(p1 + rx, refwx4);
+            x3 = simd_htfm_load(p1 + rx + 1, refwx4);
+
+            lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(x0, zero), _mm_unpacklo_epi8(x1, zero)),
+                               _mm_add_epi16(_mm_unpacklo_epi8(x2, zero), _mm_unpacklo_epi8(x3, zero)));
+            hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(x0, zero), _mm_unpackhi_epi8(x1, zero)),
+                               _mm_add_epi16(_mm_unpackhi_epi8(x2, zero), _mm_unpackhi_epi8(x3, zero)));
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_set1_epi16(2)), 2);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_set1_epi16(2)), 2);
+            x0 = _mm_packus_epi16(lo, hi);
+        }
+        else
+        {
+            /* (a + b + 1) >> 1 */
+            x0 = _mm_avg_epu8(x0, simd_htfm_load(p1 + (xh ? 1 : rx), refwx4));
+        }
+
+        return simd_sad_16(x0, blk);
+    }
+
+    static inline Int simd_sad_mb_hp_htfm_collect(UChar *ref, UChar *blk, Int dmin_rx,
+            void *extra_info, Int xh, Int yh)
+    {
+        Int i;
+        Int sad = 0;
+        Int rx = dmin_rx & 0xFFFF;
+        Int refwx4 = rx << 2;
+        Int saddata[16];      /* used when collecting flag (global) is on */
+        Int difmad;
+        HTFM_Stat *htfm_stat = (HTFM_Stat*) extra_info;
+        Int *abs_dif_mad_avg = &(htfm_stat->abs_dif_mad_avg);
+        UInt *countbreak = &(htfm_stat->countbreak);
+        Int *offsetRef = htfm_stat->offsetRef;
+
+        NUM_SAD_HP_MB_CALL();
+
+        for (i = 0; i < 16; i++) /* 16 stages */
+        {
+            sad += simd_sad_hp_stage(ref + offsetRef[i], blk, rx, refwx4, xh, yh);
+            blk += 16;
+
+            NUM_SAD_HP_MB();
+
+            saddata[i] = sad;
+
+            if (i > 0)
+            {
+                if (sad > (Int)((ULong)dmin_rx >> 16))
+                {
+                    break;
+                }
+            }
+        }
+        difmad = saddata[0] - ((saddata[1] + 1) >> 1);
+        (*abs_dif_mad_avg) += ((difmad > 0) ? difmad : -difmad);
+        (*countbreak)++;
+
+        return sad;
+    }
+
+    static inline Int simd_sad_mb_hp_htfm(UChar *ref, UChar *blk, Int dmin_rx,
+                                          void *extra_info, Int xh, Int yh)
+    {
+        Int i;
+        Int sad = 0;
+        Int rx = dmin_rx & 0xFFFF;
+        Int refwx4 = rx << 2;
+        Int sadstar = 0, madstar;
+        Int *nrmlz_th = (Int*) extra_info;
+        Int *offsetRef = nrmlz_th + 32;
+
+        madstar = (ULong)dmin_rx >> 20;
+
+        NUM_SAD_HP_MB_CALL();
+
+        for (i = 0; i < 16; i++) /* 16 stages */
+        {
+            sad += simd_sad_hp_stage(ref + offsetRef[i], blk, rx, refwx4, xh, yh);
+            blk += 16;
+
+            NUM_SAD_HP_MB();
+
+            sadstar += madstar;
+            if (sad > sadstar - nrmlz_th[i] || sad > (Int)((ULong)dmin_rx >> 16))
+            {
+                return 65536;
+            }
+        }
+
+        return sad;
+    }
+
+    Int SAD_MB_HP_HTFM_Collectxhyh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
+    {
+        return simd_sad_mb_hp_htfm_collect(ref, blk, dmin_rx, extra_info, 1, 1);
+    }
+
+    Int SAD_MB_HP_HTFM_Collectyh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
+    {
+        return simd_sad_mb_hp_htfm_collect(ref, blk, dmin_rx, extra_info, 0, 1);
+    }
+
+    Int SAD_MB_HP_HTFM_Collectxh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
+    {
+        return simd_sad_mb_hp_htfm_collect(ref, blk, dmin_rx, extra_info, 1, 0);
+    }
+
+    Int SAD_MB_HP_HTFMxhyh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
+    {
+        return simd_sad_mb_hp_htfm(ref, blk, dmin_rx, extra_info, 1, 1);
+    }
+
+    Int SAD_MB_HP_HTFMyh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
+    {
+        return simd_sad_mb_hp_htfm(ref, blk, dmin_rx, extra_info, 0, 1);
+    }
+
+    Int SAD_MB_HP_HTFMxh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
+    {
+        return simd_sad_mb_hp_htfm(ref, blk, dmin_rx, extra_info, 1, 0);
+    }
+
+#else /* __SSE2__ */
+
 //Checheck here
     Int SAD_MB_HP_HTFM_Collectxhyh(UChar *ref, UChar *blk, Int dmin_rx, void *extra_info)
     {
@@ -766,6 +905,7 @@ extern "C"
         return sad;
     }
 
+#endif /* __SSE2__ */
 #endif /* HTFM */
 
 #ifndef NO_INTER4V
@@ -23,6 +23,10 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -61,6 +65,66 @@ extern "C"
         return src1;
     }
 
+#if defined(__SSE2__)
+
+    /* Unaligned loads cost the same as aligned ones here, so there is no
+       need for the byte offset versions of sad_mb_offset.h. The SAD is
+       checked against dmin after each row like the versions below, so
+       that the same partial SAD is returned. */
+    __inline int32 simd_sad_mb(UChar *ref, UChar *blk, Int dmin, Int lx)
+    {
+        __m128i sad = _mm_setzero_si128();
+        int32 x10 = 0;
+        Int i;
+
+        for (i = 16; i > 0; i--)
+        {
+            sad = _mm_add_epi64(sad, _mm_sad_epu8(_mm_loadu_si128((__m128i*)ref),
+                                                  _mm_loadu_si128((__m128i*)blk)));
+            x10 = _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+            if (x10 > dmin)
+                break;
+
+            ref += lx;
+            blk += 16;
+        }
+
+        return x10;
+    }
+
+    /* p[0], p[4], p[8] and p[12] in the low byte of the four dwords, the
+       rest of the bytes are garbage. Nothing past p[12] is read, like the
+       C code. */
+    __inline __m128i simd_htfm_row(UChar *p)
+    {
+        __m128i x0 = _mm_loadl_epi64((__m128i*)p);
+        __m128i x1 = _mm_srli_epi64(_mm_loadl_epi64((__m128i*)(p + 5)), 24);
+
+        return _mm_unpacklo_epi64(x0, x1);
+    }
+
+    /* Gather the 16 pixels of one HTFM stage, every 4th pixel of 4 lines
+       lx4 apart, in the order HTFMPrepareCurMB stores the current MB. */
+    __inline __m128i simd_htfm_load(UChar *p, Int lx4)
+    {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        __m128i x0 = _mm_and_si128(simd_htfm_row(p), mask);
+        __m128i x1 = _mm_and_si128(simd_htfm_row(p + lx4), mask);
+        __m128i x2 = _mm_and_si128(simd_htfm_row(p + 2 * lx4), mask);
+        __m128i x3 = _mm_and_si128(simd_htfm_row(p + 3 * lx4), mask);
+
+        return _mm_packus_epi16(_mm_packs_epi32(x0, x1), _mm_packs_epi32(x2, x3));
+    }
+
+    __inline int32 simd_sad_16(__m128i ref, UChar *blk)
+    {
+        __m128i sad = _mm_sad_epu8(ref, _mm_loadu_si128((__m128i*)blk));
+
+        return _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+    }
+
+#else /* __SSE2__ */
+
 #define NUMBER 3
 #define SHIFT 24
 
@@ -172,6 +236,8 @@ SadMBOffset1:
 
     }
 
+#endif /* __SSE2__ */
+
 #elif defined(__CC_ARM)  /* only work with arm v5 */
 
     __inline int32 SUB_SAD(int32 sad, int32 tmp, int32 tmp2)
@@ -30,6 +30,7 @@
 #include <stdint.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "mp4enc_api.h"
 
@@ -43,11 +44,17 @@ enum {
     kIDRFrameRefreshIntervalInSec = 1, // in seconds.
 };
 
+static int64_t GetNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 int main(int argc, char *argv[]) {
 
     if (argc < 8) {
         fprintf(stderr, "Usage %s <input yuv> <output file> <mode> <width> "
-                        "<height> <frame rate> <bitrate in kbps>\n", argv[0]);
+                        "<height> <frame rate> <bitrate in kbps> [<threads>]\n", argv[0]);
         fprintf(stderr, "mode : h263 or mpeg4\n");
         fprintf(stderr, "Max width %d\n", kMaxWidth);
         fprintf(stderr, "Max height %d\n", kMaxHeight);
@@ -99,6 +106,13 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    // Read the number of motion estimation threads.
+    int32_t numThreads = (argc > 8) ? atoi(argv[8]) : 1;
+    if (numThreads <= 0) {
+        fprintf(stderr, "Unsupported number of threads %d\n", numThreads);
+        return EXIT_FAILURE;
+    }
+
     // Allocate input buffer.
     uint8_t *inputBuf = (uint8_t *)malloc((width * height * 3) / 2);
     assert(inputBuf != NULL);
@@ -175,6 +189,7 @@ int main(int argc, char *argv[]) {
     encParams.gobHeaderInterval = 0;
     encParams.useACPred = PV_ON;
     encParams.intraDCVlcTh = 0;
+    encParams.numThreads = numThreads;
 
     // Initialize the handle.
     tagvideoEncControls handle;
@@ -198,6 +213,7 @@ int main(int argc, char *argv[]) {
     int32_t retVal = EXIT_SUCCESS;
     int32_t frameSize = (width * height * 3) / 2;
     int32_t numFramesEncoded = 0;
+    int64_t encodeTimeNs = 0;
 
     while (1) {
         // Read the input frame.
@@ -222,9 +238,11 @@ int main(int argc, char *argv[]) {
         int32_t nLayer = 0;
         MP4HintTrack hintTrack;
         int32_t dataLength = kOutputBufferSize;
-        if (!PVEncodeVideoFrame(&handle, &vin, &vout,
-                &modTimeMs, outputBuf, &dataLength, &nLayer) ||
-            !PVGetHintTrack(&handle, &hintTrack)) {
+        int64_t startNs = GetNowNs();
+        Bool encoded = PVEncodeVideoFrame(&handle, &vin, &vout,
+                &modTimeMs, outputBuf, &dataLength, &nLayer);
+        encodeTimeNs += GetNowNs() - startNs;
+        if (!encoded || !PVGetHintTrack(&handle, &hintTrack)) {
             fprintf(stderr, "Failed to encode frame or get hink track at "
                     " frame %d\n", numFramesEncoded);
             retVal = EXIT_FAILURE;
@@ -237,6 +255,11 @@ int main(int argc, char *argv[]) {
         fwrite(outputBuf, 1, dataLength, fpOutput);
     }
 
+    if (encodeTimeNs > 0) {
+        printf("Encoded %d frames in %.3f s, %.2f fps\n", numFramesEncoded,
+                encodeTimeNs / 1E9, numFramesEncoded * 1E9 / encodeTimeNs);
+    }
+
     // Close input and output file.
     fclose(fpInput);
     fclose(fpOutput);
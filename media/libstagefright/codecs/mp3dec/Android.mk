@@ -61,6 +61,8 @@ LOCAL_MODULE := libstagefright_mp3dec
 
 LOCAL_ARM_MODE := arm
 
+# x86 builds use SSE2 (in both x86 ABIs), and SSE4.1 pmuldq when x86_has_sse41() finds it.
+
 include $(BUILD_STATIC_LIBRARY)
 
 ################################################################################
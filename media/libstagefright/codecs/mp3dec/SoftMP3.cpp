@@ -22,6 +22,7 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
 
 #include "include/pvmp3decoder_api.h"
 
@@ -48,6 +49,7 @@ SoftMP3::SoftMP3(
       mNumFramesOutput(0),
       mNumChannels(2),
       mSamplingRate(44100),
+      mMaxFramesPerBuffer(1),
       mSignalledError(false),
       mSawInputEos(false),
       mSignalledOutputEos(false),
@@ -122,20 +124,22 @@ void SoftMP3::initDecoder() {
     mIsFirst = true;
 }
 
-void *SoftMP3::memsetSafe(OMX_BUFFERHEADERTYPE *outHeader, int c, size_t len) {
-    if (len > outHeader->nAllocLen) {
-        ALOGE("memset buffer too small: got %u, expected %zu", outHeader->nAllocLen, len);
+void *SoftMP3::memsetSafe(
+        OMX_BUFFERHEADERTYPE *outHeader, size_t offset, int c, size_t len) {
+    if (offset + len > outHeader->nAllocLen) {
+        ALOGE("memset buffer too small: got %u, expected %zu",
+                outHeader->nAllocLen, offset + len);
         android_errorWriteLog(0x534e4554, "29422022");
         notify(OMX_EventError, OMX_ErrorUndefined, OUTPUT_BUFFER_TOO_SMALL, NULL);
         mSignalledError = true;
         return NULL;
     }
-    return memset(outHeader->pBuffer, c, len);
+    return memset(outHeader->pBuffer + offset, c, len);
 }
 
 OMX_ERRORTYPE SoftMP3::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
-    switch (index) {
+    switch ((int)index) {
         case OMX_IndexParamAudioPcm:
         {
             OMX_AUDIO_PARAM_PCMMODETYPE *pcmParams =
@@ -184,6 +188,23 @@ OMX_ERRORTYPE SoftMP3::internalGetParameter(
             return OMX_ErrorNone;
         }
 
+        case kMultiFrameBuffersIndex:
+        {
+            OMX_PARAM_U32TYPE *framesParams = (OMX_PARAM_U32TYPE *)params;
+
+            if (!isValidOMXParam(framesParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (framesParams->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            framesParams->nU32 = mMaxFramesPerBuffer;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalGetParameter(index, params);
     }
@@ -191,7 +212,7 @@ OMX_ERRORTYPE SoftMP3::internalGetParameter(
 
 OMX_ERRORTYPE SoftMP3::internalSetParameter(
         OMX_INDEXTYPE index, const OMX_PTR params) {
-    switch (index) {
+    switch ((int)index) {
         case OMX_IndexParamStandardComponentRole:
         {
             const OMX_PARAM_COMPONENTROLETYPE *roleParams =
@@ -229,11 +250,43 @@ OMX_ERRORTYPE SoftMP3::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case kMultiFrameBuffersIndex:
+        {
+            const OMX_PARAM_U32TYPE *framesParams =
+                (const OMX_PARAM_U32TYPE *)params;
+
+            if (!isValidOMXParam(framesParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (framesParams->nPortIndex != 1 || framesParams->nU32 == 0) {
+                return OMX_ErrorUndefined;
+            }
+
+            mMaxFramesPerBuffer = kMaxFramesPerBuffer;
+            if (framesParams->nU32 < (OMX_U32)kMaxFramesPerBuffer) {
+                mMaxFramesPerBuffer = framesParams->nU32;
+            }
+            editPortInfo(1)->mDef.nBufferSize = kOutputBufferSize * mMaxFramesPerBuffer;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalSetParameter(index, params);
     }
 }
 
+OMX_ERRORTYPE SoftMP3::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.multiFrameBuffers")) {
+        *(int32_t *)index = kMultiFrameBuffersIndex;
+        return OMX_ErrorNone;
+    }
+
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 void SoftMP3::onQueueFilled(OMX_U32 /* portIndex */) {
     if (mSignalledError || mOutputPortSettingsChange != NONE) {
         return;
@@ -243,157 +296,225 @@ void SoftMP3::onQueueFilled(OMX_U32 /* portIndex */) {
     List<BufferInfo *> &outQueue = getPortQueue(1);
     int64_t tmpTime = 0;
     while ((!inQueue.empty() || (mSawInputEos && !mSignalledOutputEos)) && !outQueue.empty()) {
-        BufferInfo *inInfo = NULL;
-        OMX_BUFFERHEADERTYPE *inHeader = NULL;
-        if (!inQueue.empty()) {
-            inInfo = *inQueue.begin();
-            inHeader = inInfo->mHeader;
-        }
-
         BufferInfo *outInfo = *outQueue.begin();
         OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
         outHeader->nFlags = 0;
 
-        if (inHeader) {
-            if (inHeader->nOffset == 0 && inHeader->nFilledLen) {
-                // use new input buffer timestamp as Anchor Time if its
-                //    a) first buffer or
-                //    b) first buffer post seek or
-                //    c) different from last buffer timestamp
-                //If input buffer timestamp is same as last input buffer timestamp then
-                //treat this as a erroneous timestamp and ignore new input buffer
-                //timestamp and use last output buffer timestamp as Anchor Time.
-                if ((mLastAnchorTimeUs != inHeader->nTimeStamp)) {
-                    mAnchorTimeUs = inHeader->nTimeStamp;
-                    mLastAnchorTimeUs = inHeader->nTimeStamp;
-                } else {
-                    mAnchorTimeUs = mNextOutBufferTimeUs;
-                }
-
-                mNumFramesOutput = 0;
+        int32_t numFramesInBuffer = 0;
+        do {
+            BufferInfo *inInfo = NULL;
+            OMX_BUFFERHEADERTYPE *inHeader = NULL;
+            if (!inQueue.empty()) {
+                inInfo = *inQueue.begin();
+                inHeader = inInfo->mHeader;
             }
 
-            if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-                mSawInputEos = true;
+            // frames after the first one of the output buffer are appended to it
+            size_t outOffset = 0;
+            if (numFramesInBuffer > 0) {
+                outOffset = outHeader->nOffset + outHeader->nFilledLen;
             }
 
-            mConfig->pInputBuffer =
-                inHeader->pBuffer + inHeader->nOffset;
+            bool hasFrameLength = false;
+            uint32_t frameLength = 0;
+            if (inHeader) {
+                if (inHeader->nOffset == 0 && inHeader->nFilledLen) {
+                    // use new input buffer timestamp as Anchor Time if its
+                    //    a) first buffer or
+                    //    b) first buffer post seek or
+                    //    c) different from last buffer timestamp
+                    //If input buffer timestamp is same as last input buffer timestamp then
+                    //treat this as a erroneous timestamp and ignore new input buffer
+                    //timestamp and use last output buffer timestamp as Anchor Time.
+                    if ((mLastAnchorTimeUs != inHeader->nTimeStamp)) {
+                        mAnchorTimeUs = inHeader->nTimeStamp;
+                        mLastAnchorTimeUs = inHeader->nTimeStamp;
+                    } else {
+                        mAnchorTimeUs = mNextOutBufferTimeUs;
+                    }
 
-            mConfig->inputBufferCurrentLength = inHeader->nFilledLen;
-        } else {
-            mConfig->pInputBuffer = NULL;
-            mConfig->inputBufferCurrentLength = 0;
-        }
-        mConfig->inputBufferMaxLength = 0;
-        mConfig->inputBufferUsedLength = 0;
-
-        mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
-        if ((int32)outHeader->nAllocLen < mConfig->outputFrameSize) {
-            ALOGE("input buffer too small: got %u, expected %u",
-                outHeader->nAllocLen, mConfig->outputFrameSize);
-            android_errorWriteLog(0x534e4554, "27793371");
-            notify(OMX_EventError, OMX_ErrorUndefined, OUTPUT_BUFFER_TOO_SMALL, NULL);
-            mSignalledError = true;
-            return;
-        }
+                    mNumFramesOutput = 0;
+                }
 
-        mConfig->pOutputBuffer =
-            reinterpret_cast<int16_t *>(outHeader->pBuffer);
+                if ((inHeader->nFlags & OMX_BUFFERFLAG_EOS)
+                        && (mMaxFramesPerBuffer == 1 || inHeader->nFilledLen == 0)) {
+                    mSawInputEos = true;
+                }
+
+                if (mMaxFramesPerBuffer > 1 && inHeader->nFilledLen > 0) {
+                    if (inHeader->nFilledLen >= sizeof(frameLength)) {
+                        memcpy(&frameLength, inHeader->pBuffer + inHeader->nOffset,
+                                sizeof(frameLength));
+                    }
+                    if (inHeader->nFilledLen < sizeof(frameLength)
+                            || frameLength > inHeader->nFilledLen - sizeof(frameLength)) {
+                        ALOGE("bad frame length in input buffer");
+                        notify(OMX_EventError, OMX_ErrorStreamCorrupt, ERROR_MALFORMED, NULL);
+                        mSignalledError = true;
+                        return;
+                    }
+                    hasFrameLength = true;
 
-        ERROR_CODE decoderErr;
-        if ((decoderErr = pvmp3_framedecoder(mConfig, mDecoderBuf))
-                != NO_DECODING_ERROR) {
-            ALOGV("mp3 decoder returned error %d", decoderErr);
+                    mConfig->pInputBuffer =
+                        inHeader->pBuffer + inHeader->nOffset + sizeof(frameLength);
 
-            if (decoderErr != NO_ENOUGH_MAIN_DATA_ERROR
-                        && decoderErr != SIDE_INFO_ERROR) {
-                ALOGE("mp3 decoder returned error %d", decoderErr);
+                    mConfig->inputBufferCurrentLength = frameLength;
+                } else {
+                    mConfig->pInputBuffer =
+                        inHeader->pBuffer + inHeader->nOffset;
 
-                notify(OMX_EventError, OMX_ErrorUndefined, decoderErr, NULL);
+                    mConfig->inputBufferCurrentLength = inHeader->nFilledLen;
+                }
+            } else {
+                mConfig->pInputBuffer = NULL;
+                mConfig->inputBufferCurrentLength = 0;
+            }
+            mConfig->inputBufferMaxLength = 0;
+            mConfig->inputBufferUsedLength = 0;
+
+            mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
+            if ((int32)(outHeader->nAllocLen - outOffset) < mConfig->outputFrameSize) {
+                ALOGE("input buffer too small: got %u, expected %u",
+                    outHeader->nAllocLen, mConfig->outputFrameSize);
+                android_errorWriteLog(0x534e4554, "27793371");
+                notify(OMX_EventError, OMX_ErrorUndefined, OUTPUT_BUFFER_TOO_SMALL, NULL);
                 mSignalledError = true;
                 return;
             }
 
-            if (mConfig->outputFrameSize == 0) {
-                mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
-            }
+            mConfig->pOutputBuffer =
+                reinterpret_cast<int16_t *>(outHeader->pBuffer + outOffset);
+
+            size_t frameOffset = 0;
+            size_t frameFilledLen = 0;
+
+            ERROR_CODE decoderErr;
+            if ((decoderErr = pvmp3_framedecoder(mConfig, mDecoderBuf))
+                    != NO_DECODING_ERROR) {
+                ALOGV("mp3 decoder returned error %d", decoderErr);
+
+                if (decoderErr != NO_ENOUGH_MAIN_DATA_ERROR
+                            && decoderErr != SIDE_INFO_ERROR) {
+                    ALOGE("mp3 decoder returned error %d", decoderErr);
+
+                    notify(OMX_EventError, OMX_ErrorUndefined, decoderErr, NULL);
+                    mSignalledError = true;
+                    return;
+                }
+
+                if (mConfig->outputFrameSize == 0) {
+                    mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
+                }
+
+                if (decoderErr == NO_ENOUGH_MAIN_DATA_ERROR && mSawInputEos) {
+                    if (!mIsFirst) {
+                        // pad the end of the stream with 529 samples, since that many samples
+                        // were trimmed off the beginning when decoding started
+                        frameOffset = 0;
+                        frameFilledLen = kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
 
-            if (decoderErr == NO_ENOUGH_MAIN_DATA_ERROR && mSawInputEos) {
-                if (!mIsFirst) {
-                    // pad the end of the stream with 529 samples, since that many samples
-                    // were trimmed off the beginning when decoding started
-                    outHeader->nOffset = 0;
-                    outHeader->nFilledLen = kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+                        if (!memsetSafe(outHeader, outOffset, 0, frameFilledLen)) {
+                            return;
+                        }
 
-                    if (!memsetSafe(outHeader, 0, outHeader->nFilledLen)) {
+                    }
+                    outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+                    mSignalledOutputEos = true;
+                } else {
+                    // This is recoverable, just ignore the current frame and
+                    // play silence instead.
+
+                    // TODO: should we skip silence (and consume input data)
+                    // if mIsFirst is true as we may not have a valid
+                    // mConfig->samplingRate and mConfig->num_channels?
+                    ALOGV_IF(mIsFirst, "insufficient data for first frame, sending silence");
+                    if (!memsetSafe(outHeader, outOffset, 0,
+                            mConfig->outputFrameSize * sizeof(int16_t))) {
                         return;
                     }
 
+                    if (inHeader) {
+                        mConfig->inputBufferUsedLength = inHeader->nFilledLen;
+                    }
                 }
-                outHeader->nFlags = OMX_BUFFERFLAG_EOS;
-                mSignalledOutputEos = true;
-            } else {
-                // This is recoverable, just ignore the current frame and
-                // play silence instead.
-
-                // TODO: should we skip silence (and consume input data)
-                // if mIsFirst is true as we may not have a valid
-                // mConfig->samplingRate and mConfig->num_channels?
-                ALOGV_IF(mIsFirst, "insufficient data for first frame, sending silence");
-                if (!memsetSafe(outHeader, 0, mConfig->outputFrameSize * sizeof(int16_t))) {
-                    return;
+            } else if (mConfig->samplingRate != mSamplingRate
+                    || mConfig->num_channels != mNumChannels) {
+                mSamplingRate = mConfig->samplingRate;
+                mNumChannels = mConfig->num_channels;
+
+                if (numFramesInBuffer > 0) {
+                    // the frames decoded before the change go out in the old format
+                    outInfo->mOwnedByUs = false;
+                    outQueue.erase(outQueue.begin());
+                    outInfo = NULL;
+                    notifyFillBufferDone(outHeader);
+                    outHeader = NULL;
                 }
 
-                if (inHeader) {
-                    mConfig->inputBufferUsedLength = inHeader->nFilledLen;
-                }
+                notify(OMX_EventPortSettingsChanged, 1, 0, NULL);
+                mOutputPortSettingsChange = AWAITING_DISABLED;
+                return;
             }
-        } else if (mConfig->samplingRate != mSamplingRate
-                || mConfig->num_channels != mNumChannels) {
-            mSamplingRate = mConfig->samplingRate;
-            mNumChannels = mConfig->num_channels;
-
-            notify(OMX_EventPortSettingsChanged, 1, 0, NULL);
-            mOutputPortSettingsChange = AWAITING_DISABLED;
-            return;
-        }
 
-        if (mIsFirst) {
-            mIsFirst = false;
-            // The decoder delay is 529 samples, so trim that many samples off
-            // the start of the first output buffer. This essentially makes this
-            // decoder have zero delay, which the rest of the pipeline assumes.
-            outHeader->nOffset =
-                kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
-
-            outHeader->nFilledLen =
-                mConfig->outputFrameSize * sizeof(int16_t) - outHeader->nOffset;
-        } else if (!mSignalledOutputEos) {
-            outHeader->nOffset = 0;
-            outHeader->nFilledLen = mConfig->outputFrameSize * sizeof(int16_t);
-        }
+            if (mIsFirst) {
+                mIsFirst = false;
+                // The decoder delay is 529 samples, so trim that many samples off
+                // the start of the first output buffer. This essentially makes this
+                // decoder have zero delay, which the rest of the pipeline assumes.
+                frameOffset =
+                    kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+
+                frameFilledLen =
+                    mConfig->outputFrameSize * sizeof(int16_t) - frameOffset;
+            } else if (!mSignalledOutputEos) {
+                frameOffset = 0;
+                frameFilledLen = mConfig->outputFrameSize * sizeof(int16_t);
+            }
+
+            if (numFramesInBuffer == 0) {
+                outHeader->nOffset = frameOffset;
+                outHeader->nFilledLen = frameFilledLen;
+                outHeader->nTimeStamp =
+                    mAnchorTimeUs + (mNumFramesOutput * 1000000ll) / mSamplingRate;
+                tmpTime = outHeader->nTimeStamp;
+            } else {
+                // only the first frame after a flush is trimmed, and that one
+                // starts an output buffer
+                CHECK_EQ(frameOffset, 0u);
+                outHeader->nFilledLen += frameFilledLen;
+            }
+            if (inHeader) {
+                size_t usedLength = mConfig->inputBufferUsedLength;
+                if (hasFrameLength) {
+                    usedLength = sizeof(frameLength) + frameLength;
+                }
 
-        outHeader->nTimeStamp =
-            mAnchorTimeUs + (mNumFramesOutput * 1000000ll) / mSamplingRate;
-        tmpTime = outHeader->nTimeStamp;
-        if (inHeader) {
-            CHECK_GE(inHeader->nFilledLen, mConfig->inputBufferUsedLength);
+                CHECK_GE(inHeader->nFilledLen, usedLength);
 
-            inHeader->nOffset += mConfig->inputBufferUsedLength;
-            inHeader->nFilledLen -= mConfig->inputBufferUsedLength;
+                inHeader->nOffset += usedLength;
+                inHeader->nFilledLen -= usedLength;
 
 
-            if (inHeader->nFilledLen == 0) {
-                inInfo->mOwnedByUs = false;
-                inQueue.erase(inQueue.begin());
-                inInfo = NULL;
-                notifyEmptyBufferDone(inHeader);
-                inHeader = NULL;
+                if (inHeader->nFilledLen == 0) {
+                    if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+                        mSawInputEos = true;
+                    }
+
+                    inInfo->mOwnedByUs = false;
+                    inQueue.erase(inQueue.begin());
+                    inInfo = NULL;
+                    notifyEmptyBufferDone(inHeader);
+                    inHeader = NULL;
+                }
             }
-        }
 
-        mNumFramesOutput += mConfig->outputFrameSize / mNumChannels;
+            mNumFramesOutput += mConfig->outputFrameSize / mNumChannels;
+            ++numFramesInBuffer;
+        } while (numFramesInBuffer < mMaxFramesPerBuffer
+                && !mSignalledOutputEos
+                && (!inQueue.empty() || mSawInputEos)
+                && outHeader->nAllocLen - outHeader->nOffset - outHeader->nFilledLen
+                        >= (OMX_U32)kOutputBufferSize);
 
         outInfo->mOwnedByUs = false;
         outQueue.erase(outQueue.begin());
@@ -39,6 +39,9 @@ protected:
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onPortEnableCompleted(OMX_U32 portIndex, bool enabled);
@@ -48,7 +51,8 @@ private:
     enum {
         kNumBuffers = 4,
         kOutputBufferSize = 4608 * 2,
-        kPVMP3DecoderDelay = 529 // frames
+        kPVMP3DecoderDelay = 529, // frames
+        kMaxFramesPerBuffer = 16
     };
 
     tPVMP3DecoderExternal *mConfig;
@@ -59,6 +63,11 @@ private:
     int32_t mNumChannels;
     int32_t mSamplingRate;
 
+    // With more than one frame per buffer, input buffers hold a sequence of
+    // frames each preceded by its length, and output buffers the PCM of as
+    // many of them as fit.
+    int32_t mMaxFramesPerBuffer;
+
     bool mIsFirst;
     bool mSignalledError;
     bool mSawInputEos;
@@ -75,7 +84,7 @@ private:
 
     void initPorts();
     void initDecoder();
-    void *memsetSafe(OMX_BUFFERHEADERTYPE *outHeader, int c, size_t len);
+    void *memsetSafe(OMX_BUFFERHEADERTYPE *outHeader, size_t offset, int c, size_t len);
 
     DISALLOW_EVIL_CONSTRUCTORS(SoftMP3);
 };
@@ -0,0 +1,171 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ Fixed point functions of pv_mp3dec_fxd_op_c_equivalent.h working on four
+ int32 at once, bit-exact with the scalar ones.
+
+ SSE2 has no signed 32x32->64 bit multiply, so the SSE2 forms correct the
+ signs of unsigned products. SSE4.1 has one (pmuldq), but the 32 bit x86
+ Android ABI does not include SSE4.1. The functions therefore come in two
+ forms, chosen by the template argument SSE41, and the kernels using them
+ are instantiated for both. x86_has_sse41() picks one at runtime. The
+ SSE4.1 form uses inline assembly, so that the file still builds for plain
+ SSE2.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef PV_MP3DEC_FXD_OP_SSE2_H
+#define PV_MP3DEC_FXD_OP_SSE2_H
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+#include "pvmp3_audio_type_defs.h"
+#include "x86_cpu_features.h"
+
+/* the signed 64 bit products of the even lanes, pmuldq */
+static inline __m128i fxp_mul_epi32_sse41(__m128i a, __m128i b)
+{
+#if defined(__SSE4_1__)
+    return _mm_mul_epi32(a, b);
+#else
+    __asm__("pmuldq %1, %0" : "+x"(a) : "x"(b));
+    return a;
+#endif
+}
+
+/* (int32)(((int64)a * b) >> n) of each lane, 0 < n <= 32 */
+template <int32 SSE41>
+static inline __m128i fxp_mul32_Qn_sse2(__m128i a, __m128i b, const int32 n)
+{
+    const __m128i hi_mask = _mm_set_epi32(-1, 0, -1, 0);
+    __m128i a_odd = _mm_srli_epi64(a, 32);
+    __m128i b_odd = _mm_srli_epi64(b, 32);
+    __m128i even, odd;
+
+    if (SSE41)
+    {
+        even = fxp_mul_epi32_sse41(a, b);
+        odd = fxp_mul_epi32_sse41(a_odd, b_odd);
+    }
+    else
+    {
+        /* unsigned products, the high halves are then fixed up for the signs */
+        __m128i fix = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b),
+                                    _mm_and_si128(_mm_srai_epi32(b, 31), a));
+        even = _mm_sub_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(fix, 32));
+        odd = _mm_sub_epi64(_mm_mul_epu32(a_odd, b_odd), _mm_and_si128(fix, hi_mask));
+    }
+
+    even = _mm_srli_epi64(even, n);
+    odd = _mm_slli_epi64(odd, 32 - n);
+
+    return _mm_or_si128(_mm_andnot_si128(hi_mask, even), _mm_and_si128(hi_mask, odd));
+}
+
+template <int32 SSE41>
+static inline __m128i fxp_mul32_Q32_sse2(__m128i a, __m128i b)
+{
+    return fxp_mul32_Qn_sse2<SSE41>(a, b, 32);
+}
+
+template <int32 SSE41>
+static inline __m128i fxp_mac32_Q32_sse2(__m128i L_add, __m128i a, __m128i b)
+{
+    return _mm_add_epi32(L_add, fxp_mul32_Qn_sse2<SSE41>(a, b, 32));
+}
+
+/*
+ *  Sums of many fxp_mac32_Q32()/fxp_msb32_Q32() terms. Only the high halves of
+ *  the 64 bit products are added up, even and odd lanes apart, and the sign
+ *  corrections of the SSE2 products go in a sum of their own, so that each
+ *  term costs no shifts. fxp_acc_sum32_Q32_sse2() gives the four sums.
+ */
+typedef struct
+{
+    __m128i even;
+    __m128i odd;
+    __m128i fix;
+} fxp_acc32_Q32_sse2;
+
+static inline void fxp_acc_init32_Q32_sse2(fxp_acc32_Q32_sse2 *acc, int32 L_init)
+{
+    acc->even = _mm_setzero_si128();
+    acc->odd = _mm_setzero_si128();
+    acc->fix = _mm_set1_epi32(-L_init);
+}
+
+template <int32 SSE41>
+static inline void fxp_acc_mac32_Q32_sse2(fxp_acc32_Q32_sse2 *acc, __m128i a, __m128i b)
+{
+    __m128i a_odd = _mm_srli_epi64(a, 32);
+    __m128i b_odd = _mm_srli_epi64(b, 32);
+
+    if (SSE41)
+    {
+        acc->even = _mm_add_epi32(acc->even, fxp_mul_epi32_sse41(a, b));
+        acc->odd = _mm_add_epi32(acc->odd, fxp_mul_epi32_sse41(a_odd, b_odd));
+    }
+    else
+    {
+        acc->even = _mm_add_epi32(acc->even, _mm_mul_epu32(a, b));
+        acc->odd = _mm_add_epi32(acc->odd, _mm_mul_epu32(a_odd, b_odd));
+        acc->fix = _mm_add_epi32(acc->fix, _mm_and_si128(_mm_srai_epi32(a, 31), b));
+        acc->fix = _mm_add_epi32(acc->fix, _mm_and_si128(_mm_srai_epi32(b, 31), a));
+    }
+}
+
+template <int32 SSE41>
+static inline void fxp_acc_msb32_Q32_sse2(fxp_acc32_Q32_sse2 *acc, __m128i a, __m128i b)
+{
+    __m128i a_odd = _mm_srli_epi64(a, 32);
+    __m128i b_odd = _mm_srli_epi64(b, 32);
+
+    if (SSE41)
+    {
+        acc->even = _mm_sub_epi32(acc->even, fxp_mul_epi32_sse41(a, b));
+        acc->odd = _mm_sub_epi32(acc->odd, fxp_mul_epi32_sse41(a_odd, b_odd));
+    }
+    else
+    {
+        acc->even = _mm_sub_epi32(acc->even, _mm_mul_epu32(a, b));
+        acc->odd = _mm_sub_epi32(acc->odd, _mm_mul_epu32(a_odd, b_odd));
+        acc->fix = _mm_sub_epi32(acc->fix, _mm_and_si128(_mm_srai_epi32(a, 31), b));
+        acc->fix = _mm_sub_epi32(acc->fix, _mm_and_si128(_mm_srai_epi32(b, 31), a));
+    }
+}
+
+static inline __m128i fxp_acc_sum32_Q32_sse2(const fxp_acc32_Q32_sse2 *acc)
+{
+    const __m128i hi_mask = _mm_set_epi32(-1, 0, -1, 0);
+    __m128i sum = _mm_or_si128(_mm_srli_epi64(acc->even, 32), _mm_and_si128(hi_mask, acc->odd));
+
+    return _mm_sub_epi32(sum, acc->fix);
+}
+
+#endif /* __SSE2__ */
+
+#endif  /* PV_MP3DEC_FXD_OP_SSE2_H */
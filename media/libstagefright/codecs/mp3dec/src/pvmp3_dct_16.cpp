@@ -97,6 +97,7 @@ Input
 
 #include "pvmp3_dct_16.h"
 #include "pv_mp3dec_fxd_op.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -407,4 +408,311 @@ void pvmp3_split(int32 *vect)
 
 }
 
+#if defined(__SSE2__)
+
+/*
+ *  The functions above on four time slots at once, one in each lane
+ */
+
+#define ADD(a, b)   _mm_add_epi32(a, b)
+#define SUB(a, b)   _mm_sub_epi32(a, b)
+#define NEG(a)      _mm_sub_epi32(_mm_setzero_si128(), a)
+#define SHL(a, n)   _mm_slli_epi32(a, n)
+
+template <int32 SSE41>
+static inline __m128i mul_cos_x4(__m128i a, int32 cosx)
+{
+    return fxp_mul32_Q32_sse2<SSE41>(a, _mm_set1_epi32(cosx));
+}
+
+template <int32 SSE41>
+static void pvmp3_dct_16_x4(__m128i vec[], int32 flag)
+{
+    __m128i tmp0;
+    __m128i tmp1;
+    __m128i tmp2;
+    __m128i tmp3;
+    __m128i tmp4;
+    __m128i tmp5;
+    __m128i tmp6;
+    __m128i tmp7;
+    __m128i tmp_o0;
+    __m128i tmp_o1;
+    __m128i tmp_o2;
+    __m128i tmp_o3;
+    __m128i tmp_o4;
+    __m128i tmp_o5;
+    __m128i tmp_o6;
+    __m128i tmp_o7;
+    __m128i itmp_e0;
+    __m128i itmp_e1;
+    __m128i itmp_e2;
+
+    /*  split input vector */
+
+    tmp_o0 = mul_cos_x4<SSE41>(SUB(vec[ 0], vec[15]), Qfmt_31(0.50241928618816F));
+    tmp0   = ADD(vec[ 0], vec[15]);
+
+    tmp_o7 = mul_cos_x4<SSE41>(SHL(SUB(vec[ 7], vec[ 8]), 3), Qfmt_31(0.63764357733614F));
+    tmp7   = ADD(vec[ 7], vec[ 8]);
+
+    itmp_e0 = mul_cos_x4<SSE41>(SUB(tmp0, tmp7), Qfmt_31(0.50979557910416F));
+    tmp7    = ADD(tmp0, tmp7);
+
+    tmp_o1 = mul_cos_x4<SSE41>(SUB(vec[ 1], vec[14]), Qfmt_31(0.52249861493969F));
+    tmp1   = ADD(vec[ 1], vec[14]);
+
+    tmp_o6 = mul_cos_x4<SSE41>(SHL(SUB(vec[ 6], vec[ 9]), 1), Qfmt_31(0.86122354911916F));
+    tmp6   = ADD(vec[ 6], vec[ 9]);
+
+    itmp_e1 = ADD(tmp1, tmp6);
+    tmp6    = mul_cos_x4<SSE41>(SUB(tmp1, tmp6), Qfmt_31(0.60134488693505F));
+
+    tmp_o2 = mul_cos_x4<SSE41>(SUB(vec[ 2], vec[13]), Qfmt_31(0.56694403481636F));
+    tmp2   = ADD(vec[ 2], vec[13]);
+    tmp_o5 = mul_cos_x4<SSE41>(SHL(SUB(vec[ 5], vec[10]), 1), Qfmt_31(0.53033884299517F));
+    tmp5   = ADD(vec[ 5], vec[10]);
+
+    itmp_e2 = ADD(tmp2, tmp5);
+    tmp5    = mul_cos_x4<SSE41>(SUB(tmp2, tmp5), Qfmt_31(0.89997622313642F));
+
+    tmp_o3 = mul_cos_x4<SSE41>(SUB(vec[ 3], vec[12]), Qfmt_31(0.64682178335999F));
+    tmp3   = ADD(vec[ 3], vec[12]);
+    tmp_o4 = mul_cos_x4<SSE41>(SUB(vec[ 4], vec[11]), Qfmt_31(0.78815462345125F));
+    tmp4   = ADD(vec[ 4], vec[11]);
+
+    tmp1   = ADD(tmp3, tmp4);
+    tmp4   = mul_cos_x4<SSE41>(SHL(SUB(tmp3, tmp4), 2), Qfmt_31(0.64072886193538F));
+
+    /*  split even part of tmp_e */
+
+    tmp0 = ADD(tmp7, tmp1);
+    tmp1 = mul_cos_x4<SSE41>(SUB(tmp7, tmp1), Qfmt_31(0.54119610014620F));
+
+    tmp3 = mul_cos_x4<SSE41>(SHL(SUB(itmp_e1, itmp_e2), 1), Qfmt_31(0.65328148243819F));
+    tmp7 = ADD(itmp_e1, itmp_e2);
+
+    vec[ 0]  = _mm_srai_epi32(ADD(tmp0, tmp7), 1);
+    vec[ 8]  = mul_cos_x4<SSE41>(SUB(tmp0, tmp7), Qfmt_31(0.70710678118655F));
+    tmp0     = mul_cos_x4<SSE41>(SHL(SUB(tmp1, tmp3), 1), Qfmt_31(0.70710678118655F));
+    vec[ 4]  = ADD(ADD(tmp1, tmp3), tmp0);
+    vec[12]  = tmp0;
+
+    /*  split odd part of tmp_e */
+
+    tmp1 = mul_cos_x4<SSE41>(SHL(SUB(itmp_e0, tmp4), 1), Qfmt_31(0.54119610014620F));
+    tmp7 = ADD(itmp_e0, tmp4);
+
+    tmp3 = mul_cos_x4<SSE41>(SHL(SUB(tmp6, tmp5), 2), Qfmt_31(0.65328148243819F));
+    tmp6 = ADD(tmp6, tmp5);
+
+    tmp4 = mul_cos_x4<SSE41>(SHL(SUB(tmp7, tmp6), 1), Qfmt_31(0.70710678118655F));
+    tmp6 = ADD(tmp6, tmp7);
+    tmp7 = mul_cos_x4<SSE41>(SHL(SUB(tmp1, tmp3), 1), Qfmt_31(0.70710678118655F));
+
+    tmp1     = ADD(tmp1, ADD(tmp3, tmp7));
+    vec[ 2]  = ADD(tmp1, tmp6);
+    vec[ 6]  = ADD(tmp1, tmp4);
+    vec[10]  = ADD(tmp7, tmp4);
+    vec[14]  = tmp7;
+
+
+    // dct8;
+
+    tmp1 = mul_cos_x4<SSE41>(SHL(SUB(tmp_o0, tmp_o7), 1), Qfmt_31(0.50979557910416F));
+    tmp7 = ADD(tmp_o0, tmp_o7);
+
+    tmp6   = ADD(tmp_o1, tmp_o6);
+    tmp_o1 = mul_cos_x4<SSE41>(SHL(SUB(tmp_o1, tmp_o6), 1), Qfmt_31(0.60134488693505F));
+
+    tmp5   = ADD(tmp_o2, tmp_o5);
+    tmp_o5 = mul_cos_x4<SSE41>(SHL(SUB(tmp_o2, tmp_o5), 1), Qfmt_31(0.89997622313642F));
+
+    tmp0 = mul_cos_x4<SSE41>(SHL(SUB(tmp_o3, tmp_o4), 3), Qfmt_31(0.6407288619354F));
+    tmp4 = ADD(tmp_o3, tmp_o4);
+
+    if (!flag)
+    {
+        tmp7   = NEG(tmp7);
+        tmp1   = NEG(tmp1);
+        tmp6   = NEG(tmp6);
+        tmp_o1 = NEG(tmp_o1);
+        tmp5   = NEG(tmp5);
+        tmp_o5 = NEG(tmp_o5);
+        tmp4   = NEG(tmp4);
+        tmp0   = NEG(tmp0);
+    }
+
+
+    tmp2    = mul_cos_x4<SSE41>(SHL(SUB(tmp1, tmp0), 1), Qfmt_31(0.54119610014620F));
+    tmp0    = ADD(tmp0, tmp1);
+    tmp1    = mul_cos_x4<SSE41>(SHL(SUB(tmp7, tmp4), 1), Qfmt_31(0.54119610014620F));
+    tmp7    = ADD(tmp7, tmp4);
+    tmp4    = mul_cos_x4<SSE41>(SHL(SUB(tmp6, tmp5), 2), Qfmt_31(0.65328148243819F));
+    tmp6    = ADD(tmp6, tmp5);
+    tmp5    = mul_cos_x4<SSE41>(SHL(SUB(tmp_o1, tmp_o5), 2), Qfmt_31(0.65328148243819F));
+    tmp_o1  = ADD(tmp_o1, tmp_o5);
+
+
+    vec[13]  = mul_cos_x4<SSE41>(SHL(SUB(tmp1, tmp4), 1), Qfmt_31(0.70710678118655F));
+    vec[ 5]  = ADD(ADD(tmp1, tmp4), vec[13]);
+
+    vec[ 9]  = mul_cos_x4<SSE41>(SHL(SUB(tmp7, tmp6), 1), Qfmt_31(0.70710678118655F));
+    vec[ 1]  = ADD(tmp7, tmp6);
+
+    tmp4     = mul_cos_x4<SSE41>(SHL(SUB(tmp0, tmp_o1), 1), Qfmt_31(0.70710678118655F));
+    tmp0     = ADD(tmp0, tmp_o1);
+    tmp6     = mul_cos_x4<SSE41>(SHL(SUB(tmp2, tmp5), 1), Qfmt_31(0.70710678118655F));
+    tmp2     = ADD(tmp2, ADD(tmp5, tmp6));
+    tmp0     = ADD(tmp0, tmp2);
+
+    vec[ 1]  = ADD(vec[ 1], tmp0);
+    vec[ 3]  = ADD(tmp0, vec[ 5]);
+    tmp2     = ADD(tmp2, tmp4);
+    vec[ 5]  = ADD(tmp2, vec[ 5]);
+    vec[ 7]  = ADD(tmp2, vec[ 9]);
+    tmp4     = ADD(tmp4, tmp6);
+    vec[ 9]  = ADD(tmp4, vec[ 9]);
+    vec[11]  = ADD(tmp4, vec[13]);
+    vec[13]  = ADD(tmp6, vec[13]);
+    vec[15]  = tmp6;
+}
+
+static void pvmp3_merge_in_place_N32_x4(__m128i vec[])
+{
+    __m128i temp0;
+    __m128i temp1;
+    __m128i temp2;
+    __m128i temp3;
+
+    temp0   = vec[14];
+    vec[14] = vec[ 7];
+    temp1   = vec[12];
+    vec[12] = vec[ 6];
+    temp2   = vec[10];
+    vec[10] = vec[ 5];
+    temp3   = vec[ 8];
+    vec[ 8] = vec[ 4];
+    vec[ 6] = vec[ 3];
+    vec[ 4] = vec[ 2];
+    vec[ 2] = vec[ 1];
+
+    vec[ 1] = ADD(vec[16], vec[17]);
+    vec[16] = temp3;
+    vec[ 3] = ADD(vec[18], vec[17]);
+    vec[ 5] = ADD(vec[19], vec[18]);
+    vec[18] = vec[9];
+
+    vec[ 7] = ADD(vec[20], vec[19]);
+    vec[ 9] = ADD(vec[21], vec[20]);
+    vec[20] = temp2;
+    temp2   = vec[13];
+    temp3   = vec[11];
+    vec[11] = ADD(vec[22], vec[21]);
+    vec[13] = ADD(vec[23], vec[22]);
+    vec[22] = temp3;
+    temp3   = vec[15];
+
+    vec[15] = ADD(vec[24], vec[23]);
+    vec[17] = ADD(vec[25], vec[24]);
+    vec[19] = ADD(vec[26], vec[25]);
+    vec[21] = ADD(vec[27], vec[26]);
+    vec[23] = ADD(vec[28], vec[27]);
+    vec[24] = temp1;
+    vec[25] = ADD(vec[29], vec[28]);
+    vec[26] = temp2;
+    vec[27] = ADD(vec[30], vec[29]);
+    vec[28] = temp0;
+    vec[29] = ADD(vec[30], vec[31]);
+    vec[30] = temp3;
+}
+
+template <int32 SSE41>
+static void pvmp3_split_x4(__m128i *vect)
+{
+    int32 i;
+
+    for (i = 0; i < 16; i++)
+    {
+        __m128i tmp2 = vect[i];
+        __m128i tmp1 = vect[-1 - i];
+        int32 cosx = CosTable_dct32[15 - i];
+
+        vect[-1 - i] = ADD(tmp1, tmp2);
+        if (i < 6)
+        {
+            vect[i] = fxp_mul32_Qn_sse2<SSE41>(SUB(tmp1, tmp2), _mm_set1_epi32(cosx), 27);
+        }
+        else
+        {
+            vect[i] = mul_cos_x4<SSE41>(SHL(SUB(tmp1, tmp2), 1), cosx);
+        }
+    }
+}
+
+/*
+ *  pvmp3_split(), the two pvmp3_dct_16() and pvmp3_merge_in_place_N32() of
+ *  the 4 consecutive blocks of 32 values at vec[0..127]
+ */
+template <int32 SSE41>
+static void pvmp3_dct_32_x4_kernel(int32 vec[])
+{
+    __m128i v[32];
+    int32 n;
+
+    for (n = 0; n < 32; n += 4)
+    {
+        __m128i r0 = _mm_loadu_si128((__m128i *)&vec[ 0 + n]);
+        __m128i r1 = _mm_loadu_si128((__m128i *)&vec[32 + n]);
+        __m128i r2 = _mm_loadu_si128((__m128i *)&vec[64 + n]);
+        __m128i r3 = _mm_loadu_si128((__m128i *)&vec[96 + n]);
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        v[n    ] = _mm_unpacklo_epi64(t0, t1);
+        v[n + 1] = _mm_unpackhi_epi64(t0, t1);
+        v[n + 2] = _mm_unpacklo_epi64(t2, t3);
+        v[n + 3] = _mm_unpackhi_epi64(t2, t3);
+    }
+
+    pvmp3_split_x4<SSE41>(&v[16]);
+
+    pvmp3_dct_16_x4<SSE41>(&v[16], 0);
+    pvmp3_dct_16_x4<SSE41>(v, 1);     // Even terms
+
+    pvmp3_merge_in_place_N32_x4(v);
+
+    for (n = 0; n < 32; n += 4)
+    {
+        __m128i t0 = _mm_unpacklo_epi32(v[n    ], v[n + 1]);
+        __m128i t1 = _mm_unpacklo_epi32(v[n + 2], v[n + 3]);
+        __m128i t2 = _mm_unpackhi_epi32(v[n    ], v[n + 1]);
+        __m128i t3 = _mm_unpackhi_epi32(v[n + 2], v[n + 3]);
+        _mm_storeu_si128((__m128i *)&vec[ 0 + n], _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)&vec[32 + n], _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)&vec[64 + n], _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128((__m128i *)&vec[96 + n], _mm_unpackhi_epi64(t2, t3));
+    }
+}
+
+void pvmp3_dct_32_x4(int32 vec[])
+{
+    if (x86_has_sse41())
+    {
+        pvmp3_dct_32_x4_kernel<1>(vec);
+    }
+    else
+    {
+        pvmp3_dct_32_x4_kernel<0>(vec);
+    }
+}
+
+#undef ADD
+#undef SUB
+#undef NEG
+#undef SHL
+
+#endif /* __SSE2__ */
+
 #endif
@@ -84,6 +84,13 @@ extern "C"
 
     void pvmp3_split(int32 *vect);
 
+#if defined(__SSE2__)
+
+    /* the DCT 32 of 4 time slots, 32 values apart, at once */
+    void pvmp3_dct_32_x4(int32 vec[]);
+
+#endif /* __SSE2__ */
+
 
 #ifdef __cplusplus
 }
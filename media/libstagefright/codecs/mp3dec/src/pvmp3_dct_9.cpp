@@ -65,6 +65,7 @@ Returns
 #include "pvmp3_audio_type_defs.h"
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -163,5 +164,68 @@ void pvmp3_dct_9(int32 vec[])
 }
 
 
+#if defined(__SSE2__)
+
+/*
+ *  pvmp3_dct_9() of four bands, one in each lane
+ */
+template <int32 SSE41>
+void pvmp3_dct_9_x4(__m128i vec[])
+{
+    __m128i tmp0 = _mm_add_epi32(vec[8], vec[0]);
+    __m128i tmp8 = _mm_sub_epi32(vec[8], vec[0]);
+    __m128i tmp1 = _mm_add_epi32(vec[7], vec[1]);
+    __m128i tmp7 = _mm_sub_epi32(vec[7], vec[1]);
+    __m128i tmp2 = _mm_add_epi32(vec[6], vec[2]);
+    __m128i tmp6 = _mm_sub_epi32(vec[6], vec[2]);
+    __m128i tmp3 = _mm_add_epi32(vec[5], vec[3]);
+    __m128i tmp5 = _mm_sub_epi32(vec[5], vec[3]);
+    __m128i tmp023 = _mm_add_epi32(_mm_add_epi32(tmp0, tmp2), tmp3);
+    __m128i tmp14 = _mm_add_epi32(tmp1, vec[4]);
+
+    vec[0]  = _mm_add_epi32(tmp023, tmp14);
+    vec[6]  = _mm_sub_epi32(_mm_srai_epi32(tmp023, 1), tmp14);
+    vec[2]  = _mm_sub_epi32(_mm_srai_epi32(tmp1, 1), vec[4]);
+    vec[4]  = _mm_sub_epi32(_mm_setzero_si128(), vec[2]);
+    vec[8]  = vec[4];
+
+    tmp0 = _mm_slli_epi32(tmp0, 1);
+    tmp2 = _mm_slli_epi32(tmp2, 1);
+    tmp3 = _mm_slli_epi32(tmp3, 1);
+    vec[4]  = fxp_mac32_Q32_sse2<SSE41>(vec[4], tmp0, _mm_set1_epi32(cos_2pi_9));
+    vec[8]  = fxp_mac32_Q32_sse2<SSE41>(vec[8], tmp0, _mm_set1_epi32(cos_4pi_9));
+    vec[2]  = fxp_mac32_Q32_sse2<SSE41>(vec[2], tmp0, _mm_set1_epi32(cos_pi_9));
+    vec[2]  = fxp_mac32_Q32_sse2<SSE41>(vec[2], tmp2, _mm_set1_epi32(cos_5pi_9));
+    vec[4]  = fxp_mac32_Q32_sse2<SSE41>(vec[4], tmp2, _mm_set1_epi32(cos_8pi_9));
+    vec[8]  = fxp_mac32_Q32_sse2<SSE41>(vec[8], tmp2, _mm_set1_epi32(cos_2pi_9));
+    vec[8]  = fxp_mac32_Q32_sse2<SSE41>(vec[8], tmp3, _mm_set1_epi32(cos_8pi_9));
+    vec[4]  = fxp_mac32_Q32_sse2<SSE41>(vec[4], tmp3, _mm_set1_epi32(cos_4pi_9));
+    vec[2]  = fxp_mac32_Q32_sse2<SSE41>(vec[2], tmp3, _mm_set1_epi32(cos_7pi_9));
+
+    __m128i tmp568 = _mm_slli_epi32(_mm_sub_epi32(_mm_add_epi32(tmp5, tmp6), tmp8), 1);
+    tmp5 = _mm_slli_epi32(tmp5, 1);
+    tmp6 = _mm_slli_epi32(tmp6, 1);
+    tmp7 = _mm_slli_epi32(tmp7, 1);
+    tmp8 = _mm_slli_epi32(tmp8, 1);
+    vec[1]  = fxp_mul32_Q32_sse2<SSE41>(tmp5, _mm_set1_epi32(cos_11pi_18));
+    vec[1]  = fxp_mac32_Q32_sse2<SSE41>(vec[1], tmp6, _mm_set1_epi32(cos_13pi_18));
+    vec[1]  = fxp_mac32_Q32_sse2<SSE41>(vec[1], tmp7, _mm_set1_epi32(cos_5pi_6));
+    vec[1]  = fxp_mac32_Q32_sse2<SSE41>(vec[1], tmp8, _mm_set1_epi32(cos_17pi_18));
+    vec[3]  = fxp_mul32_Q32_sse2<SSE41>(tmp568, _mm_set1_epi32(cos_pi_6));
+    vec[5]  = fxp_mul32_Q32_sse2<SSE41>(tmp5, _mm_set1_epi32(cos_17pi_18));
+    vec[5]  = fxp_mac32_Q32_sse2<SSE41>(vec[5], tmp6, _mm_set1_epi32(cos_7pi_18));
+    vec[5]  = fxp_mac32_Q32_sse2<SSE41>(vec[5], tmp7, _mm_set1_epi32(cos_pi_6));
+    vec[5]  = fxp_mac32_Q32_sse2<SSE41>(vec[5], tmp8, _mm_set1_epi32(cos_13pi_18));
+    vec[7]  = fxp_mul32_Q32_sse2<SSE41>(tmp5, _mm_set1_epi32(cos_5pi_18));
+    vec[7]  = fxp_mac32_Q32_sse2<SSE41>(vec[7], tmp6, _mm_set1_epi32(cos_17pi_18));
+    vec[7]  = fxp_mac32_Q32_sse2<SSE41>(vec[7], tmp7, _mm_set1_epi32(cos_pi_6));
+    vec[7]  = fxp_mac32_Q32_sse2<SSE41>(vec[7], tmp8, _mm_set1_epi32(cos_11pi_18));
+}
+
+template void pvmp3_dct_9_x4<0>(__m128i vec[]);
+template void pvmp3_dct_9_x4<1>(__m128i vec[]);
+
+#endif /* __SSE2__ */
+
 
 #endif // If not assembly
@@ -96,6 +96,7 @@ Input
 #include "pvmp3_normalize.h"
 #include "mp3_mem_funcs.h"
 #include "pvmp3_tables.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -178,6 +179,46 @@ int32 power_1_third(int32 xx)
 }
 
 
+#if defined(__SSE2__)
+
+/*
+ *  The scaling of the long block loops below on n lines, four at a time,
+ *  for -32 < global_gain < 32. The table lookups of power_1_third() stay
+ *  scalar
+ */
+template <int32 SSE41>
+static void pvmp3_dequantize_x4(int32 is[], int32 n, int32 two_raise_one_fourth, int32 global_gain)
+{
+    const __m128i two = _mm_set1_epi32(two_raise_one_fourth);
+    const __m128i lshift = _mm_cvtsi32_si128((global_gain > 0) ? global_gain : 0);
+    const __m128i rshift = _mm_cvtsi32_si128((global_gain < 0) ? -global_gain : 0);
+    int32 ss;
+
+    for (ss = 0; ss + 4 <= n; ss += 4)
+    {
+        __m128i tmp = _mm_loadu_si128((__m128i *)&is[ss]);
+        __m128i p13 = _mm_set_epi32(power_1_third(pv_abs(is[ss+3])),
+                                    power_1_third(pv_abs(is[ss+2])),
+                                    power_1_third(pv_abs(is[ss+1])),
+                                    power_1_third(pv_abs(is[ss])));
+
+        tmp = fxp_mul32_Qn_sse2<SSE41>(_mm_slli_epi32(tmp, 16), p13, 30);
+        tmp = fxp_mul32_Qn_sse2<SSE41>(tmp, two, 30);
+        tmp = _mm_sra_epi32(_mm_sll_epi32(tmp, lshift), rshift);
+        _mm_storeu_si128((__m128i *)&is[ss], tmp);
+    }
+
+    for (; ss < n; ss++)
+    {
+        int32 tmp = fxp_mul32_Q30((is[ss] << 16), power_1_third(pv_abs(is[ss])));
+        tmp = fxp_mul32_Q30(tmp, two_raise_one_fourth);
+        is[ss] = (global_gain < 0) ? (tmp >> -global_gain) : (tmp << global_gain);
+    }
+}
+
+#endif /* __SSE2__ */
+
+
 /*----------------------------------------------------------------------------
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
@@ -338,6 +379,30 @@ void pvmp3_dequantize_sample(int32 is[SUBBANDS_NUMBER*FILTERBANK_BANDS],
              *       xr[sb][ss] = 2^(global_gain/4)
              */
 
+#if defined(__SSE2__)
+            if (global_gain > -32 && global_gain < 32)
+            {
+                int32 begin = mp3_sfBandIndex[sfreq].l[cb];
+                int32 end   = mp3_sfBandIndex[sfreq].l[cb+1];
+
+                if (used_freq_lines < end)
+                {
+                    end = used_freq_lines;
+                    cb = 22;  // force breaking out of the loop
+                }
+
+                if (x86_has_sse41())
+                {
+                    pvmp3_dequantize_x4<1>(&is[begin], end - begin, two_raise_one_fourth, global_gain);
+                }
+                else
+                {
+                    pvmp3_dequantize_x4<0>(&is[begin], end - begin, two_raise_one_fourth, global_gain);
+                }
+                continue;
+            }
+#endif
+
             /* Scale quantized value. */
 
             if (used_freq_lines >= mp3_sfBandIndex[sfreq].l[cb+1])
@@ -236,6 +236,10 @@ void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
      */
 
 
+#if defined(__SSE2__)
+    int32 x4_end = 0;
+#endif
+
     for (band = 0; band < bands2process; band++)
     {
         uint32 current_blk_type = (band < mx_band) ? LONG : blk_type;
@@ -243,6 +247,22 @@ void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
         int32 * out     = in      + (band * FILTERBANK_BANDS);
         int32 * history = overlap + (band * FILTERBANK_BANDS);
 
+#if defined(__SSE2__)
+        /*
+         *  long transforms of 4 bands with the same window at once
+         */
+        if (band >= x4_end && band + 4 <= bands2process && current_blk_type != SHORT &&
+                current_blk_type == (uint32)((band + 3 < mx_band) ? LONG : blk_type))
+        {
+            const int32 *window = (current_blk_type == LONG) ? normal_win :
+                                  (current_blk_type == START) ? start_win : stop_win;
+
+            pvmp3_mdct_18_x4(out, history, window);
+            x4_end = band + 4;
+        }
+
+        if (band >= x4_end)
+#endif
         switch (current_blk_type)
         {
             case LONG:
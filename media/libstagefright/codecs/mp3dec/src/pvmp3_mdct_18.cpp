@@ -70,6 +70,7 @@ Returns
 
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 
 /*----------------------------------------------------------------------------
@@ -286,4 +287,235 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     history[11] = fxp_mul32_Q32(tmp,  window[29]);
 }
 
+
+#if defined(__SSE2__)
+
+/*
+ *  The 18 values of 4 bands, one after the other in memory, to and from
+ *  one vector per value with the bands in the lanes
+ */
+static void pvmp3_load_x4(__m128i v[], const int32 *p)
+{
+    for (int32 n = 0; n < 16; n += 4)
+    {
+        __m128i r0 = _mm_loadu_si128((const __m128i *)&p[ 0 + n]);
+        __m128i r1 = _mm_loadu_si128((const __m128i *)&p[18 + n]);
+        __m128i r2 = _mm_loadu_si128((const __m128i *)&p[36 + n]);
+        __m128i r3 = _mm_loadu_si128((const __m128i *)&p[54 + n]);
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        v[n    ] = _mm_unpacklo_epi64(t0, t1);
+        v[n + 1] = _mm_unpackhi_epi64(t0, t1);
+        v[n + 2] = _mm_unpacklo_epi64(t2, t3);
+        v[n + 3] = _mm_unpackhi_epi64(t2, t3);
+    }
+    v[16] = _mm_set_epi32(p[70], p[52], p[34], p[16]);
+    v[17] = _mm_set_epi32(p[71], p[53], p[35], p[17]);
+}
+
+static void pvmp3_store_x4(int32 *p, const __m128i v[])
+{
+    int32 tmp[8];
+
+    for (int32 n = 0; n < 16; n += 4)
+    {
+        __m128i t0 = _mm_unpacklo_epi32(v[n    ], v[n + 1]);
+        __m128i t1 = _mm_unpacklo_epi32(v[n + 2], v[n + 3]);
+        __m128i t2 = _mm_unpackhi_epi32(v[n    ], v[n + 1]);
+        __m128i t3 = _mm_unpackhi_epi32(v[n + 2], v[n + 3]);
+        _mm_storeu_si128((__m128i *)&p[ 0 + n], _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)&p[18 + n], _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)&p[36 + n], _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128((__m128i *)&p[54 + n], _mm_unpackhi_epi64(t2, t3));
+    }
+    _mm_storeu_si128((__m128i *)&tmp[0], _mm_unpacklo_epi32(v[16], v[17]));
+    _mm_storeu_si128((__m128i *)&tmp[4], _mm_unpackhi_epi32(v[16], v[17]));
+    p[16] = tmp[0];
+    p[17] = tmp[1];
+    p[34] = tmp[2];
+    p[35] = tmp[3];
+    p[52] = tmp[4];
+    p[53] = tmp[5];
+    p[70] = tmp[6];
+    p[71] = tmp[7];
+}
+
+static inline __m128i pvmp3_neg_x4(__m128i a)
+{
+    return _mm_sub_epi32(_mm_setzero_si128(), a);
+}
+
+template <int32 SSE41>
+static inline __m128i pvmp3_mac_win_x4(__m128i L_add, __m128i a, int32 win)
+{
+    return fxp_mac32_Q32_sse2<SSE41>(L_add, a, _mm_set1_epi32(win));
+}
+
+template <int32 SSE41>
+static inline __m128i pvmp3_mul_win_x4(__m128i a, int32 win)
+{
+    return fxp_mul32_Q32_sse2<SSE41>(a, _mm_set1_epi32(win));
+}
+
+/*
+ *  pvmp3_mdct_18() of vec[0..71] and history[0..71], step by step
+ */
+template <int32 SSE41>
+static void pvmp3_mdct_18_x4_kernel(int32 vec[], int32 *history, const int32 *window)
+{
+    __m128i v[18];
+    __m128i h[18];
+    __m128i tmp;
+    __m128i tmp1;
+    __m128i tmp2;
+    __m128i tmp3;
+    __m128i tmp4;
+    int32 i;
+
+    pvmp3_load_x4(v, vec);
+    pvmp3_load_x4(h, history);
+
+    for (i = 0; i < 9; i++)
+    {
+        tmp  = fxp_mul32_Q32_sse2<SSE41>(_mm_slli_epi32(v[i], 1),
+                                  _mm_set1_epi32(cosTerms_1_ov_cos_phi[i]));
+        tmp1 = fxp_mul32_Qn_sse2<SSE41>(v[17 - i], _mm_set1_epi32(cosTerms_1_ov_cos_phi[17 - i]), 27);
+        v[i]      = _mm_add_epi32(tmp, tmp1);
+        v[17 - i] = fxp_mul32_Qn_sse2<SSE41>(_mm_sub_epi32(tmp, tmp1),
+                                      _mm_set1_epi32(cosTerms_dct18[i]), 28);
+    }
+
+    pvmp3_dct_9_x4<SSE41>(v);        // Even terms
+    pvmp3_dct_9_x4<SSE41>(&v[9]);    // Odd  terms
+
+    tmp3  = v[16];
+    v[16] = v[ 8];
+    tmp4  = v[14];
+    v[14] = v[ 7];
+    tmp   = v[12];
+    v[12] = v[ 6];
+    tmp2  = v[10];
+    v[10] = v[ 5];
+    v[ 8] = v[ 4];
+    v[ 6] = v[ 3];
+    v[ 4] = v[ 2];
+    v[ 2] = v[ 1];
+    v[ 1] = _mm_sub_epi32(v[ 9], tmp2);
+    v[ 3] = _mm_sub_epi32(v[11], tmp2);
+    v[ 5] = _mm_sub_epi32(v[11], tmp);
+    v[ 7] = _mm_sub_epi32(v[13], tmp);
+    v[ 9] = _mm_sub_epi32(v[13], tmp4);
+    v[11] = _mm_sub_epi32(v[15], tmp4);
+    v[13] = _mm_sub_epi32(v[15], tmp3);
+    v[15] = _mm_sub_epi32(v[17], tmp3);
+
+    /* overlap and add */
+
+    tmp2 = v[0];
+    tmp3 = v[9];
+
+    for (i = 0; i < 6; i++)
+    {
+        tmp  = h[i];
+        tmp4 = v[i+10];
+        v[i+10] = _mm_add_epi32(tmp3, tmp4);
+        tmp1 = v[i+1];
+        v[i] = pvmp3_mac_win_x4<SSE41>(tmp, v[i+10], window[i]);
+        tmp3 = tmp4;
+        h[i] = pvmp3_neg_x4(_mm_add_epi32(tmp2, tmp1));
+        tmp2 = tmp1;
+    }
+
+    tmp  = h[6];
+    tmp4 = v[16];
+    v[16] = _mm_add_epi32(tmp3, tmp4);
+    tmp1 = v[7];
+    v[6] = pvmp3_mac_win_x4<SSE41>(tmp, _mm_slli_epi32(v[16], 1), window[6]);
+    tmp  = h[7];
+    h[6] = pvmp3_neg_x4(_mm_add_epi32(tmp2, tmp1));
+    h[7] = pvmp3_neg_x4(_mm_add_epi32(tmp1, v[8]));
+
+    tmp1 = h[8];
+    tmp4 = _mm_add_epi32(v[17], tmp4);
+    v[7] = pvmp3_mac_win_x4<SSE41>(tmp, _mm_slli_epi32(tmp4, 1), window[7]);
+    h[8] = pvmp3_neg_x4(_mm_add_epi32(v[8], v[9]));
+    v[8] = pvmp3_mac_win_x4<SSE41>(tmp1, _mm_slli_epi32(v[17], 1), window[8]);
+
+    tmp  = h[9];
+    tmp1 = h[17];
+    tmp2 = h[16];
+    v[ 9] = pvmp3_mac_win_x4<SSE41>(tmp, _mm_slli_epi32(v[17], 1), window[9]);
+
+    v[17] = pvmp3_mac_win_x4<SSE41>(tmp1, _mm_slli_epi32(v[10], 1), window[17]);
+    v[10] = pvmp3_neg_x4(v[16]);
+    v[16] = pvmp3_mac_win_x4<SSE41>(tmp2, _mm_slli_epi32(v[11], 1), window[16]);
+    tmp1 = h[15];
+    tmp2 = h[14];
+    v[11] = pvmp3_neg_x4(v[15]);
+    v[15] = pvmp3_mac_win_x4<SSE41>(tmp1, _mm_slli_epi32(v[12], 1), window[15]);
+    v[12] = pvmp3_neg_x4(v[14]);
+    v[14] = pvmp3_mac_win_x4<SSE41>(tmp2, _mm_slli_epi32(v[13], 1), window[14]);
+
+    tmp  = h[13];
+    tmp1 = h[12];
+    tmp2 = h[11];
+    tmp3 = h[10];
+    v[13] = pvmp3_mac_win_x4<SSE41>(tmp,  _mm_slli_epi32(v[12], 1), window[13]);
+    v[12] = pvmp3_mac_win_x4<SSE41>(tmp1, _mm_slli_epi32(v[11], 1), window[12]);
+    v[11] = pvmp3_mac_win_x4<SSE41>(tmp2, _mm_slli_epi32(v[10], 1), window[11]);
+    v[10] = pvmp3_mac_win_x4<SSE41>(tmp3, _mm_slli_epi32(tmp4, 1), window[10]);
+
+    /* next iteration overlap */
+
+    tmp1 = _mm_slli_epi32(h[8], 1);
+    tmp3 = _mm_slli_epi32(h[7], 1);
+    tmp2 = _mm_slli_epi32(h[1], 1);
+    tmp  = _mm_slli_epi32(h[0], 1);
+
+    h[ 0] = pvmp3_mul_win_x4<SSE41>(tmp1, window[18]);
+    h[17] = pvmp3_mul_win_x4<SSE41>(tmp1, window[35]);
+    h[ 1] = pvmp3_mul_win_x4<SSE41>(tmp3, window[19]);
+    h[16] = pvmp3_mul_win_x4<SSE41>(tmp3, window[34]);
+    h[ 7] = pvmp3_mul_win_x4<SSE41>(tmp2, window[25]);
+    h[10] = pvmp3_mul_win_x4<SSE41>(tmp2, window[28]);
+    h[ 8] = pvmp3_mul_win_x4<SSE41>(tmp,  window[26]);
+    h[ 9] = pvmp3_mul_win_x4<SSE41>(tmp,  window[27]);
+
+    tmp1 = _mm_slli_epi32(h[6], 1);
+    tmp3 = _mm_slli_epi32(h[5], 1);
+    tmp4 = _mm_slli_epi32(h[4], 1);
+    tmp2 = _mm_slli_epi32(h[3], 1);
+    tmp  = _mm_slli_epi32(h[2], 1);
+
+    h[ 2] = pvmp3_mul_win_x4<SSE41>(tmp1, window[20]);
+    h[15] = pvmp3_mul_win_x4<SSE41>(tmp1, window[33]);
+    h[ 3] = pvmp3_mul_win_x4<SSE41>(tmp3, window[21]);
+    h[14] = pvmp3_mul_win_x4<SSE41>(tmp3, window[32]);
+    h[ 4] = pvmp3_mul_win_x4<SSE41>(tmp4, window[22]);
+    h[13] = pvmp3_mul_win_x4<SSE41>(tmp4, window[31]);
+    h[ 5] = pvmp3_mul_win_x4<SSE41>(tmp2, window[23]);
+    h[12] = pvmp3_mul_win_x4<SSE41>(tmp2, window[30]);
+    h[ 6] = pvmp3_mul_win_x4<SSE41>(tmp,  window[24]);
+    h[11] = pvmp3_mul_win_x4<SSE41>(tmp,  window[29]);
+
+    pvmp3_store_x4(vec, v);
+    pvmp3_store_x4(history, h);
+}
+
+void pvmp3_mdct_18_x4(int32 vec[], int32 *history, const int32 *window)
+{
+    if (x86_has_sse41())
+    {
+        pvmp3_mdct_18_x4_kernel<1>(vec, history, window);
+    }
+    else
+    {
+        pvmp3_mdct_18_x4_kernel<0>(vec, history, window);
+    }
+}
+
+#endif /* __SSE2__ */
+
 #endif // If not assembly
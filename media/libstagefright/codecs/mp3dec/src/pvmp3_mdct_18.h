@@ -49,6 +49,9 @@
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "pvmp3_audio_type_defs.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -97,10 +100,23 @@ extern "C"
 
     void pvmp3_dct_6(int32 vec[]);
 
+#if defined(__SSE2__)
+
+    /* the same as on 4 consecutive bands sharing one window */
+    void pvmp3_mdct_18_x4(int32 vec[], int32 *history, const int32 *window);
+
+#endif /* __SSE2__ */
+
 #ifdef __cplusplus
 }
 #endif
 
+#if defined(__SSE2__)
+/* SSE41 as in pv_mp3dec_fxd_op_sse2.h */
+template <int32 SSE41>
+void pvmp3_dct_9_x4(__m128i vec[]);
+#endif
+
 /*----------------------------------------------------------------------------
 ; END
 ----------------------------------------------------------------------------*/
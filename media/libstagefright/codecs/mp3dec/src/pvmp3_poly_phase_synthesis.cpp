@@ -133,9 +133,35 @@ void pvmp3_poly_phase_synthesis(tmp3dec_chan   *pChVars,
 
 
     int16 * ptr_out = outPcm;
+    int32 band = 0;
 
+#if defined(__SSE2__)
 
-    for (int32  band = 0; band < FILTERBANK_BANDS; band += 2)
+    /*
+     *  The DCT 32 of slot band+1 does not touch what the window of slot band
+     *  reads, so 4 slots go through the DCT 32 before their windows
+     */
+    for (; band + 4 <= FILTERBANK_BANDS; band += 4)
+    {
+        int32 *inData  = &pChVars->circ_buffer[544 - (band<<5)];
+
+        pvmp3_dct_32_x4(inData - 3*SUBBANDS_NUMBER);
+
+        for (int32 k = 0; k < 4; k++)
+        {
+            pvmp3_polyphase_filter_window(inData,
+                                          ptr_out,
+                                          numChannels);
+
+            ptr_out += (numChannels << 5);
+
+            inData  -= SUBBANDS_NUMBER;
+        }
+    }
+
+#endif /* __SSE2__ */
+
+    for (; band < FILTERBANK_BANDS; band += 2)
     {
         int32 *inData  = &pChVars->circ_buffer[544 - (band<<5)];
 
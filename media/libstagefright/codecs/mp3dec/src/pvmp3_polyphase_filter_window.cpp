@@ -75,6 +75,7 @@ Input
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -112,6 +113,85 @@ Input
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#if defined(__SSE2__)
+
+/*
+ *  The loop over j of pvmp3_polyphase_filter_window(), four values of j at
+ *  a time. The lane of j = 16 is not stored
+ */
+template <int32 SSE41>
+static void pvmp3_polyphase_filter_window_x4(int32 *synth_buffer,
+                                             int16 *outPcm,
+                                             int32 numChannels)
+{
+    const int32 *winPtr = pqmfSynthWin;
+    int32 i;
+
+    for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j += 4)
+    {
+        fxp_acc32_Q32_sse2 acc1;
+        fxp_acc32_Q32_sse2 acc2;
+
+        fxp_acc_init32_Q32_sse2(&acc1, 0x00000020);
+        fxp_acc_init32_Q32_sse2(&acc2, 0x00000020);
+
+        for (i = 0; i < 4; i++)
+        {
+            /* pt_1 grows with j, pt_2 goes down: its loads get reversed */
+            int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + j];
+            int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - j - 3];
+            __m128i temp1 = _mm_loadu_si128((__m128i *)&pt_1[SUBBANDS_NUMBER*(2*i)]);
+            __m128i temp4 = _mm_loadu_si128((__m128i *)&pt_1[SUBBANDS_NUMBER*(14-2*i)]);
+            __m128i temp2 = _mm_loadu_si128((__m128i *)&pt_2[SUBBANDS_NUMBER*(2*i+1)]);
+            __m128i temp3 = _mm_loadu_si128((__m128i *)&pt_2[SUBBANDS_NUMBER*(15-2*i)]);
+            temp2 = _mm_shuffle_epi32(temp2, _MM_SHUFFLE(0, 1, 2, 3));
+            temp3 = _mm_shuffle_epi32(temp3, _MM_SHUFFLE(0, 1, 2, 3));
+
+            /* winPtr[4*i .. 4*i+3] of the four values of j, transposed */
+            __m128i w0 = _mm_loadu_si128((__m128i *)&winPtr[ 0 + 4*i]);
+            __m128i w1 = _mm_loadu_si128((__m128i *)&winPtr[16 + 4*i]);
+            __m128i w2 = _mm_loadu_si128((__m128i *)&winPtr[32 + 4*i]);
+            __m128i w3 = _mm_loadu_si128((__m128i *)&winPtr[48 + 4*i]);
+            __m128i t0 = _mm_unpacklo_epi32(w0, w1);
+            __m128i t1 = _mm_unpacklo_epi32(w2, w3);
+            __m128i t2 = _mm_unpackhi_epi32(w0, w1);
+            __m128i t3 = _mm_unpackhi_epi32(w2, w3);
+            w0 = _mm_unpacklo_epi64(t0, t1);
+            w1 = _mm_unpackhi_epi64(t0, t1);
+            w2 = _mm_unpacklo_epi64(t2, t3);
+            w3 = _mm_unpackhi_epi64(t2, t3);
+
+            fxp_acc_mac32_Q32_sse2<SSE41>(&acc1, temp1, w0);
+            fxp_acc_mac32_Q32_sse2<SSE41>(&acc2, temp3, w0);
+            fxp_acc_mac32_Q32_sse2<SSE41>(&acc2, temp1, w1);
+            fxp_acc_msb32_Q32_sse2<SSE41>(&acc1, temp3, w1);
+            fxp_acc_mac32_Q32_sse2<SSE41>(&acc1, temp2, w2);
+            fxp_acc_msb32_Q32_sse2<SSE41>(&acc2, temp4, w2);
+            fxp_acc_mac32_Q32_sse2<SSE41>(&acc2, temp2, w3);
+            fxp_acc_mac32_Q32_sse2<SSE41>(&acc1, temp4, w3);
+        }
+
+        __m128i vsum1 = fxp_acc_sum32_Q32_sse2(&acc1);
+        __m128i vsum2 = fxp_acc_sum32_Q32_sse2(&acc2);
+
+        /* saturate16() of the sum1 lanes, then of the sum2 lanes */
+        __m128i out = _mm_packs_epi32(_mm_srai_epi32(vsum1, 6), _mm_srai_epi32(vsum2, 6));
+        int16 pcm[8];
+        _mm_storeu_si128((__m128i *)pcm, out);
+
+        for (i = 0; i < 4 && j + i < SUBBANDS_NUMBER / 2; i++)
+        {
+            int32 k = (j + i) << (numChannels - 1);
+            outPcm[k] = pcm[i];
+            outPcm[(numChannels<<5) - k] = pcm[i + 4];
+        }
+
+        winPtr += 64;
+    }
+}
+
+#endif /* __SSE2__ */
+
 void pvmp3_polyphase_filter_window(int32 *synth_buffer,
                                    int16 *outPcm,
                                    int32 numChannels)
@@ -121,6 +201,20 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
     const int32 *winPtr = pqmfSynthWin;
     int32 i;
 
+#if defined(__SSE2__)
+
+    if (x86_has_sse41())
+    {
+        pvmp3_polyphase_filter_window_x4<1>(synth_buffer, outPcm, numChannels);
+    }
+    else
+    {
+        pvmp3_polyphase_filter_window_x4<0>(synth_buffer, outPcm, numChannels);
+    }
+
+    winPtr = &pqmfSynthWin[((SUBBANDS_NUMBER / 2) - 1) << 4];
+
+#else /* __SSE2__ */
 
     for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
     {
@@ -200,6 +294,8 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
         outPcm[(numChannels<<5) - k] = saturate16(sum2 >> 6);
     }
 
+#endif /* __SSE2__ */
+
 
 
     sum1 = 0x00000020;
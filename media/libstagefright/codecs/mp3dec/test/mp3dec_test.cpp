@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 
 #include "pvmp3decoder_api.h"
 #include "mp3reader.h"
@@ -42,6 +43,12 @@ enum {
     kOutputBufferSize = 4608 * 2,
 };
 
+static int64_t GetNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 int main(int argc, const char **argv) {
 
     if (argc != 3) {
@@ -95,6 +102,8 @@ int main(int argc, const char **argv) {
 
     // Decode loop.
     int retVal = EXIT_SUCCESS;
+    int64_t decodeTimeNs = 0;
+    int64_t numSamplesDecoded = 0;
     while (1) {
         // Read input from the file.
         uint32_t bytesRead;
@@ -110,7 +119,9 @@ int main(int argc, const char **argv) {
         config.outputFrameSize = kOutputBufferSize / sizeof(int16_t);
 
         ERROR_CODE decoderErr;
+        int64_t startNs = GetNowNs();
         decoderErr = pvmp3_framedecoder(&config, decoderBuf);
+        decodeTimeNs += GetNowNs() - startNs;
         if (decoderErr != NO_DECODING_ERROR) {
             fprintf(stderr, "Decoder encountered error\n");
             retVal = EXIT_FAILURE;
@@ -118,6 +129,16 @@ int main(int argc, const char **argv) {
         }
         sf_writef_short(handle, outputBuf,
                         config.outputFrameSize / sfInfo.channels);
+        numSamplesDecoded += config.outputFrameSize / sfInfo.channels;
+    }
+
+    // Report the decoding speed, the time spent reading and writing files
+    // is not counted.
+    if (decodeTimeNs > 0 && sfInfo.samplerate > 0) {
+        double audioSec = (double)numSamplesDecoded / sfInfo.samplerate;
+        double decodeSec = decodeTimeNs / 1E9;
+        printf("Decoded %.2f s of audio in %.3f s, %.1fx realtime\n",
+               audioSec, decodeSec, audioSec / decodeSec);
     }
 
     // Close input reader and output writer.
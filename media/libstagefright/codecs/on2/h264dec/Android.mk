@@ -26,6 +26,7 @@ LOCAL_SRC_FILES := \
 	./source/h264bsd_dpb.c \
 	./source/h264bsd_image.c \
 	./source/h264bsd_deblocking.c \
+	./source/h264bsd_filter_thread.c \
 	./source/h264bsd_conceal.c \
 	./source/h264bsd_vui.c \
 	./source/h264bsd_pic_order_cnt.c \
@@ -95,11 +96,16 @@ ifeq ($(ARCH_ARM_HAVE_NEON),true)
                         $(LOCAL_PATH)/./omxdl/arm_neon/vc/m4p10/api
 endif
 
+# SSE2 kernels, with SSSE3 interpolation: both are part of the x86 and x86_64 ABIs.
+LOCAL_CFLAGS_x86     := -DH264DEC_X86 -mssse3
+LOCAL_CFLAGS_x86_64  := -DH264DEC_X86 -mssse3
+
 LOCAL_CLANG := true
 LOCAL_SANITIZE := signed-integer-overflow
 
 LOCAL_SHARED_LIBRARIES := \
 	libstagefright libstagefright_omx libstagefright_foundation libutils liblog \
+	libcutils \
 
 LOCAL_MODULE := libstagefright_soft_h264dec
 
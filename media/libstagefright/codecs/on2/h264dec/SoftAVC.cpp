@@ -25,6 +25,8 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/IOMX.h>
 
+#include <cutils/properties.h>
+#include <unistd.h>
 
 namespace android {
 
@@ -47,6 +49,33 @@ static const CodecProfileLevel kProfileLevels[] = {
     { OMX_VIDEO_AVCProfileBaseline, OMX_VIDEO_AVCLevel51 },
 };
 
+static size_t GetCPUCoreCount() {
+    long cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK(cpuCoreCount >= 1);
+    ALOGV("Number of CPU cores: %ld", cpuCoreCount);
+    return (size_t)cpuCoreCount;
+}
+
+// Number of cores the decoder may use, all of them unless the property
+// below says otherwise. Setting it to 1 keeps deblocking on the decoding
+// thread, the output is the same either way.
+#define PROP_NUM_CORES "media.h264dec.num-cores"
+
+static size_t GetNumCores() {
+    int32_t numCores = property_get_int32(PROP_NUM_CORES, 0);
+    if (numCores > 0) {
+        ALOGV("Using %d cores", numCores);
+        return (size_t)numCores;
+    }
+    return GetCPUCoreCount();
+}
+
 SoftAVC::SoftAVC(
         const char *name,
         const OMX_CALLBACKTYPE *callbacks,
@@ -57,6 +86,7 @@ SoftAVC::SoftAVC(
             kProfileLevels, ARRAY_SIZE(kProfileLevels),
             320 /* width */, 240 /* height */, callbacks, appData, component),
       mHandle(NULL),
+      mNumCores(GetNumCores()),
       mInputBufferCount(0),
       mFirstPicture(NULL),
       mFirstPictureId(-1),
@@ -93,10 +123,16 @@ SoftAVC::~SoftAVC() {
 
 status_t SoftAVC::initDecoder() {
     // Force decoder to output buffers in display order.
-    if (H264SwDecInit(&mHandle, 0) == H264SWDEC_OK) {
-        return OK;
+    if (H264SwDecInit(&mHandle, 0) != H264SWDEC_OK) {
+        return UNKNOWN_ERROR;
+    }
+
+    // Deblocking runs on a second thread when there is more than one core,
+    // decoding carries on single threaded if that thread can't be started.
+    if (H264SwDecSetNumCores(mHandle, mNumCores) != H264SWDEC_OK) {
+        ALOGW("Failed to decode using %zu cores", mNumCores);
     }
-    return UNKNOWN_ERROR;
+    return OK;
 }
 
 void SoftAVC::onQueueFilled(OMX_U32 /* portIndex */) {
@@ -52,6 +52,7 @@ private:
     };
 
     void *mHandle;
+    size_t mNumCores;
 
     size_t mInputBufferCount;
 
@@ -157,6 +157,8 @@ extern "C"
 
     H264SwDecApiVersion H264SwDecGetAPIVersion(void);
 
+    H264SwDecRet H264SwDecSetNumCores(H264SwDecInst decInst, u32 numCores);
+
     /* function prototype for API trace */
     void H264SwDecTrace(char *);
 
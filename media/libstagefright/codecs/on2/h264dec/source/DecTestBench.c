@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*------------------------------------------------------------------------------
     Module defines
@@ -40,6 +41,8 @@ void WriteOutput(char *filename, u8 *data, u32 picSize);
 u32 NextPacket(u8 **pStrm);
 u32 CropPicture(u8 *pOutImage, u8 *pInImage,
     u32 picWidth, u32 picHeight, CropParams *pCropParams);
+u32 GetTimeUs(void);
+void CorruptStream(u8 *pStrm, u32 len, u32 seed);
 
 /* Global variables for stream handling */
 u8 *streamStop = NULL;
@@ -102,6 +105,9 @@ int main(int argc, char **argv)
     u32 numErrors = 0;
     u32 cropDisplay = 0;
     u32 disableOutputReordering = 0;
+    u32 numCores = 1;
+    u32 corruptSeed = 0;
+    u32 decodeTimeUs = 0;
 
     FILE *finput;
 
@@ -123,7 +129,7 @@ int main(int argc, char **argv)
     if (argc < 2)
     {
         DEBUG((
-            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-T] file.h264\n",
+            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-Mn] [-En] [-T] file.h264\n",
             argv[0]));
         DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
 #if defined(_NO_OUT)
@@ -136,6 +142,8 @@ int main(int argc, char **argv)
         DEBUG(("\t-U NAL unit stream mode\n"));
         DEBUG(("\t-C display cropped image (default decoded image)\n"));
         DEBUG(("\t-R disable DPB output reordering\n"));
+        DEBUG(("\t-Mn decode using n cores, 0 filters whole pictures only\n"));
+        DEBUG(("\t-En flip bits of the stream, n seeds the positions\n"));
         DEBUG(("\t-T to print tag name and exit\n"));
         return 0;
     }
@@ -167,6 +175,14 @@ int main(int argc, char **argv)
         {
             disableOutputReordering = 1;
         }
+        else if ( strncmp(argv[i], "-M", 2) == 0 )
+        {
+            numCores = (u32)atoi(argv[i]+2);
+        }
+        else if ( strncmp(argv[i], "-E", 2) == 0 )
+        {
+            corruptSeed = (u32)atoi(argv[i]+2);
+        }
     }
 
     /* open input file for reading, file name given by user. If file open
@@ -195,6 +211,9 @@ int main(int argc, char **argv)
     fread(byteStrmStart, sizeof(u8), strmLen, finput);
     fclose(finput);
 
+    if (corruptSeed)
+        CorruptStream(byteStrmStart, strmLen, corruptSeed);
+
     /* initialize decoder. If unsuccessful -> exit */
     ret = H264SwDecInit(&decInst, disableOutputReordering);
     if (ret != H264SWDEC_OK)
@@ -204,6 +223,15 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    ret = H264SwDecSetNumCores(decInst, numCores);
+    if (ret != H264SWDEC_OK)
+    {
+        DEBUG(("SETTING NUMBER OF CORES FAILED\n"));
+        H264SwDecRelease(decInst);
+        free(byteStrmStart);
+        return -1;
+    }
+
     /* initialize H264SwDecDecode() input structure */
     streamStop = byteStrmStart + strmLen;
     decInput.pStream = byteStrmStart;
@@ -222,8 +250,11 @@ int main(int argc, char **argv)
         /* Picture ID is the picture number in decoding order */
         decInput.picId = picDecodeNumber;
 
-        /* call API function to perform decoding */
+        /* call API function to perform decoding, only the time spent in
+         * the decoder counts towards the decoding speed */
+        tmp = GetTimeUs();
         ret = H264SwDecDecode(decInst, &decInput, &decOutput);
+        decodeTimeUs += GetTimeUs() - tmp;
 
         switch(ret)
         {
@@ -420,6 +451,12 @@ int main(int argc, char **argv)
 
     DEBUG(("Output file: %s\n", outFileName));
 
+    DEBUG(("Decoded %d pictures in %d ms", picDecodeNumber - 1,
+        decodeTimeUs / 1000));
+    if (decodeTimeUs)
+        DEBUG((", %.1f fps", (picDecodeNumber - 1) * 1000000.0 / decodeTimeUs));
+    DEBUG(("\n"));
+
     DEBUG(("DECODING DONE\n"));
     if (numErrors || picDecodeNumber == 1)
     {
@@ -665,6 +702,55 @@ u32 CropPicture(u8 *pOutImage, u8 *pInImage,
     return (0);
 }
 
+/*------------------------------------------------------------------------------
+
+    Function name: GetTimeUs
+
+    Purpose:
+        Return a monotonic time stamp in microseconds, used to measure the
+        time spent in the decoder. Wraps around, only differences between
+        time stamps are meaningful.
+
+------------------------------------------------------------------------------*/
+u32 GetTimeUs(void)
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (u32)ts.tv_sec * 1000000 + (u32)(ts.tv_nsec / 1000);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name: CorruptStream
+
+    Purpose:
+        Flip a bit every 8 kB or so of the stream, past the first kilobyte
+        that holds the parameter sets. The positions only depend on the
+        seed, so the output of different decoder builds, or of -M0 against
+        -Mn, can be compared on the same corrupted stream.
+
+------------------------------------------------------------------------------*/
+void CorruptStream(u8 *pStrm, u32 len, u32 seed)
+{
+
+    u32 pos = 1024;
+
+    for (;;)
+    {
+        seed = seed * 1103515245 + 12345;
+        pos += 1 + ((seed >> 16) << 4) % 16384;
+        if (pos >= len)
+            break;
+        seed = seed * 1103515245 + 12345;
+        pStrm[pos] ^= 1 << ((seed >> 16) & 7);
+    }
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function name:  H264SwDecTrace
@@ -29,6 +29,7 @@
           H264SwDecDecode
           H264SwDecGetAPIVersion
           H264SwDecNextPicture
+          H264SwDecSetNumCores
 
 ------------------------------------------------------------------------------*/
 
@@ -52,7 +53,7 @@
 ------------------------------------------------------------------------------*/
 
 #define H264SWDEC_MAJOR_VERSION 2
-#define H264SWDEC_MINOR_VERSION 3
+#define H264SWDEC_MINOR_VERSION 4
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -575,4 +576,67 @@ H264SwDecRet H264SwDecNextPicture(H264SwDecInst decInst,
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetNumCores
+
+        Functional description:
+            Set the number of cores the decoder may use. With more than one
+            core, deblocking filtering of a picture runs on a thread of its
+            own while the picture is being decoded. With 0 the filtering
+            waits until whole pictures are decoded. Can't be called in the
+            middle of a picture, i.e. it is best called right after
+            H264SwDecInit.
+
+        Input:
+            decInst     decoder instance
+            numCores    number of cores
+
+        Output:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters, or called in the
+                                    middle of a picture
+            H264SWDEC_MEMFAIL       failed to start a thread
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetNumCores(H264SwDecInst decInst, u32 numCores)
+{
+
+    decContainer_t *pDecCont;
+
+    DEC_API_TRC("H264SwDecSetNumCores#");
+
+    if (decInst == NULL)
+    {
+        DEC_API_TRC("H264SwDecSetNumCores# ERROR: decInst is NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pDecCont = (decContainer_t*)decInst;
 
+#ifdef H264DEC_TRACE
+    sprintf(pDecCont->str, "H264SwDecSetNumCores# decInst %p numCores %d",
+            decInst, numCores);
+    DEC_API_TRC(pDecCont->str);
+#endif
+
+    if (pDecCont->storage.picStarted)
+    {
+        DEC_API_TRC("H264SwDecSetNumCores# ERROR: picture not finished");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    if (h264bsdSetNumCores(&pDecCont->storage, numCores) != HANTRO_OK)
+    {
+        DEC_API_TRC("H264SwDecSetNumCores# ERROR: failed to start thread");
+        return(H264SWDEC_MEMFAIL);
+    }
+
+    DEC_API_TRC("H264SwDecSetNumCores# OK");
+    return(H264SWDEC_OK);
+
+}
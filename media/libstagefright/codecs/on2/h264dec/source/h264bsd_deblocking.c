@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdFilterPicture
+          h264bsdFilterMbRows
           FilterVerLumaEdge
           FilterHorLumaEdge
           FilterHorLuma
@@ -59,6 +60,10 @@
 #include "armVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_X86
+#include <emmintrin.h>
+#endif /* H264DEC_X86 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -176,6 +181,7 @@ static void FilterLuma(u8 *data, bS_t *bS, edgeThreshold_t *thresholds,
 static void FilterChroma(u8 *cb, u8 *cr, bS_t *bS, edgeThreshold_t *thresholds,
         u32 imageWidth);
 
+#ifndef H264DEC_X86
 static void FilterVerLumaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
         u32 imageWidth);
 static void FilterHorLumaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
@@ -189,6 +195,7 @@ static void FilterHorChromaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
   i32 imageWidth);
 static void FilterHorChroma( u8 *data, u32 bS, edgeThreshold_t *thresholds,
   i32 imageWidth);
+#endif /* H264DEC_X86 */
 
 static void GetLumaEdgeThresholds(
   edgeThreshold_t *thresholds,
@@ -548,20 +555,27 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 #endif /* H264DEC_OMXDL */
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: h264bsdFilterMbRows
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for macroblock rows [firstRow, endRow)
+          of a picture. Filter does not copy the original picture anywhere
+          but filtering is performed directly on the original image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
+
+          Filtering a row modifies the three bottom pixel rows of the row
+          above, so the rows have to be filtered in order. Intra prediction
+          of the row below uses unfiltered pixels, so a row can be filtered
+          only after the row below it has been decoded.
 
         Inputs:
           image         pointer to image to be filtered
           mb            pointer to macroblock data structure of the top-left
                         macroblock of the picture
+          firstRow      first macroblock row to filter
+          endRow        macroblock row after the last one to filter
 
         Outputs:
           image         filtered image stored here
@@ -571,9 +585,11 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 
 ------------------------------------------------------------------------------*/
 #ifndef H264DEC_OMXDL
-void h264bsdFilterPicture(
+void h264bsdFilterMbRows(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 endRow)
 {
 
 /* Variables */
@@ -598,9 +614,12 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow <= endRow);
+    ASSERT(endRow <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < endRow; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
@@ -638,6 +657,8 @@ void h264bsdFilterPicture(
 
 }
 
+#ifndef H264DEC_X86
+
 /*------------------------------------------------------------------------------
 
     Function: FilterVerLumaEdge
@@ -1120,6 +1141,8 @@ void FilterHorChroma(
 
 }
 
+#endif /* H264DEC_X86 */
+
 
 /*------------------------------------------------------------------------------
 
@@ -1531,6 +1554,8 @@ void GetChromaEdgeThresholds(
 
 }
 
+#ifndef H264DEC_X86
+
 /*------------------------------------------------------------------------------
 
     Function: FilterLuma
@@ -1735,24 +1760,513 @@ void FilterChroma(
     }
 }
 
+#else /* H264DEC_X86 */
+
+/*------------------------------------------------------------------------------
+
+    SSE2 versions of FilterLuma and FilterChroma. All samples along a
+    macroblock edge are filtered at once, 16 for luma and 2x8 for chroma
+    (Cb and Cr side by side). Vertical edges are transposed to be filtered
+    like horizontal ones. The bS of each 4-sample segment of an edge (2
+    samples for chroma) selects its tc0, or whether it is filtered at all,
+    as in the C versions. The filters are evaluated with 16-bit
+    intermediates and the results are bit-exact with the C versions.
+
+    All vertical edges of the macroblock are filtered before the horizontal
+    ones. That is the order of the standard, and gives the same result as
+    filtering the edges of one row of 4x4 blocks at a time as the C
+    versions do, because the samples the edges of a row modify don't
+    overlap the samples the edges of the next row use.
+
+------------------------------------------------------------------------------*/
+
+/* Select a where mask is set, b elsewhere */
+static __inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* Lanes where |a-b| < threshold, for unsigned 8-bit samples */
+static __inline __m128i AbsDiffLess(__m128i a, __m128i b, __m128i threshold)
+{
+    __m128i diff;
+
+    diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    /* diff < threshold <=> threshold - diff doesn't saturate to zero */
+    return _mm_xor_si128(
+        _mm_cmpeq_epi8(_mm_subs_epu8(threshold, diff), _mm_setzero_si128()),
+        _mm_set1_epi8(-1));
+}
+
+/* Clip x to [-tc, tc] */
+static __inline __m128i Clip3Tc(__m128i x, __m128i tc)
+{
+    return _mm_min_epi16(_mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(),
+        tc)), tc);
+}
+
+/* Load 8 samples (4 each side of a vertical edge) of 16 rows transposed, so
+ * that pix[i] holds column i of all the rows */
+static void LoadTransposed(u8 **rows, __m128i *pix)
+{
+    __m128i a[16], b[8], c[8], d[4], e[4];
+    u32 i;
+
+    for (i = 0; i < 16; i++)
+        a[i] = _mm_loadl_epi64((const __m128i*)rows[i]);
+
+    for (i = 0; i < 8; i++)
+        b[i] = _mm_unpacklo_epi8(a[2*i], a[2*i+1]);
+
+    for (i = 0; i < 4; i++)
+    {
+        c[2*i]   = _mm_unpacklo_epi16(b[2*i], b[2*i+1]);
+        c[2*i+1] = _mm_unpackhi_epi16(b[2*i], b[2*i+1]);
+    }
+
+    /* d: columns of rows 0-7, e: columns of rows 8-15, two per register */
+    d[0] = _mm_unpacklo_epi32(c[0], c[2]);
+    d[1] = _mm_unpackhi_epi32(c[0], c[2]);
+    d[2] = _mm_unpacklo_epi32(c[1], c[3]);
+    d[3] = _mm_unpackhi_epi32(c[1], c[3]);
+    e[0] = _mm_unpacklo_epi32(c[4], c[6]);
+    e[1] = _mm_unpackhi_epi32(c[4], c[6]);
+    e[2] = _mm_unpacklo_epi32(c[5], c[7]);
+    e[3] = _mm_unpackhi_epi32(c[5], c[7]);
+
+    for (i = 0; i < 4; i++)
+    {
+        pix[2*i]   = _mm_unpacklo_epi64(d[i], e[i]);
+        pix[2*i+1] = _mm_unpackhi_epi64(d[i], e[i]);
+    }
+}
+
+/* Inverse of LoadTransposed */
+static void StoreTransposed(u8 **rows, const __m128i *pix)
+{
+    __m128i a[8], b[8], c[8];
+    u32 i;
+
+    /* a[2*i]: columns 2*i, 2*i+1 of rows 0-7, a[2*i+1]: of rows 8-15 */
+    for (i = 0; i < 4; i++)
+    {
+        a[2*i]   = _mm_unpacklo_epi8(pix[2*i], pix[2*i+1]);
+        a[2*i+1] = _mm_unpackhi_epi8(pix[2*i], pix[2*i+1]);
+    }
+
+    /* b: columns 0-3 and 4-7 of rows 0-3, 4-7, 8-11 and 12-15 */
+    b[0] = _mm_unpacklo_epi16(a[0], a[2]);
+    b[1] = _mm_unpackhi_epi16(a[0], a[2]);
+    b[2] = _mm_unpacklo_epi16(a[4], a[6]);
+    b[3] = _mm_unpackhi_epi16(a[4], a[6]);
+    b[4] = _mm_unpacklo_epi16(a[1], a[3]);
+    b[5] = _mm_unpackhi_epi16(a[1], a[3]);
+    b[6] = _mm_unpacklo_epi16(a[5], a[7]);
+    b[7] = _mm_unpackhi_epi16(a[5], a[7]);
+
+    /* c[i]: rows 2*i and 2*i+1 */
+    for (i = 0; i < 2; i++)
+    {
+        c[4*i]   = _mm_unpacklo_epi32(b[4*i], b[4*i+2]);
+        c[4*i+1] = _mm_unpackhi_epi32(b[4*i], b[4*i+2]);
+        c[4*i+2] = _mm_unpacklo_epi32(b[4*i+1], b[4*i+3]);
+        c[4*i+3] = _mm_unpackhi_epi32(b[4*i+1], b[4*i+3]);
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        _mm_storel_epi64((__m128i*)rows[2*i], c[i]);
+        _mm_storel_epi64((__m128i*)rows[2*i+1], _mm_srli_si128(c[i], 8));
+    }
+}
+
+/* Luma filtering of 8 lanes with bS < 4, 16-bit samples. Returns new p1,
+ * p0, q0 and q1 in out[0..3] */
+static void LumaNormal(const __m128i *pix, __m128i tc0, __m128i ap,
+    __m128i aq, __m128i *out)
+{
+    __m128i p2 = pix[1], p1 = pix[2], p0 = pix[3];
+    __m128i q0 = pix[4], q1 = pix[5], q2 = pix[6];
+    __m128i tc, delta, avg, tmp;
+
+    /* tc = tc0 + (ap < beta) + (aq < beta), masks are -1 where set */
+    tc = _mm_sub_epi16(_mm_sub_epi16(tc0, ap), aq);
+
+    delta = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2),
+        _mm_sub_epi16(p1, q1));
+    delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+    delta = Clip3Tc(delta, tc);
+
+    avg = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(p0, q0),
+        _mm_set1_epi16(1)), 1);
+
+    tmp = _mm_sub_epi16(_mm_add_epi16(p2, avg), _mm_slli_epi16(p1, 1));
+    tmp = Clip3Tc(_mm_srai_epi16(tmp, 1), tc0);
+    out[0] = _mm_add_epi16(p1, _mm_and_si128(tmp, ap));
+
+    out[1] = _mm_add_epi16(p0, delta);
+    out[2] = _mm_sub_epi16(q0, delta);
+
+    tmp = _mm_sub_epi16(_mm_add_epi16(q2, avg), _mm_slli_epi16(q1, 1));
+    tmp = Clip3Tc(_mm_srai_epi16(tmp, 1), tc0);
+    out[3] = _mm_add_epi16(q1, _mm_and_si128(tmp, aq));
+}
+
+/* Luma filtering of 8 lanes with bS == 4, 16-bit samples. Returns new p2,
+ * p1, p0, q0, q1 and q2 in out[0..5] */
+static void LumaStrong(const __m128i *pix, __m128i sp, __m128i sq,
+    __m128i *out)
+{
+    __m128i p3 = pix[0], p2 = pix[1], p1 = pix[2], p0 = pix[3];
+    __m128i q0 = pix[4], q1 = pix[5], q2 = pix[6], q3 = pix[7];
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i four = _mm_set1_epi16(4);
+    __m128i tmp, strong, weak;
+
+    /* p side, tmp = p1 + p0 + q0 */
+    tmp = _mm_add_epi16(_mm_add_epi16(p1, p0), q0);
+    strong = _mm_add_epi16(_mm_add_epi16(p2, q1), _mm_slli_epi16(tmp, 1));
+    strong = _mm_srli_epi16(_mm_add_epi16(strong, four), 3);
+    weak = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(p1, 1), p0), q1);
+    weak = _mm_srli_epi16(_mm_add_epi16(weak, two), 2);
+    out[2] = Select(sp, strong, weak);
+    strong = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(p2, tmp), two), 2);
+    out[1] = Select(sp, strong, p1);
+    strong = _mm_add_epi16(_mm_slli_epi16(p3, 1),
+        _mm_add_epi16(_mm_add_epi16(p2, _mm_slli_epi16(p2, 1)), tmp));
+    strong = _mm_srli_epi16(_mm_add_epi16(strong, four), 3);
+    out[0] = Select(sp, strong, p2);
+
+    /* q side, tmp = p0 + q0 + q1 */
+    tmp = _mm_add_epi16(_mm_add_epi16(p0, q0), q1);
+    strong = _mm_add_epi16(_mm_add_epi16(p1, q2), _mm_slli_epi16(tmp, 1));
+    strong = _mm_srli_epi16(_mm_add_epi16(strong, four), 3);
+    weak = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(q1, 1), q0), p1);
+    weak = _mm_srli_epi16(_mm_add_epi16(weak, two), 2);
+    out[3] = Select(sq, strong, weak);
+    strong = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(q2, tmp), two), 2);
+    out[4] = Select(sq, strong, q1);
+    strong = _mm_add_epi16(_mm_slli_epi16(q3, 1),
+        _mm_add_epi16(_mm_add_epi16(q2, _mm_slli_epi16(q2, 1)), tmp));
+    strong = _mm_srli_epi16(_mm_add_epi16(strong, four), 3);
+    out[5] = Select(sq, strong, q2);
+}
+
+/* Filter one luma edge, pix[0..7] holds samples p3..q3 of the 16 lanes and
+ * bS the boundary strength of each lane */
+static void FilterLumaEdge(__m128i *pix, const u8 *bS,
+    const edgeThreshold_t *thresholds)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i alpha, beta, bs, mask, strong, ap, aq, small, tc0;
+    __m128i lo[8], hi[8], outLo[6], outHi[6], tmp;
+    u8 tc[16];
+    u32 i, normalMask, strongMask;
+
+    alpha = _mm_set1_epi8((i8)thresholds->alpha);
+    beta = _mm_set1_epi8((i8)thresholds->beta);
+
+    mask = _mm_and_si128(AbsDiffLess(pix[3], pix[4], alpha),
+        _mm_and_si128(AbsDiffLess(pix[2], pix[3], beta),
+            AbsDiffLess(pix[5], pix[4], beta)));
+    bs = _mm_loadu_si128((const __m128i*)bS);
+    mask = _mm_andnot_si128(_mm_cmpeq_epi8(bs, zero), mask);
+    strong = _mm_and_si128(mask, _mm_cmpeq_epi8(bs, _mm_set1_epi8(4)));
+
+    normalMask = (u32)_mm_movemask_epi8(_mm_andnot_si128(strong, mask));
+    strongMask = (u32)_mm_movemask_epi8(strong);
+    if (!normalMask && !strongMask)
+        return;
+
+    ap = AbsDiffLess(pix[1], pix[3], beta);
+    aq = AbsDiffLess(pix[6], pix[4], beta);
+
+    for (i = 0; i < 8; i++)
+    {
+        lo[i] = _mm_unpacklo_epi8(pix[i], zero);
+        hi[i] = _mm_unpackhi_epi8(pix[i], zero);
+    }
+
+    if (normalMask)
+    {
+        for (i = 0; i < 16; i++)
+            tc[i] = (bS[i] && bS[i] < 4) ? thresholds->tc0[bS[i]-1] : 0;
+        tc0 = _mm_loadu_si128((const __m128i*)tc);
+
+        LumaNormal(lo, _mm_unpacklo_epi8(tc0, zero),
+            _mm_unpacklo_epi8(ap, ap), _mm_unpacklo_epi8(aq, aq), outLo);
+        LumaNormal(hi, _mm_unpackhi_epi8(tc0, zero),
+            _mm_unpackhi_epi8(ap, ap), _mm_unpackhi_epi8(aq, aq), outHi);
+
+        tmp = _mm_andnot_si128(strong, mask);
+        for (i = 0; i < 4; i++)
+            pix[2+i] = Select(tmp, _mm_packus_epi16(outLo[i], outHi[i]),
+                pix[2+i]);
+    }
+
+    if (strongMask)
+    {
+        /* pix[2..5] may have been changed above, but only in lanes that
+         * aren't filtered here */
+        small = AbsDiffLess(pix[3], pix[4], _mm_set1_epi8(
+            (i8)((thresholds->alpha >> 2) + 2)));
+        ap = _mm_and_si128(ap, small);
+        aq = _mm_and_si128(aq, small);
+
+        LumaStrong(lo, _mm_unpacklo_epi8(ap, ap), _mm_unpacklo_epi8(aq, aq),
+            outLo);
+        LumaStrong(hi, _mm_unpackhi_epi8(ap, ap), _mm_unpackhi_epi8(aq, aq),
+            outHi);
+
+        for (i = 0; i < 6; i++)
+            pix[1+i] = Select(strong, _mm_packus_epi16(outLo[i], outHi[i]),
+                pix[1+i]);
+    }
+}
+
+/* Filter one chroma edge, pix[0..3] holds samples p1..q0 of the 16 lanes and
+ * bS the boundary strength of each lane */
+static void FilterChromaEdge(__m128i *pix, const u8 *bS,
+    const edgeThreshold_t *thresholds)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    __m128i alpha, beta, bs, mask, strong, tc0, tc, delta, tmp;
+    __m128i lo[4], hi[4], outLo[2], outHi[2];
+    u8 tcTable[16];
+    u32 i;
+
+    alpha = _mm_set1_epi8((i8)thresholds->alpha);
+    beta = _mm_set1_epi8((i8)thresholds->beta);
+
+    mask = _mm_and_si128(AbsDiffLess(pix[1], pix[2], alpha),
+        _mm_and_si128(AbsDiffLess(pix[0], pix[1], beta),
+            AbsDiffLess(pix[3], pix[2], beta)));
+    bs = _mm_loadu_si128((const __m128i*)bS);
+    mask = _mm_andnot_si128(_mm_cmpeq_epi8(bs, zero), mask);
+    if (!_mm_movemask_epi8(mask))
+        return;
+    strong = _mm_cmpeq_epi8(bs, _mm_set1_epi8(4));
+
+    for (i = 0; i < 16; i++)
+        tcTable[i] = (bS[i] && bS[i] < 4) ? thresholds->tc0[bS[i]-1] + 1 : 0;
+    tc0 = _mm_loadu_si128((const __m128i*)tcTable);
+
+    for (i = 0; i < 4; i++)
+    {
+        lo[i] = _mm_unpacklo_epi8(pix[i], zero);
+        hi[i] = _mm_unpackhi_epi8(pix[i], zero);
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        __m128i *in = i ? hi : lo;
+        __m128i *out = i ? outHi : outLo;
+        __m128i s = i ? _mm_unpackhi_epi8(strong, strong) :
+                        _mm_unpacklo_epi8(strong, strong);
+
+        tc = i ? _mm_unpackhi_epi8(tc0, zero) : _mm_unpacklo_epi8(tc0, zero);
+        delta = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(in[2], in[1]), 2),
+            _mm_sub_epi16(in[0], in[3]));
+        delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+        delta = Clip3Tc(delta, tc);
+
+        /* bS == 4: p0 = (2p1 + p0 + q1 + 2) >> 2, q0 = (2q1 + q0 + p1 + 2) >> 2 */
+        tmp = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(in[0], 1), in[1]),
+            _mm_add_epi16(in[3], two));
+        out[0] = Select(s, _mm_srli_epi16(tmp, 2), _mm_add_epi16(in[1], delta));
+        tmp = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(in[3], 1), in[2]),
+            _mm_add_epi16(in[0], two));
+        out[1] = Select(s, _mm_srli_epi16(tmp, 2), _mm_sub_epi16(in[2], delta));
+    }
+
+    pix[1] = Select(mask, _mm_packus_epi16(outLo[0], outHi[0]), pix[1]);
+    pix[2] = Select(mask, _mm_packus_epi16(outLo[1], outHi[1]), pix[2]);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterLuma
+
+        Functional description:
+            Function to filter all luma edges of a macroblock
+
+------------------------------------------------------------------------------*/
+void FilterLuma(
+  u8 *data,
+  bS_t *bS,
+  edgeThreshold_t *thresholds,
+  u32 width)
+{
+
+/* Variables */
+
+    u32 i, edge;
+    u8 bs[16];
+    u8 *rows[16];
+    u8 *ptr;
+    bS_t *tmp;
+    __m128i pix[8];
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(bS);
+    ASSERT(thresholds);
+
+    /* vertical edges, the first one is the left edge of the macroblock */
+    for (edge = 0; edge < 4; edge++)
+    {
+        if (!(bS[edge].left | bS[4+edge].left | bS[8+edge].left |
+              bS[12+edge].left))
+            continue;
+
+        for (i = 0; i < 16; i++)
+        {
+            bs[i] = (u8)bS[(i >> 2) * 4 + edge].left;
+            rows[i] = data + i * width + edge * 4 - 4;
+        }
+
+        LoadTransposed(rows, pix);
+        FilterLumaEdge(pix, bs, thresholds + (edge ? INNER : LEFT));
+        StoreTransposed(rows, pix);
+    }
+
+    /* horizontal edges, the first one is the top edge of the macroblock */
+    for (edge = 0; edge < 4; edge++)
+    {
+        tmp = bS + edge * 4;
+        if (!(tmp[0].top | tmp[1].top | tmp[2].top | tmp[3].top))
+            continue;
+
+        for (i = 0; i < 16; i++)
+            bs[i] = (u8)tmp[i >> 2].top;
+
+        ptr = data + edge * 4 * width;
+        for (i = 0; i < 8; i++)
+            pix[i] = _mm_loadu_si128(
+                (const __m128i*)(ptr + ((i32)i - 4) * (i32)width));
+
+        FilterLumaEdge(pix, bs, thresholds + (edge ? INNER : TOP));
+
+        for (i = 1; i < 7; i++)
+            _mm_storeu_si128((__m128i*)(ptr + ((i32)i - 4) * (i32)width),
+                pix[i]);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterChroma
+
+        Functional description:
+            Function to filter all chroma edges of a macroblock. Chroma uses
+            the bS values determined for luma edges, each bS is used for 2
+            samples of a 4-sample chroma edge.
+
+------------------------------------------------------------------------------*/
+void FilterChroma(
+  u8 *dataCb,
+  u8 *dataCr,
+  bS_t *bS,
+  edgeThreshold_t *thresholds,
+  u32 width)
+{
+
+/* Variables */
+
+    u32 i, edge;
+    u8 bs[16];
+    u8 *rows[16];
+    u8 *cb, *cr;
+    bS_t *tmp;
+    __m128i pix[8];
+
+/* Code */
+
+    ASSERT(dataCb);
+    ASSERT(dataCr);
+    ASSERT(bS);
+    ASSERT(thresholds);
+
+    /* vertical edges, lanes 0-7 are the rows of Cb and 8-15 those of Cr */
+    for (edge = 0; edge < 2; edge++)
+    {
+        tmp = bS + edge * 2;
+        if (!(tmp[0].left | tmp[4].left | tmp[8].left | tmp[12].left))
+            continue;
+
+        for (i = 0; i < 16; i++)
+        {
+            bs[i] = (u8)tmp[((i & 7) >> 1) * 4].left;
+            rows[i] = (i < 8 ? dataCb : dataCr) + (i & 7) * width +
+                edge * 4 - 4;
+        }
+
+        LoadTransposed(rows, pix);
+        FilterChromaEdge(pix + 2, bs, thresholds + (edge ? INNER : LEFT));
+        StoreTransposed(rows, pix);
+    }
+
+    /* horizontal edges, lanes 0-7 are the columns of Cb and 8-15 those of
+     * Cr */
+    for (edge = 0; edge < 2; edge++)
+    {
+        tmp = bS + edge * 8;
+        if (!(tmp[0].top | tmp[1].top | tmp[2].top | tmp[3].top))
+            continue;
+
+        for (i = 0; i < 16; i++)
+            bs[i] = (u8)tmp[(i & 7) >> 1].top;
+
+        cb = dataCb + edge * 4 * width;
+        cr = dataCr + edge * 4 * width;
+        for (i = 0; i < 4; i++)
+            pix[i] = _mm_unpacklo_epi64(
+                _mm_loadl_epi64(
+                    (const __m128i*)(cb + ((i32)i - 2) * (i32)width)),
+                _mm_loadl_epi64(
+                    (const __m128i*)(cr + ((i32)i - 2) * (i32)width)));
+
+        FilterChromaEdge(pix, bs, thresholds + (edge ? INNER : TOP));
+
+        for (i = 1; i < 3; i++)
+        {
+            _mm_storel_epi64((__m128i*)(cb + ((i32)i - 2) * (i32)width),
+                pix[i]);
+            _mm_storel_epi64((__m128i*)(cr + ((i32)i - 2) * (i32)width),
+                _mm_srli_si128(pix[i], 8));
+        }
+    }
+}
+
+#endif /* H264DEC_X86 */
+
 #else /* H264DEC_OMXDL */
 
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: h264bsdFilterMbRows
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for macroblock rows [firstRow, endRow)
+          of a picture. Filter does not copy the original picture anywhere
+          but filtering is performed directly on the original image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
+
+          Filtering a row modifies the three bottom pixel rows of the row
+          above, so the rows have to be filtered in order. Intra prediction
+          of the row below uses unfiltered pixels, so a row can be filtered
+          only after the row below it has been decoded.
 
         Inputs:
           image         pointer to image to be filtered
           mb            pointer to macroblock data structure of the top-left
                         macroblock of the picture
+          firstRow      first macroblock row to filter
+          endRow        macroblock row after the last one to filter
 
         Outputs:
           image         filtered image stored here
@@ -1763,9 +2277,11 @@ void FilterChroma(
 ------------------------------------------------------------------------------*/
 
 /*lint --e{550} Symbol not accessed */
-void h264bsdFilterPicture(
+void h264bsdFilterMbRows(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 endRow)
 {
 
 /* Variables */
@@ -1794,9 +2310,12 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow <= endRow);
+    ASSERT(endRow <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < endRow; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
@@ -2413,5 +2932,32 @@ void GetChromaEdgeThresholds(
 
 #endif /* H264DEC_OMXDL */
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterPicture
+
+        Functional description:
+          Perform deblocking filtering for a picture, see h264bsdFilterMbRows.
+
+        Inputs:
+          image         pointer to image to be filtered
+          mb            pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+
+        Outputs:
+          image         filtered image stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+void h264bsdFilterPicture(
+  image_t *image,
+  mbStorage_t *mb)
+{
+    h264bsdFilterMbRows(image, mb, 0, image->height);
+}
+
+
 /*lint +e701 +e702 */
 
@@ -26,6 +26,7 @@
           h264bsdInit
           h264bsdDecode
           h264bsdShutdown
+          h264bsdSetNumCores
           h264bsdCurrentImage
           h264bsdNextOutputPicture
           h264bsdPicWidth
@@ -105,6 +106,11 @@ u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering)
     if (!pStorage->mbLayer)
         return HANTRO_NOK;
 
+    /* single core until h264bsdSetNumCores says otherwise */
+    if (h264bsdInitFilterThread(&pStorage->filterThread, HANTRO_FALSE) !=
+        HANTRO_OK)
+        return HANTRO_NOK;
+
     if (noOutputReordering)
         pStorage->noReordering = HANTRO_TRUE;
 
@@ -238,6 +244,11 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                 return (H264BSD_ERROR);
             }
 
+            /* concealment reads and writes macroblocks anywhere in the
+             * picture */
+            if (pStorage->filterThread)
+                h264bsdFilterThreadStop(pStorage->filterThread);
+
             if (!pStorage->validSliceInAccessUnit)
             {
                 pStorage->currImage->data =
@@ -420,6 +431,10 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     }
                     pStorage->currImage->data =
                         h264bsdAllocateDpbImage(pStorage->dpb);
+
+                    if (pStorage->filterThread)
+                        h264bsdFilterThreadStartPicture(pStorage->filterThread,
+                            pStorage->currImage, pStorage->mb);
                 }
 
                 /* store slice header to storage if successfully decoded */
@@ -441,6 +456,12 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     return(H264BSD_ERROR);
                 }
 
+                /* a redundant slice may decode macroblocks of rows that
+                 * have already been filtered again */
+                if (pStorage->filterThread &&
+                    pStorage->sliceHeader->redundantPicCnt)
+                    h264bsdFilterThreadStop(pStorage->filterThread);
+
                 DEBUG(("SLICE DATA, FIRST %d\n",
                         pStorage->sliceHeader->firstMbInSlice));
                 tmp = h264bsdDecodeSliceData(&strm, pStorage,
@@ -448,6 +469,9 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                 if (tmp != HANTRO_OK)
                 {
                     EPRINT("SLICE_DATA");
+                    /* the macroblocks of the slice will be concealed */
+                    if (pStorage->filterThread)
+                        h264bsdFilterThreadStop(pStorage->filterThread);
                     h264bsdMarkSliceCorrupted(pStorage,
                         pStorage->sliceHeader->firstMbInSlice);
                     return(H264BSD_ERROR);
@@ -471,7 +495,13 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
 
     if (picReady)
     {
-        h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
+        /* filter the rows that weren't filtered during decoding, at least
+         * the last one */
+        tmp = 0;
+        if (pStorage->filterThread)
+            tmp = h264bsdFilterThreadEndPicture(pStorage->filterThread);
+        h264bsdFilterMbRows(pStorage->currImage, pStorage->mb, tmp,
+            pStorage->currImage->height);
 
         h264bsdResetStorage(pStorage);
 
@@ -563,6 +593,9 @@ void h264bsdShutdown(storage_t *pStorage)
         }
     }
 
+    if (pStorage->filterThread)
+        h264bsdShutdownFilterThread(pStorage->filterThread);
+
     FREE(pStorage->mbLayer);
     FREE(pStorage->mb);
     FREE(pStorage->sliceGroupMap);
@@ -571,6 +604,70 @@ void h264bsdShutdown(storage_t *pStorage)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetNumCores
+
+        Functional description:
+            Set the number of cores the decoder may use. The deblocking
+            filter runs one macroblock row behind the decoding, with more
+            than one core on a thread of its own. With 0 whole pictures are
+            filtered once they are decoded, the way the decoder used to.
+            Output is identical in all cases. If the thread can't be started
+            the decoder carries on with a single core.
+
+        Inputs:
+            pStorage    pointer to storage data structure
+            numCores    number of cores
+
+        Outputs:
+            none
+
+        Returns:
+            HANTRO_OK   success
+            HANTRO_NOK  failed to start the filter thread
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdSetNumCores(storage_t *pStorage, u32 numCores)
+{
+
+/* Variables */
+
+    u32 useThread;
+
+/* Code */
+
+    ASSERT(pStorage);
+
+    if (numCores == 0)
+    {
+        if (pStorage->filterThread)
+            h264bsdShutdownFilterThread(pStorage->filterThread);
+        pStorage->filterThread = NULL;
+        return(HANTRO_OK);
+    }
+
+    useThread = numCores > 1 ? HANTRO_TRUE : HANTRO_FALSE;
+    if (pStorage->filterThread &&
+        pStorage->filterThread->hasThread == useThread)
+        return(HANTRO_OK);
+
+    if (pStorage->filterThread)
+        h264bsdShutdownFilterThread(pStorage->filterThread);
+    pStorage->filterThread = NULL;
+
+    if (h264bsdInitFilterThread(&pStorage->filterThread, useThread) !=
+        HANTRO_OK)
+    {
+        (void)h264bsdInitFilterThread(&pStorage->filterThread, HANTRO_FALSE);
+        return(HANTRO_NOK);
+    }
+
+    return(HANTRO_OK);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdNextOutputPicture
@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+     1. Include headers
+     2. External compiler flags
+     3. Module defines
+     4. Local function prototypes
+     5. Functions
+          h264bsdInitFilterThread
+          h264bsdShutdownFilterThread
+          h264bsdFilterThreadStartPicture
+          h264bsdFilterThreadMbDecoded
+          h264bsdFilterThreadStop
+          h264bsdFilterThreadEndPicture
+          FilterRows
+          WaitForRows
+          FilterThreadLoop
+
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include "h264bsd_filter_thread.h"
+#include "h264bsd_deblocking.h"
+#include "h264bsd_util.h"
+
+/*------------------------------------------------------------------------------
+    2. External compiler flags
+--------------------------------------------------------------------------------
+
+--------------------------------------------------------------------------------
+    3. Module defines
+------------------------------------------------------------------------------*/
+
+/* value of mbsInOrder once a macroblock has been decoded out of order, or
+ * when no picture has been started */
+#define NOT_IN_ORDER 0xFFFFFFFFU
+
+/*------------------------------------------------------------------------------
+    4. Local function prototypes
+------------------------------------------------------------------------------*/
+
+static void FilterRows(filterThread_t *pFilterThread, u32 firstRow,
+    u32 endRow);
+static void WaitForRows(filterThread_t *pFilterThread);
+static void *FilterThreadLoop(void *arg);
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInitFilterThread
+
+        Functional description:
+            Allocate the filter thread structure and start the thread.
+            Without a thread the decoding thread filters each row itself as
+            soon as it is ready.
+
+        Inputs:
+            useThread       start a thread for the filtering
+
+        Outputs:
+            ppFilterThread  pointer to the structure is stored here
+
+        Returns:
+            HANTRO_OK       success
+            HANTRO_NOK      failed to allocate memory or start the thread
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdInitFilterThread(filterThread_t **ppFilterThread, u32 useThread)
+{
+
+/* Variables */
+
+    filterThread_t *pFilterThread;
+
+/* Code */
+
+    ASSERT(ppFilterThread);
+
+    ALLOCATE(pFilterThread, 1, filterThread_t);
+    if (pFilterThread == NULL)
+        return(HANTRO_NOK);
+
+    H264SwDecMemset(pFilterThread, 0, sizeof(filterThread_t));
+    /* no picture started */
+    pFilterThread->mbsInOrder = NOT_IN_ORDER;
+
+    pthread_mutex_init(&pFilterThread->mutex, NULL);
+    pthread_cond_init(&pFilterThread->rowsReadyCond, NULL);
+    pthread_cond_init(&pFilterThread->rowFilteredCond, NULL);
+
+    pFilterThread->hasThread = useThread;
+    if (useThread && pthread_create(&pFilterThread->thread, NULL,
+            FilterThreadLoop, pFilterThread))
+    {
+        pthread_cond_destroy(&pFilterThread->rowFilteredCond);
+        pthread_cond_destroy(&pFilterThread->rowsReadyCond);
+        pthread_mutex_destroy(&pFilterThread->mutex);
+        FREE(pFilterThread);
+        return(HANTRO_NOK);
+    }
+
+    *ppFilterThread = pFilterThread;
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdShutdownFilterThread
+
+        Functional description:
+            Stop the filter thread and free the structure.
+
+        Inputs:
+            pFilterThread   pointer to filter thread structure
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdShutdownFilterThread(filterThread_t *pFilterThread)
+{
+
+/* Code */
+
+    ASSERT(pFilterThread);
+
+    pthread_mutex_lock(&pFilterThread->mutex);
+    pFilterThread->active = HANTRO_FALSE;
+    pFilterThread->quit = HANTRO_TRUE;
+    pthread_cond_signal(&pFilterThread->rowsReadyCond);
+    pthread_mutex_unlock(&pFilterThread->mutex);
+
+    if (pFilterThread->hasThread)
+        pthread_join(pFilterThread->thread, NULL);
+
+    pthread_cond_destroy(&pFilterThread->rowFilteredCond);
+    pthread_cond_destroy(&pFilterThread->rowsReadyCond);
+    pthread_mutex_destroy(&pFilterThread->mutex);
+
+    FREE(pFilterThread->unfiltered);
+    FREE(pFilterThread);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadStartPicture
+
+        Functional description:
+            Start filtering of a new picture. Rows are handed to the thread,
+            or filtered right away, as the macroblocks below them get
+            decoded.
+
+        Inputs:
+            pFilterThread   pointer to filter thread structure
+            image           image being decoded
+            mb              pointer to macroblock data structure of the
+                            top-left macroblock of the picture
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadStartPicture(filterThread_t *pFilterThread,
+    image_t *image, mbStorage_t *mb)
+{
+
+/* Code */
+
+    ASSERT(pFilterThread);
+    ASSERT(image);
+    ASSERT(mb);
+
+    /* make sure the thread isn't still working on the previous picture */
+    WaitForRows(pFilterThread);
+
+    if (pFilterThread->unfilteredSize != image->width * image->height)
+    {
+        FREE(pFilterThread->unfiltered);
+        ALLOCATE(pFilterThread->unfiltered, image->width * image->height * 384,
+            u8);
+        pFilterThread->unfilteredSize = pFilterThread->unfiltered ?
+            image->width * image->height : 0;
+    }
+
+    pthread_mutex_lock(&pFilterThread->mutex);
+    pFilterThread->image = *image;
+    pFilterThread->mb = mb;
+    pFilterThread->rowsReady = 0;
+    pFilterThread->rowsFiltered = 0;
+    /* without a copy of the unfiltered rows the whole picture is filtered
+     * once it is complete */
+    pFilterThread->active =
+        pFilterThread->unfiltered ? HANTRO_TRUE : HANTRO_FALSE;
+    pthread_mutex_unlock(&pFilterThread->mutex);
+
+    pFilterThread->mbsInOrder = 0;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadMbDecoded
+
+        Functional description:
+            Called after each decoded macroblock. A macroblock row can be
+            filtered once the row below it is completely decoded, intra
+            prediction of the row below needs unfiltered pixels.
+
+            Rows are only handed to the thread as long as the macroblocks
+            arrive in raster scan order, i.e. no slice groups or arbitrary
+            slice order. The decoding thread filters the rest of the picture
+            once it is complete.
+
+        Inputs:
+            pFilterThread   pointer to filter thread structure
+            mbAddr          address of the decoded macroblock
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadMbDecoded(filterThread_t *pFilterThread, u32 mbAddr)
+{
+
+/* Variables */
+
+    u32 width;
+
+/* Code */
+
+    ASSERT(pFilterThread);
+
+    if (mbAddr != pFilterThread->mbsInOrder)
+    {
+        /* no more rows are handed out for the rest of the picture */
+        pFilterThread->mbsInOrder = NOT_IN_ORDER;
+        return;
+    }
+
+    pFilterThread->mbsInOrder++;
+
+    width = pFilterThread->image.width;
+    if (pFilterThread->mbsInOrder % width == 0 &&
+        pFilterThread->mbsInOrder >= 2 * width)
+    {
+        pthread_mutex_lock(&pFilterThread->mutex);
+        if (pFilterThread->active)
+        {
+            pFilterThread->rowsReady = pFilterThread->mbsInOrder / width - 1;
+            if (pFilterThread->hasThread)
+                pthread_cond_signal(&pFilterThread->rowsReadyCond);
+            else
+            {
+                FilterRows(pFilterThread, pFilterThread->rowsFiltered,
+                    pFilterThread->rowsReady);
+                pFilterThread->rowsFiltered = pFilterThread->rowsReady;
+            }
+        }
+        pthread_mutex_unlock(&pFilterThread->mutex);
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadStop
+
+        Functional description:
+            Stop handing out rows of the current picture and undo the
+            filtering of the rows filtered so far, the whole picture is
+            filtered once it is complete. Needed before the decoding thread
+            changes macroblocks other than the ones being decoded in order,
+            e.g. before error concealment. Concealment thus sees the same
+            unfiltered pixels, and concealed pictures are filtered the same
+            way, as with filtering of whole pictures only.
+
+        Inputs:
+            pFilterThread   pointer to filter thread structure
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadStop(filterThread_t *pFilterThread)
+{
+
+/* Variables */
+
+    u32 picSizeInMbs, width, size;
+    u8 *data;
+
+/* Code */
+
+    ASSERT(pFilterThread);
+
+    WaitForRows(pFilterThread);
+
+    /* the thread is idle now */
+    pthread_mutex_lock(&pFilterThread->mutex);
+    if (pFilterThread->rowsFiltered)
+    {
+        picSizeInMbs = pFilterThread->image.width *
+            pFilterThread->image.height;
+        width = pFilterThread->image.width;
+        data = pFilterThread->image.data;
+        size = pFilterThread->rowsFiltered * width;
+
+        H264SwDecMemcpy(data, pFilterThread->unfiltered, size * 256);
+        H264SwDecMemcpy(data + picSizeInMbs * 256,
+            pFilterThread->unfiltered + picSizeInMbs * 256, size * 64);
+        H264SwDecMemcpy(data + picSizeInMbs * 320,
+            pFilterThread->unfiltered + picSizeInMbs * 320, size * 64);
+
+        pFilterThread->rowsFiltered = 0;
+        pFilterThread->rowsReady = 0;
+    }
+    pthread_mutex_unlock(&pFilterThread->mutex);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadEndPicture
+
+        Functional description:
+            Stop the thread for the current picture.
+
+        Inputs:
+            pFilterThread   pointer to filter thread structure
+
+        Outputs:
+            none
+
+        Returns:
+            number of macroblock rows the thread filtered, the decoding
+            thread filters the remaining ones
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdFilterThreadEndPicture(filterThread_t *pFilterThread)
+{
+
+/* Variables */
+
+    u32 rowsFiltered;
+
+/* Code */
+
+    ASSERT(pFilterThread);
+
+    WaitForRows(pFilterThread);
+
+    pthread_mutex_lock(&pFilterThread->mutex);
+    rowsFiltered = pFilterThread->rowsFiltered;
+    /* a picture concealed without any decoded slices never starts the
+     * thread, don't report the rows of the previous one */
+    pFilterThread->rowsFiltered = 0;
+    pFilterThread->rowsReady = 0;
+    pthread_mutex_unlock(&pFilterThread->mutex);
+
+    pFilterThread->mbsInOrder = NOT_IN_ORDER;
+
+    return(rowsFiltered);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterRows
+
+        Functional description:
+            Filter macroblock rows [firstRow, endRow) of the current picture,
+            after saving their unfiltered pixels.
+
+------------------------------------------------------------------------------*/
+
+void FilterRows(filterThread_t *pFilterThread, u32 firstRow, u32 endRow)
+{
+
+/* Variables */
+
+    u32 picSizeInMbs, first, size;
+    u8 *data;
+
+/* Code */
+
+    picSizeInMbs = pFilterThread->image.width * pFilterThread->image.height;
+    first = firstRow * pFilterThread->image.width;
+    size = (endRow - firstRow) * pFilterThread->image.width;
+    data = pFilterThread->image.data;
+
+    /* filtering a row changes the row above as well, which has been saved
+     * when it was filtered itself */
+    H264SwDecMemcpy(pFilterThread->unfiltered + first * 256,
+        data + first * 256, size * 256);
+    H264SwDecMemcpy(pFilterThread->unfiltered + picSizeInMbs * 256 + first * 64,
+        data + picSizeInMbs * 256 + first * 64, size * 64);
+    H264SwDecMemcpy(pFilterThread->unfiltered + picSizeInMbs * 320 + first * 64,
+        data + picSizeInMbs * 320 + first * 64, size * 64);
+
+    h264bsdFilterMbRows(&pFilterThread->image, pFilterThread->mb, firstRow,
+        endRow);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: WaitForRows
+
+        Functional description:
+            Wait until the thread has filtered all the rows handed to it and
+            stop handing it rows of the current picture.
+
+------------------------------------------------------------------------------*/
+
+void WaitForRows(filterThread_t *pFilterThread)
+{
+
+/* Code */
+
+    pthread_mutex_lock(&pFilterThread->mutex);
+    while (pFilterThread->active &&
+           pFilterThread->rowsFiltered < pFilterThread->rowsReady)
+        pthread_cond_wait(&pFilterThread->rowFilteredCond,
+            &pFilterThread->mutex);
+    pFilterThread->active = HANTRO_FALSE;
+    pthread_mutex_unlock(&pFilterThread->mutex);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterThreadLoop
+
+        Functional description:
+            Main loop of the filter thread, filter rows one at a time as they
+            become ready.
+
+------------------------------------------------------------------------------*/
+
+void *FilterThreadLoop(void *arg)
+{
+
+/* Variables */
+
+    filterThread_t *pFilterThread = (filterThread_t *)arg;
+    u32 row;
+
+/* Code */
+
+    pthread_mutex_lock(&pFilterThread->mutex);
+
+    while (!pFilterThread->quit)
+    {
+        if (!pFilterThread->active ||
+            pFilterThread->rowsFiltered >= pFilterThread->rowsReady)
+        {
+            pthread_cond_wait(&pFilterThread->rowsReadyCond,
+                &pFilterThread->mutex);
+            continue;
+        }
+
+        row = pFilterThread->rowsFiltered;
+        pthread_mutex_unlock(&pFilterThread->mutex);
+
+        FilterRows(pFilterThread, row, row + 1);
+
+        pthread_mutex_lock(&pFilterThread->mutex);
+        pFilterThread->rowsFiltered = row + 1;
+        pthread_cond_signal(&pFilterThread->rowFilteredCond);
+    }
+
+    pthread_mutex_unlock(&pFilterThread->mutex);
+
+    return(NULL);
+
+}
+
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+    1. Include headers
+    2. Module defines
+    3. Data types
+    4. Function prototypes
+
+------------------------------------------------------------------------------*/
+
+#ifndef H264SWDEC_FILTER_THREAD_H
+#define H264SWDEC_FILTER_THREAD_H
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "basetype.h"
+#include "h264bsd_image.h"
+#include "h264bsd_macroblock_layer.h"
+
+/*------------------------------------------------------------------------------
+    2. Module defines
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    3. Data types
+------------------------------------------------------------------------------*/
+
+/* deblocking filtering of the current picture one macroblock row behind
+ * the decoding, either on a thread of its own or by the decoding thread */
+typedef struct
+{
+    u32 hasThread;      /* rows are filtered by the thread below */
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    /* signalled when there are rows to filter or the thread has to exit */
+    pthread_cond_t rowsReadyCond;
+    /* signalled when the thread is done with a row */
+    pthread_cond_t rowFilteredCond;
+
+    /* fields below protected by mutex */
+    image_t image;
+    mbStorage_t *mb;
+    u32 active;         /* rows may be handed to the thread */
+    u32 quit;
+    u32 rowsReady;      /* rows [0, rowsReady) may be filtered */
+    u32 rowsFiltered;   /* rows [0, rowsFiltered) have been filtered */
+
+    /* the rows [0, rowsFiltered) as they were before filtering, laid out
+     * like the picture, to undo the filtering before concealment */
+    u8 *unfiltered;
+    u32 unfilteredSize; /* size of the above in macroblocks */
+
+    /* only accessed by the decoding thread, number of macroblocks decoded
+     * in raster scan order from the beginning of the picture */
+    u32 mbsInOrder;
+} filterThread_t;
+
+/*------------------------------------------------------------------------------
+    4. Function prototypes
+------------------------------------------------------------------------------*/
+
+u32 h264bsdInitFilterThread(filterThread_t **ppFilterThread, u32 useThread);
+void h264bsdShutdownFilterThread(filterThread_t *pFilterThread);
+
+void h264bsdFilterThreadStartPicture(filterThread_t *pFilterThread,
+    image_t *image, mbStorage_t *mb);
+void h264bsdFilterThreadMbDecoded(filterThread_t *pFilterThread, u32 mbAddr);
+void h264bsdFilterThreadStop(filterThread_t *pFilterThread);
+u32 h264bsdFilterThreadEndPicture(filterThread_t *pFilterThread);
+
+#endif /* #ifdef H264SWDEC_FILTER_THREAD_H */
+
@@ -174,7 +174,6 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
 
 /* Variables */
 
-    u32 i;
     u32 picWidth, picSize;
     u8 *lum, *cb, *cr;
     u8 *imageBlock;
@@ -183,8 +182,12 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
     u32 block;
     u32 x, y;
     i32 *pRes;
-    i32 tmp1, tmp2, tmp3, tmp4;
+    i32 tmp1, tmp2;
+#ifndef H264DEC_X86
+    u32 i;
+    i32 tmp3, tmp4;
     const u8 *clp = h264bsdClip + 512;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
@@ -242,6 +245,7 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
 
             RANGE_CHECK_ARRAY(pRes, -512, 511, 16);
 
+#ifndef H264DEC_X86
             /* Calculate image = prediction + residual
              * Process four pixels in a loop */
             for (i = 4; i; i--)
@@ -265,6 +269,9 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
                 imageBlock[3] = (u8)tmp3;
                 imageBlock += picWidth;
             }
+#else
+            h264bsdAddResidual4x4(imageBlock, picWidth, tmp, 16, pRes);
+#endif /* H264DEC_X86 */
         }
 
     }
@@ -316,6 +323,7 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
 
             RANGE_CHECK_ARRAY(pRes, -512, 511, 16);
 
+#ifndef H264DEC_X86
             for (i = 4; i; i--)
             {
                 tmp1 = tmp[0];
@@ -337,6 +345,9 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
                 imageBlock[3] = (u8)tmp3;
                 imageBlock += picWidth;
             }
+#else
+            h264bsdAddResidual4x4(imageBlock, picWidth, tmp, 8, pRes);
+#endif /* H264DEC_X86 */
         }
     }
 
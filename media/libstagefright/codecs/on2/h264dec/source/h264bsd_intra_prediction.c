@@ -67,6 +67,10 @@
 #include "omxVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_X86
+#include <emmintrin.h>
+#endif /* H264DEC_X86 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -924,12 +928,14 @@ void h264bsdAddResidual(u8 *data, i32 *residual, u32 blockNum)
 
 /* Variables */
 
-    u32 i;
     u32 x, y;
     u32 width;
-    i32 tmp1, tmp2, tmp3, tmp4;
     u8 *tmp;
+#ifndef H264DEC_X86
+    u32 i;
+    i32 tmp1, tmp2, tmp3, tmp4;
     const u8 *clp = h264bsdClip + 512;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
@@ -956,6 +962,7 @@ void h264bsdAddResidual(u8 *data, i32 *residual, u32 blockNum)
     }
 
     tmp = data + y*width + x;
+#ifndef H264DEC_X86
     for (i = 4; i; i--)
     {
         tmp1 = *residual++;
@@ -980,6 +987,9 @@ void h264bsdAddResidual(u8 *data, i32 *residual, u32 blockNum)
 
         tmp += width;
     }
+#else
+    h264bsdAddResidual4x4(tmp, width, tmp, width, residual);
+#endif /* H264DEC_X86 */
 
 }
 #endif
@@ -997,13 +1007,19 @@ void Intra16x16VerticalPrediction(u8 *data, u8 *above)
 
 /* Variables */
 
+#ifndef H264DEC_X86
     u32 i, j;
+#else
+    u32 i;
+    __m128i row;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
     ASSERT(data);
     ASSERT(above);
 
+#ifndef H264DEC_X86
     for (i = 0; i < 16; i++)
     {
         for (j = 0; j < 16; j++)
@@ -1011,6 +1027,11 @@ void Intra16x16VerticalPrediction(u8 *data, u8 *above)
             *data++ = above[j];
         }
     }
+#else
+    row = _mm_loadu_si128((const __m128i*)above);
+    for (i = 16; i--; data += 16)
+        _mm_storeu_si128((__m128i*)data, row);
+#endif /* H264DEC_X86 */
 
 }
 
@@ -1028,13 +1049,18 @@ void Intra16x16HorizontalPrediction(u8 *data, u8 *left)
 
 /* Variables */
 
+#ifndef H264DEC_X86
     u32 i, j;
+#else
+    u32 i;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
     ASSERT(data);
     ASSERT(left);
 
+#ifndef H264DEC_X86
     for (i = 0; i < 16; i++)
     {
         for (j = 0; j < 16; j++)
@@ -1042,6 +1068,10 @@ void Intra16x16HorizontalPrediction(u8 *data, u8 *left)
             *data++ = left[i];
         }
     }
+#else
+    for (i = 0; i < 16; i++, data += 16)
+        _mm_storeu_si128((__m128i*)data, _mm_set1_epi8((char)left[i]));
+#endif /* H264DEC_X86 */
 
 }
 
@@ -1091,8 +1121,16 @@ void Intra16x16DcPrediction(u8 *data, u8 *above, u8 *left, u32 availableA,
     {
         tmp = 128;
     }
+#ifndef H264DEC_X86
     for (i = 0; i < 256; i++)
         data[i] = (u8)tmp;
+#else
+    {
+        const __m128i row = _mm_set1_epi8((char)tmp);
+        for (i = 0; i < 256; i += 16)
+            _mm_storeu_si128((__m128i*)(data + i), row);
+    }
+#endif /* H264DEC_X86 */
 
 }
 
@@ -1110,9 +1148,14 @@ void Intra16x16PlanePrediction(u8 *data, u8 *above, u8 *left)
 
 /* Variables */
 
-    i32 i, j;
+    i32 i;
     i32 a, b, c;
+#ifndef H264DEC_X86
+    i32 j;
     i32 tmp;
+#else
+    __m128i lo, hi, cc;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
@@ -1132,6 +1175,7 @@ void Intra16x16PlanePrediction(u8 *data, u8 *above, u8 *left)
     c += (i + 1) * (left[8+i] - above[-1]);
     c = (5 * c + 32) >> 6;
 
+#ifndef H264DEC_X86
     for (i = 0; i < 16; i++)
     {
         for (j = 0; j < 16; j++)
@@ -1140,6 +1184,22 @@ void Intra16x16PlanePrediction(u8 *data, u8 *above, u8 *left)
             data[i*16+j] = (u8)CLIP1(tmp);
         }
     }
+#else
+    /* |b| and |c| are at most 717, so every sum fits in 16 bits and the
+     * saturating pack does the clipping */
+    lo = _mm_add_epi16(_mm_set1_epi16((i16)(a - 7 * c + 16)),
+        _mm_mullo_epi16(_mm_set1_epi16((i16)b),
+            _mm_setr_epi16(-7, -6, -5, -4, -3, -2, -1, 0)));
+    hi = _mm_add_epi16(lo, _mm_set1_epi16((i16)(8 * b)));
+    cc = _mm_set1_epi16((i16)c);
+    for (i = 16; i--; data += 16)
+    {
+        _mm_storeu_si128((__m128i*)data, _mm_packus_epi16(
+            _mm_srai_epi16(lo, 5), _mm_srai_epi16(hi, 5)));
+        lo = _mm_add_epi16(lo, cc);
+        hi = _mm_add_epi16(hi, cc);
+    }
+#endif /* H264DEC_X86 */
 
 }
 
@@ -1262,6 +1322,7 @@ void IntraChromaHorizontalPrediction(u8 *data, u8 *left)
     ASSERT(data);
     ASSERT(left);
 
+#ifndef H264DEC_X86
     for (i = 8; i--;)
     {
         *data++ = *left;
@@ -1273,6 +1334,10 @@ void IntraChromaHorizontalPrediction(u8 *data, u8 *left)
         *data++ = *left;
         *data++ = *left++;
     }
+#else
+    for (i = 8; i--; data += 8)
+        _mm_storel_epi64((__m128i*)data, _mm_set1_epi8((char)*left++));
+#endif /* H264DEC_X86 */
 
 }
 
@@ -1297,6 +1362,7 @@ void IntraChromaVerticalPrediction(u8 *data, u8 *above)
     ASSERT(data);
     ASSERT(above);
 
+#ifndef H264DEC_X86
     for (i = 8; i--;data++/*above-=8*/)
     {
         data[0] = *above;
@@ -1308,6 +1374,13 @@ void IntraChromaVerticalPrediction(u8 *data, u8 *above)
         data[48] = *above;
         data[56] = *above++;
     }
+#else
+    {
+        const __m128i row = _mm_loadl_epi64((const __m128i*)above);
+        for (i = 8; i--; data += 8)
+            _mm_storel_epi64((__m128i*)data, row);
+    }
+#endif /* H264DEC_X86 */
 
 }
 
@@ -1327,8 +1400,12 @@ void IntraChromaPlanePrediction(u8 *data, u8 *above, u8 *left)
 
     u32 i;
     i32 a, b, c;
+#ifndef H264DEC_X86
     i32 tmp;
     const u8 *clp = h264bsdClip + 512;
+#else
+    __m128i row, cc;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
@@ -1349,6 +1426,7 @@ void IntraChromaPlanePrediction(u8 *data, u8 *above, u8 *left)
 
     /*a += 16;*/
     a = a - 3 * c + 16;
+#ifndef H264DEC_X86
     for (i = 8; i--; a += c)
     {
         tmp = (a - 3 * b);
@@ -1368,6 +1446,21 @@ void IntraChromaPlanePrediction(u8 *data, u8 *above, u8 *left)
         tmp += b;
         *data++ = clp[tmp>>5];
     }
+#else
+    /* |b| and |c| are at most 1355, so every sum fits in 16 bits and the
+     * saturating pack does the clipping. Two rows per store. */
+    row = _mm_add_epi16(_mm_set1_epi16((i16)a),
+        _mm_mullo_epi16(_mm_set1_epi16((i16)b),
+            _mm_setr_epi16(-3, -2, -1, 0, 1, 2, 3, 4)));
+    cc = _mm_set1_epi16((i16)c);
+    for (i = 4; i--; data += 16)
+    {
+        __m128i next = _mm_add_epi16(row, cc);
+        _mm_storeu_si128((__m128i*)data, _mm_packus_epi16(
+            _mm_srai_epi16(row, 5), _mm_srai_epi16(next, 5)));
+        row = _mm_add_epi16(next, cc);
+    }
+#endif /* H264DEC_X86 */
 
 }
 
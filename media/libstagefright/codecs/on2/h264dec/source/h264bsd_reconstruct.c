@@ -42,6 +42,13 @@
 #include "armVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_X86
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif /* __SSSE3__ */
+#endif /* H264DEC_X86 */
+
 #define UNUSED(x) (void)(x)
 
 /*------------------------------------------------------------------------------
@@ -106,7 +113,7 @@ extern const u8 h264bsdClip[];
           predPartChroma    pointer where predicted part is written
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_ARM11
+#if !defined(H264DEC_ARM11) && !defined(H264DEC_X86)
 void h264bsdInterpolateChromaHor(
   u8 *pRef,
   u8 *predPartChroma,
@@ -287,6 +294,7 @@ void h264bsdInterpolateChromaVer(
 
 }
 #endif
+#ifndef H264DEC_X86
 /*------------------------------------------------------------------------------
 
     Function: h264bsdInterpolateChromaHorVer
@@ -402,6 +410,7 @@ void h264bsdInterpolateChromaHorVer(
     }
 
 }
+#endif /* H264DEC_X86 */
 
 /*------------------------------------------------------------------------------
 
@@ -487,7 +496,7 @@ static void PredictChroma(
           is written to macroblock array (mb)
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_ARM11
+#if !defined(H264DEC_ARM11) && !defined(H264DEC_X86)
 void h264bsdInterpolateVerHalf(
   u8 *ref,
   u8 *mb,
@@ -1195,6 +1204,7 @@ void h264bsdInterpolateHorVerQuarter(
 }
 #endif
 
+#ifndef H264DEC_X86
 /*------------------------------------------------------------------------------
 
     Function: h264bsdInterpolateMidHalf
@@ -1790,6 +1800,877 @@ void h264bsdInterpolateMidHorQuarter(
 
 }
 
+#else /* H264DEC_X86 */
+
+/*------------------------------------------------------------------------------
+
+    SSE2 versions of the interpolation functions above. The filters are the
+    same, evaluated on a whole row of the block at a time: the 6-tap luma
+    filter with 16-bit intermediates (32-bit for the second pass of the
+    2-D filter) and the bilinear chroma filter with 16-bit products, so the
+    results are bit-exact with the C versions. Quarter sample positions are
+    computed as the rounded average of the two nearest half or integer
+    sample positions, as in the C versions. Loads never read past the
+    samples the C versions use.
+
+    With SSSE3 the filters multiply pairs of 8-bit samples by pairs of 8-bit
+    coefficients with pmaddubsw, instead of widening the samples to 16 bits
+    first. The sum of each pair fits in 16 bits without saturation, so the
+    results are the same.
+
+------------------------------------------------------------------------------*/
+
+/* Load 'n' (2, 4, 8 or 16) bytes to the low lanes of a register */
+static __inline __m128i LoadBytes(const u8 *ptr, u32 n)
+{
+    if (n == 16)
+        return _mm_loadu_si128((const __m128i*)ptr);
+    else if (n == 8)
+        return _mm_loadl_epi64((const __m128i*)ptr);
+    else if (n == 4)
+        return _mm_cvtsi32_si128((i32)(ptr[0] | (ptr[1] << 8) |
+            (ptr[2] << 16) | ((u32)ptr[3] << 24)));
+    else
+        return _mm_cvtsi32_si128((i32)(ptr[0] | (ptr[1] << 8)));
+}
+
+/* Store the low 'n' (2, 4, 8 or 16) bytes of a register */
+static __inline void StoreBytes(u8 *ptr, __m128i val, u32 n)
+{
+    u32 tmp;
+
+    if (n == 16)
+        _mm_storeu_si128((__m128i*)ptr, val);
+    else if (n == 8)
+        _mm_storel_epi64((__m128i*)ptr, val);
+    else
+    {
+        tmp = (u32)_mm_cvtsi128_si32(val);
+        ptr[0] = (u8)tmp;
+        ptr[1] = (u8)(tmp >> 8);
+        if (n == 4)
+        {
+            ptr[2] = (u8)(tmp >> 16);
+            ptr[3] = (u8)(tmp >> 24);
+        }
+    }
+}
+
+/* a - 5b + 20c + 20d - 5e + f for 8 samples, fits in 16 bits */
+static __inline __m128i Tap6(__m128i a, __m128i b, __m128i c, __m128i d,
+    __m128i e, __m128i f)
+{
+    __m128i tmp;
+
+    tmp = _mm_sub_epi16(_mm_slli_epi16(_mm_add_epi16(c, d), 2),
+        _mm_add_epi16(b, e));
+    tmp = _mm_add_epi16(tmp, _mm_slli_epi16(tmp, 2));
+    return _mm_add_epi16(tmp, _mm_add_epi16(a, f));
+}
+
+/* Same for 8 intermediate values of the 2-D filter, rounded and shifted
+ * (+512 >> 10) to 16 bits */
+static __inline __m128i Tap6Mid(__m128i a, __m128i b, __m128i c, __m128i d,
+    __m128i e, __m128i f)
+{
+    const __m128i coeffAB = _mm_setr_epi16(1, -5, 1, -5, 1, -5, 1, -5);
+    const __m128i coeffCD = _mm_set1_epi16(20);
+    const __m128i coeffEF = _mm_setr_epi16(-5, 1, -5, 1, -5, 1, -5, 1);
+    const __m128i round = _mm_set1_epi32(512);
+    __m128i lo, hi;
+
+    lo = _mm_add_epi32(
+        _mm_madd_epi16(_mm_unpacklo_epi16(a, b), coeffAB),
+        _mm_madd_epi16(_mm_unpacklo_epi16(c, d), coeffCD));
+    lo = _mm_add_epi32(lo,
+        _mm_madd_epi16(_mm_unpacklo_epi16(e, f), coeffEF));
+    hi = _mm_add_epi32(
+        _mm_madd_epi16(_mm_unpackhi_epi16(a, b), coeffAB),
+        _mm_madd_epi16(_mm_unpackhi_epi16(c, d), coeffCD));
+    hi = _mm_add_epi32(hi,
+        _mm_madd_epi16(_mm_unpackhi_epi16(e, f), coeffEF));
+
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 10);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 10);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+#ifdef __SSSE3__
+/* Tap6() of interleaved 8-bit samples: ab holds a0 b0 a1 b1 ... and so on */
+static __inline __m128i Tap6Pairs(__m128i ab, __m128i cd, __m128i ef)
+{
+    const __m128i coeffAB = _mm_setr_epi8(
+        1, -5, 1, -5, 1, -5, 1, -5, 1, -5, 1, -5, 1, -5, 1, -5);
+    const __m128i coeffCD = _mm_set1_epi8(20);
+    const __m128i coeffEF = _mm_setr_epi8(
+        -5, 1, -5, 1, -5, 1, -5, 1, -5, 1, -5, 1, -5, 1, -5, 1);
+
+    return _mm_add_epi16(
+        _mm_add_epi16(_mm_maddubs_epi16(ab, coeffAB),
+            _mm_maddubs_epi16(cd, coeffCD)),
+        _mm_maddubs_epi16(ef, coeffEF));
+}
+
+/* Unclipped horizontal 6-tap filter of 'n' (4 or 8) samples, ptr points to
+ * the sample two columns left of the first one */
+static __inline __m128i Tap6Hor(const u8 *ptr, u32 n)
+{
+    /* sample k of the row is in lane k for k < 8, and in lane k + 3 for
+     * the others */
+    const __m128i shufAB = _mm_setr_epi8(
+        0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 11);
+    const __m128i shufCD = _mm_setr_epi8(
+        2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 11, 11, 12, 12, 13);
+    const __m128i shufEF = _mm_setr_epi8(
+        4, 5, 5, 6, 6, 7, 7, 11, 11, 12, 12, 13, 13, 14, 14, 15);
+    __m128i row;
+
+    row = _mm_unpacklo_epi64(LoadBytes(ptr, 8), LoadBytes(ptr + 5, n));
+
+    return Tap6Pairs(_mm_shuffle_epi8(row, shufAB),
+        _mm_shuffle_epi8(row, shufCD), _mm_shuffle_epi8(row, shufEF));
+}
+#endif /* __SSSE3__ */
+
+/* 6-tap filter of the low 'n' bytes of s[0..5], clipped to 8 bits */
+static __inline __m128i Filter6(const __m128i *s, u32 n)
+{
+#ifndef __SSSE3__
+    const __m128i zero = _mm_setzero_si128();
+#endif
+    const __m128i round = _mm_set1_epi16(16);
+    __m128i lo, hi;
+
+#ifdef __SSSE3__
+    lo = Tap6Pairs(_mm_unpacklo_epi8(s[0], s[1]),
+        _mm_unpacklo_epi8(s[2], s[3]), _mm_unpacklo_epi8(s[4], s[5]));
+#else
+    lo = Tap6(_mm_unpacklo_epi8(s[0], zero), _mm_unpacklo_epi8(s[1], zero),
+        _mm_unpacklo_epi8(s[2], zero), _mm_unpacklo_epi8(s[3], zero),
+        _mm_unpacklo_epi8(s[4], zero), _mm_unpacklo_epi8(s[5], zero));
+#endif
+    lo = _mm_srai_epi16(_mm_add_epi16(lo, round), 5);
+
+    if (n == 16)
+    {
+#ifdef __SSSE3__
+        hi = Tap6Pairs(_mm_unpackhi_epi8(s[0], s[1]),
+            _mm_unpackhi_epi8(s[2], s[3]), _mm_unpackhi_epi8(s[4], s[5]));
+#else
+        hi = Tap6(_mm_unpackhi_epi8(s[0], zero),
+            _mm_unpackhi_epi8(s[1], zero), _mm_unpackhi_epi8(s[2], zero),
+            _mm_unpackhi_epi8(s[3], zero), _mm_unpackhi_epi8(s[4], zero),
+            _mm_unpackhi_epi8(s[5], zero));
+#endif
+        hi = _mm_srai_epi16(_mm_add_epi16(hi, round), 5);
+    }
+    else
+        hi = lo;
+
+    return _mm_packus_epi16(lo, hi);
+}
+
+/* Horizontal half sample interpolation (position 'b'), ref points to the
+ * sample two columns left of the first integer sample of the block */
+static void FilterHor(const u8 *ref, u32 width, u8 *mb,
+    u32 partWidth, u32 partHeight)
+{
+#ifdef __SSSE3__
+    const __m128i round = _mm_set1_epi16(16);
+    __m128i lo, hi;
+    u32 y;
+
+    for (y = partHeight; y; y--)
+    {
+        lo = Tap6Hor(ref, partWidth == 4 ? 4 : 8);
+        lo = _mm_srai_epi16(_mm_add_epi16(lo, round), 5);
+        if (partWidth == 16)
+        {
+            hi = Tap6Hor(ref + 8, 8);
+            hi = _mm_srai_epi16(_mm_add_epi16(hi, round), 5);
+        }
+        else
+            hi = lo;
+        StoreBytes(mb, _mm_packus_epi16(lo, hi), partWidth);
+        ref += width;
+        mb += 16;
+    }
+#else
+    __m128i s[6];
+    u32 i, y;
+
+    for (y = partHeight; y; y--)
+    {
+        for (i = 0; i < 6; i++)
+            s[i] = LoadBytes(ref + i, partWidth);
+        StoreBytes(mb, Filter6(s, partWidth), partWidth);
+        ref += width;
+        mb += 16;
+    }
+#endif /* __SSSE3__ */
+}
+
+/* Vertical half sample interpolation (position 'h'), ref points to the
+ * sample two rows above the first integer sample of the block */
+static void FilterVer(const u8 *ref, u32 width, u8 *mb,
+    u32 partWidth, u32 partHeight)
+{
+    __m128i s[6];
+    u32 i, y;
+
+    for (i = 0; i < 5; i++)
+        s[i] = LoadBytes(ref + i*width, partWidth);
+    ref += 5*width;
+
+    for (y = partHeight; y; y--)
+    {
+        s[5] = LoadBytes(ref, partWidth);
+        StoreBytes(mb, Filter6(s, partWidth), partWidth);
+        for (i = 0; i < 5; i++)
+            s[i] = s[i+1];
+        ref += width;
+        mb += 16;
+    }
+}
+
+/* Horizontal and vertical half sample interpolation (position 'j'), ref
+ * points two rows above and two columns left of the first integer sample */
+static void FilterMid(const u8 *ref, u32 width, u8 *mb,
+    u32 partWidth, u32 partHeight)
+{
+#ifndef __SSSE3__
+    const __m128i zero = _mm_setzero_si128();
+    __m128i s[6];
+    u32 i;
+#endif
+    __m128i table[21][2];
+    __m128i lo, hi;
+    u32 y;
+
+    /* First step: unclipped horizontal interpolation of partHeight+5 rows */
+    for (y = 0; y < partHeight + 5; y++)
+    {
+#ifdef __SSSE3__
+        table[y][0] = Tap6Hor(ref, partWidth == 4 ? 4 : 8);
+        if (partWidth == 16)
+            table[y][1] = Tap6Hor(ref + 8, 8);
+#else
+        for (i = 0; i < 6; i++)
+            s[i] = LoadBytes(ref + i, partWidth);
+        table[y][0] = Tap6(
+            _mm_unpacklo_epi8(s[0], zero), _mm_unpacklo_epi8(s[1], zero),
+            _mm_unpacklo_epi8(s[2], zero), _mm_unpacklo_epi8(s[3], zero),
+            _mm_unpacklo_epi8(s[4], zero), _mm_unpacklo_epi8(s[5], zero));
+        if (partWidth == 16)
+            table[y][1] = Tap6(
+                _mm_unpackhi_epi8(s[0], zero), _mm_unpackhi_epi8(s[1], zero),
+                _mm_unpackhi_epi8(s[2], zero), _mm_unpackhi_epi8(s[3], zero),
+                _mm_unpackhi_epi8(s[4], zero), _mm_unpackhi_epi8(s[5], zero));
+#endif /* __SSSE3__ */
+        ref += width;
+    }
+
+    /* Second step: vertical interpolation of the intermediate values */
+    for (y = 0; y < partHeight; y++)
+    {
+        lo = Tap6Mid(table[y][0], table[y+1][0], table[y+2][0],
+            table[y+3][0], table[y+4][0], table[y+5][0]);
+        if (partWidth == 16)
+            hi = Tap6Mid(table[y][1], table[y+1][1], table[y+2][1],
+                table[y+3][1], table[y+4][1], table[y+5][1]);
+        else
+            hi = lo;
+        StoreBytes(mb, _mm_packus_epi16(lo, hi), partWidth);
+        mb += 16;
+    }
+}
+
+/* Average the block in mb with the samples in ref, rounding upwards */
+static void Average(u8 *mb, const u8 *ref, u32 width,
+    u32 partWidth, u32 partHeight)
+{
+    u32 y;
+
+    for (y = partHeight; y; y--)
+    {
+        StoreBytes(mb, _mm_avg_epu8(LoadBytes(mb, partWidth),
+            LoadBytes(ref, partWidth)), partWidth);
+        mb += 16;
+        ref += width;
+    }
+}
+
+void h264bsdInterpolateChromaHor(
+  u8 *pRef,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 xFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+
+/* Variables */
+
+    u32 y, comp;
+    u8 *ptrA, *cbr;
+    u8 block[9*8*2];
+    __m128i valA, round, a;
+#ifndef __SSSE3__
+    __m128i valB, zero, b;
+#endif
+
+/* Code */
+
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth);
+    ASSERT(chromaPartHeight);
+    ASSERT(xFrac < 8);
+    ASSERT(pRef);
+
+    if ((x0 < 0) || ((u32)x0+chromaPartWidth+1 > width) ||
+        (y0 < 0) || ((u32)y0+chromaPartHeight > height))
+    {
+        h264bsdFillBlock(pRef, block, x0, y0, width, height,
+            chromaPartWidth + 1, chromaPartHeight, chromaPartWidth + 1);
+        pRef += width * height;
+        h264bsdFillBlock(pRef, block + (chromaPartWidth+1)*chromaPartHeight,
+            x0, y0, width, height, chromaPartWidth + 1,
+            chromaPartHeight, chromaPartWidth + 1);
+
+        pRef = block;
+        x0 = 0;
+        y0 = 0;
+        width = chromaPartWidth+1;
+        height = chromaPartHeight;
+    }
+
+    /* ((8-xFrac)*A + xFrac*B) * 8 + 32 >> 6 == ((8-xFrac)*A + xFrac*B + 4) >> 3 */
+#ifdef __SSSE3__
+    /* pairs of 8-bit weights for A and B */
+    valA = _mm_set1_epi16((i16)(xFrac << 8 | (8 - xFrac)));
+#else
+    valA = _mm_set1_epi16((i16)(8 - xFrac));
+    valB = _mm_set1_epi16((i16)xFrac);
+    zero = _mm_setzero_si128();
+#endif
+    round = _mm_set1_epi16(4);
+
+    for (comp = 0; comp <= 1; comp++)
+    {
+
+        ptrA = pRef + (comp * height + (u32)y0) * width + x0;
+        cbr = predPartChroma + comp * 8 * 8;
+
+        for (y = chromaPartHeight; y; y--)
+        {
+#ifdef __SSSE3__
+            a = _mm_maddubs_epi16(_mm_unpacklo_epi8(
+                LoadBytes(ptrA, chromaPartWidth),
+                LoadBytes(ptrA + 1, chromaPartWidth)), valA);
+#else
+            a = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth), zero);
+            b = _mm_unpacklo_epi8(LoadBytes(ptrA + 1, chromaPartWidth), zero);
+            a = _mm_add_epi16(_mm_mullo_epi16(a, valA),
+                _mm_mullo_epi16(b, valB));
+#endif
+            a = _mm_srli_epi16(_mm_add_epi16(a, round), 3);
+            StoreBytes(cbr, _mm_packus_epi16(a, a), chromaPartWidth);
+            cbr += 8;
+            ptrA += width;
+        }
+    }
+
+}
+
+void h264bsdInterpolateChromaVer(
+  u8 *pRef,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 yFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+
+/* Variables */
+
+    u32 y, comp;
+    u8 *ptrA, *cbr;
+    u8 block[9*8*2];
+    __m128i valA, round, a, b, c;
+#ifndef __SSSE3__
+    __m128i valB, zero;
+#endif
+
+/* Code */
+
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth);
+    ASSERT(chromaPartHeight);
+    ASSERT(yFrac < 8);
+    ASSERT(pRef);
+
+    if ((x0 < 0) || ((u32)x0+chromaPartWidth > width) ||
+        (y0 < 0) || ((u32)y0+chromaPartHeight+1 > height))
+    {
+        h264bsdFillBlock(pRef, block, x0, y0, width, height, chromaPartWidth,
+            chromaPartHeight + 1, chromaPartWidth);
+        pRef += width * height;
+        h264bsdFillBlock(pRef, block + chromaPartWidth*(chromaPartHeight+1),
+            x0, y0, width, height, chromaPartWidth,
+            chromaPartHeight + 1, chromaPartWidth);
+
+        pRef = block;
+        x0 = 0;
+        y0 = 0;
+        width = chromaPartWidth;
+        height = chromaPartHeight+1;
+    }
+
+#ifdef __SSSE3__
+    valA = _mm_set1_epi16((i16)(yFrac << 8 | (8 - yFrac)));
+#else
+    valA = _mm_set1_epi16((i16)(8 - yFrac));
+    valB = _mm_set1_epi16((i16)yFrac);
+    zero = _mm_setzero_si128();
+#endif
+    round = _mm_set1_epi16(4);
+
+    for (comp = 0; comp <= 1; comp++)
+    {
+
+        ptrA = pRef + (comp * height + (u32)y0) * width + x0;
+        cbr = predPartChroma + comp * 8 * 8;
+
+#ifdef __SSSE3__
+        a = LoadBytes(ptrA, chromaPartWidth);
+#else
+        a = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth), zero);
+#endif
+        for (y = chromaPartHeight; y; y--)
+        {
+            ptrA += width;
+#ifdef __SSSE3__
+            b = LoadBytes(ptrA, chromaPartWidth);
+            c = _mm_maddubs_epi16(_mm_unpacklo_epi8(a, b), valA);
+#else
+            b = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth), zero);
+            c = _mm_add_epi16(_mm_mullo_epi16(a, valA),
+                _mm_mullo_epi16(b, valB));
+#endif
+            c = _mm_srli_epi16(_mm_add_epi16(c, round), 3);
+            StoreBytes(cbr, _mm_packus_epi16(c, c), chromaPartWidth);
+            cbr += 8;
+            a = b;
+        }
+    }
+
+}
+
+void h264bsdInterpolateChromaHorVer(
+  u8 *ref,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 xFrac,
+  u32 yFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+    u8 block[9*9*2];
+    u32 y, comp;
+    u8 *ptrA, *cbr;
+    __m128i valA, valC, round, a, c, tmp;
+#ifndef __SSSE3__
+    __m128i valB, valD, zero, b, d;
+#endif
+
+/* Code */
+
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth);
+    ASSERT(chromaPartHeight);
+    ASSERT(xFrac < 8);
+    ASSERT(yFrac < 8);
+    ASSERT(ref);
+
+    if ((x0 < 0) || ((u32)x0+chromaPartWidth+1 > width) ||
+        (y0 < 0) || ((u32)y0+chromaPartHeight+1 > height))
+    {
+        h264bsdFillBlock(ref, block, x0, y0, width, height,
+            chromaPartWidth + 1, chromaPartHeight + 1, chromaPartWidth + 1);
+        ref += width * height;
+        h264bsdFillBlock(ref, block + (chromaPartWidth+1)*(chromaPartHeight+1),
+            x0, y0, width, height, chromaPartWidth + 1,
+            chromaPartHeight + 1, chromaPartWidth + 1);
+
+        ref = block;
+        x0 = 0;
+        y0 = 0;
+        width = chromaPartWidth+1;
+        height = chromaPartHeight+1;
+    }
+
+    /* weights of the four surrounding samples, sum of weighted samples is
+     * at most 64*255 + 32 and fits in 16 bits */
+#ifdef __SSSE3__
+    /* pairs of 8-bit weights for A and B, and for C and D */
+    valA = _mm_set1_epi16((i16)(xFrac * (8 - yFrac) << 8 |
+        (8 - xFrac) * (8 - yFrac)));
+    valC = _mm_set1_epi16((i16)(xFrac * yFrac << 8 | (8 - xFrac) * yFrac));
+#else
+    valA = _mm_set1_epi16((i16)((8 - xFrac) * (8 - yFrac)));
+    valB = _mm_set1_epi16((i16)(xFrac * (8 - yFrac)));
+    valC = _mm_set1_epi16((i16)((8 - xFrac) * yFrac));
+    valD = _mm_set1_epi16((i16)(xFrac * yFrac));
+    zero = _mm_setzero_si128();
+#endif
+    round = _mm_set1_epi16(32);
+
+    for (comp = 0; comp <= 1; comp++)
+    {
+
+        ptrA = ref + (comp * height + (u32)y0) * width + x0;
+        cbr = predPartChroma + comp * 8 * 8;
+
+#ifdef __SSSE3__
+        a = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth),
+            LoadBytes(ptrA + 1, chromaPartWidth));
+#else
+        a = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth), zero);
+        b = _mm_unpacklo_epi8(LoadBytes(ptrA + 1, chromaPartWidth), zero);
+#endif
+        for (y = chromaPartHeight; y; y--)
+        {
+            ptrA += width;
+#ifdef __SSSE3__
+            c = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth),
+                LoadBytes(ptrA + 1, chromaPartWidth));
+            tmp = _mm_add_epi16(_mm_maddubs_epi16(a, valA),
+                _mm_maddubs_epi16(c, valC));
+#else
+            c = _mm_unpacklo_epi8(LoadBytes(ptrA, chromaPartWidth), zero);
+            d = _mm_unpacklo_epi8(LoadBytes(ptrA + 1, chromaPartWidth), zero);
+            tmp = _mm_add_epi16(
+                _mm_add_epi16(_mm_mullo_epi16(a, valA),
+                    _mm_mullo_epi16(b, valB)),
+                _mm_add_epi16(_mm_mullo_epi16(c, valC),
+                    _mm_mullo_epi16(d, valD)));
+#endif
+            tmp = _mm_srli_epi16(_mm_add_epi16(tmp, round), 6);
+            StoreBytes(cbr, _mm_packus_epi16(tmp, tmp), chromaPartWidth);
+            cbr += 8;
+            a = c;
+#ifndef __SSSE3__
+            b = d;
+#endif
+        }
+    }
+
+}
+
+void h264bsdInterpolateVerHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth, partHeight+5, partWidth);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    FilterVer(ref, width, mb, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 verOffset)    /* 0 for pixel d, 1 for pixel n */
+{
+    u32 p1[21*21/4+1];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth, partHeight+5, partWidth);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    FilterVer(ref, width, mb, partWidth, partHeight);
+    /* average with integer sample position, either G or M */
+    Average(mb, ref + (2+verOffset)*width, width, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateHorHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    ASSERT(ref);
+    ASSERT(mb);
+    ASSERT((partWidth&0x3) == 0);
+    ASSERT((partHeight&0x3) == 0);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth + 5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    FilterHor(ref, width, mb, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateHorQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horOffset) /* 0 for pixel a, 1 for pixel c */
+{
+    u32 p1[21*21/4+1];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth + 5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    FilterHor(ref, width, mb, partWidth, partHeight);
+    /* average with integer sample position, either G or H */
+    Average(mb, ref + 2 + horOffset, width, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateHorVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horVerOffset) /* 0 for pixel e, 1 for pixel g,
+                       2 for pixel p, 3 for pixel r */
+{
+    u32 p1[21*21/4+1];
+    u8 ver[16*16];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight+5, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth+5;
+    }
+
+    /* Ref points to G + (-2, -2) */
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* horizontal interpolation of either row J or Q, vertical
+     * interpolation of either column C or D, and average of the two */
+    FilterHor(ref + (((horVerOffset & 0x2) >> 1) + 2) * width, width, mb,
+        partWidth, partHeight);
+    FilterVer(ref + 2 + (horVerOffset & 0x1), width, ver,
+        partWidth, partHeight);
+    Average(mb, ver, 16, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateMidHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight+5, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth+5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    FilterMid(ref, width, mb, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateMidVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 verOffset)    /* 0 for pixel f, 1 for pixel q */
+{
+    u32 p1[21*21/4+1];
+    u8 hor[16*16];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight+5, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth+5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* average of 'j' and horizontal interpolation of either row J or Q */
+    FilterMid(ref, width, mb, partWidth, partHeight);
+    FilterHor(ref + (2+verOffset)*width, width, hor, partWidth, partHeight);
+    Average(mb, hor, 16, partWidth, partHeight);
+
+}
+
+void h264bsdInterpolateMidHorQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horOffset)    /* 0 for pixel i, 1 for pixel k */
+{
+    u32 p1[21*21/4+1];
+    u8 ver[16*16];
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight+5, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth+5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* average of 'j' and vertical interpolation of either column C or D */
+    FilterMid(ref, width, mb, partWidth, partHeight);
+    FilterVer(ref + 2 + horOffset, width, ver, partWidth, partHeight);
+    Average(mb, ver, 16, partWidth, partHeight);
+
+}
+
+#endif /* H264DEC_X86 */
+
 
 /*------------------------------------------------------------------------------
 
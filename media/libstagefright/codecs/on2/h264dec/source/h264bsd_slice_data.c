@@ -190,6 +190,9 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
             return(tmp);
         }
 
+        if (pStorage->filterThread)
+            h264bsdFilterThreadMbDecoded(pStorage->filterThread, currMbAddr);
+
         /* increment macroblock count only for macroblocks that were decoded
          * for the first time (redundant slices) */
         if (pStorage->mb[currMbAddr].decoded == 1)
@@ -37,6 +37,10 @@
 #include "h264bsd_transform.h"
 #include "h264bsd_util.h"
 
+#ifdef H264DEC_X86
+#include <emmintrin.h>
+#endif /* H264DEC_X86 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -98,9 +102,11 @@ u32 h264bsdProcessBlock(i32 *data, u32 qp, u32 skip, u32 coeffMap)
 
     i32 tmp0, tmp1, tmp2, tmp3;
     i32 d1, d2, d3;
-    u32 row,col;
     u32 qpDiv;
+#ifndef H264DEC_X86
+    u32 row,col;
     i32 *ptr;
+#endif /* H264DEC_X86 */
 
 /* Code */
 
@@ -152,6 +158,7 @@ u32 h264bsdProcessBlock(i32 *data, u32 qp, u32 skip, u32 coeffMap)
         data[10] = (d2 * tmp1);
         data[11] = (d3 * tmp2);
 
+#ifndef H264DEC_X86
         /* horizontal transform */
         for (row = 4, ptr = data; row--; ptr += 4)
         {
@@ -184,6 +191,74 @@ u32 h264bsdProcessBlock(i32 *data, u32 qp, u32 skip, u32 coeffMap)
                 ((u32)(data[12] + 512) > 1023) )
                 return(HANTRO_NOK);
         }
+#else
+        {
+            /* Both passes work on four rows or columns at a time, the block
+             * is transposed before and after the horizontal one. */
+            __m128i r0, r1, r2, r3, t0, t1, t2, t3, range;
+
+            r0 = _mm_loadu_si128((const __m128i*)data);
+            r1 = _mm_loadu_si128((const __m128i*)(data + 4));
+            r2 = _mm_loadu_si128((const __m128i*)(data + 8));
+            r3 = _mm_loadu_si128((const __m128i*)(data + 12));
+
+            t0 = _mm_unpacklo_epi32(r0, r1);
+            t1 = _mm_unpacklo_epi32(r2, r3);
+            t2 = _mm_unpackhi_epi32(r0, r1);
+            t3 = _mm_unpackhi_epi32(r2, r3);
+            r0 = _mm_unpacklo_epi64(t0, t1);
+            r1 = _mm_unpackhi_epi64(t0, t1);
+            r2 = _mm_unpacklo_epi64(t2, t3);
+            r3 = _mm_unpackhi_epi64(t2, t3);
+
+            /* horizontal transform */
+            t0 = _mm_add_epi32(r0, r2);
+            t1 = _mm_sub_epi32(r0, r2);
+            t2 = _mm_sub_epi32(_mm_srai_epi32(r1, 1), r3);
+            t3 = _mm_add_epi32(r1, _mm_srai_epi32(r3, 1));
+            r0 = _mm_add_epi32(t0, t3);
+            r1 = _mm_add_epi32(t1, t2);
+            r2 = _mm_sub_epi32(t1, t2);
+            r3 = _mm_sub_epi32(t0, t3);
+
+            t0 = _mm_unpacklo_epi32(r0, r1);
+            t1 = _mm_unpacklo_epi32(r2, r3);
+            t2 = _mm_unpackhi_epi32(r0, r1);
+            t3 = _mm_unpackhi_epi32(r2, r3);
+            r0 = _mm_unpacklo_epi64(t0, t1);
+            r1 = _mm_unpackhi_epi64(t0, t1);
+            r2 = _mm_unpacklo_epi64(t2, t3);
+            r3 = _mm_unpackhi_epi64(t2, t3);
+
+            /* then vertical transform, rounding included */
+            r0 = _mm_add_epi32(r0, _mm_set1_epi32(32));
+            t0 = _mm_add_epi32(r0, r2);
+            t1 = _mm_sub_epi32(r0, r2);
+            t2 = _mm_sub_epi32(_mm_srai_epi32(r1, 1), r3);
+            t3 = _mm_add_epi32(r1, _mm_srai_epi32(r3, 1));
+            r0 = _mm_srai_epi32(_mm_add_epi32(t0, t3), 6);
+            r1 = _mm_srai_epi32(_mm_add_epi32(t1, t2), 6);
+            r2 = _mm_srai_epi32(_mm_sub_epi32(t1, t2), 6);
+            r3 = _mm_srai_epi32(_mm_sub_epi32(t0, t3), 6);
+
+            _mm_storeu_si128((__m128i*)data, r0);
+            _mm_storeu_si128((__m128i*)(data + 4), r1);
+            _mm_storeu_si128((__m128i*)(data + 8), r2);
+            _mm_storeu_si128((__m128i*)(data + 12), r3);
+
+            /* check that each value is in the range [-512,511] */
+            t0 = _mm_set1_epi32(511);
+            t1 = _mm_set1_epi32(-512);
+            range = _mm_or_si128(
+                _mm_or_si128(_mm_cmpgt_epi32(r0, t0), _mm_cmplt_epi32(r0, t1)),
+                _mm_or_si128(_mm_cmpgt_epi32(r1, t0), _mm_cmplt_epi32(r1, t1)));
+            range = _mm_or_si128(range, _mm_or_si128(
+                _mm_or_si128(_mm_cmpgt_epi32(r2, t0), _mm_cmplt_epi32(r2, t1)),
+                _mm_or_si128(_mm_cmpgt_epi32(r3, t0), _mm_cmplt_epi32(r3, t1))));
+            if (_mm_movemask_epi8(range))
+                return(HANTRO_NOK);
+        }
+#endif /* H264DEC_X86 */
     }
     else /* rows 1, 2 and 3 are zero */
     {
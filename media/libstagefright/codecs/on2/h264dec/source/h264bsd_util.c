@@ -28,6 +28,7 @@
           h264bsdMoreRbspData
           h264bsdNextMbAddress
           h264bsdSetCurrImageMbPointers
+          h264bsdAddResidual4x4
 
 ------------------------------------------------------------------------------*/
 
@@ -37,6 +38,10 @@
 
 #include "h264bsd_util.h"
 
+#ifdef H264DEC_X86
+#include <emmintrin.h>
+#endif /* H264DEC_X86 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -281,4 +286,69 @@ void h264bsdSetCurrImageMbPointers(image_t *image, u32 mbNum)
     image->cr = (u8*)(image->cb + picSize * 64);
 }
 
+#ifdef H264DEC_X86
+/*------------------------------------------------------------------------------
+
+   5.6  Function: h264bsdAddResidual4x4
+
+        Functional description:
+            Add residual of a 4x4 block into its prediction and write the
+            clipped sum into the image or macroblock array. Residual values
+            are within [-512, 511], so the sum is computed with 16-bit
+            precision.
+
+        Inputs:
+            pred        pointer to the prediction of the block
+            predWidth   width of the array the prediction is in
+            residual    residual of the block, 16 values in raster scan order
+            width       width of the array the output is written to
+
+        Outputs:
+            data        pointer to the output block, may be equal to pred
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+void h264bsdAddResidual4x4(u8 *data, u32 width, const u8 *pred, u32 predWidth,
+    const i32 *residual)
+{
+
+/* Variables */
+
+    __m128i res01, res23, pred01, pred23, out;
+    const __m128i zero = _mm_setzero_si128();
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(pred);
+    ASSERT(residual);
+    ASSERT(!((uintptr_t)data&0x3));
+    ASSERT(!((uintptr_t)pred&0x3));
+
+    res01 = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)residual),
+        _mm_loadu_si128((const __m128i*)(residual + 4)));
+    res23 = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(residual + 8)),
+        _mm_loadu_si128((const __m128i*)(residual + 12)));
+
+    /*lint -e826 */
+    pred01 = _mm_unpacklo_epi32(
+        _mm_cvtsi32_si128(*(const i32*)pred),
+        _mm_cvtsi32_si128(*(const i32*)(pred + predWidth)));
+    pred23 = _mm_unpacklo_epi32(
+        _mm_cvtsi32_si128(*(const i32*)(pred + 2*predWidth)),
+        _mm_cvtsi32_si128(*(const i32*)(pred + 3*predWidth)));
+
+    out = _mm_packus_epi16(
+        _mm_add_epi16(_mm_unpacklo_epi8(pred01, zero), res01),
+        _mm_add_epi16(_mm_unpacklo_epi8(pred23, zero), res23));
+
+    *(i32*)data = _mm_cvtsi128_si32(out);
+    *(i32*)(data + width) = _mm_cvtsi128_si32(_mm_srli_si128(out, 4));
+    *(i32*)(data + 2*width) = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+    *(i32*)(data + 3*width) = _mm_cvtsi128_si32(_mm_srli_si128(out, 12));
+
+}
+#endif /* H264DEC_X86 */
 
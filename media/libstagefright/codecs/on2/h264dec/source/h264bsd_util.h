@@ -175,5 +175,10 @@ u32 h264bsdNextMbAddress(u32 *pSliceGroupMap, u32 picSizeInMbs, u32 currMbAddr);
 
 void h264bsdSetCurrImageMbPointers(image_t *image, u32 mbNum);
 
+#ifdef H264DEC_X86
+void h264bsdAddResidual4x4(u8 *data, u32 width, const u8 *pred, u32 predWidth,
+    const i32 *residual);
+#endif /* H264DEC_X86 */
+
 #endif /* #ifdef H264SWDEC_UTIL_H */
 
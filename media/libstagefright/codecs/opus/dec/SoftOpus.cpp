@@ -62,6 +62,8 @@ SoftOpus::SoftOpus(
       mSeekPreRoll(0),
       mAnchorTimeUs(0),
       mNumFramesOutput(0),
+      mFirstPacket(true),
+      mMaxFramesPerBuffer(1),
       mOutputPortSettingsChange(NONE) {
     initPorts();
     CHECK_EQ(initDecoder(), (status_t)OK);
@@ -186,6 +188,23 @@ OMX_ERRORTYPE SoftOpus::internalGetParameter(
             return OMX_ErrorNone;
         }
 
+        case kMultiFrameBuffersIndex:
+        {
+            OMX_PARAM_U32TYPE *framesParams = (OMX_PARAM_U32TYPE *)params;
+
+            if (!isValidOMXParam(framesParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (framesParams->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            framesParams->nU32 = mMaxFramesPerBuffer;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalGetParameter(index, params);
     }
@@ -228,11 +247,45 @@ OMX_ERRORTYPE SoftOpus::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case kMultiFrameBuffersIndex:
+        {
+            const OMX_PARAM_U32TYPE *framesParams =
+                (const OMX_PARAM_U32TYPE *)params;
+
+            if (!isValidOMXParam(framesParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (framesParams->nPortIndex != 1 || framesParams->nU32 == 0) {
+                return OMX_ErrorUndefined;
+            }
+
+            // The output buffers already hold the longest packets of the most
+            // channels, so they are not grown; packets of common streams
+            // are short enough for several to fit.
+            mMaxFramesPerBuffer = kMaxFramesPerBuffer;
+            if (framesParams->nU32 < (OMX_U32)kMaxFramesPerBuffer) {
+                mMaxFramesPerBuffer = framesParams->nU32;
+            }
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalSetParameter(index, params);
     }
 }
 
+OMX_ERRORTYPE SoftOpus::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.multiFrameBuffers")) {
+        *(int32_t *)index = kMultiFrameBuffersIndex;
+        return OMX_ErrorNone;
+    }
+
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 bool SoftOpus::isConfigured() const {
     return mInputBufferCount >= 1;
 }
@@ -416,101 +469,154 @@ void SoftOpus::onQueueFilled(OMX_U32 portIndex) {
     }
 
     while (!inQueue.empty() && !outQueue.empty()) {
-        BufferInfo *inInfo = *inQueue.begin();
-        OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
-
-        // Ignore CSD re-submissions.
-        if (inHeader->nFlags & OMX_BUFFERFLAG_CODECCONFIG) {
-            inQueue.erase(inQueue.begin());
-            inInfo->mOwnedByUs = false;
-            notifyEmptyBufferDone(inHeader);
-            return;
-        }
-
         BufferInfo *outInfo = *outQueue.begin();
         OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
 
-        if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-            inQueue.erase(inQueue.begin());
-            inInfo->mOwnedByUs = false;
-            notifyEmptyBufferDone(inHeader);
+        outHeader->nOffset = 0;
+        outHeader->nFilledLen = 0;
+        outHeader->nFlags = 0;
 
-            outHeader->nFilledLen = 0;
-            outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+        int32_t numFramesInBuffer = 0;
+        do {
+            BufferInfo *inInfo = *inQueue.begin();
+            OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+
+            // Ignore CSD re-submissions.
+            if (inHeader->nFlags & OMX_BUFFERFLAG_CODECCONFIG) {
+                if (numFramesInBuffer > 0) {
+                    break;
+                }
+                inQueue.erase(inQueue.begin());
+                inInfo->mOwnedByUs = false;
+                notifyEmptyBufferDone(inHeader);
+                return;
+            }
 
-            outQueue.erase(outQueue.begin());
-            outInfo->mOwnedByUs = false;
-            notifyFillBufferDone(outHeader);
-            return;
-        }
+            // An EOS buffer may still hold packets, they are decoded first.
+            if ((inHeader->nFlags & OMX_BUFFERFLAG_EOS)
+                    && inHeader->nFilledLen == 0) {
+                inQueue.erase(inQueue.begin());
+                inInfo->mOwnedByUs = false;
+                notifyEmptyBufferDone(inHeader);
 
-        if (inHeader->nOffset == 0) {
-            mAnchorTimeUs = inHeader->nTimeStamp;
-            mNumFramesOutput = 0;
-        }
+                outHeader->nFlags = OMX_BUFFERFLAG_EOS;
 
-        // When seeking to zero, |mCodecDelay| samples has to be discarded
-        // instead of |mSeekPreRoll| samples (as we would when seeking to any
-        // other timestamp).
-        if (inHeader->nTimeStamp == 0) {
-            mSamplesToDiscard = mCodecDelay;
-        }
+                outQueue.erase(outQueue.begin());
+                outInfo->mOwnedByUs = false;
+                notifyFillBufferDone(outHeader);
+                return;
+            }
 
-        const uint8_t *data = inHeader->pBuffer + inHeader->nOffset;
-        const uint32_t size = inHeader->nFilledLen;
-        size_t frameSize = kMaxOpusOutputPacketSizeSamples;
-        if (frameSize > outHeader->nAllocLen / sizeof(int16_t) / mHeader->channels) {
-            frameSize = outHeader->nAllocLen / sizeof(int16_t) / mHeader->channels;
-            android_errorWriteLog(0x534e4554, "27833616");
-        }
+            const uint8_t *data = inHeader->pBuffer + inHeader->nOffset;
+            uint32_t size = inHeader->nFilledLen;
+            size_t inputUsedLength = inHeader->nFilledLen;
+            if (mMaxFramesPerBuffer > 1) {
+                if (inHeader->nFilledLen >= sizeof(size)) {
+                    memcpy(&size, data, sizeof(size));
+                }
+                if (inHeader->nFilledLen < sizeof(size)
+                        || size > inHeader->nFilledLen - sizeof(size)) {
+                    ALOGE("bad packet length in input buffer");
+                    notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                    return;
+                }
+                data += sizeof(size);
+                inputUsedLength = sizeof(size) + size;
+            }
 
-        int numFrames = opus_multistream_decode(mDecoder,
-                                                data,
-                                                size,
-                                                (int16_t *)outHeader->pBuffer,
-                                                frameSize,
-                                                0);
-        if (numFrames < 0) {
-            ALOGE("opus_multistream_decode returned %d", numFrames);
-            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-            return;
-        }
+            if (inHeader->nOffset == 0) {
+                mAnchorTimeUs = inHeader->nTimeStamp;
+                mNumFramesOutput = 0;
+            }
 
-        outHeader->nOffset = 0;
-        if (mSamplesToDiscard > 0) {
-            if (mSamplesToDiscard > numFrames) {
-                mSamplesToDiscard -= numFrames;
-                numFrames = 0;
-            } else {
-                numFrames -= mSamplesToDiscard;
-                outHeader->nOffset = mSamplesToDiscard * sizeof(int16_t) *
-                                     mHeader->channels;
-                mSamplesToDiscard = 0;
+            // When seeking to zero, |mCodecDelay| samples has to be discarded
+            // instead of |mSeekPreRoll| samples (as we would when seeking to any
+            // other timestamp). Only the first packet after a flush starts the
+            // discard; packets that lie within the codec delay are stamped 0 as
+            // well, and must not start it over.
+            if (mFirstPacket && inHeader->nTimeStamp == 0) {
+                mSamplesToDiscard = mCodecDelay;
+            }
+            mFirstPacket = false;
+
+            // the PCM of each packet follows that of the previous one
+            size_t outOffset = outHeader->nOffset + outHeader->nFilledLen;
+            size_t outSize = outHeader->nAllocLen - outOffset;
+            size_t frameSize = kMaxOpusOutputPacketSizeSamples;
+            if (frameSize > outSize / sizeof(int16_t) / mHeader->channels) {
+                frameSize = outSize / sizeof(int16_t) / mHeader->channels;
+                android_errorWriteLog(0x534e4554, "27833616");
             }
-        }
 
-        outHeader->nFilledLen = numFrames * sizeof(int16_t) * mHeader->channels;
-        outHeader->nFlags = 0;
+            int numFrames = opus_multistream_decode(mDecoder,
+                                                    data,
+                                                    size,
+                                                    (int16_t *)(outHeader->pBuffer
+                                                            + outOffset),
+                                                    frameSize,
+                                                    0);
+            if (numFrames < 0) {
+                ALOGE("opus_multistream_decode returned %d", numFrames);
+                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                return;
+            }
 
-        outHeader->nTimeStamp = mAnchorTimeUs +
-                                (mNumFramesOutput * 1000000ll) /
-                                kRate;
+            size_t discardLength = 0;
+            if (mSamplesToDiscard > 0) {
+                if (mSamplesToDiscard > numFrames) {
+                    mSamplesToDiscard -= numFrames;
+                    numFrames = 0;
+                } else {
+                    numFrames -= mSamplesToDiscard;
+                    discardLength = mSamplesToDiscard * sizeof(int16_t) *
+                                    mHeader->channels;
+                    mSamplesToDiscard = 0;
+                }
+            }
 
-        mNumFramesOutput += numFrames;
+            size_t frameLength = numFrames * sizeof(int16_t) * mHeader->channels;
+            if (outHeader->nFilledLen == 0) {
+                outHeader->nOffset += discardLength;
+                outHeader->nTimeStamp = mAnchorTimeUs +
+                                        (mNumFramesOutput * 1000000ll) /
+                                        kRate;
+            } else if (discardLength > 0) {
+                memmove(outHeader->pBuffer + outOffset,
+                        outHeader->pBuffer + outOffset + discardLength,
+                        frameLength);
+            }
+            outHeader->nFilledLen += frameLength;
+
+            mNumFramesOutput += numFrames;
+
+            inHeader->nOffset += inputUsedLength;
+            inHeader->nFilledLen -= inputUsedLength;
+            if (inHeader->nFilledLen == 0) {
+                if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+                    outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+                }
+
+                inInfo->mOwnedByUs = false;
+                inQueue.erase(inQueue.begin());
+                inInfo = NULL;
+                notifyEmptyBufferDone(inHeader);
+                inHeader = NULL;
+            }
 
-        inInfo->mOwnedByUs = false;
-        inQueue.erase(inQueue.begin());
-        inInfo = NULL;
-        notifyEmptyBufferDone(inHeader);
-        inHeader = NULL;
+            ++mInputBufferCount;
+            ++numFramesInBuffer;
+        } while (numFramesInBuffer < mMaxFramesPerBuffer
+                && !(outHeader->nFlags & OMX_BUFFERFLAG_EOS)
+                && !inQueue.empty()
+                && outHeader->nAllocLen - outHeader->nOffset - outHeader->nFilledLen
+                        >= kMaxOpusOutputPacketSizeSamples * sizeof(int16_t)
+                                * mHeader->channels);
 
         outInfo->mOwnedByUs = false;
         outQueue.erase(outQueue.begin());
         outInfo = NULL;
         notifyFillBufferDone(outHeader);
         outHeader = NULL;
-
-        ++mInputBufferCount;
     }
 }
 
@@ -522,12 +628,14 @@ void SoftOpus::onPortFlushCompleted(OMX_U32 portIndex) {
         opus_multistream_decoder_ctl(mDecoder, OPUS_RESET_STATE);
         mAnchorTimeUs = 0;
         mSamplesToDiscard = mSeekPreRoll;
+        mFirstPacket = true;
     }
 }
 
 void SoftOpus::onReset() {
     mInputBufferCount = 0;
     mNumFramesOutput = 0;
+    mFirstPacket = true;
     if (mDecoder != NULL) {
         opus_multistream_decoder_destroy(mDecoder);
         mDecoder = NULL;
@@ -54,6 +54,9 @@ protected:
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onPortEnableCompleted(OMX_U32 portIndex, bool enabled);
@@ -62,7 +65,8 @@ protected:
 private:
     enum {
         kNumBuffers = 4,
-        kMaxNumSamplesPerBuffer = 960 * 6
+        kMaxNumSamplesPerBuffer = 960 * 6,
+        kMaxFramesPerBuffer = 16
     };
 
     size_t mInputBufferCount;
@@ -75,6 +79,12 @@ private:
     int64_t mSamplesToDiscard;
     int64_t mAnchorTimeUs;
     int64_t mNumFramesOutput;
+    bool mFirstPacket;  // no packet decoded since start or the last flush
+
+    // With more than one frame per buffer, input buffers hold a sequence of
+    // packets each preceded by its length, and output buffers the PCM of as
+    // many of them as fit.
+    int32_t mMaxFramesPerBuffer;
 
     enum {
         NONE,
@@ -54,6 +54,7 @@ SoftVorbis::SoftVorbis(
       mAnchorTimeUs(0),
       mNumFramesOutput(0),
       mNumFramesLeftOnPage(-1),
+      mMaxFramesPerBuffer(1),
       mSawInputEos(false),
       mSignalledOutputEos(false),
       mSignalledError(false),
@@ -125,7 +126,7 @@ status_t SoftVorbis::initDecoder() {
 
 OMX_ERRORTYPE SoftVorbis::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
-    switch (index) {
+    switch ((int)index) {
         case OMX_IndexParamAudioVorbis:
         {
             OMX_AUDIO_PARAM_VORBISTYPE *vorbisParams =
@@ -193,6 +194,23 @@ OMX_ERRORTYPE SoftVorbis::internalGetParameter(
             return OMX_ErrorNone;
         }
 
+        case kMultiFrameBuffersIndex:
+        {
+            OMX_PARAM_U32TYPE *framesParams = (OMX_PARAM_U32TYPE *)params;
+
+            if (!isValidOMXParam(framesParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (framesParams->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            framesParams->nU32 = mMaxFramesPerBuffer;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalGetParameter(index, params);
     }
@@ -200,7 +218,7 @@ OMX_ERRORTYPE SoftVorbis::internalGetParameter(
 
 OMX_ERRORTYPE SoftVorbis::internalSetParameter(
         OMX_INDEXTYPE index, const OMX_PTR params) {
-    switch (index) {
+    switch ((int)index) {
         case OMX_IndexParamStandardComponentRole:
         {
             const OMX_PARAM_COMPONENTROLETYPE *roleParams =
@@ -235,11 +253,44 @@ OMX_ERRORTYPE SoftVorbis::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case kMultiFrameBuffersIndex:
+        {
+            const OMX_PARAM_U32TYPE *framesParams =
+                (const OMX_PARAM_U32TYPE *)params;
+
+            if (!isValidOMXParam(framesParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (framesParams->nPortIndex != 1 || framesParams->nU32 == 0) {
+                return OMX_ErrorUndefined;
+            }
+
+            mMaxFramesPerBuffer = kMaxFramesPerBuffer;
+            if (framesParams->nU32 < (OMX_U32)kMaxFramesPerBuffer) {
+                mMaxFramesPerBuffer = framesParams->nU32;
+            }
+            editPortInfo(1)->mDef.nBufferSize =
+                kMaxNumSamplesPerBuffer * sizeof(int16_t) * mMaxFramesPerBuffer;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalSetParameter(index, params);
     }
 }
 
+OMX_ERRORTYPE SoftVorbis::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.multiFrameBuffers")) {
+        *(int32_t *)index = kMultiFrameBuffersIndex;
+        return OMX_ErrorNone;
+    }
+
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 bool SoftVorbis::isConfigured() const {
     return mInputBufferCount >= 2;
 }
@@ -327,133 +378,189 @@ void SoftVorbis::onQueueFilled(OMX_U32 portIndex) {
     }
 
     while ((!inQueue.empty() || (mSawInputEos && !mSignalledOutputEos)) && !outQueue.empty()) {
-        BufferInfo *inInfo = NULL;
-        OMX_BUFFERHEADERTYPE *inHeader = NULL;
-        if (!inQueue.empty()) {
-            inInfo = *inQueue.begin();
-            inHeader = inInfo->mHeader;
-        }
-
         BufferInfo *outInfo = *outQueue.begin();
         OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
 
-        int32_t numPageSamples = 0;
+        outHeader->nFlags = 0;
+        outHeader->nFilledLen = 0;
+        outHeader->nOffset = 0;
 
-        if (inHeader) {
-            if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-                mSawInputEos = true;
+        int32_t numFramesInBuffer = 0;
+        do {
+            BufferInfo *inInfo = NULL;
+            OMX_BUFFERHEADERTYPE *inHeader = NULL;
+            if (!inQueue.empty()) {
+                inInfo = *inQueue.begin();
+                inHeader = inInfo->mHeader;
             }
 
-            if (inHeader->nFilledLen || !mSawInputEos) {
-                if (inHeader->nFilledLen < sizeof(numPageSamples)) {
+            int32_t numPageSamples = 0;
+            const uint8_t *packetData = NULL;
+            size_t packetSize = 0;
+            size_t inputUsedLength = 0;
+
+            if (inHeader && mMaxFramesPerBuffer > 1 && inHeader->nFilledLen > 0) {
+                uint32_t frameLength = 0;
+                if (inHeader->nFilledLen >= sizeof(frameLength)) {
+                    memcpy(&frameLength, inHeader->pBuffer + inHeader->nOffset,
+                            sizeof(frameLength));
+                }
+                if (frameLength < sizeof(numPageSamples)
+                        || inHeader->nFilledLen < sizeof(frameLength)
+                        || frameLength > inHeader->nFilledLen - sizeof(frameLength)) {
                     notify(OMX_EventError, OMX_ErrorBadParameter, 0, NULL);
                     mSignalledError = true;
-                    ALOGE("onQueueFilled, input header has nFilledLen %u, expected %zu",
-                            inHeader->nFilledLen, sizeof(numPageSamples));
+                    ALOGE("onQueueFilled, bad frame length in input header");
                     return;
                 }
-                memcpy(&numPageSamples,
-                       inHeader->pBuffer
-                        + inHeader->nOffset + inHeader->nFilledLen - 4,
-                       sizeof(numPageSamples));
+                inputUsedLength = sizeof(frameLength) + frameLength;
+
+                if ((inHeader->nFlags & OMX_BUFFERFLAG_EOS)
+                        && inputUsedLength == inHeader->nFilledLen) {
+                    mSawInputEos = true;
+                }
+
+                packetData = inHeader->pBuffer + inHeader->nOffset + sizeof(frameLength);
+                packetSize = frameLength - sizeof(numPageSamples);
+                memcpy(&numPageSamples, packetData + packetSize, sizeof(numPageSamples));
 
                 if (inHeader->nOffset == 0) {
                     mAnchorTimeUs = inHeader->nTimeStamp;
                     mNumFramesOutput = 0;
                 }
+            } else if (inHeader) {
+                if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+                    mSawInputEos = true;
+                }
 
-                inHeader->nFilledLen -= sizeof(numPageSamples);;
-            }
-        }
-
-        if (numPageSamples >= 0) {
-            mNumFramesLeftOnPage = numPageSamples;
-        }
-
-        ogg_buffer buf;
-        buf.data = inHeader ? inHeader->pBuffer + inHeader->nOffset : NULL;
-        buf.size = inHeader ? inHeader->nFilledLen : 0;
-        buf.refcount = 1;
-        buf.ptr.owner = NULL;
-
-        ogg_reference ref;
-        ref.buffer = &buf;
-        ref.begin = 0;
-        ref.length = buf.size;
-        ref.next = NULL;
+                if (inHeader->nFilledLen || !mSawInputEos) {
+                    if (inHeader->nFilledLen < sizeof(numPageSamples)) {
+                        notify(OMX_EventError, OMX_ErrorBadParameter, 0, NULL);
+                        mSignalledError = true;
+                        ALOGE("onQueueFilled, input header has nFilledLen %u, expected %zu",
+                                inHeader->nFilledLen, sizeof(numPageSamples));
+                        return;
+                    }
+                    memcpy(&numPageSamples,
+                           inHeader->pBuffer
+                            + inHeader->nOffset + inHeader->nFilledLen - 4,
+                           sizeof(numPageSamples));
+
+                    if (inHeader->nOffset == 0) {
+                        mAnchorTimeUs = inHeader->nTimeStamp;
+                        mNumFramesOutput = 0;
+                    }
+
+                    inHeader->nFilledLen -= sizeof(numPageSamples);;
+                }
 
-        ogg_packet pack;
-        pack.packet = &ref;
-        pack.bytes = ref.length;
-        pack.b_o_s = 0;
-        pack.e_o_s = 0;
-        pack.granulepos = 0;
-        pack.packetno = 0;
+                packetData = inHeader->pBuffer + inHeader->nOffset;
+                packetSize = inHeader->nFilledLen;
+                inputUsedLength = inHeader->nFilledLen;
+            }
 
-        int numFrames = 0;
+            if (numPageSamples >= 0) {
+                mNumFramesLeftOnPage = numPageSamples;
+            }
 
-        outHeader->nFlags = 0;
-        int err = vorbis_dsp_synthesis(mState, &pack, 1);
-        if (err != 0) {
-            // FIXME temporary workaround for log spam
+            ogg_buffer buf;
+            buf.data = const_cast<uint8_t *>(packetData);
+            buf.size = packetSize;
+            buf.refcount = 1;
+            buf.ptr.owner = NULL;
+
+            ogg_reference ref;
+            ref.buffer = &buf;
+            ref.begin = 0;
+            ref.length = buf.size;
+            ref.next = NULL;
+
+            ogg_packet pack;
+            pack.packet = &ref;
+            pack.bytes = ref.length;
+            pack.b_o_s = 0;
+            pack.e_o_s = 0;
+            pack.granulepos = 0;
+            pack.packetno = 0;
+
+            int numFrames = 0;
+
+            // the PCM of each packet follows that of the previous one
+            size_t outOffset = outHeader->nOffset + outHeader->nFilledLen;
+
+            int err = vorbis_dsp_synthesis(mState, &pack, 1);
+            if (err != 0) {
+                // FIXME temporary workaround for log spam
 #if !defined(__arm__) && !defined(__aarch64__)
-            ALOGV("vorbis_dsp_synthesis returned %d", err);
+                ALOGV("vorbis_dsp_synthesis returned %d", err);
 #else
-            ALOGW("vorbis_dsp_synthesis returned %d", err);
+                ALOGW("vorbis_dsp_synthesis returned %d", err);
 #endif
-        } else {
-            size_t numSamplesPerBuffer = kMaxNumSamplesPerBuffer;
-            if (numSamplesPerBuffer > outHeader->nAllocLen / sizeof(int16_t)) {
-                numSamplesPerBuffer = outHeader->nAllocLen / sizeof(int16_t);
-                android_errorWriteLog(0x534e4554, "27833616");
-            }
-            numFrames = vorbis_dsp_pcmout(
-                    mState, (int16_t *)outHeader->pBuffer,
-                    (numSamplesPerBuffer / mVi->channels));
+            } else {
+                size_t numSamplesPerBuffer = kMaxNumSamplesPerBuffer;
+                if (numSamplesPerBuffer > (outHeader->nAllocLen - outOffset) / sizeof(int16_t)) {
+                    numSamplesPerBuffer = (outHeader->nAllocLen - outOffset) / sizeof(int16_t);
+                    android_errorWriteLog(0x534e4554, "27833616");
+                }
+                numFrames = vorbis_dsp_pcmout(
+                        mState, (int16_t *)(outHeader->pBuffer + outOffset),
+                        (numSamplesPerBuffer / mVi->channels));
 
-            if (numFrames < 0) {
-                ALOGE("vorbis_dsp_pcmout returned %d", numFrames);
-                numFrames = 0;
+                if (numFrames < 0) {
+                    ALOGE("vorbis_dsp_pcmout returned %d", numFrames);
+                    numFrames = 0;
+                }
             }
-        }
 
-        if (mNumFramesLeftOnPage >= 0) {
-            if (numFrames > mNumFramesLeftOnPage) {
-                ALOGV("discarding %d frames at end of page",
-                     numFrames - mNumFramesLeftOnPage);
-                numFrames = mNumFramesLeftOnPage;
-                if (mSawInputEos) {
-                    outHeader->nFlags = OMX_BUFFERFLAG_EOS;
-                    mSignalledOutputEos = true;
+            if (mNumFramesLeftOnPage >= 0) {
+                if (numFrames > mNumFramesLeftOnPage) {
+                    ALOGV("discarding %d frames at end of page",
+                         numFrames - mNumFramesLeftOnPage);
+                    numFrames = mNumFramesLeftOnPage;
+                    if (mSawInputEos) {
+                        outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+                        mSignalledOutputEos = true;
+                    }
                 }
+                mNumFramesLeftOnPage -= numFrames;
             }
-            mNumFramesLeftOnPage -= numFrames;
-        }
 
-        outHeader->nFilledLen = numFrames * sizeof(int16_t) * mVi->channels;
-        outHeader->nOffset = 0;
+            if (outHeader->nFilledLen == 0) {
+                outHeader->nTimeStamp =
+                    mAnchorTimeUs
+                        + (mNumFramesOutput * 1000000ll) / mVi->rate;
+            }
 
-        outHeader->nTimeStamp =
-            mAnchorTimeUs
-                + (mNumFramesOutput * 1000000ll) / mVi->rate;
+            outHeader->nFilledLen += numFrames * sizeof(int16_t) * mVi->channels;
 
-        mNumFramesOutput += numFrames;
+            mNumFramesOutput += numFrames;
 
-        if (inHeader) {
-            inInfo->mOwnedByUs = false;
-            inQueue.erase(inQueue.begin());
-            inInfo = NULL;
-            notifyEmptyBufferDone(inHeader);
-            inHeader = NULL;
-        }
+            if (inHeader) {
+                inHeader->nOffset += inputUsedLength;
+                inHeader->nFilledLen -= inputUsedLength;
+
+                if (inHeader->nFilledLen == 0) {
+                    inInfo->mOwnedByUs = false;
+                    inQueue.erase(inQueue.begin());
+                    inInfo = NULL;
+                    notifyEmptyBufferDone(inHeader);
+                    inHeader = NULL;
+                }
+            }
+
+            ++mInputBufferCount;
+            ++numFramesInBuffer;
+        } while (numFramesInBuffer < mMaxFramesPerBuffer
+                && !mSignalledOutputEos
+                && (!inQueue.empty() || mSawInputEos)
+                && outHeader->nAllocLen - outHeader->nOffset - outHeader->nFilledLen
+                        >= kMaxNumSamplesPerBuffer * sizeof(int16_t));
 
         outInfo->mOwnedByUs = false;
         outQueue.erase(outQueue.begin());
         outInfo = NULL;
         notifyFillBufferDone(outHeader);
         outHeader = NULL;
-
-        ++mInputBufferCount;
     }
 }
 
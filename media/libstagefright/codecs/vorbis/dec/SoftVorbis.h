@@ -40,6 +40,9 @@ protected:
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onPortEnableCompleted(OMX_U32 portIndex, bool enabled);
@@ -48,7 +51,8 @@ protected:
 private:
     enum {
         kNumBuffers = 4,
-        kMaxNumSamplesPerBuffer = 8192 * 2
+        kMaxNumSamplesPerBuffer = 8192 * 2,
+        kMaxFramesPerBuffer = 16
     };
 
     size_t mInputBufferCount;
@@ -59,6 +63,11 @@ private:
     int64_t mAnchorTimeUs;
     int64_t mNumFramesOutput;
     int32_t mNumFramesLeftOnPage;
+
+    // With more than one frame per buffer, input buffers hold a sequence of
+    // packets, each with its page sample count and preceded by the length of
+    // both, and output buffers the PCM of as many of them as fit.
+    int32_t mMaxFramesPerBuffer;
     bool mSawInputEos;
     bool mSignalledOutputEos;
     bool mSignalledError;
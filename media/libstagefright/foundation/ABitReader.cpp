@@ -15,6 +15,7 @@
  */
 
 #include "ABitReader.h"
+#include "StartCodeUtils.h"
 
 #include <media/stagefright/foundation/ADebug.h>
 
@@ -132,9 +133,34 @@ const uint8_t *ABitReader::data() const {
     return mData - (mNumBitsLeft + 7) / 8;
 }
 
+// Emulation prevention bytes are rare, so NALBitReader looks for the next one
+// with findEmulationPrevention() and takes the bytes before it as they are.
+// The look-ahead is bounded so that short reads of long NAL units stay cheap.
+static const size_t kEmulationPreventionScanSize = 256;
+
+// Scans [from, end) for the next emulation_prevention_three_byte. Returns it
+// and sets |*found|, or returns how far the data was found to be free of them.
+// A 0x00 0x00 0x03 starting in the last two bytes scanned is not seen, so the
+// next scan must start two bytes before the returned position.
+static const uint8_t *scanForEmulationPrevention(
+        const uint8_t *from, const uint8_t *end, bool *found) {
+    size_t size = end - from;
+    if (size > kEmulationPreventionScanSize + 2) {
+        size = kEmulationPreventionScanSize + 2;
+    }
+
+    size_t offset = findEmulationPrevention(from, size);
+    *found = (offset < size);
+    if (*found) {
+        return from + offset + 2;
+    }
+    return from + size;
+}
+
 NALBitReader::NALBitReader(const uint8_t *data, size_t size)
-    : ABitReader(data, size),
-      mNumZeros(0) {
+    : ABitReader(data, size) {
+    mEmulationPrevention =
+        scanForEmulationPrevention(data, data + size, &mAtEmulationPrevention);
 }
 
 bool NALBitReader::atLeastNumBitsLeft(size_t n) const {
@@ -146,24 +172,30 @@ bool NALBitReader::atLeastNumBitsLeft(size_t n) const {
 
     ssize_t numBitsRemaining = (ssize_t)n - (ssize_t)mNumBitsLeft;
 
-    size_t size = mSize;
     const uint8_t *data = mData;
-    int32_t numZeros = mNumZeros;
-    while (size > 0 && numBitsRemaining > 0) {
-        bool isEmulationPreventionByte = (numZeros >= 2 && *data == 3);
-
-        if (*data == 0) {
-            ++numZeros;
-        } else {
-            numZeros = 0;
+    const uint8_t *end = mData + mSize;
+    const uint8_t *emulationPrevention = mEmulationPrevention;
+    bool atEmulationPrevention = mAtEmulationPrevention;
+    while (data < end && numBitsRemaining > 0) {
+        if (data == emulationPrevention) {
+            if (atEmulationPrevention) {
+                // skip emulation_prevention_three_byte
+                ++data;
+                emulationPrevention =
+                    scanForEmulationPrevention(data, end, &atEmulationPrevention);
+            } else {
+                emulationPrevention =
+                    scanForEmulationPrevention(data - 2, end, &atEmulationPrevention);
+            }
+            continue;
         }
 
-        if (!isEmulationPreventionByte) {
-            numBitsRemaining -= 8;
+        size_t numBytes = emulationPrevention - data;
+        if (numBytes > ((size_t)numBitsRemaining + 7) / 8) {
+            numBytes = ((size_t)numBitsRemaining + 7) / 8;
         }
-
-        ++data;
-        --size;
+        numBitsRemaining -= 8 * numBytes;
+        data += numBytes;
     }
 
     return (numBitsRemaining <= 0);
@@ -175,22 +207,33 @@ bool NALBitReader::fillReservoir() {
         return false;
     }
 
+    if (mSize >= 4 && (size_t)(mEmulationPrevention - mData) >= 4) {
+        mReservoir = (uint32_t)mData[0] << 24 | mData[1] << 16 | mData[2] << 8 | mData[3];
+        mData += 4;
+        mSize -= 4;
+        mNumBitsLeft = 32;
+        return true;
+    }
+
     mReservoir = 0;
     size_t i = 0;
     while (mSize > 0 && i < 4) {
-        bool isEmulationPreventionByte = (mNumZeros >= 2 && *mData == 3);
-
-        if (*mData == 0) {
-            ++mNumZeros;
-        } else {
-            mNumZeros = 0;
+        if (mData == mEmulationPrevention) {
+            if (mAtEmulationPrevention) {
+                // skip emulation_prevention_three_byte
+                ++mData;
+                --mSize;
+                mEmulationPrevention = scanForEmulationPrevention(
+                        mData, mData + mSize, &mAtEmulationPrevention);
+            } else {
+                mEmulationPrevention = scanForEmulationPrevention(
+                        mData - 2, mData + mSize, &mAtEmulationPrevention);
+            }
+            continue;
         }
 
-        // skip emulation_prevention_three_byte
-        if (!isEmulationPreventionByte) {
-            mReservoir = (mReservoir << 8) | *mData;
-            ++i;
-        }
+        mReservoir = (mReservoir << 8) | *mData;
+        ++i;
 
         ++mData;
         --mSize;
@@ -27,8 +27,10 @@
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
@@ -52,6 +54,17 @@ static uint64_t U64_AT(const uint8_t *ptr) {
 static const size_t kMaxUDPSize = 1500;
 static const int32_t kMaxUDPRetries = 200;
 
+static const size_t kMaxTCPReadSize = 16384;
+
+// Queued fragments are handed to the kernel with a single writev or sendmmsg
+// call in batches of up to this many.
+static const size_t kMaxFragmentsPerWrite = 64;
+
+static const int kMaxPollEvents = 64;
+
+// Tags the interrupt pipe in the epoll set, session IDs start at 1.
+static const uint32_t kInterruptEventID = 0;
+
 struct ANetworkSession::NetworkThread : public Thread {
     NetworkThread(ANetworkSession *session);
 
@@ -96,12 +109,22 @@ struct ANetworkSession::Session : public RefBase {
     bool wantsToRead();
     bool wantsToWrite();
 
+    // The socket is watched edge-triggered, so the session tracks whether
+    // the last write found room in the socket buffer.
+    bool isWritable() const;
+    void setWritable();
+
     status_t readMore();
     status_t writeMore();
 
     status_t sendRequest(
             const void *data, ssize_t size, bool timeValid, int64_t timeUs);
 
+    status_t sendDatagram(
+            const void *data, size_t size,
+            const sp<ABuffer> &payload, size_t payloadOffset,
+            size_t payloadSize, bool timeValid, int64_t timeUs);
+
     void setMode(Mode mode);
 
     status_t switchToWebSocketMode();
@@ -117,6 +140,11 @@ private:
         uint32_t mFlags;
         int64_t mTimeUs;
         sp<ABuffer> mBuffer;
+
+        // Sent following mBuffer without having been copied, if not NULL.
+        sp<ABuffer> mPayload;
+        size_t mPayloadOffset;
+        size_t mPayloadSize;
     };
 
     int32_t mSessionID;
@@ -125,6 +153,7 @@ private:
     int mSocket;
     sp<AMessage> mNotify;
     bool mSawReceiveFailure, mSawSendFailure;
+    bool mWritable;
     int32_t mUDPRetries;
 
     List<Fragment> mOutFragments;
@@ -137,6 +166,11 @@ private:
     void notify(NotificationReason reason);
 
     void dumpFragmentStats(const Fragment &frag);
+    void queueFragment(
+            const sp<ABuffer> &buffer, bool timeValid, int64_t timeUs,
+            const sp<ABuffer> &payload = NULL, size_t payloadOffset = 0,
+            size_t payloadSize = 0);
+    static size_t FillIOVec(const Fragment &frag, struct iovec *iov);
 
     DISALLOW_EVIL_CONSTRUCTORS(Session);
 };
@@ -169,6 +203,7 @@ ANetworkSession::Session::Session(
       mNotify(notify),
       mSawReceiveFailure(false),
       mSawSendFailure(false),
+      mWritable(false),
       mUDPRetries(kMaxUDPRetries),
       mLastStallReportUs(-1ll) {
     if (mState == CONNECTED) {
@@ -265,6 +300,14 @@ bool ANetworkSession::Session::wantsToWrite() {
             || (mState == DATAGRAM && !mOutFragments.empty()));
 }
 
+bool ANetworkSession::Session::isWritable() const {
+    return mWritable;
+}
+
+void ANetworkSession::Session::setWritable() {
+    mWritable = true;
+}
+
 status_t ANetworkSession::Session::readMore() {
     if (mState == DATAGRAM) {
         CHECK_EQ(mMode, MODE_DATAGRAM);
@@ -336,39 +379,55 @@ status_t ANetworkSession::Session::readMore() {
         return err;
     }
 
-    char tmp[512];
-    ssize_t n;
-    do {
-        n = recv(mSocket, tmp, sizeof(tmp), 0);
-    } while (n < 0 && errno == EINTR);
-
+    // Drain the socket, no further notification comes until more data
+    // arrives.
     status_t err = OK;
+    for (;;) {
+        char tmp[kMaxTCPReadSize];
+        ssize_t n;
+        do {
+            n = recv(mSocket, tmp, sizeof(tmp), 0);
+        } while (n < 0 && errno == EINTR);
 
-    if (n > 0) {
-        mInBuffer.append(tmp, n);
+        if (n > 0) {
+            mInBuffer.append(tmp, n);
 
 #if 0
-        ALOGI("in:");
-        hexdump(tmp, n);
+            ALOGI("in:");
+            hexdump(tmp, n);
 #endif
-    } else if (n < 0) {
-        err = -errno;
-    } else {
-        err = -ECONNRESET;
+            continue;
+        }
+
+        if (n < 0) {
+            err = -errno;
+        } else {
+            err = -ECONNRESET;
+        }
+        break;
     }
 
+    if (err == -EAGAIN) {
+        err = OK;
+    }
+
+    // Number of bytes at the front of mInBuffer that have been consumed,
+    // they are erased in one go once all complete messages are out.
+    size_t offset = 0;
+
     if (mMode == MODE_DATAGRAM) {
         // TCP stream carrying 16-bit length-prefixed datagrams.
 
-        while (mInBuffer.size() >= 2) {
-            size_t packetSize = U16_AT((const uint8_t *)mInBuffer.c_str());
+        while (mInBuffer.size() - offset >= 2) {
+            const uint8_t *data = (const uint8_t *)mInBuffer.c_str() + offset;
+            size_t packetSize = U16_AT(data);
 
-            if (mInBuffer.size() < packetSize + 2) {
+            if (mInBuffer.size() - offset < packetSize + 2) {
                 break;
             }
 
             sp<ABuffer> packet = new ABuffer(packetSize);
-            memcpy(packet->data(), mInBuffer.c_str() + 2, packetSize);
+            memcpy(packet->data(), data + 2, packetSize);
 
             int64_t nowUs = ALooper::GetNowUs();
             packet->meta()->setInt64("arrivalTimeUs", nowUs);
@@ -379,44 +438,45 @@ status_t ANetworkSession::Session::readMore() {
             notify->setBuffer("data", packet);
             notify->post();
 
-            mInBuffer.erase(0, packetSize + 2);
+            offset += packetSize + 2;
         }
     } else if (mMode == MODE_RTSP) {
         for (;;) {
+            const char *data = mInBuffer.c_str() + offset;
+            size_t size = mInBuffer.size() - offset;
             size_t length;
 
-            if (mInBuffer.size() > 0 && mInBuffer.c_str()[0] == '$') {
-                if (mInBuffer.size() < 4) {
+            if (size > 0 && data[0] == '$') {
+                if (size < 4) {
                     break;
                 }
 
-                length = U16_AT((const uint8_t *)mInBuffer.c_str() + 2);
+                length = U16_AT((const uint8_t *)data + 2);
 
-                if (mInBuffer.size() < 4 + length) {
+                if (size < 4 + length) {
                     break;
                 }
 
                 sp<AMessage> notify = mNotify->dup();
                 notify->setInt32("sessionID", mSessionID);
                 notify->setInt32("reason", kWhatBinaryData);
-                notify->setInt32("channel", mInBuffer.c_str()[1]);
+                notify->setInt32("channel", data[1]);
 
-                sp<ABuffer> data = new ABuffer(length);
-                memcpy(data->data(), mInBuffer.c_str() + 4, length);
+                sp<ABuffer> buffer = new ABuffer(length);
+                memcpy(buffer->data(), data + 4, length);
 
                 int64_t nowUs = ALooper::GetNowUs();
-                data->meta()->setInt64("arrivalTimeUs", nowUs);
+                buffer->meta()->setInt64("arrivalTimeUs", nowUs);
 
-                notify->setBuffer("data", data);
+                notify->setBuffer("data", buffer);
                 notify->post();
 
-                mInBuffer.erase(0, 4 + length);
+                offset += 4 + length;
                 continue;
             }
 
             sp<ParsedMessage> msg =
-                ParsedMessage::Parse(
-                        mInBuffer.c_str(), mInBuffer.size(), err != OK, &length);
+                ParsedMessage::Parse(data, size, err != OK, &length);
 
             if (msg == NULL) {
                 break;
@@ -436,13 +496,13 @@ status_t ANetworkSession::Session::readMore() {
             if (content
                     && !memcmp(content, "wfd_idr_request\r\n", 17)
                     && length >= 19
-                    && mInBuffer.c_str()[length] == '\r'
-                    && mInBuffer.c_str()[length + 1] == '\n') {
+                    && data[length] == '\r'
+                    && data[length + 1] == '\n') {
                 length += 2;
             }
 #endif
 
-            mInBuffer.erase(0, length);
+            offset += length;
 
             if (err != OK) {
                 break;
@@ -451,53 +511,58 @@ status_t ANetworkSession::Session::readMore() {
     } else {
         CHECK_EQ(mMode, MODE_WEBSOCKET);
 
-        const uint8_t *data = (const uint8_t *)mInBuffer.c_str();
-        // hexdump(data, mInBuffer.size());
+        for (;;) {
+            const uint8_t *data = (const uint8_t *)mInBuffer.c_str() + offset;
+            size_t size = mInBuffer.size() - offset;
+            // hexdump(data, size);
+
+            if (size < 2) {
+                break;
+            }
 
-        while (mInBuffer.size() >= 2) {
-            size_t offset = 2;
+            size_t headerSize = 2;
 
             uint64_t payloadLen = data[1] & 0x7f;
             if (payloadLen == 126) {
-                if (offset + 2 > mInBuffer.size()) {
+                if (headerSize + 2 > size) {
                     break;
                 }
 
-                payloadLen = U16_AT(&data[offset]);
-                offset += 2;
+                payloadLen = U16_AT(&data[headerSize]);
+                headerSize += 2;
             } else if (payloadLen == 127) {
-                if (offset + 8 > mInBuffer.size()) {
+                if (headerSize + 8 > size) {
                     break;
                 }
 
-                payloadLen = U64_AT(&data[offset]);
-                offset += 8;
+                payloadLen = U64_AT(&data[headerSize]);
+                headerSize += 8;
             }
 
             uint32_t mask = 0;
             if (data[1] & 0x80) {
                 // MASK==1
-                if (offset + 4 > mInBuffer.size()) {
+                if (headerSize + 4 > size) {
                     break;
                 }
 
-                mask = U32_AT(&data[offset]);
-                offset += 4;
+                mask = U32_AT(&data[headerSize]);
+                headerSize += 4;
             }
 
-            if (payloadLen > mInBuffer.size() || offset > mInBuffer.size() - payloadLen) {
+            if (payloadLen > size || headerSize > size - payloadLen) {
                 break;
             }
 
             // We have the full message.
 
             sp<ABuffer> packet = new ABuffer(payloadLen);
-            memcpy(packet->data(), &data[offset], payloadLen);
+            memcpy(packet->data(), &data[headerSize], payloadLen);
 
             if (mask != 0) {
                 for (size_t i = 0; i < payloadLen; ++i) {
                     packet->data()[i] =
-                        data[offset + i]
+                        data[headerSize + i]
                             ^ ((mask >> (8 * (3 - (i % 4)))) & 0xff);
                 }
             }
@@ -509,10 +574,14 @@ status_t ANetworkSession::Session::readMore() {
             notify->setInt32("headerByte", data[0]);
             notify->post();
 
-            mInBuffer.erase(0, offset + payloadLen);
+            offset += headerSize + payloadLen;
         }
     }
 
+    if (offset > 0) {
+        mInBuffer.erase(0, offset);
+    }
+
     if (err != OK) {
         notifyError(false /* send */, err, "Recv failed.");
         mSawReceiveFailure = true;
@@ -552,35 +621,51 @@ status_t ANetworkSession::Session::writeMore() {
     if (mState == DATAGRAM) {
         CHECK(!mOutFragments.empty());
 
-        status_t err;
-        do {
-            const Fragment &frag = *mOutFragments.begin();
-            const sp<ABuffer> &datagram = frag.mBuffer;
+        status_t err = OK;
+        while (err == OK && !mOutFragments.empty()) {
+            struct iovec iov[2 * kMaxFragmentsPerWrite];
+            struct mmsghdr msgs[kMaxFragmentsPerWrite];
+            memset(msgs, 0, sizeof(msgs));
+
+            size_t count = 0;
+            size_t numIOVecs = 0;
+            for (List<Fragment>::iterator it = mOutFragments.begin();
+                    it != mOutFragments.end() && count < kMaxFragmentsPerWrite;
+                    ++it, ++count) {
+                msgs[count].msg_hdr.msg_iov = &iov[numIOVecs];
+                msgs[count].msg_hdr.msg_iovlen =
+                    FillIOVec(*it, &iov[numIOVecs]);
+
+                numIOVecs += msgs[count].msg_hdr.msg_iovlen;
+            }
 
             int n;
             do {
-                n = send(mSocket, datagram->data(), datagram->size(), 0);
+                n = sendmmsg(mSocket, msgs, count, 0);
             } while (n < 0 && errno == EINTR);
 
-            err = OK;
+            if (n < 0) {
+                err = -errno;
+            } else if (n == 0) {
+                err = -ECONNRESET;
+            }
+
+            for (int i = 0; i < n; ++i) {
+                const Fragment &frag = *mOutFragments.begin();
 
-            if (n > 0) {
                 if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
                     dumpFragmentStats(frag);
                 }
 
                 mOutFragments.erase(mOutFragments.begin());
-            } else if (n < 0) {
-                err = -errno;
-            } else if (n == 0) {
-                err = -ECONNRESET;
             }
-        } while (err == OK && !mOutFragments.empty());
+        }
 
         if (err == -EAGAIN) {
             if (!mOutFragments.empty()) {
                 ALOGI("%zu datagrams remain queued.", mOutFragments.size());
             }
+            mWritable = false;
             err = OK;
         }
 
@@ -623,38 +708,66 @@ status_t ANetworkSession::Session::writeMore() {
     CHECK_EQ(mState, CONNECTED);
     CHECK(!mOutFragments.empty());
 
-    ssize_t n = -1;
+    status_t err = OK;
     while (!mOutFragments.empty()) {
-        const Fragment &frag = *mOutFragments.begin();
+        struct iovec iov[2 * kMaxFragmentsPerWrite];
+
+        size_t count = 0;
+        size_t numIOVecs = 0;
+        for (List<Fragment>::iterator it = mOutFragments.begin();
+                it != mOutFragments.end() && count < kMaxFragmentsPerWrite;
+                ++it, ++count) {
+            numIOVecs += FillIOVec(*it, &iov[numIOVecs]);
+        }
 
+        ssize_t n;
         do {
-            n = send(mSocket, frag.mBuffer->data(), frag.mBuffer->size(), 0);
+            n = writev(mSocket, iov, numIOVecs);
         } while (n < 0 && errno == EINTR);
 
-        if (n <= 0) {
+        if (n < 0) {
+            err = -errno;
+            break;
+        } else if (n == 0) {
+            err = -ECONNRESET;
             break;
         }
 
-        frag.mBuffer->setRange(
-                frag.mBuffer->offset() + n, frag.mBuffer->size() - n);
+        // Retire the fragments that were sent completely and advance into
+        // the one that was sent in part, if any.
+        size_t numBytesSent = n;
+        while (numBytesSent > 0) {
+            Fragment &frag = *mOutFragments.begin();
+            size_t size = frag.mBuffer->size() + frag.mPayloadSize;
+
+            if (numBytesSent < size) {
+                size_t headerBytes = frag.mBuffer->size();
+                if (headerBytes > numBytesSent) {
+                    headerBytes = numBytesSent;
+                }
 
-        if (frag.mBuffer->size() > 0) {
-            break;
-        }
+                frag.mBuffer->setRange(
+                        frag.mBuffer->offset() + headerBytes,
+                        frag.mBuffer->size() - headerBytes);
 
-        if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
-            dumpFragmentStats(frag);
-        }
+                frag.mPayloadOffset += numBytesSent - headerBytes;
+                frag.mPayloadSize -= numBytesSent - headerBytes;
+                break;
+            }
 
-        mOutFragments.erase(mOutFragments.begin());
-    }
+            numBytesSent -= size;
 
-    status_t err = OK;
+            if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
+                dumpFragmentStats(frag);
+            }
 
-    if (n < 0) {
-        err = -errno;
-    } else if (n == 0) {
-        err = -ECONNRESET;
+            mOutFragments.erase(mOutFragments.begin());
+        }
+    }
+
+    if (err == -EAGAIN) {
+        mWritable = false;
+        err = OK;
     }
 
     if (err != OK) {
@@ -762,6 +875,58 @@ status_t ANetworkSession::Session::sendRequest(
         memcpy(buffer->data(), data, size);
     }
 
+    queueFragment(buffer, timeValid, timeUs);
+
+    return OK;
+}
+
+status_t ANetworkSession::Session::sendDatagram(
+        const void *data, size_t size,
+        const sp<ABuffer> &payload, size_t payloadOffset, size_t payloadSize,
+        bool timeValid, int64_t timeUs) {
+    if (mState != DATAGRAM
+            && (mState != CONNECTED || mMode != MODE_DATAGRAM)) {
+        return INVALID_OPERATION;
+    }
+
+    if (payloadOffset > payload->size()
+            || payloadSize > payload->size() - payloadOffset) {
+        return -EINVAL;
+    }
+
+    if (size + payloadSize == 0) {
+        return OK;
+    }
+
+    sp<ABuffer> buffer;
+
+    if (mState == CONNECTED) {
+        // TCP stream carrying 16-bit length-prefixed datagrams.
+        size_t datagramSize = size + payloadSize;
+        CHECK_LE(datagramSize, 65535u);
+
+        buffer = new ABuffer(size + 2);
+        buffer->data()[0] = datagramSize >> 8;
+        buffer->data()[1] = datagramSize & 0xff;
+        if (size > 0) {
+            memcpy(buffer->data() + 2, data, size);
+        }
+    } else {
+        buffer = new ABuffer(size);
+        if (size > 0) {
+            memcpy(buffer->data(), data, size);
+        }
+    }
+
+    queueFragment(
+            buffer, timeValid, timeUs, payload, payloadOffset, payloadSize);
+
+    return OK;
+}
+
+void ANetworkSession::Session::queueFragment(
+        const sp<ABuffer> &buffer, bool timeValid, int64_t timeUs,
+        const sp<ABuffer> &payload, size_t payloadOffset, size_t payloadSize) {
     Fragment frag;
 
     frag.mFlags = 0;
@@ -772,9 +937,27 @@ status_t ANetworkSession::Session::sendRequest(
 
     frag.mBuffer = buffer;
 
+    frag.mPayload = payload;
+    frag.mPayloadOffset = payloadOffset;
+    frag.mPayloadSize = payloadSize;
+
     mOutFragments.push_back(frag);
+}
 
-    return OK;
+// static
+size_t ANetworkSession::Session::FillIOVec(
+        const Fragment &frag, struct iovec *iov) {
+    iov[0].iov_base = frag.mBuffer->data();
+    iov[0].iov_len = frag.mBuffer->size();
+
+    if (frag.mPayload == NULL) {
+        return 1;
+    }
+
+    iov[1].iov_base = frag.mPayload->data() + frag.mPayloadOffset;
+    iov[1].iov_len = frag.mPayloadSize;
+
+    return 2;
 }
 
 void ANetworkSession::Session::notifyError(
@@ -800,10 +983,16 @@ void ANetworkSession::Session::notify(NotificationReason reason) {
 ANetworkSession::ANetworkSession()
     : mNextSessionID(1) {
     mPipeFd[0] = mPipeFd[1] = -1;
+
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    CHECK_GE(mEpollFd, 0);
 }
 
 ANetworkSession::~ANetworkSession() {
     stop();
+
+    close(mEpollFd);
+    mEpollFd = -1;
 }
 
 status_t ANetworkSession::start() {
@@ -811,12 +1000,28 @@ status_t ANetworkSession::start() {
         return INVALID_OPERATION;
     }
 
-    int res = pipe(mPipeFd);
+    int res = pipe2(mPipeFd, O_CLOEXEC | O_NONBLOCK);
     if (res != 0) {
         mPipeFd[0] = mPipeFd[1] = -1;
         return -errno;
     }
 
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = kInterruptEventID;
+
+    res = epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mPipeFd[0], &ev);
+    if (res != 0) {
+        status_t err = -errno;
+
+        close(mPipeFd[0]);
+        close(mPipeFd[1]);
+        mPipeFd[0] = mPipeFd[1] = -1;
+
+        return err;
+    }
+
     mThread = new NetworkThread(this);
 
     status_t err = mThread->run("ANetworkSession", ANDROID_PRIORITY_AUDIO);
@@ -824,6 +1029,7 @@ status_t ANetworkSession::start() {
     if (err != OK) {
         mThread.clear();
 
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, mPipeFd[0], NULL);
         close(mPipeFd[0]);
         close(mPipeFd[1]);
         mPipeFd[0] = mPipeFd[1] = -1;
@@ -845,6 +1051,7 @@ status_t ANetworkSession::stop() {
 
     mThread.clear();
 
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, mPipeFd[0], NULL);
     close(mPipeFd[0]);
     close(mPipeFd[1]);
     mPipeFd[0] = mPipeFd[1] = -1;
@@ -937,6 +1144,7 @@ status_t ANetworkSession::destroySession(int32_t sessionID) {
         return -ENOENT;
     }
 
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, mSessions.valueAt(index)->socket(), NULL);
     mSessions.removeItemsAt(index);
 
     interrupt();
@@ -944,6 +1152,24 @@ status_t ANetworkSession::destroySession(int32_t sessionID) {
     return OK;
 }
 
+status_t ANetworkSession::addSession(const sp<Session> &session) {
+    // Read and write readiness are both watched for the lifetime of the
+    // socket, the session keeps track of what it is waiting for.
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.u32 = session->sessionID();
+
+    int res = epoll_ctl(mEpollFd, EPOLL_CTL_ADD, session->socket(), &ev);
+    if (res != 0) {
+        return -errno;
+    }
+
+    mSessions.add(session->sessionID(), session);
+
+    return OK;
+}
+
 // static
 status_t ANetworkSession::MakeSocketNonBlocking(int s) {
     int flags = fcntl(s, F_GETFL, 0);
@@ -1148,7 +1374,12 @@ status_t ANetworkSession::createClientOrServer(
         session->setMode(Session::MODE_RTSP);
     }
 
-    mSessions.add(session->sessionID(), session);
+    // The session owns the socket from here on.
+    err = addSession(session);
+
+    if (err != OK) {
+        goto bail;
+    }
 
     interrupt();
 
@@ -1215,9 +1446,45 @@ status_t ANetworkSession::sendRequest(
 
     const sp<Session> session = mSessions.valueAt(index);
 
+    // Only a session that had nothing queued needs the network thread's
+    // attention, otherwise it is either scheduled already or waiting for
+    // the socket to become writable again.
+    bool wasIdle = !session->wantsToWrite();
+
     status_t err = session->sendRequest(data, size, timeValid, timeUs);
 
-    interrupt();
+    if (err == OK && wasIdle) {
+        mPendingWrites.push_back(sessionID);
+        interrupt();
+    }
+
+    return err;
+}
+
+status_t ANetworkSession::sendDatagram(
+        int32_t sessionID, const void *data, size_t size,
+        const sp<ABuffer> &payload, size_t payloadOffset, size_t payloadSize,
+        bool timeValid, int64_t timeUs) {
+    Mutex::Autolock autoLock(mLock);
+
+    ssize_t index = mSessions.indexOfKey(sessionID);
+
+    if (index < 0) {
+        return -ENOENT;
+    }
+
+    const sp<Session> session = mSessions.valueAt(index);
+
+    bool wasIdle = !session->wantsToWrite();
+
+    status_t err = session->sendDatagram(
+            data, size, payload, payloadOffset, payloadSize,
+            timeValid, timeUs);
+
+    if (err == OK && wasIdle) {
+        mPendingWrites.push_back(sessionID);
+        interrupt();
+    }
 
     return err;
 }
@@ -1243,168 +1510,204 @@ void ANetworkSession::interrupt() {
         n = write(mPipeFd[1], &dummy, 1);
     } while (n < 0 && errno == EINTR);
 
-    if (n < 0) {
+    // A full pipe already guarantees a wakeup.
+    if (n < 0 && errno != EAGAIN) {
         ALOGW("Error writing to pipe (%s)", strerror(errno));
     }
 }
 
-void ANetworkSession::threadLoop() {
-    fd_set rs, ws;
-    FD_ZERO(&rs);
-    FD_ZERO(&ws);
+void ANetworkSession::drainInterruptPipe() {
+    char buffer[64];
 
-    FD_SET(mPipeFd[0], &rs);
-    int maxFd = mPipeFd[0];
+    ssize_t n;
+    do {
+        n = read(mPipeFd[0], buffer, sizeof(buffer));
+    } while (n > 0 || (n < 0 && errno == EINTR));
 
-    {
-        Mutex::Autolock autoLock(mLock);
+    if (n < 0 && errno != EAGAIN) {
+        ALOGW("Error reading from pipe (%s)", strerror(errno));
+    }
+}
 
-        for (size_t i = 0; i < mSessions.size(); ++i) {
-            const sp<Session> &session = mSessions.valueAt(i);
+void ANetworkSession::acceptConnections(const sp<Session> &session) {
+    int s = session->socket();
 
-            int s = session->socket();
+    // Accept until the backlog is empty, the listening socket is not
+    // reported again until a new connection comes in.
+    for (;;) {
+        struct sockaddr_in remoteAddr;
+        socklen_t remoteAddrLen = sizeof(remoteAddr);
+
+        int clientSocket = accept(
+                s, (struct sockaddr *)&remoteAddr, &remoteAddrLen);
 
-            if (s < 0) {
+        if (clientSocket < 0) {
+            if (errno == EINTR) {
                 continue;
             }
 
-            if (session->wantsToRead()) {
-                FD_SET(s, &rs);
-                if (s > maxFd) {
-                    maxFd = s;
-                }
+            if (errno != EAGAIN) {
+                ALOGE("accept returned error %d (%s)",
+                      errno, strerror(errno));
             }
+            break;
+        }
 
-            if (session->wantsToWrite()) {
-                FD_SET(s, &ws);
-                if (s > maxFd) {
-                    maxFd = s;
-                }
-            }
+        status_t err = MakeSocketNonBlocking(clientSocket);
+
+        if (err != OK) {
+            ALOGE("Unable to make client socket non blocking, "
+                  "failed w/ error %d (%s)",
+                  err, strerror(-err));
+
+            close(clientSocket);
+            clientSocket = -1;
+            continue;
         }
+
+        in_addr_t addr = ntohl(remoteAddr.sin_addr.s_addr);
+
+        ALOGI("incoming connection from %d.%d.%d.%d:%d "
+              "(socket %d)",
+              (addr >> 24),
+              (addr >> 16) & 0xff,
+              (addr >> 8) & 0xff,
+              addr & 0xff,
+              ntohs(remoteAddr.sin_port),
+              clientSocket);
+
+        sp<Session> clientSession =
+            new Session(
+                    mNextSessionID++,
+                    Session::CONNECTED,
+                    clientSocket,
+                    session->getNotificationMessage());
+
+        clientSession->setMode(
+                session->isRTSPServer()
+                    ? Session::MODE_RTSP
+                    : Session::MODE_DATAGRAM);
+
+        err = addSession(clientSession);
+
+        if (err != OK) {
+            ALOGE("Unable to watch client socket %d, failed w/ error %d (%s)",
+                  clientSocket, err, strerror(-err));
+            continue;
+        }
+
+        ALOGI("added clientSession %d", clientSession->sessionID());
     }
+}
 
-    int res = select(maxFd + 1, &rs, &ws, NULL, NULL /* tv */);
+void ANetworkSession::processEvents(
+        const sp<Session> &session, uint32_t events) {
+    int s = session->socket();
 
-    if (res == 0) {
+    if (session->isRTSPServer() || session->isTCPDatagramServer()) {
+        acceptConnections(session);
         return;
     }
 
+    if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+        session->setWritable();
+    }
+
+    // Writing comes first, a connection that has just been established is
+    // only ready to be read from once writeMore has seen it complete.
+    if (session->wantsToWrite() && session->isWritable()) {
+        status_t err = session->writeMore();
+        if (err != OK) {
+            ALOGE("writeMore on socket %d failed w/ error %d (%s)",
+                  s, err, strerror(-err));
+        }
+
+        if (session->wantsToWrite() && session->isWritable()) {
+            // A failed datagram send that is being retried.
+            mPendingWrites.push_back(session->sessionID());
+        }
+    }
+
+    if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && session->wantsToRead()) {
+        status_t err = session->readMore();
+        if (err != OK) {
+            ALOGE("readMore on socket %d failed w/ error %d (%s)",
+                  s, err, strerror(-err));
+        }
+    }
+}
+
+void ANetworkSession::threadLoop() {
+    int timeoutMs = -1;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        // Don't block if a write was cut short by an error that is being
+        // retried.
+        if (!mPendingWrites.empty()) {
+            timeoutMs = 0;
+        }
+    }
+
+    struct epoll_event events[kMaxPollEvents];
+    int res = epoll_wait(mEpollFd, events, kMaxPollEvents, timeoutMs);
+
     if (res < 0) {
         if (errno == EINTR) {
             return;
         }
 
-        ALOGE("select failed w/ error %d (%s)", errno, strerror(errno));
+        ALOGE("epoll_wait failed w/ error %d (%s)", errno, strerror(errno));
         return;
     }
 
-    if (FD_ISSET(mPipeFd[0], &rs)) {
-        char c;
-        ssize_t n;
-        do {
-            n = read(mPipeFd[0], &c, 1);
-        } while (n < 0 && errno == EINTR);
+    Mutex::Autolock autoLock(mLock);
 
-        if (n < 0) {
-            ALOGW("Error reading from pipe (%s)", strerror(errno));
+    for (int i = 0; i < res; ++i) {
+        if (events[i].data.u32 == kInterruptEventID) {
+            drainInterruptPipe();
+            continue;
         }
 
-        --res;
-    }
+        ssize_t index = mSessions.indexOfKey(events[i].data.u32);
 
-    {
-        Mutex::Autolock autoLock(mLock);
+        if (index < 0) {
+            // The session was destroyed after the event was reported.
+            continue;
+        }
 
-        List<sp<Session> > sessionsToAdd;
+        sp<Session> session = mSessions.valueAt(index);
+        processEvents(session, events[i].events);
+    }
 
-        for (size_t i = mSessions.size(); res > 0 && i > 0;) {
-            i--;
-            const sp<Session> &session = mSessions.valueAt(i);
+    Vector<int32_t> pendingWrites = mPendingWrites;
+    mPendingWrites.clear();
 
-            int s = session->socket();
+    for (size_t i = 0; i < pendingWrites.size(); ++i) {
+        int32_t sessionID = pendingWrites.itemAt(i);
+        ssize_t index = mSessions.indexOfKey(sessionID);
 
-            if (s < 0) {
-                continue;
-            }
-
-            if (FD_ISSET(s, &rs) || FD_ISSET(s, &ws)) {
-                --res;
-            }
+        if (index < 0) {
+            continue;
+        }
 
-            if (FD_ISSET(s, &rs)) {
-                if (session->isRTSPServer() || session->isTCPDatagramServer()) {
-                    struct sockaddr_in remoteAddr;
-                    socklen_t remoteAddrLen = sizeof(remoteAddr);
-
-                    int clientSocket = accept(
-                            s, (struct sockaddr *)&remoteAddr, &remoteAddrLen);
-
-                    if (clientSocket >= 0) {
-                        status_t err = MakeSocketNonBlocking(clientSocket);
-
-                        if (err != OK) {
-                            ALOGE("Unable to make client socket non blocking, "
-                                  "failed w/ error %d (%s)",
-                                  err, strerror(-err));
-
-                            close(clientSocket);
-                            clientSocket = -1;
-                        } else {
-                            in_addr_t addr = ntohl(remoteAddr.sin_addr.s_addr);
-
-                            ALOGI("incoming connection from %d.%d.%d.%d:%d "
-                                  "(socket %d)",
-                                  (addr >> 24),
-                                  (addr >> 16) & 0xff,
-                                  (addr >> 8) & 0xff,
-                                  addr & 0xff,
-                                  ntohs(remoteAddr.sin_port),
-                                  clientSocket);
-
-                            sp<Session> clientSession =
-                                new Session(
-                                        mNextSessionID++,
-                                        Session::CONNECTED,
-                                        clientSocket,
-                                        session->getNotificationMessage());
-
-                            clientSession->setMode(
-                                    session->isRTSPServer()
-                                        ? Session::MODE_RTSP
-                                        : Session::MODE_DATAGRAM);
-
-                            sessionsToAdd.push_back(clientSession);
-                        }
-                    } else {
-                        ALOGE("accept returned error %d (%s)",
-                              errno, strerror(errno));
-                    }
-                } else {
-                    status_t err = session->readMore();
-                    if (err != OK) {
-                        ALOGE("readMore on socket %d failed w/ error %d (%s)",
-                              s, err, strerror(-err));
-                    }
-                }
-            }
+        sp<Session> session = mSessions.valueAt(index);
 
-            if (FD_ISSET(s, &ws)) {
-                status_t err = session->writeMore();
-                if (err != OK) {
-                    ALOGE("writeMore on socket %d failed w/ error %d (%s)",
-                          s, err, strerror(-err));
-                }
-            }
+        if (!session->wantsToWrite() || !session->isWritable()) {
+            // Either already sent while handling an event above, or the
+            // next EPOLLOUT edge will pick it up.
+            continue;
         }
 
-        while (!sessionsToAdd.empty()) {
-            sp<Session> session = *sessionsToAdd.begin();
-            sessionsToAdd.erase(sessionsToAdd.begin());
-
-            mSessions.add(session->sessionID(), session);
+        status_t err = session->writeMore();
+        if (err != OK) {
+            ALOGE("writeMore on socket %d failed w/ error %d (%s)",
+                  session->socket(), err, strerror(-err));
+        }
 
-            ALOGI("added clientSession %d", session->sessionID());
+        if (session->wantsToWrite() && session->isWritable()) {
+            mPendingWrites.push_back(sessionID);
         }
     }
 }
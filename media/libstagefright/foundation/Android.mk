@@ -20,6 +20,7 @@ LOCAL_SRC_FILES:=                 \
     MediaBufferGroup.cpp          \
     MetaData.cpp                  \
     ParsedMessage.cpp             \
+    StartCodeUtils.cpp            \
     base64.cpp                    \
     hexdump.cpp
 
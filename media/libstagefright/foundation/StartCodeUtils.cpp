@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StartCodeUtils.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace android {
+
+// Finds the first occurrence of 0x00 0x00 |last|.
+static size_t findPrefixedByteScalar(
+        const uint8_t *data, size_t size, size_t offset, uint8_t last) {
+    for (; offset + 2 < size; ++offset) {
+        if (data[offset + 2] == last
+                && data[offset] == 0x00 && data[offset + 1] == 0x00) {
+            return offset;
+        }
+    }
+
+    return size;
+}
+
+static size_t findPrefixedByte(
+        const uint8_t *data, size_t size, uint8_t last) {
+    size_t offset = 0;
+
+    // Each iteration tests the 16 candidate positions [offset, offset + 16)
+    // and therefore reads up to data[offset + 17].
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lastByte = _mm_set1_epi8((char)last);
+
+    while (offset + 18 <= size) {
+        const uint8_t *ptr = &data[offset];
+        __m128i b0 = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(ptr + 1));
+        __m128i b2 = _mm_loadu_si128((const __m128i *)(ptr + 2));
+
+        __m128i match = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                _mm_cmpeq_epi8(b2, lastByte));
+
+        int mask = _mm_movemask_epi8(match);
+        if (mask != 0) {
+            return offset + __builtin_ctz(mask);
+        }
+
+        offset += 16;
+    }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t lastByte = vdupq_n_u8(last);
+
+    while (offset + 18 <= size) {
+        const uint8_t *ptr = &data[offset];
+        uint8x16_t b0 = vld1q_u8(ptr);
+        uint8x16_t b1 = vld1q_u8(ptr + 1);
+        uint8x16_t b2 = vld1q_u8(ptr + 2);
+
+        uint8x16_t match = vandq_u8(
+                vandq_u8(vceqq_u8(b0, zero), vceqq_u8(b1, zero)),
+                vceqq_u8(b2, lastByte));
+
+        uint64x2_t match64 = vreinterpretq_u64_u8(match);
+        if ((vgetq_lane_u64(match64, 0) | vgetq_lane_u64(match64, 1)) != 0) {
+            // Let the scalar loop below pinpoint the match within this block.
+            break;
+        }
+
+        offset += 16;
+    }
+#endif
+
+    return findPrefixedByteScalar(data, size, offset, last);
+}
+
+size_t findStartCode(const uint8_t *data, size_t size) {
+    return findPrefixedByte(data, size, 0x01);
+}
+
+size_t findEmulationPrevention(const uint8_t *data, size_t size) {
+    return findPrefixedByte(data, size, 0x03);
+}
+
+size_t findStartCodeScalar(const uint8_t *data, size_t size) {
+    return findPrefixedByteScalar(data, size, 0, 0x01);
+}
+
+size_t findEmulationPreventionScalar(const uint8_t *data, size_t size) {
+    return findPrefixedByteScalar(data, size, 0, 0x03);
+}
+
+}  // namespace android
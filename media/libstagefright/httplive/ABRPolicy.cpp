@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABRPolicy"
+#include <utils/Log.h>
+
+#include "ABRPolicy.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AUtils.h>
+
+#include <math.h>
+#include <string.h>
+
+namespace android {
+
+// Only count on this share of the measured bandwidth, to avoid
+// overestimating it and having to switch down again right away.
+static int32_t SustainableBandwidth(int32_t bandwidthBps) {
+    return (int32_t)((int64_t)bandwidthBps * 7 / 10);
+}
+
+struct ThroughputABRPolicy : public ABRPolicy {
+    ThroughputABRPolicy() {}
+
+    virtual size_t selectVariant(
+            const Vector<Variant> &variants, const Status &status);
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(ThroughputABRPolicy);
+};
+
+size_t ThroughputABRPolicy::selectVariant(
+        const Vector<Variant> &variants, const Status &status) {
+    int32_t bandwidthBps = status.mBandwidthBps;
+    int32_t curBandwidth = variants.itemAt(status.mCurIndex).mBandwidthBps;
+
+    // canSwitchDown and canSwitchUp can't both be true.
+    // we only want to switch up when measured bw is 120% higher than current variant,
+    // and we only want to switch down when measured bw is below current variant.
+    bool canSwitchDown = status.mBufferLow
+            && (bandwidthBps < curBandwidth);
+    bool canSwitchUp = status.mBufferHigh
+            && (bandwidthBps > (int64_t)curBandwidth * 12 / 10);
+
+    if (!canSwitchDown && !canSwitchUp) {
+        return status.mCurIndex;
+    }
+
+    // bandwidth estimating has some delay, if we have to downswitch when
+    // it hasn't stabilized, use the short term to guess real bandwidth,
+    // since it may be dropping too fast.
+    // (note this doesn't apply to upswitch, always use longer average there)
+    if (!status.mIsStable && canSwitchDown
+            && status.mShortTermBps < bandwidthBps) {
+        bandwidthBps = status.mShortTermBps;
+    }
+
+    size_t index = GetVariantForBandwidth(
+            variants, SustainableBandwidth(bandwidthBps));
+
+    // it's possible that we're checking for canSwitchUp case, but the returned
+    // index is below the current one, as only 70% of the measured bw is used.
+    // In that case we don't want to do anything, since we have both enough
+    // buffer and enough bw.
+    if ((canSwitchUp && index > status.mCurIndex)
+            || (canSwitchDown && index < status.mCurIndex)) {
+        return index;
+    }
+
+    return status.mCurIndex;
+}
+
+// BOLA (Spiteri et al., "BOLA: Near-Optimal Bitrate Adaptation for Online
+// Videos"). Variant m has the utility u_m = 1 + ln(bw_m / bw_0), and for a
+// buffer level Q the policy picks the variant maximizing
+//
+//     (V * (u_m + gp) - Q) / bw_m.
+//
+// V and gp are set so that the lowest variant is picked while Q is below a
+// minimum buffer level, and the highest one once the fetchers have buffered
+// all they are going to.
+struct BufferABRPolicy : public ABRPolicy {
+    BufferABRPolicy() {}
+
+    virtual size_t selectVariant(
+            const Vector<Variant> &variants, const Status &status);
+
+private:
+    size_t getVariantForBuffer(
+            const Vector<Variant> &variants, const Status &status,
+            int64_t bufferedDurationUs) const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(BufferABRPolicy);
+};
+
+size_t BufferABRPolicy::selectVariant(
+        const Vector<Variant> &variants, const Status &status) {
+    size_t index = getVariantForBuffer(
+            variants, status, status.mBufferedDurationUs);
+
+    // The buffer level moves by up to a segment as segments are fetched and
+    // played out. Only switch once it is past the point where the other
+    // variant is better by as much as the switch marks are apart, so that
+    // it doesn't switch back and forth with every segment.
+    int64_t hysteresisUs = status.mDownSwitchMarkUs - status.mUpSwitchMarkUs;
+    if (index > status.mCurIndex) {
+        index = max(status.mCurIndex, getVariantForBuffer(
+                variants, status, status.mBufferedDurationUs - hysteresisUs));
+    } else if (index < status.mCurIndex) {
+        index = min(status.mCurIndex, getVariantForBuffer(
+                variants, status, status.mBufferedDurationUs + hysteresisUs));
+    }
+
+    return index;
+}
+
+size_t BufferABRPolicy::getVariantForBuffer(
+        const Vector<Variant> &variants, const Status &status,
+        int64_t bufferedDurationUs) const {
+    size_t lowest = GetLowestValidVariant(variants);
+
+    // Stay on the lowest variant until the up switch buffer is half full.
+    double minBufferS = status.mUpSwitchMarkUs / 2E6;
+    double maxBufferS = status.mMaxBufferedDurationUs / 1E6;
+    double lowestBandwidthBps = variants.itemAt(lowest).mBandwidthBps;
+    double maxUtility = 1.0 + log(
+            variants.itemAt(variants.size() - 1).mBandwidthBps
+                / lowestBandwidthBps);
+
+    if (lowestBandwidthBps <= 0
+            || maxBufferS <= minBufferS || maxUtility <= 1.0) {
+        return status.mCurIndex;
+    }
+
+    double gp = (maxUtility - 1.0) / (maxBufferS / minBufferS - 1.0);
+    double v = minBufferS / gp;
+    double bufferS = bufferedDurationUs / 1E6;
+
+    size_t index = lowest;
+    double bestScore = 0.0;
+    for (size_t i = lowest; i < variants.size(); ++i) {
+        const Variant &variant = variants.itemAt(i);
+        if (!variant.mIsValid) {
+            continue;
+        }
+
+        double utility =
+            1.0 + log(variant.mBandwidthBps / lowestBandwidthBps);
+        double score = (v * (utility + gp) - bufferS) / variant.mBandwidthBps;
+        if (i == lowest || score >= bestScore) {
+            index = i;
+            bestScore = score;
+        }
+    }
+
+    return index;
+}
+
+struct HybridABRPolicy : public BufferABRPolicy {
+    HybridABRPolicy() {}
+
+    virtual size_t selectVariant(
+            const Vector<Variant> &variants, const Status &status);
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(HybridABRPolicy);
+};
+
+size_t HybridABRPolicy::selectVariant(
+        const Vector<Variant> &variants, const Status &status) {
+    size_t index = BufferABRPolicy::selectVariant(variants, status);
+
+    int32_t bandwidthBps = status.mBandwidthBps;
+    if (!status.mIsStable && status.mShortTermBps < bandwidthBps) {
+        bandwidthBps = status.mShortTermBps;
+    }
+    size_t sustainable = GetVariantForBandwidth(
+            variants, SustainableBandwidth(bandwidthBps));
+
+    // A full buffer alone doesn't justify going up to a variant the
+    // network can't keep up with; the buffer would just drain again.
+    if (index > status.mCurIndex) {
+        index = max(status.mCurIndex, min(index, sustainable));
+    }
+
+    // Don't wait for the buffer to drain any further before going down to
+    // what the network sustains.
+    if (status.mBufferLow && sustainable < index) {
+        index = sustainable;
+    }
+
+    return index;
+}
+
+// static
+sp<ABRPolicy> ABRPolicy::Create(Type type) {
+    switch (type) {
+        case THROUGHPUT:
+            return new ThroughputABRPolicy;
+        case BUFFER:
+            return new BufferABRPolicy;
+        case HYBRID:
+            return new HybridABRPolicy;
+        default:
+            TRESPASS();
+    }
+    return NULL;
+}
+
+// static
+bool ABRPolicy::ParseType(const char *name, Type *type) {
+    for (int i = THROUGHPUT; i <= HYBRID; ++i) {
+        if (!strcasecmp(name, TypeToString((Type)i))) {
+            *type = (Type)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// static
+const char *ABRPolicy::TypeToString(Type type) {
+    switch (type) {
+        case THROUGHPUT:
+            return "throughput";
+        case BUFFER:
+            return "buffer";
+        case HYBRID:
+            return "hybrid";
+        default:
+            break;
+    }
+    return "unknown";
+}
+
+// static
+size_t ABRPolicy::GetVariantForBandwidth(
+        const Vector<Variant> &variants, int32_t bandwidthBps) {
+    size_t lowest = GetLowestValidVariant(variants);
+    size_t index = variants.size() - 1;
+    while (index > lowest) {
+        const Variant &variant = variants.itemAt(index);
+        if (variant.mBandwidthBps <= bandwidthBps && variant.mIsValid) {
+            break;
+        }
+        --index;
+    }
+    return index;
+}
+
+// static
+size_t ABRPolicy::GetLowestValidVariant(const Vector<Variant> &variants) {
+    for (size_t index = 0; index < variants.size(); ++index) {
+        if (variants.itemAt(index).mIsValid) {
+            return index;
+        }
+    }
+    // if variants are all blacklisted, return 0 and hope it's alive
+    return 0;
+}
+
+ABRController::ABRController(ABRPolicy::Type type)
+    : mPolicy(ABRPolicy::Create(type)),
+      mThroughputPolicy(ABRPolicy::Create(ABRPolicy::THROUGHPUT)),
+      mForcedIndex(-1),
+      mMaxBandwidthBps(0) {
+}
+
+void ABRController::setForcedIndex(ssize_t index) {
+    mForcedIndex = index;
+}
+
+void ABRController::setMaxBandwidth(int32_t bandwidthBps) {
+    mMaxBandwidthBps = bandwidthBps;
+}
+
+size_t ABRController::selectVariant(
+        const Vector<ABRPolicy::Variant> &variants,
+        const ABRPolicy::Status &status, bool preparing) {
+    if (mForcedIndex >= 0) {
+        // With only the forced variant left to pick, the throughput rules
+        // decide whether the buffer and bandwidth allow going there yet.
+        size_t forcedIndex = min((size_t)mForcedIndex, variants.size() - 1);
+        Vector<ABRPolicy::Variant> forced = variants;
+        for (size_t i = 0; i < forced.size(); ++i) {
+            forced.editItemAt(i).mIsValid = (i == forcedIndex);
+        }
+        return mThroughputPolicy->selectVariant(forced, status);
+    }
+
+    ABRPolicy::Status cappedStatus = status;
+    if (mMaxBandwidthBps > 0) {
+        if (cappedStatus.mBandwidthBps > mMaxBandwidthBps) {
+            ALOGV("bandwidth capped to %d bps", mMaxBandwidthBps);
+            cappedStatus.mBandwidthBps = mMaxBandwidthBps;
+        }
+        if (cappedStatus.mShortTermBps > mMaxBandwidthBps) {
+            cappedStatus.mShortTermBps = mMaxBandwidthBps;
+        }
+    }
+
+    // There is no buffer to go by yet while preparing, only allow the
+    // measured bandwidth to take us down.
+    const sp<ABRPolicy> &policy = preparing ? mThroughputPolicy : mPolicy;
+
+    return policy->selectVariant(variants, cappedStatus);
+}
+
+}  // namespace android
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ABR_POLICY_H_
+
+#define ABR_POLICY_H_
+
+#include <sys/types.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Decides which variant of a master playlist LiveSession fetches from.
+// While playing, LiveSession polls its policy with the variants sorted by
+// ascending bandwidth, the current bandwidth estimate and the buffer level,
+// and switches to whichever variant the policy returns.
+//
+// Policies only look at what they are passed, so that a sequence of
+// decisions can be replayed deterministically outside of a session.
+struct ABRPolicy : public RefBase {
+    enum Type {
+        // Picks the variant the measured bandwidth sustains, switching only
+        // once the buffer is high enough to go up or low enough to go down.
+        THROUGHPUT,
+        // BOLA: picks the variant from the buffer level alone.
+        BUFFER,
+        // BOLA, but doesn't go up past what the measured bandwidth sustains
+        // and goes down to it once the buffer runs low.
+        HYBRID,
+    };
+
+    struct Variant {
+        int32_t mBandwidthBps;
+        // False while the variant is blacklisted after a failure.
+        bool mIsValid;
+    };
+
+    struct Status {
+        size_t mCurIndex;
+
+        // Long and short term bandwidth estimates, and whether the long
+        // term one has been steady lately.
+        int32_t mBandwidthBps;
+        int32_t mShortTermBps;
+        bool mIsStable;
+
+        // Least amount of media buffered by any active stream.
+        int64_t mBufferedDurationUs;
+
+        // All active streams are buffered beyond mUpSwitchMarkUs, or some
+        // stream is buffered below mDownSwitchMarkUs. Both marks scale with
+        // the target duration of the playlist.
+        bool mBufferHigh;
+        bool mBufferLow;
+        int64_t mUpSwitchMarkUs;
+        int64_t mDownSwitchMarkUs;
+
+        // Buffer level the fetchers stop fetching at.
+        int64_t mMaxBufferedDurationUs;
+    };
+
+    static sp<ABRPolicy> Create(Type type);
+
+    // Parses "throughput", "buffer" or "hybrid".
+    static bool ParseType(const char *name, Type *type);
+    static const char *TypeToString(Type type);
+
+    // Returns the index of the variant to fetch from, status.mCurIndex to
+    // stay on the current one.
+    virtual size_t selectVariant(
+            const Vector<Variant> &variants, const Status &status) = 0;
+
+protected:
+    ABRPolicy() {}
+    virtual ~ABRPolicy() {}
+
+    // Returns the highest valid variant whose bandwidth is at most
+    // |bandwidthBps|, or the lowest valid variant if there is none.
+    static size_t GetVariantForBandwidth(
+            const Vector<Variant> &variants, int32_t bandwidthBps);
+
+    static size_t GetLowestValidVariant(const Vector<Variant> &variants);
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(ABRPolicy);
+};
+
+// Makes LiveSession's variant decisions: the configured policy while
+// playing, the throughput rules while preparing, and the debug overrides
+// of media.httplive.bw-index and media.httplive.max-bw on top of both.
+struct ABRController : public RefBase {
+    ABRController(ABRPolicy::Type type);
+
+    // Go to variant |index| rather than the one the bandwidth sustains,
+    // negative for none. As before the policies were split out, the switch
+    // is only made once the throughput rules allow one in its direction.
+    void setForcedIndex(ssize_t index);
+
+    // Caps the bandwidth estimates the policies see, 0 for no cap.
+    void setMaxBandwidth(int32_t bandwidthBps);
+
+    size_t selectVariant(
+            const Vector<ABRPolicy::Variant> &variants,
+            const ABRPolicy::Status &status, bool preparing);
+
+protected:
+    virtual ~ABRController() {}
+
+private:
+    sp<ABRPolicy> mPolicy;
+    sp<ABRPolicy> mThroughputPolicy;
+    ssize_t mForcedIndex;
+    int32_t mMaxBandwidthBps;
+
+    DISALLOW_EVIL_CONSTRUCTORS(ABRController);
+};
+
+}  // namespace android
+
+#endif  // ABR_POLICY_H_
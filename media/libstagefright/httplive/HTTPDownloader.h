@@ -50,7 +50,7 @@ struct HTTPDownloader : public RefBase {
     //
     // For reused HTTP sources, the caller must download a file sequentially without
     // any overlaps or gaps to prevent reconnection.
-    ssize_t fetchBlock(
+    virtual ssize_t fetchBlock(
             const char *url,
             sp<ABuffer> *out,
             int64_t range_offset, /* open file at range_offset */
@@ -66,9 +66,10 @@ struct HTTPDownloader : public RefBase {
             sp<ABuffer> *out,
             String8 *actualUrl = NULL);
 
-    // fetch a playlist file
+    // fetch a playlist file, |previous| is the version of it being refreshed
     sp<M3UParser> fetchPlaylist(
-            const char *url, uint8_t *curPlaylistHash, bool *unchanged);
+            const char *url, uint8_t *curPlaylistHash, bool *unchanged,
+            const sp<M3UParser> &previous = NULL);
 
 private:
     sp<HTTPBase> mHTTPDataSource;
@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "LiveSession.h"
+#include "BandwidthEstimator.h"
 #include "HTTPDownloader.h"
 #include "M3UParser.h"
 #include "PlaylistFetcher.h"
@@ -35,8 +36,6 @@
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
 
-#include <utils/Mutex.h>
-
 #include <ctype.h>
 #include <inttypes.h>
 
@@ -54,175 +53,6 @@ const int64_t LiveSession::kReadyMarkUs = 5000000ll;
 const int64_t LiveSession::kPrepareMarkUs = 1500000ll;
 const int64_t LiveSession::kUnderflowMarkUs = 1000000ll;
 
-struct LiveSession::BandwidthEstimator : public LiveSession::BandwidthBaseEstimator {
-    BandwidthEstimator();
-
-    void addBandwidthMeasurement(size_t numBytes, int64_t delayUs);
-    bool estimateBandwidth(
-            int32_t *bandwidth,
-            bool *isStable = NULL,
-            int32_t *shortTermBps = NULL);
-
-private:
-    // Bandwidth estimation parameters
-    static const int32_t kShortTermBandwidthItems = 3;
-    static const int32_t kMinBandwidthHistoryItems = 20;
-    static const int64_t kMinBandwidthHistoryWindowUs = 5000000ll; // 5 sec
-    static const int64_t kMaxBandwidthHistoryWindowUs = 30000000ll; // 30 sec
-    static const int64_t kMaxBandwidthHistoryAgeUs = 60000000ll; // 60 sec
-
-    struct BandwidthEntry {
-        int64_t mTimestampUs;
-        int64_t mDelayUs;
-        size_t mNumBytes;
-    };
-
-    Mutex mLock;
-    List<BandwidthEntry> mBandwidthHistory;
-    List<int32_t> mPrevEstimates;
-    int32_t mShortTermEstimate;
-    bool mHasNewSample;
-    bool mIsStable;
-    int64_t mTotalTransferTimeUs;
-    size_t mTotalTransferBytes;
-
-    DISALLOW_EVIL_CONSTRUCTORS(BandwidthEstimator);
-};
-
-LiveSession::BandwidthEstimator::BandwidthEstimator() :
-    mShortTermEstimate(0),
-    mHasNewSample(false),
-    mIsStable(true),
-    mTotalTransferTimeUs(0),
-    mTotalTransferBytes(0) {
-}
-
-void LiveSession::BandwidthEstimator::addBandwidthMeasurement(
-        size_t numBytes, int64_t delayUs) {
-    AutoMutex autoLock(mLock);
-
-    int64_t nowUs = ALooper::GetNowUs();
-    BandwidthEntry entry;
-    entry.mTimestampUs = nowUs;
-    entry.mDelayUs = delayUs;
-    entry.mNumBytes = numBytes;
-    mTotalTransferTimeUs += delayUs;
-    mTotalTransferBytes += numBytes;
-    mBandwidthHistory.push_back(entry);
-    mHasNewSample = true;
-
-    // Remove no more than 10% of total transfer time at a time
-    // to avoid sudden jump on bandwidth estimation. There might
-    // be long blocking reads that takes up signification time,
-    // we have to keep a longer window in that case.
-    int64_t bandwidthHistoryWindowUs = mTotalTransferTimeUs * 9 / 10;
-    if (bandwidthHistoryWindowUs < kMinBandwidthHistoryWindowUs) {
-        bandwidthHistoryWindowUs = kMinBandwidthHistoryWindowUs;
-    } else if (bandwidthHistoryWindowUs > kMaxBandwidthHistoryWindowUs) {
-        bandwidthHistoryWindowUs = kMaxBandwidthHistoryWindowUs;
-    }
-    // trim old samples, keeping at least kMaxBandwidthHistoryItems samples,
-    // and total transfer time at least kMaxBandwidthHistoryWindowUs.
-    while (mBandwidthHistory.size() > kMinBandwidthHistoryItems) {
-        List<BandwidthEntry>::iterator it = mBandwidthHistory.begin();
-        // remove sample if either absolute age or total transfer time is
-        // over kMaxBandwidthHistoryWindowUs
-        if (nowUs - it->mTimestampUs < kMaxBandwidthHistoryAgeUs &&
-                mTotalTransferTimeUs - it->mDelayUs < bandwidthHistoryWindowUs) {
-            break;
-        }
-        mTotalTransferTimeUs -= it->mDelayUs;
-        mTotalTransferBytes -= it->mNumBytes;
-        mBandwidthHistory.erase(mBandwidthHistory.begin());
-    }
-}
-
-bool LiveSession::BandwidthEstimator::estimateBandwidth(
-        int32_t *bandwidthBps, bool *isStable, int32_t *shortTermBps) {
-    AutoMutex autoLock(mLock);
-
-    if (mBandwidthHistory.size() < 2) {
-        return false;
-    }
-
-    if (!mHasNewSample) {
-        *bandwidthBps = *(--mPrevEstimates.end());
-        if (isStable) {
-            *isStable = mIsStable;
-        }
-        if (shortTermBps) {
-            *shortTermBps = mShortTermEstimate;
-        }
-        return true;
-    }
-
-    *bandwidthBps = ((double)mTotalTransferBytes * 8E6 / mTotalTransferTimeUs);
-    mPrevEstimates.push_back(*bandwidthBps);
-    while (mPrevEstimates.size() > 3) {
-        mPrevEstimates.erase(mPrevEstimates.begin());
-    }
-    mHasNewSample = false;
-
-    int64_t totalTimeUs = 0;
-    size_t totalBytes = 0;
-    if (mBandwidthHistory.size() >= kShortTermBandwidthItems) {
-        List<BandwidthEntry>::iterator it = --mBandwidthHistory.end();
-        for (size_t i = 0; i < kShortTermBandwidthItems; i++, it--) {
-            totalTimeUs += it->mDelayUs;
-            totalBytes += it->mNumBytes;
-        }
-    }
-    mShortTermEstimate = totalTimeUs > 0 ?
-            (totalBytes * 8E6 / totalTimeUs) : *bandwidthBps;
-    if (shortTermBps) {
-        *shortTermBps = mShortTermEstimate;
-    }
-
-    int32_t minEstimate = -1, maxEstimate = -1;
-    List<int32_t>::iterator it;
-    for (it = mPrevEstimates.begin(); it != mPrevEstimates.end(); it++) {
-        int32_t estimate = *it;
-        if (minEstimate < 0 || minEstimate > estimate) {
-            minEstimate = estimate;
-        }
-        if (maxEstimate < 0 || maxEstimate < estimate) {
-            maxEstimate = estimate;
-        }
-    }
-    // consider it stable if long-term average is not jumping a lot
-    // and short-term average is not much lower than long-term average
-    mIsStable = (maxEstimate <= minEstimate * 4 / 3)
-            && mShortTermEstimate > minEstimate * 7 / 10;
-    if (isStable) {
-        *isStable = mIsStable;
-    }
-
-#if 0
-    {
-        char dumpStr[1024] = {0};
-        size_t itemIdx = 0;
-        size_t histSize = mBandwidthHistory.size();
-        sprintf(dumpStr, "estimate bps=%d stable=%d history (n=%d): {",
-            *bandwidthBps, mIsStable, histSize);
-        List<BandwidthEntry>::iterator it = mBandwidthHistory.begin();
-        for (; it != mBandwidthHistory.end(); ++it) {
-            if (itemIdx > 50) {
-                sprintf(dumpStr + strlen(dumpStr),
-                        "...(%zd more items)... }", histSize - itemIdx);
-                break;
-            }
-            sprintf(dumpStr + strlen(dumpStr), "%dk/%.3fs%s",
-                it->mNumBytes / 1024,
-                (double)it->mDelayUs * 1.0e-6,
-                (it == (--mBandwidthHistory.end())) ? "}" : ", ");
-            itemIdx++;
-        }
-        ALOGE(dumpStr);
-    }
-#endif
-    return true;
-}
-
 //static
 const char *LiveSession::getKeyForStream(StreamType type) {
     switch (type) {
@@ -314,6 +144,15 @@ LiveSession::LiveSession(
         mPacketSources.add(indexToType(i), new AnotherPacketSource(NULL /* meta */));
         mPacketSources2.add(indexToType(i), new AnotherPacketSource(NULL /* meta */));
     }
+
+    ABRPolicy::Type policyType = ABRPolicy::THROUGHPUT;
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.httplive.abr-policy", value, NULL)
+            && !ABRPolicy::ParseType(value, &policyType)) {
+        ALOGW("unknown ABR policy '%s'", value);
+    }
+    ALOGV("using %s ABR policy", ABRPolicy::TypeToString(policyType));
+    mABRController = new ABRController(policyType);
 }
 
 LiveSession::~LiveSession() {
@@ -1326,7 +1165,7 @@ ssize_t LiveSession::getLowestValidBandwidthIndex() const {
     return 0;
 }
 
-size_t LiveSession::getBandwidthIndex(int32_t bandwidthBps) {
+size_t LiveSession::getBandwidthIndex(const ABRPolicy::Status &status) {
     if (mBandwidthItems.size() < 2) {
         // shouldn't be here if we only have 1 bandwidth, check
         // logic to get rid of redundant bandwidth polling
@@ -1334,100 +1173,36 @@ size_t LiveSession::getBandwidthIndex(int32_t bandwidthBps) {
         return 0;
     }
 
-#if 1
+    ssize_t forcedIndex = -1;
     char value[PROPERTY_VALUE_MAX];
-    ssize_t index = -1;
     if (property_get("media.httplive.bw-index", value, NULL)) {
         char *end;
-        index = strtol(value, &end, 10);
+        forcedIndex = strtol(value, &end, 10);
         CHECK(end > value && *end == '\0');
-
-        if (index >= 0 && (size_t)index >= mBandwidthItems.size()) {
-            index = mBandwidthItems.size() - 1;
-        }
-    }
-
-    if (index < 0) {
-        char value[PROPERTY_VALUE_MAX];
-        if (property_get("media.httplive.max-bw", value, NULL)) {
-            char *end;
-            long maxBw = strtoul(value, &end, 10);
-            if (end > value && *end == '\0') {
-                if (maxBw > 0 && bandwidthBps > maxBw) {
-                    ALOGV("bandwidth capped to %ld bps", maxBw);
-                    bandwidthBps = maxBw;
-                }
-            }
-        }
-
-        // Pick the highest bandwidth stream that's not currently blacklisted
-        // below or equal to estimated bandwidth.
-
-        index = mBandwidthItems.size() - 1;
-        ssize_t lowestBandwidth = getLowestValidBandwidthIndex();
-        while (index > lowestBandwidth) {
-            // be conservative (70%) to avoid overestimating and immediately
-            // switching down again.
-            size_t adjustedBandwidthBps = bandwidthBps * 7 / 10;
-            const BandwidthItem &item = mBandwidthItems[index];
-            if (item.mBandwidth <= adjustedBandwidthBps
-                    && isBandwidthValid(item)) {
-                break;
-            }
-            --index;
-        }
-    }
-#elif 0
-    // Change bandwidth at random()
-    size_t index = uniformRand() * mBandwidthItems.size();
-#elif 0
-    // There's a 50% chance to stay on the current bandwidth and
-    // a 50% chance to switch to the next higher bandwidth (wrapping around
-    // to lowest)
-    const size_t kMinIndex = 0;
-
-    static ssize_t mCurBandwidthIndex = -1;
-
-    size_t index;
-    if (mCurBandwidthIndex < 0) {
-        index = kMinIndex;
-    } else if (uniformRand() < 0.5) {
-        index = (size_t)mCurBandwidthIndex;
-    } else {
-        index = mCurBandwidthIndex + 1;
-        if (index == mBandwidthItems.size()) {
-            index = kMinIndex;
-        }
     }
-    mCurBandwidthIndex = index;
-#elif 0
-    // Pick the highest bandwidth stream below or equal to 1.2 Mbit/sec
+    mABRController->setForcedIndex(forcedIndex);
 
-    size_t index = mBandwidthItems.size() - 1;
-    while (index > 0 && mBandwidthItems.itemAt(index).mBandwidth > 1200000) {
-        --index;
-    }
-#elif 1
-    char value[PROPERTY_VALUE_MAX];
-    size_t index;
-    if (property_get("media.httplive.bw-index", value, NULL)) {
+    int32_t maxBandwidthBps = 0;
+    if (property_get("media.httplive.max-bw", value, NULL)) {
         char *end;
-        index = strtoul(value, &end, 10);
-        CHECK(end > value && *end == '\0');
-
-        if (index >= mBandwidthItems.size()) {
-            index = mBandwidthItems.size() - 1;
+        long maxBw = strtoul(value, &end, 10);
+        if (end > value && *end == '\0' && maxBw > 0 && maxBw <= INT32_MAX) {
+            maxBandwidthBps = maxBw;
         }
-    } else {
-        index = 0;
     }
-#else
-    size_t index = mBandwidthItems.size() - 1;  // Highest bandwidth stream
-#endif
+    mABRController->setMaxBandwidth(maxBandwidthBps);
 
-    CHECK_GE(index, 0);
+    Vector<ABRPolicy::Variant> variants;
+    variants.setCapacity(mBandwidthItems.size());
+    for (size_t i = 0; i < mBandwidthItems.size(); ++i) {
+        ABRPolicy::Variant variant;
+        variant.mBandwidthBps = mBandwidthItems.itemAt(i).mBandwidth;
+        variant.mIsValid = isBandwidthValid(mBandwidthItems.itemAt(i));
+        variants.push(variant);
+    }
 
-    return index;
+    return mABRController->selectVariant(
+            variants, status, mInPreparationPhase);
 }
 
 HLSTime LiveSession::latestMediaSegmentStartTime() const {
@@ -2063,7 +1838,8 @@ void LiveSession::onPollBuffering() {
         mInPreparationPhase, mCurBandwidthIndex, mStreamMask);
 
     bool underflow, ready, down, up;
-    if (checkBuffering(underflow, ready, down, up)) {
+    int64_t bufferedDurationUs;
+    if (checkBuffering(underflow, ready, down, up, bufferedDurationUs)) {
         if (mInPreparationPhase) {
             // Allow down switch even if we're still preparing.
             //
@@ -2072,7 +1848,8 @@ void LiveSession::onPollBuffering() {
             // to ready mark, then it immediately pauses after start
             // as we have to do a down switch. It's better experience
             // to restart from a lower index, if we detect low bw.
-            if (!switchBandwidthIfNeeded(false /* up */, down) && ready) {
+            if (!switchBandwidthIfNeeded(
+                    false /* up */, down, bufferedDurationUs) && ready) {
                 postPrepared(OK);
             }
         }
@@ -2083,7 +1860,7 @@ void LiveSession::onPollBuffering() {
             } else if (underflow) {
                 startBufferingIfNecessary();
             }
-            switchBandwidthIfNeeded(up, down);
+            switchBandwidthIfNeeded(up, down, bufferedDurationUs);
         }
     }
 
@@ -2138,8 +1915,10 @@ void LiveSession::cancelBandwidthSwitch(bool resume) {
 }
 
 bool LiveSession::checkBuffering(
-        bool &underflow, bool &ready, bool &down, bool &up) {
+        bool &underflow, bool &ready, bool &down, bool &up,
+        int64_t &minBufferedDurationUs) {
     underflow = ready = down = up = false;
+    minBufferedDurationUs = -1;
 
     if (mReconfigurationInProgress) {
         ALOGV("Switch/Reconfig in progress, defer buffer polling");
@@ -2192,6 +1971,10 @@ bool LiveSession::checkBuffering(
             ++readyCount;
         }
         if (!mPacketSources[i]->isFinished(0)) {
+            if (minBufferedDurationUs < 0
+                    || bufferedDurationUs < minBufferedDurationUs) {
+                minBufferedDurationUs = bufferedDurationUs;
+            }
             if (bufferedDurationUs < kUnderflowMarkUs) {
                 ++underflowCount;
             }
@@ -2290,9 +2073,11 @@ bool LiveSession::tryBandwidthFallback() {
  * returns true if a bandwidth switch is actually needed (and started),
  * returns false otherwise
  */
-bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
-    // no need to check bandwidth if we only have 1 bandwidth settings
-    if (mBandwidthItems.size() < 2) {
+bool LiveSession::switchBandwidthIfNeeded(
+        bool bufferHigh, bool bufferLow, int64_t bufferedDurationUs) {
+    // no need to check bandwidth if we only have 1 bandwidth settings,
+    // or if all streams have been fetched to the end
+    if (mBandwidthItems.size() < 2 || bufferedDurationUs < 0) {
         return false;
     }
 
@@ -2317,40 +2102,25 @@ bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
         return false;
     }
 
-    int32_t curBandwidth = mBandwidthItems.itemAt(mCurBandwidthIndex).mBandwidth;
-    // canSwithDown and canSwitchUp can't both be true.
-    // we only want to switch up when measured bw is 120% higher than current variant,
-    // and we only want to switch down when measured bw is below current variant.
-    bool canSwitchDown = bufferLow
-            && (bandwidthBps < (int32_t)curBandwidth);
-    bool canSwitchUp = bufferHigh
-            && (bandwidthBps > (int32_t)curBandwidth * 12 / 10);
-
-    if (canSwitchDown || canSwitchUp) {
-        // bandwidth estimating has some delay, if we have to downswitch when
-        // it hasn't stabilized, use the short term to guess real bandwidth,
-        // since it may be dropping too fast.
-        // (note this doesn't apply to upswitch, always use longer average there)
-        if (!isStable && canSwitchDown) {
-            if (shortTermBps < bandwidthBps) {
-                bandwidthBps = shortTermBps;
-            }
-        }
-
-        ssize_t bandwidthIndex = getBandwidthIndex(bandwidthBps);
-
-        // it's possible that we're checking for canSwitchUp case, but the returned
-        // bandwidthIndex is < mCurBandwidthIndex, as getBandwidthIndex() only uses 70%
-        // of measured bw. In that case we don't want to do anything, since we have
-        // both enough buffer and enough bw.
-        if ((canSwitchUp && bandwidthIndex > mCurBandwidthIndex)
-         || (canSwitchDown && bandwidthIndex < mCurBandwidthIndex)) {
-            // if not yet prepared, just restart again with new bw index.
-            // this is faster and playback experience is cleaner.
-            changeConfiguration(
-                    mInPreparationPhase ? 0 : -1ll, bandwidthIndex);
-            return true;
-        }
+    ABRPolicy::Status status;
+    status.mCurIndex = mCurBandwidthIndex;
+    status.mBandwidthBps = bandwidthBps;
+    status.mShortTermBps = shortTermBps;
+    status.mIsStable = isStable;
+    status.mBufferedDurationUs = bufferedDurationUs;
+    status.mBufferHigh = bufferHigh;
+    status.mBufferLow = bufferLow;
+    status.mUpSwitchMarkUs = mUpSwitchMark;
+    status.mDownSwitchMarkUs = mDownSwitchMark;
+    status.mMaxBufferedDurationUs = PlaylistFetcher::kMinBufferedDurationUs;
+
+    ssize_t bandwidthIndex = getBandwidthIndex(status);
+    if (bandwidthIndex != mCurBandwidthIndex) {
+        // if not yet prepared, just restart again with new bw index.
+        // this is faster and playback experience is cleaner.
+        changeConfiguration(
+                mInPreparationPhase ? 0 : -1ll, bandwidthIndex);
+        return true;
     }
     return false;
 }
@@ -23,6 +23,7 @@
 
 #include <utils/String8.h>
 
+#include "ABRPolicy.h"
 #include "mpeg2ts/ATSParser.h"
 
 namespace android {
@@ -30,6 +31,7 @@ namespace android {
 struct ABuffer;
 struct AReplyToken;
 struct AnotherPacketSource;
+struct BandwidthBaseEstimator;
 class DataSource;
 struct HTTPBase;
 struct IMediaHTTPService;
@@ -141,15 +143,6 @@ protected:
     static const int64_t kPrepareMarkUs;
     static const int64_t kUnderflowMarkUs;
 
-    struct BandwidthBaseEstimator : public RefBase {
-        virtual void addBandwidthMeasurement(size_t numBytes, int64_t delayUs) = 0;
-        virtual bool estimateBandwidth(
-                int32_t *bandwidth,
-                bool *isStable = NULL,
-                int32_t *shortTermBps = NULL) = 0;
-    };
-
-    struct BandwidthEstimator;
     struct BandwidthItem {
         size_t mPlaylistIndex;
         unsigned long mBandwidth;
@@ -209,6 +202,7 @@ protected:
     int32_t mLastBandwidthBps;
     bool mLastBandwidthStable;
     sp<BandwidthBaseEstimator> mBandwidthEstimator;
+    sp<ABRController> mABRController;
 
     sp<M3UParser> mPlaylist;
     int32_t mMaxWidth;
@@ -276,7 +270,7 @@ protected:
     float getAbortThreshold(
             ssize_t currentBWIndex, ssize_t targetBWIndex) const;
     void addBandwidthMeasurement(size_t numBytes, int64_t delayUs);
-    virtual size_t getBandwidthIndex(int32_t bandwidthBps);
+    virtual size_t getBandwidthIndex(const ABRPolicy::Status &status);
     ssize_t getLowestValidBandwidthIndex() const;
     HLSTime latestMediaSegmentStartTime() const;
 
@@ -297,14 +291,16 @@ protected:
     bool checkSwitchProgress(
             sp<AMessage> &msg, int64_t delayUs, bool *needResumeUntil);
 
-    bool switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow);
+    bool switchBandwidthIfNeeded(
+            bool bufferHigh, bool bufferLow, int64_t bufferedDurationUs);
     bool tryBandwidthFallback();
 
     void schedulePollBuffering();
     void cancelPollBuffering();
     void restartPollBuffering();
     virtual void onPollBuffering();
-    bool checkBuffering(bool &underflow, bool &ready, bool &down, bool &up);
+    bool checkBuffering(bool &underflow, bool &ready, bool &down, bool &up,
+            int64_t &minBufferedDurationUs);
     void startBufferingIfNecessary();
     void stopBufferingIfNecessary();
     void notifyBufferingUpdate(int32_t percentage);
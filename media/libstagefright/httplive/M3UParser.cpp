@@ -243,7 +243,8 @@ bool M3UParser::MediaGroup::getActiveURI(AString *uri) const {
 ////////////////////////////////////////////////////////////////////////////////
 
 M3UParser::M3UParser(
-        const char *baseURI, const void *data, size_t size)
+        const char *baseURI, const void *data, size_t size,
+        const sp<M3UParser> &previous)
     : mInitCheck(NO_INIT),
       mBaseURI(baseURI),
       mIsExtM3U(false),
@@ -255,8 +256,13 @@ M3UParser::M3UParser(
       mTargetDurationUs(-1ll),
       mDiscontinuitySeq(0),
       mDiscontinuityCount(0),
-      mSelectedIndex(-1) {
-    mInitCheck = parse(data, size);
+      mSelectedIndex(-1),
+      mPartTargetDurationUs(-1ll),
+      mPartHoldBackUs(-1ll),
+      mSkipBoundaryUs(-1ll),
+      mCanBlockReload(false),
+      mHasPreloadHint(false) {
+    mInitCheck = parse(data, size, previous);
 }
 
 M3UParser::~M3UParser() {
@@ -331,6 +337,153 @@ bool M3UParser::itemAt(size_t index, AString *uri, sp<AMessage> *meta) {
     return true;
 }
 
+int64_t M3UParser::getPartTargetDuration() const {
+    return mPartTargetDurationUs;
+}
+
+bool M3UParser::canBlockReload() const {
+    return mCanBlockReload;
+}
+
+int64_t M3UParser::getSkipBoundary() const {
+    return mSkipBoundaryUs;
+}
+
+int64_t M3UParser::getPartHoldBack() const {
+    if (mPartHoldBackUs < 0 && mPartTargetDurationUs > 0) {
+        // PART-HOLD-BACK must be at least three part target durations.
+        return mPartTargetDurationUs * 3;
+    }
+    return mPartHoldBackUs;
+}
+
+size_t M3UParser::getPartCount(int32_t seqNumber) const {
+    if (seqNumber < mFirstSeqNumber) {
+        return 0;
+    }
+
+    size_t itemIndex = seqNumber - mFirstSeqNumber;
+
+    // Parts are only listed for the last few segments, look from the end.
+    size_t count = 0;
+    for (size_t i = mParts.size(); i > 0; --i) {
+        const Part &part = mParts.itemAt(i - 1);
+        if (part.mItemIndex < itemIndex) {
+            break;
+        } else if (part.mItemIndex == itemIndex) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+bool M3UParser::partAt(
+        int32_t seqNumber, size_t index,
+        AString *uri, sp<AMessage> *meta) const {
+    if (uri) {
+        uri->clear();
+    }
+
+    if (meta) {
+        *meta = NULL;
+    }
+
+    if (seqNumber < mFirstSeqNumber) {
+        return false;
+    }
+
+    size_t itemIndex = seqNumber - mFirstSeqNumber;
+
+    for (size_t i = mParts.size(); i > 0; --i) {
+        const Part &part = mParts.itemAt(i - 1);
+        if (part.mItemIndex < itemIndex) {
+            break;
+        } else if (part.mItemIndex == itemIndex && part.mPartIndex == index) {
+            if (uri) {
+                *uri = part.mURI;
+            }
+
+            if (meta) {
+                *meta = part.mMeta;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int32_t M3UParser::getPartHoldBackStart(int32_t *partIndex) const {
+    int64_t holdBackUs = getPartHoldBack();
+
+    // Walk back from the live edge over the listed parts, which cover the
+    // segment in progress and the most recent complete ones, and then over
+    // whole segments until the hold back is covered.
+    int64_t durationUs = 0ll;
+    for (int32_t seqNumber = mLastSeqNumber + 1;
+            seqNumber >= mFirstSeqNumber; --seqNumber) {
+        size_t partCount = getPartCount(seqNumber);
+
+        for (size_t i = partCount; i > 0; --i) {
+            sp<AMessage> partMeta;
+            CHECK(partAt(seqNumber, i - 1, NULL /* uri */, &partMeta));
+
+            int64_t partDurationUs;
+            CHECK(partMeta->findInt64("durationUs", &partDurationUs));
+            durationUs += partDurationUs;
+
+            // Playback can only start with a part that doesn't depend on
+            // the ones before it.
+            int32_t independent;
+            if (durationUs >= holdBackUs
+                    && (i == 1 || (partMeta->findInt32("independent", &independent)
+                            && independent))) {
+                *partIndex = (i == 1 && seqNumber <= mLastSeqNumber) ? -1 : i - 1;
+                return seqNumber;
+            }
+        }
+
+        if (partCount == 0 && seqNumber <= mLastSeqNumber) {
+            sp<AMessage> itemMeta = mItems.itemAt(seqNumber - mFirstSeqNumber).mMeta;
+
+            int64_t itemDurationUs;
+            CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+            durationUs += itemDurationUs;
+
+            if (durationUs >= holdBackUs) {
+                *partIndex = -1;
+                return seqNumber;
+            }
+        }
+    }
+
+    *partIndex = -1;
+    return mFirstSeqNumber;
+}
+
+bool M3UParser::getPreloadHint(
+        int32_t *seqNumber, size_t *index,
+        AString *uri, sp<AMessage> *meta) const {
+    if (!mHasPreloadHint) {
+        return false;
+    }
+
+    *seqNumber = mFirstSeqNumber + mPreloadHint.mItemIndex;
+    *index = mPreloadHint.mPartIndex;
+
+    if (uri) {
+        *uri = mPreloadHint.mURI;
+    }
+
+    if (meta) {
+        *meta = mPreloadHint.mMeta;
+    }
+
+    return true;
+}
+
 void M3UParser::pickRandomMediaItems() {
     for (size_t i = 0; i < mMediaGroups.size(); ++i) {
         mMediaGroups.valueAt(i)->pickRandomMediaItems();
@@ -544,11 +697,69 @@ static bool MakeURL(const char *baseURL, const char *url, AString *out) {
     return true;
 }
 
-status_t M3UParser::parse(const void *_data, size_t size) {
+// Tags that only apply to the segment that follows them.
+static bool IsSegmentTag(const AString &line) {
+    return line.startsWith("#EXTINF")
+            || line.startsWith("#EXT-X-BYTERANGE")
+            || line.startsWith("#EXT-X-KEY")
+            || line.startsWith("#EXT-X-PROGRAM-DATE-TIME")
+            || (line.startsWith("#EXT-X-DISCONTINUITY")
+                    && !line.startsWith("#EXT-X-DISCONTINUITY-SEQUENCE"));
+}
+
+int32_t M3UParser::getNextSeqNumber() const {
+    int32_t firstSeqNumber = 0;
+    if (mMeta != NULL) {
+        mMeta->findInt32("media-sequence", &firstSeqNumber);
+    }
+    return firstSeqNumber + mItems.size();
+}
+
+const M3UParser::Item *M3UParser::findPreviousItem(
+        const sp<M3UParser> &previous, int32_t seqNumber) const {
+    if (previous == NULL
+            || seqNumber < previous->mFirstSeqNumber
+            || seqNumber > previous->mLastSeqNumber) {
+        return NULL;
+    }
+    return &previous->mItems.itemAt(seqNumber - previous->mFirstSeqNumber);
+}
+
+void M3UParser::takeOverItem(const Item &item, uint64_t *segmentRangeOffset) {
+    // Items are never modified once parsed, so they can be shared between
+    // versions of the playlist.
+    mItems.push_back(item);
+
+    int32_t discontinuitySeq;
+    CHECK(item.mMeta->findInt32("discontinuity-sequence", &discontinuitySeq));
+    mDiscontinuityCount = discontinuitySeq - (int32_t)mDiscontinuitySeq;
+
+    int64_t rangeOffset, rangeLength;
+    if (item.mMeta->findInt64("range-offset", &rangeOffset)
+            && item.mMeta->findInt64("range-length", &rangeLength)) {
+        *segmentRangeOffset = rangeOffset + rangeLength;
+    }
+}
+
+status_t M3UParser::parse(
+        const void *_data, size_t size, const sp<M3UParser> &previous) {
     int32_t lineNo = 0;
 
     sp<AMessage> itemMeta;
 
+    // While refreshing, the tags of a segment that was in the previous
+    // version of the playlist are skipped. Parsing restarts at the first
+    // line after the previous URI if the segment turns out to need parsing
+    // after all: for good if its URI changed, or just for that segment if
+    // it comes with a key or parts.
+    bool reuseItems = previous != NULL
+            && previous->mInitCheck == OK && !previous->mIsVariantPlaylist;
+    int32_t parseSeqNumber = -1;
+    size_t itemStartOffset = 0;
+    if (reuseItems) {
+        mItems.setCapacity(previous->mItems.size());
+    }
+
     const char *data = (const char *)_data;
     size_t offset = 0;
     uint64_t segmentRangeOffset = 0;
@@ -576,6 +787,27 @@ status_t M3UParser::parse(const void *_data, size_t size) {
             mIsExtM3U = true;
         }
 
+        bool reuseItem = mIsExtM3U && reuseItems && !mIsVariantPlaylist
+                && getNextSeqNumber() != parseSeqNumber
+                && findPreviousItem(previous, getNextSeqNumber()) != NULL;
+
+        if (reuseItem) {
+            if (line.startsWith("#EXT-X-KEY")
+                    || (line.startsWith("#EXT-X-PART")
+                            && !line.startsWith("#EXT-X-PART-INF"))) {
+                // A key may be repeated for the first segment once the one
+                // it was listed with is removed, and parts are kept with
+                // the segment they belong to.
+                parseSeqNumber = getNextSeqNumber();
+                offset = itemStartOffset;
+                continue;
+            } else if (IsSegmentTag(line)) {
+                offset = offsetLF + 1;
+                ++lineNo;
+                continue;
+            }
+        }
+
         if (mIsExtM3U) {
             status_t err = OK;
 
@@ -650,6 +882,32 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 }
             } else if (line.startsWith("#EXT-X-MEDIA")) {
                 err = parseMedia(line);
+            } else if (line.startsWith("#EXT-X-SERVER-CONTROL")) {
+                if (mIsVariantPlaylist) {
+                    return ERROR_MALFORMED;
+                }
+                err = parseServerControl(line);
+            } else if (line.startsWith("#EXT-X-PART-INF")) {
+                if (mIsVariantPlaylist) {
+                    return ERROR_MALFORMED;
+                }
+                err = parsePartInf(line);
+            } else if (line.startsWith("#EXT-X-PART")) {
+                if (mIsVariantPlaylist) {
+                    return ERROR_MALFORMED;
+                }
+                err = parsePart(line, itemMeta);
+            } else if (line.startsWith("#EXT-X-PRELOAD-HINT")) {
+                if (mIsVariantPlaylist) {
+                    return ERROR_MALFORMED;
+                }
+                err = parsePreloadHint(line);
+            } else if (line.startsWith("#EXT-X-SKIP")) {
+                if (mIsVariantPlaylist) {
+                    return ERROR_MALFORMED;
+                }
+                err = parseSkip(line, previous, &segmentRangeOffset);
+                itemStartOffset = offsetLF + 1;
             }
 
             if (err != OK) {
@@ -658,6 +916,30 @@ status_t M3UParser::parse(const void *_data, size_t size) {
         }
 
         if (!line.startsWith("#")) {
+            if (reuseItem) {
+                const Item *previousItem =
+                    findPreviousItem(previous, getNextSeqNumber());
+
+                AString uri;
+                if (MakeURL(mBaseURI.c_str(), line.c_str(), &uri)
+                        && uri == previousItem->mURI) {
+                    takeOverItem(*previousItem, &segmentRangeOffset);
+                    itemMeta.clear();
+                    itemStartOffset = offsetLF + 1;
+                } else {
+                    ALOGV("playlist was rewritten at segment %d",
+                          getNextSeqNumber());
+                    reuseItems = false;
+                    itemMeta.clear();
+                    offset = itemStartOffset;
+                    continue;
+                }
+
+                offset = offsetLF + 1;
+                ++lineNo;
+                continue;
+            }
+
             if (!mIsVariantPlaylist) {
                 int64_t durationUs;
                 if (itemMeta == NULL
@@ -676,6 +958,7 @@ status_t M3UParser::parse(const void *_data, size_t size) {
             item->mMeta = itemMeta;
 
             itemMeta.clear();
+            itemStartOffset = offsetLF + 1;
         }
 
         offset = offsetLF + 1;
@@ -699,9 +982,27 @@ status_t M3UParser::parse(const void *_data, size_t size) {
             mMeta->findInt32("media-sequence", &mFirstSeqNumber);
         }
         mLastSeqNumber = mFirstSeqNumber + mItems.size() - 1;
+
+        if (mHasPreloadHint) {
+            // The hinted part follows the parts of the segment in progress.
+            mPreloadHint.mItemIndex = mItems.size();
+            mPreloadHint.mPartIndex = 0;
+            if (!mParts.empty()
+                    && mParts.itemAt(mParts.size() - 1).mItemIndex == mItems.size()) {
+                mPreloadHint.mPartIndex =
+                    mParts.itemAt(mParts.size() - 1).mPartIndex + 1;
+            }
+            mPreloadHint.mMeta->setInt32(
+                    "discontinuity-sequence",
+                    mDiscontinuitySeq + mDiscontinuityCount);
+            mPreloadHint.mMeta->setInt64("durationUs",
+                    mPartTargetDurationUs > 0
+                            ? mPartTargetDurationUs : mTargetDurationUs);
+        }
     }
 
-    for (size_t i = 0; i < mItems.size(); ++i) {
+    // Only variant streams refer to media groups.
+    for (size_t i = 0; mIsVariantPlaylist && i < mItems.size(); ++i) {
         sp<AMessage> meta = mItems.itemAt(i).mMeta;
         const char *keys[] = {"audio", "video", "subtitles"};
         for (size_t j = 0; j < sizeof(keys) / sizeof(const char *); ++j) {
@@ -1252,6 +1553,284 @@ status_t M3UParser::parseMedia(const AString &line) {
             flags);
 }
 
+// static
+status_t M3UParser::parseAttributes(const AString &line, sp<AMessage> *attrs) {
+    ssize_t colonPos = line.find(":");
+
+    if (colonPos < 0) {
+        return ERROR_MALFORMED;
+    }
+
+    *attrs = new AMessage;
+
+    size_t offset = colonPos + 1;
+
+    while (offset < line.size()) {
+        ssize_t end = FindNextUnquoted(line, ',', offset);
+        if (end < 0) {
+            end = line.size();
+        }
+
+        AString attr(line, offset, end - offset);
+        attr.trim();
+
+        offset = end + 1;
+
+        ssize_t equalPos = attr.find("=");
+        if (equalPos < 0) {
+            continue;
+        }
+
+        AString key(attr, 0, equalPos);
+        key.trim();
+
+        AString val(attr, equalPos + 1, attr.size() - equalPos - 1);
+        val.trim();
+
+        ALOGV("key=%s value=%s", key.c_str(), val.c_str());
+
+        if (isQuotedString(val)) {
+            val = unquoteString(val);
+        }
+
+        key.tolower();
+        (*attrs)->setString(key.c_str(), val.c_str());
+    }
+
+    return OK;
+}
+
+status_t M3UParser::parseServerControl(const AString &line) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString val;
+    if (attrs->findString("can-block-reload", &val)) {
+        mCanBlockReload = (val == "YES");
+    }
+
+    if (attrs->findString("can-skip-until", &val)) {
+        double x;
+        if (ParseDouble(val.c_str(), &x) != OK || x < 0) {
+            return ERROR_MALFORMED;
+        }
+        mSkipBoundaryUs = (int64_t)(x * 1E6);
+    }
+
+    if (attrs->findString("part-hold-back", &val)) {
+        double x;
+        if (ParseDouble(val.c_str(), &x) != OK || x < 0) {
+            return ERROR_MALFORMED;
+        }
+        mPartHoldBackUs = (int64_t)(x * 1E6);
+    }
+
+    return OK;
+}
+
+status_t M3UParser::parsePartInf(const AString &line) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString val;
+    double x;
+    if (!attrs->findString("part-target", &val)
+            || ParseDouble(val.c_str(), &x) != OK || x <= 0) {
+        ALOGE("Missing or invalid PART-TARGET in EXT-X-PART-INF.");
+        return ERROR_MALFORMED;
+    }
+    mPartTargetDurationUs = (int64_t)(x * 1E6);
+
+    return OK;
+}
+
+status_t M3UParser::parsePart(
+        const AString &line, const sp<AMessage> &itemMeta) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString uri, val;
+    double x;
+    if (!attrs->findString("uri", &uri)
+            || !attrs->findString("duration", &val)
+            || ParseDouble(val.c_str(), &x) != OK || x < 0) {
+        ALOGE("Incomplete EXT-X-PART element.");
+        return ERROR_MALFORMED;
+    }
+
+    Part part;
+    if (!MakeURL(mBaseURI.c_str(), uri.c_str(), &part.mURI)) {
+        ALOGE("failed to make absolute url for %s.", uriDebugString(uri).c_str());
+        return ERROR_MALFORMED;
+    }
+
+    // Parts listed before a segment's URI belong to that segment.
+    part.mItemIndex = mItems.size();
+    part.mPartIndex = 0;
+
+    const Part *prev = NULL;
+    if (!mParts.empty()) {
+        prev = &mParts.itemAt(mParts.size() - 1);
+        if (prev->mItemIndex == part.mItemIndex) {
+            part.mPartIndex = prev->mPartIndex + 1;
+        }
+    }
+
+    part.mMeta = new AMessage;
+    part.mMeta->setInt64("durationUs", (int64_t)(x * 1E6));
+    part.mMeta->setInt32("part-index", part.mPartIndex);
+    part.mMeta->setInt32(
+            "discontinuity-sequence", mDiscontinuitySeq + mDiscontinuityCount);
+
+    if (attrs->findString("independent", &val) && val == "YES") {
+        part.mMeta->setInt32("independent", true);
+    }
+
+    if (itemMeta != NULL) {
+        int32_t discontinuity;
+        if (part.mPartIndex == 0
+                && itemMeta->findInt32("discontinuity", &discontinuity)) {
+            part.mMeta->setInt32("discontinuity", discontinuity);
+        }
+
+        AString method;
+        if (itemMeta->findString("cipher-method", &method)) {
+            part.mMeta->setString("cipher-method", method.c_str());
+        }
+    }
+
+    if (attrs->findString("byterange", &val)) {
+        // Without an offset the range continues the previous part of the
+        // same resource.
+        uint64_t curOffset = 0;
+        int64_t prevOffset, prevLength;
+        if (prev != NULL && prev->mURI == part.mURI
+                && prev->mMeta->findInt64("range-offset", &prevOffset)
+                && prev->mMeta->findInt64("range-length", &prevLength)) {
+            curOffset = prevOffset + prevLength;
+        }
+
+        AString byteRange(":");
+        byteRange.append(val);
+
+        uint64_t length, offset;
+        err = parseByteRange(byteRange, curOffset, &length, &offset);
+        if (err != OK) {
+            return err;
+        }
+
+        part.mMeta->setInt64("range-offset", offset);
+        part.mMeta->setInt64("range-length", length);
+    }
+
+    mParts.push_back(part);
+
+    return OK;
+}
+
+status_t M3UParser::parseSkip(
+        const AString &line, const sp<M3UParser> &previous,
+        uint64_t *segmentRangeOffset) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString val;
+    int32_t skipped;
+    if (!attrs->findString("skipped-segments", &val)
+            || ParseInt32(val.c_str(), &skipped) != OK || skipped < 0) {
+        ALOGE("Missing or invalid SKIPPED-SEGMENTS in EXT-X-SKIP.");
+        return ERROR_MALFORMED;
+    }
+
+    // The skipped segments are the oldest ones of the playlist; they have
+    // to be in the version we're updating.
+    for (int32_t i = 0; i < skipped; ++i) {
+        const Item *item = findPreviousItem(previous, getNextSeqNumber());
+        if (item == NULL) {
+            ALOGE("Delta update skips segment %d which we don't have.",
+                  getNextSeqNumber());
+            return ERROR_MALFORMED;
+        }
+        takeOverItem(*item, segmentRangeOffset);
+    }
+
+    return OK;
+}
+
+status_t M3UParser::parsePreloadHint(const AString &line) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString type, uri;
+    if (!attrs->findString("type", &type) || !attrs->findString("uri", &uri)) {
+        ALOGE("Incomplete EXT-X-PRELOAD-HINT element.");
+        return ERROR_MALFORMED;
+    }
+
+    if (type != "PART") {
+        // Only partial segment hints are used.
+        return OK;
+    }
+
+    Part hint;
+    if (!MakeURL(mBaseURI.c_str(), uri.c_str(), &hint.mURI)) {
+        ALOGE("failed to make absolute url for %s.", uriDebugString(uri).c_str());
+        return ERROR_MALFORMED;
+    }
+    hint.mMeta = new AMessage;
+
+    AString val;
+    if (attrs->findString("byterange-start", &val)) {
+        // An open ended range can't be requested as a block download, so
+        // a hint is only used if it has a length.
+        AString lengthStr;
+        if (!attrs->findString("byterange-length", &lengthStr)) {
+            return OK;
+        }
+
+        const char *s = val.c_str();
+        char *end;
+        uint64_t offset = strtoull(s, &end, 10);
+        if (s == end || *end != '\0') {
+            return ERROR_MALFORMED;
+        }
+
+        s = lengthStr.c_str();
+        uint64_t length = strtoull(s, &end, 10);
+        if (s == end || *end != '\0') {
+            return ERROR_MALFORMED;
+        }
+
+        hint.mMeta->setInt64("range-offset", offset);
+        hint.mMeta->setInt64("range-length", length);
+    }
+
+    // The position of the hinted part is only known once the whole
+    // playlist has been parsed.
+    hint.mItemIndex = 0;
+    hint.mPartIndex = 0;
+
+    mPreloadHint = hint;
+    mHasPreloadHint = true;
+
+    return OK;
+}
+
 // static
 status_t M3UParser::parseDiscontinuitySequence(const AString &line, size_t *seq) {
     ssize_t colonPos = line.find(":");
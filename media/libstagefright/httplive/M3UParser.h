@@ -27,7 +27,12 @@
 namespace android {
 
 struct M3UParser : public RefBase {
-    M3UParser(const char *baseURI, const void *data, size_t size);
+    // |previous| is the last version of a media playlist that is being
+    // refreshed. Segments that are still listed are taken over from it
+    // rather than parsed again, and the segments an EXT-X-SKIP delta
+    // update leaves out are filled in from it.
+    M3UParser(const char *baseURI, const void *data, size_t size,
+              const sp<M3UParser> &previous = NULL);
 
     status_t initCheck() const;
 
@@ -55,6 +60,32 @@ struct M3UParser : public RefBase {
     bool getTypeURI(size_t index, const char *key, AString *uri) const;
     bool hasType(size_t index, const char *key) const;
 
+    // Low-latency playlists list the partial segments (EXT-X-PART) of their
+    // most recent segments, including those of the segment that follows the
+    // last complete one and is still being produced.
+    // Returns -1 if the playlist doesn't list partial segments.
+    int64_t getPartTargetDuration() const;
+    bool canBlockReload() const;
+    // Returns the CAN-SKIP-UNTIL boundary of delta updates, or -1 if the
+    // server doesn't serve them.
+    int64_t getSkipBoundary() const;
+    int64_t getPartHoldBack() const;
+    size_t getPartCount(int32_t seqNumber) const;
+    bool partAt(
+            int32_t seqNumber, size_t index,
+            AString *uri, sp<AMessage> *meta = NULL) const;
+
+    // Returns the segment to start live playback with, PART-HOLD-BACK
+    // from the live edge. If playback is to start with one of its parts,
+    // an independent one, |partIndex| is set to its index, otherwise to -1.
+    int32_t getPartHoldBackStart(int32_t *partIndex) const;
+
+    // Returns the partial segment the server announced with
+    // EXT-X-PRELOAD-HINT, which follows the last one listed.
+    bool getPreloadHint(
+            int32_t *seqNumber, size_t *index,
+            AString *uri, sp<AMessage> *meta = NULL) const;
+
 protected:
     virtual ~M3UParser();
 
@@ -66,6 +97,13 @@ private:
         sp<AMessage> mMeta;
     };
 
+    struct Part {
+        AString mURI;
+        sp<AMessage> mMeta;
+        size_t mItemIndex;
+        size_t mPartIndex;
+    };
+
     status_t mInitCheck;
 
     AString mBaseURI;
@@ -83,10 +121,27 @@ private:
     Vector<Item> mItems;
     ssize_t mSelectedIndex;
 
+    Vector<Part> mParts;
+    int64_t mPartTargetDurationUs;
+    int64_t mPartHoldBackUs;
+    int64_t mSkipBoundaryUs;
+    bool mCanBlockReload;
+    bool mHasPreloadHint;
+    Part mPreloadHint;
+
     // Media groups keyed by group ID.
     KeyedVector<AString, sp<MediaGroup> > mMediaGroups;
 
-    status_t parse(const void *data, size_t size);
+    status_t parse(
+            const void *data, size_t size, const sp<M3UParser> &previous);
+
+    int32_t getNextSeqNumber() const;
+    const Item *findPreviousItem(
+            const sp<M3UParser> &previous, int32_t seqNumber) const;
+    void takeOverItem(const Item &item, uint64_t *segmentRangeOffset);
+    status_t parseSkip(
+            const AString &line, const sp<M3UParser> &previous,
+            uint64_t *segmentRangeOffset);
 
     static status_t parseMetaData(
             const AString &line, sp<AMessage> *meta, const char *key);
@@ -106,6 +161,13 @@ private:
 
     status_t parseMedia(const AString &line);
 
+    status_t parseServerControl(const AString &line);
+    status_t parsePartInf(const AString &line);
+    status_t parsePart(const AString &line, const sp<AMessage> &itemMeta);
+    status_t parsePreloadHint(const AString &line);
+
+    static status_t parseAttributes(const AString &line, sp<AMessage> *attrs);
+
     static status_t parseDiscontinuitySequence(const AString &line, size_t *seq);
 
     static status_t ParseInt32(const char *s, int32_t *x);
@@ -23,6 +23,7 @@
 #include "HTTPDownloader.h"
 #include "LiveSession.h"
 #include "M3UParser.h"
+#include "SegmentPrefetcher.h"
 #include "include/avc_utils.h"
 #include "include/ID3.h"
 #include "mpeg2ts/AnotherPacketSource.h"
@@ -35,9 +36,10 @@
 #include <media/stagefright/Utils.h>
 #include <stagefright/AVExtensions.h>
 
+#include <cutils/properties.h>
+
 #include <ctype.h>
 #include <inttypes.h>
-#include <openssl/aes.h>
 
 #define FLOGV(fmt, ...) ALOGV("[fetcher-%d] " fmt, mFetcherID, ##__VA_ARGS__)
 #define FSLOGV(stream, fmt, ...) ALOGV("[fetcher-%d] [%s] " fmt, mFetcherID, \
@@ -50,6 +52,8 @@ const int64_t PlaylistFetcher::kMinBufferedDurationUs = 30000000ll;
 const int64_t PlaylistFetcher::kMaxMonitorDelayUs = 3000000ll;
 // LCM of 188 (size of a TS packet) & 1k works well
 const int32_t PlaylistFetcher::kDownloadBlockSize = 47 * 1024;
+// number of upcoming segments downloaded while the current one is parsed
+const int32_t PlaylistFetcher::kDefaultPrefetchDepth = 2;
 
 struct PlaylistFetcher::DownloadState : public RefBase {
     DownloadState();
@@ -144,6 +148,7 @@ PlaylistFetcher::PlaylistFetcher(
         int32_t id,
         int32_t subtitleGeneration)
     : mNotify(notify),
+      mPrefetchPending(false),
       mSession(session),
       mURI(uri),
       mFetcherID(id),
@@ -155,6 +160,8 @@ PlaylistFetcher::PlaylistFetcher(
       mLastPlaylistFetchTimeUs(-1ll),
       mPlaylistTimeUs(-1ll),
       mSeqNumber(-1),
+      mPartIndex(-1),
+      mPartialSegmentsDisabled(false),
       mNumRetries(0),
       mStartup(true),
       mIDRFound(false),
@@ -172,10 +179,23 @@ PlaylistFetcher::PlaylistFetcher(
       mDownloadState(new DownloadState()),
       mHasMetadata(false) {
     memset(mPlaylistHash, 0, sizeof(mPlaylistHash));
+    EVP_CIPHER_CTX_init(&mAESContext);
     mHTTPDownloader = mSession->getHTTPDownloader();
+
+    int32_t prefetchDepth = property_get_int32(
+            "media.httplive.prefetch-depth", kDefaultPrefetchDepth);
+    if (prefetchDepth > 0) {
+        mPrefetcher = new SegmentPrefetcher(
+                mSession->getHTTPDownloader(), prefetchDepth);
+        mPrefetcher->start();
+    }
 }
 
 PlaylistFetcher::~PlaylistFetcher() {
+    if (mPrefetcher != NULL) {
+        mPrefetcher->stop();
+    }
+    EVP_CIPHER_CTX_cleanup(&mAESContext);
 }
 
 int32_t PlaylistFetcher::getFetcherID() const {
@@ -189,8 +209,10 @@ int64_t PlaylistFetcher::getSegmentStartTimeUs(int32_t seqNumber) const {
     mPlaylist->getSeqNumberRange(
             &firstSeqNumberInPlaylist, &lastSeqNumberInPlaylist);
 
+    // The segment following the last complete one may be downloaded in
+    // parts, it starts where the playlist ends.
     CHECK_GE(seqNumber, firstSeqNumberInPlaylist);
-    CHECK_LE(seqNumber, lastSeqNumberInPlaylist);
+    CHECK_LE(seqNumber, lastSeqNumberInPlaylist + 1);
 
     int64_t segmentStartUs = 0ll;
     for (int32_t index = 0;
@@ -216,7 +238,12 @@ int64_t PlaylistFetcher::getSegmentDurationUs(int32_t seqNumber) const {
             &firstSeqNumberInPlaylist, &lastSeqNumberInPlaylist);
 
     CHECK_GE(seqNumber, firstSeqNumberInPlaylist);
-    CHECK_LE(seqNumber, lastSeqNumberInPlaylist);
+    CHECK_LE(seqNumber, lastSeqNumberInPlaylist + 1);
+
+    if (seqNumber > lastSeqNumberInPlaylist) {
+        // Still being produced, its duration is not known yet.
+        return mPlaylist->getTargetDuration();
+    }
 
     int32_t index = seqNumber - firstSeqNumberInPlaylist;
     sp<AMessage> itemMeta;
@@ -243,11 +270,30 @@ int64_t PlaylistFetcher::delayUsToRefreshPlaylist() const {
 
     int64_t targetDurationUs = mPlaylist->getTargetDuration();
 
+    // At the live edge of a low-latency playlist the playlist changes with
+    // every part. A server that supports blocking reloads holds the request
+    // until the part we're waiting for is available; if it doesn't, or the
+    // playlist came back unchanged, reload every part target duration.
+    bool atLiveEdge = mPartIndex >= 0 && mPlaylist->getPartTargetDuration() > 0;
+    if (atLiveEdge) {
+        if (mPlaylist->canBlockReload()
+                && mRefreshState == INITIAL_MINIMUM_RELOAD_DELAY
+                && isWaitingForPart()) {
+            return 0ll;
+        }
+        targetDurationUs = mPlaylist->getPartTargetDuration();
+    }
+
     int64_t minPlaylistAgeUs;
 
     switch (mRefreshState) {
         case INITIAL_MINIMUM_RELOAD_DELAY:
         {
+            if (atLiveEdge) {
+                minPlaylistAgeUs = targetDurationUs;
+                break;
+            }
+
             size_t n = mPlaylist->size();
             if (n > 0) {
                 sp<AMessage> itemMeta;
@@ -290,26 +336,42 @@ int64_t PlaylistFetcher::delayUsToRefreshPlaylist() const {
     return delayUs > 0ll ? delayUs : 0ll;
 }
 
-status_t PlaylistFetcher::decryptBuffer(
-        size_t playlistIndex, const sp<ABuffer> &buffer,
-        bool first) {
-    sp<AMessage> itemMeta;
-    bool found = false;
-    AString method;
+void PlaylistFetcher::findCipherInfo(
+        size_t playlistIndex, AString *method, sp<AMessage> *itemMeta) {
+    *method = "NONE";
+    itemMeta->clear();
+
+    if (mPlaylist->size() == 0) {
+        return;
+    }
+
+    // A segment that is still being produced is encrypted with the key of
+    // the last complete one, unless its parts say otherwise.
+    if (playlistIndex >= mPlaylist->size()) {
+        playlistIndex = mPlaylist->size() - 1;
+    }
 
     for (ssize_t i = playlistIndex; i >= 0; --i) {
         AString uri;
-        CHECK(mPlaylist->itemAt(i, &uri, &itemMeta));
+        CHECK(mPlaylist->itemAt(i, &uri, itemMeta));
 
-        if (itemMeta->findString("cipher-method", &method)) {
-            found = true;
-            break;
+        if ((*itemMeta)->findString("cipher-method", method)) {
+            return;
         }
     }
 
-    if (!found) {
-        method = "NONE";
+    *method = "NONE";
+}
+
+status_t PlaylistFetcher::decryptBuffer(
+        size_t playlistIndex, const sp<ABuffer> &buffer,
+        bool first) {
+    if (first || mCipherItemMeta == NULL) {
+        findCipherInfo(playlistIndex, &mCipherMethod, &mCipherItemMeta);
     }
+
+    const AString &method = mCipherMethod;
+    const sp<AMessage> &itemMeta = mCipherItemMeta;
     buffer->meta()->setString("cipher-method", method.c_str());
 
     if (method == "NONE") {
@@ -325,31 +387,42 @@ status_t PlaylistFetcher::decryptBuffer(
         return ERROR_MALFORMED;
     }
 
-    ssize_t index = mAESKeyForURI.indexOfKey(keyURI);
+    if (first || !(keyURI == mAESContextKeyURI)) {
+        ssize_t index = mAESKeyForURI.indexOfKey(keyURI);
 
-    sp<ABuffer> key;
-    if (index >= 0) {
-        key = mAESKeyForURI.valueAt(index);
-    } else {
-        ssize_t err = mHTTPDownloader->fetchFile(keyURI.c_str(), &key);
+        sp<ABuffer> key;
+        if (index >= 0) {
+            key = mAESKeyForURI.valueAt(index);
+        } else {
+            ssize_t err = mHTTPDownloader->fetchFile(keyURI.c_str(), &key);
 
-        if (err == ERROR_NOT_CONNECTED) {
-            return ERROR_NOT_CONNECTED;
-        } else if (err < 0) {
-            ALOGE("failed to fetch cipher key from '%s'.", keyURI.c_str());
-            return ERROR_IO;
-        } else if (key->size() != 16) {
-            ALOGE("key file '%s' wasn't 16 bytes in size.", keyURI.c_str());
-            return ERROR_MALFORMED;
-        }
+            if (err == ERROR_NOT_CONNECTED) {
+                return ERROR_NOT_CONNECTED;
+            } else if (err < 0) {
+                ALOGE("failed to fetch cipher key from '%s'.", keyURI.c_str());
+                return ERROR_IO;
+            } else if (key->size() != 16) {
+                ALOGE("key file '%s' wasn't 16 bytes in size.", keyURI.c_str());
+                return ERROR_MALFORMED;
+            }
 
-        mAESKeyForURI.add(keyURI, key);
-    }
+            mAESKeyForURI.add(keyURI, key);
+        }
 
-    AES_KEY aes_key;
-    if (AES_set_decrypt_key(key->data(), 128, &aes_key) != 0) {
-        ALOGE("failed to set AES decryption key.");
-        return UNKNOWN_ERROR;
+        if (!(keyURI == mAESContextKeyURI)) {
+            // EVP picks the AES-NI / ARMv8 crypto extension implementation
+            // where the CPU supports it. Padding is checked separately once
+            // the whole segment has been decrypted.
+            if (EVP_DecryptInit_ex(
+                        &mAESContext, EVP_aes_128_cbc(), NULL,
+                        key->data(), NULL) != 1) {
+                ALOGE("failed to set AES decryption key.");
+                mAESContextKeyURI.clear();
+                return UNKNOWN_ERROR;
+            }
+            EVP_CIPHER_CTX_set_padding(&mAESContext, 0);
+            mAESContextKeyURI = keyURI;
+        }
     }
 
     size_t n = buffer->size();
@@ -366,6 +439,8 @@ status_t PlaylistFetcher::decryptBuffer(
         // If decrypting the first block in a file, read the iv from the manifest
         // or derive the iv from the file's sequence number.
 
+        uint8_t aesInitVec[16];
+
         AString iv;
         if (itemMeta->findString("cipher-iv", &iv)) {
             if ((!iv.startsWith("0x") && !iv.startsWith("0X"))
@@ -378,7 +453,7 @@ status_t PlaylistFetcher::decryptBuffer(
                 iv.insert("0", 1, 2);
             }
 
-            memset(mAESInitVec, 0, sizeof(mAESInitVec));
+            memset(aesInitVec, 0, sizeof(aesInitVec));
             for (size_t i = 0; i < 16; ++i) {
                 char c1 = tolower(iv.c_str()[2 + 2 * i]);
                 char c2 = tolower(iv.c_str()[3 + 2 * i]);
@@ -389,21 +464,36 @@ status_t PlaylistFetcher::decryptBuffer(
                 uint8_t nibble1 = isdigit(c1) ? c1 - '0' : c1 - 'a' + 10;
                 uint8_t nibble2 = isdigit(c2) ? c2 - '0' : c2 - 'a' + 10;
 
-                mAESInitVec[i] = nibble1 << 4 | nibble2;
+                aesInitVec[i] = nibble1 << 4 | nibble2;
             }
         } else {
-            memset(mAESInitVec, 0, sizeof(mAESInitVec));
-            mAESInitVec[15] = mSeqNumber & 0xff;
-            mAESInitVec[14] = (mSeqNumber >> 8) & 0xff;
-            mAESInitVec[13] = (mSeqNumber >> 16) & 0xff;
-            mAESInitVec[12] = (mSeqNumber >> 24) & 0xff;
-        }
+            memset(aesInitVec, 0, sizeof(aesInitVec));
+            aesInitVec[15] = mSeqNumber & 0xff;
+            aesInitVec[14] = (mSeqNumber >> 8) & 0xff;
+            aesInitVec[13] = (mSeqNumber >> 16) & 0xff;
+            aesInitVec[12] = (mSeqNumber >> 24) & 0xff;
+        }
+
+        // Only reset the IV, the key schedule is kept.
+        if (EVP_DecryptInit_ex(
+                    &mAESContext, NULL, NULL, NULL, aesInitVec) != 1) {
+            ALOGE("failed to set AES initialization vector.");
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    // Decrypt in place; with padding disabled and block aligned input all
+    // of it is output right away, and the context keeps the last cipher
+    // block as the IV for the next call.
+    int outLength;
+    if (EVP_DecryptUpdate(
+                &mAESContext, buffer->data(), &outLength,
+                buffer->data(), n) != 1
+            || (size_t)outLength != n) {
+        ALOGE("failed to decrypt %zu bytes", n);
+        return UNKNOWN_ERROR;
     }
 
-    AES_cbc_encrypt(
-            buffer->data(), buffer->data(), buffer->size(),
-            &aes_key, mAESInitVec, AES_DECRYPT);
-
     return OK;
 }
 
@@ -449,6 +539,7 @@ void PlaylistFetcher::postMonitorQueue(int64_t delayUs, int64_t minDelayUs) {
 
 void PlaylistFetcher::cancelMonitorQueue() {
     ++mMonitorQueueGeneration;
+    mPrefetchPending = false;
 }
 
 void PlaylistFetcher::setStoppingThreshold(float thresholdRatio, bool disconnect) {
@@ -458,6 +549,9 @@ void PlaylistFetcher::setStoppingThreshold(float thresholdRatio, bool disconnect
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->disconnect();
+        }
     }
 }
 
@@ -468,9 +562,15 @@ void PlaylistFetcher::resetStoppingThreshold(bool disconnect) {
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->disconnect();
+        }
     } else {
         // allow reconnect
         mHTTPDownloader->reconnect();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->reconnect();
+        }
     }
 }
 
@@ -629,6 +729,22 @@ void PlaylistFetcher::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatPrefetchedSegment:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
+
+            if (generation != mMonitorQueueGeneration || !mPrefetchPending) {
+                // Stale event
+                break;
+            }
+
+            mPrefetchPending = false;
+            mPrefetchedSegment = msg;
+            onDownloadNext();
+            break;
+        }
+
         default:
             TRESPASS();
     }
@@ -710,8 +826,14 @@ status_t PlaylistFetcher::onStart(const sp<AMessage> &msg) {
         mStartTimeUs = startTimeUs;
         mFirstPTSValid = false;
         mSeqNumber = -1;
+        mPartIndex = -1;
         mTimeChangeSignaled = false;
         mDownloadState->resetState();
+        if (mPrefetcher != NULL) {
+            mPrefetcher->flush();
+        }
+        // Drops the reply to a segment taken from the prefetcher.
+        cancelMonitorQueue();
     }
 
     postMonitorQueue();
@@ -739,6 +861,9 @@ void PlaylistFetcher::onStop(const sp<AMessage> &msg) {
     }
 
     mDownloadState->resetState();
+    if (mPrefetcher != NULL) {
+        mPrefetcher->flush();
+    }
     mPacketSources.clear();
     mStreamTypeMask = 0;
 
@@ -856,11 +981,54 @@ void PlaylistFetcher::onMonitorQueue() {
     }
 }
 
+bool PlaylistFetcher::isWaitingForPart() const {
+    if (mPartIndex < 0) {
+        return false;
+    }
+
+    int32_t firstSeqNumberInPlaylist, lastSeqNumberInPlaylist;
+    mPlaylist->getSeqNumberRange(
+            &firstSeqNumberInPlaylist, &lastSeqNumberInPlaylist);
+
+    return mSeqNumber > lastSeqNumberInPlaylist
+            && !mPlaylist->partAt(mSeqNumber, mPartIndex, NULL /* uri */);
+}
+
 status_t PlaylistFetcher::refreshPlaylist() {
     if (delayUsToRefreshPlaylist() <= 0) {
+        AString url = mURI;
+        if (mPlaylist != NULL && mPlaylist->canBlockReload()
+                && !mPlaylist->isComplete() && isWaitingForPart()) {
+            // Ask the server to hold on to the request until the part we'll
+            // download next is in the playlist.
+            url.append(mURI.find("?") < 0 ? "?" : "&");
+            url.append(AStringPrintf(
+                    "_HLS_msn=%d&_HLS_part=%d", mSeqNumber, mPartIndex));
+        }
+
+        // Ask for a delta update if the segments it leaves out are still in
+        // the playlist we have.
+        AString deltaURL;
+        if (mPlaylist != NULL && !mPlaylist->isComplete()
+                && mPlaylist->getSkipBoundary() > 0
+                && ALooper::GetNowUs() - mLastPlaylistFetchTimeUs
+                        < mPlaylist->getSkipBoundary() / 2) {
+            deltaURL = url;
+            deltaURL.append(url.find("?") < 0 ? "?" : "&");
+            deltaURL.append("_HLS_skip=YES");
+        }
+        bool delta = !deltaURL.empty();
+
         bool unchanged;
         sp<M3UParser> playlist = mHTTPDownloader->fetchPlaylist(
-                mURI.c_str(), mPlaylistHash, &unchanged);
+                delta ? deltaURL.c_str() : url.c_str(),
+                mPlaylistHash, &unchanged, mPlaylist);
+
+        if (playlist == NULL && !unchanged && delta) {
+            ALOGW("delta update of playlist failed, fetching all of it");
+            playlist = mHTTPDownloader->fetchPlaylist(
+                    url.c_str(), mPlaylistHash, &unchanged, mPlaylist);
+        }
 
         if (playlist == NULL) {
             if (unchanged) {
@@ -985,7 +1153,18 @@ bool PlaylistFetcher::initDownloadState(
             if (!mPlaylist->isComplete() && !mPlaylist->isEvent()) {
                 // If this is a live session, start 3 segments from the end on connect
                 if (!getSeqNumberInLiveStreaming()) {
-                    mSeqNumber = lastSeqNumberInPlaylist - 3;
+                    if (mPlaylist->getPartTargetDuration() > 0
+                            && !mPartialSegmentsDisabled) {
+                        // Low-latency playlists advertise how far from
+                        // the live edge to start instead.
+                        mSeqNumber = mPlaylist->getPartHoldBackStart(&mPartIndex);
+                        if (mPartIndex >= 0 && !canFetchPartsOf(
+                                mSeqNumber, firstSeqNumberInPlaylist)) {
+                            mPartIndex = -1;
+                        }
+                    } else {
+                        mSeqNumber = lastSeqNumberInPlaylist - 3;
+                    }
                 }
                 if (mSeqNumber < firstSeqNumberInPlaylist) {
                     mSeqNumber = firstSeqNumberInPlaylist;
@@ -1037,10 +1216,25 @@ bool PlaylistFetcher::initDownloadState(
         }
     }
 
+    bool partial = false;
+    if (mPlaylist != NULL && err == OK
+            && mSeqNumber >= firstSeqNumberInPlaylist) {
+        bool wait;
+        partial = selectPartialSegment(
+                uri, itemMeta, firstSeqNumberInPlaylist,
+                lastSeqNumberInPlaylist, &wait);
+        if (wait) {
+            FLOGV("part %d of segment %d not yet available",
+                    mPartIndex, mSeqNumber);
+            postMonitorQueue(delayUsToRefreshPlaylist());
+            return false;
+        }
+    }
+
     // if mPlaylist is NULL then err must be non-OK; but the other way around might not be true
-    if (mSeqNumber < firstSeqNumberInPlaylist
+    if (!partial && (mSeqNumber < firstSeqNumberInPlaylist
             || mSeqNumber > lastSeqNumberInPlaylist
-            || err != OK) {
+            || err != OK)) {
         if ((err != OK || !mPlaylist->isComplete()) && mNumRetries < kMaxNumRetries) {
             ++mNumRetries;
 
@@ -1090,6 +1284,7 @@ bool PlaylistFetcher::initDownloadState(
             if (mSeqNumber < firstSeqNumberInPlaylist) {
                 mSeqNumber = firstSeqNumberInPlaylist;
             }
+            mPartIndex = -1;
             discontinuity = true;
 
             // fall through
@@ -1132,10 +1327,12 @@ bool PlaylistFetcher::initDownloadState(
 
     mNumRetries = 0;
 
-    CHECK(mPlaylist->itemAt(
-                mSeqNumber - firstSeqNumberInPlaylist,
-                &uri,
-                &itemMeta));
+    if (!partial) {
+        CHECK(mPlaylist->itemAt(
+                    mSeqNumber - firstSeqNumberInPlaylist,
+                    &uri,
+                    &itemMeta));
+    }
 
     CHECK(itemMeta->findInt32("discontinuity-sequence", &mDiscontinuitySeq));
 
@@ -1217,12 +1414,116 @@ bool PlaylistFetcher::initDownloadState(
         }
     }
 
-    FLOGV("fetching segment %d from (%d .. %d)",
-            mSeqNumber, firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
+    FLOGV("fetching segment %d (part %d) from (%d .. %d)",
+            mSeqNumber, mPartIndex, firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
     return true;
 }
 
+bool PlaylistFetcher::canFetchPartsOf(
+        int32_t seqNumber, int32_t firstSeqNumberInPlaylist) {
+    // Encrypted parts are left to whole segment downloads, as the
+    // cipher state would have to be carried from part to part.
+    AString method;
+    sp<AMessage> cipherMeta;
+    findCipherInfo(
+            seqNumber - firstSeqNumberInPlaylist, &method, &cipherMeta);
+
+    sp<AMessage> partMeta;
+    if (mPlaylist->partAt(seqNumber, 0, NULL /* uri */, &partMeta)) {
+        partMeta->findString("cipher-method", &method);
+    }
+
+    return method == "NONE";
+}
+
+bool PlaylistFetcher::selectPartialSegment(
+        AString &uri,
+        sp<AMessage> &itemMeta,
+        int32_t firstSeqNumberInPlaylist,
+        int32_t lastSeqNumberInPlaylist,
+        bool *wait) {
+    *wait = false;
+
+    if (mPartIndex >= 0 && mSeqNumber <= lastSeqNumberInPlaylist) {
+        // The segment was completed since we started on its parts. Move on
+        // to the next one once we have all of them.
+        size_t partCount = mPlaylist->getPartCount(mSeqNumber);
+        if ((size_t)mPartIndex >= partCount) {
+            if ((size_t)mPartIndex > partCount) {
+                ALOGW("parts of segment %d are no longer listed, skipping "
+                      "the rest of it", mSeqNumber);
+            }
+            ++mSeqNumber;
+            mPartIndex = -1;
+        }
+    }
+
+    if (mPartIndex < 0) {
+        if (mPartialSegmentsDisabled
+                || mSeqNumber != lastSeqNumberInPlaylist + 1
+                || mPlaylist->getPartTargetDuration() <= 0) {
+            return false;
+        }
+
+        if (!canFetchPartsOf(mSeqNumber, firstSeqNumberInPlaylist)) {
+            return false;
+        }
+
+        mPartIndex = 0;
+    }
+
+    if (mPlaylist->partAt(mSeqNumber, mPartIndex, &uri, &itemMeta)) {
+        return true;
+    }
+
+    int32_t hintSeqNumber;
+    size_t hintIndex;
+    if (mPlaylist->getPreloadHint(&hintSeqNumber, &hintIndex, &uri, &itemMeta)
+            && hintSeqNumber == mSeqNumber && hintIndex == (size_t)mPartIndex) {
+        // The server holds on to the request until the part is available.
+        return true;
+    }
+
+    *wait = true;
+    return false;
+}
+
+void PlaylistFetcher::prefetchSegmentsAfter(
+        int32_t firstSeqNumberInPlaylist, int32_t lastSeqNumberInPlaylist) {
+    if (mPrefetcher == NULL || mPlaylist == NULL) {
+        return;
+    }
+
+    for (size_t i = 1; i <= mPrefetcher->getDepth(); ++i) {
+        int32_t seqNumber = mSeqNumber + i;
+        if (seqNumber > lastSeqNumberInPlaylist) {
+            break;
+        }
+
+        AString uri;
+        sp<AMessage> itemMeta;
+        if (!mPlaylist->itemAt(
+                    seqNumber - firstSeqNumberInPlaylist, &uri, &itemMeta)) {
+            break;
+        }
+
+        int64_t range_offset, range_length;
+        if (!itemMeta->findInt64("range-offset", &range_offset)
+                || !itemMeta->findInt64("range-length", &range_length)) {
+            range_offset = 0;
+            range_length = -1;
+        }
+
+        mPrefetcher->prefetch(uri, range_offset, range_length);
+    }
+}
+
 void PlaylistFetcher::onDownloadNext() {
+    if (mPrefetchPending) {
+        // The prefetcher's reply resumes the download.
+        return;
+    }
+
     AString uri;
     sp<AMessage> itemMeta;
     sp<ABuffer> buffer;
@@ -1239,7 +1540,9 @@ void PlaylistFetcher::onDownloadNext() {
                 tsBuffer,
                 firstSeqNumberInPlaylist,
                 lastSeqNumberInPlaylist);
-        connectHTTP = false;
+        // Nothing has been downloaded yet if we were waiting for the
+        // prefetcher.
+        connectHTTP = (buffer == NULL);
         FLOGV("resuming: '%s'", uri.c_str());
     } else {
         if (!initDownloadState(
@@ -1259,15 +1562,72 @@ void PlaylistFetcher::onDownloadNext() {
         range_length = -1;
     }
 
+    // If the segment was downloaded ahead of time, it's handed to the
+    // block loop below in download sized blocks, so that decryption and
+    // extraction still proceed a block at a time.
+    sp<ABuffer> prefetchedBuffer;
+    size_t prefetchedSize = 0;
+    int64_t prefetchDelayUs = 0ll;
+    bool exclusive = true;
+    if (mPrefetchedSegment != NULL) {
+        if (mPrefetchedSegment->findBuffer("buffer", &prefetchedBuffer)) {
+            int32_t prefetchExclusive;
+            CHECK(mPrefetchedSegment->findInt64("fetchTimeUs", &prefetchDelayUs));
+            CHECK(mPrefetchedSegment->findInt32("exclusive", &prefetchExclusive));
+            exclusive = prefetchExclusive;
+            prefetchedSize = prefetchedBuffer->size();
+            FLOGV("using prefetched segment, %zu bytes", prefetchedSize);
+        }
+        mPrefetchedSegment.clear();
+        prefetchSegmentsAfter(
+                firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
+    } else if (mPrefetcher != NULL && connectHTTP) {
+        sp<AMessage> reply = new AMessage(kWhatPrefetchedSegment, this);
+        reply->setInt32("generation", mMonitorQueueGeneration);
+        if (mPrefetcher->takeSegment(
+                uri, range_offset, range_length, reply)) {
+            mDownloadState->saveState(
+                    uri,
+                    itemMeta,
+                    buffer,
+                    tsBuffer,
+                    firstSeqNumberInPlaylist,
+                    lastSeqNumberInPlaylist);
+            mPrefetchPending = true;
+            return;
+        }
+        prefetchSegmentsAfter(
+                firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
+    }
+
     // block-wise download
     bool shouldPause = false;
     ssize_t bytesRead;
     do {
-        int64_t startUs = ALooper::GetNowUs();
-        bytesRead = mHTTPDownloader->fetchBlock(
-                uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
-                NULL /* actualURL */, connectHTTP);
-        int64_t delayUs = ALooper::GetNowUs() - startUs;
+        int64_t delayUs;
+        if (prefetchedBuffer != NULL) {
+            size_t consumed = (buffer == NULL) ? 0 : buffer->size();
+            bytesRead = prefetchedSize - consumed;
+            if (bytesRead > kDownloadBlockSize) {
+                bytesRead = kDownloadBlockSize;
+            }
+            buffer = prefetchedBuffer;
+            buffer->setRange(0, consumed + bytesRead);
+            delayUs = prefetchedSize > 0
+                    ? prefetchDelayUs * bytesRead / (int64_t)prefetchedSize : 0ll;
+        } else {
+            if (mPrefetcher != NULL) {
+                mPrefetcher->beginDownload();
+            }
+            int64_t startUs = ALooper::GetNowUs();
+            bytesRead = mHTTPDownloader->fetchBlock(
+                    uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
+                    NULL /* actualURL */, connectHTTP);
+            delayUs = ALooper::GetNowUs() - startUs;
+            if (mPrefetcher != NULL) {
+                exclusive = mPrefetcher->endDownload();
+            }
+        }
 
         if (bytesRead == ERROR_NOT_CONNECTED) {
             return;
@@ -1281,8 +1641,9 @@ void PlaylistFetcher::onDownloadNext() {
 
         // add sample for bandwidth estimation, excluding samples from subtitles (as
         // its too small), or during startup/resumeUntil (when we could have more than
-        // one connection open which affects bandwidth)
-        if (!mStartup && mStopParams == NULL && bytesRead > 0
+        // one connection open which affects bandwidth), or when our own download and
+        // the prefetcher's were running at the same time
+        if (!mStartup && mStopParams == NULL && bytesRead > 0 && exclusive
                 && (mStreamTypeMask
                         & (LiveSession::STREAMTYPE_AUDIO
                         | LiveSession::STREAMTYPE_VIDEO))) {
@@ -1356,8 +1717,10 @@ void PlaylistFetcher::onDownloadNext() {
         }
         if (shouldPause || shouldPauseDownload()) {
             // save state and return if this is not the last chunk,
-            // leaving the fetcher in paused state.
-            if (bytesRead != 0) {
+            // leaving the fetcher in paused state. A prefetched segment
+            // is processed in full, as resuming would fetch the rest of it
+            // over our own connection.
+            if (bytesRead != 0 && prefetchedBuffer == NULL) {
                 mDownloadState->saveState(
                         uri,
                         itemMeta,
@@ -1371,7 +1734,18 @@ void PlaylistFetcher::onDownloadNext() {
         }
     } while (bytesRead != 0);
 
-    if (bufferStartsWithTsSyncByte(buffer)) {
+    if (mPartIndex >= 0 && !bufferStartsWithTsSyncByte(buffer)) {
+        // Only transport streams can be extracted a part at a time, wait
+        // for the segment to complete and download it whole.
+        ALOGW("partial segment is not a transport stream, "
+              "downloading whole segments");
+        mPartialSegmentsDisabled = true;
+        mPartIndex = -1;
+        postMonitorQueue(delayUsToRefreshPlaylist());
+        return;
+    }
+
+    if (mPartIndex < 0 && bufferStartsWithTsSyncByte(buffer)) {
         // If we don't see a stream in the program table after fetching a full ts segment
         // mark it as nonexistent.
         ATSParser::SourceType srcTypes[] =
@@ -1439,7 +1813,11 @@ void PlaylistFetcher::onDownloadNext() {
         return;
     }
 
-    ++mSeqNumber;
+    if (mPartIndex >= 0) {
+        ++mPartIndex;
+    } else {
+        ++mSeqNumber;
+    }
 
     // if adapting, pause after found the next starting point
     if (mSeekMode != LiveSession::kSeekModeExactPosition && startUp != mStartup) {
@@ -1510,6 +1888,7 @@ bool PlaylistFetcher::adjustSeqNumberWithAnchorTime(int64_t anchorTimeUs) {
     mSeqNumber = firstSeqNumberInPlaylist + index;
 
     if (mSeqNumber != oldSeqNumber) {
+        mPartIndex = -1;
         FLOGV("guessed wrong seg number: diff %lld out of [%lld, %lld]",
                 (long long) anchorTimeUs - mStartTimeUs,
                 (long long) minDiffUs,
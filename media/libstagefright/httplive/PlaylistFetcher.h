@@ -23,6 +23,8 @@
 #include "mpeg2ts/ATSParser.h"
 #include "LiveSession.h"
 
+#include <openssl/evp.h>
+
 namespace android {
 
 struct ABuffer;
@@ -31,11 +33,13 @@ class DataSource;
 struct HTTPBase;
 struct LiveDataSource;
 struct M3UParser;
+struct SegmentPrefetcher;
 class String8;
 
 struct PlaylistFetcher : public AHandler {
     static const int64_t kMinBufferedDurationUs;
     static const int32_t kDownloadBlockSize;
+    static const int32_t kDefaultPrefetchDepth;
     static const int64_t kFetcherResumeThreshold;
 
     enum {
@@ -100,7 +104,8 @@ protected:
         kWhatMonitorQueue   = 'moni',
         kWhatResumeUntil    = 'rsme',
         kWhatDownloadNext   = 'dlnx',
-        kWhatFetchPlaylist  = 'flst'
+        kWhatFetchPlaylist  = 'flst',
+        kWhatPrefetchedSegment = 'pfsg',
     };
 
     struct DownloadState;
@@ -116,6 +121,11 @@ protected:
     sp<AMessage> mStartTimeUsNotify;
 
     sp<HTTPDownloader> mHTTPDownloader;
+    sp<SegmentPrefetcher> mPrefetcher;
+    // Set while the download of the current segment waits for the
+    // prefetcher to hand it over, the reply is kept until it's picked up.
+    bool mPrefetchPending;
+    sp<AMessage> mPrefetchedSegment;
     sp<LiveSession> mSession;
     AString mURI;
 
@@ -142,6 +152,10 @@ protected:
     int64_t mPlaylistTimeUs;
     sp<M3UParser> mPlaylist;
     int32_t mSeqNumber;
+    // Next partial segment of mSeqNumber to download at the live edge of a
+    // low-latency playlist, or -1 while downloading whole segments.
+    int32_t mPartIndex;
+    bool mPartialSegmentsDisabled;
     int32_t mNumRetries;
     bool mStartup;
     bool mIDRFound;
@@ -171,10 +185,16 @@ protected:
     int64_t mSegmentFirstPTS;
     sp<AnotherPacketSource> mVideoBuffer;
 
-    // Stores the initialization vector to decrypt the next block of cipher text, which can
-    // either be derived from the sequence number, read from the manifest, or copied from
-    // the last block of cipher text (cipher-block chaining).
-    unsigned char mAESInitVec[16];
+    // CBC decryption state of the segment being downloaded. The key schedule
+    // is kept for as long as the key doesn't change, and the context carries
+    // the chaining IV from one downloaded block to the next.
+    EVP_CIPHER_CTX mAESContext;
+    AString mAESContextKeyURI;
+
+    // Cipher method and item meta of the segment being decrypted, looked up
+    // when its first block is decrypted.
+    AString mCipherMethod;
+    sp<AMessage> mCipherItemMeta;
 
     Mutex mThresholdLock;
     float mThresholdRatio;
@@ -185,8 +205,8 @@ protected:
 
     // Set first to true if decrypting the first segment of a playlist segment. When
     // first is true, reset the initialization vector based on the available
-    // information in the manifest; otherwise, use the initialization vector as
-    // updated by the last call to AES_cbc_encrypt.
+    // information in the manifest; otherwise, continue from the cipher state left
+    // by the previous call.
     //
     // For the input to decrypt correctly, decryptBuffer must be called on
     // consecutive byte ranges on block boundaries, e.g. 0..15, 16..47, 48..63,
@@ -194,6 +214,8 @@ protected:
     status_t decryptBuffer(
             size_t playlistIndex, const sp<ABuffer> &buffer,
             bool first = true);
+    void findCipherInfo(
+            size_t playlistIndex, AString *method, sp<AMessage> *itemMeta);
     status_t checkDecryptPadding(const sp<ABuffer> &buffer);
 
     void postMonitorQueue(int64_t delayUs = 0, int64_t minDelayUs = 0);
@@ -203,6 +225,7 @@ protected:
     float getStoppingThreshold();
     bool shouldPauseDownload();
 
+    bool isWaitingForPart() const;
     int64_t delayUsToRefreshPlaylist() const;
     status_t refreshPlaylist();
 
@@ -222,6 +245,16 @@ protected:
             sp<AMessage> &itemMeta,
             int32_t &firstSeqNumberInPlaylist,
             int32_t &lastSeqNumberInPlaylist);
+    void prefetchSegmentsAfter(
+            int32_t firstSeqNumberInPlaylist, int32_t lastSeqNumberInPlaylist);
+    bool canFetchPartsOf(
+            int32_t seqNumber, int32_t firstSeqNumberInPlaylist);
+    bool selectPartialSegment(
+            AString &uri,
+            sp<AMessage> &itemMeta,
+            int32_t firstSeqNumberInPlaylist,
+            int32_t lastSeqNumberInPlaylist,
+            bool *wait);
 
     // Resume a fetcher to continue until the stopping point stored in msg.
     status_t onResumeUntil(const sp<AMessage> &msg);
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcher"
+#include <utils/Log.h>
+
+#include "SegmentPrefetcher.h"
+#include "HTTPDownloader.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+SegmentPrefetcher::SegmentPrefetcher(
+        const sp<HTTPDownloader> &downloader, size_t depth)
+    : mHTTPDownloader(downloader),
+      mDepth(depth),
+      mFetchPending(false),
+      mNumActiveDownloads(0),
+      mNumDownloadsStarted(0) {
+}
+
+SegmentPrefetcher::~SegmentPrefetcher() {
+}
+
+void SegmentPrefetcher::start() {
+    mLooper = new ALooper;
+    mLooper->setName("segment prefetcher");
+    mLooper->start();
+    mLooper->registerHandler(this);
+}
+
+void SegmentPrefetcher::stop() {
+    flush();
+    disconnect();
+
+    if (mLooper != NULL) {
+        mLooper->unregisterHandler(id());
+        mLooper->stop();
+        mLooper.clear();
+    }
+}
+
+void SegmentPrefetcher::prefetch(
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mSegments.size() >= mDepth) {
+        return;
+    }
+
+    for (List<Segment>::iterator it = mSegments.begin();
+            it != mSegments.end(); ++it) {
+        if (it->mURI == uri
+                && it->mRangeOffset == rangeOffset
+                && it->mRangeLength == rangeLength) {
+            return;
+        }
+    }
+
+    ALOGV("queueing '%s' @%lld", uri.c_str(), (long long)rangeOffset);
+
+    Segment segment;
+    segment.mURI = uri;
+    segment.mRangeOffset = rangeOffset;
+    segment.mRangeLength = rangeLength;
+    segment.mState = PENDING;
+    segment.mFetchTimeUs = -1ll;
+    segment.mExclusive = false;
+    mSegments.push_back(segment);
+
+    postFetchNext_l();
+}
+
+bool SegmentPrefetcher::takeSegment(
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+        const sp<AMessage> &reply) {
+    Mutex::Autolock autoLock(mLock);
+
+    List<Segment>::iterator it = mSegments.begin();
+    while (it != mSegments.end()
+            && (it->mURI != uri
+                || it->mRangeOffset != rangeOffset
+                || it->mRangeLength != rangeLength)) {
+        ++it;
+    }
+
+    if (it == mSegments.end()) {
+        // Not what we expected the fetcher to ask for next, everything
+        // queued is likely stale.
+        mSegments.clear();
+        return false;
+    }
+
+    // Anything queued before this segment has been skipped.
+    while (mSegments.begin() != it) {
+        mSegments.erase(mSegments.begin());
+    }
+
+    if (it->mState == PENDING) {
+        // Not started yet, the caller is better off fetching it directly.
+        mSegments.erase(it);
+        postFetchNext_l();
+        return false;
+    }
+
+    it->mReply = reply;
+    if (it->mState == FETCHING) {
+        // onFetchNext() replies once the download is done.
+        return true;
+    }
+
+    postReply_l(*it);
+
+    mSegments.erase(it);
+    postFetchNext_l();
+
+    return true;
+}
+
+void SegmentPrefetcher::flush() {
+    Mutex::Autolock autoLock(mLock);
+
+    mSegments.clear();
+}
+
+void SegmentPrefetcher::beginDownload() {
+    Mutex::Autolock autoLock(mLock);
+
+    beginDownload_l(&mDownload);
+}
+
+bool SegmentPrefetcher::endDownload() {
+    Mutex::Autolock autoLock(mLock);
+
+    return endDownload_l(mDownload);
+}
+
+void SegmentPrefetcher::beginDownload_l(Download *download) {
+    download->mOverlapped = (mNumActiveDownloads > 0);
+    download->mStartCount = ++mNumDownloadsStarted;
+    ++mNumActiveDownloads;
+}
+
+bool SegmentPrefetcher::endDownload_l(const Download &download) {
+    CHECK_GT(mNumActiveDownloads, 0u);
+    --mNumActiveDownloads;
+
+    return !download.mOverlapped
+            && download.mStartCount == mNumDownloadsStarted;
+}
+
+void SegmentPrefetcher::disconnect() {
+    mHTTPDownloader->disconnect();
+}
+
+void SegmentPrefetcher::reconnect() {
+    mHTTPDownloader->reconnect();
+}
+
+void SegmentPrefetcher::postFetchNext_l() {
+    if (mFetchPending || mLooper == NULL) {
+        return;
+    }
+
+    for (List<Segment>::iterator it = mSegments.begin();
+            it != mSegments.end(); ++it) {
+        if (it->mState == PENDING) {
+            (new AMessage(kWhatFetchNext, this))->post();
+            mFetchPending = true;
+            return;
+        }
+    }
+}
+
+void SegmentPrefetcher::postReply_l(const Segment &segment) {
+    sp<AMessage> reply = segment.mReply;
+    if (segment.mState == FETCHED) {
+        reply->setBuffer("buffer", segment.mBuffer);
+    }
+    reply->setInt64("fetchTimeUs", segment.mFetchTimeUs);
+    reply->setInt32("exclusive", segment.mExclusive);
+    reply->post();
+}
+
+void SegmentPrefetcher::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatFetchNext:
+        {
+            onFetchNext();
+            break;
+        }
+
+        default:
+            TRESPASS();
+    }
+}
+
+void SegmentPrefetcher::onFetchNext() {
+    AString uri;
+    int64_t rangeOffset, rangeLength;
+    Download download;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        List<Segment>::iterator it = mSegments.begin();
+        while (it != mSegments.end() && it->mState != PENDING) {
+            ++it;
+        }
+
+        if (it == mSegments.end()) {
+            mFetchPending = false;
+            return;
+        }
+
+        // mFetchPending stays set until this download completes, so that
+        // segments are fetched one at a time over our single connection.
+        it->mState = FETCHING;
+        uri = it->mURI;
+        rangeOffset = it->mRangeOffset;
+        rangeLength = it->mRangeLength;
+
+        beginDownload_l(&download);
+    }
+
+    sp<ABuffer> buffer;
+    int64_t startUs = ALooper::GetNowUs();
+    ssize_t bytesRead = mHTTPDownloader->fetchBlock(
+            uri.c_str(), &buffer, rangeOffset, rangeLength,
+            0 /* block_size */, NULL /* actualURL */, true /* reconnect */);
+    int64_t fetchTimeUs = ALooper::GetNowUs() - startUs;
+
+    if (bytesRead < 0) {
+        ALOGW("failed to prefetch '%s' (%zd)", uri.c_str(), bytesRead);
+    } else {
+        ALOGV("prefetched '%s' @%lld, %zd bytes in %lld us",
+              uri.c_str(), (long long)rangeOffset, bytesRead,
+              (long long)fetchTimeUs);
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    mFetchPending = false;
+    bool exclusive = endDownload_l(download);
+
+    // The segment may have been flushed in the meantime.
+    for (List<Segment>::iterator it = mSegments.begin();
+            it != mSegments.end(); ++it) {
+        if (it->mState == FETCHING
+                && it->mURI == uri
+                && it->mRangeOffset == rangeOffset
+                && it->mRangeLength == rangeLength) {
+            if (bytesRead >= 0 && buffer != NULL) {
+                it->mState = FETCHED;
+                it->mBuffer = buffer;
+                it->mFetchTimeUs = fetchTimeUs;
+                it->mExclusive = exclusive;
+            } else {
+                it->mState = FAILED;
+            }
+
+            if (it->mReply != NULL) {
+                postReply_l(*it);
+                mSegments.erase(it);
+            }
+            break;
+        }
+    }
+
+    postFetchNext_l();
+}
+
+}  // namespace android
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SEGMENT_PREFETCHER_H_
+
+#define SEGMENT_PREFETCHER_H_
+
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/List.h>
+#include <utils/Mutex.h>
+
+namespace android {
+
+struct ABuffer;
+struct ALooper;
+struct HTTPDownloader;
+
+// Downloads the segments following the one a PlaylistFetcher is currently
+// parsing on a separate connection and looper, so that the network fetch of
+// segment N+1 overlaps with the parsing and decryption of segment N.
+//
+// Segments are identified by their URI and byte range, and are fetched one
+// at a time in the order they were requested, up to a fixed pipeline depth.
+//
+// A download that overlaps with another one, prefetched or made by the
+// fetcher over its own connection, shares the bandwidth with it and is
+// flagged so that it can be left out of the bandwidth estimate.
+struct SegmentPrefetcher : public AHandler {
+    SegmentPrefetcher(const sp<HTTPDownloader> &downloader, size_t depth);
+
+    void start();
+    void stop();
+
+    size_t getDepth() const { return mDepth; }
+
+    // Queues a segment for download, unless the pipeline is full or the
+    // segment has been queued already.
+    void prefetch(
+            const AString &uri, int64_t rangeOffset, int64_t rangeLength);
+
+    // Returns false if the given segment was never queued or its download
+    // has not started yet, in which case the caller should fetch it itself.
+    // Otherwise |reply| is posted once the download has finished, or right
+    // away if it already has, with the content in "buffer" (absent if the
+    // download failed), the time it took in "fetchTimeUs" and whether it
+    // had the network to itself in "exclusive". Segments queued before
+    // this one are discarded.
+    bool takeSegment(
+            const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+            const sp<AMessage> &reply);
+
+    // Discards all queued and downloaded segments. Replies still waiting
+    // for a download are dropped.
+    void flush();
+
+    // Bracket a download the caller makes over its own connection. The
+    // latter returns false if it overlapped with a prefetch.
+    void beginDownload();
+    bool endDownload();
+
+    void disconnect();
+    void reconnect();
+
+protected:
+    virtual ~SegmentPrefetcher();
+    virtual void onMessageReceived(const sp<AMessage> &msg);
+
+private:
+    enum {
+        kWhatFetchNext = 'fnxt',
+    };
+
+    enum State {
+        PENDING,
+        FETCHING,
+        FETCHED,
+        FAILED,
+    };
+
+    // Downloads that started or were in progress while one was running
+    // mark it as overlapped.
+    struct Download {
+        uint32_t mStartCount;
+        bool mOverlapped;
+    };
+
+    struct Segment {
+        AString mURI;
+        int64_t mRangeOffset;
+        int64_t mRangeLength;
+        State mState;
+        sp<ABuffer> mBuffer;
+        int64_t mFetchTimeUs;
+        bool mExclusive;
+        sp<AMessage> mReply;
+    };
+
+    sp<ALooper> mLooper;
+    sp<HTTPDownloader> mHTTPDownloader;
+    const size_t mDepth;
+
+    Mutex mLock;
+    List<Segment> mSegments;
+    bool mFetchPending;
+
+    size_t mNumActiveDownloads;
+    uint32_t mNumDownloadsStarted;
+    Download mDownload;
+
+    void beginDownload_l(Download *download);
+    bool endDownload_l(const Download &download);
+
+    void postFetchNext_l();
+    void postReply_l(const Segment &segment);
+    void onFetchNext();
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentPrefetcher);
+};
+
+}  // namespace android
+
+#endif  // SEGMENT_PREFETCHER_H_
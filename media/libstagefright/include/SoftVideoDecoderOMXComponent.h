@@ -45,7 +45,7 @@ struct SoftVideoDecoderOMXComponent : public SimpleSoftOMXComponent {
 
 protected:
     enum {
-        kDescribeColorAspectsIndex = kPrepareForAdaptivePlaybackIndex + 1,
+        kDescribeColorAspectsIndex = kMultiFrameBuffersIndex + 1,
     };
 
     enum {
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef X86_CPU_FEATURES_H_
+
+#define X86_CPU_FEATURES_H_
+
+// Runtime checks for the x86 extensions that the Android x86 ABIs do not
+// include, shared by the software codecs. C and C++.
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#include <cpuid.h>
+
+// Nonzero when the CPU has SSE4.1. cpuid is read on the first call only.
+static inline int x86_has_sse41(void) {
+#if defined(__SSE4_1__)
+    return 1;
+#else
+    static int hasSSE41 = -1;
+
+    int has = __atomic_load_n(&hasSSE41, __ATOMIC_RELAXED);
+    if (has < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        has = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1);
+        __atomic_store_n(&hasSSE41, has, __ATOMIC_RELAXED);
+    }
+    return has;
+#endif
+}
+
+#endif  // __i386__ || __x86_64__
+
+#endif  // X86_CPU_FEATURES_H_
@@ -27,6 +27,8 @@
 #include <media/stagefright/foundation/ABitReader.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandlerReflector.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/MediaDefs.h>
@@ -34,7 +36,9 @@
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
 #include <media/IStreamSource.h>
+#include <utils/Condition.h>
 #include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
 #include <utils/Vector.h>
 
 #include <inttypes.h>
@@ -48,6 +52,10 @@ namespace android {
 
 static const size_t kTSPacketSize = 188;
 
+// Maximum number of TS packets queued to a program worker before
+// feedTSPacket() blocks in PARALLEL_DEMUX mode.
+static const size_t kMaxPendingWorkerPackets = 4096;
+
 struct ATSParser::Program : public RefBase {
     Program(ATSParser *parser, unsigned programNumber, unsigned programMapPID,
             int64_t lastRecoveredPTS);
@@ -74,6 +82,7 @@ struct ATSParser::Program : public RefBase {
     int64_t convertPTSToTimestamp(uint64_t PTS);
 
     bool PTSTimeDeltaEstablished() const {
+        Mutex::Autolock autoLock(mLock);
         return mFirstPTSValid;
     }
 
@@ -91,12 +100,60 @@ struct ATSParser::Program : public RefBase {
         return mParser->mFlags;
     }
 
+    // PARALLEL_DEMUX support. Once the worker is started, parsePID() queues
+    // elementary stream packets to the worker looper instead of parsing them.
+    void startWorker();
+    void stopWorker();
+    // Wait until all packets queued to the worker have been parsed. Returns
+    // the first error the worker ran into, see mWorkerError.
+    status_t flushWorker();
+
+    void onMessageReceived(const sp<AMessage> &msg);
+
 private:
     struct StreamInfo {
         unsigned mType;
         unsigned mPID;
     };
 
+    // The payload of a TS packet queued to the worker.
+    struct PendingPacket {
+        unsigned mPID;
+        unsigned mContinuityCounter;
+        unsigned mPayloadUnitStart;
+        size_t mSize;
+        uint8_t mData[kTSPacketSize];
+    };
+
+    enum {
+        kWhatDrain      = 'drai',
+    };
+
+    // Held while parsing stream data or changing mStreams. The worker looper
+    // and the thread feeding the parser both take it in PARALLEL_DEMUX mode.
+    mutable Mutex mLock;
+
+    sp<ALooper> mWorkerLooper;
+    sp<AHandlerReflector<Program> > mWorkerReflector;
+
+    // Packets are handed to the worker in batches. A kWhatDrain message is
+    // only posted while the worker is idle; a busy worker picks up whatever
+    // was queued in the meantime before it goes idle again.
+    Mutex mPendingLock;
+    Condition mPendingCondition;
+    Vector<PendingPacket> mPendingPackets;
+    size_t mNumUnparsedPackets;  // queued or being parsed by the worker
+    bool mDrainPending;
+    // The first error returned by Stream::parse() on the worker. It is sticky:
+    // the worker stops parsing and parsePID() returns it from then on, like
+    // the error the caller would have seen when parsing inline.
+    status_t mWorkerError;
+
+    void queuePacket(
+            unsigned pid, unsigned continuity_counter,
+            unsigned payload_unit_start_indicator, ABitReader *br);
+    void drainPackets();
+
     ATSParser *mParser;
     unsigned mProgramNumber;
     unsigned mProgramMapPID;
@@ -224,7 +281,10 @@ void ATSParser::SyncEvent::reset() {
 ATSParser::Program::Program(
         ATSParser *parser, unsigned programNumber, unsigned programMapPID,
         int64_t lastRecoveredPTS)
-    : mParser(parser),
+    : mNumUnparsedPackets(0),
+      mDrainPending(false),
+      mWorkerError(OK),
+      mParser(parser),
       mProgramNumber(programNumber),
       mProgramMapPID(programMapPID),
       mFirstPTSValid(false),
@@ -233,6 +293,131 @@ ATSParser::Program::Program(
     ALOGV("new program number %u", programNumber);
 }
 
+void ATSParser::Program::startWorker() {
+    if (mWorkerLooper != NULL) {
+        return;
+    }
+
+    AString name = AStringPrintf("TSProgram%u", mProgramNumber);
+    mWorkerLooper = new ALooper;
+    mWorkerLooper->setName(name.c_str());
+    mWorkerLooper->start();
+
+    mWorkerReflector = new AHandlerReflector<Program>(this);
+    mWorkerLooper->registerHandler(mWorkerReflector);
+}
+
+void ATSParser::Program::stopWorker() {
+    if (mWorkerLooper == NULL) {
+        return;
+    }
+
+    mWorkerLooper->unregisterHandler(mWorkerReflector->id());
+    mWorkerLooper->stop();
+    mWorkerLooper.clear();
+    mWorkerReflector.clear();
+
+    Mutex::Autolock autoLock(mPendingLock);
+    mPendingPackets.clear();
+    mNumUnparsedPackets = 0;
+    mDrainPending = false;
+    mPendingCondition.broadcast();
+}
+
+status_t ATSParser::Program::flushWorker() {
+    if (mWorkerLooper == NULL) {
+        return OK;
+    }
+
+    Mutex::Autolock autoLock(mPendingLock);
+    while (mNumUnparsedPackets > 0) {
+        mPendingCondition.wait(mPendingLock);
+    }
+
+    return mWorkerError;
+}
+
+void ATSParser::Program::queuePacket(
+        unsigned pid, unsigned continuity_counter,
+        unsigned payload_unit_start_indicator, ABitReader *br) {
+    Mutex::Autolock autoLock(mPendingLock);
+    while (mNumUnparsedPackets >= kMaxPendingWorkerPackets) {
+        mPendingCondition.wait(mPendingLock);
+    }
+
+    mPendingPackets.push();
+    PendingPacket *packet = &mPendingPackets.editTop();
+    packet->mPID = pid;
+    packet->mContinuityCounter = continuity_counter;
+    packet->mPayloadUnitStart = payload_unit_start_indicator;
+    packet->mSize = br->numBitsLeft() / 8;
+    memcpy(packet->mData, br->data(), packet->mSize);
+    ++mNumUnparsedPackets;
+
+    if (!mDrainPending) {
+        mDrainPending = true;
+        (new AMessage(kWhatDrain, mWorkerReflector))->post();
+    }
+}
+
+void ATSParser::Program::drainPackets() {
+    Vector<PendingPacket> packets;
+    status_t err = OK;
+
+    for (;;) {
+        {
+            Mutex::Autolock autoLock(mPendingLock);
+            mNumUnparsedPackets -= packets.size();
+            if (err != OK && mWorkerError == OK) {
+                mWorkerError = err;
+            }
+            mPendingCondition.broadcast();
+
+            if (mPendingPackets.empty()) {
+                mDrainPending = false;
+                return;
+            }
+
+            // Shares the storage, the queue gets a new one on its next push.
+            packets = mPendingPackets;
+            mPendingPackets.clear();
+            err = mWorkerError;
+        }
+
+        for (size_t i = 0; err == OK && i < packets.size(); ++i) {
+            const PendingPacket &packet = packets.itemAt(i);
+
+            Mutex::Autolock autoLock(mLock);
+            ssize_t index = mStreams.indexOfKey(packet.mPID);
+            if (index < 0) {
+                continue;
+            }
+
+            ABitReader br(packet.mData, packet.mSize);
+            err = mStreams.editValueAt(index)->parse(
+                    packet.mContinuityCounter, packet.mPayloadUnitStart, &br,
+                    NULL /* event */);
+            if (err != OK) {
+                ALOGE("program %u failed to parse PID 0x%04x (%d)",
+                      mProgramNumber, packet.mPID, err);
+            }
+        }
+    }
+}
+
+void ATSParser::Program::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatDrain:
+        {
+            drainPackets();
+            break;
+        }
+
+        default:
+            TRESPASS();
+    }
+}
+
 bool ATSParser::Program::parsePSISection(
         unsigned pid, ABitReader *br, status_t *err) {
     *err = OK;
@@ -252,6 +437,27 @@ bool ATSParser::Program::parsePID(
         ABitReader *br, status_t *err, SyncEvent *event) {
     *err = OK;
 
+    if (mWorkerLooper != NULL) {
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (mStreams.indexOfKey(pid) < 0) {
+                return false;
+            }
+        }
+
+        {
+            Mutex::Autolock autoLock(mPendingLock);
+            *err = mWorkerError;
+        }
+
+        if (*err == OK) {
+            queuePacket(
+                    pid, continuity_counter, payload_unit_start_indicator, br);
+        }
+        return true;
+    }
+
+    Mutex::Autolock autoLock(mLock);
     ssize_t index = mStreams.indexOfKey(pid);
     if (index < 0) {
         return false;
@@ -265,6 +471,7 @@ bool ATSParser::Program::parsePID(
 
 void ATSParser::Program::signalDiscontinuity(
         DiscontinuityType type, const sp<AMessage> &extra) {
+    Mutex::Autolock autoLock(mLock);
     int64_t mediaTimeUs;
     if ((type & DISCONTINUITY_TIME)
             && extra != NULL
@@ -279,6 +486,7 @@ void ATSParser::Program::signalDiscontinuity(
 }
 
 void ATSParser::Program::signalEOS(status_t finalResult) {
+    Mutex::Autolock autoLock(mLock);
     for (size_t i = 0; i < mStreams.size(); ++i) {
         mStreams.editValueAt(i)->signalEOS(finalResult);
     }
@@ -447,18 +655,34 @@ status_t ATSParser::Program::parseProgramMap(ABitReader *br) {
     MY_LOGV("  CRC = 0x%08x", br->getBits(32));
 
     bool PIDsChanged = false;
-    for (size_t i = 0; i < infos.size(); ++i) {
-        StreamInfo &info = infos.editItemAt(i);
+    {
+        Mutex::Autolock autoLock(mLock);
+        for (size_t i = 0; i < infos.size(); ++i) {
+            StreamInfo &info = infos.editItemAt(i);
 
-        ssize_t index = mStreams.indexOfKey(info.mPID);
+            ssize_t index = mStreams.indexOfKey(info.mPID);
 
-        if (index >= 0 && mStreams.editValueAt(index)->type() != info.mType) {
-            ALOGI("uh oh. stream PIDs have changed.");
-            PIDsChanged = true;
-            break;
+            if (index >= 0
+                    && mStreams.editValueAt(index)->type() != info.mType) {
+                ALOGI("uh oh. stream PIDs have changed.");
+                PIDsChanged = true;
+                break;
+            }
         }
     }
 
+    if (PIDsChanged) {
+        // Packets the worker still holds were queued under the old PIDs and
+        // belong to the streams those PIDs map to now, parse them before the
+        // streams are moved to their new PIDs.
+        status_t err = flushWorker();
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
     if (PIDsChanged) {
 #if 0
         ALOGI("before:");
@@ -528,6 +752,7 @@ int64_t ATSParser::Program::recoverPTS(uint64_t PTS_33bit) {
 }
 
 sp<MediaSource> ATSParser::Program::getSource(SourceType type) {
+    Mutex::Autolock autoLock(mLock);
     for (size_t i = 0; i < mStreams.size(); ++i) {
         sp<MediaSource> source = mStreams.editValueAt(i)->getSource(type);
         if (source != NULL) {
@@ -539,6 +764,7 @@ sp<MediaSource> ATSParser::Program::getSource(SourceType type) {
 }
 
 bool ATSParser::Program::hasSource(SourceType type) const {
+    Mutex::Autolock autoLock(mLock);
     for (size_t i = 0; i < mStreams.size(); ++i) {
         const sp<Stream> &stream = mStreams.valueAt(i);
         if (type == AUDIO && stream->isAudio()) {
@@ -1185,6 +1411,25 @@ ATSParser::ATSParser(uint32_t flags)
 }
 
 ATSParser::~ATSParser() {
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.editItemAt(i)->stopWorker();
+    }
+}
+
+status_t ATSParser::flushWorkers() {
+    if (!(mFlags & PARALLEL_DEMUX)) {
+        return OK;
+    }
+
+    status_t result = OK;
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        status_t err = mPrograms.editItemAt(i)->flushWorker();
+        if (err != OK && result == OK) {
+            result = err;
+        }
+    }
+
+    return result;
 }
 
 status_t ATSParser::feedTSPacket(const void *data, size_t size,
@@ -1200,6 +1445,12 @@ status_t ATSParser::feedTSPacket(const void *data, size_t size,
 
 void ATSParser::signalDiscontinuity(
         DiscontinuityType type, const sp<AMessage> &extra) {
+    // Workers read the time anchor and offset below when converting PTS.
+    status_t err = flushWorkers();
+    if (err != OK) {
+        ALOGW("discontinuity after a parse error (%d)", err);
+    }
+
     int64_t mediaTimeUs;
     if ((type & DISCONTINUITY_TIME) && extra != NULL) {
         if (extra->findInt64(IStreamListener::kKeyMediaTimeUs, &mediaTimeUs)) {
@@ -1252,6 +1503,12 @@ void ATSParser::signalEOS(status_t finalResult) {
         return;
     }
 
+    // A parse error the caller hasn't seen yet ends the streams instead.
+    status_t err = flushWorkers();
+    if (err != OK) {
+        finalResult = err;
+    }
+
     for (size_t i = 0; i < mPrograms.size(); ++i) {
         mPrograms.editItemAt(i)->signalEOS(finalResult);
     }
@@ -1307,8 +1564,12 @@ void ATSParser::parseProgramAssociationTable(ABitReader *br) {
             }
 
             if (!found) {
-                mPrograms.push(
-                        new Program(this, program_number, programMapPID, mLastRecoveredPTS));
+                sp<Program> program =
+                        new Program(this, program_number, programMapPID, mLastRecoveredPTS);
+                if (mFlags & PARALLEL_DEMUX) {
+                    program->startWorker();
+                }
+                mPrograms.push(program);
             }
 
             if (mPSISections.indexOfKey(programMapPID) < 0) {
@@ -60,6 +60,14 @@ struct ATSParser : public RefBase {
         TS_TIMESTAMPS_ARE_ABSOLUTE = 1,
         // Video PES packets contain exactly one (aligned) access unit.
         ALIGNED_VIDEO_DATA         = 2,
+        // Elementary stream packets are handed off to a worker looper per
+        // program, which does PES reassembly and access unit extraction in
+        // parallel with the caller of feedTSPacket(). Packets of a stream are
+        // still parsed in order. SyncEvents are not reported in this mode,
+        // and a parse error on a worker is returned from the next
+        // feedTSPacket() call for that program instead of the current one.
+        // signalEOS() ends the streams with it if it wasn't returned yet.
+        PARALLEL_DEMUX             = 4,
     };
 
     // Event is used to signal sync point event at feedTSPacket().
@@ -185,6 +193,10 @@ private:
 
     void updatePCR(unsigned PID, uint64_t PCR, uint64_t byteOffsetFromStart);
 
+    // In PARALLEL_DEMUX mode, wait until all queued packets have been parsed.
+    // Returns the first error a worker ran into.
+    status_t flushWorkers();
+
     uint64_t mPCR[2];
     uint64_t mPCRBytes[2];
     int64_t mSystemTimeUs[2];
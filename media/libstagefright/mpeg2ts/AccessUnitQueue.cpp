@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AccessUnitQueue"
+#include <utils/Log.h>
+
+#include "AccessUnitQueue.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/Utils.h>
+
+namespace android {
+
+// Dequeued entries are dropped once there are at least this many of them
+// and they make up half of the vector.
+static const size_t kMinCompactSize = 32;
+
+AccessUnitQueue::AccessUnitQueue()
+    : mHead(0),
+      mHeadPosition(0),
+      mTrimPointsHead(0),
+      mNumDataUnits(0) {
+}
+
+const AccessUnitQueue::Entry &AccessUnitQueue::entryAt(size_t index) const {
+    return mEntries.itemAt(mHead + index);
+}
+
+const sp<ABuffer> &AccessUnitQueue::front() const {
+    CHECK(!empty());
+    return entryAt(0).mBuffer;
+}
+
+const sp<ABuffer> &AccessUnitQueue::itemAt(size_t index) const {
+    return entryAt(index).mBuffer;
+}
+
+bool AccessUnitQueue::isDiscontinuityAt(size_t index) const {
+    return entryAt(index).mIsDiscontinuity;
+}
+
+void AccessUnitQueue::appendEntry(
+        const sp<ABuffer> &buffer, bool isTrimPoint) {
+    Entry entry;
+    entry.mBuffer = buffer;
+
+    int32_t discontinuity;
+    entry.mIsDiscontinuity =
+        buffer->meta()->findInt32("discontinuity", &discontinuity);
+    entry.mIsTrimPoint = isTrimPoint && !entry.mIsDiscontinuity;
+
+    if (!empty()) {
+        const Entry &prev = entryAt(size() - 1);
+        entry.mHasMaxKey = prev.mHasMaxKey;
+        entry.mMaxKey = prev.mMaxKey;
+        entry.mCompletedUs = prev.mCompletedUs;
+        entry.mSegmentFirstUs = prev.mSegmentFirstUs;
+        entry.mSegmentMaxUs = prev.mSegmentMaxUs;
+        entry.mMarkersBefore =
+            prev.mMarkersBefore + (prev.mIsDiscontinuity ? 1 : 0);
+    }
+
+    if (entry.mIsDiscontinuity) {
+        // Close the current discontinuity segment.
+        entry.mCompletedUs = entry.bufferedUs();
+        entry.mSegmentFirstUs = -1;
+        entry.mSegmentMaxUs = -1;
+    } else {
+        Key key;
+        if (!buffer->meta()->findInt32("discontinuitySeq", &key.mSeq)) {
+            key.mSeq = 0;
+        }
+        CHECK(buffer->meta()->findInt64("timeUs", &key.mTimeUs));
+
+        if (!entry.mHasMaxKey || entry.mMaxKey < key) {
+            entry.mMaxKey = key;
+            entry.mHasMaxKey = true;
+        }
+
+        if (entry.mSegmentFirstUs < 0) {
+            entry.mSegmentFirstUs = key.mTimeUs;
+            entry.mSegmentMaxUs = key.mTimeUs;
+        } else if (key.mTimeUs > entry.mSegmentMaxUs) {
+            entry.mSegmentMaxUs = key.mTimeUs;
+        }
+
+        if (entry.mIsTrimPoint) {
+            TrimPoint trimPoint;
+            trimPoint.mPosition = mHeadPosition + size();
+            trimPoint.mMaxKey = key;
+            if (mTrimPoints.size() > mTrimPointsHead) {
+                const TrimPoint &last = mTrimPoints.itemAt(mTrimPoints.size() - 1);
+                if (key < last.mMaxKey) {
+                    trimPoint.mMaxKey = last.mMaxKey;
+                }
+            }
+            mTrimPoints.push_back(trimPoint);
+        }
+
+        ++mNumDataUnits;
+    }
+
+    mEntries.push_back(entry);
+}
+
+void AccessUnitQueue::pushBack(const sp<ABuffer> &buffer, bool isTrimPoint) {
+    appendEntry(buffer, isTrimPoint);
+}
+
+void AccessUnitQueue::pushFront(const sp<ABuffer> &buffer, bool isTrimPoint) {
+    // The running values of all following units depend on this one, so
+    // they have to be recomputed. Only used to put back a unit that was
+    // just dequeued, on queues that are short.
+    Vector<Entry> entries;
+    entries.setCapacity(size() + 1);
+
+    Entry entry;
+    entry.mBuffer = buffer;
+    entry.mIsTrimPoint = isTrimPoint;
+    entries.push_back(entry);
+
+    for (size_t i = 0; i < size(); ++i) {
+        entries.push_back(entryAt(i));
+    }
+
+    rebuild(entries);
+}
+
+void AccessUnitQueue::popFront() {
+    CHECK(!empty());
+
+    Entry &entry = mEntries.editItemAt(mHead);
+    if (!entry.mIsDiscontinuity) {
+        --mNumDataUnits;
+    }
+    if (mTrimPoints.size() > mTrimPointsHead
+            && mTrimPoints.itemAt(mTrimPointsHead).mPosition == mHeadPosition) {
+        ++mTrimPointsHead;
+    }
+    entry.mBuffer.clear();
+
+    ++mHead;
+    ++mHeadPosition;
+
+    if (empty()) {
+        clear();
+    } else {
+        compact();
+    }
+}
+
+void AccessUnitQueue::compact() {
+    if (mHead >= kMinCompactSize && mHead * 2 >= mEntries.size()) {
+        mEntries.removeItemsAt(0, mHead);
+        mHead = 0;
+    }
+
+    if (mTrimPointsHead >= kMinCompactSize
+            && mTrimPointsHead * 2 >= mTrimPoints.size()) {
+        mTrimPoints.removeItemsAt(0, mTrimPointsHead);
+        mTrimPointsHead = 0;
+    }
+}
+
+void AccessUnitQueue::clear() {
+    mEntries.clear();
+    mHead = 0;
+    mHeadPosition = 0;
+    mTrimPoints.clear();
+    mTrimPointsHead = 0;
+    mNumDataUnits = 0;
+}
+
+void AccessUnitQueue::clearDataUnits() {
+    Vector<Entry> entries;
+    for (size_t i = 0; i < size(); ++i) {
+        if (entryAt(i).mIsDiscontinuity) {
+            entries.push_back(entryAt(i));
+        }
+    }
+
+    rebuild(entries);
+}
+
+void AccessUnitQueue::rebuild(const Vector<Entry> &entries) {
+    clear();
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        appendEntry(entries.itemAt(i).mBuffer, entries.itemAt(i).mIsTrimPoint);
+    }
+}
+
+size_t AccessUnitQueue::findBufferedDuration(int64_t durationUs) const {
+    if (empty()) {
+        return 0;
+    }
+
+    int64_t targetUs = entryAt(0).bufferedUs() + durationUs;
+
+    size_t lo = 0;
+    size_t hi = size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entryAt(mid).bufferedUs() < targetUs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    while (lo < size() && entryAt(lo).mIsDiscontinuity) {
+        ++lo;
+    }
+
+    return lo;
+}
+
+size_t AccessUnitQueue::findFirstNotBefore(const HLSTime &time) const {
+    Key key;
+    key.mSeq = time.mSeq;
+    key.mTimeUs = time.mTimeUs;
+
+    size_t lo = 0;
+    size_t hi = size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const Entry &entry = entryAt(mid);
+        if (!entry.mHasMaxKey || entry.mMaxKey < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    while (lo < size() && entryAt(lo).mIsDiscontinuity) {
+        ++lo;
+    }
+
+    return lo;
+}
+
+size_t AccessUnitQueue::findFirstTrimPointAfter(const HLSTime &time) const {
+    Key key;
+    key.mSeq = time.mSeq;
+    key.mTimeUs = time.mTimeUs;
+
+    size_t lo = mTrimPointsHead;
+    size_t hi = mTrimPoints.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!(key < mTrimPoints.itemAt(mid).mMaxKey)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == mTrimPoints.size()) {
+        return size();
+    }
+
+    return mTrimPoints.itemAt(lo).mPosition - mHeadPosition;
+}
+
+ssize_t AccessUnitQueue::findLastDataUnitBefore(size_t index) const {
+    while (index > 0) {
+        --index;
+        if (!entryAt(index).mIsDiscontinuity) {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+size_t AccessUnitQueue::countDiscontinuitiesBefore(size_t index) const {
+    if (index == 0) {
+        return 0;
+    }
+
+    const Entry &last = entryAt(index - 1);
+    return last.mMarkersBefore + (last.mIsDiscontinuity ? 1 : 0)
+            - entryAt(0).mMarkersBefore;
+}
+
+void AccessUnitQueue::eraseFront(size_t index) {
+    if (index >= size()) {
+        clear();
+        return;
+    }
+
+    for (; index > 0; --index) {
+        popFront();
+    }
+}
+
+void AccessUnitQueue::eraseBack(size_t index) {
+    if (index == 0) {
+        clear();
+        return;
+    }
+
+    if (index >= size()) {
+        return;
+    }
+
+    for (size_t i = index; i < size(); ++i) {
+        if (!entryAt(i).mIsDiscontinuity) {
+            --mNumDataUnits;
+        }
+    }
+
+    size_t endPosition = mHeadPosition + index;
+    while (mTrimPoints.size() > mTrimPointsHead
+            && mTrimPoints.itemAt(mTrimPoints.size() - 1).mPosition >= endPosition) {
+        mTrimPoints.pop();
+    }
+
+    mEntries.removeItemsAt(mHead + index, size() - index);
+}
+
+}  // namespace android
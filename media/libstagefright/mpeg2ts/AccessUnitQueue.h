@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ACCESS_UNIT_QUEUE_H_
+
+#define ACCESS_UNIT_QUEUE_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+struct HLSTime;
+
+// Queue of access units and discontinuity markers used by
+// AnotherPacketSource. Alongside the buffers it maintains, as units are
+// queued, the running maximum timestamp, the running buffered duration and
+// the positions of the units that a stream may be trimmed to, so that
+// locating a time or a buffered duration in the queue is a binary search
+// rather than a walk over every unit.
+//
+// The running values are accumulated from the oldest unit that was in the
+// queue when it was last empty. They match a walk from the head of the
+// queue as long as the units already dequeued precede those searched for,
+// which holds for the forward-moving timestamps of a stream.
+struct AccessUnitQueue {
+    AccessUnitQueue();
+
+    bool empty() const { return size() == 0; }
+    size_t size() const { return mEntries.size() - mHead; }
+
+    // Number of queued units that are not discontinuity markers.
+    size_t numDataUnits() const { return mNumDataUnits; }
+
+    const sp<ABuffer> &front() const;
+    const sp<ABuffer> &itemAt(size_t index) const;
+    bool isDiscontinuityAt(size_t index) const;
+
+    // |isTrimPoint| marks a unit that the front of the stream may be trimmed
+    // up to, e.g. an IDR frame of an AVC stream.
+    void pushBack(const sp<ABuffer> &buffer, bool isTrimPoint);
+    void pushFront(const sp<ABuffer> &buffer, bool isTrimPoint);
+    void popFront();
+
+    void clear();
+
+    // Removes all units except the discontinuity markers.
+    void clearDataUnits();
+
+    // Returns the index of the first data unit that is at least durationUs
+    // of buffered data past the head of the queue, or size() if there is
+    // none.
+    size_t findBufferedDuration(int64_t durationUs) const;
+
+    // Returns the index of the first data unit not earlier than |time|, or
+    // size() if there is none.
+    size_t findFirstNotBefore(const HLSTime &time) const;
+
+    // Returns the index of the first trim point later than |time|, or
+    // size() if there is none.
+    size_t findFirstTrimPointAfter(const HLSTime &time) const;
+
+    // Returns the index of the last data unit before |index|, or -1 if there
+    // is none.
+    ssize_t findLastDataUnitBefore(size_t index) const;
+
+    // Number of discontinuity markers before |index|.
+    size_t countDiscontinuitiesBefore(size_t index) const;
+
+    // Removes the units in [0, index) or [index, size()) respectively.
+    void eraseFront(size_t index);
+    void eraseBack(size_t index);
+
+private:
+    struct Key {
+        int32_t mSeq;
+        int64_t mTimeUs;
+
+        Key() : mSeq(0), mTimeUs(0) {}
+
+        bool operator<(const Key &other) const {
+            return mSeq < other.mSeq
+                    || (mSeq == other.mSeq && mTimeUs < other.mTimeUs);
+        }
+    };
+
+    struct Entry {
+        sp<ABuffer> mBuffer;
+        bool mIsDiscontinuity;
+        bool mIsTrimPoint;
+
+        // Running maximum of the (discontinuitySeq, timeUs) key of all data
+        // units up to and including this one.
+        bool mHasMaxKey;
+        Key mMaxKey;
+
+        // Buffered duration of completed discontinuity segments, and the
+        // first and maximum timestamps of the current one.
+        int64_t mCompletedUs;
+        int64_t mSegmentFirstUs;
+        int64_t mSegmentMaxUs;
+
+        // Number of discontinuity markers queued before this unit.
+        size_t mMarkersBefore;
+
+        Entry()
+            : mIsDiscontinuity(false),
+              mIsTrimPoint(false),
+              mHasMaxKey(false),
+              mCompletedUs(0),
+              mSegmentFirstUs(-1),
+              mSegmentMaxUs(-1),
+              mMarkersBefore(0) {
+        }
+
+        int64_t bufferedUs() const {
+            return mCompletedUs + mSegmentMaxUs - mSegmentFirstUs;
+        }
+    };
+
+    struct TrimPoint {
+        size_t mPosition;
+        Key mMaxKey;
+    };
+
+    // Entries before mHead have been dequeued and are dropped lazily. The
+    // absolute position of mEntries[mHead] is mHeadPosition.
+    Vector<Entry> mEntries;
+    size_t mHead;
+    size_t mHeadPosition;
+
+    Vector<TrimPoint> mTrimPoints;
+    size_t mTrimPointsHead;
+
+    size_t mNumDataUnits;
+
+    const Entry &entryAt(size_t index) const;
+    void appendEntry(const sp<ABuffer> &buffer, bool isTrimPoint);
+    void rebuild(const Vector<Entry> &entries);
+    void compact();
+
+    DISALLOW_EVIL_CONSTRUCTORS(AccessUnitQueue);
+};
+
+}  // namespace android
+
+#endif  // ACCESS_UNIT_QUEUE_H_
@@ -3,6 +3,7 @@ LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:=                 \
+        AccessUnitQueue.cpp       \
         AnotherPacketSource.cpp   \
         ATSParser.cpp             \
         ESQueue.cpp               \
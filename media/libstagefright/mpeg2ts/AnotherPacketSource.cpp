@@ -19,8 +19,6 @@
 
 #include "AnotherPacketSource.h"
 
-#include "include/avc_utils.h"
-
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
@@ -46,7 +44,9 @@ AnotherPacketSource::AnotherPacketSource(const sp<MetaData> &meta)
       mLastQueuedTimeUs(0),
       mEOSResult(OK),
       mLatestEnqueuedMeta(NULL),
-      mLatestDequeuedMeta(NULL) {
+      mLatestDequeuedMeta(NULL),
+      mQueuedFormatFound(false),
+      mQueuedFormatIsAvc(false) {
     setFormat(meta);
 
     mDiscontinuitySegments.push_back(DiscontinuitySegment());
@@ -95,19 +95,15 @@ sp<MetaData> AnotherPacketSource::getFormat() {
         return mFormat;
     }
 
-    List<sp<ABuffer> >::iterator it = mBuffers.begin();
-    while (it != mBuffers.end()) {
-        sp<ABuffer> buffer = *it;
-        int32_t discontinuity;
-        if (!buffer->meta()->findInt32("discontinuity", &discontinuity)) {
+    for (size_t i = 0; i < mBuffers.size(); ++i) {
+        if (!mBuffers.isDiscontinuityAt(i)) {
+            const sp<ABuffer> &buffer = mBuffers.itemAt(i);
             sp<RefBase> object;
             if (buffer->meta()->findObject("format", &object)) {
                 setFormat(static_cast<MetaData*>(object.get()));
                 return mFormat;
             }
         }
-
-        ++it;
     }
     return NULL;
 }
@@ -121,8 +117,8 @@ status_t AnotherPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
     }
 
     if (!mBuffers.empty()) {
-        *buffer = *mBuffers.begin();
-        mBuffers.erase(mBuffers.begin());
+        *buffer = mBuffers.front();
+        mBuffers.popFront();
 
         int32_t discontinuity;
         if ((*buffer)->meta()->findInt32("discontinuity", &discontinuity)) {
@@ -159,7 +155,7 @@ status_t AnotherPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
 void AnotherPacketSource::requeueAccessUnit(const sp<ABuffer> &buffer) {
     // TODO: update corresponding book keeping info.
     Mutex::Autolock autoLock(mLock);
-    mBuffers.push_front(buffer);
+    mBuffers.pushFront(buffer, true /* isTrimPoint */);
 }
 
 status_t AnotherPacketSource::read(
@@ -173,8 +169,8 @@ status_t AnotherPacketSource::read(
 
     if (!mBuffers.empty()) {
 
-        const sp<ABuffer> buffer = *mBuffers.begin();
-        mBuffers.erase(mBuffers.begin());
+        const sp<ABuffer> buffer = mBuffers.front();
+        mBuffers.popFront();
 
         int32_t discontinuity;
         if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
@@ -242,6 +238,36 @@ bool AnotherPacketSource::wasFormatChange(
     return false;
 }
 
+bool AnotherPacketSource::isTrimPoint_l(const sp<ABuffer> &buffer) {
+    int32_t discontinuity;
+    if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
+        mQueuedFormatFound = false;
+        mQueuedFormatIsAvc = false;
+        return false;
+    }
+
+    if (!mQueuedFormatFound) {
+        sp<RefBase> object;
+        if (buffer->meta()->findObject("format", &object)) {
+            const char *mime;
+            sp<MetaData> format = static_cast<MetaData*>(object.get());
+            mQueuedFormatFound = format != NULL;
+            mQueuedFormatIsAvc = format != NULL
+                    && format->findCString(kKeyMIMEType, &mime)
+                    && !strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_AVC);
+        }
+    }
+
+    if (!mQueuedFormatIsAvc) {
+        return true;
+    }
+
+    // AVC streams can only be trimmed to IDR frames, which ESQueue flags
+    // as sync frames.
+    int32_t isSync;
+    return buffer->meta()->findInt32("isSync", &isSync) && isSync;
+}
+
 void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
     int32_t damaged;
     if (buffer->meta()->findInt32("damaged", &damaged) && damaged) {
@@ -250,7 +276,7 @@ void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
     }
 
     Mutex::Autolock autoLock(mLock);
-    mBuffers.push_back(buffer);
+    mBuffers.pushBack(buffer, isTrimPoint_l(buffer));
     mCondition.signal();
 
     int32_t discontinuity;
@@ -303,6 +329,8 @@ void AnotherPacketSource::clear() {
 
     mBuffers.clear();
     mEOSResult = OK;
+    mQueuedFormatFound = false;
+    mQueuedFormatIsAvc = false;
 
     mDiscontinuitySegments.clear();
     mDiscontinuitySegments.push_back(DiscontinuitySegment());
@@ -319,19 +347,7 @@ void AnotherPacketSource::queueDiscontinuity(
 
     if (discard) {
         // Leave only discontinuities in the queue.
-        List<sp<ABuffer> >::iterator it = mBuffers.begin();
-        while (it != mBuffers.end()) {
-            sp<ABuffer> oldBuffer = *it;
-
-            int32_t oldDiscontinuityType;
-            if (!oldBuffer->meta()->findInt32(
-                        "discontinuity", &oldDiscontinuityType)) {
-                it = mBuffers.erase(it);
-                continue;
-            }
-
-            ++it;
-        }
+        mBuffers.clearDataUnits();
 
         for (List<DiscontinuitySegment>::iterator it2 = mDiscontinuitySegments.begin();
                 it2 != mDiscontinuitySegments.end();
@@ -356,7 +372,7 @@ void AnotherPacketSource::queueDiscontinuity(
     buffer->meta()->setInt32("discontinuity", static_cast<int32_t>(type));
     buffer->meta()->setMessage("extra", extra);
 
-    mBuffers.push_back(buffer);
+    mBuffers.pushBack(buffer, isTrimPoint_l(buffer));
     mCondition.signal();
 }
 
@@ -388,12 +404,8 @@ bool AnotherPacketSource::hasDataBufferAvailable(status_t *finalResult) {
     if (!mEnabled) {
         return false;
     }
-    List<sp<ABuffer> >::iterator it;
-    for (it = mBuffers.begin(); it != mBuffers.end(); it++) {
-        int32_t discontinuity;
-        if (!(*it)->meta()->findInt32("discontinuity", &discontinuity)) {
-            return true;
-        }
+    if (mBuffers.numDataUnits() > 0) {
+        return true;
     }
 
     *finalResult = mEOSResult;
@@ -440,7 +452,7 @@ status_t AnotherPacketSource::nextBufferTime(int64_t *timeUs) {
         return mEOSResult != OK ? mEOSResult : -EWOULDBLOCK;
     }
 
-    sp<ABuffer> buffer = *mBuffers.begin();
+    sp<ABuffer> buffer = mBuffers.front();
     CHECK(buffer->meta()->findInt64("timeUs", timeUs));
 
     return OK;
@@ -478,32 +490,10 @@ void AnotherPacketSource::enable(bool enable) {
  */
 sp<AMessage> AnotherPacketSource::getMetaAfterLastDequeued(int64_t delayUs) {
     Mutex::Autolock autoLock(mLock);
-    int64_t firstUs = -1;
-    int64_t lastUs = -1;
-    int64_t durationUs = 0;
 
-    List<sp<ABuffer> >::iterator it;
-    for (it = mBuffers.begin(); it != mBuffers.end(); ++it) {
-        const sp<ABuffer> &buffer = *it;
-        int32_t discontinuity;
-        if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
-            durationUs += lastUs - firstUs;
-            firstUs = -1;
-            lastUs = -1;
-            continue;
-        }
-        int64_t timeUs;
-        if (buffer->meta()->findInt64("timeUs", &timeUs)) {
-            if (firstUs < 0) {
-                firstUs = timeUs;
-            }
-            if (lastUs < 0 || timeUs > lastUs) {
-                lastUs = timeUs;
-            }
-            if (durationUs + (lastUs - firstUs) >= delayUs) {
-                return buffer->meta();
-            }
-        }
+    size_t index = mBuffers.findBufferedDuration(delayUs);
+    if (index < mBuffers.size()) {
+        return mBuffers.itemAt(index)->meta();
     }
     return NULL;
 }
@@ -527,30 +517,28 @@ void AnotherPacketSource::trimBuffersAfterMeta(
     ALOGV("trimBuffersAfterMeta: discontinuitySeq %d, timeUs %lld",
             stopTime.mSeq, (long long)stopTime.mTimeUs);
 
-    List<sp<ABuffer> >::iterator it;
-    List<DiscontinuitySegment >::iterator it2;
+    size_t index = mBuffers.findFirstNotBefore(stopTime);
+    if (index < mBuffers.size()) {
+        ALOGV("trimming from %lld (inclusive) to end",
+                (long long)HLSTime(mBuffers.itemAt(index)->meta()).mTimeUs);
+    }
+
     sp<AMessage> newLatestEnqueuedMeta = NULL;
     int64_t newLastQueuedTimeUs = 0;
-    for (it = mBuffers.begin(), it2 = mDiscontinuitySegments.begin(); it != mBuffers.end(); ++it) {
-        const sp<ABuffer> &buffer = *it;
-        int32_t discontinuity;
-        if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
-            // CHECK(it2 != mDiscontinuitySegments.end());
-            ++it2;
-            continue;
-        }
+    ssize_t lastIndex = mBuffers.findLastDataUnitBefore(index);
+    if (lastIndex >= 0) {
+        newLatestEnqueuedMeta = mBuffers.itemAt(lastIndex)->meta();
+        CHECK(newLatestEnqueuedMeta->findInt64("timeUs", &newLastQueuedTimeUs));
+    }
 
-        HLSTime curTime(buffer->meta());
-        if (!(curTime < stopTime)) {
-            ALOGV("trimming from %lld (inclusive) to end",
-                    (long long)curTime.mTimeUs);
-            break;
-        }
-        newLatestEnqueuedMeta = buffer->meta();
-        newLastQueuedTimeUs = curTime.mTimeUs;
+    // CHECK(numDiscontinuities < mDiscontinuitySegments.size());
+    size_t numDiscontinuities = mBuffers.countDiscontinuitiesBefore(index);
+    List<DiscontinuitySegment >::iterator it2 = mDiscontinuitySegments.begin();
+    for (size_t i = 0; i < numDiscontinuities; ++i) {
+        ++it2;
     }
 
-    mBuffers.erase(it, mBuffers.end());
+    mBuffers.eraseBack(index);
     mLatestEnqueuedMeta = newLatestEnqueuedMeta;
     mLastQueuedTimeUs = newLastQueuedTimeUs;
 
@@ -583,44 +571,22 @@ sp<AMessage> AnotherPacketSource::trimBuffersBeforeMeta(
         return NULL;
     }
 
-    sp<MetaData> format;
-    bool isAvc = false;
-
-    List<sp<ABuffer> >::iterator it;
-    for (it = mBuffers.begin(); it != mBuffers.end(); ++it) {
-        const sp<ABuffer> &buffer = *it;
-        int32_t discontinuity;
-        if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
-            mDiscontinuitySegments.erase(mDiscontinuitySegments.begin());
-            // CHECK(!mDiscontinuitySegments.empty());
-            format = NULL;
-            isAvc = false;
-            continue;
-        }
-        if (format == NULL) {
-            sp<RefBase> object;
-            if (buffer->meta()->findObject("format", &object)) {
-                const char* mime;
-                format = static_cast<MetaData*>(object.get());
-                isAvc = format != NULL
-                        && format->findCString(kKeyMIMEType, &mime)
-                        && !strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_AVC);
-            }
-        }
-        if (isAvc && !IsIDR(buffer)) {
-            continue;
-        }
+    // For AVC only IDR frames are trim points.
+    size_t index = mBuffers.findFirstTrimPointAfter(startTime);
+    if (index < mBuffers.size()) {
+        firstMeta = mBuffers.itemAt(index)->meta();
+        CHECK(firstMeta->findInt64("timeUs", &firstTimeUs));
+        ALOGV("trimming from beginning to %lld (not inclusive)",
+                (long long)firstTimeUs);
+    }
 
-        HLSTime curTime(buffer->meta());
-        if (startTime < curTime) {
-            ALOGV("trimming from beginning to %lld (not inclusive)",
-                    (long long)curTime.mTimeUs);
-            firstMeta = buffer->meta();
-            firstTimeUs = curTime.mTimeUs;
-            break;
-        }
+    size_t numDiscontinuities = mBuffers.countDiscontinuitiesBefore(index);
+    for (size_t i = 0; i < numDiscontinuities; ++i) {
+        mDiscontinuitySegments.erase(mDiscontinuitySegments.begin());
+        // CHECK(!mDiscontinuitySegments.empty());
     }
-    mBuffers.erase(mBuffers.begin(), it);
+
+    mBuffers.eraseFront(index);
     mLatestDequeuedMeta = NULL;
 
     // CHECK(!mDiscontinuitySegments.empty());
@@ -23,6 +23,7 @@
 #include <utils/threads.h>
 #include <utils/List.h>
 
+#include "AccessUnitQueue.h"
 #include "ATSParser.h"
 
 namespace android {
@@ -113,12 +114,18 @@ private:
     bool mEnabled;
     sp<MetaData> mFormat;
     int64_t mLastQueuedTimeUs;
-    List<sp<ABuffer> > mBuffers;
+    AccessUnitQueue mBuffers;
     status_t mEOSResult;
     sp<AMessage> mLatestEnqueuedMeta;
     sp<AMessage> mLatestDequeuedMeta;
 
+    // Format of the access units queued since the last discontinuity, used
+    // to tell which of them are trim points.
+    bool mQueuedFormatFound;
+    bool mQueuedFormatIsAvc;
+
     bool wasFormatChange(int32_t discontinuityType) const;
+    bool isTrimPoint_l(const sp<ABuffer> &buffer);
 
     DISALLOW_EVIL_CONSTRUCTORS(AnotherPacketSource);
 };
@@ -90,6 +90,11 @@ protected:
     // returns its timestamp in us (or -1 if no time information).
     int64_t fetchTimestamp(size_t size);
 
+    // drop "size" bytes from the front of mBuffer. The remaining data is
+    // not moved; the consumed space is reclaimed by appendData once the
+    // buffer runs out of room at its end.
+    void consumeBuffer(size_t size);
+
 private:
     DISALLOW_EVIL_CONSTRUCTORS(ElementaryStreamQueue);
 };
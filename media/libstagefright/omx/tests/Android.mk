@@ -42,3 +42,30 @@ LOCAL_CFLAGS += -Werror -Wall
 LOCAL_CLANG := true
 
 include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := SoftOpus_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	SoftOpus_test.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright_omx \
+	libstagefright_foundation \
+	libutils \
+	liblog \
+	libopus \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/omx \
+	frameworks/native/include/media/hardware \
+	frameworks/native/include/media/openmax \
+	external/libopus/include \
+
+LOCAL_CFLAGS += -Werror -Wall
+LOCAL_CLANG := true
+
+include $(BUILD_NATIVE_TEST)
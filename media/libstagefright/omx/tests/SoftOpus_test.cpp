@@ -0,0 +1,469 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftOpus_test"
+#include <utils/Log.h>
+
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+#include <OMX_Component.h>
+#include <OMX_Core.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/List.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+#include "SoftOMXPlugin.h"
+
+#include "opus.h"
+
+namespace android {
+
+static const int32_t kSampleRate = 48000;
+static const int32_t kNumChannels = 2;
+static const int64_t kSeekPreRollNs = 80000000ll;
+static const int64_t kTimeoutUs = 5000000ll;
+
+template<class T>
+static void InitOMXParams(T *params) {
+    memset(params, 0, sizeof(T));
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+}
+
+class SoftOpusTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        encode(4 /* seconds */);
+    }
+
+    // Decodes mPackets with up to |framesPerBuffer| packets per input buffer
+    // and returns the PCM, and the timestamp of each output buffer keyed by
+    // the PCM offset it starts at. EOS is signalled on the buffer holding the
+    // last packet if |eosWithData|, otherwise on an empty buffer after it.
+    void decode(
+            uint32_t framesPerBuffer, bool eosWithData,
+            Vector<uint8_t> *pcm, KeyedVector<size_t, int64_t> *timestamps);
+
+    int32_t mPreSkip;
+    size_t mNumSamples;
+    Vector<sp<ABuffer> > mPackets;
+
+private:
+    struct Event {
+        OMX_EVENTTYPE mEvent;
+        OMX_U32 mData1;
+        OMX_U32 mData2;
+    };
+
+    Mutex mLock;
+    Condition mCondition;
+    List<Event> mEvents;
+    List<OMX_BUFFERHEADERTYPE *> mEmptiedBuffers;
+    List<OMX_BUFFERHEADERTYPE *> mFilledBuffers;
+
+    void encode(size_t seconds);
+
+    void allocateBuffers(
+            OMX_COMPONENTTYPE *component, OMX_U32 portIndex,
+            Vector<OMX_BUFFERHEADERTYPE *> *buffers);
+    void waitForCommand(OMX_COMMANDTYPE command, OMX_U32 param);
+    void fillInputBuffer(
+            OMX_BUFFERHEADERTYPE *header, uint32_t framesPerBuffer,
+            bool eosWithData, size_t *next);
+
+    static OMX_ERRORTYPE OnEvent(
+            OMX_HANDLETYPE component, OMX_PTR appData, OMX_EVENTTYPE event,
+            OMX_U32 data1, OMX_U32 data2, OMX_PTR eventData);
+    static OMX_ERRORTYPE OnEmptyBufferDone(
+            OMX_HANDLETYPE component, OMX_PTR appData,
+            OMX_BUFFERHEADERTYPE *header);
+    static OMX_ERRORTYPE OnFillBufferDone(
+            OMX_HANDLETYPE component, OMX_PTR appData,
+            OMX_BUFFERHEADERTYPE *header);
+};
+
+// Encodes a stereo test signal, cycling through all frame sizes from 2.5 to
+// 60 ms. Packets are stamped the way OggExtractor stamps them: at their
+// position less the pre-skip, so the first packets that lie within the
+// pre-skip are all stamped 0.
+void SoftOpusTest::encode(size_t seconds) {
+    static const int kFrameSizes[] = { 120, 240, 480, 960, 1920, 2880 };
+
+    int err;
+    OpusEncoder *encoder = opus_encoder_create(
+            kSampleRate, kNumChannels, OPUS_APPLICATION_AUDIO, &err);
+    ASSERT_EQ(OPUS_OK, err);
+    ASSERT_EQ(OPUS_OK, opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&mPreSkip)));
+
+    Vector<int16_t> signal;
+    for (size_t i = 0; i < seconds * kSampleRate; ++i) {
+        double t = (double)i / kSampleRate;
+        signal.push((int16_t)(8000 * sin(2 * M_PI * 440 * t)));
+        signal.push((int16_t)(6000 * sin(2 * M_PI * 660 * t + 1)));
+    }
+
+    mNumSamples = 0;
+    for (size_t n = 0; mNumSamples + kFrameSizes[n % 6] <= seconds * kSampleRate; ++n) {
+        int frameSize = kFrameSizes[n % 6];
+
+        sp<ABuffer> packet = new ABuffer(1500);
+        int size = opus_encode(
+                encoder, signal.array() + mNumSamples * kNumChannels, frameSize,
+                packet->data(), packet->capacity());
+        ASSERT_GT(size, 0);
+        packet->setRange(0, size);
+
+        int64_t position = (int64_t)mNumSamples - mPreSkip;
+        packet->meta()->setInt64(
+                "timeUs", position > 0 ? position * 1000000ll / kSampleRate : 0);
+        mPackets.push(packet);
+
+        mNumSamples += frameSize;
+    }
+
+    opus_encoder_destroy(encoder);
+}
+
+void SoftOpusTest::allocateBuffers(
+        OMX_COMPONENTTYPE *component, OMX_U32 portIndex,
+        Vector<OMX_BUFFERHEADERTYPE *> *buffers) {
+    OMX_PARAM_PORTDEFINITIONTYPE def;
+    InitOMXParams(&def);
+    def.nPortIndex = portIndex;
+    ASSERT_EQ(OMX_ErrorNone,
+              OMX_GetParameter(component, OMX_IndexParamPortDefinition, &def));
+
+    for (OMX_U32 i = 0; i < def.nBufferCountActual; ++i) {
+        OMX_BUFFERHEADERTYPE *header;
+        ASSERT_EQ(OMX_ErrorNone, OMX_AllocateBuffer(
+                component, &header, portIndex, NULL /* appPrivate */,
+                def.nBufferSize));
+        buffers->push(header);
+    }
+}
+
+void SoftOpusTest::waitForCommand(OMX_COMMANDTYPE command, OMX_U32 param) {
+    Mutex::Autolock autoLock(mLock);
+    for (;;) {
+        for (List<Event>::iterator it = mEvents.begin(); it != mEvents.end(); ++it) {
+            if (it->mEvent == OMX_EventCmdComplete
+                    && it->mData1 == (OMX_U32)command && it->mData2 == param) {
+                mEvents.erase(it);
+                return;
+            }
+        }
+        ASSERT_EQ((status_t)OK, mCondition.waitRelative(mLock, kTimeoutUs * 1000ll))
+                << "command " << command << " did not complete";
+    }
+}
+
+// Fills |header| with the next codec config buffer or packets, starting at
+// input |*next|: the three codec config buffers come first, then mPackets.
+void SoftOpusTest::fillInputBuffer(
+        OMX_BUFFERHEADERTYPE *header, uint32_t framesPerBuffer,
+        bool eosWithData, size_t *next) {
+    header->nOffset = 0;
+    header->nFilledLen = 0;
+    header->nFlags = 0;
+    header->nTimeStamp = 0;
+
+    if (*next < 3) {
+        uint8_t config[19];
+        size_t size = sizeof(int64_t);
+        if (*next == 0) {
+            // OpusHead of a stereo stream with channel mapping family 0.
+            memset(config, 0, sizeof(config));
+            memcpy(config, "OpusHead", 8);
+            config[8] = 1;
+            config[9] = kNumChannels;
+            config[10] = mPreSkip & 0xff;
+            config[11] = mPreSkip >> 8;
+            memcpy(&config[12], &kSampleRate, sizeof(kSampleRate));
+            size = sizeof(config);
+        } else {
+            int64_t ns = (*next == 1)
+                    ? mPreSkip * 1000000000ll / kSampleRate : kSeekPreRollNs;
+            memcpy(config, &ns, sizeof(ns));
+        }
+        memcpy(header->pBuffer, config, size);
+        header->nFilledLen = size;
+        header->nFlags = OMX_BUFFERFLAG_CODECCONFIG;
+        ++*next;
+        return;
+    }
+
+    size_t index = *next - 3;
+    if (index < mPackets.size()) {
+        int64_t timeUs;
+        ASSERT_TRUE(mPackets.itemAt(index)->meta()->findInt64("timeUs", &timeUs));
+        header->nTimeStamp = timeUs;
+    }
+
+    for (uint32_t n = 0; n < framesPerBuffer && index < mPackets.size(); ++n, ++index) {
+        const sp<ABuffer> &packet = mPackets.itemAt(index);
+        uint32_t length = packet->size();
+        size_t lengthSize = (framesPerBuffer > 1) ? sizeof(length) : 0;
+        if (header->nFilledLen + lengthSize + length > header->nAllocLen) {
+            break;
+        }
+
+        memcpy(header->pBuffer + header->nFilledLen, &length, lengthSize);
+        memcpy(header->pBuffer + header->nFilledLen + lengthSize, packet->data(), length);
+        header->nFilledLen += lengthSize + length;
+    }
+
+    if (index == mPackets.size() && (eosWithData || header->nFilledLen == 0)) {
+        header->nFlags |= OMX_BUFFERFLAG_EOS;
+    }
+    *next = index + 3;
+}
+
+void SoftOpusTest::decode(
+        uint32_t framesPerBuffer, bool eosWithData,
+        Vector<uint8_t> *pcm, KeyedVector<size_t, int64_t> *timestamps) {
+    SoftOMXPlugin plugin;
+    OMX_CALLBACKTYPE callbacks = { &OnEvent, &OnEmptyBufferDone, &OnFillBufferDone };
+    OMX_COMPONENTTYPE *component;
+    ASSERT_EQ(OMX_ErrorNone, plugin.makeComponentInstance(
+            "OMX.google.opus.decoder", &callbacks, this, &component));
+
+    if (framesPerBuffer > 1) {
+        OMX_INDEXTYPE index;
+        ASSERT_EQ(OMX_ErrorNone, OMX_GetExtensionIndex(
+                component, (OMX_STRING)"OMX.google.android.index.multiFrameBuffers",
+                &index));
+
+        OMX_PARAM_U32TYPE params;
+        InitOMXParams(&params);
+        params.nPortIndex = 1;
+        params.nU32 = framesPerBuffer;
+        ASSERT_EQ(OMX_ErrorNone, OMX_SetParameter(component, index, &params));
+        ASSERT_EQ(OMX_ErrorNone, OMX_GetParameter(component, index, &params));
+        ASSERT_EQ(framesPerBuffer, params.nU32);
+    }
+
+    Vector<OMX_BUFFERHEADERTYPE *> inBuffers, outBuffers;
+    ASSERT_EQ(OMX_ErrorNone,
+              OMX_SendCommand(component, OMX_CommandStateSet, OMX_StateIdle, NULL));
+    allocateBuffers(component, 0, &inBuffers);
+    allocateBuffers(component, 1, &outBuffers);
+    waitForCommand(OMX_CommandStateSet, OMX_StateIdle);
+
+    ASSERT_EQ(OMX_ErrorNone,
+              OMX_SendCommand(component, OMX_CommandStateSet, OMX_StateExecuting, NULL));
+    waitForCommand(OMX_CommandStateSet, OMX_StateExecuting);
+
+    List<OMX_BUFFERHEADERTYPE *> freeInBuffers;
+    for (size_t i = 0; i < inBuffers.size(); ++i) {
+        freeInBuffers.push_back(inBuffers.itemAt(i));
+    }
+    for (size_t i = 0; i < outBuffers.size(); ++i) {
+        ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(component, outBuffers.itemAt(i)));
+    }
+
+    size_t next = 0;
+    bool sentEOS = false;
+    bool sawOutputEOS = false;
+    bool disablingOutput = false;
+    size_t numOutBuffersOwned = 0;
+    while (!sawOutputEOS) {
+        while (!freeInBuffers.empty() && !sentEOS) {
+            OMX_BUFFERHEADERTYPE *header = *freeInBuffers.begin();
+            freeInBuffers.erase(freeInBuffers.begin());
+            fillInputBuffer(header, framesPerBuffer, eosWithData, &next);
+            sentEOS = (header->nFlags & OMX_BUFFERFLAG_EOS) != 0;
+            ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(component, header));
+        }
+
+        List<Event> events;
+        List<OMX_BUFFERHEADERTYPE *> filledBuffers;
+        {
+            Mutex::Autolock autoLock(mLock);
+            while (mEvents.empty() && mEmptiedBuffers.empty() && mFilledBuffers.empty()) {
+                ASSERT_EQ((status_t)OK, mCondition.waitRelative(mLock, kTimeoutUs * 1000ll))
+                        << "decoder stalled";
+            }
+            events = mEvents;
+            mEvents.clear();
+            filledBuffers = mFilledBuffers;
+            mFilledBuffers.clear();
+            while (!mEmptiedBuffers.empty()) {
+                freeInBuffers.push_back(*mEmptiedBuffers.begin());
+                mEmptiedBuffers.erase(mEmptiedBuffers.begin());
+            }
+        }
+
+        for (List<Event>::iterator it = events.begin(); it != events.end(); ++it) {
+            ASSERT_NE(OMX_EventError, it->mEvent);
+            if (it->mEvent == OMX_EventPortSettingsChanged && it->mData1 == 1) {
+                ASSERT_EQ(OMX_ErrorNone,
+                          OMX_SendCommand(component, OMX_CommandPortDisable, 1, NULL));
+                disablingOutput = true;
+            }
+        }
+
+        for (List<OMX_BUFFERHEADERTYPE *>::iterator it = filledBuffers.begin();
+                it != filledBuffers.end(); ++it) {
+            OMX_BUFFERHEADERTYPE *header = *it;
+            if (disablingOutput) {
+                ++numOutBuffersOwned;
+                continue;
+            }
+
+            if (header->nFilledLen > 0) {
+                timestamps->add(pcm->size(), header->nTimeStamp);
+                pcm->appendArray(header->pBuffer + header->nOffset, header->nFilledLen);
+            }
+            if (header->nFlags & OMX_BUFFERFLAG_EOS) {
+                sawOutputEOS = true;
+            }
+
+            header->nOffset = 0;
+            header->nFilledLen = 0;
+            header->nFlags = 0;
+            ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(component, header));
+        }
+
+        // Reallocate the output buffers once the component has returned all
+        // of them.
+        if (disablingOutput && numOutBuffersOwned == outBuffers.size()) {
+            for (size_t i = 0; i < outBuffers.size(); ++i) {
+                ASSERT_EQ(OMX_ErrorNone, OMX_FreeBuffer(component, 1, outBuffers.itemAt(i)));
+            }
+            outBuffers.clear();
+            waitForCommand(OMX_CommandPortDisable, 1);
+
+            ASSERT_EQ(OMX_ErrorNone,
+                      OMX_SendCommand(component, OMX_CommandPortEnable, 1, NULL));
+            allocateBuffers(component, 1, &outBuffers);
+            waitForCommand(OMX_CommandPortEnable, 1);
+
+            for (size_t i = 0; i < outBuffers.size(); ++i) {
+                ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(component, outBuffers.itemAt(i)));
+            }
+            disablingOutput = false;
+            numOutBuffersOwned = 0;
+        }
+    }
+
+    // Going to idle returns all buffers.
+    ASSERT_EQ(OMX_ErrorNone,
+              OMX_SendCommand(component, OMX_CommandStateSet, OMX_StateIdle, NULL));
+    waitForCommand(OMX_CommandStateSet, OMX_StateIdle);
+
+    ASSERT_EQ(OMX_ErrorNone,
+              OMX_SendCommand(component, OMX_CommandStateSet, OMX_StateLoaded, NULL));
+    for (size_t i = 0; i < inBuffers.size(); ++i) {
+        ASSERT_EQ(OMX_ErrorNone, OMX_FreeBuffer(component, 0, inBuffers.itemAt(i)));
+    }
+    for (size_t i = 0; i < outBuffers.size(); ++i) {
+        ASSERT_EQ(OMX_ErrorNone, OMX_FreeBuffer(component, 1, outBuffers.itemAt(i)));
+    }
+    waitForCommand(OMX_CommandStateSet, OMX_StateLoaded);
+
+    plugin.destroyComponentInstance(component);
+
+    Mutex::Autolock autoLock(mLock);
+    mEvents.clear();
+    mEmptiedBuffers.clear();
+    mFilledBuffers.clear();
+}
+
+// static
+OMX_ERRORTYPE SoftOpusTest::OnEvent(
+        OMX_HANDLETYPE /* component */, OMX_PTR appData, OMX_EVENTTYPE event,
+        OMX_U32 data1, OMX_U32 data2, OMX_PTR /* eventData */) {
+    SoftOpusTest *test = static_cast<SoftOpusTest *>(appData);
+    Event e;
+    e.mEvent = event;
+    e.mData1 = data1;
+    e.mData2 = data2;
+
+    Mutex::Autolock autoLock(test->mLock);
+    test->mEvents.push_back(e);
+    test->mCondition.broadcast();
+    return OMX_ErrorNone;
+}
+
+// static
+OMX_ERRORTYPE SoftOpusTest::OnEmptyBufferDone(
+        OMX_HANDLETYPE /* component */, OMX_PTR appData,
+        OMX_BUFFERHEADERTYPE *header) {
+    SoftOpusTest *test = static_cast<SoftOpusTest *>(appData);
+    Mutex::Autolock autoLock(test->mLock);
+    test->mEmptiedBuffers.push_back(header);
+    test->mCondition.broadcast();
+    return OMX_ErrorNone;
+}
+
+// static
+OMX_ERRORTYPE SoftOpusTest::OnFillBufferDone(
+        OMX_HANDLETYPE /* component */, OMX_PTR appData,
+        OMX_BUFFERHEADERTYPE *header) {
+    SoftOpusTest *test = static_cast<SoftOpusTest *>(appData);
+    Mutex::Autolock autoLock(test->mLock);
+    test->mFilledBuffers.push_back(header);
+    test->mCondition.broadcast();
+    return OMX_ErrorNone;
+}
+
+TEST_F(SoftOpusTest, MultiFrameBuffersMatchSingleFrameBuffers) {
+    Vector<uint8_t> expectedPCM;
+    KeyedVector<size_t, int64_t> expectedTimestamps;
+    decode(1, false /* eosWithData */, &expectedPCM, &expectedTimestamps);
+
+    // The pre-skip is discarded once, even though the first packets are all
+    // stamped 0.
+    EXPECT_EQ((mNumSamples - mPreSkip) * kNumChannels * sizeof(int16_t), expectedPCM.size());
+
+    static const uint32_t kFramesPerBuffer[] = { 1, 2, 4, 16 };
+    for (size_t i = 0; i < sizeof(kFramesPerBuffer) / sizeof(kFramesPerBuffer[0]); ++i) {
+        for (int eosWithData = 0; eosWithData < 2; ++eosWithData) {
+            uint32_t framesPerBuffer = kFramesPerBuffer[i];
+            if (framesPerBuffer == 1 && !eosWithData) {
+                continue;
+            }
+
+            Vector<uint8_t> pcm;
+            KeyedVector<size_t, int64_t> timestamps;
+            decode(framesPerBuffer, eosWithData, &pcm, &timestamps);
+
+            ASSERT_EQ(expectedPCM.size(), pcm.size())
+                    << framesPerBuffer << " frames per buffer, eosWithData " << eosWithData;
+            EXPECT_EQ(0, memcmp(expectedPCM.array(), pcm.array(), pcm.size()))
+                    << framesPerBuffer << " frames per buffer, eosWithData " << eosWithData;
+
+            // Each output buffer starts where one of the single frame buffers
+            // does, at the same time.
+            for (size_t j = 0; j < timestamps.size(); ++j) {
+                ssize_t index = expectedTimestamps.indexOfKey(timestamps.keyAt(j));
+                ASSERT_GE(index, 0) << "output buffer at PCM offset " << timestamps.keyAt(j);
+                EXPECT_EQ(expectedTimestamps.valueAt(index), timestamps.valueAt(j))
+                        << "output buffer at PCM offset " << timestamps.keyAt(j);
+            }
+        }
+    }
+}
+
+}  // namespace android
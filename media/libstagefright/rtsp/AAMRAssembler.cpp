@@ -100,28 +100,21 @@ static size_t getFrameSize(bool isWide, unsigned FT) {
 
 ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
         const sp<ARTPSource> &source) {
-    List<sp<ABuffer> > *queue = source->queue();
+    ARTPPacketQueue *queue = source->queue();
 
     if (queue->empty()) {
         return NOT_ENOUGH_DATA;
     }
 
     if (mNextExpectedSeqNoValid) {
-        List<sp<ABuffer> >::iterator it = queue->begin();
-        while (it != queue->end()) {
-            if ((uint32_t)(*it)->int32Data() >= mNextExpectedSeqNo) {
-                break;
-            }
-
-            it = queue->erase(it);
-        }
+        queue->dropBefore(mNextExpectedSeqNo);
 
         if (queue->empty()) {
             return NOT_ENOUGH_DATA;
         }
     }
 
-    sp<ABuffer> buffer = *queue->begin();
+    sp<ABuffer> buffer = queue->front();
 
     if (!mNextExpectedSeqNoValid) {
         mNextExpectedSeqNoValid = true;
@@ -135,7 +128,7 @@ ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
     // hexdump(buffer->data(), buffer->size());
 
     if (buffer->size() < 1) {
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
 
         ALOGV("AMR packet too short.");
@@ -152,7 +145,7 @@ ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
     size_t totalSize = 0;
     for (;;) {
         if (offset >= buffer->size()) {
-            queue->erase(queue->begin());
+            queue->popFront();
             ++mNextExpectedSeqNo;
 
             ALOGV("Unable to parse TOC.");
@@ -166,7 +159,7 @@ ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
         if ((toc & 3) != 0
                 || (mIsWide && FT > 9 && FT != 15)
                 || (!mIsWide && FT > 8 && FT != 15)) {
-            queue->erase(queue->begin());
+            queue->popFront();
             ++mNextExpectedSeqNo;
 
             ALOGV("Illegal TOC entry.");
@@ -193,7 +186,7 @@ ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
         size_t frameSize = getFrameSize(mIsWide, (toc >> 3) & 0x0f);
 
         if (offset + frameSize - 1 > buffer->size()) {
-            queue->erase(queue->begin());
+            queue->popFront();
             ++mNextExpectedSeqNo;
 
             ALOGV("AMR packet too short.");
@@ -213,7 +206,7 @@ ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
     msg->setBuffer("access-unit", accessUnit);
     msg->post();
 
-    queue->erase(queue->begin());
+    queue->popFront();
     ++mNextExpectedSeqNo;
 
     return OK;
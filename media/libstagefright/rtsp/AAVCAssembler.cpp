@@ -37,7 +37,12 @@ AAVCAssembler::AAVCAssembler(const sp<AMessage> &notify)
       mAccessUnitRTPTime(0),
       mNextExpectedSeqNoValid(false),
       mNextExpectedSeqNo(0),
-      mAccessUnitDamaged(false) {
+      mAccessUnitDamaged(false),
+      mFragmentScanValid(false),
+      mFragmentScanStartSeqNo(0),
+      mFragmentScanEndSeqNo(0),
+      mFragmentScanSize(0),
+      mFragmentScanCount(0) {
 }
 
 AAVCAssembler::~AAVCAssembler() {
@@ -45,28 +50,21 @@ AAVCAssembler::~AAVCAssembler() {
 
 ARTPAssembler::AssemblyStatus AAVCAssembler::addNALUnit(
         const sp<ARTPSource> &source) {
-    List<sp<ABuffer> > *queue = source->queue();
+    ARTPPacketQueue *queue = source->queue();
 
     if (queue->empty()) {
         return NOT_ENOUGH_DATA;
     }
 
     if (mNextExpectedSeqNoValid) {
-        List<sp<ABuffer> >::iterator it = queue->begin();
-        while (it != queue->end()) {
-            if ((uint32_t)(*it)->int32Data() >= mNextExpectedSeqNo) {
-                break;
-            }
-
-            it = queue->erase(it);
-        }
+        queue->dropBefore(mNextExpectedSeqNo);
 
         if (queue->empty()) {
             return NOT_ENOUGH_DATA;
         }
     }
 
-    sp<ABuffer> buffer = *queue->begin();
+    sp<ABuffer> buffer = queue->front();
 
     if (!mNextExpectedSeqNoValid) {
         mNextExpectedSeqNoValid = true;
@@ -84,7 +82,7 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addNALUnit(
         // Corrupt.
 
         ALOGV("Ignoring corrupt buffer.");
-        queue->erase(queue->begin());
+        queue->popFront();
 
         ++mNextExpectedSeqNo;
         return MALFORMED_PACKET;
@@ -93,7 +91,7 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addNALUnit(
     unsigned nalType = data[0] & 0x1f;
     if (nalType >= 1 && nalType <= 23) {
         addSingleNALUnit(buffer);
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
         return OK;
     } else if (nalType == 28) {
@@ -102,21 +100,21 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addNALUnit(
     } else if (nalType == 24) {
         // STAP-A
         bool success = addSingleTimeAggregationPacket(buffer);
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
 
         return success ? OK : MALFORMED_PACKET;
     } else if (nalType == 0) {
         ALOGV("Ignoring undefined nal type.");
 
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
 
         return OK;
     } else {
         ALOGV("Ignoring unsupported buffer (nalType=%d)", nalType);
 
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
 
         return MALFORMED_PACKET;
@@ -178,10 +176,10 @@ bool AAVCAssembler::addSingleTimeAggregationPacket(const sp<ABuffer> &buffer) {
 }
 
 ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
-        List<sp<ABuffer> > *queue) {
+        ARTPPacketQueue *queue) {
     CHECK(!queue->empty());
 
-    sp<ABuffer> buffer = *queue->begin();
+    sp<ABuffer> buffer = queue->front();
     const uint8_t *data = buffer->data();
     size_t size = buffer->size();
 
@@ -193,7 +191,7 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
     if (size < 2) {
         ALOGV("Ignoring malformed FU buffer (size = %zu)", size);
 
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
         return MALFORMED_PACKET;
     }
@@ -203,7 +201,7 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
 
         ALOGV("Start bit not set on first buffer");
 
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
         return MALFORMED_PACKET;
     }
@@ -211,11 +209,22 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
     uint32_t nalType = data[1] & 0x1f;
     uint32_t nri = (data[0] >> 5) & 3;
 
-    uint32_t expectedSeqNo = (uint32_t)buffer->int32Data() + 1;
+    uint32_t startSeqNo = (uint32_t)buffer->int32Data();
+    uint32_t expectedSeqNo = startSeqNo + 1;
     size_t totalSize = size - 2;
     size_t totalCount = 1;
     bool complete = false;
 
+    if (mFragmentScanValid && mFragmentScanStartSeqNo == startSeqNo) {
+        // The fragments up to mFragmentScanEndSeqNo have been validated
+        // by an earlier call already, pick up where that one left off.
+        expectedSeqNo = mFragmentScanEndSeqNo;
+        totalSize = mFragmentScanSize;
+        totalCount = mFragmentScanCount;
+    }
+
+    mFragmentScanValid = false;
+
     if (data[1] & 0x40) {
         // Huh? End bit also set on the first buffer.
 
@@ -223,22 +232,31 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
 
         complete = true;
     } else {
-        List<sp<ABuffer> >::iterator it = ++queue->begin();
-        while (it != queue->end()) {
+        for (;;) {
             ALOGV("sequence length %zu", totalCount);
 
-            const sp<ABuffer> &buffer = *it;
+            sp<ABuffer> buffer = queue->find(expectedSeqNo);
 
-            const uint8_t *data = buffer->data();
-            size_t size = buffer->size();
+            if (buffer == NULL) {
+                mFragmentScanValid = true;
+                mFragmentScanStartSeqNo = startSeqNo;
+                mFragmentScanEndSeqNo = expectedSeqNo;
+                mFragmentScanSize = totalSize;
+                mFragmentScanCount = totalCount;
 
-            if ((uint32_t)buffer->int32Data() != expectedSeqNo) {
-                ALOGV("sequence not complete, expected seqNo %d, got %d",
-                     expectedSeqNo, (uint32_t)buffer->int32Data());
+                if (expectedSeqNo < queue->endSeqNum()) {
+                    ALOGV("sequence not complete, expected seqNo %d",
+                         expectedSeqNo);
 
-                return WRONG_SEQUENCE_NUMBER;
+                    return WRONG_SEQUENCE_NUMBER;
+                }
+
+                break;
             }
 
+            const uint8_t *data = buffer->data();
+            size_t size = buffer->size();
+
             if (size < 2
                     || data[0] != indicator
                     || (data[1] & 0x1f) != nalType
@@ -247,10 +265,7 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
 
                 // Delete the whole start of the FU.
 
-                it = queue->begin();
-                for (size_t i = 0; i <= totalCount; ++i) {
-                    it = queue->erase(it);
-                }
+                queue->dropBefore(expectedSeqNo + 1);
 
                 mNextExpectedSeqNo = expectedSeqNo + 1;
 
@@ -267,8 +282,6 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
                 complete = true;
                 break;
             }
-
-            ++it;
         }
     }
 
@@ -285,14 +298,13 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
     ++totalSize;
 
     sp<ABuffer> unit = new ABuffer(totalSize);
-    CopyTimes(unit, *queue->begin());
+    CopyTimes(unit, queue->front());
 
     unit->data()[0] = (nri << 5) | nalType;
 
     size_t offset = 1;
-    List<sp<ABuffer> >::iterator it = queue->begin();
     for (size_t i = 0; i < totalCount; ++i) {
-        const sp<ABuffer> &buffer = *it;
+        const sp<ABuffer> &buffer = queue->front();
 
         ALOGV("piece #%zu/%zu", i + 1, totalCount);
 #if !LOG_NDEBUG
@@ -302,7 +314,7 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
         memcpy(unit->data() + offset, buffer->data() + 2, buffer->size() - 2);
         offset += buffer->size() - 2;
 
-        it = queue->erase(it);
+        queue->popFront();
     }
 
     unit->setRange(0, totalSize);
@@ -27,6 +27,7 @@ namespace android {
 
 struct ABuffer;
 struct AMessage;
+struct ARTPPacketQueue;
 
 struct AAVCAssembler : public ARTPAssembler {
     AAVCAssembler(const sp<AMessage> &notify);
@@ -47,9 +48,17 @@ private:
     bool mAccessUnitDamaged;
     List<sp<ABuffer> > mNALUnits;
 
+    // Progress of the search for the fragments of the FU at the front of
+    // the queue, so that each packet only needs to be examined once.
+    bool mFragmentScanValid;
+    uint32_t mFragmentScanStartSeqNo;
+    uint32_t mFragmentScanEndSeqNo;
+    size_t mFragmentScanSize;
+    size_t mFragmentScanCount;
+
     AssemblyStatus addNALUnit(const sp<ARTPSource> &source);
     void addSingleNALUnit(const sp<ABuffer> &buffer);
-    AssemblyStatus addFragmentedNALUnit(List<sp<ABuffer> > *queue);
+    AssemblyStatus addFragmentedNALUnit(ARTPPacketQueue *queue);
     bool addSingleTimeAggregationPacket(const sp<ABuffer> &buffer);
 
     void submitAccessUnit();
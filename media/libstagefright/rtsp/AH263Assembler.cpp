@@ -53,21 +53,18 @@ ARTPAssembler::AssemblyStatus AH263Assembler::assembleMore(
 
 ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
         const sp<ARTPSource> &source) {
-    List<sp<ABuffer> > *queue = source->queue();
+    ARTPPacketQueue *queue = source->queue();
 
     if (queue->empty()) {
         return NOT_ENOUGH_DATA;
     }
 
     if (mNextExpectedSeqNoValid) {
-        List<sp<ABuffer> >::iterator it = queue->begin();
-        while (it != queue->end()) {
-            if ((uint32_t)(*it)->int32Data() >= mNextExpectedSeqNo) {
-                break;
-            }
+        while (!queue->empty()
+                && (uint32_t)queue->front()->int32Data() < mNextExpectedSeqNo) {
             AVMediaServiceUtils::get()->addH263AdvancedPacket(
-                    *it, &mPackets, mAccessUnitRTPTime);
-            it = queue->erase(it);
+                    queue->front(), &mPackets, mAccessUnitRTPTime);
+            queue->popFront();
         }
 
         if (queue->empty()) {
@@ -75,7 +72,7 @@ ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
         }
     }
 
-    sp<ABuffer> buffer = *queue->begin();
+    sp<ABuffer> buffer = queue->front();
 
     if (!mNextExpectedSeqNoValid) {
         mNextExpectedSeqNoValid = true;
@@ -99,7 +96,7 @@ ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
     // hexdump(buffer->data(), buffer->size());
 
     if (buffer->size() < 2) {
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
 
         return MALFORMED_PACKET;
@@ -113,7 +110,7 @@ ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
 
     // V=0
     if (V != 0u) {
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
         ALOGW("Packet discarded due to VRC (V != 0)");
         return MALFORMED_PACKET;
@@ -121,7 +118,7 @@ ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
 
     // PLEN=0
     if (PLEN != 0u) {
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
         ALOGW("Packet discarded (PLEN != 0)");
         return MALFORMED_PACKET;
@@ -129,7 +126,7 @@ ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
 
     // PEBIT=0
     if (PEBIT != 0u) {
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
         ALOGW("Packet discarded (PEBIT != 0)");
         return MALFORMED_PACKET;
@@ -146,7 +143,7 @@ ARTPAssembler::AssemblyStatus AH263Assembler::addPacket(
 
     mPackets.push_back(buffer);
 
-    queue->erase(queue->begin());
+    queue->popFront();
     ++mNextExpectedSeqNo;
 
     return OK;
@@ -493,28 +493,21 @@ ARTPAssembler::AssemblyStatus AMPEG4AudioAssembler::assembleMore(
 
 ARTPAssembler::AssemblyStatus AMPEG4AudioAssembler::addPacket(
         const sp<ARTPSource> &source) {
-    List<sp<ABuffer> > *queue = source->queue();
+    ARTPPacketQueue *queue = source->queue();
 
     if (queue->empty()) {
         return NOT_ENOUGH_DATA;
     }
 
     if (mNextExpectedSeqNoValid) {
-        List<sp<ABuffer> >::iterator it = queue->begin();
-        while (it != queue->end()) {
-            if ((uint32_t)(*it)->int32Data() >= mNextExpectedSeqNo) {
-                break;
-            }
-
-            it = queue->erase(it);
-        }
+        queue->dropBefore(mNextExpectedSeqNo);
 
         if (queue->empty()) {
             return NOT_ENOUGH_DATA;
         }
     }
 
-    sp<ABuffer> buffer = *queue->begin();
+    sp<ABuffer> buffer = queue->front();
 
     if (!mNextExpectedSeqNoValid) {
         mNextExpectedSeqNoValid = true;
@@ -537,7 +530,7 @@ ARTPAssembler::AssemblyStatus AMPEG4AudioAssembler::addPacket(
 
     mPackets.push_back(buffer);
 
-    queue->erase(queue->begin());
+    queue->popFront();
     ++mNextExpectedSeqNo;
 
     return OK;
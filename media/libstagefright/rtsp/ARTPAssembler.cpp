@@ -21,12 +21,25 @@
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 
+#include <cutils/properties.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 namespace android {
 
+// How long to wait for a missing packet before declaring it lost.
+static const int64_t kDefaultPlayoutDelayUs = 10000ll;
+
 ARTPAssembler::ARTPAssembler()
-    : mFirstFailureTimeUs(-1) {
+    : mFirstFailureTimeUs(-1),
+      mPlayoutDelayUs(kDefaultPlayoutDelayUs) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("rtsp.rtp.playout_delay_ms", value, NULL) > 0) {
+        int delayMs = atoi(value);
+        if (delayMs >= 0) {
+            mPlayoutDelayUs = delayMs * 1000ll;
+        }
+    }
 }
 
 void ARTPAssembler::onPacketReceived(const sp<ARTPSource> &source) {
@@ -36,7 +49,8 @@ void ARTPAssembler::onPacketReceived(const sp<ARTPSource> &source) {
 
         if (status == WRONG_SEQUENCE_NUMBER) {
             if (mFirstFailureTimeUs >= 0) {
-                if (ALooper::GetNowUs() - mFirstFailureTimeUs > 10000ll) {
+                if (ALooper::GetNowUs() - mFirstFailureTimeUs
+                        > mPlayoutDelayUs) {
                     mFirstFailureTimeUs = -1;
 
                     // LOG(VERBOSE) << "waited too long for packet.";
@@ -58,6 +58,9 @@ protected:
 private:
     int64_t mFirstFailureTimeUs;
 
+    // Set through the rtsp.rtp.playout_delay_ms property.
+    int64_t mPlayoutDelayUs;
+
     DISALLOW_EVIL_CONSTRUCTORS(ARTPAssembler);
 };
 
@@ -31,12 +31,25 @@
 #include <media/stagefright/foundation/hexdump.h>
 
 #include <arpa/inet.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 namespace android {
 
 static const size_t kMaxUDPSize = 1500;
 
+// RTP datagrams are pulled off a socket with a single recvmmsg call in
+// batches of up to this many.
+static const size_t kMaxDatagramsPerBatch = 16;
+static const size_t kMaxDatagramSize = 65536;
+
+static inline bool isTruncated(const struct mmsghdr &msg) {
+    return msg.msg_hdr.msg_flags & MSG_TRUNC;
+}
+
+static const int kMaxPollEvents = 16;
+
 static uint16_t u16at(const uint8_t *data) {
     return data[0] << 8 | data[1];
 }
@@ -50,7 +63,7 @@ static uint64_t u64at(const uint8_t *data) {
 }
 
 // static
-const int64_t ARTPConnection::kSelectTimeoutUs = 1000ll;
+const int64_t ARTPConnection::kPollTimeoutUs = 1000ll;
 
 struct ARTPConnection::StreamInfo {
     int mRTPSocket;
@@ -70,10 +83,15 @@ struct ARTPConnection::StreamInfo {
 ARTPConnection::ARTPConnection(uint32_t flags)
     : mFlags(flags),
       mPollEventPending(false),
-      mLastReceiverReportTimeUs(-1) {
+      mLastReceiverReportTimeUs(-1),
+      mReceiveBufferSize(kMaxUDPSize) {
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    CHECK_GE(mEpollFd, 0);
 }
 
 ARTPConnection::~ARTPConnection() {
+    close(mEpollFd);
+    mEpollFd = -1;
 }
 
 void ARTPConnection::addStream(
@@ -212,6 +230,7 @@ void ARTPConnection::onAddStream(const sp<AMessage> &msg) {
     memset(&info->mRemoteRTCPAddr, 0, sizeof(info->mRemoteRTCPAddr));
 
     if (!injected) {
+        watchStream(*info);
         postPollEvent();
     }
 }
@@ -231,9 +250,33 @@ void ARTPConnection::onRemoveStream(const sp<AMessage> &msg) {
         return;
     }
 
+    unwatchStream(*it);
     mStreams.erase(it);
 }
 
+void ARTPConnection::watchStream(const StreamInfo &info) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+
+    ev.data.fd = info.mRTPSocket;
+    CHECK_EQ(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, info.mRTPSocket, &ev), 0);
+
+    ev.data.fd = info.mRTCPSocket;
+    CHECK_EQ(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, info.mRTCPSocket, &ev), 0);
+}
+
+void ARTPConnection::unwatchStream(const StreamInfo &info) {
+    if (info.mIsInjected) {
+        return;
+    }
+
+    // The sockets may already have been closed by their owner, in which
+    // case the kernel has dropped them from the epoll set already.
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, info.mRTPSocket, NULL);
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, info.mRTCPSocket, NULL);
+}
+
 void ARTPConnection::postPollEvent() {
     if (mPollEventPending) {
         return;
@@ -252,62 +295,55 @@ void ARTPConnection::onPollStreams() {
         return;
     }
 
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = kSelectTimeoutUs;
-
-    fd_set rs;
-    FD_ZERO(&rs);
-
-    int maxSocket = -1;
+    bool havePolledStreams = false;
     for (List<StreamInfo>::iterator it = mStreams.begin();
          it != mStreams.end(); ++it) {
-        if ((*it).mIsInjected) {
-            continue;
-        }
-
-        FD_SET(it->mRTPSocket, &rs);
-        FD_SET(it->mRTCPSocket, &rs);
-
-        if (it->mRTPSocket > maxSocket) {
-            maxSocket = it->mRTPSocket;
-        }
-        if (it->mRTCPSocket > maxSocket) {
-            maxSocket = it->mRTCPSocket;
+        if (!(*it).mIsInjected) {
+            havePolledStreams = true;
+            break;
         }
     }
 
-    if (maxSocket == -1) {
+    if (!havePolledStreams) {
         return;
     }
 
-    int res = select(maxSocket + 1, &rs, NULL, NULL, &tv);
+    struct epoll_event events[kMaxPollEvents];
+
+    int res;
+    do {
+        res = epoll_wait(
+                mEpollFd, events, kMaxPollEvents, (int)(kPollTimeoutUs / 1000ll));
+    } while (res < 0 && errno == EINTR);
+
+    for (int i = 0; i < res; ++i) {
+        int fd = events[i].data.fd;
 
-    if (res > 0) {
         List<StreamInfo>::iterator it = mStreams.begin();
-        while (it != mStreams.end()) {
-            if ((*it).mIsInjected) {
-                ++it;
-                continue;
-            }
+        while (it != mStreams.end()
+                && ((*it).mIsInjected
+                    || (it->mRTPSocket != fd && it->mRTCPSocket != fd))) {
+            ++it;
+        }
 
-            status_t err = OK;
-            if (FD_ISSET(it->mRTPSocket, &rs)) {
-                err = receive(&*it, true);
-            }
-            if (err == OK && FD_ISSET(it->mRTCPSocket, &rs)) {
-                err = receive(&*it, false);
-            }
+        if (it == mStreams.end()) {
+            // The stream went away while handling an earlier event.
+            continue;
+        }
 
-            if (err == -ECONNRESET) {
-                // socket failure, this stream is dead, Jim.
+        status_t err;
+        if (fd == it->mRTPSocket) {
+            err = receiveRTP(&*it);
+        } else {
+            err = receiveRTCP(&*it);
+        }
 
-                ALOGW("failed to receive RTP/RTCP datagram.");
-                it = mStreams.erase(it);
-                continue;
-            }
+        if (err == -ECONNRESET) {
+            // socket failure, this stream is dead, Jim.
 
-            ++it;
+            ALOGW("failed to receive RTP/RTCP datagram.");
+            unwatchStream(*it);
+            mStreams.erase(it);
         }
     }
 
@@ -358,6 +394,7 @@ void ARTPConnection::onPollStreams() {
                     ALOGW("failed to send RTCP receiver report (%s).",
                          n == 0 ? "connection gone" : strerror(errno));
 
+                    unwatchStream(*it);
                     it = mStreams.erase(it);
                     continue;
                 }
@@ -376,21 +413,113 @@ void ARTPConnection::onPollStreams() {
     }
 }
 
-status_t ARTPConnection::receive(StreamInfo *s, bool receiveRTP) {
-    ALOGV("receiving %s", receiveRTP ? "RTP" : "RTCP");
+status_t ARTPConnection::receiveRTP(StreamInfo *s) {
+    ALOGV("receiving RTP");
+
+    CHECK(!s->mIsInjected);
+
+    struct iovec iov[kMaxDatagramsPerBatch];
+    struct mmsghdr msgs[kMaxDatagramsPerBatch];
+    memset(msgs, 0, sizeof(msgs));
+
+    // Datagrams are received straight into the buffers handed to the
+    // sources. A buffer still held by a source or an assembler is left to
+    // them and replaced, the others are used again.
+    mReceiveBuffers.resize(kMaxDatagramsPerBatch);
+    for (size_t i = 0; i < kMaxDatagramsPerBatch; ++i) {
+        sp<ABuffer> &buffer = mReceiveBuffers.editItemAt(i);
+        if (buffer == NULL || buffer->getStrongCount() > 1
+                || buffer->capacity() < mReceiveBufferSize) {
+            buffer = new ABuffer(mReceiveBufferSize);
+        } else {
+            buffer->meta()->clear();
+        }
+
+        iov[i].iov_base = buffer->base();
+        iov[i].iov_len = buffer->capacity();
+
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int n;
+    do {
+        n = recvmmsg(
+            s->mRTPSocket, msgs, kMaxDatagramsPerBatch, MSG_DONTWAIT, NULL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return OK;
+    }
+
+    if (n <= 0) {
+        return -ECONNRESET;
+    }
+
+    // Hand consecutive packets from the same source over in one go, so
+    // the assembler runs once per batch instead of once per packet.
+    sp<ARTPSource> batchSource;
+    List<sp<ABuffer> > batch;
+
+    status_t err = OK;
+    for (int i = 0; i < n; ++i) {
+        size_t nbytes = msgs[i].msg_len;
+        if (nbytes == 0) {
+            err = -ECONNRESET;
+            break;
+        }
+
+        if (isTruncated(msgs[i])) {
+            // RTP senders keep their packets within the path MTU, but one
+            // that relies on IP fragmentation has to be given room.
+            if (mReceiveBufferSize < kMaxDatagramSize) {
+                ALOGW("dropping truncated RTP datagram, "
+                      "receiving up to %zu bytes from now on.",
+                      kMaxDatagramSize);
+                mReceiveBufferSize = kMaxDatagramSize;
+            }
+            continue;
+        }
+
+        sp<ABuffer> buffer = mReceiveBuffers.itemAt(i);
+        buffer->setRange(0, nbytes);
+
+        sp<ARTPSource> source;
+        if (parseRTPHeader(s, buffer, &source) != OK) {
+            continue;
+        }
+
+        if (source != batchSource && !batch.empty()) {
+            batchSource->processRTPPackets(batch);
+            batch.clear();
+        }
+
+        batchSource = source;
+        batch.push_back(buffer);
+    }
+
+    if (!batch.empty()) {
+        batchSource->processRTPPackets(batch);
+    }
+
+    return err;
+}
+
+status_t ARTPConnection::receiveRTCP(StreamInfo *s) {
+    ALOGV("receiving RTCP");
 
     CHECK(!s->mIsInjected);
 
     sp<ABuffer> buffer = new ABuffer(65536);
 
     socklen_t remoteAddrLen =
-        (!receiveRTP && s->mNumRTCPPacketsReceived == 0)
+        (s->mNumRTCPPacketsReceived == 0)
             ? sizeof(s->mRemoteRTCPAddr) : 0;
 
     ssize_t nbytes;
     do {
         nbytes = recvfrom(
-            receiveRTP ? s->mRTPSocket : s->mRTCPSocket,
+            s->mRTCPSocket,
             buffer->data(),
             buffer->capacity(),
             0,
@@ -406,17 +535,23 @@ status_t ARTPConnection::receive(StreamInfo *s, bool receiveRTP) {
 
     // ALOGI("received %d bytes.", buffer->size());
 
-    status_t err;
-    if (receiveRTP) {
-        err = parseRTP(s, buffer);
-    } else {
-        err = parseRTCP(s, buffer);
+    return parseRTCP(s, buffer);
+}
+
+status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
+    sp<ARTPSource> source;
+    status_t err = parseRTPHeader(s, buffer, &source);
+    if (err != OK) {
+        return err;
     }
 
-    return err;
+    source->processRTPPacket(buffer);
+
+    return OK;
 }
 
-status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
+status_t ARTPConnection::parseRTPHeader(
+        StreamInfo *s, const sp<ABuffer> &buffer, sp<ARTPSource> *source) {
     if (s->mNumRTPPacketsReceived++ == 0) {
         sp<AMessage> notify = s->mNotifyMsg->dup();
         notify->setInt32("first-rtp", true);
@@ -484,7 +619,7 @@ status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
 
     uint32_t srcId = u32at(&data[8]);
 
-    sp<ARTPSource> source = findSource(s, srcId);
+    *source = findSource(s, srcId);
 
     uint32_t rtpTime = u32at(&data[4]);
 
@@ -497,8 +632,6 @@ status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
     buffer->setInt32Data(u16at(&data[2]));
     buffer->setRange(payloadOffset, size - payloadOffset);
 
-    source->processRTPPacket(buffer);
-
     return OK;
 }
 
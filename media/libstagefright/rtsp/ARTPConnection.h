@@ -20,6 +20,7 @@
 
 #include <media/stagefright/foundation/AHandler.h>
 #include <utils/List.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -63,7 +64,7 @@ protected:
         kWhatInjectPacket,
     };
 
-    static const int64_t kSelectTimeoutUs;
+    static const int64_t kPollTimeoutUs;
 
     uint32_t mFlags;
 
@@ -73,15 +74,31 @@ protected:
     bool mPollEventPending;
     int64_t mLastReceiverReportTimeUs;
 
+    // All non-injected RTP and RTCP sockets are registered with mEpollFd.
+    int mEpollFd;
+
+    // Buffers that a batch of RTP datagrams is received into, each
+    // mReceiveBufferSize bytes. That starts out as an Ethernet MTU and
+    // grows only once a datagram has been truncated.
+    Vector<sp<ABuffer> > mReceiveBuffers;
+    size_t mReceiveBufferSize;
+
     virtual void onAddStream(const sp<AMessage> &msg);
     void onRemoveStream(const sp<AMessage> &msg);
     void onPollStreams();
     void onInjectPacket(const sp<AMessage> &msg);
     void onSendReceiverReports();
 
-    status_t receive(StreamInfo *info, bool receiveRTP);
+    void watchStream(const StreamInfo &info);
+    void unwatchStream(const StreamInfo &info);
+
+    status_t receiveRTP(StreamInfo *info);
+    status_t receiveRTCP(StreamInfo *info);
 
     status_t parseRTP(StreamInfo *info, const sp<ABuffer> &buffer);
+    status_t parseRTPHeader(
+            StreamInfo *info, const sp<ABuffer> &buffer,
+            sp<ARTPSource> *source);
     status_t parseRTCP(StreamInfo *info, const sp<ABuffer> &buffer);
     status_t parseSR(StreamInfo *info, const uint8_t *data, size_t size);
     status_t parseBYE(StreamInfo *info, const uint8_t *data, size_t size);
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ARTPPacketQueue"
+#include <utils/Log.h>
+
+#include "ARTPPacketQueue.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+
+#include <string.h>
+
+namespace android {
+
+ARTPPacketQueue::ARTPPacketQueue()
+    : mMask(kInitialCapacity - 1),
+      mFirstSeqNum(0),
+      mEndSeqNum(0),
+      mSize(0) {
+    memset(&mStats, 0, sizeof(mStats));
+    mSlots.resize(kInitialCapacity);
+}
+
+bool ARTPPacketQueue::insert(const sp<ABuffer> &buffer) {
+    uint32_t seqNum = (uint32_t)buffer->int32Data();
+
+    ++mStats.mNumInserted;
+
+    if (mSize == 0) {
+        mFirstSeqNum = seqNum;
+        mEndSeqNum = seqNum + 1;
+    } else if (seqNum >= mEndSeqNum) {
+        if (seqNum - mFirstSeqNum >= kMaxCapacity) {
+            // The sender jumped ahead, make room by giving up on the
+            // oldest packets.
+            ALOGW("Sequence number jumped from %u to %u, dropping old packets",
+                  mFirstSeqNum, seqNum);
+
+            dropBefore(seqNum - kMaxCapacity + 1);
+
+            if (mSize == 0) {
+                mFirstSeqNum = seqNum;
+            }
+        }
+
+        if (seqNum - mFirstSeqNum >= mSlots.size()) {
+            grow(seqNum - mFirstSeqNum + 1);
+        }
+
+        mEndSeqNum = seqNum + 1;
+    } else if (seqNum < mFirstSeqNum) {
+        if (mEndSeqNum - seqNum > kMaxCapacity) {
+            ++mStats.mNumTooLate;
+            return false;
+        }
+
+        if (mEndSeqNum - seqNum > mSlots.size()) {
+            grow(mEndSeqNum - seqNum);
+        }
+
+        mFirstSeqNum = seqNum;
+    } else if (mSlots[seqNum & mMask] != NULL) {
+        ++mStats.mNumDuplicates;
+        return false;
+    }
+
+    if (seqNum + 1 < mEndSeqNum) {
+        ++mStats.mNumReordered;
+
+        uint32_t depth = mEndSeqNum - 1 - seqNum;
+        if (depth > mStats.mMaxReorderDepth) {
+            mStats.mMaxReorderDepth = depth;
+        }
+    }
+
+    mSlots.editItemAt(seqNum & mMask) = buffer;
+    ++mSize;
+
+    return true;
+}
+
+const sp<ABuffer> &ARTPPacketQueue::front() const {
+    CHECK(mSize > 0);
+
+    return mSlots[mFirstSeqNum & mMask];
+}
+
+void ARTPPacketQueue::popFront() {
+    CHECK(mSize > 0);
+
+    mSlots.editItemAt(mFirstSeqNum & mMask).clear();
+    --mSize;
+
+    ++mFirstSeqNum;
+    skipEmptySlots();
+}
+
+sp<ABuffer> ARTPPacketQueue::find(uint32_t seqNum) const {
+    if (mSize == 0 || seqNum < mFirstSeqNum || seqNum >= mEndSeqNum) {
+        return NULL;
+    }
+
+    return mSlots[seqNum & mMask];
+}
+
+void ARTPPacketQueue::dropBefore(uint32_t seqNum) {
+    while (mSize > 0 && mFirstSeqNum < seqNum) {
+        popFront();
+    }
+}
+
+void ARTPPacketQueue::clear() {
+    while (mSize > 0) {
+        popFront();
+    }
+}
+
+size_t ARTPPacketQueue::numMissing() const {
+    if (mSize == 0) {
+        return 0;
+    }
+
+    return (mEndSeqNum - mFirstSeqNum) - mSize;
+}
+
+void ARTPPacketQueue::getMissing(
+        Vector<uint32_t> *seqNums, size_t maxCount) const {
+    if (mSize == 0) {
+        return;
+    }
+
+    size_t count = 0;
+    for (uint32_t seqNum = mFirstSeqNum;
+            seqNum != mEndSeqNum && count < maxCount; ++seqNum) {
+        if (mSlots[seqNum & mMask] == NULL) {
+            seqNums->push_back(seqNum);
+            ++count;
+        }
+    }
+}
+
+void ARTPPacketQueue::grow(size_t minCapacity) {
+    size_t capacity = mSlots.size();
+    while (capacity < minCapacity) {
+        capacity *= 2;
+    }
+
+    ALOGV("growing packet queue to %zu entries", capacity);
+
+    Vector<sp<ABuffer> > slots;
+    slots.resize(capacity);
+
+    size_t mask = capacity - 1;
+    for (uint32_t seqNum = mFirstSeqNum; seqNum != mEndSeqNum; ++seqNum) {
+        slots.editItemAt(seqNum & mask) = mSlots[seqNum & mMask];
+    }
+
+    mSlots = slots;
+    mMask = mask;
+}
+
+void ARTPPacketQueue::skipEmptySlots() {
+    if (mSize == 0) {
+        mFirstSeqNum = mEndSeqNum;
+        return;
+    }
+
+    while (mSlots[mFirstSeqNum & mMask] == NULL) {
+        ++mFirstSeqNum;
+    }
+}
+
+}  // namespace android
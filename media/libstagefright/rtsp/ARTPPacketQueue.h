@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef A_RTP_PACKET_QUEUE_H_
+
+#define A_RTP_PACKET_QUEUE_H_
+
+#include <stdint.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+
+// Reorder queue for the packets of a single RTP source. Packets are kept
+// in a circular array indexed by their extended sequence number (stored
+// in the buffer's int32Data), so that insertion, lookup by sequence number
+// and removal from the front are all O(1), and the sequence numbers that
+// are still missing can be enumerated, e.g. for generating NACKs.
+struct ARTPPacketQueue {
+    ARTPPacketQueue();
+
+    // Returns false if the packet was discarded, either because a packet
+    // with the same sequence number is already queued or because it is
+    // too old to fit in the queue.
+    bool insert(const sp<ABuffer> &buffer);
+
+    bool empty() const { return mSize == 0; }
+    size_t size() const { return mSize; }
+
+    // The queued packet with the lowest sequence number.
+    const sp<ABuffer> &front() const;
+    void popFront();
+
+    // Returns the packet with the given sequence number, or NULL if it
+    // has not been received.
+    sp<ABuffer> find(uint32_t seqNum) const;
+
+    // Discards all packets with a sequence number lower than seqNum.
+    void dropBefore(uint32_t seqNum);
+
+    void clear();
+
+    // One past the highest sequence number queued.
+    uint32_t endSeqNum() const { return mEndSeqNum; }
+
+    // Number of sequence numbers between the first and the last queued
+    // packet that have not been received (yet).
+    size_t numMissing() const;
+
+    // Appends up to maxCount of the missing sequence numbers, in order.
+    void getMissing(Vector<uint32_t> *seqNums, size_t maxCount) const;
+
+    struct Stats {
+        uint64_t mNumInserted;
+        uint64_t mNumReordered;     // arrived after a higher sequence number
+        uint64_t mNumDuplicates;
+        uint64_t mNumTooLate;       // older than anything the queue can hold
+        uint32_t mMaxReorderDepth;  // in sequence numbers
+    };
+
+    const Stats &stats() const { return mStats; }
+
+private:
+    enum {
+        kInitialCapacity = 64,
+        // Bounds how far apart the first and last queued packet can be.
+        kMaxCapacity = 16384,
+    };
+
+    Vector<sp<ABuffer> > mSlots;
+    size_t mMask;
+
+    // Packets are only ever queued in [mFirstSeqNum, mEndSeqNum), and the
+    // slot for mFirstSeqNum is occupied unless the queue is empty.
+    uint32_t mFirstSeqNum;
+    uint32_t mEndSeqNum;
+    size_t mSize;
+
+    Stats mStats;
+
+    void grow(size_t minCapacity);
+    void skipEmptySlots();
+
+    DISALLOW_EVIL_CONSTRUCTORS(ARTPPacketQueue);
+};
+
+}  // namespace android
+
+#endif  // A_RTP_PACKET_QUEUE_H_
@@ -91,6 +91,20 @@ void ARTPSource::processRTPPacket(const sp<ABuffer> &buffer) {
     }
 }
 
+void ARTPSource::processRTPPackets(const List<sp<ABuffer> > &buffers) {
+    bool queued = false;
+    for (List<sp<ABuffer> >::const_iterator it = buffers.begin();
+         it != buffers.end(); ++it) {
+        if (queuePacket(*it)) {
+            queued = true;
+        }
+    }
+
+    if (queued && mAssembler != NULL) {
+        mAssembler->onPacketReceived(this);
+    }
+}
+
 void ARTPSource::timeUpdate(uint32_t rtpTime, uint64_t ntpTime) {
     mLastNTPTime = ntpTime;
     mLastNTPTimeUpdateUs = ALooper::GetNowUs();
@@ -107,8 +121,7 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
 
     if (mNumBuffersReceived++ == 0) {
         mHighestSeqNumber = seqNum;
-        mQueue.push_back(buffer);
-        return true;
+        return mQueue.insert(buffer);
     }
 
     // Only the lower 16-bit of the sequence numbers are transmitted,
@@ -151,22 +164,25 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
 
     buffer->setInt32Data(seqNum);
 
-    List<sp<ABuffer> >::iterator it = mQueue.begin();
-    while (it != mQueue.end() && (uint32_t)(*it)->int32Data() < seqNum) {
-        ++it;
-    }
-
-    if (it != mQueue.end() && (uint32_t)(*it)->int32Data() == seqNum) {
-        ALOGW("Discarding duplicate buffer");
+    if (!mQueue.insert(buffer)) {
+        ALOGW("Discarding duplicate or late buffer");
         return false;
     }
 
-    mQueue.insert(it, buffer);
-
     return true;
 }
 
 void ARTPSource::byeReceived() {
+    const ARTPPacketQueue::Stats &stats = mQueue.stats();
+    ALOGV("source 0x%08x: %llu packets, %llu reordered (max depth %u), "
+          "%llu duplicates, %llu too late",
+          mID,
+          (unsigned long long)stats.mNumInserted,
+          (unsigned long long)stats.mNumReordered,
+          stats.mMaxReorderDepth,
+          (unsigned long long)stats.mNumDuplicates,
+          (unsigned long long)stats.mNumTooLate);
+
     mAssembler->onByeReceived();
 }
 
@@ -24,6 +24,8 @@
 #include <utils/List.h>
 #include <utils/RefBase.h>
 
+#include "ARTPPacketQueue.h"
+
 namespace android {
 
 struct ABuffer;
@@ -38,10 +40,13 @@ struct ARTPSource : public RefBase {
             const sp<AMessage> &notify);
 
     void processRTPPacket(const sp<ABuffer> &buffer);
+
+    // Queues all of the packets before running the assembler once.
+    void processRTPPackets(const List<sp<ABuffer> > &buffers);
     void timeUpdate(uint32_t rtpTime, uint64_t ntpTime);
     void byeReceived();
 
-    List<sp<ABuffer> > *queue() { return &mQueue; }
+    ARTPPacketQueue *queue() { return &mQueue; }
 
     void addReceiverReport(const sp<ABuffer> &buffer);
     void addFIR(const sp<ABuffer> &buffer);
@@ -51,7 +56,7 @@ private:
     uint32_t mHighestSeqNumber;
     int32_t mNumBuffersReceived;
 
-    List<sp<ABuffer> > mQueue;
+    ARTPPacketQueue mQueue;
     sp<ARTPAssembler> mAssembler;
 
     uint64_t mLastNTPTime;
@@ -48,7 +48,8 @@ ARTPWriter::ARTPWriter(int fd)
     : mFlags(0),
       mFd(dup(fd)),
       mLooper(new ALooper),
-      mReflector(new AHandlerReflector<ARTPWriter>(this)) {
+      mReflector(new AHandlerReflector<ARTPWriter>(this)),
+      mNumPendingPackets(0) {
     CHECK_GE(fd, 0);
 
     mLooper->setName("rtp writer");
@@ -327,6 +328,82 @@ void ARTPWriter::send(const sp<ABuffer> &buffer, bool isRTCP) {
 #endif
 }
 
+uint8_t *ARTPWriter::queueRTPPacket(
+        size_t headerSize, const uint8_t *payload, size_t payloadSize) {
+    CHECK_LE(headerSize, (size_t)kMaxPacketHeaderSize);
+
+    if (mNumPendingPackets == kMaxPacketsPerBatch) {
+        flushRTPPackets();
+    }
+
+    size_t i = mNumPendingPackets++;
+
+    mPacketIOV[i][0].iov_base = mPacketHeaders[i];
+    mPacketIOV[i][0].iov_len = headerSize;
+    mPacketIOV[i][1].iov_base = const_cast<uint8_t *>(payload);
+    mPacketIOV[i][1].iov_len = payloadSize;
+
+    ++mNumRTPSent;
+    mNumRTPOctetsSent += headerSize - 12 + payloadSize;
+
+    return mPacketHeaders[i];
+}
+
+void ARTPWriter::flushRTPPackets() {
+    struct mmsghdr msgs[kMaxPacketsPerBatch];
+    memset(msgs, 0, sizeof(msgs));
+
+    for (size_t i = 0; i < mNumPendingPackets; ++i) {
+        msgs[i].msg_hdr.msg_name = &mRTPAddr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(mRTPAddr);
+        msgs[i].msg_hdr.msg_iov = mPacketIOV[i];
+        msgs[i].msg_hdr.msg_iovlen = 2;
+    }
+
+    size_t numSent = 0;
+    while (numSent < mNumPendingPackets) {
+        int n = sendmmsg(
+                mSocket, &msgs[numSent], mNumPendingPackets - numSent, 0);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        CHECK_GT(n, 0);
+        numSent += n;
+    }
+
+#if LOG_TO_FILES
+    for (size_t i = 0; i < mNumPendingPackets; ++i) {
+        uint32_t ms = tolel(ALooper::GetNowUs() / 1000ll);
+        uint32_t length =
+            tolel(mPacketIOV[i][0].iov_len + mPacketIOV[i][1].iov_len);
+        write(mRTPFd, &ms, sizeof(ms));
+        write(mRTPFd, &length, sizeof(length));
+        writev(mRTPFd, mPacketIOV[i], 2);
+    }
+#endif
+
+    mNumPendingPackets = 0;
+}
+
+void ARTPWriter::writeRTPHeader(uint8_t *data, bool marker, uint32_t rtpTime) {
+    data[0] = 0x80;
+    data[1] = (marker ? (1 << 7) : 0x00) | PT;  // M-bit
+    data[2] = (mSeqNo >> 8) & 0xff;
+    data[3] = mSeqNo & 0xff;
+    data[4] = rtpTime >> 24;
+    data[5] = (rtpTime >> 16) & 0xff;
+    data[6] = (rtpTime >> 8) & 0xff;
+    data[7] = rtpTime & 0xff;
+    data[8] = mSourceID >> 24;
+    data[9] = (mSourceID >> 16) & 0xff;
+    data[10] = (mSourceID >> 8) & 0xff;
+    data[11] = mSourceID & 0xff;
+
+    ++mSeqNo;
+}
+
 void ARTPWriter::addSR(const sp<ABuffer> &buffer) {
     uint8_t *data = buffer->data() + buffer->size();
 
@@ -579,33 +656,10 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
     const uint8_t *mediaData =
         (const uint8_t *)mediaBuf->data() + mediaBuf->range_offset();
 
-    sp<ABuffer> buffer = new ABuffer(kMaxPacketSize);
-    if (mediaBuf->range_length() + 12 <= buffer->capacity()) {
+    if (mediaBuf->range_length() + 12 <= kMaxPacketSize) {
         // The data fits into a single packet
-        uint8_t *data = buffer->data();
-        data[0] = 0x80;
-        data[1] = (1 << 7) | PT;  // M-bit
-        data[2] = (mSeqNo >> 8) & 0xff;
-        data[3] = mSeqNo & 0xff;
-        data[4] = rtpTime >> 24;
-        data[5] = (rtpTime >> 16) & 0xff;
-        data[6] = (rtpTime >> 8) & 0xff;
-        data[7] = rtpTime & 0xff;
-        data[8] = mSourceID >> 24;
-        data[9] = (mSourceID >> 16) & 0xff;
-        data[10] = (mSourceID >> 8) & 0xff;
-        data[11] = mSourceID & 0xff;
-
-        memcpy(&data[12],
-               mediaData, mediaBuf->range_length());
-
-        buffer->setRange(0, mediaBuf->range_length() + 12);
-
-        send(buffer, false /* isRTCP */);
-
-        ++mSeqNo;
-        ++mNumRTPSent;
-        mNumRTPOctetsSent += buffer->size() - 12;
+        uint8_t *data = queueRTPPacket(12, mediaData, mediaBuf->range_length());
+        writeRTPHeader(data, true /* marker */, rtpTime);
     } else {
         // FU-A
 
@@ -616,24 +670,13 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
         while (offset < mediaBuf->range_length()) {
             size_t size = mediaBuf->range_length() - offset;
             bool lastPacket = true;
-            if (size + 12 + 2 > buffer->capacity()) {
+            if (size + 12 + 2 > kMaxPacketSize) {
                 lastPacket = false;
-                size = buffer->capacity() - 12 - 2;
+                size = kMaxPacketSize - 12 - 2;
             }
 
-            uint8_t *data = buffer->data();
-            data[0] = 0x80;
-            data[1] = (lastPacket ? (1 << 7) : 0x00) | PT;  // M-bit
-            data[2] = (mSeqNo >> 8) & 0xff;
-            data[3] = mSeqNo & 0xff;
-            data[4] = rtpTime >> 24;
-            data[5] = (rtpTime >> 16) & 0xff;
-            data[6] = (rtpTime >> 8) & 0xff;
-            data[7] = rtpTime & 0xff;
-            data[8] = mSourceID >> 24;
-            data[9] = (mSourceID >> 16) & 0xff;
-            data[10] = (mSourceID >> 8) & 0xff;
-            data[11] = mSourceID & 0xff;
+            uint8_t *data = queueRTPPacket(14, &mediaData[offset], size);
+            writeRTPHeader(data, lastPacket, rtpTime);
 
             data[12] = 28 | (nalType & 0xe0);
 
@@ -644,21 +687,13 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
                 | (lastPacket ? 0x40 : 0x00)
                 | (nalType & 0x1f);
 
-            memcpy(&data[14], &mediaData[offset], size);
-
-            buffer->setRange(0, 14 + size);
-
-            send(buffer, false /* isRTCP */);
-
-            ++mSeqNo;
-            ++mNumRTPSent;
-            mNumRTPOctetsSent += buffer->size() - 12;
-
             firstPacket = false;
             offset += size;
         }
     }
 
+    flushRTPPackets();
+
     mLastRTPTime = rtpTime;
     mLastNTPTime = GetNowNTP();
 }
@@ -683,44 +718,23 @@ void ARTPWriter::sendH263Data(MediaBuffer *mediaBuf) {
     size_t size = mediaBuf->range_length();
 
     while (offset < size) {
-        sp<ABuffer> buffer = new ABuffer(kMaxPacketSize);
-        // CHECK_LE(mediaBuf->range_length() -2 + 14, buffer->capacity());
-
         size_t remaining = size - offset;
-        bool lastPacket = (remaining + 14 <= buffer->capacity());
+        bool lastPacket = (remaining + 14 <= kMaxPacketSize);
         if (!lastPacket) {
-            remaining = buffer->capacity() - 14;
+            remaining = kMaxPacketSize - 14;
         }
 
-        uint8_t *data = buffer->data();
-        data[0] = 0x80;
-        data[1] = (lastPacket ? 0x80 : 0x00) | PT;  // M-bit
-        data[2] = (mSeqNo >> 8) & 0xff;
-        data[3] = mSeqNo & 0xff;
-        data[4] = rtpTime >> 24;
-        data[5] = (rtpTime >> 16) & 0xff;
-        data[6] = (rtpTime >> 8) & 0xff;
-        data[7] = rtpTime & 0xff;
-        data[8] = mSourceID >> 24;
-        data[9] = (mSourceID >> 16) & 0xff;
-        data[10] = (mSourceID >> 8) & 0xff;
-        data[11] = mSourceID & 0xff;
+        uint8_t *data = queueRTPPacket(14, &mediaData[offset], remaining);
+        writeRTPHeader(data, lastPacket, rtpTime);
 
         data[12] = (offset == 2) ? 0x04 : 0x00;  // P=?, V=0
         data[13] = 0x00;  // PLEN = PEBIT = 0
 
-        memcpy(&data[14], &mediaData[offset], remaining);
         offset += remaining;
-
-        buffer->setRange(0, remaining + 14);
-
-        send(buffer, false /* isRTCP */);
-
-        ++mSeqNo;
-        ++mNumRTPSent;
-        mNumRTPOctetsSent += buffer->size() - 12;
     }
 
+    flushRTPPackets();
+
     mLastRTPTime = rtpTime;
     mLastNTPTime = GetNowNTP();
 }
@@ -26,6 +26,7 @@
 
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #define LOG_TO_FILES    0
 
@@ -61,6 +62,12 @@ private:
         kFlagEOS      = 2,
     };
 
+    enum {
+        kMaxPacketsPerBatch     = 16,
+        // 12 bytes RTP header + up to 2 bytes of payload header.
+        kMaxPacketHeaderSize    = 14,
+    };
+
     Mutex mLock;
     Condition mCondition;
     uint32_t mFlags;
@@ -94,6 +101,13 @@ private:
 
     int32_t mNumSRsSent;
 
+    // RTP packets waiting to be handed to the kernel in a single sendmmsg
+    // call. Their headers are built here, their payloads are sent straight
+    // from the source's buffer.
+    uint8_t mPacketHeaders[kMaxPacketsPerBatch][kMaxPacketHeaderSize];
+    struct iovec mPacketIOV[kMaxPacketsPerBatch][2];
+    size_t mNumPendingPackets;
+
     enum {
         INVALID,
         H264,
@@ -120,6 +134,11 @@ private:
 
     void send(const sp<ABuffer> &buffer, bool isRTCP);
 
+    uint8_t *queueRTPPacket(
+            size_t headerSize, const uint8_t *payload, size_t payloadSize);
+    void flushRTPPackets();
+    void writeRTPHeader(uint8_t *data, bool marker, uint32_t rtpTime);
+
     DISALLOW_EVIL_CONSTRUCTORS(ARTPWriter);
 };
 
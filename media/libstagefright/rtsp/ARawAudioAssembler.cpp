@@ -52,28 +52,21 @@ ARTPAssembler::AssemblyStatus ARawAudioAssembler::assembleMore(
 
 ARTPAssembler::AssemblyStatus ARawAudioAssembler::addPacket(
         const sp<ARTPSource> &source) {
-    List<sp<ABuffer> > *queue = source->queue();
+    ARTPPacketQueue *queue = source->queue();
 
     if (queue->empty()) {
         return NOT_ENOUGH_DATA;
     }
 
     if (mNextExpectedSeqNoValid) {
-        List<sp<ABuffer> >::iterator it = queue->begin();
-        while (it != queue->end()) {
-            if ((uint32_t)(*it)->int32Data() >= mNextExpectedSeqNo) {
-                break;
-            }
-
-            it = queue->erase(it);
-        }
+        queue->dropBefore(mNextExpectedSeqNo);
 
         if (queue->empty()) {
             return NOT_ENOUGH_DATA;
         }
     }
 
-    sp<ABuffer> buffer = *queue->begin();
+    sp<ABuffer> buffer = queue->front();
 
     if (!mNextExpectedSeqNoValid) {
         mNextExpectedSeqNoValid = true;
@@ -87,7 +80,7 @@ ARTPAssembler::AssemblyStatus ARawAudioAssembler::addPacket(
     // hexdump(buffer->data(), buffer->size());
 
     if (buffer->size() < 1) {
-        queue->erase(queue->begin());
+        queue->popFront();
         ++mNextExpectedSeqNo;
 
         ALOGV("raw audio packet too short.");
@@ -99,7 +92,7 @@ ARTPAssembler::AssemblyStatus ARawAudioAssembler::addPacket(
     msg->setBuffer("access-unit", buffer);
     msg->post();
 
-    queue->erase(queue->begin());
+    queue->popFront();
     ++mNextExpectedSeqNo;
 
     return OK;
@@ -0,0 +1,549 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABRPolicy_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/AUtils.h>
+#include <utils/Vector.h>
+#include <utils/misc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "httplive/ABRPolicy.h"
+#include "httplive/BandwidthEstimator.h"
+
+namespace android {
+
+// Buffer marks and polling interval, as in LiveSession and PlaylistFetcher.
+static const int64_t kUpSwitchMarkUs = 15000000ll;
+static const int64_t kDownSwitchMarkUs = 20000000ll;
+static const int64_t kReadyMarkUs = 5000000ll;
+static const int64_t kPrepareMarkUs = 1500000ll;
+static const int64_t kUnderflowMarkUs = 1000000ll;
+static const int64_t kMaxBufferedDurationUs = 30000000ll;
+static const int64_t kPollIntervalUs = 1000000ll;
+
+static const int64_t kStepUs = 10000ll;
+
+// A BandwidthEstimator that ages its measurements by the simulated clock.
+struct SimulatedBandwidthEstimator : public BandwidthEstimator {
+    SimulatedBandwidthEstimator(const int64_t *nowUs) : mNowUs(nowUs) {}
+
+protected:
+    virtual int64_t getNowUs() const { return *mNowUs; }
+
+private:
+    const int64_t *mNowUs;
+};
+
+struct TraceSample {
+    int64_t mDurationUs;
+    int32_t mBandwidthBps;
+};
+
+struct SimulationResult {
+    int64_t mRebufferUs;
+    int32_t mAverageBps;
+    size_t mNumSwitches;
+    size_t mFinalIndex;
+};
+
+// Plays a stream of fixed length segments over a network that follows a
+// bandwidth trace, asking the ABRController LiveSession uses which variant
+// to fetch the way LiveSession does: the buffer is polled every second,
+// segment downloads feed the bandwidth estimator, and while preparing a
+// switch restarts the download.
+// A switch made during playback takes effect with the next segment. The
+// trace is repeated if it is shorter than the playback.
+class ABRSimulator {
+public:
+    ABRSimulator(
+            const Vector<int32_t> &bandwidths,
+            int64_t segmentDurationUs,
+            const Vector<TraceSample> &trace)
+        : mBandwidths(bandwidths),
+          mSegmentDurationUs(segmentDurationUs),
+          mTrace(trace),
+          mTraceDurationUs(0) {
+        for (size_t i = 0; i < mTrace.size(); ++i) {
+            mTraceDurationUs += mTrace.itemAt(i).mDurationUs;
+        }
+    }
+
+    SimulationResult run(
+            ABRPolicy::Type type, size_t startIndex, int64_t playbackUs) {
+        int64_t nowUs = 0;
+        sp<BandwidthEstimator> estimator =
+            new SimulatedBandwidthEstimator(&nowUs);
+        sp<ABRController> controller = new ABRController(type);
+
+        Vector<ABRPolicy::Variant> variants;
+        for (size_t i = 0; i < mBandwidths.size(); ++i) {
+            ABRPolicy::Variant variant;
+            variant.mBandwidthBps = mBandwidths.itemAt(i);
+            variant.mIsValid = true;
+            variants.push(variant);
+        }
+
+        int64_t upSwitchMarkUs = min(kUpSwitchMarkUs, mSegmentDurationUs * 7 / 4);
+        int64_t downSwitchMarkUs = min(kDownSwitchMarkUs, mSegmentDurationUs * 9 / 4);
+
+        SimulationResult result;
+        result.mRebufferUs = 0;
+        result.mNumSwitches = 0;
+
+        size_t curIndex = startIndex;
+        bool preparing = true;
+        bool playing = false;
+        int64_t playedUs = 0;
+        double playedBits = 0;
+
+        // Variants of the segments buffered, the first one partially played.
+        Vector<size_t> buffered;
+        int64_t bufferedUs = 0;
+        int64_t frontPlayedUs = 0;
+
+        bool downloading = false;
+        size_t downloadIndex = 0;
+        double downloadedBits = 0;
+        int64_t downloadStartUs = 0;
+
+        int64_t nextPollUs = kPollIntervalUs;
+
+        while (playedUs < playbackUs) {
+            if (!downloading && bufferedUs < kMaxBufferedDurationUs) {
+                downloading = true;
+                downloadIndex = curIndex;
+                downloadedBits = 0;
+                downloadStartUs = nowUs;
+            }
+
+            if (downloading) {
+                downloadedBits += bandwidthAt(nowUs) * (kStepUs / 1E6);
+                double segmentBits = mBandwidths.itemAt(downloadIndex)
+                        * (mSegmentDurationUs / 1E6);
+                if (downloadedBits >= segmentBits) {
+                    estimator->addBandwidthMeasurement(
+                            (size_t)(segmentBits / 8),
+                            nowUs + kStepUs - downloadStartUs);
+                    buffered.push(downloadIndex);
+                    bufferedUs += mSegmentDurationUs;
+                    downloading = false;
+                }
+            }
+
+            if (playing) {
+                if (bufferedUs > 0) {
+                    int64_t deltaUs = min(kStepUs, bufferedUs);
+                    playedBits += mBandwidths.itemAt(buffered.itemAt(0))
+                            * (deltaUs / 1E6);
+                    playedUs += deltaUs;
+                    bufferedUs -= deltaUs;
+                    frontPlayedUs += deltaUs;
+                    if (frontPlayedUs >= mSegmentDurationUs) {
+                        buffered.removeAt(0);
+                        frontPlayedUs = 0;
+                    }
+                } else {
+                    // Stalled before the next poll noticed the underflow.
+                    result.mRebufferUs += kStepUs;
+                }
+            } else if (!preparing) {
+                result.mRebufferUs += kStepUs;
+            }
+
+            nowUs += kStepUs;
+
+            if (nowUs < nextPollUs) {
+                continue;
+            }
+            nextPollUs += kPollIntervalUs;
+
+            int32_t bandwidthBps = 0, shortTermBps = 0;
+            bool isStable = false;
+            bool hasEstimate = estimator->estimateBandwidth(
+                    &bandwidthBps, &isStable, &shortTermBps);
+
+            ABRPolicy::Status status;
+            status.mCurIndex = curIndex;
+            status.mBandwidthBps = bandwidthBps;
+            status.mShortTermBps = shortTermBps;
+            status.mIsStable = isStable;
+            status.mBufferedDurationUs = bufferedUs;
+            status.mBufferHigh = false;
+            status.mBufferLow = bufferedUs < downSwitchMarkUs;
+            status.mUpSwitchMarkUs = upSwitchMarkUs;
+            status.mDownSwitchMarkUs = downSwitchMarkUs;
+            status.mMaxBufferedDurationUs = kMaxBufferedDurationUs;
+
+            if (preparing) {
+                // Only a down switch, which restarts the download.
+                size_t index = hasEstimate
+                        ? controller->selectVariant(variants, status, true /* preparing */)
+                        : curIndex;
+                if (index != curIndex) {
+                    curIndex = index;
+                    ++result.mNumSwitches;
+                    buffered.clear();
+                    bufferedUs = 0;
+                    frontPlayedUs = 0;
+                    downloading = false;
+                    continue;
+                }
+                if (bufferedUs <= kPrepareMarkUs) {
+                    continue;
+                }
+                preparing = false;
+                playing = true;
+            } else if (bufferedUs > kReadyMarkUs) {
+                playing = true;
+            } else if (bufferedUs < kUnderflowMarkUs) {
+                playing = false;
+            }
+
+            if (!hasEstimate) {
+                continue;
+            }
+
+            status.mBufferHigh = bufferedUs > upSwitchMarkUs;
+            size_t index = controller->selectVariant(
+                    variants, status, false /* preparing */);
+            if (index != curIndex) {
+                ALOGV("%s: switching %zu => %zu at %.1f s, buffered %.1f s, "
+                        "bandwidth %d bps",
+                        ABRPolicy::TypeToString(type), curIndex, index,
+                        nowUs / 1E6, bufferedUs / 1E6, bandwidthBps);
+                curIndex = index;
+                ++result.mNumSwitches;
+            }
+        }
+
+        result.mAverageBps = playedBits * 1E6 / playedUs;
+        result.mFinalIndex = curIndex;
+
+        return result;
+    }
+
+private:
+    Vector<int32_t> mBandwidths;
+    int64_t mSegmentDurationUs;
+    Vector<TraceSample> mTrace;
+    int64_t mTraceDurationUs;
+
+    int32_t bandwidthAt(int64_t timeUs) const {
+        timeUs %= mTraceDurationUs;
+        for (size_t i = 0; i < mTrace.size(); ++i) {
+            if (timeUs < mTrace.itemAt(i).mDurationUs) {
+                return mTrace.itemAt(i).mBandwidthBps;
+            }
+            timeUs -= mTrace.itemAt(i).mDurationUs;
+        }
+        return mTrace.itemAt(mTrace.size() - 1).mBandwidthBps;
+    }
+};
+
+// Reads a bandwidth trace of "<duration ms> <kbps>" lines.
+static bool loadTrace(const char *path, Vector<TraceSample> *trace) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    trace->clear();
+    long long durationMs;
+    long kbps;
+    while (fscanf(file, "%lld %ld", &durationMs, &kbps) == 2) {
+        TraceSample sample;
+        sample.mDurationUs = durationMs * 1000ll;
+        sample.mBandwidthBps = kbps * 1000;
+        trace->push(sample);
+    }
+    fclose(file);
+
+    return !trace->empty();
+}
+
+static void addSample(
+        Vector<TraceSample> *trace, int64_t durationS, int32_t kbps) {
+    TraceSample sample;
+    sample.mDurationUs = durationS * 1000000ll;
+    sample.mBandwidthBps = kbps * 1000;
+    trace->push(sample);
+}
+
+class ABRPolicyTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        static const int32_t kBandwidths[] = {
+            300000, 700000, 1500000, 3000000,
+        };
+        for (size_t i = 0; i < NELEM(kBandwidths); ++i) {
+            ABRPolicy::Variant variant;
+            variant.mBandwidthBps = kBandwidths[i];
+            variant.mIsValid = true;
+            mVariants.push(variant);
+            mBandwidths.push(kBandwidths[i]);
+        }
+    }
+
+    ABRPolicy::Status makeStatus(
+            size_t curIndex, int32_t bandwidthBps, int64_t bufferedUs) {
+        ABRPolicy::Status status;
+        status.mCurIndex = curIndex;
+        status.mBandwidthBps = bandwidthBps;
+        status.mShortTermBps = bandwidthBps;
+        status.mIsStable = true;
+        status.mBufferedDurationUs = bufferedUs;
+        status.mBufferHigh = bufferedUs > kUpSwitchMarkUs;
+        status.mBufferLow = bufferedUs < kDownSwitchMarkUs;
+        status.mUpSwitchMarkUs = kUpSwitchMarkUs;
+        status.mDownSwitchMarkUs = kDownSwitchMarkUs;
+        status.mMaxBufferedDurationUs = kMaxBufferedDurationUs;
+        return status;
+    }
+
+    void simulateAll(
+            const char *name, const Vector<TraceSample> &trace,
+            int64_t playbackUs, SimulationResult *results) {
+        ABRSimulator simulator(mBandwidths, 4000000ll, trace);
+        for (int i = ABRPolicy::THROUGHPUT; i <= ABRPolicy::HYBRID; ++i) {
+            results[i] = simulator.run((ABRPolicy::Type)i, 1, playbackUs);
+            ALOGI("%s, %s policy: rebuffered %lld ms, average %d bps, "
+                    "%zu switches",
+                    name, ABRPolicy::TypeToString((ABRPolicy::Type)i),
+                    (long long)(results[i].mRebufferUs / 1000),
+                    results[i].mAverageBps, results[i].mNumSwitches);
+        }
+    }
+
+    Vector<ABRPolicy::Variant> mVariants;
+    Vector<int32_t> mBandwidths;
+};
+
+TEST_F(ABRPolicyTest, TestThroughputPolicy) {
+    sp<ABRPolicy> policy = ABRPolicy::Create(ABRPolicy::THROUGHPUT);
+
+    // Switches up only with a full buffer, to what 70% of the bandwidth
+    // sustains.
+    EXPECT_EQ(1u, policy->selectVariant(mVariants, makeStatus(1, 5000000, 10000000)));
+    EXPECT_EQ(3u, policy->selectVariant(mVariants, makeStatus(1, 5000000, 16000000)));
+    EXPECT_EQ(2u, policy->selectVariant(mVariants, makeStatus(1, 2500000, 16000000)));
+
+    // Not when the bandwidth is within 120% of the current variant.
+    EXPECT_EQ(1u, policy->selectVariant(mVariants, makeStatus(1, 800000, 16000000)));
+
+    // Switches down only with a low buffer.
+    EXPECT_EQ(3u, policy->selectVariant(mVariants, makeStatus(3, 1000000, 25000000)));
+    EXPECT_EQ(1u, policy->selectVariant(mVariants, makeStatus(3, 1000000, 10000000)));
+
+    // Goes by the short term estimate when it is lower and the long term
+    // one is unsteady.
+    ABRPolicy::Status status = makeStatus(3, 2500000, 10000000);
+    status.mShortTermBps = 1200000;
+    EXPECT_EQ(2u, policy->selectVariant(mVariants, status));
+    status.mIsStable = false;
+    EXPECT_EQ(1u, policy->selectVariant(mVariants, status));
+
+    // Skips blacklisted variants.
+    mVariants.editItemAt(3).mIsValid = false;
+    EXPECT_EQ(2u, policy->selectVariant(mVariants, makeStatus(1, 5000000, 16000000)));
+}
+
+TEST_F(ABRPolicyTest, TestBufferPolicy) {
+    sp<ABRPolicy> policy = ABRPolicy::Create(ABRPolicy::BUFFER);
+
+    // The bandwidth estimate doesn't matter, only the buffer does.
+    EXPECT_EQ(0u, policy->selectVariant(mVariants, makeStatus(2, 10000000, 0)));
+    EXPECT_EQ(0u, policy->selectVariant(
+            mVariants, makeStatus(0, 10000000, kUpSwitchMarkUs / 2)));
+    EXPECT_EQ(3u, policy->selectVariant(
+            mVariants, makeStatus(3, 100000, kMaxBufferedDurationUs)));
+
+    size_t prevIndex = 0;
+    for (int64_t bufferedUs = 0; bufferedUs <= kMaxBufferedDurationUs;
+            bufferedUs += 500000ll) {
+        size_t index = policy->selectVariant(
+                mVariants, makeStatus(0, 1000000, bufferedUs));
+        EXPECT_GE(index, prevIndex);
+        prevIndex = index;
+    }
+    EXPECT_GT(prevIndex, 0u);
+
+    // Doesn't switch back as soon as the buffer moves past the point where
+    // it switched.
+    size_t index = policy->selectVariant(
+            mVariants, makeStatus(1, 1000000, 20000000));
+    ABRPolicy::Status status = makeStatus(index, 1000000, 20000000);
+    for (int64_t deltaUs = -4000000ll; deltaUs <= 4000000ll; deltaUs += 500000ll) {
+        status.mBufferedDurationUs = 20000000 + deltaUs;
+        EXPECT_EQ(index, policy->selectVariant(mVariants, status));
+    }
+
+    mVariants.editItemAt(0).mIsValid = false;
+    EXPECT_EQ(1u, policy->selectVariant(mVariants, makeStatus(2, 10000000, 0)));
+}
+
+TEST_F(ABRPolicyTest, TestHybridPolicy) {
+    sp<ABRPolicy> policy = ABRPolicy::Create(ABRPolicy::HYBRID);
+
+    // Goes up with the buffer, but not past what the bandwidth sustains.
+    EXPECT_EQ(3u, policy->selectVariant(
+            mVariants, makeStatus(3, 10000000, kMaxBufferedDurationUs)));
+    EXPECT_EQ(2u, policy->selectVariant(
+            mVariants, makeStatus(1, 10000000, kMaxBufferedDurationUs)));
+    EXPECT_EQ(1u, policy->selectVariant(
+            mVariants, makeStatus(1, 1000000, kMaxBufferedDurationUs)));
+
+    // Goes down with the bandwidth once the buffer runs low.
+    EXPECT_EQ(1u, policy->selectVariant(
+            mVariants, makeStatus(3, 1200000, 15000000)));
+}
+
+TEST_F(ABRPolicyTest, TestController) {
+    sp<ABRController> controller = new ABRController(ABRPolicy::BUFFER);
+
+    // The throughput rules decide while preparing.
+    EXPECT_EQ(1u, controller->selectVariant(
+            mVariants, makeStatus(1, 5000000, 0), true /* preparing */));
+    EXPECT_EQ(0u, controller->selectVariant(
+            mVariants, makeStatus(1, 5000000, 0), false /* preparing */));
+
+    // A cap on the bandwidth applies to the estimates the policies see.
+    controller = new ABRController(ABRPolicy::THROUGHPUT);
+    controller->setMaxBandwidth(1200000);
+    EXPECT_EQ(1u, controller->selectVariant(
+            mVariants, makeStatus(0, 5000000, 16000000), false /* preparing */));
+    controller->setMaxBandwidth(0);
+    EXPECT_EQ(3u, controller->selectVariant(
+            mVariants, makeStatus(0, 5000000, 16000000), false /* preparing */));
+}
+
+TEST_F(ABRPolicyTest, TestForcedIndex) {
+    sp<ABRController> controller = new ABRController(ABRPolicy::HYBRID);
+    controller->setForcedIndex(2);
+
+    // Switches up to the forced variant only once the buffer is high and
+    // the bandwidth beats the current variant by 20%, whatever the policy.
+    EXPECT_EQ(0u, controller->selectVariant(
+            mVariants, makeStatus(0, 10000000, 10000000), false /* preparing */));
+    EXPECT_EQ(0u, controller->selectVariant(
+            mVariants, makeStatus(0, 330000, 16000000), false /* preparing */));
+    EXPECT_EQ(2u, controller->selectVariant(
+            mVariants, makeStatus(0, 400000, 16000000), false /* preparing */));
+
+    // And down to it only once the buffer is low and the bandwidth is
+    // below the current variant.
+    EXPECT_EQ(3u, controller->selectVariant(
+            mVariants, makeStatus(3, 2000000, 25000000), false /* preparing */));
+    EXPECT_EQ(3u, controller->selectVariant(
+            mVariants, makeStatus(3, 5000000, 10000000), false /* preparing */));
+    EXPECT_EQ(2u, controller->selectVariant(
+            mVariants, makeStatus(3, 2000000, 10000000), false /* preparing */));
+
+    // Never away from it.
+    EXPECT_EQ(2u, controller->selectVariant(
+            mVariants, makeStatus(2, 100000, 0), false /* preparing */));
+    EXPECT_EQ(2u, controller->selectVariant(
+            mVariants, makeStatus(2, 100000000, kMaxBufferedDurationUs),
+            false /* preparing */));
+
+    // Indices past the last variant force the last one.
+    controller->setForcedIndex(10);
+    EXPECT_EQ(3u, controller->selectVariant(
+            mVariants, makeStatus(1, 2000000, 16000000), false /* preparing */));
+
+    controller->setForcedIndex(-1);
+    EXPECT_EQ(0u, controller->selectVariant(
+            mVariants, makeStatus(2, 100000, 0), false /* preparing */));
+}
+
+TEST_F(ABRPolicyTest, TestParseType) {
+    ABRPolicy::Type type;
+    EXPECT_TRUE(ABRPolicy::ParseType("buffer", &type));
+    EXPECT_EQ(ABRPolicy::BUFFER, type);
+    EXPECT_TRUE(ABRPolicy::ParseType("Hybrid", &type));
+    EXPECT_EQ(ABRPolicy::HYBRID, type);
+    EXPECT_FALSE(ABRPolicy::ParseType("bola", &type));
+}
+
+TEST_F(ABRPolicyTest, TestSimulateConstantBandwidth) {
+    Vector<TraceSample> trace;
+    addSample(&trace, 60, 8000);
+
+    SimulationResult results[ABRPolicy::HYBRID + 1];
+    simulateAll("constant 8 Mbps", trace, 300000000ll, results);
+
+    for (int i = ABRPolicy::THROUGHPUT; i <= ABRPolicy::HYBRID; ++i) {
+        EXPECT_EQ(0ll, results[i].mRebufferUs);
+        EXPECT_EQ(3u, results[i].mFinalIndex);
+    }
+
+    // Replaying the same trace gives the same results.
+    ABRSimulator simulator(mBandwidths, 4000000ll, trace);
+    SimulationResult again = simulator.run(ABRPolicy::BUFFER, 1, 300000000ll);
+    EXPECT_EQ(results[ABRPolicy::BUFFER].mAverageBps, again.mAverageBps);
+    EXPECT_EQ(results[ABRPolicy::BUFFER].mNumSwitches, again.mNumSwitches);
+}
+
+TEST_F(ABRPolicyTest, TestSimulateBandwidthDrop) {
+    Vector<TraceSample> trace;
+    addSample(&trace, 120, 6000);
+    addSample(&trace, 600, 900);
+
+    SimulationResult results[ABRPolicy::HYBRID + 1];
+    simulateAll("6 Mbps dropping to 900 kbps", trace, 600000000ll, results);
+
+    // All policies settle on a variant the lower bandwidth sustains.
+    for (int i = ABRPolicy::THROUGHPUT; i <= ABRPolicy::HYBRID; ++i) {
+        EXPECT_LE(mBandwidths.itemAt(results[i].mFinalIndex), 900000);
+    }
+}
+
+TEST_F(ABRPolicyTest, TestSimulateFluctuatingBandwidth) {
+    Vector<TraceSample> trace;
+    addSample(&trace, 20, 4000);
+    addSample(&trace, 10, 500);
+    addSample(&trace, 30, 2000);
+    addSample(&trace, 5, 200);
+    addSample(&trace, 25, 1200);
+
+    SimulationResult results[ABRPolicy::HYBRID + 1];
+    simulateAll("fluctuating", trace, 900000000ll, results);
+
+    for (int i = ABRPolicy::THROUGHPUT; i <= ABRPolicy::HYBRID; ++i) {
+        EXPECT_GT(results[i].mAverageBps, mBandwidths.itemAt(0));
+    }
+}
+
+// Replays the trace named by ABR_TRACE, if any.
+TEST_F(ABRPolicyTest, TestSimulateRecordedTrace) {
+    const char *path = getenv("ABR_TRACE");
+    Vector<TraceSample> trace;
+    if (path == NULL || !loadTrace(path, &trace)) {
+        ALOGI("no bandwidth trace given in ABR_TRACE");
+        return;
+    }
+
+    SimulationResult results[ABRPolicy::HYBRID + 1];
+    simulateAll(path, trace, 1800000000ll, results);
+}
+
+}  // namespace android
@@ -0,0 +1,524 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ANetworkSession_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/ANetworkSession.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/List.h>
+#include <utils/Mutex.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace android {
+
+static const unsigned kServerPort = 34560;
+static const unsigned kStreamPort = 34561;
+static const unsigned kUDPBasePort = 34600;
+
+// Enough sessions for their sockets to go past FD_SETSIZE.
+static const size_t kNumSessions = 320;
+static const size_t kNumDatagramsPerSession = 50;
+
+static const int64_t kTimeoutNs = 10000000000ll;
+
+// Collects the notifications of all sessions in the order they arrive.
+struct NotificationCollector : public AHandler {
+    NotificationCollector() {}
+
+    sp<AMessage> waitForNotification() {
+        Mutex::Autolock autoLock(mLock);
+
+        while (mNotifications.empty()) {
+            if (mCondition.waitRelative(mLock, kTimeoutNs) != OK) {
+                return NULL;
+            }
+        }
+
+        sp<AMessage> msg = *mNotifications.begin();
+        mNotifications.erase(mNotifications.begin());
+
+        return msg;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        Mutex::Autolock autoLock(mLock);
+        mNotifications.push_back(msg);
+        mCondition.signal();
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    List<sp<AMessage> > mNotifications;
+
+    DISALLOW_EVIL_CONSTRUCTORS(NotificationCollector);
+};
+
+class ANetworkSessionTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("ANetworkSession_test");
+        mLooper->start();
+
+        mCollector = new NotificationCollector;
+        mLooper->registerHandler(mCollector);
+
+        mNetSession = new ANetworkSession;
+        ASSERT_EQ((status_t)OK, mNetSession->start());
+
+        mNotify = new AMessage(0, mCollector);
+    }
+
+    virtual void TearDown() {
+        mNetSession->stop();
+        mLooper->unregisterHandler(mCollector->id());
+        mLooper->stop();
+    }
+
+    // Fills a datagram with a pattern that identifies the sender and its
+    // position in the stream.
+    static void fillDatagram(
+            uint8_t *data, size_t size, size_t session, size_t index) {
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = (uint8_t)(session + index + i);
+        }
+    }
+
+    static bool checkDatagram(
+            const sp<ABuffer> &buffer, size_t session, size_t index) {
+        for (size_t i = 0; i < buffer->size(); ++i) {
+            if (buffer->data()[i] != (uint8_t)(session + index + i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static size_t datagramSize(size_t session, size_t index) {
+        return 1 + (session * 131 + index * 17) % 4000;
+    }
+
+    // Accepts a connection from a TCP datagram session on a plain socket
+    // whose receive buffer is |receiveBufferSize| bytes if not zero, and
+    // returns the socket of the session's end of it in |sessionSocket|.
+    void connectToSocket(
+            size_t receiveBufferSize, int32_t *sessionID, int *s,
+            int *sessionSocket) {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_GE(listener, 0);
+
+        const int yes = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        if (receiveBufferSize > 0) {
+            // Inherited by the accepted socket.
+            int size = receiveBufferSize;
+            ASSERT_EQ(0, setsockopt(
+                    listener, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)));
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(kStreamPort);
+        ASSERT_EQ(0, bind(listener, (const struct sockaddr *)&addr, sizeof(addr)));
+        ASSERT_EQ(0, listen(listener, 1));
+
+        ASSERT_EQ((status_t)OK, mNetSession->createTCPDatagramSession(
+                0 /* localPort */, "127.0.0.1", kStreamPort, mNotify,
+                sessionID));
+
+        sp<AMessage> msg = mCollector->waitForNotification();
+        ASSERT_TRUE(msg != NULL);
+        int32_t reason;
+        ASSERT_TRUE(msg->findInt32("reason", &reason));
+        ASSERT_EQ((int32_t)ANetworkSession::kWhatConnected, reason);
+
+        socklen_t addrLen = sizeof(addr);
+        *s = accept(listener, (struct sockaddr *)&addr, &addrLen);
+        close(listener);
+        ASSERT_GE(*s, 0);
+
+        struct timeval timeout;
+        timeout.tv_sec = kTimeoutNs / 1000000000ll;
+        timeout.tv_usec = 0;
+        setsockopt(*s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // The session's socket is the one bound to our peer's address.
+        *sessionSocket = -1;
+        for (int fd = 0; fd < 1024 && *sessionSocket < 0; ++fd) {
+            struct sockaddr_in local;
+            socklen_t localLen = sizeof(local);
+            if (fd != *s
+                    && getsockname(fd, (struct sockaddr *)&local, &localLen) == 0
+                    && local.sin_family == AF_INET
+                    && local.sin_port == addr.sin_port) {
+                *sessionSocket = fd;
+            }
+        }
+        ASSERT_GE(*sessionSocket, 0);
+    }
+
+    // Header and payload of the |index|-th datagram sent by
+    // TestShortWrites; the payload is taken from |mPattern|.
+    static size_t headerSize(size_t index) {
+        return (index * 5) % 17;
+    }
+
+    static size_t payloadOffset(size_t index) {
+        return (index * 37) % 251;
+    }
+
+    static size_t payloadSize(size_t index) {
+        return (index * 1237) % 6000;
+    }
+
+    sp<ALooper> mLooper;
+    sp<NotificationCollector> mCollector;
+    sp<ANetworkSession> mNetSession;
+    sp<AMessage> mNotify;
+};
+
+TEST_F(ANetworkSessionTest, TestManyTCPDatagramSessions) {
+    struct in_addr addr;
+    addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int32_t serverID;
+    ASSERT_EQ((status_t)OK, mNetSession->createTCPDatagramSession(
+            addr, kServerPort, mNotify, &serverID));
+
+    // Connect the clients one at a time, the server's listen backlog is
+    // short.
+    KeyedVector<int32_t, size_t> clients;
+    KeyedVector<int32_t, size_t> peers;
+    for (size_t i = 0; i < kNumSessions; ++i) {
+        int32_t clientID;
+        ASSERT_EQ((status_t)OK, mNetSession->createTCPDatagramSession(
+                0 /* localPort */, "127.0.0.1", kServerPort, mNotify,
+                &clientID));
+        clients.add(clientID, i);
+
+        bool connected = false;
+        bool accepted = false;
+        while (!connected || !accepted) {
+            sp<AMessage> msg = mCollector->waitForNotification();
+            ASSERT_TRUE(msg != NULL);
+
+            int32_t sessionID, reason;
+            ASSERT_TRUE(msg->findInt32("sessionID", &sessionID));
+            ASSERT_TRUE(msg->findInt32("reason", &reason));
+
+            if (reason == ANetworkSession::kWhatConnected) {
+                ASSERT_EQ(clientID, sessionID);
+                connected = true;
+            } else {
+                ASSERT_EQ((int32_t)ANetworkSession::kWhatClientConnected, reason);
+                peers.add(sessionID, i);
+                accepted = true;
+            }
+        }
+    }
+
+    uint8_t data[4000];
+
+    int64_t startUs = ALooper::GetNowUs();
+
+    for (size_t j = 0; j < kNumDatagramsPerSession; ++j) {
+        for (size_t i = 0; i < clients.size(); ++i) {
+            size_t session = clients.valueAt(i);
+            size_t size = datagramSize(session, j);
+            fillDatagram(data, size, session, j);
+
+            ASSERT_EQ((status_t)OK, mNetSession->sendRequest(
+                    clients.keyAt(i), data, size));
+        }
+    }
+
+    // Datagrams have to arrive complete and in order on every connection.
+    KeyedVector<int32_t, size_t> numReceived;
+    for (size_t n = 0; n < kNumSessions * kNumDatagramsPerSession; ++n) {
+        sp<AMessage> msg = mCollector->waitForNotification();
+        ASSERT_TRUE(msg != NULL);
+
+        int32_t sessionID, reason;
+        ASSERT_TRUE(msg->findInt32("sessionID", &sessionID));
+        ASSERT_TRUE(msg->findInt32("reason", &reason));
+        ASSERT_EQ((int32_t)ANetworkSession::kWhatDatagram, reason);
+
+        ssize_t index = peers.indexOfKey(sessionID);
+        ASSERT_GE(index, 0);
+        size_t session = peers.valueAt(index);
+
+        index = numReceived.indexOfKey(sessionID);
+        if (index < 0) {
+            index = numReceived.add(sessionID, 0);
+        }
+        size_t count = numReceived.valueAt(index);
+
+        sp<ABuffer> buffer;
+        ASSERT_TRUE(msg->findBuffer("data", &buffer));
+        ASSERT_EQ(datagramSize(session, count), buffer->size());
+        ASSERT_TRUE(checkDatagram(buffer, session, count));
+
+        numReceived.replaceValueAt(index, count + 1);
+    }
+
+    ALOGI("%zu datagrams over %zu connections delivered in %lld us",
+          kNumSessions * kNumDatagramsPerSession, kNumSessions,
+          (long long)(ALooper::GetNowUs() - startUs));
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+        EXPECT_EQ((status_t)OK, mNetSession->destroySession(clients.keyAt(i)));
+    }
+    for (size_t i = 0; i < peers.size(); ++i) {
+        EXPECT_EQ((status_t)OK, mNetSession->destroySession(peers.keyAt(i)));
+    }
+    EXPECT_EQ((status_t)OK, mNetSession->destroySession(serverID));
+}
+
+TEST_F(ANetworkSessionTest, TestUDPSessions) {
+    static const size_t kNumPairs = kNumSessions / 2;
+
+    KeyedVector<int32_t, size_t> senders;
+    KeyedVector<int32_t, size_t> receivers;
+    for (size_t i = 0; i < kNumPairs; ++i) {
+        unsigned senderPort = kUDPBasePort + 2 * i;
+        unsigned receiverPort = senderPort + 1;
+
+        int32_t senderID, receiverID;
+        ASSERT_EQ((status_t)OK, mNetSession->createUDPSession(
+                senderPort, "127.0.0.1", receiverPort, mNotify, &senderID));
+        ASSERT_EQ((status_t)OK, mNetSession->createUDPSession(
+                receiverPort, "127.0.0.1", senderPort, mNotify, &receiverID));
+
+        senders.add(senderID, i);
+        receivers.add(receiverID, i);
+    }
+
+    // Stay well below the socket buffers, loopback doesn't drop datagrams
+    // unless they overflow.
+    static const size_t kNumDatagrams = 8;
+    static const size_t kDatagramSize = 1000;
+
+    uint8_t data[kDatagramSize];
+
+    for (size_t j = 0; j < kNumDatagrams; ++j) {
+        for (size_t i = 0; i < senders.size(); ++i) {
+            fillDatagram(data, sizeof(data), senders.valueAt(i), j);
+            ASSERT_EQ((status_t)OK, mNetSession->sendRequest(
+                    senders.keyAt(i), data, sizeof(data)));
+        }
+    }
+
+    KeyedVector<int32_t, size_t> numReceived;
+    for (size_t n = 0; n < kNumPairs * kNumDatagrams; ++n) {
+        sp<AMessage> msg = mCollector->waitForNotification();
+        ASSERT_TRUE(msg != NULL);
+
+        int32_t sessionID, reason;
+        ASSERT_TRUE(msg->findInt32("sessionID", &sessionID));
+        ASSERT_TRUE(msg->findInt32("reason", &reason));
+        ASSERT_EQ((int32_t)ANetworkSession::kWhatDatagram, reason);
+
+        ssize_t index = receivers.indexOfKey(sessionID);
+        ASSERT_GE(index, 0);
+        size_t session = receivers.valueAt(index);
+
+        index = numReceived.indexOfKey(sessionID);
+        if (index < 0) {
+            index = numReceived.add(sessionID, 0);
+        }
+        size_t count = numReceived.valueAt(index);
+
+        sp<ABuffer> buffer;
+        ASSERT_TRUE(msg->findBuffer("data", &buffer));
+        ASSERT_EQ(kDatagramSize, buffer->size());
+        ASSERT_TRUE(checkDatagram(buffer, session, count));
+
+        numReceived.replaceValueAt(index, count + 1);
+    }
+
+    for (size_t i = 0; i < senders.size(); ++i) {
+        EXPECT_EQ((status_t)OK, mNetSession->destroySession(senders.keyAt(i)));
+        EXPECT_EQ((status_t)OK, mNetSession->destroySession(receivers.keyAt(i)));
+    }
+}
+
+TEST_F(ANetworkSessionTest, TestShortWrites) {
+    int32_t sessionID;
+    int s, sessionSocket;
+    ASSERT_NO_FATAL_FAILURE(connectToSocket(
+            4096 /* receiveBufferSize */, &sessionID, &s, &sessionSocket));
+
+    // With both socket buffers this small most writes of the session
+    // are cut short, at any byte of a header, length prefix or payload.
+    int size = 4096;
+    ASSERT_EQ(0, setsockopt(
+            sessionSocket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)));
+
+    sp<ABuffer> pattern = new ABuffer(256 + 6000);
+    for (size_t i = 0; i < pattern->size(); ++i) {
+        pattern->data()[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    static const size_t kNumDatagrams = 2000;
+
+    uint8_t header[16];
+    size_t numBytes = 0;
+    for (size_t i = 0; i < kNumDatagrams; ++i) {
+        if (headerSize(i) + payloadSize(i) == 0) {
+            continue;
+        }
+
+        fillDatagram(header, headerSize(i), 0, i);
+        if (i % 3 == 0) {
+            // The copying path, interleaved with the other one.
+            sp<ABuffer> data = new ABuffer(headerSize(i) + payloadSize(i));
+            memcpy(data->data(), header, headerSize(i));
+            memcpy(data->data() + headerSize(i),
+                   pattern->data() + payloadOffset(i), payloadSize(i));
+            ASSERT_EQ((status_t)OK, mNetSession->sendRequest(
+                    sessionID, data->data(), data->size()));
+        } else {
+            ASSERT_EQ((status_t)OK, mNetSession->sendDatagram(
+                    sessionID, header, headerSize(i),
+                    pattern, payloadOffset(i), payloadSize(i)));
+        }
+        numBytes += 2 + headerSize(i) + payloadSize(i);
+    }
+
+    // Let the session run into a full send buffer before reading, then
+    // read slowly, in pieces that don't line up with the datagrams.
+    usleep(100000);
+
+    AString received;
+    uint8_t piece[1500];
+    size_t index = 0;
+    size_t numReceived = 0;
+    while (numReceived < numBytes) {
+        ssize_t n = recv(s, piece, 1 + (numReceived * 13) % sizeof(piece), 0);
+        ASSERT_GT(n, 0) << "after " << numReceived << " of " << numBytes << " bytes";
+        numReceived += n;
+        received.append((const char *)piece, n);
+
+        while (received.size() >= 2) {
+            const uint8_t *data = (const uint8_t *)received.c_str();
+            size_t datagramSize = (data[0] << 8) | data[1];
+            if (received.size() < 2 + datagramSize) {
+                break;
+            }
+
+            // Skip the empty datagrams that were never queued.
+            while (headerSize(index) + payloadSize(index) == 0) {
+                ++index;
+            }
+            ASSERT_EQ(headerSize(index) + payloadSize(index), datagramSize)
+                    << "datagram " << index;
+
+            sp<ABuffer> buffer = new ABuffer(headerSize(index));
+            memcpy(buffer->data(), data + 2, headerSize(index));
+            ASSERT_TRUE(checkDatagram(buffer, 0, index)) << "datagram " << index;
+            ASSERT_EQ(0, memcmp(data + 2 + headerSize(index),
+                                pattern->data() + payloadOffset(index),
+                                payloadSize(index))) << "datagram " << index;
+
+            received.erase(0, 2 + datagramSize);
+            ++index;
+        }
+    }
+
+    EXPECT_EQ(0u, received.size());
+    EXPECT_EQ(kNumDatagrams, index);
+
+    close(s);
+    EXPECT_EQ((status_t)OK, mNetSession->destroySession(sessionID));
+}
+
+TEST_F(ANetworkSessionTest, TestTCPDatagramThroughput) {
+    int32_t sessionID;
+    int s, sessionSocket;
+    ASSERT_NO_FATAL_FAILURE(connectToSocket(
+            0 /* receiveBufferSize */, &sessionID, &s, &sessionSocket));
+
+    // 40 MB of RTP sized packets, the header copied and the payload sent
+    // from the source buffer, once by reference and once by copy.
+    static const size_t kHeaderSize = 12;
+    static const size_t kPayloadSize = 1388;
+    static const size_t kNumDatagrams = 30000;
+
+    sp<ABuffer> payloads = new ABuffer(kNumDatagrams * kPayloadSize / 100);
+    memset(payloads->data(), 0x55, payloads->size());
+
+    uint8_t datagram[kHeaderSize + kPayloadSize];
+    memset(datagram, 0xaa, sizeof(datagram));
+
+    size_t numBytes = kNumDatagrams * (2 + kHeaderSize + kPayloadSize);
+
+    uint8_t piece[65536];
+
+    static const char *kPaths[] = { "sendDatagram", "sendRequest" };
+    for (size_t path = 0; path < 2; ++path) {
+        int64_t startUs = ALooper::GetNowUs();
+
+        for (size_t i = 0; i < kNumDatagrams; ++i) {
+            size_t offset = (i % 100) * kPayloadSize;
+            if (path == 0) {
+                ASSERT_EQ((status_t)OK, mNetSession->sendDatagram(
+                        sessionID, datagram, kHeaderSize,
+                        payloads, offset, kPayloadSize));
+            } else {
+                memcpy(datagram + kHeaderSize, payloads->data() + offset,
+                       kPayloadSize);
+                ASSERT_EQ((status_t)OK, mNetSession->sendRequest(
+                        sessionID, datagram, sizeof(datagram)));
+            }
+        }
+
+        size_t numReceived = 0;
+        while (numReceived < numBytes) {
+            ssize_t n = recv(s, piece, sizeof(piece), 0);
+            ASSERT_GT(n, 0);
+            numReceived += n;
+        }
+
+        int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+        ALOGI("%s: %zu datagrams, %zu bytes over loopback in %lld us, %.1f MB/s",
+              kPaths[path], kNumDatagrams, numBytes, (long long)elapsedUs,
+              (double)numBytes / elapsedUs);
+    }
+
+    close(s);
+    EXPECT_EQ((status_t)OK, mNetSession->destroySession(sessionID));
+}
+
+} // namespace android
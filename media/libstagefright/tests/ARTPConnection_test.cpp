@@ -0,0 +1,359 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ARTPConnection_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+#include "rtsp/ARTPConnection.h"
+#include "rtsp/ASessionDescription.h"
+
+namespace android {
+
+static const char *kSDP =
+    "v=0\r\n"
+    "o=- 0 0 IN IP4 127.0.0.1\r\n"
+    "s=test\r\n"
+    "c=IN IP4 127.0.0.1\r\n"
+    "t=0 0\r\n"
+    "m=audio 0 RTP/AVP 0\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n";
+
+static const uint32_t kSSRCs[] = { 0x11111111, 0x22222222, 0x33333333 };
+static const size_t kNumSSRCs = sizeof(kSSRCs) / sizeof(kSSRCs[0]);
+
+// Raw audio goes through the assembler packet by packet, so every RTP
+// payload comes back as an access unit of its own.
+static uint8_t payloadByte(uint32_t ssrc, uint16_t seqNum, size_t offset) {
+    return (uint8_t)(ssrc + seqNum * 7 + offset);
+}
+
+struct AccessUnitSink : public AHandler {
+    enum {
+        kWhatAccessUnit,
+    };
+
+    AccessUnitSink(bool keepAccessUnits)
+        : mNumCorrupt(0),
+          mKeepAccessUnits(keepAccessUnits),
+          mNumReceived(0) {
+    }
+
+    // Waits until |count| access units have arrived, or |timeoutUs| has
+    // passed without a new one.
+    bool waitFor(size_t count, int64_t timeoutUs) {
+        Mutex::Autolock autoLock(mLock);
+        while (mNumReceived < count) {
+            if (mCondition.waitRelative(mLock, timeoutUs * 1000ll) != OK) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The access units' sequence numbers in the order they arrived, with
+    // their payloads checked against what was sent.
+    KeyedVector<uint32_t, Vector<uint32_t> > mSeqNums;
+    Vector<sp<ABuffer> > mAccessUnits;
+    size_t mNumCorrupt;
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        sp<ABuffer> accessUnit;
+        if (!msg->findBuffer("access-unit", &accessUnit)) {
+            return;
+        }
+
+        int32_t ssrc;
+        CHECK(accessUnit->meta()->findInt32("ssrc", &ssrc));
+        uint16_t seqNum = (uint16_t)accessUnit->int32Data();
+
+        Mutex::Autolock autoLock(mLock);
+        if (!check(accessUnit)) {
+            ++mNumCorrupt;
+        }
+
+        ssize_t index = mSeqNums.indexOfKey(ssrc);
+        if (index < 0) {
+            index = mSeqNums.add(ssrc, Vector<uint32_t>());
+        }
+        mSeqNums.editValueAt(index).push(seqNum);
+
+        if (mKeepAccessUnits) {
+            mAccessUnits.push(accessUnit);
+        }
+
+        ++mNumReceived;
+        mCondition.signal();
+    }
+
+public:
+    // The payload carries the SSRC and sequence number it was sent with.
+    static bool check(const sp<ABuffer> &accessUnit) {
+        int32_t ssrc;
+        CHECK(accessUnit->meta()->findInt32("ssrc", &ssrc));
+        uint16_t seqNum = (uint16_t)accessUnit->int32Data();
+
+        for (size_t i = 0; i < accessUnit->size(); ++i) {
+            if (accessUnit->data()[i] != payloadByte(ssrc, seqNum, i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool mKeepAccessUnits;
+    Mutex mLock;
+    Condition mCondition;
+    size_t mNumReceived;
+
+    DISALLOW_EVIL_CONSTRUCTORS(AccessUnitSink);
+};
+
+class ARTPConnectionTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("rtp");
+        mLooper->start();
+
+        mSinkLooper = new ALooper;
+        mSinkLooper->setName("sink");
+        mSinkLooper->start();
+
+        mSessionDesc = new ASessionDescription;
+        ASSERT_TRUE(mSessionDesc->setTo(kSDP, strlen(kSDP)));
+
+        ARTPConnection::MakePortPair(&mRTPSocket, &mRTCPSocket, &mRTPPort);
+
+        mSendSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(mSendSocket, 0);
+
+        memset(&mRemoteAddr, 0, sizeof(mRemoteAddr));
+        mRemoteAddr.sin_family = AF_INET;
+        mRemoteAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        mRemoteAddr.sin_port = htons(mRTPPort);
+    }
+
+    virtual void TearDown() {
+        if (mConnection != NULL) {
+            mConnection->removeStream(mRTPSocket, mRTCPSocket);
+        }
+        mLooper->stop();
+        mSinkLooper->stop();
+
+        close(mSendSocket);
+        close(mRTCPSocket);
+        close(mRTPSocket);
+    }
+
+    void start(const sp<AccessUnitSink> &sink) {
+        mSinkLooper->registerHandler(sink);
+
+        mConnection = new ARTPConnection;
+        mLooper->registerHandler(mConnection);
+        mConnection->addStream(
+                mRTPSocket, mRTCPSocket, mSessionDesc, 1,
+                new AMessage(AccessUnitSink::kWhatAccessUnit, sink),
+                false /* injected */);
+    }
+
+    void send(uint32_t ssrc, uint16_t seqNum, size_t payloadSize) {
+        uint8_t packet[12 + 4096];
+        ASSERT_LE(payloadSize, sizeof(packet) - 12);
+
+        uint32_t rtpTime = seqNum * 160;
+        packet[0] = 0x80;
+        packet[1] = 0;  // PCMU
+        packet[2] = seqNum >> 8;
+        packet[3] = seqNum & 0xff;
+        packet[4] = rtpTime >> 24;
+        packet[5] = (rtpTime >> 16) & 0xff;
+        packet[6] = (rtpTime >> 8) & 0xff;
+        packet[7] = rtpTime & 0xff;
+        packet[8] = ssrc >> 24;
+        packet[9] = (ssrc >> 16) & 0xff;
+        packet[10] = (ssrc >> 8) & 0xff;
+        packet[11] = ssrc & 0xff;
+
+        for (size_t i = 0; i < payloadSize; ++i) {
+            packet[12 + i] = payloadByte(ssrc, seqNum, i);
+        }
+
+        ssize_t n = sendto(
+                mSendSocket, packet, 12 + payloadSize, 0,
+                (const struct sockaddr *)&mRemoteAddr, sizeof(mRemoteAddr));
+        ASSERT_EQ((ssize_t)(12 + payloadSize), n);
+    }
+
+    sp<ALooper> mLooper;
+    sp<ALooper> mSinkLooper;
+    sp<ASessionDescription> mSessionDesc;
+    sp<ARTPConnection> mConnection;
+
+    int mRTPSocket;
+    int mRTCPSocket;
+    unsigned mRTPPort;
+
+    int mSendSocket;
+    struct sockaddr_in mRemoteAddr;
+};
+
+// Every SSRC gets sequence numbers first..first+count-1, in order.
+static void expectInOrder(
+        const sp<AccessUnitSink> &sink, uint32_t ssrc,
+        uint16_t first, size_t count) {
+    ssize_t index = sink->mSeqNums.indexOfKey(ssrc);
+    ASSERT_GE(index, 0);
+
+    const Vector<uint32_t> &seqNums = sink->mSeqNums.valueAt(index);
+    ASSERT_EQ(count, seqNums.size());
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ((uint16_t)(first + i), seqNums[i]) << "ssrc " << ssrc;
+    }
+}
+
+// The datagrams are queued on the socket before the stream is added, so
+// they are read in full batches. Each batch has runs from every SSRC and
+// the access units are held until the end, while the connection keeps
+// receiving.
+TEST_F(ARTPConnectionTest, TestBatchesFromSeveralSources) {
+    sp<AccessUnitSink> sink = new AccessUnitSink(true /* keepAccessUnits */);
+
+    static const size_t kNumPacketsPerSSRC = 80;
+    static const uint16_t kFirstSeqNum = 65500;  // wraps around
+
+    uint16_t next[kNumSSRCs];
+    for (size_t i = 0; i < kNumSSRCs; ++i) {
+        next[i] = kFirstSeqNum + i * 1000;
+    }
+
+    size_t numSent = 0;
+    for (size_t run = 0; numSent < kNumPacketsPerSSRC * kNumSSRCs; ++run) {
+        size_t i = run % kNumSSRCs;
+        for (size_t n = 0; n < run % 5 + 1; ++n) {
+            if ((uint16_t)(next[i] - kFirstSeqNum - i * 1000)
+                    == kNumPacketsPerSSRC) {
+                break;
+            }
+            send(kSSRCs[i], next[i], 160 + next[i] % 200);
+            ++next[i];
+            ++numSent;
+        }
+    }
+
+    start(sink);
+
+    ASSERT_TRUE(sink->waitFor(numSent, 2000000ll));
+    EXPECT_EQ(kNumSSRCs, sink->mSeqNums.size());
+
+    for (size_t i = 0; i < kNumSSRCs; ++i) {
+        expectInOrder(sink, kSSRCs[i], kFirstSeqNum + i * 1000,
+                      kNumPacketsPerSSRC);
+    }
+
+    // The pool must not have received into a buffer that was handed out.
+    EXPECT_EQ(0u, sink->mNumCorrupt);
+    for (size_t i = 0; i < sink->mAccessUnits.size(); ++i) {
+        EXPECT_TRUE(AccessUnitSink::check(sink->mAccessUnits[i]));
+    }
+}
+
+// Datagrams start out received into MTU sized buffers. The first one
+// that does not fit is dropped, the receive buffers grow and later large
+// datagrams arrive whole.
+TEST_F(ARTPConnectionTest, TestTruncatedDatagram) {
+    sp<AccessUnitSink> sink = new AccessUnitSink(true /* keepAccessUnits */);
+    start(sink);
+
+    const uint32_t ssrc = kSSRCs[0];
+
+    send(ssrc, 0, 160);
+    ASSERT_TRUE(sink->waitFor(1, 2000000ll));
+
+    send(ssrc, 1, 3000);  // truncated and dropped
+
+    // The assembler only gives up on the missing packet once a later one
+    // has waited past the playout delay.
+    for (uint16_t seqNum = 2; seqNum < 6; ++seqNum) {
+        usleep(20000);
+        send(ssrc, seqNum, 3000);
+    }
+    ASSERT_TRUE(sink->waitFor(5, 2000000ll));
+
+    const Vector<uint32_t> &seqNums = sink->mSeqNums.valueFor(ssrc);
+    ASSERT_EQ(5u, seqNums.size());
+    EXPECT_EQ(0u, seqNums[0]);
+    for (size_t i = 1; i < seqNums.size(); ++i) {
+        EXPECT_EQ(i + 1, seqNums[i]);
+        EXPECT_EQ(3000u, sink->mAccessUnits[i]->size());
+    }
+    EXPECT_EQ(0u, sink->mNumCorrupt);
+}
+
+// Streams from every SSRC as fast as the receiver keeps up, with at most
+// kWindow datagrams in flight so that none are dropped by the socket, and
+// logs the rate.
+TEST_F(ARTPConnectionTest, TestThroughput) {
+    sp<AccessUnitSink> sink = new AccessUnitSink(false /* keepAccessUnits */);
+    start(sink);
+
+    static const size_t kNumPackets = 60000;
+    static const size_t kWindow = 128;
+
+    int64_t startUs = ALooper::GetNowUs();
+    for (size_t n = 0; n < kNumPackets; ++n) {
+        if (n >= kWindow) {
+            ASSERT_TRUE(sink->waitFor(n - kWindow + 1, 2000000ll));
+        }
+
+        size_t i = (n / 4) % kNumSSRCs;
+        uint16_t seqNum = (uint16_t)(n / (4 * kNumSSRCs) * 4 + n % 4);
+        send(kSSRCs[i], seqNum, 160);
+    }
+    ASSERT_TRUE(sink->waitFor(kNumPackets, 2000000ll));
+    int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+
+    EXPECT_EQ(0u, sink->mNumCorrupt);
+    for (size_t i = 0; i < kNumSSRCs; ++i) {
+        expectInOrder(sink, kSSRCs[i], 0, kNumPackets / kNumSSRCs);
+    }
+
+    ALOGI("received %zu RTP packets from %zu sources in %lld ms, "
+          "%.0f packets/sec",
+          kNumPackets, kNumSSRCs, (long long)elapsedUs / 1000,
+          kNumPackets * 1E6 / elapsedUs);
+}
+
+}  // namespace android
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ARTPPacketQueue_test"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <utils/Vector.h>
+
+#include "rtsp/ARTPPacketQueue.h"
+
+namespace android {
+
+static sp<ABuffer> makePacket(uint32_t seqNum) {
+    sp<ABuffer> buffer = new ABuffer(4);
+    buffer->setInt32Data(seqNum);
+    return buffer;
+}
+
+class ARTPPacketQueueTest : public ::testing::Test {
+};
+
+TEST_F(ARTPPacketQueueTest, TestReorder) {
+    ARTPPacketQueue queue;
+
+    static const uint32_t kSeqNums[] = { 100, 102, 101, 105, 99, 104 };
+    for (size_t i = 0; i < sizeof(kSeqNums) / sizeof(kSeqNums[0]); ++i) {
+        ASSERT_TRUE(queue.insert(makePacket(kSeqNums[i])));
+    }
+
+    ASSERT_FALSE(queue.insert(makePacket(102)));
+    ASSERT_EQ(queue.stats().mNumDuplicates, 1u);
+
+    ASSERT_EQ(queue.size(), 6u);
+    ASSERT_EQ(queue.numMissing(), 1u);
+
+    Vector<uint32_t> missing;
+    queue.getMissing(&missing, 10);
+    ASSERT_EQ(missing.size(), 1u);
+    ASSERT_EQ(missing[0], 103u);
+
+    ASSERT_TRUE(queue.find(103) == NULL);
+    ASSERT_TRUE(queue.find(104) != NULL);
+
+    static const uint32_t kExpected[] = { 99, 100, 101, 102, 104, 105 };
+    for (size_t i = 0; i < sizeof(kExpected) / sizeof(kExpected[0]); ++i) {
+        ASSERT_FALSE(queue.empty());
+        ASSERT_EQ((uint32_t)queue.front()->int32Data(), kExpected[i]);
+        queue.popFront();
+    }
+
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST_F(ARTPPacketQueueTest, TestDropBefore) {
+    ARTPPacketQueue queue;
+
+    for (uint32_t seqNum = 10; seqNum < 20; seqNum += 2) {
+        ASSERT_TRUE(queue.insert(makePacket(seqNum)));
+    }
+
+    queue.dropBefore(15);
+    ASSERT_EQ(queue.size(), 2u);
+    ASSERT_EQ((uint32_t)queue.front()->int32Data(), 16u);
+
+    queue.clear();
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(queue.numMissing(), 0u);
+}
+
+// Simulates a lossy network that drops, duplicates and locally reorders
+// packets, and checks that whatever arrives comes out in order and that
+// exactly the dropped packets are reported missing.
+TEST_F(ARTPPacketQueueTest, TestLossyNetwork) {
+    static const uint32_t kFirstSeqNum = 65000;
+    static const size_t kNumPackets = 10000;
+    static const size_t kReorderWindow = 8;
+
+    unsigned seed = 1;
+
+    Vector<uint32_t> sent;
+    Vector<bool> dropped;
+    for (size_t i = 0; i < kNumPackets; ++i) {
+        sent.push_back(kFirstSeqNum + i);
+        dropped.push_back((rand_r(&seed) % 100) < 5);
+    }
+
+    // Shuffle within small windows.
+    for (size_t i = 0; i + kReorderWindow <= kNumPackets; i += kReorderWindow) {
+        for (size_t j = kReorderWindow - 1; j > 0; --j) {
+            size_t k = rand_r(&seed) % (j + 1);
+            uint32_t tmp = sent[i + j];
+            sent.editItemAt(i + j) = sent[i + k];
+            sent.editItemAt(i + k) = tmp;
+        }
+    }
+
+    ARTPPacketQueue queue;
+    size_t numDropped = 0;
+    for (size_t i = 0; i < kNumPackets; ++i) {
+        uint32_t seqNum = sent[i];
+        if (dropped[seqNum - kFirstSeqNum]) {
+            ++numDropped;
+            continue;
+        }
+
+        ASSERT_TRUE(queue.insert(makePacket(seqNum)));
+
+        if ((rand_r(&seed) % 100) < 2) {
+            ASSERT_FALSE(queue.insert(makePacket(seqNum)));
+        }
+    }
+
+    ASSERT_EQ(queue.size(), kNumPackets - numDropped);
+
+    Vector<uint32_t> missing;
+    queue.getMissing(&missing, kNumPackets);
+    ASSERT_EQ(missing.size(), queue.numMissing());
+
+    size_t missingIndex = 0;
+    for (size_t i = 0; i < kNumPackets; ++i) {
+        if (dropped[i] && kFirstSeqNum + i > (uint32_t)queue.front()->int32Data()
+                && kFirstSeqNum + i < queue.endSeqNum()) {
+            ASSERT_LT(missingIndex, missing.size());
+            ASSERT_EQ(missing[missingIndex++], kFirstSeqNum + i);
+        }
+    }
+    ASSERT_EQ(missingIndex, missing.size());
+
+    uint32_t lastSeqNum = 0;
+    while (!queue.empty()) {
+        uint32_t seqNum = (uint32_t)queue.front()->int32Data();
+        ASSERT_LT(lastSeqNum, seqNum);
+        ASSERT_FALSE(dropped[seqNum - kFirstSeqNum]);
+        lastSeqNum = seqNum;
+        queue.popFront();
+    }
+}
+
+} // namespace android
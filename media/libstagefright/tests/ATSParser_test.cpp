@@ -0,0 +1,565 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ATSParser_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Vector.h>
+
+#include "mpeg2ts/ATSParser.h"
+#include "mpeg2ts/AnotherPacketSource.h"
+
+namespace android {
+
+static const size_t kTSPacketSize = 188;
+
+static const unsigned kPMTPID = 0x100;
+static const unsigned kVideoPID = 0x101;
+static const unsigned kAudioPID = 0x102;
+
+// Program i uses the PIDs above plus i * kProgramPIDStep.
+static const unsigned kProgramPIDStep = 0x10;
+static const size_t kMaxPrograms = 4;
+
+// Baseline profile 352x288.
+static const uint8_t kSPS[] = { 0x27, 0x42, 0x00, 0x15, 0xa6, 0x81, 0x60, 0x94, 0x40 };
+static const uint8_t kPPS[] = { 0x28, 0xce, 0x3c, 0x80 };
+
+// Writes a transport stream with |numPrograms| programs, each carrying H.264
+// video and ADTS AAC audio. The packets of the programs are interleaved, and
+// the first packet of each video PES carries the program's PCR. The PAT lists
+// |firstProgram| first, which is the program ATSParser::getSource() picks.
+// Payload bytes never contain zeros, so no start code emulation.
+struct TSWriter {
+    TSWriter(size_t numPrograms = 1, size_t firstProgram = 0)
+        : mNumPrograms(numPrograms),
+          mFirstProgram(firstProgram),
+          mFrame(0),
+          mSeed(1) {
+        for (size_t i = 0; i < mNumPrograms; ++i) {
+            Program &program = mPrograms[i];
+            program.mVideoPID = kVideoPID + i * kProgramPIDStep;
+            program.mAudioPID = kAudioPID + i * kProgramPIDStep;
+            program.mVersion = 0;
+            program.mVideoCC = 0;
+            program.mAudioCC = 0;
+            // Each program starts at its own PTS.
+            program.mBasePTS = i * 100 * 90000ll;
+            program.mAudioPTS = 0;
+        }
+    }
+
+    // Moves the streams of |program| to other PIDs from the next PMT on.
+    void setPIDs(size_t program, unsigned videoPID, unsigned audioPID) {
+        mPrograms[program].mVideoPID = videoPID;
+        mPrograms[program].mAudioPID = audioPID;
+        ++mPrograms[program].mVersion;
+    }
+
+    void writeTables() {
+        interleave();
+
+        Vector<uint8_t> pat;
+        static const uint8_t kPATHeader[] = { 0x00, 0xb0, 0x00, 0x00, 0x01, 0xc1, 0x00, 0x00 };
+        pat.appendArray(kPATHeader, sizeof(kPATHeader));
+        for (size_t n = 0; n < mNumPrograms; ++n) {
+            size_t i = (mFirstProgram + n) % mNumPrograms;
+            unsigned pmtPID = kPMTPID + i * kProgramPIDStep;
+            uint8_t entry[4] = {
+                0x00, (uint8_t)(i + 1), (uint8_t)(0xe0 | (pmtPID >> 8)), (uint8_t)(pmtPID & 0xff),
+            };
+            pat.appendArray(entry, sizeof(entry));
+        }
+        pat.editItemAt(2) = pat.size() - 3 + 4;
+        writeSection(0 /* pid */, pat.array(), pat.size());
+
+        for (size_t i = 0; i < mNumPrograms; ++i) {
+            const Program &program = mPrograms[i];
+            uint8_t pmt[] = {
+                0x02, 0xb0, 0x17, 0x00, (uint8_t)(i + 1),
+                (uint8_t)(0xc1 | ((program.mVersion & 0x1f) << 1)), 0x00, 0x00,
+                (uint8_t)(0xe0 | (program.mVideoPID >> 8)), (uint8_t)(program.mVideoPID & 0xff),
+                0xf0, 0x00,
+                0x1b, (uint8_t)(0xe0 | (program.mVideoPID >> 8)),
+                (uint8_t)(program.mVideoPID & 0xff), 0xf0, 0x00,
+                0x0f, (uint8_t)(0xe0 | (program.mAudioPID >> 8)),
+                (uint8_t)(program.mAudioPID & 0xff), 0xf0, 0x00,
+            };
+            writeSection(kPMTPID + i * kProgramPIDStep, pmt, sizeof(pmt));
+        }
+    }
+
+    // Writes |seconds| of 30 fps video with a key frame every second and
+    // 44.1 kHz audio in PES packets of 3 frames for every program. Tables are
+    // repeated at each key frame.
+    void writeSeconds(size_t seconds, size_t sliceSize, size_t audioFrameSize) {
+        if (mFrame == 0) {
+            writeTables();
+        }
+
+        for (size_t end = mFrame + seconds * 30; mFrame < end; ++mFrame) {
+            int64_t videoPTS = mFrame * 3000;
+            bool isIDR = (mFrame % 30) == 0;
+            size_t size = isIDR ? sliceSize * 4 : sliceSize / 2 + (mFrame % 7) * sliceSize / 7;
+
+            for (size_t i = 0; i < mNumPrograms; ++i) {
+                Program &program = mPrograms[i];
+                while (program.mAudioPTS <= videoPTS) {
+                    writeAudioFrames(&program, program.mAudioPTS, 3, audioFrameSize);
+                    program.mAudioPTS += 3 * 1024 * 90000 / 44100;
+                }
+                writeVideoFrame(&program, videoPTS, size, isIDR);
+            }
+
+            interleave();
+            if (isIDR) {
+                writeTables();
+            }
+        }
+    }
+
+    const Vector<uint8_t> &data() const {
+        return mData;
+    }
+
+private:
+    struct Program {
+        unsigned mVideoPID;
+        unsigned mAudioPID;
+        unsigned mVersion;
+        // Continuity counters follow the streams, not the PIDs.
+        unsigned mVideoCC;
+        unsigned mAudioCC;
+        int64_t mBasePTS;
+        int64_t mAudioPTS;
+        // Packets written but not yet interleaved into mData.
+        Vector<uint8_t> mPending;
+    };
+
+    size_t mNumPrograms;
+    size_t mFirstProgram;
+    Program mPrograms[kMaxPrograms];
+    size_t mFrame;
+    Vector<uint8_t> mData;
+    uint32_t mSeed;
+
+    void writeVideoFrame(Program *program, int64_t pts, size_t sliceSize, bool isIDR) {
+        Vector<uint8_t> frame;
+        static const uint8_t kAUD[] = { 0x09, 0xf0 };
+        appendNAL(&frame, kAUD, sizeof(kAUD));
+        if (isIDR) {
+            appendNAL(&frame, kSPS, sizeof(kSPS));
+            appendNAL(&frame, kPPS, sizeof(kPPS));
+        }
+
+        Vector<uint8_t> slice;
+        slice.push(isIDR ? 0x25 : 0x21);
+        slice.push(0x88);  // first_mb_in_slice = 0
+        appendRandom(&slice, sliceSize);
+        appendNAL(&frame, slice.array(), slice.size());
+
+        writePES(program, program->mVideoPID, 0xe0, program->mBasePTS + pts, true /* pcr */,
+                 frame, &program->mVideoCC);
+    }
+
+    void writeAudioFrames(Program *program, int64_t pts, size_t count, size_t frameSize) {
+        Vector<uint8_t> frames;
+        for (size_t i = 0; i < count; ++i) {
+            size_t length = 7 + frameSize;
+            uint8_t header[7] = {
+                0xff, 0xf1,
+                0x50,  // AAC LC, 44.1 kHz
+                (uint8_t)(0x80 | (length >> 11)),  // stereo
+                (uint8_t)(length >> 3),
+                (uint8_t)(((length & 7) << 5) | 0x1f),
+                0xfc,
+            };
+            frames.appendArray(header, sizeof(header));
+            appendRandom(&frames, frameSize);
+        }
+
+        writePES(program, program->mAudioPID, 0xc0, program->mBasePTS + pts, false /* pcr */,
+                 frames, &program->mAudioCC);
+    }
+
+    // Moves the pending packets of all programs to mData, one packet of each
+    // program in turn.
+    void interleave() {
+        for (size_t offset = 0;; offset += kTSPacketSize) {
+            bool done = true;
+            for (size_t i = 0; i < mNumPrograms; ++i) {
+                const Vector<uint8_t> &pending = mPrograms[i].mPending;
+                if (offset < pending.size()) {
+                    mData.appendArray(pending.array() + offset, kTSPacketSize);
+                    done = false;
+                }
+            }
+            if (done) {
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < mNumPrograms; ++i) {
+            mPrograms[i].mPending.clear();
+        }
+    }
+
+    void appendRandom(Vector<uint8_t> *out, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            mSeed = mSeed * 1103515245 + 12345;
+            out->push(1 + (mSeed >> 16) % 255);
+        }
+    }
+
+    static void appendNAL(Vector<uint8_t> *out, const uint8_t *nal, size_t size) {
+        static const uint8_t kStartCode[] = { 0x00, 0x00, 0x00, 0x01 };
+        out->appendArray(kStartCode, sizeof(kStartCode));
+        out->appendArray(nal, size);
+    }
+
+    static uint32_t crc32(const uint8_t *data, size_t size) {
+        uint32_t crc = 0xffffffff;
+        for (size_t i = 0; i < size; ++i) {
+            crc ^= (uint32_t)data[i] << 24;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    void writeSection(unsigned pid, const uint8_t *section, size_t size) {
+        uint8_t packet[kTSPacketSize];
+        memset(packet, 0xff, sizeof(packet));
+        packet[0] = 0x47;
+        packet[1] = 0x40 | (pid >> 8);
+        packet[2] = pid & 0xff;
+        packet[3] = 0x10;
+        packet[4] = 0x00;  // pointer_field
+        memcpy(&packet[5], section, size);
+        uint32_t crc = crc32(section, size);
+        packet[5 + size] = crc >> 24;
+        packet[6 + size] = (crc >> 16) & 0xff;
+        packet[7 + size] = (crc >> 8) & 0xff;
+        packet[8 + size] = crc & 0xff;
+        mData.appendArray(packet, sizeof(packet));
+    }
+
+    void writePES(
+            Program *program, unsigned pid, unsigned streamId, int64_t pts, bool pcr,
+            const Vector<uint8_t> &payload, unsigned *cc) {
+        Vector<uint8_t> pes;
+        size_t length = 8 + payload.size();
+        uint8_t header[14] = {
+            0x00, 0x00, 0x01, (uint8_t)streamId,
+            (uint8_t)(length > 0xffff ? 0 : length >> 8),
+            (uint8_t)(length > 0xffff ? 0 : length & 0xff),
+            0x80, 0x80, 0x05,
+            (uint8_t)(0x21 | ((pts >> 29) & 0x0e)),
+            (uint8_t)(pts >> 22),
+            (uint8_t)(0x01 | ((pts >> 14) & 0xfe)),
+            (uint8_t)(pts >> 7),
+            (uint8_t)(0x01 | ((pts << 1) & 0xfe)),
+        };
+        pes.appendArray(header, sizeof(header));
+        pes.appendVector(payload);
+
+        size_t offset = 0;
+        while (offset < pes.size()) {
+            uint8_t packet[kTSPacketSize];
+            // The PCR takes the flags byte and 6 bytes of adaptation field.
+            bool hasPCR = pcr && offset == 0;
+            size_t copy = pes.size() - offset;
+            if (copy > kTSPacketSize - 4 - (hasPCR ? 8 : 0)) {
+                copy = kTSPacketSize - 4 - (hasPCR ? 8 : 0);
+            }
+
+            packet[0] = 0x47;
+            packet[1] = (offset == 0 ? 0x40 : 0x00) | (pid >> 8);
+            packet[2] = pid & 0xff;
+            size_t headerSize = 4;
+            if (copy < kTSPacketSize - 4) {
+                // Put the PCR or stuffing into an adaptation field.
+                size_t fieldSize = kTSPacketSize - 4 - copy;
+                packet[3] = 0x30 | *cc;
+                packet[4] = fieldSize - 1;
+                if (fieldSize > 1) {
+                    size_t used = 2;
+                    packet[5] = hasPCR ? 0x10 : 0x00;
+                    if (hasPCR) {
+                        // PCR_base is the PTS, PCR_ext is 0.
+                        uint64_t base = pts & 0x1ffffffffull;
+                        packet[6] = base >> 25;
+                        packet[7] = base >> 17;
+                        packet[8] = base >> 9;
+                        packet[9] = base >> 1;
+                        packet[10] = ((base & 1) << 7) | 0x7e;
+                        packet[11] = 0x00;
+                        used += 6;
+                    }
+                    memset(&packet[4 + used], 0xff, fieldSize - used);
+                }
+                headerSize += fieldSize;
+            } else {
+                packet[3] = 0x10 | *cc;
+            }
+            *cc = (*cc + 1) & 0x0f;
+
+            memcpy(&packet[headerSize], pes.array() + offset, copy);
+            program->mPending.appendArray(packet, sizeof(packet));
+            offset += copy;
+        }
+    }
+};
+
+struct AccessUnit {
+    status_t mResult;
+    int64_t mTimeUs;
+    sp<ABuffer> mBuffer;
+};
+
+static status_t feed(
+        const sp<ATSParser> &parser, const Vector<uint8_t> &data,
+        size_t start, size_t end) {
+    for (size_t offset = start; offset < end; offset += kTSPacketSize) {
+        status_t err = parser->feedTSPacket(data.array() + offset, kTSPacketSize);
+        if (err != OK) {
+            return err;
+        }
+    }
+    return OK;
+}
+
+static void dequeueAll(
+        const sp<ATSParser> &parser, ATSParser::SourceType type,
+        Vector<AccessUnit> *units) {
+    sp<MediaSource> source = parser->getSource(type);
+    ASSERT_TRUE(source != NULL);
+    sp<AnotherPacketSource> packetSource =
+            static_cast<AnotherPacketSource *>(source.get());
+
+    for (;;) {
+        AccessUnit unit;
+        unit.mTimeUs = -1;
+        unit.mResult = packetSource->dequeueAccessUnit(&unit.mBuffer);
+        if (unit.mResult == OK) {
+            ASSERT_TRUE(unit.mBuffer->meta()->findInt64("timeUs", &unit.mTimeUs));
+        }
+        units->push(unit);
+        if (unit.mResult != OK && unit.mResult != INFO_DISCONTINUITY) {
+            break;
+        }
+    }
+}
+
+// Demuxes |data|, with a time discontinuity at |discontinuityOffset| unless
+// that is 0.
+static void demux(
+        uint32_t flags, const Vector<uint8_t> &data, size_t discontinuityOffset,
+        Vector<AccessUnit> *video, Vector<AccessUnit> *audio) {
+    sp<ATSParser> parser = new ATSParser(flags);
+
+    if (discontinuityOffset > 0) {
+        ASSERT_EQ((status_t)OK, feed(parser, data, 0, discontinuityOffset));
+        parser->signalDiscontinuity(ATSParser::DISCONTINUITY_TIME, NULL /* extra */);
+    }
+    ASSERT_EQ((status_t)OK, feed(parser, data, discontinuityOffset, data.size()));
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    dequeueAll(parser, ATSParser::VIDEO, video);
+    dequeueAll(parser, ATSParser::AUDIO, audio);
+}
+
+static void expectSameAccessUnits(
+        const Vector<AccessUnit> &expected, const Vector<AccessUnit> &actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const AccessUnit &a = expected.itemAt(i);
+        const AccessUnit &b = actual.itemAt(i);
+        EXPECT_EQ(a.mResult, b.mResult) << "at access unit " << i;
+        EXPECT_EQ(a.mTimeUs, b.mTimeUs) << "at access unit " << i;
+        if (a.mResult == OK && b.mResult == OK) {
+            ASSERT_EQ(a.mBuffer->size(), b.mBuffer->size()) << "at access unit " << i;
+            EXPECT_EQ(0, memcmp(a.mBuffer->data(), b.mBuffer->data(), a.mBuffer->size()))
+                    << "at access unit " << i;
+        }
+    }
+}
+
+class ATSParserTest : public ::testing::Test {
+};
+
+TEST_F(ATSParserTest, ParallelDemuxMatchesSerialDemux) {
+    TSWriter writer;
+    writer.writeSeconds(10, 3000, 300);
+
+    Vector<AccessUnit> serialVideo, serialAudio;
+    demux(0, writer.data(), 0, &serialVideo, &serialAudio);
+
+    // The last video frame is only complete at the next access unit
+    // delimiter, which never comes. Audio has one access unit per PES packet.
+    // Both end with EOS.
+    EXPECT_EQ(300u, serialVideo.size());
+    EXPECT_EQ(145u, serialAudio.size());
+
+    Vector<AccessUnit> parallelVideo, parallelAudio;
+    demux(ATSParser::PARALLEL_DEMUX, writer.data(), 0, &parallelVideo, &parallelAudio);
+
+    expectSameAccessUnits(serialVideo, parallelVideo);
+    expectSameAccessUnits(serialAudio, parallelAudio);
+}
+
+TEST_F(ATSParserTest, ParallelDemuxDiscontinuity) {
+    TSWriter writer;
+    writer.writeSeconds(10, 3000, 300);
+    const Vector<uint8_t> &data = writer.data();
+    size_t middle = (data.size() / kTSPacketSize / 2) * kTSPacketSize;
+
+    // The discontinuity discards whatever was queued before it, so the
+    // workers must have parsed all earlier packets when it is signalled.
+    Vector<AccessUnit> serialVideo, serialAudio;
+    demux(0, data, middle, &serialVideo, &serialAudio);
+
+    ASSERT_LT(2u, serialVideo.size());
+    EXPECT_EQ(INFO_DISCONTINUITY, serialVideo.itemAt(0).mResult);
+    EXPECT_GT(301u, serialVideo.size());
+
+    Vector<AccessUnit> parallelVideo, parallelAudio;
+    demux(ATSParser::PARALLEL_DEMUX, data, middle, &parallelVideo, &parallelAudio);
+
+    expectSameAccessUnits(serialVideo, parallelVideo);
+    expectSameAccessUnits(serialAudio, parallelAudio);
+}
+
+TEST_F(ATSParserTest, ParallelDemuxPIDSwap) {
+    TSWriter writer;
+    writer.writeSeconds(10, 3000, 300);
+
+    Vector<AccessUnit> expectedVideo, expectedAudio;
+    demux(0, writer.data(), 0, &expectedVideo, &expectedAudio);
+
+    // Halfway through, a new PMT moves video to the audio PID and vice
+    // versa. The packets queued to the worker before the PMT still belong to
+    // the streams their PIDs mapped to when they were queued.
+    TSWriter swapped;
+    swapped.writeSeconds(5, 3000, 300);
+    swapped.setPIDs(0, kAudioPID /* videoPID */, kVideoPID /* audioPID */);
+    swapped.writeTables();
+    swapped.writeSeconds(5, 3000, 300);
+
+    Vector<AccessUnit> serialVideo, serialAudio;
+    demux(0, swapped.data(), 0, &serialVideo, &serialAudio);
+
+    expectSameAccessUnits(expectedVideo, serialVideo);
+    expectSameAccessUnits(expectedAudio, serialAudio);
+
+    Vector<AccessUnit> parallelVideo, parallelAudio;
+    demux(ATSParser::PARALLEL_DEMUX, swapped.data(), 0, &parallelVideo, &parallelAudio);
+
+    expectSameAccessUnits(expectedVideo, parallelVideo);
+    expectSameAccessUnits(expectedAudio, parallelAudio);
+}
+
+TEST_F(ATSParserTest, ParallelDemuxMultipleProgramsMatchSerialDemux) {
+    static const size_t kNumPrograms = 3;
+
+    // getSource() returns the streams of the program listed first in the PAT,
+    // so each program is checked in a stream that lists it first. The
+    // packets are the same otherwise.
+    Vector<AccessUnit> firstVideo;
+    for (size_t program = 0; program < kNumPrograms; ++program) {
+        TSWriter writer(kNumPrograms, program);
+        writer.writeSeconds(5, 3000, 300);
+
+        Vector<AccessUnit> serialVideo, serialAudio;
+        demux(0, writer.data(), 0, &serialVideo, &serialAudio);
+
+        EXPECT_EQ(150u, serialVideo.size()) << "program " << program;
+        EXPECT_EQ(73u, serialAudio.size()) << "program " << program;
+        ASSERT_EQ((status_t)OK, serialVideo.itemAt(0).mResult);
+        EXPECT_EQ(0, serialVideo.itemAt(0).mTimeUs) << "program " << program;
+
+        // Make sure this is a different program than the first one.
+        if (program == 0) {
+            firstVideo = serialVideo;
+        } else {
+            const sp<ABuffer> &a = firstVideo.itemAt(0).mBuffer;
+            const sp<ABuffer> &b = serialVideo.itemAt(0).mBuffer;
+            EXPECT_TRUE(a->size() != b->size()
+                    || memcmp(a->data(), b->data(), a->size()) != 0)
+                    << "program " << program;
+        }
+
+        Vector<AccessUnit> parallelVideo, parallelAudio;
+        demux(ATSParser::PARALLEL_DEMUX, writer.data(), 0, &parallelVideo, &parallelAudio);
+
+        expectSameAccessUnits(serialVideo, parallelVideo);
+        expectSameAccessUnits(serialAudio, parallelAudio);
+    }
+}
+
+TEST_F(ATSParserTest, ParallelDemuxThroughput) {
+    // Four programs of about 3 Mbit/s each, like a broadcast multiplex.
+    static const size_t kNumPrograms = 4;
+    TSWriter writer(kNumPrograms);
+    writer.writeSeconds(30, 11000, 370);
+    const Vector<uint8_t> &data = writer.data();
+
+    // Best of two runs each. The access units of the first program must match
+    // between the two modes.
+    int64_t serialUs = 0, parallelUs = 0;
+    Vector<AccessUnit> serialVideo, serialAudio, parallelVideo, parallelAudio;
+    for (int i = 0; i < 4; ++i) {
+        uint32_t flags = (i & 1) ? ATSParser::PARALLEL_DEMUX : 0;
+        sp<ATSParser> parser = new ATSParser(flags);
+
+        int64_t startUs = ALooper::GetNowUs();
+        ASSERT_EQ((status_t)OK, feed(parser, data, 0, data.size()));
+        parser->signalEOS(ERROR_END_OF_STREAM);
+        int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+
+        int64_t *bestUs = (flags & ATSParser::PARALLEL_DEMUX) ? &parallelUs : &serialUs;
+        if (*bestUs == 0 || elapsedUs < *bestUs) {
+            *bestUs = elapsedUs;
+        }
+
+        if (i < 2) {
+            Vector<AccessUnit> *video = (flags & ATSParser::PARALLEL_DEMUX)
+                    ? &parallelVideo : &serialVideo;
+            Vector<AccessUnit> *audio = (flags & ATSParser::PARALLEL_DEMUX)
+                    ? &parallelAudio : &serialAudio;
+            dequeueAll(parser, ATSParser::VIDEO, video);
+            dequeueAll(parser, ATSParser::AUDIO, audio);
+        }
+    }
+
+    EXPECT_EQ(900u, serialVideo.size());
+    expectSameAccessUnits(serialVideo, parallelVideo);
+    expectSameAccessUnits(serialAudio, parallelAudio);
+
+    ALOGI("demuxed %zu bytes of %zu programs in %lld us serially, %lld us with "
+          "PARALLEL_DEMUX", data.size(), kNumPrograms, (long long)serialUs,
+          (long long)parallelUs);
+}
+
+}  // namespace android
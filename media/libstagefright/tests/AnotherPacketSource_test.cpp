@@ -0,0 +1,158 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AnotherPacketSource_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MetaData.h>
+
+#include "mpeg2ts/AnotherPacketSource.h"
+
+namespace android {
+
+static sp<ABuffer> makeAccessUnit(
+        int64_t timeUs, int32_t seq = 0, bool isSync = false) {
+    sp<ABuffer> buffer = new ABuffer(16);
+    buffer->meta()->setInt64("timeUs", timeUs);
+    buffer->meta()->setInt32("discontinuitySeq", seq);
+    if (isSync) {
+        buffer->meta()->setInt32("isSync", 1);
+    }
+    return buffer;
+}
+
+static sp<AMessage> makeMeta(int64_t timeUs, int32_t seq = 0) {
+    sp<AMessage> meta = new AMessage;
+    meta->setInt64("timeUs", timeUs);
+    meta->setInt32("discontinuitySeq", seq);
+    return meta;
+}
+
+static int64_t timeOf(const sp<AMessage> &meta) {
+    int64_t timeUs = -1;
+    if (meta != NULL) {
+        meta->findInt64("timeUs", &timeUs);
+    }
+    return timeUs;
+}
+
+class AnotherPacketSourceTest : public ::testing::Test {
+};
+
+TEST_F(AnotherPacketSourceTest, TestMetaAfterLastDequeued) {
+    sp<AnotherPacketSource> source = new AnotherPacketSource(NULL);
+
+    for (int64_t i = 0; i < 5; ++i) {
+        source->queueAccessUnit(makeAccessUnit(i * 100000ll));
+    }
+    source->queueDiscontinuity(
+            ATSParser::DISCONTINUITY_TIME, NULL, false /* discard */);
+    for (int64_t i = 0; i < 5; ++i) {
+        source->queueAccessUnit(makeAccessUnit(1000000ll + i * 100000ll, 1));
+    }
+
+    ASSERT_EQ(timeOf(source->getMetaAfterLastDequeued(0)), 0);
+    ASSERT_EQ(timeOf(source->getMetaAfterLastDequeued(250000ll)), 300000);
+    // 400ms before the discontinuity, 100ms after it.
+    ASSERT_EQ(timeOf(source->getMetaAfterLastDequeued(500000ll)), 1100000);
+    ASSERT_TRUE(source->getMetaAfterLastDequeued(900000ll) == NULL);
+
+    sp<ABuffer> buffer;
+    ASSERT_EQ(source->dequeueAccessUnit(&buffer), (status_t)OK);
+    ASSERT_EQ(source->dequeueAccessUnit(&buffer), (status_t)OK);
+    // 200ms left before the discontinuity.
+    ASSERT_EQ(timeOf(source->getMetaAfterLastDequeued(250000ll)), 1100000);
+}
+
+TEST_F(AnotherPacketSourceTest, TestTrimAfter) {
+    sp<AnotherPacketSource> source = new AnotherPacketSource(NULL);
+
+    for (int64_t i = 0; i < 10; ++i) {
+        source->queueAccessUnit(makeAccessUnit(i * 100000ll));
+    }
+
+    source->trimBuffersAfterMeta(makeMeta(450000ll));
+
+    status_t finalResult;
+    ASSERT_EQ(source->getAvailableBufferCount(&finalResult), 5u);
+    ASSERT_EQ(timeOf(source->getLatestEnqueuedMeta()), 400000);
+    ASSERT_EQ(source->getBufferedDurationUs(&finalResult), 400000);
+
+    // Units queued after trimming are found again.
+    source->queueAccessUnit(makeAccessUnit(500000ll));
+    ASSERT_EQ(timeOf(source->getMetaAfterLastDequeued(500000ll)), 500000);
+
+    source->trimBuffersAfterMeta(makeMeta(0ll, 1));
+    ASSERT_EQ(source->getAvailableBufferCount(&finalResult), 6u);
+
+    source->trimBuffersAfterMeta(makeMeta(0ll));
+    ASSERT_EQ(source->getAvailableBufferCount(&finalResult), 0u);
+}
+
+TEST_F(AnotherPacketSourceTest, TestTrimBeforeAVC) {
+    sp<AnotherPacketSource> source = new AnotherPacketSource(NULL);
+
+    sp<MetaData> format = new MetaData;
+    format->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_AVC);
+
+    for (int64_t i = 0; i < 10; ++i) {
+        sp<ABuffer> buffer = makeAccessUnit(i * 100000ll, 0, i % 5 == 0);
+        if (i == 0) {
+            buffer->meta()->setObject("format", format);
+        }
+        source->queueAccessUnit(buffer);
+    }
+
+    sp<AMessage> firstMeta = source->trimBuffersBeforeMeta(makeMeta(200000ll));
+    ASSERT_EQ(timeOf(firstMeta), 500000);
+
+    status_t finalResult;
+    ASSERT_EQ(source->getAvailableBufferCount(&finalResult), 5u);
+
+    ASSERT_TRUE(source->trimBuffersBeforeMeta(makeMeta(800000ll)) == NULL);
+    ASSERT_EQ(source->getAvailableBufferCount(&finalResult), 0u);
+}
+
+TEST_F(AnotherPacketSourceTest, TestDiscardLeavesDiscontinuities) {
+    sp<AnotherPacketSource> source = new AnotherPacketSource(NULL);
+
+    status_t finalResult;
+    for (int64_t i = 0; i < 3; ++i) {
+        source->queueAccessUnit(makeAccessUnit(i * 100000ll));
+    }
+    ASSERT_TRUE(source->hasDataBufferAvailable(&finalResult));
+
+    source->queueDiscontinuity(
+            ATSParser::DISCONTINUITY_TIME, NULL, true /* discard */);
+    ASSERT_TRUE(source->hasBufferAvailable(&finalResult));
+    ASSERT_FALSE(source->hasDataBufferAvailable(&finalResult));
+    ASSERT_EQ(source->getAvailableBufferCount(&finalResult), 1u);
+
+    source->queueAccessUnit(makeAccessUnit(0ll, 1));
+    ASSERT_TRUE(source->hasDataBufferAvailable(&finalResult));
+
+    sp<ABuffer> buffer;
+    ASSERT_EQ(source->dequeueAccessUnit(&buffer), (status_t)INFO_DISCONTINUITY);
+    ASSERT_EQ(source->dequeueAccessUnit(&buffer), (status_t)OK);
+    ASSERT_FALSE(source->hasBufferAvailable(&finalResult));
+}
+
+}  // namespace android
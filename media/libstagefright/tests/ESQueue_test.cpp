@@ -0,0 +1,160 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ESQueue_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <utils/Vector.h>
+
+#include "mpeg2ts/ESQueue.h"
+
+namespace android {
+
+// Baseline profile 352x288.
+static const uint8_t kSPS[] = { 0x27, 0x42, 0x00, 0x15, 0xa6, 0x81, 0x60, 0x94, 0x40 };
+static const uint8_t kPPS[] = { 0x28, 0xce, 0x3c, 0x80 };
+
+static uint32_t gSeed = 1;
+
+static uint32_t nextRandom() {
+    gSeed = gSeed * 1103515245 + 12345;
+    return gSeed >> 16;
+}
+
+static void appendNAL(Vector<uint8_t> *out, const uint8_t *nal, size_t size) {
+    static const uint8_t kStartCode[] = { 0x00, 0x00, 0x00, 0x01 };
+    out->appendArray(kStartCode, sizeof(kStartCode));
+    out->appendArray(nal, size);
+}
+
+// An H.264 access unit whose slice data has no zero bytes, so there is no
+// start code emulation to worry about.
+static sp<ABuffer> makeFrame(size_t sliceSize, bool isIDR) {
+    Vector<uint8_t> frame;
+    static const uint8_t kAUD[] = { 0x09, 0xf0 };
+    appendNAL(&frame, kAUD, sizeof(kAUD));
+    if (isIDR) {
+        appendNAL(&frame, kSPS, sizeof(kSPS));
+        appendNAL(&frame, kPPS, sizeof(kPPS));
+    }
+
+    Vector<uint8_t> slice;
+    slice.push(isIDR ? 0x25 : 0x21);
+    slice.push(0x88);  // first_mb_in_slice = 0
+    for (size_t i = 0; i < sliceSize; ++i) {
+        slice.push(1 + nextRandom() % 255);
+    }
+    appendNAL(&frame, slice.array(), slice.size());
+
+    sp<ABuffer> buffer = new ABuffer(frame.size());
+    memcpy(buffer->data(), frame.array(), frame.size());
+    return buffer;
+}
+
+// Appends |frames| in pieces of at most |maxPieceSize| bytes, each frame
+// timestamped with its index, and checks that they come back unchanged.
+// The last frame stays queued since nothing follows it.
+static void expectSameFrames(const Vector<sp<ABuffer> > &frames, size_t maxPieceSize) {
+    ElementaryStreamQueue queue(ElementaryStreamQueue::H264);
+
+    size_t numDequeued = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const sp<ABuffer> &frame = frames.itemAt(i);
+        size_t offset = 0;
+        while (offset < frame->size()) {
+            size_t pieceSize = 1 + nextRandom() % maxPieceSize;
+            if (pieceSize > frame->size() - offset) {
+                pieceSize = frame->size() - offset;
+            }
+            // Only the first piece of a frame starts with a start code.
+            ASSERT_EQ((status_t)OK, queue.appendData(
+                    frame->data() + offset, pieceSize, offset == 0 ? i : -1));
+            offset += pieceSize;
+
+            sp<ABuffer> accessUnit;
+            while ((accessUnit = queue.dequeueAccessUnit()) != NULL) {
+                ASSERT_LT(numDequeued, i);
+                const sp<ABuffer> &expected = frames.itemAt(numDequeued);
+                ASSERT_EQ(expected->size(), accessUnit->size()) << "frame " << numDequeued;
+                EXPECT_EQ(0, memcmp(expected->data(), accessUnit->data(), expected->size()))
+                        << "frame " << numDequeued;
+
+                int64_t timeUs;
+                ASSERT_TRUE(accessUnit->meta()->findInt64("timeUs", &timeUs));
+                EXPECT_EQ((int64_t)numDequeued, timeUs);
+                ++numDequeued;
+            }
+        }
+    }
+
+    EXPECT_EQ(frames.size() - 1, numDequeued);
+}
+
+class ESQueueTest : public ::testing::Test {
+};
+
+TEST_F(ESQueueTest, H264FramesOfVaryingSize) {
+    // Mix small and large frames so that the queue both grows its buffer
+    // and reclaims consumed space.
+    Vector<sp<ABuffer> > frames;
+    for (size_t i = 0; i < 400; ++i) {
+        size_t sliceSize = (i % 50 == 0) ? 300000 : 100 + nextRandom() % 40000;
+        frames.push(makeFrame(sliceSize, (i % 30) == 0));
+    }
+
+    expectSameFrames(frames, 200000);
+    expectSameFrames(frames, 4096);
+}
+
+TEST_F(ESQueueTest, H264Throughput) {
+    // 10 seconds at 50 Mbit/s and 30 fps, key frames four times the size
+    // of the others.
+    static const size_t kNumFrames = 300;
+    static const size_t kBytesPerSecond = 50000000 / 8;
+    static const size_t kFrameSize = kBytesPerSecond / 30;
+
+    Vector<sp<ABuffer> > frames;
+    for (size_t i = 0; i < kNumFrames; ++i) {
+        bool isIDR = (i % 30) == 0;
+        frames.push(makeFrame(isIDR ? 4 * kFrameSize : kFrameSize * 26 / 29, isIDR));
+    }
+
+    ElementaryStreamQueue queue(ElementaryStreamQueue::H264);
+
+    // One frame per PES packet, the way most muxers write video.
+    int64_t startUs = ALooper::GetNowUs();
+    size_t numDequeued = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const sp<ABuffer> &frame = frames.itemAt(i);
+        ASSERT_EQ((status_t)OK, queue.appendData(frame->data(), frame->size(), i * 33333));
+        while (queue.dequeueAccessUnit() != NULL) {
+            ++numDequeued;
+        }
+    }
+    int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+
+    EXPECT_EQ(kNumFrames - 1, numDequeued);
+    ALOGI("%zu access units at 50 Mbit/s in %lld us, %lld us per access unit",
+          numDequeued, (long long)elapsedUs, (long long)(elapsedUs / numDequeued));
+}
+
+}  // namespace android
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "M3UParser_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Timers.h>
+
+#include "httplive/M3UParser.h"
+
+namespace android {
+
+static const char *kBaseURI = "http://example.com/live/index.m3u8";
+
+// A live playlist of segments [first, first + count), with a discontinuity
+// before every segment whose number is a multiple of 100.
+static AString makePlaylist(
+        int32_t first, int32_t count,
+        const char *prefix = "seg", const char *serverControl = NULL) {
+    AString playlist("#EXTM3U\n#EXT-X-TARGETDURATION:4\n");
+    if (serverControl != NULL) {
+        playlist.append(serverControl);
+        playlist.append("\n");
+    }
+    playlist.append(AStringPrintf("#EXT-X-MEDIA-SEQUENCE:%d\n", first));
+    playlist.append(
+            AStringPrintf("#EXT-X-DISCONTINUITY-SEQUENCE:%d\n", first / 100));
+    for (int32_t seq = first; seq < first + count; ++seq) {
+        if (seq % 100 == 0 && seq != first) {
+            playlist.append("#EXT-X-DISCONTINUITY\n");
+        }
+        playlist.append(AStringPrintf("#EXTINF:4.0,\n%s%d.ts\n", prefix, seq));
+    }
+    return playlist;
+}
+
+static sp<M3UParser> parse(
+        const AString &playlist, const sp<M3UParser> &previous = NULL) {
+    return new M3UParser(
+            kBaseURI, playlist.c_str(), playlist.size(), previous);
+}
+
+static void expectSegment(
+        const sp<M3UParser> &parser, int32_t seq, const char *prefix = "seg") {
+    AString uri;
+    sp<AMessage> meta;
+    ASSERT_TRUE(parser->itemAt(seq - parser->getFirstSeqNumber(), &uri, &meta));
+    EXPECT_EQ(AStringPrintf("http://example.com/live/%s%d.ts", prefix, seq), uri);
+
+    int64_t durationUs;
+    ASSERT_TRUE(meta->findInt64("durationUs", &durationUs));
+    EXPECT_EQ(4000000ll, durationUs);
+
+    int32_t discontinuitySeq;
+    ASSERT_TRUE(meta->findInt32("discontinuity-sequence", &discontinuitySeq));
+    EXPECT_EQ(seq / 100, discontinuitySeq);
+}
+
+static sp<AMessage> metaAt(const sp<M3UParser> &parser, int32_t seq) {
+    sp<AMessage> meta;
+    parser->itemAt(seq - parser->getFirstSeqNumber(), NULL /* uri */, &meta);
+    return meta;
+}
+
+class M3UParserTest : public ::testing::Test {
+};
+
+TEST_F(M3UParserTest, TestRefreshTakesOverSegments) {
+    sp<M3UParser> previous = parse(makePlaylist(90, 20));
+    ASSERT_EQ((status_t)OK, previous->initCheck());
+
+    sp<M3UParser> parser = parse(makePlaylist(95, 20), previous);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    ASSERT_EQ(20u, parser->size());
+
+    for (int32_t seq = 95; seq < 115; ++seq) {
+        expectSegment(parser, seq);
+    }
+
+    // Segments still listed are shared with the previous version.
+    for (int32_t seq = 95; seq < 110; ++seq) {
+        EXPECT_TRUE(metaAt(parser, seq) == metaAt(previous, seq));
+    }
+    for (int32_t seq = 110; seq < 115; ++seq) {
+        EXPECT_TRUE(metaAt(parser, seq) != NULL);
+    }
+}
+
+TEST_F(M3UParserTest, TestRefreshOfRewrittenPlaylist) {
+    sp<M3UParser> previous = parse(makePlaylist(90, 20));
+    sp<M3UParser> parser = parse(makePlaylist(95, 20, "new"), previous);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    ASSERT_EQ(20u, parser->size());
+
+    for (int32_t seq = 95; seq < 115; ++seq) {
+        expectSegment(parser, seq, "new");
+        EXPECT_TRUE(metaAt(parser, seq) != metaAt(previous, seq));
+    }
+}
+
+TEST_F(M3UParserTest, TestRefreshWithRepeatedKey) {
+    AString playlist("#EXTM3U\n#EXT-X-TARGETDURATION:4\n#EXT-X-MEDIA-SEQUENCE:1\n"
+            "#EXT-X-KEY:METHOD=AES-128,URI=\"key\"\n"
+            "#EXTINF:4.0,\nseg1.ts\n#EXTINF:4.0,\nseg2.ts\n");
+    sp<M3UParser> previous = parse(playlist);
+
+    playlist.setTo("#EXTM3U\n#EXT-X-TARGETDURATION:4\n#EXT-X-MEDIA-SEQUENCE:2\n"
+            "#EXT-X-KEY:METHOD=AES-128,URI=\"key\"\n"
+            "#EXTINF:4.0,\nseg2.ts\n#EXTINF:4.0,\nseg3.ts\n");
+    sp<M3UParser> parser = parse(playlist, previous);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    ASSERT_EQ(2u, parser->size());
+
+    // The key now comes with segment 2, which has to be parsed again.
+    AString method;
+    ASSERT_TRUE(metaAt(parser, 2)->findString("cipher-method", &method));
+    EXPECT_EQ(AString("AES-128"), method);
+    EXPECT_FALSE(metaAt(parser, 3)->findString("cipher-method", &method));
+}
+
+TEST_F(M3UParserTest, TestDeltaUpdate) {
+    const char *kServerControl =
+        "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=24.0";
+    sp<M3UParser> previous = parse(makePlaylist(90, 20, "seg", kServerControl));
+    ASSERT_EQ((status_t)OK, previous->initCheck());
+    EXPECT_EQ(24000000ll, previous->getSkipBoundary());
+
+    // Segments 95..106 are left out of the update.
+    AString delta("#EXTM3U\n#EXT-X-TARGETDURATION:4\n");
+    delta.append(kServerControl);
+    delta.append("\n#EXT-X-MEDIA-SEQUENCE:95\n#EXT-X-DISCONTINUITY-SEQUENCE:0\n"
+            "#EXT-X-SKIP:SKIPPED-SEGMENTS=12\n");
+    for (int32_t seq = 107; seq < 115; ++seq) {
+        delta.append(AStringPrintf("#EXTINF:4.0,\nseg%d.ts\n", seq));
+    }
+
+    sp<M3UParser> parser = parse(delta, previous);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    ASSERT_EQ(20u, parser->size());
+
+    int32_t firstSeq, lastSeq;
+    parser->getSeqNumberRange(&firstSeq, &lastSeq);
+    EXPECT_EQ(95, firstSeq);
+    EXPECT_EQ(114, lastSeq);
+
+    for (int32_t seq = 95; seq < 115; ++seq) {
+        expectSegment(parser, seq);
+    }
+
+    // An update can't be applied without the segments it skips.
+    EXPECT_NE((status_t)OK, parse(delta)->initCheck());
+    EXPECT_NE((status_t)OK, parse(delta, parse(makePlaylist(100, 20)))->initCheck());
+}
+
+TEST_F(M3UParserTest, TestPartialSegments) {
+    AString playlist("#EXTM3U\n#EXT-X-TARGETDURATION:4\n"
+            "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.0\n"
+            "#EXT-X-PART-INF:PART-TARGET=1.0\n#EXT-X-MEDIA-SEQUENCE:10\n"
+            "#EXTINF:4.0,\nseg10.ts\n"
+            "#EXT-X-PART:DURATION=1.0,URI=\"seg11.ts\",BYTERANGE=1000@0,INDEPENDENT=YES\n"
+            "#EXT-X-PART:DURATION=1.0,URI=\"seg11.ts\",BYTERANGE=1500\n"
+            "#EXTINF:2.0,\nseg11.ts\n"
+            "#EXT-X-PART:DURATION=1.0,URI=\"seg12.0.ts\"\n"
+            "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg12.1.ts\"\n");
+    sp<M3UParser> parser = parse(playlist);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+
+    EXPECT_TRUE(parser->canBlockReload());
+    EXPECT_EQ(1000000ll, parser->getPartTargetDuration());
+    EXPECT_EQ(3000000ll, parser->getPartHoldBack());
+
+    EXPECT_EQ(0u, parser->getPartCount(10));
+    EXPECT_EQ(2u, parser->getPartCount(11));
+    EXPECT_EQ(1u, parser->getPartCount(12));
+
+    AString uri;
+    sp<AMessage> meta;
+    int64_t rangeOffset, rangeLength;
+    ASSERT_TRUE(parser->partAt(11, 1, &uri, &meta));
+    EXPECT_EQ(AString("http://example.com/live/seg11.ts"), uri);
+    ASSERT_TRUE(meta->findInt64("range-offset", &rangeOffset));
+    ASSERT_TRUE(meta->findInt64("range-length", &rangeLength));
+    EXPECT_EQ(1000, rangeOffset);
+    EXPECT_EQ(1500, rangeLength);
+    EXPECT_FALSE(parser->partAt(11, 2, &uri, &meta));
+
+    int32_t seq;
+    size_t index;
+    ASSERT_TRUE(parser->getPreloadHint(&seq, &index, &uri));
+    EXPECT_EQ(12, seq);
+    EXPECT_EQ(1u, index);
+    EXPECT_EQ(AString("http://example.com/live/seg12.1.ts"), uri);
+}
+
+// A low-latency playlist with 4 second segments 10..12 and the first two
+// parts of segment 13. The 1 second parts of segments 11..13 are listed,
+// the third part of each segment and the second one of segment 13 are
+// independent.
+static sp<M3UParser> parsePartialSegments(const char *partHoldBack) {
+    AString playlist("#EXTM3U\n#EXT-X-TARGETDURATION:4\n");
+    playlist.append(AStringPrintf(
+            "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%s\n",
+            partHoldBack));
+    playlist.append("#EXT-X-PART-INF:PART-TARGET=1.0\n#EXT-X-MEDIA-SEQUENCE:10\n"
+            "#EXTINF:4.0,\nseg10.ts\n");
+    for (int32_t seq = 11; seq <= 13; ++seq) {
+        size_t numParts = (seq == 13) ? 2 : 4;
+        for (size_t i = 0; i < numParts; ++i) {
+            bool independent = (i == 2) || (seq == 13 && i == 1);
+            playlist.append(AStringPrintf(
+                    "#EXT-X-PART:DURATION=1.0,URI=\"seg%d.%zu.ts\"%s\n",
+                    seq, i, independent ? ",INDEPENDENT=YES" : ""));
+        }
+        if (seq < 13) {
+            playlist.append(AStringPrintf("#EXTINF:4.0,\nseg%d.ts\n", seq));
+        }
+    }
+    return parse(playlist);
+}
+
+static void expectPartHoldBackStart(
+        const char *partHoldBack, int32_t seq, int32_t partIndex) {
+    sp<M3UParser> parser = parsePartialSegments(partHoldBack);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+
+    int32_t startPartIndex;
+    EXPECT_EQ(seq, parser->getPartHoldBackStart(&startPartIndex))
+            << "PART-HOLD-BACK=" << partHoldBack;
+    EXPECT_EQ(partIndex, startPartIndex) << "PART-HOLD-BACK=" << partHoldBack;
+}
+
+TEST_F(M3UParserTest, TestPartHoldBackStart) {
+    sp<M3UParser> parser = parsePartialSegments("3.0");
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    EXPECT_EQ(4u, parser->getPartCount(12));
+    EXPECT_EQ(2u, parser->getPartCount(13));
+
+    // Within the segment in progress.
+    expectPartHoldBackStart("1.0", 13, 1);
+    // At the first independent part at least that far back.
+    expectPartHoldBackStart("3.0", 12, 2);
+    expectPartHoldBackStart("4.0", 12, 2);
+    // A complete segment is downloaded whole when starting with its first
+    // part.
+    expectPartHoldBackStart("4.5", 12, -1);
+    expectPartHoldBackStart("6.0", 12, -1);
+    // Beyond the listed parts, segment by segment.
+    expectPartHoldBackStart("8.0", 11, 2);
+    expectPartHoldBackStart("11.0", 10, -1);
+    expectPartHoldBackStart("60.0", 10, -1);
+}
+
+TEST_F(M3UParserTest, TestRefreshWithPartialSegments) {
+    sp<M3UParser> previous = parsePartialSegments("3.0");
+    ASSERT_EQ((status_t)OK, previous->initCheck());
+
+    // Segment 13 completed and the first part of segment 14 is out.
+    AString playlist("#EXTM3U\n#EXT-X-TARGETDURATION:4\n"
+            "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.0\n"
+            "#EXT-X-PART-INF:PART-TARGET=1.0\n#EXT-X-MEDIA-SEQUENCE:11\n"
+            "#EXTINF:4.0,\nseg11.ts\n");
+    for (int32_t seq = 12; seq <= 14; ++seq) {
+        size_t numParts = (seq == 14) ? 1 : 4;
+        for (size_t i = 0; i < numParts; ++i) {
+            playlist.append(AStringPrintf(
+                    "#EXT-X-PART:DURATION=1.0,URI=\"seg%d.%zu.ts\"%s\n",
+                    seq, i, i == 2 ? ",INDEPENDENT=YES" : ""));
+        }
+        if (seq < 14) {
+            playlist.append(AStringPrintf("#EXTINF:4.0,\nseg%d.ts\n", seq));
+        }
+    }
+    playlist.append("#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg14.1.ts\"\n");
+
+    sp<M3UParser> parser = parse(playlist, previous);
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+
+    int32_t firstSeq, lastSeq;
+    parser->getSeqNumberRange(&firstSeq, &lastSeq);
+    EXPECT_EQ(11, firstSeq);
+    EXPECT_EQ(13, lastSeq);
+
+    EXPECT_EQ(0u, parser->getPartCount(11));
+    EXPECT_EQ(4u, parser->getPartCount(13));
+    EXPECT_EQ(1u, parser->getPartCount(14));
+
+    AString uri;
+    ASSERT_TRUE(parser->partAt(13, 3, &uri));
+    EXPECT_EQ(AString("http://example.com/live/seg13.3.ts"), uri);
+    ASSERT_TRUE(parser->partAt(14, 0, &uri));
+    EXPECT_EQ(AString("http://example.com/live/seg14.0.ts"), uri);
+
+    int32_t seq;
+    size_t index;
+    ASSERT_TRUE(parser->getPreloadHint(&seq, &index, &uri));
+    EXPECT_EQ(14, seq);
+    EXPECT_EQ(1u, index);
+
+    int32_t partIndex;
+    EXPECT_EQ(13, parser->getPartHoldBackStart(&partIndex));
+    EXPECT_EQ(2, partIndex);
+}
+
+TEST_F(M3UParserTest, TestRefreshLargePlaylist) {
+    const int32_t kNumSegments = 10000;
+    const int32_t kNumNew = 3;
+
+    AString text = makePlaylist(0, kNumSegments);
+    AString refreshed = makePlaylist(kNumNew, kNumSegments);
+
+    nsecs_t startNs = systemTime();
+    sp<M3UParser> previous = parse(text);
+    nsecs_t fullNs = systemTime() - startNs;
+    ASSERT_EQ((status_t)OK, previous->initCheck());
+
+    startNs = systemTime();
+    sp<M3UParser> parser = parse(refreshed, previous);
+    nsecs_t refreshNs = systemTime() - startNs;
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    ASSERT_EQ((size_t)kNumSegments, parser->size());
+
+    ALOGI("parsed %d segments in %lld us, refreshed in %lld us",
+            kNumSegments, (long long)(fullNs / 1000),
+            (long long)(refreshNs / 1000));
+
+    expectSegment(parser, kNumNew);
+    expectSegment(parser, kNumSegments - 1);
+    expectSegment(parser, kNumSegments + kNumNew - 1);
+    EXPECT_TRUE(metaAt(parser, kNumSegments - 1) == metaAt(previous, kNumSegments - 1));
+}
+
+} // namespace android
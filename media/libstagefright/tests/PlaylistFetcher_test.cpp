@@ -0,0 +1,843 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PlaylistFetcher_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <binder/IInterface.h>
+#include <media/IMediaHTTPConnection.h>
+#include <media/IMediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include "httplive/LiveSession.h"
+#include "httplive/PlaylistFetcher.h"
+#include "mpeg2ts/AnotherPacketSource.h"
+
+namespace android {
+
+static const int64_t kWaitUs = 10000000ll;
+
+static const size_t kTSPacketSize = 188;
+static const unsigned kPMTPID = 0x100;
+static const unsigned kAudioPID = 0x101;
+
+// Parts of 12 AAC frames at 48 kHz, 0.256 seconds, and 4 parts to a
+// segment. PART-HOLD-BACK is between 2 and 3 parts.
+static const size_t kFramesPerPart = 12;
+static const size_t kAudioFrameSize = 64;
+static const int64_t kFramePTS = 1024 * 90000ll / 48000;
+static const int64_t kPartDurationUs = kFramesPerPart * 1024 * 1000000ll / 48000;
+static const int32_t kPartsPerSegment = 4;
+static const char *kPartHoldBack = "0.7";
+
+// The playlist starts out with 3 complete segments and 2 parts of the next,
+// and keeps the last 4 complete segments.
+static const int32_t kInitialParts = 3 * kPartsPerSegment + 2;
+static const int32_t kWindowSegments = 4;
+
+// A live low-latency HLS server on a loopback port. From the first playlist
+// request on it adds a part every kPartDurationUs. Each part is a transport
+// stream of its own, a segment is its parts back to back. A playlist request
+// asking for a part that isn't there yet (_HLS_msn/_HLS_part) is held until
+// it is, as by a server that advertises CAN-BLOCK-RELOAD.
+struct LowLatencyServer {
+    struct Request {
+        AString mPath;
+        int32_t mMSN;   // -1 unless a blocking playlist reload
+        int32_t mPart;
+        bool mHeld;
+        bool mMedia;
+    };
+
+    // Unless |independentParts|, only the first part of each segment is
+    // marked INDEPENDENT.
+    LowLatencyServer(bool independentParts)
+        : mIndependentParts(independentParts),
+          mListener(-1),
+          mPort(0),
+          mStopping(false),
+          mNumMediaRequests(0),
+          mClockStartUs(-1ll),
+          mPATCC(0),
+          mPMTCC(0),
+          mAudioCC(0) {
+        while (mParts.size() < (size_t)kInitialParts) {
+            writePart();
+        }
+    }
+
+    ~LowLatencyServer() {
+        stop();
+    }
+
+    bool start() {
+        mListener = socket(AF_INET, SOCK_STREAM, 0);
+        if (mListener < 0) {
+            return false;
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t addrLen = sizeof(addr);
+        if (bind(mListener, (const struct sockaddr *)&addr, sizeof(addr)) < 0
+                || listen(mListener, 4) < 0
+                || getsockname(mListener, (struct sockaddr *)&addr, &addrLen) < 0) {
+            return false;
+        }
+        mPort = ntohs(addr.sin_port);
+
+        return pthread_create(&mThread, NULL, ThreadWrapper, this) == 0;
+    }
+
+    void stop() {
+        if (mListener < 0) {
+            return;
+        }
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            mStopping = true;
+        }
+        void *dummy;
+        pthread_join(mThread, &dummy);
+
+        // Lets a fetcher waiting on a held request go on to stop.
+        for (size_t i = 0; i < mHeld.size(); ++i) {
+            sendPlaylist(mHeld[i].mSocket);
+        }
+        mHeld.clear();
+
+        close(mListener);
+        mListener = -1;
+    }
+
+    AString getPlaylistURL() const {
+        return AStringPrintf("http://127.0.0.1:%u/live.m3u8", mPort);
+    }
+
+    // Waits for |count| media requests and returns the requests made up to
+    // the last of them.
+    bool waitForMediaRequests(size_t count, Vector<Request> *requests) {
+        Mutex::Autolock autoLock(mLock);
+        while (mNumMediaRequests < count) {
+            if (mCondition.waitRelative(mLock, kWaitUs * 1000ll) != OK) {
+                return false;
+            }
+        }
+
+        requests->clear();
+        for (size_t i = 0, numMedia = 0; numMedia < count; ++i) {
+            requests->push(mRequests[i]);
+            numMedia += mRequests[i].mMedia;
+        }
+        return true;
+    }
+
+private:
+    struct HeldRequest {
+        int mSocket;
+        int32_t mPart;  // index of the part waited for
+    };
+
+    const bool mIndependentParts;
+    int mListener;
+    unsigned mPort;
+    pthread_t mThread;
+
+    Mutex mLock;
+    Condition mCondition;
+    bool mStopping;
+    Vector<Request> mRequests;
+    size_t mNumMediaRequests;
+
+    // Only touched by the server thread.
+    int64_t mClockStartUs;
+    Vector<sp<ABuffer> > mParts;
+    Vector<HeldRequest> mHeld;
+    unsigned mPATCC;
+    unsigned mPMTCC;
+    unsigned mAudioCC;
+
+    static void *ThreadWrapper(void *me) {
+        static_cast<LowLatencyServer *>(me)->threadLoop();
+        return NULL;
+    }
+
+    void threadLoop() {
+        for (;;) {
+            {
+                Mutex::Autolock autoLock(mLock);
+                if (mStopping) {
+                    break;
+                }
+            }
+
+            publishParts();
+
+            int timeoutMs = 20;
+            if (mClockStartUs >= 0ll) {
+                int64_t nextUs = mClockStartUs
+                        + (mParts.size() - kInitialParts + 1) * kPartDurationUs;
+                int64_t delayMs = (nextUs - ALooper::GetNowUs() + 999ll) / 1000ll;
+                if (delayMs < timeoutMs) {
+                    timeoutMs = delayMs < 0 ? 0 : delayMs;
+                }
+            }
+
+            struct pollfd pfd;
+            pfd.fd = mListener;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, timeoutMs) <= 0) {
+                continue;
+            }
+
+            int s = accept(mListener, NULL, NULL);
+            if (s >= 0) {
+                onConnection(s);
+            }
+        }
+    }
+
+    // Adds the parts that are due and answers the playlist requests that
+    // were waiting for them.
+    void publishParts() {
+        if (mClockStartUs < 0ll) {
+            return;
+        }
+
+        size_t numParts = kInitialParts
+                + (ALooper::GetNowUs() - mClockStartUs) / kPartDurationUs;
+        while (mParts.size() < numParts) {
+            writePart();
+        }
+
+        for (size_t i = mHeld.size(); i > 0;) {
+            --i;
+            if ((size_t)mHeld[i].mPart < mParts.size()) {
+                sendPlaylist(mHeld[i].mSocket);
+                mHeld.removeAt(i);
+            }
+        }
+    }
+
+    void onConnection(int s) {
+        AString header;
+        char buffer[1024];
+        while (header.find("\r\n\r\n") < 0) {
+            ssize_t n = recv(s, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                close(s);
+                return;
+            }
+            header.append(buffer, n);
+        }
+
+        // "GET <path> HTTP/1.1"
+        ssize_t pathEnd = header.find(" ", 4);
+        if (!header.startsWith("GET ") || pathEnd < 0) {
+            sendResponse(s, 400, NULL, NULL, 0);
+            return;
+        }
+        AString path(header, 4, pathEnd - 4);
+
+        Request request;
+        request.mMSN = -1;
+        request.mPart = -1;
+        request.mHeld = false;
+        request.mMedia = false;
+
+        AString query;
+        ssize_t queryStart = path.find("?");
+        if (queryStart >= 0) {
+            query.setTo(path, queryStart + 1, path.size() - queryStart - 1);
+            path.erase(queryStart, path.size() - queryStart);
+        }
+        request.mPath = path;
+
+        int32_t seqNumber, partIndex;
+        if (path == "/live.m3u8") {
+            if (mClockStartUs < 0ll) {
+                mClockStartUs = ALooper::GetNowUs();
+            }
+
+            const char *msn = strstr(query.c_str(), "_HLS_msn=");
+            if (msn != NULL) {
+                request.mMSN = atoi(msn + 9);
+                const char *part = strstr(query.c_str(), "_HLS_part=");
+                request.mPart = (part != NULL) ? atoi(part + 10) : -1;
+            }
+
+            // Without _HLS_part the whole segment is waited for.
+            int32_t waitFor = -1;
+            if (request.mMSN >= 0) {
+                waitFor = (request.mPart >= 0)
+                        ? request.mMSN * kPartsPerSegment + request.mPart
+                        : (request.mMSN + 1) * kPartsPerSegment - 1;
+            }
+            if (waitFor >= (int32_t)mParts.size()) {
+                HeldRequest held;
+                held.mSocket = s;
+                held.mPart = waitFor;
+                mHeld.push(held);
+                request.mHeld = true;
+            } else {
+                sendPlaylist(s);
+            }
+        } else if (sscanf(path.c_str(), "/seg%d.%d.ts", &seqNumber, &partIndex) == 2) {
+            request.mMedia = true;
+            int32_t index = seqNumber * kPartsPerSegment + partIndex;
+            if (index >= 0 && partIndex < kPartsPerSegment
+                    && (size_t)index < mParts.size()) {
+                const sp<ABuffer> &part = mParts[index];
+                sendResponse(s, 200, "video/mp2t", part->data(), part->size());
+            } else {
+                sendResponse(s, 404, NULL, NULL, 0);
+            }
+        } else if (sscanf(path.c_str(), "/seg%d.ts", &seqNumber) == 1) {
+            request.mMedia = true;
+            if (seqNumber >= 0 && (size_t)((seqNumber + 1) * kPartsPerSegment)
+                    <= mParts.size()) {
+                Vector<uint8_t> segment;
+                for (int32_t i = 0; i < kPartsPerSegment; ++i) {
+                    const sp<ABuffer> &part =
+                        mParts[seqNumber * kPartsPerSegment + i];
+                    segment.appendArray(part->data(), part->size());
+                }
+                sendResponse(s, 200, "video/mp2t", segment.array(), segment.size());
+            } else {
+                sendResponse(s, 404, NULL, NULL, 0);
+            }
+        } else {
+            sendResponse(s, 404, NULL, NULL, 0);
+        }
+
+        ALOGV("GET %s%s%s%s", path.c_str(), query.empty() ? "" : "?",
+                query.c_str(), request.mHeld ? " (held)" : "");
+
+        Mutex::Autolock autoLock(mLock);
+        mRequests.push(request);
+        if (request.mMedia) {
+            ++mNumMediaRequests;
+            mCondition.broadcast();
+        }
+    }
+
+    void sendPlaylist(int s) {
+        int32_t numParts = mParts.size();
+        int32_t numSegments = numParts / kPartsPerSegment;
+        int32_t firstSeqNumber = numSegments - kWindowSegments;
+        if (firstSeqNumber < 0) {
+            firstSeqNumber = 0;
+        }
+
+        AString playlist("#EXTM3U\n#EXT-X-VERSION:6\n#EXT-X-TARGETDURATION:1\n");
+        playlist.append(AStringPrintf(
+                "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%s\n",
+                kPartHoldBack));
+        playlist.append(AStringPrintf(
+                "#EXT-X-PART-INF:PART-TARGET=%.3f\n", kPartDurationUs / 1E6));
+        playlist.append(AStringPrintf("#EXT-X-MEDIA-SEQUENCE:%d\n", firstSeqNumber));
+
+        // Parts are listed for the last complete segment and the one in
+        // progress.
+        for (int32_t seqNumber = firstSeqNumber; seqNumber <= numSegments; ++seqNumber) {
+            if (seqNumber >= numSegments - 1) {
+                for (int32_t i = 0; i < kPartsPerSegment
+                        && seqNumber * kPartsPerSegment + i < numParts; ++i) {
+                    playlist.append(AStringPrintf(
+                            "#EXT-X-PART:DURATION=%.3f,URI=\"seg%d.%d.ts\"%s\n",
+                            kPartDurationUs / 1E6, seqNumber, i,
+                            (mIndependentParts || i == 0) ? ",INDEPENDENT=YES" : ""));
+                }
+            }
+            if (seqNumber < numSegments) {
+                playlist.append(AStringPrintf(
+                        "#EXTINF:%.3f,\nseg%d.ts\n",
+                        kPartsPerSegment * kPartDurationUs / 1E6, seqNumber));
+            }
+        }
+
+        sendResponse(s, 200, "application/vnd.apple.mpegurl",
+                playlist.c_str(), playlist.size());
+    }
+
+    static void sendResponse(
+            int s, int status, const char *mimeType, const void *data, size_t size) {
+        AString response = AStringPrintf("HTTP/1.1 %d %s\r\n", status,
+                status == 200 ? "OK" : status == 404 ? "Not Found" : "Bad Request");
+        if (mimeType != NULL) {
+            response.append(AStringPrintf("Content-Type: %s\r\n", mimeType));
+        }
+        response.append(AStringPrintf(
+                "Content-Length: %zu\r\nConnection: close\r\n\r\n", size));
+        response.append((const char *)data, size);
+
+        size_t offset = 0;
+        while (offset < response.size()) {
+            ssize_t n = send(s, response.c_str() + offset,
+                    response.size() - offset, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            offset += n;
+        }
+        close(s);
+    }
+
+    // Appends the next part: PAT, PMT and a PES packet for each of its ADTS
+    // frames, with continuity counters and PTS carried on from the last part.
+    void writePart() {
+        sp<ABuffer> part = new ABuffer(
+                (2 + kFramesPerPart) * kTSPacketSize);
+        part->setRange(0, 0);
+
+        static const uint8_t kPAT[] = {
+            0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+            0x00, 0x01, 0xe0 | (kPMTPID >> 8), kPMTPID & 0xff,
+        };
+        writeSection(part, 0 /* pid */, kPAT, sizeof(kPAT), &mPATCC);
+
+        static const uint8_t kPMT[] = {
+            0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+            0xe0 | (kAudioPID >> 8), kAudioPID & 0xff, 0xf0, 0x00,
+            0x0f, 0xe0 | (kAudioPID >> 8), kAudioPID & 0xff, 0xf0, 0x00,
+        };
+        writeSection(part, kPMTPID, kPMT, sizeof(kPMT), &mPMTCC);
+
+        for (size_t i = 0; i < kFramesPerPart; ++i) {
+            int64_t frame = mParts.size() * kFramesPerPart + i;
+            writeAudioFrame(part, 90000ll + frame * kFramePTS, frame);
+        }
+
+        mParts.push(part);
+    }
+
+    static uint32_t crc32(const uint8_t *data, size_t size) {
+        uint32_t crc = 0xffffffff;
+        for (size_t i = 0; i < size; ++i) {
+            crc ^= (uint32_t)data[i] << 24;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    static void writeSection(
+            const sp<ABuffer> &out, unsigned pid, const uint8_t *section,
+            size_t size, unsigned *cc) {
+        uint8_t *packet = out->data() + out->size();
+        memset(packet, 0xff, kTSPacketSize);
+        packet[0] = 0x47;
+        packet[1] = 0x40 | (pid >> 8);
+        packet[2] = pid & 0xff;
+        packet[3] = 0x10 | *cc;
+        packet[4] = 0x00;  // pointer_field
+        memcpy(&packet[5], section, size);
+        uint32_t crc = crc32(section, size);
+        packet[5 + size] = crc >> 24;
+        packet[6 + size] = (crc >> 16) & 0xff;
+        packet[7 + size] = (crc >> 8) & 0xff;
+        packet[8 + size] = crc & 0xff;
+        *cc = (*cc + 1) & 0x0f;
+        out->setRange(0, out->size() + kTSPacketSize);
+    }
+
+    // A PES packet with a single ADTS frame fits a transport packet, the
+    // rest of which is stuffing in the adaptation field.
+    void writeAudioFrame(const sp<ABuffer> &out, int64_t pts, int64_t frame) {
+        size_t length = 7 + kAudioFrameSize;
+        uint8_t pes[14 + 7 + kAudioFrameSize] = {
+            0x00, 0x00, 0x01, 0xc0,
+            0x00, (uint8_t)(8 + length),
+            0x80, 0x80, 0x05,
+            (uint8_t)(0x21 | ((pts >> 29) & 0x0e)),
+            (uint8_t)(pts >> 22),
+            (uint8_t)(0x01 | ((pts >> 14) & 0xfe)),
+            (uint8_t)(pts >> 7),
+            (uint8_t)(0x01 | ((pts << 1) & 0xfe)),
+            0xff, 0xf1,
+            0x4c,  // AAC LC, 48 kHz
+            (uint8_t)(0x80 | (length >> 11)),  // stereo
+            (uint8_t)(length >> 3),
+            (uint8_t)(((length & 7) << 5) | 0x1f),
+            0xfc,
+        };
+        for (size_t i = 0; i < kAudioFrameSize; ++i) {
+            pes[21 + i] = (uint8_t)(frame * 7 + i);
+        }
+
+        uint8_t *packet = out->data() + out->size();
+        size_t fieldSize = kTSPacketSize - 4 - sizeof(pes);
+        packet[0] = 0x47;
+        packet[1] = 0x40 | (kAudioPID >> 8);
+        packet[2] = kAudioPID & 0xff;
+        packet[3] = 0x30 | mAudioCC;
+        packet[4] = fieldSize - 1;
+        packet[5] = 0x00;
+        memset(&packet[6], 0xff, fieldSize - 2);
+        memcpy(&packet[4 + fieldSize], pes, sizeof(pes));
+        mAudioCC = (mAudioCC + 1) & 0x0f;
+        out->setRange(0, out->size() + kTSPacketSize);
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(LowLatencyServer);
+};
+
+// Makes the whole request at connect() and serves the response body from
+// memory, which is all HTTPDownloader needs of a connection.
+struct LoopbackHTTPConnection : public BnInterface<IMediaHTTPConnection> {
+    LoopbackHTTPConnection()
+        : mConnected(false),
+          mBodyOffset(0) {
+    }
+
+    virtual bool connect(
+            const char *uri, const KeyedVector<String8, String8> *headers) {
+        disconnect();
+
+        static const char kPrefix[] = "http://127.0.0.1:";
+        if (strncmp(uri, kPrefix, sizeof(kPrefix) - 1)) {
+            return false;
+        }
+        char *path;
+        unsigned port = strtoul(uri + sizeof(kPrefix) - 1, &path, 10);
+        if (*path != '/') {
+            return false;
+        }
+
+        AString request = AStringPrintf(
+                "GET %s HTTP/1.1\r\nHost: 127.0.0.1:%u\r\n", path, port);
+        for (size_t i = 0; headers != NULL && i < headers->size(); ++i) {
+            request.append(AStringPrintf("%s: %s\r\n",
+                    headers->keyAt(i).string(), headers->valueAt(i).string()));
+        }
+        request.append("Connection: close\r\n\r\n");
+
+        int s = socket(AF_INET, SOCK_STREAM, 0);
+        if (s < 0) {
+            return false;
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (::connect(s, (const struct sockaddr *)&addr, sizeof(addr)) < 0
+                || send(s, request.c_str(), request.size(), MSG_NOSIGNAL)
+                        != (ssize_t)request.size()) {
+            close(s);
+            return false;
+        }
+
+        // Blocks for as long as the server holds on to the request.
+        char buffer[4096];
+        ssize_t n;
+        while ((n = recv(s, buffer, sizeof(buffer), 0)) > 0) {
+            mResponse.append(buffer, n);
+        }
+        close(s);
+
+        ssize_t headerEnd = mResponse.find("\r\n\r\n");
+        if (n < 0 || headerEnd < 0
+                || !mResponse.startsWith("HTTP/1.1 200 ")) {
+            mResponse.clear();
+            return false;
+        }
+        mBodyOffset = headerEnd + 4;
+
+        ssize_t typeStart = mResponse.find("Content-Type: ");
+        if (typeStart >= 0 && typeStart < headerEnd) {
+            typeStart += 14;
+            mMIMEType.setTo(mResponse.c_str() + typeStart,
+                    mResponse.find("\r\n", typeStart) - typeStart);
+        }
+
+        mURI.setTo(uri);
+        mConnected = true;
+        return true;
+    }
+
+    virtual void disconnect() {
+        mConnected = false;
+        mResponse.clear();
+        mBodyOffset = 0;
+        mMIMEType.clear();
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (!mConnected) {
+            return ERROR_NOT_CONNECTED;
+        }
+
+        size_t bodySize = mResponse.size() - mBodyOffset;
+        if (offset < 0 || (size_t)offset >= bodySize) {
+            return 0;
+        }
+        if (size > bodySize - offset) {
+            size = bodySize - offset;
+        }
+        memcpy(data, mResponse.c_str() + mBodyOffset + offset, size);
+        return size;
+    }
+
+    virtual off64_t getSize() {
+        return mConnected ? (off64_t)(mResponse.size() - mBodyOffset) : -1;
+    }
+
+    virtual status_t getMIMEType(String8 *mimeType) {
+        *mimeType = mMIMEType;
+        return mConnected ? OK : (status_t)ERROR_NOT_CONNECTED;
+    }
+
+    virtual status_t getUri(String8 *uri) {
+        *uri = mURI;
+        return mConnected ? OK : (status_t)ERROR_NOT_CONNECTED;
+    }
+
+private:
+    bool mConnected;
+    AString mResponse;
+    size_t mBodyOffset;
+    String8 mMIMEType;
+    String8 mURI;
+
+    DISALLOW_EVIL_CONSTRUCTORS(LoopbackHTTPConnection);
+};
+
+struct LoopbackHTTPService : public BnInterface<IMediaHTTPService> {
+    virtual sp<IMediaHTTPConnection> makeHTTPConnection() {
+        return new LoopbackHTTPConnection;
+    }
+};
+
+// Counts the errors a fetcher reports.
+struct FetcherListener : public AHandler {
+    FetcherListener()
+        : mNumErrors(0) {
+    }
+
+    size_t numErrors() {
+        Mutex::Autolock autoLock(mLock);
+        return mNumErrors;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        int32_t what;
+        CHECK(msg->findInt32("what", &what));
+
+        if (what == PlaylistFetcher::kWhatError) {
+            int32_t err;
+            CHECK(msg->findInt32("err", &err));
+            ALOGE("fetcher error %d", err);
+
+            Mutex::Autolock autoLock(mLock);
+            ++mNumErrors;
+        }
+    }
+
+private:
+    Mutex mLock;
+    size_t mNumErrors;
+};
+
+class PlaylistFetcherTest : public ::testing::Test {
+protected:
+    enum {
+        kWhatFetcherNotify,
+    };
+
+    PlaylistFetcherTest()
+        : mServer(NULL) {
+    }
+
+    virtual void SetUp() {
+        mListener = new FetcherListener;
+        mListenerLooper = new ALooper;
+        mListenerLooper->setName("fetcher listener");
+        mListenerLooper->registerHandler(mListener);
+        ASSERT_EQ(OK, mListenerLooper->start());
+
+        mFetcherLooper = new ALooper;
+        mFetcherLooper->setName("fetcher");
+        ASSERT_EQ(OK, mFetcherLooper->start());
+
+        mAudioSource = new AnotherPacketSource(NULL /* meta */);
+    }
+
+    virtual void TearDown() {
+        if (mFetcher != NULL) {
+            mFetcher->stopAsync();
+        }
+        delete mServer;
+        mServer = NULL;
+        mFetcherLooper->stop();
+        mListenerLooper->stop();
+    }
+
+    // Starts the server and a fetcher on its playlist, as LiveSession does
+    // for a live stream.
+    void start(bool independentParts) {
+        mServer = new LowLatencyServer(independentParts);
+        ASSERT_TRUE(mServer->start());
+
+        sp<LiveSession> session = new LiveSession(
+                new AMessage, 0 /* flags */, new LoopbackHTTPService);
+        mFetcher = new PlaylistFetcher(
+                new AMessage(kWhatFetcherNotify, mListener), session,
+                mServer->getPlaylistURL().c_str(), 0 /* id */,
+                0 /* subtitleGeneration */);
+        mFetcherLooper->registerHandler(mFetcher);
+        mFetcher->startAsync(
+                mAudioSource, NULL /* videoSource */, NULL /* subtitleSource */,
+                NULL /* metadataSource */, 0ll /* startTimeUs */);
+    }
+
+    // Expects the media requests to be parts |seqNumber|.|partIndex| on,
+    // each playlist request after the first to be a blocking reload for the
+    // part requested next, held by the server.
+    void checkRequests(
+            const Vector<LowLatencyServer::Request> &requests,
+            int32_t seqNumber, int32_t partIndex) {
+        ASSERT_LT(0u, requests.size());
+        EXPECT_EQ(AString("/live.m3u8"), requests[0].mPath);
+        EXPECT_EQ(-1, requests[0].mMSN);
+
+        int32_t reloadMSN = -1, reloadPart = -1;
+        for (size_t i = 1; i < requests.size(); ++i) {
+            const LowLatencyServer::Request &request = requests[i];
+            if (!request.mMedia) {
+                EXPECT_EQ(AString("/live.m3u8"), request.mPath);
+                EXPECT_EQ(seqNumber, request.mMSN) << "request " << i;
+                EXPECT_EQ(partIndex, request.mPart) << "request " << i;
+                EXPECT_TRUE(request.mHeld) << "request " << i;
+                reloadMSN = request.mMSN;
+                reloadPart = request.mPart;
+                continue;
+            }
+
+            EXPECT_EQ(AStringPrintf("/seg%d.%d.ts", seqNumber, partIndex),
+                    request.mPath) << "request " << i;
+            if (reloadMSN >= 0) {
+                EXPECT_EQ(seqNumber, reloadMSN);
+                EXPECT_EQ(partIndex, reloadPart);
+            }
+            reloadMSN = reloadPart = -1;
+
+            if (++partIndex == kPartsPerSegment) {
+                ++seqNumber;
+                partIndex = 0;
+            }
+        }
+    }
+
+    // Expects at least |count| consecutive access units.
+    void checkAccessUnits(size_t count) {
+        size_t numAccessUnits = 0;
+        int64_t lastTimeUs = -1ll;
+        sp<ABuffer> accessUnit;
+        status_t finalResult;
+        while (mAudioSource->hasBufferAvailable(&finalResult)) {
+            ASSERT_EQ(OK, mAudioSource->dequeueAccessUnit(&accessUnit));
+
+            int64_t timeUs;
+            ASSERT_TRUE(accessUnit->meta()->findInt64("timeUs", &timeUs));
+            if (lastTimeUs >= 0ll) {
+                EXPECT_NEAR(lastTimeUs + kFramePTS * 100 / 9, timeUs, 1)
+                        << "access unit " << numAccessUnits;
+            }
+            // ADTS header and frame.
+            EXPECT_EQ(7 + kAudioFrameSize, accessUnit->size());
+            lastTimeUs = timeUs;
+            ++numAccessUnits;
+        }
+        EXPECT_LE(count, numAccessUnits);
+    }
+
+    sp<FetcherListener> mListener;
+    sp<ALooper> mListenerLooper;
+    sp<ALooper> mFetcherLooper;
+    sp<AnotherPacketSource> mAudioSource;
+    sp<PlaylistFetcher> mFetcher;
+    LowLatencyServer *mServer;
+};
+
+// Independent parts let playback start PART-HOLD-BACK from the live edge,
+// 3 parts back: the last part of segment 2. The fetcher then keeps up with
+// the edge a part at a time, asking for each part it doesn't have yet with
+// a blocking playlist reload.
+TEST_F(PlaylistFetcherTest, TestPartsFromLiveEdge) {
+    // Ends on the first part of segment 5, so segments complete in between.
+    static const size_t kNumParts = 10;
+    ASSERT_NO_FATAL_FAILURE(start(true /* independentParts */));
+
+    Vector<LowLatencyServer::Request> requests;
+    ASSERT_TRUE(mServer->waitForMediaRequests(kNumParts, &requests));
+    EXPECT_EQ(0u, mListener->numErrors());
+
+    checkRequests(requests, 2 /* seqNumber */, 3 /* partIndex */);
+    // All but the last PES of the parts before the last one are extracted.
+    checkAccessUnits((kNumParts - 1) * kFramesPerPart - 1);
+}
+
+// With only the first part of each segment independent, the start walks
+// back to the start of segment 2, which is complete and fetched whole. The
+// segment in progress is fetched in parts from then on.
+TEST_F(PlaylistFetcherTest, TestSegmentThenPartsFromLiveEdge) {
+    static const size_t kNumParts = 6;
+    ASSERT_NO_FATAL_FAILURE(start(false /* independentParts */));
+
+    Vector<LowLatencyServer::Request> requests;
+    ASSERT_TRUE(mServer->waitForMediaRequests(1 + kNumParts, &requests));
+    EXPECT_EQ(0u, mListener->numErrors());
+
+    ASSERT_LT(1u, requests.size());
+    EXPECT_EQ(AString("/seg2.ts"), requests[1].mPath);
+    EXPECT_TRUE(requests[1].mMedia);
+    requests.removeAt(1);
+    checkRequests(requests, 3 /* seqNumber */, 0 /* partIndex */);
+    checkAccessUnits((kPartsPerSegment + kNumParts - 1) * kFramesPerPart - 1);
+}
+
+}  // namespace android
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcher_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <binder/IInterface.h>
+#include <media/IMediaHTTPConnection.h>
+#include <media/IMediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/List.h>
+#include <utils/Mutex.h>
+#include <utils/String8.h>
+
+#include "httplive/HTTPDownloader.h"
+#include "include/HTTPBase.h"
+#include "httplive/SegmentPrefetcher.h"
+
+namespace android {
+
+static const int64_t kWaitUs = 2000000ll;
+
+// HTTPDownloader wants a connection factory, the fake below never uses it.
+struct NullHTTPService : public BnInterface<IMediaHTTPService> {
+    virtual sp<IMediaHTTPConnection> makeHTTPConnection() { return NULL; }
+};
+
+// Serves each URI as its own name, once the test has released it.
+struct FakeDownloader : public HTTPDownloader {
+    FakeDownloader()
+        : HTTPDownloader(new NullHTTPService, KeyedVector<String8, String8>()) {
+    }
+
+    void release(const char *uri) {
+        Mutex::Autolock autoLock(mLock);
+        mReleased.push_back(AString(uri));
+        mCondition.broadcast();
+    }
+
+    // Waits for |numFetches| downloads to have started.
+    bool waitForFetches(size_t numFetches) {
+        Mutex::Autolock autoLock(mLock);
+        while (mNumFetches < numFetches) {
+            if (mCondition.waitRelative(mLock, kWaitUs * 1000ll) != OK) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t numFetches() {
+        Mutex::Autolock autoLock(mLock);
+        return mNumFetches;
+    }
+
+    virtual ssize_t fetchBlock(
+            const char *url, sp<ABuffer> *out,
+            int64_t /* range_offset */, int64_t /* range_length */,
+            uint32_t /* block_size */, String8 * /* actualUrl */,
+            bool /* reconnect */) {
+        Mutex::Autolock autoLock(mLock);
+        ++mNumFetches;
+        mCondition.broadcast();
+
+        while (!isReleased(url)) {
+            mCondition.wait(mLock);
+        }
+
+        size_t size = strlen(url);
+        *out = new ABuffer(size);
+        memcpy((*out)->data(), url, size);
+        return size;
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    List<AString> mReleased;
+    size_t mNumFetches = 0;
+
+    bool isReleased(const char *uri) const {
+        for (List<AString>::const_iterator it = mReleased.begin();
+                it != mReleased.end(); ++it) {
+            if (*it == uri) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Collects the prefetcher's replies.
+struct ReplyHandler : public AHandler {
+    sp<AMessage> waitForReply(int64_t timeoutUs = kWaitUs) {
+        Mutex::Autolock autoLock(mLock);
+        while (mReplies.empty()) {
+            if (mCondition.waitRelative(mLock, timeoutUs * 1000ll) != OK) {
+                return NULL;
+            }
+        }
+        sp<AMessage> reply = *mReplies.begin();
+        mReplies.erase(mReplies.begin());
+        return reply;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        Mutex::Autolock autoLock(mLock);
+        mReplies.push_back(msg);
+        mCondition.broadcast();
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    List<sp<AMessage> > mReplies;
+};
+
+class SegmentPrefetcherTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mDownloader = new FakeDownloader;
+        mPrefetcher = new SegmentPrefetcher(mDownloader, 2 /* depth */);
+        mPrefetcher->start();
+
+        mLooper = new ALooper;
+        mLooper->start();
+        mHandler = new ReplyHandler;
+        mLooper->registerHandler(mHandler);
+    }
+
+    virtual void TearDown() {
+        // Let a download that is still blocked finish.
+        mDownloader->release("a");
+        mDownloader->release("b");
+        mDownloader->release("c");
+        mPrefetcher->stop();
+        mLooper->stop();
+    }
+
+    void prefetch(const char *uri) {
+        mPrefetcher->prefetch(AString(uri), 0, -1);
+    }
+
+    bool take(const char *uri) {
+        return mPrefetcher->takeSegment(
+                AString(uri), 0, -1, new AMessage('repl', mHandler));
+    }
+
+    void expectSegment(const sp<AMessage> &reply, const char *uri, bool exclusive) {
+        ASSERT_TRUE(reply != NULL);
+
+        sp<ABuffer> buffer;
+        ASSERT_TRUE(reply->findBuffer("buffer", &buffer));
+        EXPECT_EQ(AString(uri), AString((const char *)buffer->data(), buffer->size()));
+
+        int64_t fetchTimeUs;
+        EXPECT_TRUE(reply->findInt64("fetchTimeUs", &fetchTimeUs));
+        EXPECT_GE(fetchTimeUs, 0ll);
+
+        int32_t value;
+        ASSERT_TRUE(reply->findInt32("exclusive", &value));
+        EXPECT_EQ(exclusive, value != 0);
+    }
+
+    sp<FakeDownloader> mDownloader;
+    sp<SegmentPrefetcher> mPrefetcher;
+    sp<ALooper> mLooper;
+    sp<ReplyHandler> mHandler;
+};
+
+TEST_F(SegmentPrefetcherTest, Hit) {
+    prefetch("a");
+    prefetch("b");
+    ASSERT_TRUE(mDownloader->waitForFetches(1));
+
+    // Taken while still downloading, the reply waits for the download.
+    ASSERT_TRUE(take("a"));
+    EXPECT_TRUE(mHandler->waitForReply(100000ll) == NULL);
+    mDownloader->release("a");
+    expectSegment(mHandler->waitForReply(), "a", true);
+
+    // Taken once downloaded, the reply is posted right away.
+    mDownloader->release("b");
+    prefetch("c");
+    ASSERT_TRUE(mDownloader->waitForFetches(3));
+    ASSERT_TRUE(take("b"));
+    expectSegment(mHandler->waitForReply(), "b", true);
+
+    EXPECT_EQ(3u, mDownloader->numFetches());
+}
+
+TEST_F(SegmentPrefetcherTest, Miss) {
+    prefetch("a");
+    prefetch("b");
+    ASSERT_TRUE(mDownloader->waitForFetches(1));
+
+    // "b" hasn't started downloading, the caller is better off fetching it.
+    EXPECT_FALSE(take("b"));
+
+    // Neither was "c" ever queued, which discards everything queued.
+    prefetch("b");
+    EXPECT_FALSE(take("c"));
+    EXPECT_FALSE(take("b"));
+
+    mDownloader->release("a");
+    EXPECT_TRUE(mHandler->waitForReply(100000ll) == NULL);
+    EXPECT_EQ(1u, mDownloader->numFetches());
+}
+
+TEST_F(SegmentPrefetcherTest, CancelOnSeek) {
+    prefetch("a");
+    ASSERT_TRUE(mDownloader->waitForFetches(1));
+    ASSERT_TRUE(take("a"));
+
+    // A seek flushes the prefetcher while the fetcher waits for "a".
+    mPrefetcher->flush();
+    mDownloader->release("a");
+    EXPECT_TRUE(mHandler->waitForReply(100000ll) == NULL);
+
+    // The download that was cut short doesn't satisfy a new request.
+    prefetch("a");
+    ASSERT_TRUE(mDownloader->waitForFetches(2));
+    ASSERT_TRUE(take("a"));
+    expectSegment(mHandler->waitForReply(), "a", true);
+    EXPECT_EQ(2u, mDownloader->numFetches());
+}
+
+TEST_F(SegmentPrefetcherTest, OverlappingDownloads) {
+    // The fetcher downloads over its own connection while "a" is
+    // prefetched, neither may feed the bandwidth estimate.
+    prefetch("a");
+    ASSERT_TRUE(mDownloader->waitForFetches(1));
+    mPrefetcher->beginDownload();
+    mDownloader->release("a");
+    ASSERT_TRUE(take("a"));
+    expectSegment(mHandler->waitForReply(), "a", false);
+    EXPECT_FALSE(mPrefetcher->endDownload());
+
+    // One after the other is fine.
+    mPrefetcher->beginDownload();
+    EXPECT_TRUE(mPrefetcher->endDownload());
+
+    mDownloader->release("b");
+    prefetch("b");
+    ASSERT_TRUE(mDownloader->waitForFetches(2));
+    ASSERT_TRUE(take("b"));
+    expectSegment(mHandler->waitForReply(), "b", true);
+}
+
+}  // namespace android
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "StartCodeUtils_test"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/ABitReader.h>
+#include <media/stagefright/foundation/StartCodeUtils.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class StartCodeUtilsTest : public ::testing::Test {
+};
+
+TEST_F(StartCodeUtilsTest, TestSimple) {
+    static const uint8_t kData[] = {
+        0x12, 0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x00, 0x01, 0x65,
+    };
+
+    ASSERT_EQ(findStartCode(kData, sizeof(kData)), 6u);
+    ASSERT_EQ(findEmulationPrevention(kData, sizeof(kData)), 1u);
+
+    // A start code must fit entirely within the range.
+    ASSERT_EQ(findStartCode(kData, 8), 8u);
+    ASSERT_EQ(findStartCode(kData, 0), 0u);
+    ASSERT_EQ(findStartCode(kData, 2), 2u);
+}
+
+TEST_F(StartCodeUtilsTest, TestMatchesScalar) {
+    static const size_t kMaxSize = 256;
+    uint8_t data[kMaxSize];
+
+    unsigned seed = 1;
+    for (size_t iter = 0; iter < 100000; ++iter) {
+        size_t size = rand_r(&seed) % kMaxSize;
+
+        // Keep the data mostly zeroes and small values so that start codes,
+        // emulation prevention bytes and near misses are all common.
+        for (size_t i = 0; i < size; ++i) {
+            int r = rand_r(&seed) % 8;
+            data[i] = r < 4 ? 0x00 : (r < 7 ? r - 3 : rand_r(&seed) & 0xff);
+        }
+
+        // Exercise every alignment relative to the vector width.
+        size_t offset = size > 0 ? rand_r(&seed) % (size < 32 ? size : 32) : 0;
+
+        ASSERT_EQ(findStartCodeScalar(data + offset, size - offset),
+                  findStartCode(data + offset, size - offset));
+        ASSERT_EQ(findEmulationPreventionScalar(data + offset, size - offset),
+                  findEmulationPrevention(data + offset, size - offset));
+    }
+}
+
+TEST_F(StartCodeUtilsTest, TestEveryPosition) {
+    static const size_t kSize = 67;
+    uint8_t data[kSize];
+
+    for (size_t pos = 0; pos + 3 <= kSize; ++pos) {
+        memset(data, 0xff, kSize);
+        data[pos] = 0x00;
+        data[pos + 1] = 0x00;
+        data[pos + 2] = 0x01;
+
+        ASSERT_EQ(findStartCode(data, kSize), pos);
+        ASSERT_EQ(findEmulationPrevention(data, kSize), kSize);
+
+        // Truncating the range by one byte hides the start code.
+        ASSERT_EQ(findStartCode(data, pos + 2), pos + 2);
+    }
+}
+
+// Returns the best of |numRuns| throughputs of |find| over |data|, in GB/s.
+static double measureThroughput(
+        size_t (*find)(const uint8_t *, size_t), const uint8_t *data, size_t size,
+        size_t numRuns) {
+    nsecs_t bestNs = 0;
+    for (size_t i = 0; i < numRuns; ++i) {
+        nsecs_t startNs = systemTime();
+        size_t offset = find(data, size);
+        nsecs_t elapsedNs = systemTime() - startNs;
+        EXPECT_EQ(size, offset);
+
+        if (i == 0 || elapsedNs < bestNs) {
+            bestNs = elapsedNs;
+        }
+    }
+    return bestNs > 0 ? (double)size / bestNs : 0.0;
+}
+
+TEST_F(StartCodeUtilsTest, TestThroughput) {
+    // Escaped slice data as found between start codes: mostly random bytes,
+    // with an emulation_prevention_three_byte wherever two zero bytes are
+    // followed by 0x00-0x03. Larger than the caches, so that the scans are
+    // measured at the speed the data comes from memory.
+    static const size_t kSize = 32 << 20;
+    uint8_t *data = new uint8_t[kSize];
+
+    unsigned seed = 1;
+    for (size_t i = 0; i < kSize; ++i) {
+        int r = rand_r(&seed);
+        data[i] = (r & 0x700) == 0 ? 0x00 : (r & 0xff);
+        if (i >= 2 && data[i - 2] == 0x00 && data[i - 1] == 0x00 && data[i] <= 0x03) {
+            data[i] = 0x03;
+        }
+    }
+
+    double scalarGBps = measureThroughput(findStartCodeScalar, data, kSize, 5);
+    double vectorGBps = measureThroughput(findStartCode, data, kSize, 5);
+
+    ALOGI("start code scan of %zu MiB: %.2f GB/s, %.2f GB/s byte by byte, %.1fx",
+          kSize >> 20, vectorGBps, scalarGBps,
+          scalarGBps > 0 ? vectorGBps / scalarGBps : 0.0);
+
+    delete[] data;
+}
+
+// Drops every emulation_prevention_three_byte from |data|.
+static size_t unescape(const uint8_t *data, size_t size, uint8_t *out) {
+    size_t outSize = 0;
+    size_t numZeros = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (numZeros >= 2 && data[i] == 0x03) {
+            numZeros = 0;
+            continue;
+        }
+        numZeros = (data[i] == 0x00) ? numZeros + 1 : 0;
+        out[outSize++] = data[i];
+    }
+    return outSize;
+}
+
+TEST_F(StartCodeUtilsTest, TestNALBitReader) {
+    static const size_t kMaxSize = 2048;
+    uint8_t data[kMaxSize];
+    uint8_t unescaped[kMaxSize];
+
+    unsigned seed = 1;
+    for (size_t iter = 0; iter < 5000; ++iter) {
+        size_t size = rand_r(&seed) % kMaxSize;
+
+        // Alternate between dense and sparse emulation prevention bytes, the
+        // latter so that the reader has to look ahead over long stretches.
+        bool sparse = (iter & 1) != 0;
+        for (size_t i = 0; i < size; ++i) {
+            int r = rand_r(&seed) % (sparse ? 512 : 8);
+            data[i] = r < 4 ? (sparse ? 0x03 : 0x00) : (r < 7 ? r - 3 : rand_r(&seed) & 0xff);
+            if (sparse && r < 4 && i >= 2) {
+                data[i - 2] = data[i - 1] = 0x00;
+            }
+        }
+
+        size_t unescapedSize = unescape(data, size, unescaped);
+
+        NALBitReader br(data, size);
+        ABitReader expected(unescaped, unescapedSize);
+        size_t numBitsRead = 0;
+        for (;;) {
+            size_t n = rand_r(&seed) % 33;
+            size_t numBitsLeft = 8 * unescapedSize - numBitsRead;
+            ASSERT_EQ(n <= numBitsLeft, br.atLeastNumBitsLeft(n));
+            if (n > numBitsLeft) {
+                break;
+            }
+
+            uint32_t x, y;
+            ASSERT_TRUE(br.getBitsGraceful(n, &x));
+            ASSERT_TRUE(expected.getBitsGraceful(n, &y));
+            ASSERT_EQ(y, x) << "at bit " << numBitsRead << " of " << size << " bytes";
+            numBitsRead += n;
+        }
+    }
+}
+
+} // namespace android
@@ -205,27 +205,32 @@ status_t RTPSender::queueBuffer(
     return err;
 }
 
-status_t RTPSender::queueRawPacket(
-        const sp<ABuffer> &packet, uint8_t packetType) {
-    CHECK_LE(packet->size(), kMaxUDPPacketSize - 12);
-
-    int64_t timeUs;
-    CHECK(packet->meta()->findInt64("timeUs", &timeUs));
-
-    sp<ABuffer> udpPacket = new ABuffer(12 + packet->size());
-
-    udpPacket->setInt32Data(mRTPSeqNo);
+// static
+RTPSender::Packet RTPSender::MakePacket(
+        size_t headerSize, const sp<ABuffer> &payload,
+        size_t payloadOffset, size_t payloadSize) {
+    Packet packet;
+    packet.mHeader = new ABuffer(headerSize);
+    packet.mPayload = payload;
+    packet.mPayloadOffset = payloadOffset;
+    packet.mPayloadSize = payloadSize;
+
+    return packet;
+}
 
-    uint8_t *rtp = udpPacket->data();
+void RTPSender::writeRTPHeader(
+        uint8_t *rtp, uint8_t packetType, bool marker, uint32_t rtpTime) {
     rtp[0] = 0x80;
+
     rtp[1] = packetType;
+    if (marker) {
+        rtp[1] |= 1 << 7;  // M-bit
+    }
 
     rtp[2] = (mRTPSeqNo >> 8) & 0xff;
     rtp[3] = mRTPSeqNo & 0xff;
     ++mRTPSeqNo;
 
-    uint32_t rtpTime = (timeUs * 9) / 100ll;
-
     rtp[4] = rtpTime >> 24;
     rtp[5] = (rtpTime >> 16) & 0xff;
     rtp[6] = (rtpTime >> 8) & 0xff;
@@ -235,8 +240,21 @@ status_t RTPSender::queueRawPacket(
     rtp[9] = (kSourceID >> 16) & 0xff;
     rtp[10] = (kSourceID >> 8) & 0xff;
     rtp[11] = kSourceID & 0xff;
+}
 
-    memcpy(&rtp[12], packet->data(), packet->size());
+status_t RTPSender::queueRawPacket(
+        const sp<ABuffer> &packet, uint8_t packetType) {
+    CHECK_LE(packet->size(), kMaxUDPPacketSize - 12);
+
+    int64_t timeUs;
+    CHECK(packet->meta()->findInt64("timeUs", &timeUs));
+
+    Packet udpPacket = MakePacket(12, packet, 0, packet->size());
+    udpPacket.mHeader->setInt32Data(mRTPSeqNo);
+
+    uint32_t rtpTime = (timeUs * 9) / 100ll;
+    writeRTPHeader(
+            udpPacket.mHeader->data(), packetType, false /* marker */, rtpTime);
 
     return sendRTPPacket(
             udpPacket,
@@ -254,40 +272,22 @@ status_t RTPSender::queueTSPackets(
 
     size_t srcOffset = 0;
     while (srcOffset < tsPackets->size()) {
-        sp<ABuffer> udpPacket =
-            new ABuffer(12 + kMaxNumTSPacketsPerRTPPacket * 188);
-
-        udpPacket->setInt32Data(mRTPSeqNo);
-
-        uint8_t *rtp = udpPacket->data();
-        rtp[0] = 0x80;
-        rtp[1] = packetType;
-
-        rtp[2] = (mRTPSeqNo >> 8) & 0xff;
-        rtp[3] = mRTPSeqNo & 0xff;
-        ++mRTPSeqNo;
-
-        int64_t nowUs = ALooper::GetNowUs();
-        uint32_t rtpTime = (nowUs * 9) / 100ll;
-
-        rtp[4] = rtpTime >> 24;
-        rtp[5] = (rtpTime >> 16) & 0xff;
-        rtp[6] = (rtpTime >> 8) & 0xff;
-        rtp[7] = rtpTime & 0xff;
-
-        rtp[8] = kSourceID >> 24;
-        rtp[9] = (kSourceID >> 16) & 0xff;
-        rtp[10] = (kSourceID >> 8) & 0xff;
-        rtp[11] = kSourceID & 0xff;
-
         size_t numTSPackets = (tsPackets->size() - srcOffset) / 188;
         if (numTSPackets > kMaxNumTSPacketsPerRTPPacket) {
             numTSPackets = kMaxNumTSPacketsPerRTPPacket;
         }
 
-        memcpy(&rtp[12], tsPackets->data() + srcOffset, numTSPackets * 188);
+        // The TS packets are sent straight from the packetizer's buffer.
+        Packet udpPacket =
+            MakePacket(12, tsPackets, srcOffset, numTSPackets * 188);
+        udpPacket.mHeader->setInt32Data(mRTPSeqNo);
 
-        udpPacket->setRange(0, 12 + numTSPackets * 188);
+        int64_t nowUs = ALooper::GetNowUs();
+        uint32_t rtpTime = (nowUs * 9) / 100ll;
+
+        writeRTPHeader(
+                udpPacket.mHeader->data(), packetType, false /* marker */,
+                rtpTime);
 
         srcOffset += numTSPackets * 188;
         bool isLastPacket = (srcOffset == tsPackets->size());
@@ -313,8 +313,11 @@ status_t RTPSender::queueAVCBuffer(
 
     uint32_t rtpTime = (timeUs * 9 / 100ll);
 
-    List<sp<ABuffer> > packets;
+    List<Packet> packets;
 
+    // Small NAL units are aggregated into STAP-A packets, which are
+    // assembled in |out|. Single NAL unit packets and FU-As reference the
+    // NAL unit in the access unit instead.
     sp<ABuffer> out = new ABuffer(kMaxUDPPacketSize);
     size_t outBytesUsed = 12;  // Placeholder for RTP header.
 
@@ -325,6 +328,8 @@ status_t RTPSender::queueAVCBuffer(
     while (getNextNALUnit(
                 &data, &size, &nalStart, &nalSize,
                 true /* startCodeFollows */) == OK) {
+        size_t nalOffset = nalStart - accessUnit->data();
+
         size_t bytesNeeded = nalSize + 2;
         if (outBytesUsed == 12) {
             ++bytesNeeded;
@@ -338,21 +343,23 @@ status_t RTPSender::queueAVCBuffer(
                 // We haven't emitted anything into the current packet yet and
                 // this NAL unit fits into a single-NAL-unit-packet while
                 // it wouldn't have fit as part of a STAP-A packet.
-
-                memcpy(out->data() + outBytesUsed, nalStart, nalSize);
-                outBytesUsed += nalSize;
-
                 emitSingleNALPacket = true;
             }
 
             if (outBytesUsed > 12) {
                 out->setRange(0, outBytesUsed);
-                packets.push_back(out);
+
+                Packet packet;
+                packet.mHeader = out;
+                packets.push_back(packet);
+
                 out = new ABuffer(kMaxUDPPacketSize);
                 outBytesUsed = 12;  // Placeholder for RTP header
             }
 
             if (emitSingleNALPacket) {
+                packets.push_back(
+                        MakePacket(12, accessUnit, nalOffset, nalSize));
                 continue;
             }
         }
@@ -382,12 +389,15 @@ status_t RTPSender::queueAVCBuffer(
 
         size_t srcOffset = 1;
         while (srcOffset < nalSize) {
-            size_t copy = out->capacity() - outBytesUsed - 2;
+            size_t copy = kMaxUDPPacketSize - 12 - 2;
             if (copy > nalSize - srcOffset) {
                 copy = nalSize - srcOffset;
             }
 
-            uint8_t *dst = out->data() + outBytesUsed;
+            Packet packet =
+                MakePacket(12 + 2, accessUnit, nalOffset + srcOffset, copy);
+
+            uint8_t *dst = packet.mHeader->data() + 12;
             dst[0] = (nri << 5) | 28;
 
             dst[1] = nalType;
@@ -400,53 +410,31 @@ status_t RTPSender::queueAVCBuffer(
                 dst[1] |= 0x40;
             }
 
-            memcpy(&dst[2], nalStart + srcOffset, copy);
             srcOffset += copy;
 
-            out->setRange(0, outBytesUsed + copy + 2);
-
-            packets.push_back(out);
-            out = new ABuffer(kMaxUDPPacketSize);
-            outBytesUsed = 12;  // Placeholder for RTP header
+            packets.push_back(packet);
         }
     }
 
     if (outBytesUsed > 12) {
         out->setRange(0, outBytesUsed);
-        packets.push_back(out);
+
+        Packet packet;
+        packet.mHeader = out;
+        packets.push_back(packet);
     }
 
     while (!packets.empty()) {
-        sp<ABuffer> out = *packets.begin();
+        Packet packet = *packets.begin();
         packets.erase(packets.begin());
 
-        out->setInt32Data(mRTPSeqNo);
+        packet.mHeader->setInt32Data(mRTPSeqNo);
 
         bool last = packets.empty();
 
-        uint8_t *dst = out->data();
-
-        dst[0] = 0x80;
+        writeRTPHeader(packet.mHeader->data(), packetType, last, rtpTime);
 
-        dst[1] = packetType;
-        if (last) {
-            dst[1] |= 1 << 7;  // M-bit
-        }
-
-        dst[2] = (mRTPSeqNo >> 8) & 0xff;
-        dst[3] = mRTPSeqNo & 0xff;
-        ++mRTPSeqNo;
-
-        dst[4] = rtpTime >> 24;
-        dst[5] = (rtpTime >> 16) & 0xff;
-        dst[6] = (rtpTime >> 8) & 0xff;
-        dst[7] = rtpTime & 0xff;
-        dst[8] = kSourceID >> 24;
-        dst[9] = (kSourceID >> 16) & 0xff;
-        dst[10] = (kSourceID >> 8) & 0xff;
-        dst[11] = kSourceID & 0xff;
-
-        status_t err = sendRTPPacket(out, true /* storeInHistory */);
+        status_t err = sendRTPPacket(packet, true /* storeInHistory */);
 
         if (err != OK) {
             return err;
@@ -457,23 +445,33 @@ status_t RTPSender::queueAVCBuffer(
 }
 
 status_t RTPSender::sendRTPPacket(
-        const sp<ABuffer> &buffer, bool storeInHistory,
+        const Packet &packet, bool storeInHistory,
         bool timeValid, int64_t timeUs) {
     CHECK(mRTPConnected);
 
-    status_t err = mNetSession->sendRequest(
-            mRTPSessionID, buffer->data(), buffer->size(),
-            timeValid, timeUs);
+    const sp<ABuffer> &header = packet.mHeader;
+
+    status_t err;
+    if (packet.mPayload == NULL) {
+        err = mNetSession->sendRequest(
+                mRTPSessionID, header->data(), header->size(),
+                timeValid, timeUs);
+    } else {
+        err = mNetSession->sendDatagram(
+                mRTPSessionID, header->data(), header->size(),
+                packet.mPayload, packet.mPayloadOffset, packet.mPayloadSize,
+                timeValid, timeUs);
+    }
 
     if (err != OK) {
         return err;
     }
 
     mLastNTPTime = GetNowNTP();
-    mLastRTPTime = U32_AT(buffer->data() + 4);
+    mLastRTPTime = U32_AT(header->data() + 4);
 
     ++mNumRTPSent;
-    mNumRTPOctetsSent += buffer->size() - 12;
+    mNumRTPOctetsSent += header->size() + packet.mPayloadSize - 12;
 
     if (storeInHistory) {
         if (mHistorySize == kMaxHistorySize) {
@@ -481,7 +479,7 @@ status_t RTPSender::sendRTPPacket(
         } else {
             ++mHistorySize;
         }
-        mHistory.push_back(buffer);
+        mHistory.push_back(packet);
     }
 
     return OK;
@@ -707,12 +705,12 @@ status_t RTPSender::parseTSFB(const uint8_t *data, size_t size) {
         uint16_t seqNo = U16_AT(&data[i]);
         uint16_t blp = U16_AT(&data[i + 2]);
 
-        List<sp<ABuffer> >::iterator it = mHistory.begin();
+        List<Packet>::iterator it = mHistory.begin();
         bool foundSeqNo = false;
         while (it != mHistory.end()) {
-            const sp<ABuffer> &buffer = *it;
+            const Packet &packet = *it;
 
-            uint16_t bufferSeqNo = buffer->int32Data() & 0xffff;
+            uint16_t bufferSeqNo = packet.mHeader->int32Data() & 0xffff;
 
             bool retransmit = false;
             if (bufferSeqNo == seqNo) {
@@ -731,7 +729,7 @@ status_t RTPSender::parseTSFB(const uint8_t *data, size_t size) {
                 ALOGV("retransmitting seqNo %d", bufferSeqNo);
 
                 CHECK_EQ((status_t)OK,
-                         sendRTPPacket(buffer, false /* storeInHistory */));
+                         sendRTPPacket(packet, false /* storeInHistory */));
 
                 if (bufferSeqNo == seqNo) {
                     foundSeqNo = true;
@@ -751,8 +749,10 @@ status_t RTPSender::parseTSFB(const uint8_t *data, size_t size) {
                   seqNo, foundSeqNo, blp);
 
             if (!mHistory.empty()) {
-                int32_t earliest = (*mHistory.begin())->int32Data() & 0xffff;
-                int32_t latest = (*--mHistory.end())->int32Data() & 0xffff;
+                int32_t earliest =
+                    (*mHistory.begin()).mHeader->int32Data() & 0xffff;
+                int32_t latest =
+                    (*--mHistory.end()).mHeader->int32Data() & 0xffff;
 
                 ALOGI("have seq numbers from %d - %d", earliest, latest);
             }
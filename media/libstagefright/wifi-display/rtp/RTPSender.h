@@ -89,7 +89,20 @@ private:
 
     uint32_t mRTPSeqNo;
 
-    List<sp<ABuffer> > mHistory;
+    // An RTP packet as handed to the network session. mHeader holds the RTP
+    // header and any payload header, followed by the payload if it was
+    // assembled from several pieces. Otherwise the payload is a range of
+    // the buffer that was queued, which is sent without being copied.
+    struct Packet {
+        sp<ABuffer> mHeader;
+        sp<ABuffer> mPayload;
+        size_t mPayloadOffset;
+        size_t mPayloadSize;
+
+        Packet() : mPayloadOffset(0), mPayloadSize(0) {}
+    };
+
+    List<Packet> mHistory;
     size_t mHistorySize;
 
     static uint64_t GetNowNTP();
@@ -98,8 +111,15 @@ private:
     status_t queueTSPackets(const sp<ABuffer> &tsPackets, uint8_t packetType);
     status_t queueAVCBuffer(const sp<ABuffer> &accessUnit, uint8_t packetType);
 
+    static Packet MakePacket(
+            size_t headerSize, const sp<ABuffer> &payload,
+            size_t payloadOffset, size_t payloadSize);
+
+    void writeRTPHeader(
+            uint8_t *rtp, uint8_t packetType, bool marker, uint32_t rtpTime);
+
     status_t sendRTPPacket(
-            const sp<ABuffer> &packet, bool storeInHistory,
+            const Packet &packet, bool storeInHistory,
             bool timeValid = false, int64_t timeUs = -1ll);
 
     void onNetNotify(bool isRTP, const sp<AMessage> &msg);
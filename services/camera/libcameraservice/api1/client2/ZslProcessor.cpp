@@ -27,6 +27,7 @@
 
 #include <inttypes.h>
 
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 #include <gui/Surface.h>
@@ -51,6 +52,8 @@ ZslProcessor::ZslProcessor(
         mId(client->getCameraId()),
         mZslStreamId(NO_STREAM),
         mFrameListHead(0),
+        mFrameListCount(0),
+        mPinCandidateCount(0),
         mHasFocuser(false) {
     // Initialize buffer queue and frame list based on pipeline max depth.
     size_t pipelineMaxDepth = kDefaultMaxPipelineDepth;
@@ -83,6 +86,18 @@ ZslProcessor::ZslProcessor(
     mFrameListDepth = pipelineMaxDepth;
     mBufferQueueDepth = mFrameListDepth + 1;
 
+    // Optionally keep the best candidates pinned in the ZSL ring. Leave room
+    // for the producer and for the buffer pinned by the reprocess request.
+    char value[PROPERTY_VALUE_MAX];
+    property_get("camera.zsl.pin_candidates", value, "0");
+    int pinCandidateCount = atoi(value);
+    if (pinCandidateCount > 0) {
+        size_t maxPinCount = mBufferQueueDepth > 2 ? mBufferQueueDepth - 2 : 0;
+        mPinCandidateCount = (size_t)pinCandidateCount < maxPinCount ?
+                (size_t)pinCandidateCount : maxPinCount;
+        ALOGV("%s: Pinning up to %zu ZSL candidate buffers", __FUNCTION__,
+                mPinCandidateCount);
+    }
 
     mZslQueue.insertAt(0, mBufferQueueDepth);
     mFrameList.insertAt(0, mFrameListDepth);
@@ -98,31 +113,60 @@ ZslProcessor::~ZslProcessor() {
 void ZslProcessor::onResultAvailable(const CaptureResult &result) {
     ATRACE_CALL();
     ALOGV("%s:", __FUNCTION__);
-    Mutex::Autolock l(mInputMutex);
-    camera_metadata_ro_entry_t entry;
-    entry = result.mMetadata.find(ANDROID_SENSOR_TIMESTAMP);
-    nsecs_t timestamp = entry.data.i64[0];
-    if (entry.count == 0) {
-        ALOGE("%s: metadata doesn't have timestamp, skip this result", __FUNCTION__);
-        return;
-    }
+    Vector<nsecs_t> pinTimestamps;
+    sp<camera3::Camera3ZslStream> zslStream;
+    {
+        Mutex::Autolock l(mInputMutex);
+        camera_metadata_ro_entry_t entry;
+        entry = result.mMetadata.find(ANDROID_SENSOR_TIMESTAMP);
+        if (entry.count == 0) {
+            ALOGE("%s: metadata doesn't have timestamp, skip this result", __FUNCTION__);
+            return;
+        }
+        nsecs_t timestamp = entry.data.i64[0];
 
-    entry = result.mMetadata.find(ANDROID_REQUEST_FRAME_COUNT);
-    if (entry.count == 0) {
-        ALOGE("%s: metadata doesn't have frame number, skip this result", __FUNCTION__);
-        return;
-    }
-    int32_t frameNumber = entry.data.i32[0];
+        entry = result.mMetadata.find(ANDROID_REQUEST_FRAME_COUNT);
+        if (entry.count == 0) {
+            ALOGE("%s: metadata doesn't have frame number, skip this result", __FUNCTION__);
+            return;
+        }
+        int32_t frameNumber = entry.data.i32[0];
 
-    ALOGVV("Got preview metadata for frame %d with timestamp %" PRId64, frameNumber, timestamp);
+        ALOGVV("Got preview metadata for frame %d with timestamp %" PRId64, frameNumber, timestamp);
 
-    if (mState != RUNNING) return;
+        if (mState != RUNNING) return;
 
-    // Corresponding buffer has been cleared. No need to push into mFrameList
-    if (timestamp <= mLatestClearedBufferTimestamp) return;
+        // Corresponding buffer has been cleared. No need to push into mFrameList
+        if (timestamp <= mLatestClearedBufferTimestamp) return;
 
-    mFrameList.editItemAt(mFrameListHead) = result.mMetadata;
-    mFrameListHead = (mFrameListHead + 1) % mFrameListDepth;
+        // Drop the frame being overwritten from the candidate index
+        CameraMetadata &slot = mFrameList.editItemAt(mFrameListHead);
+        if (!slot.isEmpty()) {
+            entry = slot.find(ANDROID_SENSOR_TIMESTAMP);
+            if (entry.count > 0) {
+                ssize_t idx = mCandidateIndex.indexOfKey(entry.data.i64[0]);
+                if (idx >= 0 && mCandidateIndex.valueAt(idx) == mFrameListHead) {
+                    mCandidateIndex.removeItemsAt(idx);
+                }
+            }
+        } else {
+            mFrameListCount++;
+        }
+
+        slot = result.mMetadata;
+        if (isCandidateFrame(slot)) {
+            mCandidateIndex.add(timestamp, mFrameListHead);
+        }
+        mFrameListHead = (mFrameListHead + 1) % mFrameListDepth;
+
+        if (mPinCandidateCount == 0 || mZslStream == 0) return;
+        getPinCandidateTimestampsLocked(&pinTimestamps);
+        zslStream = mZslStream;
+    }
+
+    // Pin outside of mInputMutex; the stream lock is held while calling
+    // onBufferReleased, which takes mInputMutex.
+    zslStream->pinCandidateBuffers(pinTimestamps);
 }
 
 status_t ZslProcessor::updateStream(const Parameters &params) {
@@ -448,7 +492,9 @@ status_t ZslProcessor::clearZslQueueLocked() {
 void ZslProcessor::clearZslResultQueueLocked() {
     mFrameList.clear();
     mFrameListHead = 0;
+    mFrameListCount = 0;
     mFrameList.insertAt(0, mFrameListDepth);
+    mCandidateIndex.clear();
 }
 
 void ZslProcessor::dump(int fd, const Vector<String16>& /*args*/) const {
@@ -461,6 +507,9 @@ void ZslProcessor::dump(int fd, const Vector<String16>& /*args*/) const {
         String8 result("    Latest ZSL capture request: none yet\n");
         write(fd, result.string(), result.size());
     }
+    String8 result = String8::format("    ZSL candidates: %zu, pinned up to %zu\n",
+            mCandidateIndex.size(), mPinCandidateCount);
+    write(fd, result.string(), result.size());
     dumpZslQueue(fd);
 }
 
@@ -519,92 +568,80 @@ bool ZslProcessor::isFixedFocusMode(uint8_t afMode) const {
     }
 }
 
-nsecs_t ZslProcessor::getCandidateTimestampLocked(size_t* metadataIdx) const {
+bool ZslProcessor::isCandidateFrame(const CameraMetadata &frame) const {
     /**
-     * Find the smallest timestamp we know about so far
-     * - ensure that aeState is either converged or locked
+     * Ensure that aeState is either converged or locked, and that the frame
+     * is in focus if the device has a focuser.
      */
+    camera_metadata_ro_entry_t entry;
+    entry = frame.find(ANDROID_CONTROL_AE_STATE);
 
-    size_t idx = 0;
-    nsecs_t minTimestamp = -1;
-
-    size_t emptyCount = mFrameList.size();
-
-    for (size_t j = 0; j < mFrameList.size(); j++) {
-        const CameraMetadata &frame = mFrameList[j];
-        if (!frame.isEmpty()) {
+    if (entry.count == 0) {
+        /**
+         * This is most likely a HAL bug. The aeState field is
+         * mandatory, so it should always be in a metadata packet.
+         */
+        ALOGW("%s: ZSL queue frame has no AE state field!",
+                __FUNCTION__);
+        return false;
+    }
+    if (entry.data.u8[0] != ANDROID_CONTROL_AE_STATE_CONVERGED &&
+            entry.data.u8[0] != ANDROID_CONTROL_AE_STATE_LOCKED) {
+        ALOGVV("%s: ZSL queue frame AE state is %d, need "
+               "full capture",  __FUNCTION__, entry.data.u8[0]);
+        return false;
+    }
 
-            emptyCount--;
+    entry = frame.find(ANDROID_CONTROL_AF_MODE);
+    if (entry.count == 0) {
+        ALOGW("%s: ZSL queue frame has no AF mode field!",
+                __FUNCTION__);
+        return false;
+    }
+    uint8_t afMode = entry.data.u8[0];
+    if (afMode == ANDROID_CONTROL_AF_MODE_OFF) {
+        // Skip all the ZSL buffer for manual AF mode, as we don't really
+        // know the af state.
+        return false;
+    }
 
-            camera_metadata_ro_entry_t entry;
-            entry = frame.find(ANDROID_SENSOR_TIMESTAMP);
-            if (entry.count == 0) {
-                ALOGE("%s: Can't find timestamp in frame!",
-                        __FUNCTION__);
-                continue;
-            }
-            nsecs_t frameTimestamp = entry.data.i64[0];
-            if (minTimestamp > frameTimestamp || minTimestamp == -1) {
-
-                entry = frame.find(ANDROID_CONTROL_AE_STATE);
-
-                if (entry.count == 0) {
-                    /**
-                     * This is most likely a HAL bug. The aeState field is
-                     * mandatory, so it should always be in a metadata packet.
-                     */
-                    ALOGW("%s: ZSL queue frame has no AE state field!",
-                            __FUNCTION__);
-                    continue;
-                }
-                if (entry.data.u8[0] != ANDROID_CONTROL_AE_STATE_CONVERGED &&
-                        entry.data.u8[0] != ANDROID_CONTROL_AE_STATE_LOCKED) {
-                    ALOGVV("%s: ZSL queue frame AE state is %d, need "
-                           "full capture",  __FUNCTION__, entry.data.u8[0]);
-                    continue;
-                }
+    // Check AF state if device has focuser and focus mode isn't fixed
+    if (mHasFocuser && !isFixedFocusMode(afMode)) {
+        // Make sure the candidate frame has good focus.
+        entry = frame.find(ANDROID_CONTROL_AF_STATE);
+        if (entry.count == 0) {
+            ALOGW("%s: ZSL queue frame has no AF state field!",
+                    __FUNCTION__);
+            return false;
+        }
+        uint8_t afState = entry.data.u8[0];
+        if (afState != ANDROID_CONTROL_AF_STATE_PASSIVE_FOCUSED &&
+                afState != ANDROID_CONTROL_AF_STATE_FOCUSED_LOCKED &&
+                afState != ANDROID_CONTROL_AF_STATE_NOT_FOCUSED_LOCKED) {
+            ALOGVV("%s: ZSL queue frame AF state is %d is not good for capture, skip it",
+                    __FUNCTION__, afState);
+            return false;
+        }
+    }
 
-                entry = frame.find(ANDROID_CONTROL_AF_MODE);
-                if (entry.count == 0) {
-                    ALOGW("%s: ZSL queue frame has no AF mode field!",
-                            __FUNCTION__);
-                    continue;
-                }
-                uint8_t afMode = entry.data.u8[0];
-                if (afMode == ANDROID_CONTROL_AF_MODE_OFF) {
-                    // Skip all the ZSL buffer for manual AF mode, as we don't really
-                    // know the af state.
-                    continue;
-                }
+    return true;
+}
 
-                // Check AF state if device has focuser and focus mode isn't fixed
-                if (mHasFocuser && !isFixedFocusMode(afMode)) {
-                    // Make sure the candidate frame has good focus.
-                    entry = frame.find(ANDROID_CONTROL_AF_STATE);
-                    if (entry.count == 0) {
-                        ALOGW("%s: ZSL queue frame has no AF state field!",
-                                __FUNCTION__);
-                        continue;
-                    }
-                    uint8_t afState = entry.data.u8[0];
-                    if (afState != ANDROID_CONTROL_AF_STATE_PASSIVE_FOCUSED &&
-                            afState != ANDROID_CONTROL_AF_STATE_FOCUSED_LOCKED &&
-                            afState != ANDROID_CONTROL_AF_STATE_NOT_FOCUSED_LOCKED) {
-                        ALOGVV("%s: ZSL queue frame AF state is %d is not good for capture, skip it",
-                                __FUNCTION__, afState);
-                        continue;
-                    }
-                }
+nsecs_t ZslProcessor::getCandidateTimestampLocked(size_t* metadataIdx) const {
+    /**
+     * Pick the smallest timestamp out of the candidate index; frames are
+     * checked for 3A convergence as they arrive in onResultAvailable.
+     */
 
-                minTimestamp = frameTimestamp;
-                idx = j;
-            }
+    size_t idx = 0;
+    nsecs_t minTimestamp = -1;
 
-            ALOGVV("%s: Saw timestamp %" PRId64, __FUNCTION__, frameTimestamp);
-        }
+    if (mCandidateIndex.size() > 0) {
+        minTimestamp = mCandidateIndex.keyAt(0);
+        idx = mCandidateIndex.valueAt(0);
     }
 
-    if (emptyCount == mFrameList.size()) {
+    if (mFrameListCount == 0) {
         /**
          * This could be mildly bad and means our ZSL was triggered before
          * there were any frames yet received by the camera framework.
@@ -620,8 +657,9 @@ nsecs_t ZslProcessor::getCandidateTimestampLocked(size_t* metadataIdx) const {
         ALOGW("%s: ZSL queue has no metadata frames", __FUNCTION__);
     }
 
-    ALOGV("%s: Candidate timestamp %" PRId64 " (idx %zu), empty frames: %zu",
-          __FUNCTION__, minTimestamp, idx, emptyCount);
+    ALOGV("%s: Candidate timestamp %" PRId64 " (idx %zu), candidates: %zu, "
+          "empty frames: %zu", __FUNCTION__, minTimestamp, idx,
+          mCandidateIndex.size(), mFrameList.size() - mFrameListCount);
 
     if (metadataIdx) {
         *metadataIdx = idx;
@@ -630,6 +668,17 @@ nsecs_t ZslProcessor::getCandidateTimestampLocked(size_t* metadataIdx) const {
     return minTimestamp;
 }
 
+void ZslProcessor::getPinCandidateTimestampsLocked(Vector<nsecs_t>* timestamps) const {
+    // Candidates are selected oldest first, which are also the ones closest
+    // to being evicted from the ring buffer.
+    size_t count = mCandidateIndex.size() < mPinCandidateCount ?
+            mCandidateIndex.size() : mPinCandidateCount;
+    timestamps->setCapacity(count);
+    for (size_t i = 0; i < count; i++) {
+        timestamps->push_back(mCandidateIndex.keyAt(i));
+    }
+}
+
 void ZslProcessor::onBufferAcquired(const BufferInfo& /*bufferInfo*/) {
     // Intentionally left empty
     // Although theoretically we could use this to get better dump info
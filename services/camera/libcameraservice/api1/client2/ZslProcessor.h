@@ -20,6 +20,7 @@
 #include <utils/Thread.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
+#include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Condition.h>
 #include <gui/BufferItem.h>
@@ -126,6 +127,17 @@ class ZslProcessor :
     size_t mFrameListDepth;
     Vector<CameraMetadata> mFrameList;
     size_t mFrameListHead;
+    size_t mFrameListCount;
+
+    // Index of the frames in mFrameList that are good candidates for
+    // reprocessing (AE/AF converged), from timestamp to mFrameList slot.
+    // Updated as results arrive so candidate selection doesn't need to
+    // scan the frame list.
+    KeyedVector<nsecs_t, size_t> mCandidateIndex;
+
+    // Number of best candidate buffers to keep pinned in the ZSL ring
+    // ahead of a capture request, 0 to disable.
+    size_t mPinCandidateCount;
 
     ZslPair mNextPair;
 
@@ -145,6 +157,12 @@ class ZslProcessor :
 
     nsecs_t getCandidateTimestampLocked(size_t* metadataIdx) const;
 
+    // Whether the result metadata has the 3A state required for reprocessing
+    bool isCandidateFrame(const CameraMetadata &frame) const;
+
+    // Collect the timestamps of the best candidates to pin in the ZSL ring
+    void getPinCandidateTimestampsLocked(Vector<nsecs_t>* timestamps) const;
+
     bool isFixedFocusMode(uint8_t afMode) const;
 
     // Update the post-processing metadata with the default still capture request template
@@ -276,8 +276,8 @@ void Camera3ZslStream::dump(int fd, const Vector<String16> &args) const {
     Camera3IOStreamBase::dump(fd, args);
 
     lines = String8();
-    lines.appendFormat("      Input buffers pending: %zu, in flight %zu\n",
-            mInputBufferQueue.size(), mBuffersInFlight.size());
+    lines.appendFormat("      Input buffers pending: %zu, in flight %zu, pinned candidates %zu\n",
+            mInputBufferQueue.size(), mBuffersInFlight.size(), mCandidateBuffers.size());
     write(fd, lines.string(), lines.size());
 }
 
@@ -287,11 +287,25 @@ status_t Camera3ZslStream::enqueueInputBufferByTimestamp(
 
     Mutex::Autolock l(mLock);
 
-    TimestampFinder timestampFinder = TimestampFinder(timestamp);
+    sp<RingBufferConsumer::PinnedBufferItem> pinnedBuffer;
 
-    sp<RingBufferConsumer::PinnedBufferItem> pinnedBuffer =
-            mProducer->pinSelectedBuffer(timestampFinder,
-                                        /*waitForFence*/false);
+    ssize_t idx = mCandidateBuffers.indexOfKey(timestamp);
+    if (idx >= 0) {
+        pinnedBuffer = mCandidateBuffers.valueAt(idx);
+        mCandidateBuffers.removeItemsAt(idx);
+    }
+
+    if (pinnedBuffer == 0) {
+        pinnedBuffer = mProducer->pinBufferByTimestamp(timestamp,
+                                                       /*waitForFence*/false);
+    }
+
+    if (pinnedBuffer == 0) {
+        // No exact match, fall back to searching for the closest timestamp
+        TimestampFinder timestampFinder = TimestampFinder(timestamp);
+        pinnedBuffer = mProducer->pinSelectedBuffer(timestampFinder,
+                                                    /*waitForFence*/false);
+    }
 
     if (pinnedBuffer == 0) {
         ALOGE("%s: No ZSL buffers were available yet", __FUNCTION__);
@@ -328,10 +342,38 @@ status_t Camera3ZslStream::clearInputRingBufferLocked(nsecs_t* latestTimestamp)
         *latestTimestamp = mProducer->getLatestTimestamp();
     }
     mInputBufferQueue.clear();
+    mCandidateBuffers.clear();
 
     return mProducer->clear();
 }
 
+size_t Camera3ZslStream::pinCandidateBuffers(const Vector<nsecs_t>& timestamps) {
+    Mutex::Autolock l(mLock);
+
+    KeyedVector<nsecs_t, sp<PinnedBufferItem> > candidates;
+    for (size_t i = 0; i < timestamps.size(); i++) {
+        nsecs_t timestamp = timestamps[i];
+        sp<PinnedBufferItem> pinnedBuffer;
+
+        ssize_t idx = mCandidateBuffers.indexOfKey(timestamp);
+        if (idx >= 0) {
+            pinnedBuffer = mCandidateBuffers.valueAt(idx);
+        } else {
+            pinnedBuffer = mProducer->pinBufferByTimestamp(timestamp,
+                                                           /*waitForFence*/false);
+        }
+
+        if (pinnedBuffer != 0) {
+            candidates.add(timestamp, pinnedBuffer);
+        }
+    }
+
+    // Dropping the last reference of stale candidates unpins them
+    mCandidateBuffers = candidates;
+
+    return mCandidateBuffers.size();
+}
+
 status_t Camera3ZslStream::disconnectLocked() {
     clearInputRingBufferLocked(NULL);
 
@@ -18,6 +18,7 @@
 #define ANDROID_SERVERS_CAMERA3_ZSL_STREAM_H
 
 #include <utils/RefBase.h>
+#include <utils/KeyedVector.h>
 #include <gui/Surface.h>
 #include <gui/RingBufferConsumer.h>
 
@@ -64,6 +65,16 @@ class Camera3ZslStream :
      */
     status_t clearInputRingBuffer(nsecs_t* latestTimestamp);
 
+    /**
+     * Pin the buffers matching these timestamps ahead of a capture request, so
+     * that they are not evicted from the RingBufferConsumer and can be found by
+     * enqueueInputBufferByTimestamp without searching the ring. Buffers pinned
+     * by a previous call that are not in timestamps are unpinned.
+     *
+     * Returns the number of buffers that are pinned after the call.
+     */
+    size_t pinCandidateBuffers(const Vector<nsecs_t>& timestamps);
+
   protected:
 
     /**
@@ -80,6 +91,10 @@ class Camera3ZslStream :
     // Input buffers in flight to HAL
     Vector<sp<RingBufferConsumer::PinnedBufferItem> > mBuffersInFlight;
 
+    // Candidate buffers pinned ahead of time, keyed by timestamp
+    KeyedVector<nsecs_t, sp<RingBufferConsumer::PinnedBufferItem> >
+                                                    mCandidateBuffers;
+
     /**
      * Camera3Stream interface
      */
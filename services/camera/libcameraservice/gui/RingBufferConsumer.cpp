@@ -106,17 +106,53 @@ sp<PinnedBufferItem> RingBufferConsumer::pinSelectedBuffer(
     } // end scope of mMutex autolock
 
     if (waitForFence) {
-        status_t err = pinnedBuffer->getBufferItem().mFence->waitForever(
-                "RingBufferConsumer::pinSelectedBuffer");
-        if (err != OK) {
-            BI_LOGE("Failed to wait for fence of acquired buffer: %s (%d)",
-                    strerror(-err), err);
+        waitForPinnedFence(pinnedBuffer);
+    }
+
+    return pinnedBuffer;
+}
+
+sp<PinnedBufferItem> RingBufferConsumer::pinBufferByTimestamp(
+        nsecs_t timestamp,
+        bool waitForFence) {
+
+    sp<PinnedBufferItem> pinnedBuffer;
+
+    {
+        Mutex::Autolock _l(mMutex);
+
+        ssize_t idx = mTimestampIndex.indexOfKey(timestamp);
+        if (idx < 0) {
+            BI_LOGV("No buffer with timestamp %" PRId64 " in ring buffer",
+                    timestamp);
+            return NULL;
         }
+
+        RingBufferItem* item = mTimestampIndex.valueAt(idx);
+        pinnedBuffer = new PinnedBufferItem(this, *item);
+        item->mPinCount++;
+
+        BI_LOGV("Pinned buffer (frame %" PRIu64 ", timestamp %" PRId64 ")",
+                item->mFrameNumber, item->mTimestamp);
+    } // end scope of mMutex autolock
+
+    if (waitForFence) {
+        waitForPinnedFence(pinnedBuffer);
     }
 
     return pinnedBuffer;
 }
 
+void RingBufferConsumer::waitForPinnedFence(
+        const sp<PinnedBufferItem>& pinnedBuffer) {
+    status_t err = pinnedBuffer->getBufferItem().mFence->waitForever(
+            "RingBufferConsumer::pinSelectedBuffer");
+    if (err != OK) {
+        BI_LOGE("Failed to wait for fence of acquired buffer: %s (%d)",
+                strerror(-err), err);
+    }
+}
+
 status_t RingBufferConsumer::clear() {
 
     status_t err;
@@ -256,6 +292,10 @@ status_t RingBufferConsumer::releaseOldestBufferLocked(size_t* pinnedFrames) {
         BI_LOGV("Buffer timestamp %" PRId64 ", frame %" PRIu64 " evicted",
                 item.mTimestamp, item.mFrameNumber);
 
+        ssize_t idx = mTimestampIndex.indexOfKey(item.mTimestamp);
+        if (idx >= 0 && mTimestampIndex.valueAt(idx) == &item) {
+            mTimestampIndex.removeItemsAt(idx);
+        }
         mBufferItemList.erase(accIt);
     } else {
         BI_LOGW("All buffers pinned, could not find any to release");
@@ -317,6 +357,8 @@ void RingBufferConsumer::onFrameAvailable(const BufferItem& item) {
         mLatestTimestamp = item.mTimestamp;
 
         item.mGraphicBuffer = mSlots[item.mSlot].mGraphicBuffer;
+
+        mTimestampIndex.add(item.mTimestamp, &item);
     } // end of mMutex lock
 
     ConsumerBase::onFrameAvailable(item);
@@ -22,6 +22,7 @@
 
 #include <ui/GraphicBuffer.h>
 
+#include <utils/KeyedVector.h>
 #include <utils/String8.h>
 #include <utils/Vector.h>
 #include <utils/threads.h>
@@ -155,6 +156,15 @@ class RingBufferConsumer : public ConsumerBase,
     sp<PinnedBufferItem> pinSelectedBuffer(const RingBufferComparator& filter,
                                            bool waitForFence = true);
 
+    // Find the buffer with exactly this timestamp, then pin it before
+    // returning it. Unlike pinSelectedBuffer this does not walk the ring,
+    // it looks the buffer up in a timestamp index maintained as buffers
+    // are acquired and released.
+    //
+    // Returns NULL if no buffer with this timestamp is in the ring buffer.
+    sp<PinnedBufferItem> pinBufferByTimestamp(nsecs_t timestamp,
+                                              bool waitForFence = true);
+
     // Release all the non-pinned buffers in the ring buffer
     status_t clear();
 
@@ -167,6 +177,7 @@ class RingBufferConsumer : public ConsumerBase,
     virtual void onFrameAvailable(const BufferItem& item);
 
     void pinBufferLocked(const BufferItem& item);
+    void waitForPinnedFence(const sp<PinnedBufferItem>& pinnedBuffer);
     void unpinBuffer(const BufferItem& item);
 
     // Releases oldest buffer. Returns NO_BUFFER_AVAILABLE
@@ -181,6 +192,9 @@ class RingBufferConsumer : public ConsumerBase,
 
     // List of acquired buffers in our ring buffer
     List<RingBufferItem>       mBufferItemList;
+    // Index from timestamp to the matching item in mBufferItemList. List
+    // nodes are stable, so the pointers stay valid until the item is erased.
+    KeyedVector<nsecs_t, RingBufferItem*> mTimestampIndex;
     const int                  mBufferCount;
 
     // Timestamp of latest buffer